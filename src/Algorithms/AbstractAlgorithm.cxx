@@ -20,11 +20,14 @@
 
 #include "AbstractAlgorithm.h"
 
+#include "CaretProfiler.h"
+
 using namespace std;
 using namespace caret;
 
-AbstractAlgorithm::AbstractAlgorithm(ProgressObject* myProgressObject)
+AbstractAlgorithm::AbstractAlgorithm(ProgressObject* myProgressObject, const AString& profileName)
 {
+    m_profileSection = CaretProfiler::beginSection(profileName, "algorithm");
     m_progObj = myProgressObject;
     m_finish = true;
     if (m_progObj == NULL)
@@ -56,6 +59,7 @@ float AbstractAlgorithm::getAlgorithmWeight()
 
 AbstractAlgorithm::~AbstractAlgorithm()
 {
+    CaretProfiler::endSection(m_profileSection);
     if ((m_progObj != NULL) && m_finish)
     {
         m_progObj->forceFinish();
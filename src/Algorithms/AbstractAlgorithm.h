@@ -34,13 +34,15 @@ namespace caret {
     {
         ProgressObject* m_progObj;//so that the destructor can make sure the bar finishes
         bool m_finish;
+        int64_t m_profileSection;//for -profile, ended by the destructor, which also runs if the derived constructor throws
         AbstractAlgorithm();//prevent default construction
     protected:
         ///override this with the weights of the algorithms this algorithm will call
         static float getSubAlgorithmWeight();//protected so that people don't try to use them to set algorithm weights in progress objects
         ///override this with the amount of work the algorithm does internally, outside of calls to other algorithms
         static float getAlgorithmInternalWeight();
-        AbstractAlgorithm(ProgressObject* myProgressObject);
+        ///profileName names the -profile section that times the algorithm, derived classes should pass getCommandSwitch()
+        AbstractAlgorithm(ProgressObject* myProgressObject, const AString& profileName);
         virtual ~AbstractAlgorithm();
     public:
         ///use this to set the weight parameter of a ProgressObject
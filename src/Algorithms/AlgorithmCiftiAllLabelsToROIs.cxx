@@ -75,7 +75,7 @@ void AlgorithmCiftiAllLabelsToROIs::useParameters(OperationParameters* myParams,
     AlgorithmCiftiAllLabelsToROIs(myProgObj, myLabel, whichMap, myCiftiOut);
 }
 
-AlgorithmCiftiAllLabelsToROIs::AlgorithmCiftiAllLabelsToROIs(ProgressObject* myProgObj, const CiftiFile* myLabel, const int& whichMap, CiftiFile* myCiftiOut) : AbstractAlgorithm(myProgObj)
+AlgorithmCiftiAllLabelsToROIs::AlgorithmCiftiAllLabelsToROIs(ProgressObject* myProgObj, const CiftiFile* myLabel, const int& whichMap, CiftiFile* myCiftiOut) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     const CiftiXMLOld& myXML = myLabel->getCiftiXMLOld();
@@ -22,10 +22,13 @@
 #include "AlgorithmException.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
+#include "CiftiGroupBlockReader.h"
 #include "MathFunctions.h"
 
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
@@ -92,7 +95,7 @@ void AlgorithmCiftiAverage::useParameters(OperationParameters* myParams, Progres
     }
 }
 
-AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const vector<const CiftiFile*>& ciftiList, CiftiFile* ciftiOut, const vector<float>* weightsPtr) : AbstractAlgorithm(myProgObj)
+AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const vector<const CiftiFile*>& ciftiList, CiftiFile* ciftiOut, const vector<float>* weightsPtr) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (ciftiList.size() == 0)
@@ -116,56 +119,67 @@ AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const ve
         }
     }
     ciftiOut->setCiftiXML(baseXML);
-    vector<double> accum(rowSize);
-    vector<float> myrow(rowSize);
-    for (int i = 0; i < numRows; ++i)
+    CiftiGroupBlockReader myReader(ciftiList);
+    int64_t blockRows = myReader.getBlockRows();
+    vector<float> outBlock;
+    for (int64_t startRow = 0; startRow < numRows; startRow += blockRows)
     {
-        vector<double> weightaccum(rowSize, 0.0);
-        for (int j = 0; j < rowSize; ++j)
+        int64_t thisBlockRows = min(blockRows, numRows - startRow);
+        myReader.readBlock(startRow, thisBlockRows);
+        outBlock.resize(thisBlockRows * rowSize);
+#pragma omp CARET_PAR
         {
-            accum[j] = 0.0;
-        }
-        for (int j = 0; j < numFiles; ++j)
-        {
-            ciftiList[j]->getRow(myrow.data(), i);
-            if (weightsPtr == NULL)
+            vector<double> accum(rowSize), weightaccum(rowSize);
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int64_t i = 0; i < thisBlockRows; ++i)
             {
                 for (int k = 0; k < rowSize; ++k)
                 {
-                    if (MathFunctions::isNumeric(myrow[k]))
+                    accum[k] = 0.0;
+                    weightaccum[k] = 0.0;
+                }
+                for (int j = 0; j < numFiles; ++j)
+                {//same summation order as one row at a time
+                    const float* myrow = myReader.getBlockData(j) + i * rowSize;
+                    float weight = 1.0f;
+                    if (weightsPtr != NULL) weight = (*weightsPtr)[j];
+                    for (int k = 0; k < rowSize; ++k)
                     {
-                        weightaccum[k] += 1.0;
-                        accum[k] += myrow[k];
+                        if (MathFunctions::isNumeric(myrow[k]))
+                        {
+                            if (weightsPtr == NULL)
+                            {
+                                weightaccum[k] += 1.0;
+                                accum[k] += myrow[k];
+                            } else {
+                                weightaccum[k] += weight;
+                                accum[k] += myrow[k] * weight;
+                            }
+                        }
                     }
                 }
-            } else {
-                float weight = (*weightsPtr)[j];
+                float* outrow = outBlock.data() + i * rowSize;
                 for (int k = 0; k < rowSize; ++k)
                 {
-                    if (MathFunctions::isNumeric(myrow[k]))
+                    if (weightaccum[k] != 0.0)
                     {
-                        weightaccum[k] += weight;
-                        accum[k] += myrow[k] * weight;
+                        outrow[k] = accum[k] / weightaccum[k];
+                    } else {
+                        outrow[k] = 0.0f;
                     }
                 }
             }
         }
-        for (int k = 0; k < rowSize; ++k)
+        for (int64_t i = 0; i < thisBlockRows; ++i)
         {
-            if (weightaccum[k] != 0.0)
-            {
-                myrow[k] = accum[k] / weightaccum[k];
-            } else {
-                myrow[k] = 0.0f;
-            }
+            ciftiOut->setRow(outBlock.data() + i * rowSize, startRow + i);
         }
-        ciftiOut->setRow(myrow.data(), i);
     }
 }
 
 AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const vector<const CiftiFile*>& ciftiList,
                                              const float& sigmaBelow, const float& sigmaAbove,
-                                             CiftiFile* ciftiOut, const std::vector<float>* weightsPtr): AbstractAlgorithm(myProgObj)
+                                             CiftiFile* ciftiOut, const std::vector<float>* weightsPtr): AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (ciftiList.size() < 2)
@@ -190,75 +204,98 @@ AlgorithmCiftiAverage::AlgorithmCiftiAverage(ProgressObject* myProgObj, const ve
     }
     bool haveWarned = false;
     ciftiOut->setCiftiXML(baseXML);
-    vector<vector<float> > myrows(numFiles, vector<float>(rowSize));
-    for (int i = 0; i < numRows; ++i)
+    CiftiGroupBlockReader myReader(ciftiList);
+    int64_t blockRows = myReader.getBlockRows();
+    vector<float> outBlock;
+    for (int64_t startRow = 0; startRow < numRows; startRow += blockRows)
     {
-        for (int j = 0; j < numFiles; ++j)
+        int64_t thisBlockRows = min(blockRows, numRows - startRow);
+        myReader.readBlock(startRow, thisBlockRows);
+        outBlock.resize(thisBlockRows * rowSize);
+        int64_t blockElements = thisBlockRows * rowSize;
+        bool foundFewNumeric = false;//set from each thread's own flag, so the shared flag is only touched inside the critical section
+#pragma omp CARET_PAR
         {
-            ciftiList[j]->getRow(myrows[j].data(), i);
-        }
-        vector<float> outrow(rowSize);
-        for (int k = 0; k < rowSize; ++k)
-        {
-            double accum = 0.0;
-            double weightaccum = 0.0;
-            int nonnumeric = 0;
-            for (int j = 0; j < numFiles; ++j)
-            {
-                if (MathFunctions::isNumeric(myrows[j][k]))
-                {
-                    accum += myrows[j][k];
-                } else {
-                    ++nonnumeric;
-                }
-            }
-            if (nonnumeric >= numFiles - 1)
+            vector<float> values(numFiles);
+            bool threadFoundFewNumeric = false;
+#pragma omp CARET_FOR schedule(dynamic, 1024)
+            for (int64_t elem = 0; elem < blockElements; ++elem)
             {
-                if (!haveWarned)
+                for (int j = 0; j < numFiles; ++j)
                 {
-                    CaretLogWarning("found element where less than 2 files have numeric values");
-                    haveWarned = true;
+                    values[j] = myReader.getBlockData(j)[elem];
                 }
-                outrow[k] = 0.0f;
-            } else {
-                float mean = accum / (numFiles - nonnumeric);
-                accum = 0.0;
+                double accum = 0.0;
+                double weightaccum = 0.0;
+                int nonnumeric = 0;
                 for (int j = 0; j < numFiles; ++j)
                 {
-                    if (MathFunctions::isNumeric(myrows[j][k]))
+                    if (MathFunctions::isNumeric(values[j]))
                     {
-                        float temp = myrows[j][k] - mean;
-                        accum += temp * temp;
+                        accum += values[j];
+                    } else {
+                        ++nonnumeric;
                     }
                 }
-                float stdev = sqrt(accum / (numFiles - 1 - nonnumeric));
-                float cutoffLow = mean - sigmaBelow * stdev;
-                float cutoffHigh = mean + sigmaAbove * stdev;
-                accum = 0.0;
-                for (int j = 0; j < numFiles; ++j)
+                if (nonnumeric >= numFiles - 1)
                 {
-                    if (myrows[j][k] > cutoffLow && myrows[j][k] < cutoffHigh)//implicitly excludes NaN and inf
+                    threadFoundFewNumeric = true;
+                    outBlock[elem] = 0.0f;
+                } else {
+                    float mean = accum / (numFiles - nonnumeric);
+                    accum = 0.0;
+                    for (int j = 0; j < numFiles; ++j)
+                    {
+                        if (MathFunctions::isNumeric(values[j]))
+                        {
+                            float temp = values[j] - mean;
+                            accum += temp * temp;
+                        }
+                    }
+                    float stdev = sqrt(accum / (numFiles - 1 - nonnumeric));
+                    float cutoffLow = mean - sigmaBelow * stdev;
+                    float cutoffHigh = mean + sigmaAbove * stdev;
+                    accum = 0.0;
+                    for (int j = 0; j < numFiles; ++j)
                     {
-                        if (weightsPtr != NULL)
+                        if (values[j] > cutoffLow && values[j] < cutoffHigh)//implicitly excludes NaN and inf
                         {
-                            float weight = (*weightsPtr)[j];
-                            accum += myrows[j][k] * weight;
-                            weightaccum += weight;
-                        } else {
-                            accum += myrows[j][k];
-                            weightaccum += 1.0;
+                            if (weightsPtr != NULL)
+                            {
+                                float weight = (*weightsPtr)[j];
+                                accum += values[j] * weight;
+                                weightaccum += weight;
+                            } else {
+                                accum += values[j];
+                                weightaccum += 1.0;
+                            }
                         }
                     }
+                    if (weightaccum != 0.0)
+                    {
+                        outBlock[elem] = accum / weightaccum;
+                    } else {
+                        outBlock[elem] = 0.0f;
+                    }
                 }
-                if (weightaccum != 0.0)
+            }
+            if (threadFoundFewNumeric)
+            {
+#pragma omp critical
                 {
-                    outrow[k] = accum / weightaccum;
-                } else {
-                    outrow[k] = 0.0f;
+                    foundFewNumeric = true;
                 }
             }
         }
-        ciftiOut->setRow(outrow.data(), i);
+        if (foundFewNumeric && !haveWarned)
+        {
+            CaretLogWarning("found element where less than 2 files have numeric values");
+            haveWarned = true;
+        }
+        for (int64_t i = 0; i < thisBlockRows; ++i)
+        {
+            ciftiOut->setRow(outBlock.data() + i * rowSize, startRow + i);
+        }
     }
 }
 
@@ -189,7 +189,7 @@ AlgorithmCiftiCorrelationGradient::AlgorithmCiftiCorrelationGradient(ProgressObj
                                                                      const float& surfKern, const float& volKern, const bool& undoFisherInput, const bool& applyFisher,
                                                                      const float& surfaceExclude, const float& volumeExclude,
                                                                      const bool& covariance,
-                                                                     const float& memLimitGB) : AbstractAlgorithm(myProgObj)
+                                                                     const float& memLimitGB) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     init(myCifti, undoFisherInput, applyFisher, covariance);
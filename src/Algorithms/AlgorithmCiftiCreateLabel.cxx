@@ -135,7 +135,7 @@ void AlgorithmCiftiCreateLabel::useParameters(OperationParameters* myParams, Pro
 AlgorithmCiftiCreateLabel::AlgorithmCiftiCreateLabel(ProgressObject* myProgObj, CiftiFile* myCiftiOut, const VolumeFile* myVol,
                                                                          const VolumeFile* myVolLabel, const LabelFile* leftData, const MetricFile* leftRoi,
                                                                          const LabelFile* rightData, const MetricFile* rightRoi, const LabelFile* cerebData,
-                                                                         const MetricFile* cerebRoi) : AbstractAlgorithm(myProgObj)
+                                                                         const MetricFile* cerebRoi) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     CaretAssert(myCiftiOut != NULL);
     LevelProgress myProgress(myProgObj);
@@ -25,15 +25,19 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "CiftiFile.h"
-#include "dot_wrapper.h"
 #include "FileInformation.h"
 
-#include <cmath>
+#include <algorithm>
 #include <fstream>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t BLOCK_ROWS_B = 64;//rows of B that are read, packed and correlated against the cached A rows together
+}
+
 AString AlgorithmCiftiCrossCorrelation::getCommandSwitch()
 {
     return "-cifti-cross-correlation";
@@ -65,7 +69,8 @@ OperationParameters* AlgorithmCiftiCrossCorrelation::getParameters()
         AString("Correlates every row in <cifti-a> with every row in <cifti-b>.  ") +
         "The mapping along columns in <cifti-b> becomes the mapping along rows in the output.\n\n" +
         "When using the -fisher-z option, the output is NOT a Z-score, it is artanh(r), to do further math on this output, consider using -cifti-math.\n\n" +
-        "Restricting the memory usage will make it calculate the output in chunks, by reading through <cifti-b> multiple times."
+        "Restricting the memory usage will make it calculate the output in chunks, by reading through <cifti-b> multiple times.\n\n" +
+        "This command uses its own blocked dot product, so the -simd global option has no effect on it."
     );
     return ret;
 }
@@ -116,7 +121,7 @@ void AlgorithmCiftiCrossCorrelation::useParameters(OperationParameters* myParams
 }
 
 AlgorithmCiftiCrossCorrelation::AlgorithmCiftiCrossCorrelation(ProgressObject* myProgObj, const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, CiftiFile* myCiftiOut,
-                                                               const vector<float>* weights, const bool& fisherZ, const float& memLimitGB) : AbstractAlgorithm(myProgObj)
+                                                               const vector<float>* weights, const bool& fisherZ, const float& memLimitGB) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     init(myCiftiA, myCiftiB, myCiftiOut, weights);
@@ -128,35 +133,59 @@ AlgorithmCiftiCrossCorrelation::AlgorithmCiftiCrossCorrelation(ProgressObject* m
     {
         chunkSize = numRowsForMem(memLimitGB);
     }
-    vector<vector<float> > outscratch(chunkSize, vector<float>(m_numRowsB));//allocate output rows
+    const int64_t TILE = CorrelationEngine::TILE_SIZE;
+    const int64_t numBlocksB = (m_numRowsB - 1) / BLOCK_ROWS_B + 1;
+    vector<float> outscratch(chunkSize * m_numRowsB), rrsA(chunkSize);//allocate output rows
+    vector<const float*> rowsA(chunkSize);
     for (int64_t chunkStart = 0; chunkStart < m_numRowsA; chunkStart += chunkSize)
     {
         int64_t chunkEnd = chunkStart + chunkSize;
         if (chunkEnd > m_numRowsA) chunkEnd = m_numRowsA;
         cacheRowsA(chunkStart, chunkEnd);
-        int64_t counter = 0;
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int64_t i = 0; i < m_numRowsB; ++i)
+        const int64_t chunkRows = chunkEnd - chunkStart;
+        for (int64_t i = 0; i < chunkRows; ++i)
         {
-            float rrsB;
-            int64_t indB;
-            const float* rowB;
-#pragma omp critical
-            {
-                indB = counter;//manually in-order rows because we need to read them from disk, and can't request more than one at a time
-                ++counter;
-                rowB = getRowB(indB, rrsB);
-            }
-            for (int indA = chunkStart; indA < chunkEnd; ++indA)
+            const RowInfo& myInfo = m_rowInfoA[chunkStart + i];
+            rowsA[i] = m_rowCacheA[myInfo.m_cacheIndex].m_row.data();
+            rrsA[i] = myInfo.m_rootResidSqr;
+        }
+        const int64_t numTilesA = (chunkRows - 1) / TILE + 1;
+        readBlockB(m_blocksB[0], 0);
+        for (int64_t block = 0; block < numBlocksB; ++block)
+        {
+            const BlockB& current = m_blocksB[block % 2];
+            BlockB& next = m_blocksB[(block + 1) % 2];
+            const int64_t numTilesB = (current.m_count - 1) / TILE + 1;
+            const int64_t numTiles = numTilesA * numTilesB;
+            AString errorMessage;
+#pragma omp CARET_PAR
             {
-                float rrsA;
-                const float* rowA = getCachedRowA(indA, rrsA);
-                outscratch[indA - chunkStart][indB] = correlate(rowA, rrsA, rowB, rrsB, fisherZ);
+#pragma omp CARET_SINGLE nowait
+                {//one thread reads the next block, then joins in on the tiles that are left
+                    if (block + 1 < numBlocksB)
+                    {
+                        try
+                        {
+                            readBlockB(next, (block + 1) * BLOCK_ROWS_B);
+                        } catch (CaretException& e) {//exceptions can't leave an openmp region
+                            errorMessage = e.whatString();
+                        }
+                    }
+                }
+#pragma omp CARET_FOR schedule(dynamic)
+                for (int64_t tile = 0; tile < numTiles; ++tile)
+                {
+                    const int64_t firstA = (tile / numTilesB) * TILE, firstB = (tile % numTilesB) * TILE;//consecutive tiles share rows from A
+                    m_engine->correlateTile(rowsA.data() + firstA, rrsA.data() + firstA, min(TILE, chunkRows - firstA),
+                                            current.m_panel.data() + firstB * m_engine->getPreparedLength(), current.m_rootResidSqr.data() + firstB, min(TILE, current.m_count - firstB),
+                                            outscratch.data() + firstA * m_numRowsB + current.m_start + firstB, m_numRowsB, fisherZ);
+                }
             }
+            if (errorMessage != "") throw AlgorithmException(errorMessage);
         }
         for (int64_t indA = chunkStart; indA < chunkEnd; ++indA)
         {
-            myCiftiOut->setRow(outscratch[indA - chunkStart].data(), indA);
+            myCiftiOut->setRow(outscratch.data() + (indA - chunkStart) * m_numRowsB, indA);
         }
     }
 }
@@ -174,36 +203,17 @@ void AlgorithmCiftiCrossCorrelation::init(const CiftiFile* myCiftiA, const Cifti
     m_rowInfoB.resize(m_numRowsB);
     if (weights != NULL)
     {
-        m_weightSum = 0.0;
-        m_weightedMode = true;
         int64_t numWeights = (int64_t)weights->size();
         if (numWeights != m_numCols) throw AlgorithmException("input weights do not match row length");
-        m_binaryWeights = true;
-        for (int i = 0; i < numWeights; ++i)
+        for (int64_t i = 0; i < numWeights; ++i)
         {
-            float val = (*weights)[i];
-            if (val != 0.0f)
+            if ((*weights)[i] < 0.0f)
             {
-                if (val < 0.0f)
-                {
-                    throw AlgorithmException("weights cannot be negative");
-                }
-                m_weightSum += val;
-                m_weights.push_back(val);
-                m_weightIndexes.push_back(i);
-                if (val != 1.0f)
-                {
-                    m_binaryWeights = false;
-                }
+                throw AlgorithmException("weights cannot be negative");
             }
         }
-        if (m_binaryWeights && m_weights.size() == weights->size())
-        {
-            m_weightedMode = false;//all weights were 1, so switch back to normal mode
-        }
-    } else {
-        m_weightedMode = false;
     }
+    m_engine.grabNew(new CorrelationEngine(m_numCols, weights));//handles compacting to nonzero weights, and all weights being 1
 }
 
 int64_t AlgorithmCiftiCrossCorrelation::numRowsForMem(const float& memLimitGB)
@@ -212,11 +222,7 @@ int64_t AlgorithmCiftiCrossCorrelation::numRowsForMem(const float& memLimitGB)
     if (m_ciftiOut->isInMemory()) targetBytes -= sizeof(float) * m_numRowsA * m_numRowsB;//count only in-memory output against total, the only time inputs might be in memory is in the GUI
     int64_t bytesPerInputRow = sizeof(float) * m_numCols;//this means we expect the user to give "current free memory" as the limit
     int64_t bytesPerOutputRow = sizeof(float) * m_numRowsB;
-#ifdef CARET_OMP
-    targetBytes -= bytesPerInputRow * omp_get_max_threads();//subtract the temporary row memory
-#else
-    targetBytes -= bytesPerInputRow;
-#endif
+    targetBytes -= bytesPerInputRow * BLOCK_ROWS_B * 4;//subtract the two blocks of B rows and their packed copies
     int64_t ret = 1;
     if (targetBytes < 1)
     {
@@ -242,70 +248,24 @@ int64_t AlgorithmCiftiCrossCorrelation::numRowsForMem(const float& memLimitGB)
     return ret;
 }
 
-float AlgorithmCiftiCrossCorrelation::correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ)
-{
-    double r;
-    if (m_weightedMode)
-    {
-        int numWeights = (int)m_weightIndexes.size();//because we compacted the data in the row to not include any zero weights
-        double accum = dsdot(row1, row2, numWeights);//these have already had the weighted row means subtracted out, and weights applied
-        r = accum / (rrs1 * rrs2);//as do these
-    } else {
-        double accum = dsdot(row1, row2, m_numCols);//these have already had the row means subtracted out
-        r = accum / (rrs1 * rrs2);
-    }
-    if (fisherZ)
-    {
-        if (r > 0.999999) r = 0.999999;//prevent inf
-        if (r < -0.999999) r = -0.999999;//prevent -inf
-        return 0.5 * log((1 + r) / (1 - r));
-    } else {
-        if (r > 1.0) r = 1.0;//don't output anything silly
-        if (r < -1.0) r = -1.0;
-        return r;
-    }
-}
-
-const float* AlgorithmCiftiCrossCorrelation::getCachedRowA(const int64_t& ciftiIndex, float& rootResidSqr)
-{
-    CaretAssertVectorIndex(m_rowInfoA, ciftiIndex);
-    CaretAssert(m_rowInfoA[ciftiIndex].m_cacheIndex != -1);
-    rootResidSqr = m_rowInfoA[ciftiIndex].m_rootResidSqr;
-    return m_rowCacheA[m_rowInfoA[ciftiIndex].m_cacheIndex].m_row.data();
-}
-
-const float* AlgorithmCiftiCrossCorrelation::getRowB(const int64_t& ciftiIndex, float& rootResidSqr)
-{
-    CaretAssertVectorIndex(m_rowInfoB, ciftiIndex);
-    float* ret = getTempRowB();//purely allocation, one array per thread
-    m_ciftiB->getRow(ret, ciftiIndex);
-    adjustRow(ret, m_rowInfoB[ciftiIndex]);
-    rootResidSqr = m_rowInfoB[ciftiIndex].m_rootResidSqr;//NOTE: must do this AFTER adjustRow, because it is not computed before it on the first chunk
-    return ret;
-}
-
-float* AlgorithmCiftiCrossCorrelation::getTempRowB()
+void AlgorithmCiftiCrossCorrelation::readBlockB(BlockB& block, const int64_t& start)
 {
-#ifdef CARET_OMP
-    int oldsize = (int)m_tempRowsB.size();
-    int threadNum = omp_get_thread_num();
-    if (threadNum >= oldsize)
+    CaretAssert(start >= 0 && start < m_numRowsB);
+    block.m_start = start;
+    block.m_count = min(BLOCK_ROWS_B, m_numRowsB - start);
+    block.m_rows.resize(block.m_count * m_numCols);
+    block.m_rootResidSqr.resize(block.m_count);
+    block.m_panel.resize(m_engine->getPanelSize(block.m_count));
+    vector<const float*> rowPointers(block.m_count);
+    for (int64_t i = 0; i < block.m_count; ++i)
     {
-        m_tempRowsB.resize(threadNum + 1);
-        for (int i = oldsize; i <= threadNum; ++i)
-        {
-            m_tempRowsB[i] = CaretArray<float>(m_numCols);
-        }
+        float* myRow = block.m_rows.data() + i * m_numCols;
+        m_ciftiB->getRow(myRow, start + i);
+        prepareRow(myRow, m_rowInfoB[start + i]);
+        block.m_rootResidSqr[i] = m_rowInfoB[start + i].m_rootResidSqr;//NOTE: must do this AFTER prepareRow, because it is not computed before it on the first chunk
+        rowPointers[i] = myRow;
     }
-    return m_tempRowsB[threadNum].getArray();
-#else
-    if (m_tempRowsB.size() == 0)
-    {
-        m_tempRowsB.resize(1);
-        m_tempRowsB[0] = CaretArray<float>(m_numCols);
-    }
-    return m_tempRowsB[0].getArray();
-#endif
+    m_engine->packPanel(rowPointers.data(), block.m_count, block.m_panel.data());
 }
 
 void AlgorithmCiftiCrossCorrelation::cacheRowsA(const int64_t& begin, const int64_t& end)
@@ -334,83 +294,18 @@ void AlgorithmCiftiCrossCorrelation::cacheRowsA(const int64_t& begin, const int6
         CacheRow& myRow = m_rowCacheA[myindex - begin];
         myRow.m_ciftiIndex = myindex;
         m_rowInfoA[myindex].m_cacheIndex = myindex - begin;
-        adjustRow(myRow.m_row.data(), m_rowInfoA[myindex]);
+        prepareRow(myRow.m_row.data(), m_rowInfoA[myindex]);
     }
 }
 
-void AlgorithmCiftiCrossCorrelation::adjustRow(float* row, RowInfo& info)
+void AlgorithmCiftiCrossCorrelation::prepareRow(float* row, RowInfo& info)
 {
     if (!info.m_haveCalculated)//ensure statistics are calculated
     {
         info.m_haveCalculated = true;
-        double accum = 0.0;
-        if (m_weightedMode)
-        {
-            int64_t mycount = (int64_t)m_weightIndexes.size();
-            if (m_binaryWeights)
-            {
-                for (int64_t i = 0; i < mycount; ++i)
-                {
-                    accum += row[m_weightIndexes[i]];
-                }
-                info.m_mean = accum / mycount;
-                accum = 0.0;
-                for (int64_t i = 0; i < mycount; ++i)
-                {
-                    float tempf = row[m_weightIndexes[i]] - info.m_mean;
-                    accum += tempf * tempf;
-                }
-                info.m_rootResidSqr = sqrt(accum);
-            } else {
-                for (int64_t i = 0; i < mycount; ++i)
-                {
-                    accum += m_weights[i] * row[m_weightIndexes[i]];
-                }
-                info.m_mean = accum / m_weightSum;
-                accum = 0.0;
-                for (int64_t i = 0; i < mycount; ++i)
-                {
-                    float tempf = row[m_weightIndexes[i]] - info.m_mean;
-                    accum += m_weights[i] * tempf * tempf;
-                }
-                info.m_rootResidSqr = sqrt(accum);
-            }
-        } else {
-            for (int64_t i = 0; i < m_numCols; ++i)
-            {
-                accum += row[i];
-            }
-            info.m_mean = accum / m_numCols;
-            accum = 0.0;
-            for (int64_t i = 0; i < m_numCols; ++i)
-            {
-                float tempf = row[i] - info.m_mean;
-                accum += tempf * tempf;
-            }
-            info.m_rootResidSqr = sqrt(accum);
-        }
-    }
-    if (m_weightedMode)//COMPACT data, subtract mean, multiply by square root of weights if applicable
-    {
-        int64_t mycount = (int64_t)m_weightIndexes.size();
-        if (m_binaryWeights)
-        {
-            for (int64_t i = 0; i < mycount; ++i)
-            {
-                row[i] = row[m_weightIndexes[i]] - info.m_mean;
-            }
-        } else {
-            for (int64_t i = 0; i < mycount; ++i)
-            {
-                row[i] = sqrt(m_weights[i]) * (row[m_weightIndexes[i]] - info.m_mean);//this is so the numerator doesn't get squared weights applied, since this happens to both rows
-            }
-        }
-    } else {
-        for (int64_t i = 0; i < m_numCols; ++i)
-        {
-            row[i] -= info.m_mean;
-        }
+        m_engine->computeRowStatistics(row, info.m_mean, info.m_rootResidSqr);
     }
+    m_engine->prepareRow(row, info.m_mean);
 }
 
 float AlgorithmCiftiCrossCorrelation::getAlgorithmInternalWeight()
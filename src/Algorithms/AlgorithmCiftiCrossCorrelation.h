@@ -24,6 +24,7 @@
 #include "AbstractAlgorithm.h"
 
 #include "CaretPointer.h"
+#include "CorrelationEngine.h"
 
 #include <vector>
 
@@ -47,23 +48,27 @@ namespace caret {
                 m_cacheIndex = -1;
             }
         };
+        struct BlockB
+        {
+            int64_t m_start, m_count;
+            std::vector<float> m_rows, m_panel, m_rootResidSqr;//prepared rows, and the same rows packed for CorrelationEngine::correlateTile
+            BlockB()
+            {
+                m_start = 0;
+                m_count = 0;
+            }
+        };
         int64_t m_numCols, m_numRowsA, m_numRowsB;
         const CiftiFile* m_ciftiA, *m_ciftiB, *m_ciftiOut;//output is really only to check if it is in-memory for numRowsForMem
         std::vector<CacheRow> m_rowCacheA;//we only cache from cifti A
         std::vector<RowInfo> m_rowInfoA, m_rowInfoB;
-        std::vector<CaretArray<float> > m_tempRowsB;//reuse return values in getRowB instead of reallocating
-        std::vector<float> m_weights;
-        std::vector<int> m_weightIndexes;
-        bool m_binaryWeights, m_weightedMode;
-        double m_weightSum;
+        BlockB m_blocksB[2];//double buffered, so the next block of B is read while the current one is correlated
+        CaretPointer<CorrelationEngine> m_engine;
         AlgorithmCiftiCrossCorrelation();
         void init(const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, const CiftiFile* myCiftiOut, const std::vector<float>* weights);
         int64_t numRowsForMem(const float& memLimitGB);//call after init()
-        float* getTempRowB();//only used for getRowB, A rows are pulled from cache
-        const float* getCachedRowA(const int64_t& ciftiIndex, float& rootResidSqr);//retrieve already cached rows
-        const float* getRowB(const int64_t& ciftiIndex, float& rootResidSqr);
-        void adjustRow(float* row, RowInfo& info);
-        float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ);
+        void prepareRow(float* row, RowInfo& info);//calculates the statistics the first time a row is seen
+        void readBlockB(BlockB& block, const int64_t& start);//reads, prepares and packs the next rows of B, must not run concurrently with other reads of B
         void cacheRowsA(const int64_t& begin, const int64_t& end);//grabs the rows and does whatever it needs to, using as much IO bandwidth and CPU resources as available/needed
     protected:
         static float getSubAlgorithmWeight();
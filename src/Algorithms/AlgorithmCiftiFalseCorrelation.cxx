@@ -123,7 +123,7 @@ void AlgorithmCiftiFalseCorrelation::useParameters(OperationParameters* myParams
 
 AlgorithmCiftiFalseCorrelation::AlgorithmCiftiFalseCorrelation(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const float& max3D, const float& maxgeo, const float& mingeo,
                                                                CiftiFile* myCiftiOut, const SurfaceFile* myLeftSurf, const AString& leftDumpName,
-                                                               const SurfaceFile* myRightSurf, const AString& rightDumpName, const SurfaceFile* myCerebSurf, const AString& cerebDumpName) : AbstractAlgorithm(myProgObj)
+                                                               const SurfaceFile* myRightSurf, const AString& rightDumpName, const SurfaceFile* myCerebSurf, const AString& cerebDumpName) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     const CiftiXMLOld& myXML = myCiftiIn->getCiftiXMLOld();
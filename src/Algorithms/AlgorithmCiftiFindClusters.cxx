@@ -195,7 +195,7 @@ AlgorithmCiftiFindClusters::AlgorithmCiftiFindClusters(ProgressObject* myProgObj
                                                        const SurfaceFile* myRightSurf, const MetricFile* myRightAreas,
                                                        const SurfaceFile* myCerebSurf, const MetricFile* myCerebAreas,
                                                        const CiftiFile* roiCifti, const bool& mergedVol, const int& startVal, int* endVal,
-                                                       const float& surfSizeRatio, const float& volSizeRatio, const float& surfDistCutoff, const float& volDistCutoff) : AbstractAlgorithm(myProgObj)
+                                                       const float& surfSizeRatio, const float& volSizeRatio, const float& surfDistCutoff, const float& volDistCutoff) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (startVal == 0)
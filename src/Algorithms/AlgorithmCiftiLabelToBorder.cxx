@@ -95,7 +95,7 @@ void AlgorithmCiftiLabelToBorder::useParameters(OperationParameters* myParams, P
 }
 
 AlgorithmCiftiLabelToBorder::AlgorithmCiftiLabelToBorder(ProgressObject* myProgObj, const CiftiFile* myCifti, const SurfaceFile* mySurf,
-                                                         BorderFile* borderOut, const float& placement, const int& column) : AbstractAlgorithm(myProgObj)
+                                                         BorderFile* borderOut, const float& placement, const int& column) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     const CiftiXML& myXML = myCifti->getCiftiXML();
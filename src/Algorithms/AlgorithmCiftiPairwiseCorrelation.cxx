@@ -25,13 +25,27 @@
 #include "CaretLogger.h"
 #include "CaretOMP.h"
 #include "CiftiFile.h"
+#include "CorrelationEngine.h"
 #include "FileInformation.h"
 
-#include <cmath>
+#include <algorithm>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t BLOCK_ROWS = 256;//rows of each input that are read together while the previous rows are correlated
+    
+    void readRowBlock(const CiftiFile* input, const int64_t& start, const int64_t& count, const int64_t& rowLength, float* rowsOut)
+    {
+        for (int64_t i = 0; i < count; ++i)
+        {
+            input->getRow(rowsOut + i * rowLength, start + i);
+        }
+    }
+}
+
 AString AlgorithmCiftiPairwiseCorrelation::getCommandSwitch()
 {
     return "-cifti-pairwise-correlation";
@@ -56,7 +70,8 @@ OperationParameters* AlgorithmCiftiPairwiseCorrelation::getParameters()
     ret->createOptionalParameter(5, "-override-mapping-check", "don't check the mappings for compatibility, only check length");
     
     ret->setHelpText(
-        AString("For each row in <cifti-a>, correlate it with the same row in <cifti-b>, and put the result in the same row of <cifti-out>, which has only one column.")
+        AString("For each row in <cifti-a>, correlate it with the same row in <cifti-b>, and put the result in the same row of <cifti-out>, which has only one column.  ") +
+        "The -simd global option has no effect on this command."
     );
     return ret;
 }
@@ -72,7 +87,7 @@ void AlgorithmCiftiPairwiseCorrelation::useParameters(OperationParameters* myPar
 }
 
 AlgorithmCiftiPairwiseCorrelation::AlgorithmCiftiPairwiseCorrelation(ProgressObject* myProgObj, const CiftiFile* myCiftiA, const CiftiFile* myCiftiB, CiftiFile* myCiftiOut,
-                                                                     const bool& fisherZ, const bool& overrideMappingCheck) : AbstractAlgorithm(myProgObj)
+                                                                     const bool& fisherZ, const bool& overrideMappingCheck) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     CiftiXMLOld outXML = myCiftiA->getCiftiXMLOld();
@@ -87,54 +102,73 @@ AlgorithmCiftiPairwiseCorrelation::AlgorithmCiftiPairwiseCorrelation(ProgressObj
     outXML.resetRowsToScalars(1);
     outXML.setMapNameForRowIndex(0, "pairwise correlation");
     myCiftiOut->setCiftiXML(outXML);
-    vector<float> rowA(rowLength), rowB(rowLength), columnOut(numRows);
-    for (int64_t i = 0; i < numRows; ++i)
+    CorrelationEngine myEngine(rowLength);
+    const int64_t blockRows = min(BLOCK_ROWS, numRows);
+    const int64_t numBlocks = (numRows - 1) / blockRows + 1;
+    const bool separateFiles = (myCiftiA != myCiftiB);//reading one file from two threads at once isn't allowed
+    vector<float> blocksA[2], blocksB[2], columnOut(numRows);
+    for (int i = 0; i < 2; ++i)
     {
-        float rrsA, rrsB;
-        myCiftiA->getRow(rowA.data(), i);
-        myCiftiB->getRow(rowB.data(), i);
-        preprocess(rowA.data(), rowLength, rrsA);
-        preprocess(rowB.data(), rowLength, rrsB);
-        columnOut[i] = correlate(rowA.data(), rrsA, rowB.data(), rrsB, rowLength, fisherZ);
+        blocksA[i].resize(blockRows * rowLength);
+        blocksB[i].resize(blockRows * rowLength);
     }
-    myCiftiOut->setColumn(columnOut.data(), 0);
-}
-
-void AlgorithmCiftiPairwiseCorrelation::preprocess(float* row, const int64_t length, float& rrsOut)
-{
-    double accum = 0.0;
-    for (int64_t i = 0; i < length; ++i)
+    readRowBlock(myCiftiA, 0, blockRows, rowLength, blocksA[0].data());
+    readRowBlock(myCiftiB, 0, blockRows, rowLength, blocksB[0].data());
+    for (int64_t block = 0; block < numBlocks; ++block)
     {
-        accum += row[i];
-    }
-    float mean = accum / length;
-    accum = 0.0;
-    for (int64_t i = 0; i < length; ++i)
-    {
-        row[i] -= mean;
-        accum += row[i] * row[i];
-    }
-    rrsOut = sqrt(accum);
-}
-
-float AlgorithmCiftiPairwiseCorrelation::correlate(const float* rowA, const float& rrsA, const float* rowB, const float& rrsB, const int64_t& length, const bool& fisherZ)
-{
-    double r = 0.0;
-    for (int64_t i = 0; i < length; ++i)
-    {
-        r += rowA[i] * rowB[i];
-    }
-    r /= rrsA * rrsB;
-    if (fisherZ)
-    {
-        if (r > 0.999999) r = 0.999999;//prevent inf
-        if (r < -0.999999) r = -0.999999;//prevent -inf
-        return 0.5 * log((1 + r) / (1 - r));
-    } else {
-        if (r > 1.0) r = 1.0;//don't output anything silly
-        if (r < -1.0) r = -1.0;
-        return r;
+        const int64_t blockStart = block * blockRows, blockCount = min(blockRows, numRows - blockStart);
+        const int64_t nextStart = blockStart + blockRows, nextCount = min(blockRows, numRows - nextStart);
+        float* currentA = blocksA[block % 2].data(), *currentB = blocksB[block % 2].data();
+        float* nextA = blocksA[(block + 1) % 2].data(), *nextB = blocksB[(block + 1) % 2].data();
+        AString errorMessage;
+#pragma omp CARET_PAR
+        {//while the current block is correlated, the next block is read from both inputs, concurrently if they are different files
+#pragma omp CARET_SINGLE nowait
+            {
+                if (nextCount > 0)
+                {
+                    try
+                    {
+                        readRowBlock(myCiftiA, nextStart, nextCount, rowLength, nextA);
+                        if (!separateFiles) readRowBlock(myCiftiB, nextStart, nextCount, rowLength, nextB);
+                    } catch (CaretException& e) {//exceptions can't leave an openmp region
+#pragma omp critical
+                        {
+                            errorMessage = e.whatString();
+                        }
+                    }
+                }
+            }
+#pragma omp CARET_SINGLE nowait
+            {
+                if (nextCount > 0 && separateFiles)
+                {
+                    try
+                    {
+                        readRowBlock(myCiftiB, nextStart, nextCount, rowLength, nextB);
+                    } catch (CaretException& e) {
+#pragma omp critical
+                        {
+                            errorMessage = e.whatString();
+                        }
+                    }
+                }
+            }
+#pragma omp CARET_FOR schedule(dynamic, 16)
+            for (int64_t i = 0; i < blockCount; ++i)
+            {
+                float* rowA = currentA + i * rowLength, *rowB = currentB + i * rowLength;
+                float meanA, rrsA, meanB, rrsB;
+                myEngine.computeRowStatistics(rowA, meanA, rrsA);
+                myEngine.computeRowStatistics(rowB, meanB, rrsB);
+                myEngine.prepareRow(rowA, meanA);
+                myEngine.prepareRow(rowB, meanB);
+                columnOut[blockStart + i] = myEngine.correlatePair(rowA, rrsA, rowB, rrsB, fisherZ);
+            }
+        }
+        if (errorMessage != "") throw AlgorithmException(errorMessage);
     }
+    myCiftiOut->setColumn(columnOut.data(), 0);
 }
 
 float AlgorithmCiftiPairwiseCorrelation::getAlgorithmInternalWeight()
@@ -28,8 +28,6 @@ namespace caret {
     class AlgorithmCiftiPairwiseCorrelation : public AbstractAlgorithm
     {
         AlgorithmCiftiPairwiseCorrelation();
-        void preprocess(float* row, const int64_t length, float& rrsOut);
-        float correlate(const float* rowA, const float& rrsA, const float* rowB, const float& rrsB, const int64_t& length, const bool& fisherZ);
     protected:
         static float getSubAlgorithmWeight();
         static float getAlgorithmInternalWeight();
@@ -40,6 +40,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <map>
 
 using namespace caret;
 using namespace std;
@@ -509,6 +510,7 @@ namespace
         vector<CiftiBrainModelsMap::SurfaceMap> inSurfMap, outSurfMap;
         vector<CiftiBrainModelsMap::VolumeMap> inVolMap, outVolMap;
         vector<float> floatScratch1, floatScratch2;
+        vector<vector<float> > blockScratch1, blockScratch2;
         vector<int32_t> intScratch1, intScratch2;
         vector<int64_t> inOffset;
         int64_t refDims[3], refOffset[3];
@@ -702,6 +704,56 @@ namespace
             }
         }
     }
+    
+    const int64_t ROW_BLOCK_SIZE = 64;//rows resampled together, so the surface weights are gone through once per block instead of once per row
+    
+    void processRowBlockSurface(ResampleCache& myCache, const vector<vector<float> >& inRows, vector<vector<float> >& outRows, const int64_t& numBlockRows, const int64_t& firstRow,
+                                const CiftiXML& myInputXML, const float& surfdilatemm, const bool& surfLargest, const vector<int>& unassignedLabelKey,
+                                const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent)
+    {
+        bool labelMode = (myInputXML.getMappingType(CiftiXML::ALONG_COLUMN) == CiftiMappingType::LABELS);
+        if (myCache.copyMode || labelMode || surfLargest)
+        {//these don't use the weighted sum, so do them one row at a time
+            for (int64_t b = 0; b < numBlockRows; ++b)
+            {
+                int unassigned = (labelMode ? unassignedLabelKey[firstRow + b] : 0);
+                processRowSurface(myCache, inRows[b], outRows[b], myInputXML, surfdilatemm, surfLargest, unassigned, firstRow + b, surfDilateMethod, surfDilateExponent);
+            }
+            return;
+        }
+        int inMapSize = (int)myCache.inSurfMap.size(), outMapSize = (int)myCache.outSurfMap.size();
+        if ((int64_t)myCache.blockScratch1.size() < numBlockRows)
+        {//nodes outside the input map are never written, and stay 0 like floatScratch1
+            myCache.blockScratch1.resize(numBlockRows, vector<float>(myCache.floatScratch1.size(), 0.0f));
+            myCache.blockScratch2.resize(numBlockRows, vector<float>(myCache.floatScratch2.size(), 0.0f));
+        }
+        vector<const float*> inputs(numBlockRows);
+        vector<float*> outputs(numBlockRows);
+        for (int64_t b = 0; b < numBlockRows; ++b)
+        {
+            for (int j = 0; j < inMapSize; ++j)
+            {
+                myCache.blockScratch1[b][myCache.inSurfMap[j].m_surfaceNode] = inRows[b][myCache.inSurfMap[j].m_ciftiIndex];
+            }
+            inputs[b] = myCache.blockScratch1[b].data();
+            outputs[b] = myCache.blockScratch2[b].data();
+        }
+        myCache.surfResamp.resampleNormal(inputs, outputs);
+        for (int64_t b = 0; b < numBlockRows; ++b)
+        {
+            const float* outData = outputs[b];
+            if (surfdilatemm > 0.0f)
+            {
+                myCache.tempMetric1.setValuesForColumn(0, outputs[b]);
+                AlgorithmMetricDilate(NULL, &(myCache.tempMetric1), myCache.newSphere, surfdilatemm, &(myCache.tempMetric2), &(myCache.surfDilateRoi), NULL, 0, surfDilateMethod, surfDilateExponent);
+                outData = myCache.tempMetric2.getValuePointerForColumn(0);
+            }
+            for (int j = 0; j < outMapSize; ++j)
+            {
+                outRows[b][myCache.outSurfMap[j].m_ciftiIndex] = outData[myCache.outSurfMap[j].m_surfaceNode];
+            }
+        }
+    }
 }
 
 AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const CiftiFile* myCiftiIn, const int& direction, const CiftiFile* myTemplate, const int& templateDir,
@@ -712,7 +764,7 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                                                const SurfaceFile* curRightSphere, const SurfaceFile* newRightSphere, const MetricFile* curRightAreas, const MetricFile* newRightAreas,
                                                const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas,
                                                const AlgorithmVolumeDilate::Method& volDilateMethod, const float& volDilateExponent,
-                                               const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent) : AbstractAlgorithm(myProgObj)
+                                               const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     pair<bool, AString> myError = checkForErrors(myCiftiIn, direction, myTemplate, templateDir, mySurfMethod,
@@ -782,48 +834,60 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                            curRightSphere, newRightSphere, curRightAreas, newRightAreas,
                            curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas);
         int64_t numRows = myInputXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-        vector<float> inRow(myInputXML.getDimensionLength(CiftiXML::ALONG_ROW)), outRow(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW));
-        for (int64_t row = 0; row < numRows; ++row)
+        int64_t maxBlockRows = min(ROW_BLOCK_SIZE, numRows);
+        vector<vector<float> > inRows(maxBlockRows, vector<float>(myInputXML.getDimensionLength(CiftiXML::ALONG_ROW))),
+                               outRows(maxBlockRows, vector<float>(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW)));
+        for (int64_t firstRow = 0; firstRow < numRows; firstRow += ROW_BLOCK_SIZE)
         {
-            myCiftiIn->getRow(inRow.data(), row);
+            int64_t numBlockRows = min(ROW_BLOCK_SIZE, numRows - firstRow);
+            for (int64_t b = 0; b < numBlockRows; ++b)
+            {
+                myCiftiIn->getRow(inRows[b].data(), firstRow + b);
+            }
             for (int i = 0; i < numSurfStructs; ++i)
             {
                 map<StructureEnum::Enum, ResampleCache>::iterator iter = surfCache.find(surfList[i]);
                 CaretAssert(iter != surfCache.end());
-                processRowSurface(iter->second, inRow, outRow, myInputXML, surfdilatemm, surfLargest, unassignedLabelKey[row], row, surfDilateMethod, surfDilateExponent);
+                processRowBlockSurface(iter->second, inRows, outRows, numBlockRows, firstRow, myInputXML, surfdilatemm, surfLargest, unassignedLabelKey, surfDilateMethod, surfDilateExponent);
             }
-            for (int i = 0; i < numVolStructs; ++i)
+            for (int64_t b = 0; b < numBlockRows; ++b)
             {
-                map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
-                CaretAssert(iter != volCache.end());
-                ResampleCache& myCache = iter->second;
-                if (labelMode)//gets initialized to 0 when not using labels
-                {
-                    myCache.tempVol1->setValueAllVoxels(unassignedLabelKey[row]);
-                }
-                int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
-                for (int j = 0; j < inMapSize; ++j)
-                {
-                    myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
-                                               myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
-                                               myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
-                }
-                const VolumeFile* toResample = myCache.tempVol1;
-                if (voldilatemm > 0.0f)
-                {
-                    myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
-                    AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, volDilateMethod, myCache.tempVol3, myCache.volDilateRoi, NULL, -1, volDilateExponent);
-                    toResample = myCache.tempVol3;
-                }
-                AlgorithmVolumeWarpfieldResample(NULL, toResample, warpfield, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
-                for (int j = 0; j < outMapSize; ++j)
+                const int64_t row = firstRow + b;
+                const vector<float>& inRow = inRows[b];
+                vector<float>& outRow = outRows[b];
+                for (int i = 0; i < numVolStructs; ++i)
                 {
-                    outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
-                                                                                           myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
-                                                                                           myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
+                    map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
+                    CaretAssert(iter != volCache.end());
+                    ResampleCache& myCache = iter->second;
+                    if (labelMode)//gets initialized to 0 when not using labels
+                    {
+                        myCache.tempVol1->setValueAllVoxels(unassignedLabelKey[row]);
+                    }
+                    int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
+                    for (int j = 0; j < inMapSize; ++j)
+                    {
+                        myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
+                                                   myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
+                                                   myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
+                    }
+                    const VolumeFile* toResample = myCache.tempVol1;
+                    if (voldilatemm > 0.0f)
+                    {
+                        myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
+                        AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, volDilateMethod, myCache.tempVol3, myCache.volDilateRoi, NULL, -1, volDilateExponent);
+                        toResample = myCache.tempVol3;
+                    }
+                    AlgorithmVolumeWarpfieldResample(NULL, toResample, warpfield, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
+                    for (int j = 0; j < outMapSize; ++j)
+                    {
+                        outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
+                                                                                               myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
+                                                                                               myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
+                    }
                 }
+                myCiftiOut->setRow(outRow.data(), row);
             }
-            myCiftiOut->setRow(outRow.data(), row);
         }
     }
 }
@@ -836,7 +900,7 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                                                const SurfaceFile* curRightSphere, const SurfaceFile* newRightSphere, const MetricFile* curRightAreas, const MetricFile* newRightAreas,
                                                const SurfaceFile* curCerebSphere, const SurfaceFile* newCerebSphere, const MetricFile* curCerebAreas, const MetricFile* newCerebAreas,
                                                const AlgorithmVolumeDilate::Method& volDilateMethod, const float& volDilateExponent,
-                                               const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent) : AbstractAlgorithm(myProgObj)
+                                               const AlgorithmMetricDilate::Method& surfDilateMethod, const float& surfDilateExponent) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     pair<bool, AString> myError = checkForErrors(myCiftiIn, direction, myTemplate, templateDir, mySurfMethod,
@@ -905,44 +969,56 @@ AlgorithmCiftiResample::AlgorithmCiftiResample(ProgressObject* myProgObj, const
                            curRightSphere, newRightSphere, curRightAreas, newRightAreas,
                            curCerebSphere, newCerebSphere, curCerebAreas, newCerebAreas);
         int64_t numRows = myInputXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-        vector<float> inRow(myInputXML.getDimensionLength(CiftiXML::ALONG_ROW)), outRow(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW));
-        for (int64_t row = 0; row < numRows; ++row)
+        int64_t maxBlockRows = min(ROW_BLOCK_SIZE, numRows);
+        vector<vector<float> > inRows(maxBlockRows, vector<float>(myInputXML.getDimensionLength(CiftiXML::ALONG_ROW))),
+                               outRows(maxBlockRows, vector<float>(myOutXML.getDimensionLength(CiftiXML::ALONG_ROW)));
+        for (int64_t firstRow = 0; firstRow < numRows; firstRow += ROW_BLOCK_SIZE)
         {
-            myCiftiIn->getRow(inRow.data(), row);
+            int64_t numBlockRows = min(ROW_BLOCK_SIZE, numRows - firstRow);
+            for (int64_t b = 0; b < numBlockRows; ++b)
+            {
+                myCiftiIn->getRow(inRows[b].data(), firstRow + b);
+            }
             for (int i = 0; i < numSurfStructs; ++i)
             {
                 map<StructureEnum::Enum, ResampleCache>::iterator iter = surfCache.find(surfList[i]);
                 CaretAssert(iter != surfCache.end());
-                processRowSurface(iter->second, inRow, outRow, myInputXML, surfdilatemm, surfLargest, unassignedLabelKey[row], row, surfDilateMethod, surfDilateExponent);
+                processRowBlockSurface(iter->second, inRows, outRows, numBlockRows, firstRow, myInputXML, surfdilatemm, surfLargest, unassignedLabelKey, surfDilateMethod, surfDilateExponent);
             }
-            for (int i = 0; i < numVolStructs; ++i)
+            for (int64_t b = 0; b < numBlockRows; ++b)
             {
-                map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
-                CaretAssert(iter != volCache.end());
-                ResampleCache& myCache = iter->second;
-                int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
-                for (int j = 0; j < inMapSize; ++j)
-                {
-                    myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
-                                               myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
-                                               myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
-                }
-                const VolumeFile* toResample = myCache.tempVol1;
-                if (voldilatemm > 0.0f)
-                {
-                    myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
-                    AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, volDilateMethod, myCache.tempVol3, myCache.volDilateRoi, NULL, -1, volDilateExponent);
-                    toResample = myCache.tempVol3;
-                }
-                AlgorithmVolumeAffineResample(NULL, toResample, affine, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
-                for (int j = 0; j < outMapSize; ++j)
+                const int64_t row = firstRow + b;
+                const vector<float>& inRow = inRows[b];
+                vector<float>& outRow = outRows[b];
+                for (int i = 0; i < numVolStructs; ++i)
                 {
-                    outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
-                                                                                           myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
-                                                                                           myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
+                    map<StructureEnum::Enum, ResampleCache>::iterator iter = volCache.find(volList[i]);
+                    CaretAssert(iter != volCache.end());
+                    ResampleCache& myCache = iter->second;
+                    int inMapSize = (int)myCache.inVolMap.size(), outMapSize = (int)myCache.outVolMap.size();
+                    for (int j = 0; j < inMapSize; ++j)
+                    {
+                        myCache.tempVol1->setValue(inRow[myCache.inVolMap[j].m_ciftiIndex], myCache.inVolMap[j].m_ijk[0] - myCache.inOffset[0],
+                                                   myCache.inVolMap[j].m_ijk[1] - myCache.inOffset[1],
+                                                   myCache.inVolMap[j].m_ijk[2] - myCache.inOffset[2]);
+                    }
+                    const VolumeFile* toResample = myCache.tempVol1;
+                    if (voldilatemm > 0.0f)
+                    {
+                        myCache.volPadding.doPadding(myCache.tempVol1, myCache.tempVol2);
+                        AlgorithmVolumeDilate(NULL, myCache.tempVol2, voldilatemm, volDilateMethod, myCache.tempVol3, myCache.volDilateRoi, NULL, -1, volDilateExponent);
+                        toResample = myCache.tempVol3;
+                    }
+                    AlgorithmVolumeAffineResample(NULL, toResample, affine, myCache.refDims, myCache.refSform, myVolMethod, myCache.tempVol2);
+                    for (int j = 0; j < outMapSize; ++j)
+                    {
+                        outRow[myCache.outVolMap[j].m_ciftiIndex] = myCache.tempVol2->getValue(myCache.outVolMap[j].m_ijk[0] - myCache.refOffset[0],
+                                                                                               myCache.outVolMap[j].m_ijk[1] - myCache.refOffset[1],
+                                                                                               myCache.outVolMap[j].m_ijk[2] - myCache.refOffset[2]);
+                    }
                 }
+                myCiftiOut->setRow(outRow.data(), row);
             }
-            myCiftiOut->setRow(outRow.data(), row);
         }
     }
 }
@@ -20,11 +20,302 @@
 
 #include "AlgorithmCiftiTranspose.h"
 #include "AlgorithmException.h"
+
+#include "CaretOMP.h"
 #include "CiftiFile.h"
+#include "FileInformation.h"
+#include "SystemUtilities.h"
+
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <cstring>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t TILE_SIZE = 8;
+    const int64_t STRIP_COLS = 64;//columns of a band that one thread transposes at a time
+    const int64_t BAND_TARGET_BYTES = 64 * 1024 * 1024;//size of each buffered band of input rows when memory isn't restricted
+    
+    //fixed size so the compiler can keep the tile in registers and vectorize the loads and stores
+    inline void transpose8x8(const float* in, const int64_t& inStride, float* out, const int64_t& outStride)
+    {
+        float tile[TILE_SIZE][TILE_SIZE];
+        for (int i = 0; i < TILE_SIZE; ++i)
+        {
+            for (int j = 0; j < TILE_SIZE; ++j)
+            {
+                tile[j][i] = in[i * inStride + j];
+            }
+        }
+        for (int j = 0; j < TILE_SIZE; ++j)
+        {
+            for (int i = 0; i < TILE_SIZE; ++i)
+            {
+                out[j * outStride + i] = tile[j][i];
+            }
+        }
+    }
+    
+    //out[c * outStride + r] = in[r * inStride + c], done in 8x8 tiles so that both sides touch whole cache lines
+    void transposeTiles(const float* in, const int64_t& inStride, float* out, const int64_t& outStride, const int64_t& numRows, const int64_t& numCols)
+    {
+        const int64_t fullRows = numRows - numRows % TILE_SIZE, fullCols = numCols - numCols % TILE_SIZE;
+        for (int64_t r = 0; r < fullRows; r += TILE_SIZE)
+        {
+            for (int64_t c = 0; c < fullCols; c += TILE_SIZE)
+            {
+                transpose8x8(in + r * inStride + c, inStride, out + c * outStride + r, outStride);
+            }
+        }
+        for (int64_t c = fullCols; c < numCols; ++c)
+        {
+            for (int64_t r = 0; r < numRows; ++r)
+            {
+                out[c * outStride + r] = in[r * inStride + c];
+            }
+        }
+        for (int64_t c = 0; c < fullCols; ++c)
+        {
+            for (int64_t r = fullRows; r < numRows; ++r)
+            {
+                out[c * outStride + r] = in[r * inStride + c];
+            }
+        }
+    }
+    
+    //how many rows of the given size fit in the byte budget, at least 1, at most maxRows, and a multiple of the tile size when possible
+    int64_t rowsForBytes(const int64_t& bytes, const int64_t& rowBytes, const int64_t& maxRows)
+    {
+        int64_t ret = bytes / max(rowBytes, (int64_t)1);
+        if (ret > TILE_SIZE) ret -= ret % TILE_SIZE;
+        return max((int64_t)1, min(ret, maxRows));
+    }
+    
+    void readRows(const CiftiFile* ciftiIn, const int64_t& start, const int64_t& count, const int64_t& rowLength, float* rowsOut)
+    {
+        for (int64_t i = 0; i < count; ++i)
+        {
+            ciftiIn->getRow(rowsOut + i * rowLength, start + i);
+        }
+    }
+    
+    void writeRows(CiftiFile* ciftiOut, const int64_t& start, const int64_t& count, const int64_t& rowLength, const float* rowsIn)
+    {
+        for (int64_t i = 0; i < count; ++i)
+        {
+            ciftiOut->setRow(rowsIn + i * rowLength, start + i);
+        }
+    }
+    
+    void writeTemp(QTemporaryFile& tempFile, const float* data, const int64_t& count)
+    {
+        const int64_t bytes = count * sizeof(float);
+        if (tempFile.write((const char*)data, bytes) != bytes)
+        {
+            throw AlgorithmException("failed to write to temporary file '" + tempFile.fileName() + "': " + tempFile.errorString());
+        }
+    }
+    
+    void readTemp(QTemporaryFile& tempFile, const int64_t& offset, float* data, const int64_t& count)
+    {
+        const int64_t bytes = count * sizeof(float);
+        if (!tempFile.seek(offset * sizeof(float)) || tempFile.read((char*)data, bytes) != bytes)
+        {
+            throw AlgorithmException("failed to read from temporary file '" + tempFile.fileName() + "': " + tempFile.errorString());
+        }
+    }
+    
+    //each pass reads every input row in bands, and transposes the columns for the current output rows into the cache
+    //the next band is read while the current band is transposed
+    void transposeDirect(const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const int64_t& rowSize, const int64_t& colSize, const int64_t& numCacheRows, const int64_t& bandRows)
+    {
+        vector<float> cacheRows(numCacheRows * rowSize), bands[2];
+        bands[0].resize(bandRows * colSize);
+        bands[1].resize(bandRows * colSize);
+        const int64_t numBands = (rowSize - 1) / bandRows + 1;
+        for (int64_t passStart = 0; passStart < colSize; passStart += numCacheRows)
+        {
+            const int64_t passRows = min(numCacheRows, colSize - passStart);
+            const int64_t numStrips = (passRows - 1) / STRIP_COLS + 1;
+            readRows(ciftiIn, 0, min(bandRows, rowSize), colSize, bands[0].data());
+            for (int64_t band = 0; band < numBands; ++band)
+            {
+                const int64_t bandStart = band * bandRows, bandCount = min(bandRows, rowSize - bandStart);
+                const int64_t nextStart = bandStart + bandRows, nextCount = min(bandRows, rowSize - nextStart);
+                const float* current = bands[band % 2].data();
+                float* next = bands[(band + 1) % 2].data();
+                AString errorMessage;
+#pragma omp CARET_PAR
+                {
+#pragma omp CARET_SINGLE nowait
+                    {//one thread reads the next band, then joins in on the strips that are left
+                        if (nextCount > 0)
+                        {
+                            try
+                            {
+                                readRows(ciftiIn, nextStart, nextCount, colSize, next);
+                            } catch (CaretException& e) {//exceptions can't leave an openmp region
+                                errorMessage = e.whatString();
+                            }
+                        }
+                    }
+#pragma omp CARET_FOR schedule(dynamic)
+                    for (int64_t strip = 0; strip < numStrips; ++strip)
+                    {
+                        const int64_t firstCol = strip * STRIP_COLS, numCols = min(STRIP_COLS, passRows - firstCol);
+                        transposeTiles(current + passStart + firstCol, colSize, cacheRows.data() + firstCol * rowSize + bandStart, rowSize, bandCount, numCols);
+                    }
+                }
+                if (errorMessage != "") throw AlgorithmException(errorMessage);
+            }
+            writeRows(ciftiOut, passStart, passRows, rowSize, cacheRows.data());
+        }
+    }
+    
+    //out-of-core version for when the output rows that fit in memory would need many passes through the input:
+    //first, each band of input rows is transposed and appended to a temporary file, so band b holds colSize rows of the band's length,
+    //then each group of output rows is one contiguous read per band from the temporary file
+    //reading, transposing, and writing are overlapped with double buffers in both phases
+    void transposeWithTempFile(const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const int64_t& rowSize, const int64_t& colSize, const int64_t& memLimitBytes)
+    {
+        AString tempDir = SystemUtilities::getTempDirectory();
+        if (!ciftiOut->isInMemory() && ciftiOut->getFileName() != "")
+        {
+            tempDir = FileInformation(ciftiOut->getFileName()).getAbsolutePath();//the output's filesystem is known to have room for the output
+        }
+        QTemporaryFile tempFile(tempDir + "/wb_transpose_XXXXXX.tmp");
+        if (!tempFile.open())
+        {
+            throw AlgorithmException("failed to create temporary file in '" + tempDir + "': " + tempFile.errorString());
+        }
+        const int64_t bandRows = rowsForBytes(memLimitBytes / 4, colSize * sizeof(float), rowSize);//two input bands and two transposed bands
+        const int64_t numBands = (rowSize - 1) / bandRows + 1;
+        const int64_t numStrips = (colSize - 1) / STRIP_COLS + 1;
+        {
+            vector<float> inBands[2], outBands[2];
+            for (int i = 0; i < 2; ++i)
+            {
+                inBands[i].resize(bandRows * colSize);
+                outBands[i].resize(bandRows * colSize);
+            }
+            readRows(ciftiIn, 0, bandRows, colSize, inBands[0].data());
+            for (int64_t band = 0; band < numBands; ++band)
+            {
+                const int64_t bandStart = band * bandRows, bandCount = min(bandRows, rowSize - bandStart);
+                const int64_t nextStart = bandStart + bandRows, nextCount = min(bandRows, rowSize - nextStart);
+                const float* current = inBands[band % 2].data();
+                float* next = inBands[(band + 1) % 2].data(), *transposed = outBands[band % 2].data();
+                const float* previous = outBands[(band + 1) % 2].data();//transposed in the previous iteration, not yet written
+                AString errorMessage;
+#pragma omp CARET_PAR
+                {
+#pragma omp CARET_SINGLE nowait
+                    {
+                        if (nextCount > 0)
+                        {
+                            try
+                            {
+                                readRows(ciftiIn, nextStart, nextCount, colSize, next);
+                            } catch (CaretException& e) {//exceptions can't leave an openmp region
+#pragma omp critical
+                                {
+                                    errorMessage = e.whatString();
+                                }
+                            }
+                        }
+                    }
+#pragma omp CARET_SINGLE nowait
+                    {
+                        if (band > 0)
+                        {
+                            try
+                            {
+                                writeTemp(tempFile, previous, bandRows * colSize);//only the last band can be short
+                            } catch (CaretException& e) {
+#pragma omp critical
+                                {
+                                    errorMessage = e.whatString();
+                                }
+                            }
+                        }
+                    }
+#pragma omp CARET_FOR schedule(dynamic)
+                    for (int64_t strip = 0; strip < numStrips; ++strip)
+                    {
+                        const int64_t firstCol = strip * STRIP_COLS, numCols = min(STRIP_COLS, colSize - firstCol);
+                        transposeTiles(current + firstCol, colSize, transposed + firstCol * bandCount, bandCount, bandCount, numCols);
+                    }
+                }
+                if (errorMessage != "") throw AlgorithmException(errorMessage);
+            }
+            const int64_t lastCount = rowSize - (numBands - 1) * bandRows;
+            writeTemp(tempFile, outBands[(numBands - 1) % 2].data(), lastCount * colSize);
+            if (!tempFile.flush())
+            {
+                throw AlgorithmException("failed to write to temporary file '" + tempFile.fileName() + "': " + tempFile.errorString());
+            }
+        }//free the band memory before allocating the output groups
+        const int64_t groupRows = rowsForBytes(memLimitBytes, (2 * rowSize + bandRows) * sizeof(float), colSize);//two output groups, and the scratch for one band of a group
+        const int64_t numGroups = (colSize - 1) / groupRows + 1;
+        vector<float> groups[2], scratch(groupRows * bandRows);
+        groups[0].resize(groupRows * rowSize);
+        groups[1].resize(groupRows * rowSize);
+        for (int64_t group = -1; group < numGroups; ++group)
+        {//group -1 only fills the first buffer
+            const int64_t groupStart = group * groupRows, nextStart = groupStart + groupRows;
+            const int64_t nextCount = min(groupRows, colSize - nextStart);
+            AString errorMessage;
+#pragma omp CARET_PAR
+            {
+#pragma omp CARET_SINGLE nowait
+                {//gather the next group from the temporary file
+                    if (nextCount > 0)
+                    {
+                        try
+                        {
+                            float* nextRows = groups[(group + 1) % 2].data();
+                            for (int64_t band = 0; band < numBands; ++band)
+                            {
+                                const int64_t bandStart = band * bandRows, bandCount = min(bandRows, rowSize - bandStart);
+                                readTemp(tempFile, colSize * bandStart + nextStart * bandCount, scratch.data(), nextCount * bandCount);
+                                for (int64_t i = 0; i < nextCount; ++i)
+                                {
+                                    memcpy(nextRows + i * rowSize + bandStart, scratch.data() + i * bandCount, bandCount * sizeof(float));
+                                }
+                            }
+                        } catch (CaretException& e) {//exceptions can't leave an openmp region
+#pragma omp critical
+                            {
+                                errorMessage = e.whatString();
+                            }
+                        }
+                    }
+                }
+#pragma omp CARET_SINGLE nowait
+                {//while writing the current group
+                    if (group >= 0)
+                    {
+                        try
+                        {
+                            writeRows(ciftiOut, groupStart, min(groupRows, colSize - groupStart), rowSize, groups[group % 2].data());
+                        } catch (CaretException& e) {
+#pragma omp critical
+                            {
+                                errorMessage = e.whatString();
+                            }
+                        }
+                    }
+                }
+            }
+            if (errorMessage != "") throw AlgorithmException(errorMessage);
+        }
+    }
+}
+
 AString AlgorithmCiftiTranspose::getCommandSwitch()
 {
     return "-cifti-transpose";
@@ -47,7 +338,9 @@ OperationParameters* AlgorithmCiftiTranspose::getParameters()
     
     ret->setHelpText(
         AString("The input must be a 2-dimensional cifti file.  ") +
-        "The output is a cifti file where every row in the input is a column in the output."
+        "The output is a cifti file where every row in the input is a column in the output.\n\n" +
+        "If the memory limit would require reading the input more than twice, the data is instead transposed in blocks through a temporary file " +
+        "in the same directory as <cifti-out>, which needs as much free space as the output file."
     );
     return ret;
 }
@@ -69,7 +362,7 @@ void AlgorithmCiftiTranspose::useParameters(OperationParameters* myParams, Progr
     AlgorithmCiftiTranspose(myProgObj, ciftiIn, ciftiOut, memLimitGB);
 }
 
-AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const float& memLimitGB) : AbstractAlgorithm(myProgObj)
+AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, const CiftiFile* ciftiIn, CiftiFile* ciftiOut, const float& memLimitGB) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     const CiftiXML& inXML = ciftiIn->getCiftiXML();
@@ -82,34 +375,22 @@ AlgorithmCiftiTranspose::AlgorithmCiftiTranspose(ProgressObject* myProgObj, cons
     outXML.setMap(0, *(inXML.getMap(1)));
     outXML.setMap(1, *(inXML.getMap(0)));
     ciftiOut->setCiftiXML(outXML);
-    int rowSize = outXML.getDimensionLength(CiftiXML::ALONG_ROW), colSize = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
-    int64_t outRowBytes = rowSize * sizeof(float);
-    int numCacheRows = colSize;
+    const int64_t rowSize = outXML.getDimensionLength(CiftiXML::ALONG_ROW), colSize = outXML.getDimensionLength(CiftiXML::ALONG_COLUMN);
+    const int64_t outRowBytes = rowSize * sizeof(float), inRowBytes = colSize * sizeof(float);
+    int64_t numCacheRows = colSize, bandRows = rowsForBytes(BAND_TARGET_BYTES, inRowBytes, rowSize);
     if (memLimitGB >= 0.0f)
     {
-        numCacheRows = memLimitGB * 1024 * 1024 * 1024 / outRowBytes;
-        if (numCacheRows < 1) numCacheRows = 1;
-        if (numCacheRows > colSize) numCacheRows = colSize;
-    }
-    vector<vector<float> > cacheRows(numCacheRows, vector<float>(rowSize));
-    vector<float> scratchInRow(colSize);
-    for (int i = 0; i < colSize; i += numCacheRows)//loop through cache chunks
-    {
-        int end = i + numCacheRows;
-        if (end > colSize) end = colSize;
-        for (int j = 0; j < rowSize; ++j)//loop through all input rows
-        {
-            ciftiIn->getRow(scratchInRow.data(), j);
-            for (int k = i; k < end; ++k)
-            {
-                cacheRows[k - i][j] = scratchInRow[k];
-            }
-        }
-        for (int k = i; k < end; ++k)
-        {
-            ciftiOut->setRow(cacheRows[k - i].data(), k);
+        const int64_t memLimitBytes = memLimitGB * 1024 * 1024 * 1024;
+        bandRows = rowsForBytes(min(BAND_TARGET_BYTES, memLimitBytes / 8), inRowBytes, rowSize);//the two input bands get at most a quarter of the memory
+        numCacheRows = rowsForBytes(memLimitBytes - 2 * bandRows * inRowBytes, outRowBytes, colSize);
+        const int64_t numPasses = (colSize - 1) / numCacheRows + 1;
+        if (numPasses > 2 && !ciftiIn->isInMemory())
+        {//reading the input twice and the output once is cheaper than more passes through the input
+            transposeWithTempFile(ciftiIn, ciftiOut, rowSize, colSize, memLimitBytes);
+            return;
         }
     }
+    transposeDirect(ciftiIn, ciftiOut, rowSize, colSize, numCacheRows, bandRows);
 }
 
 float AlgorithmCiftiTranspose::getAlgorithmInternalWeight()
@@ -97,7 +97,7 @@ void AlgorithmLabelModifyKeys::useParameters(OperationParameters* myParams, Prog
     AlgorithmLabelModifyKeys(myProgObj, labelIn, remap, labelOut, column);
 }
 
-AlgorithmLabelModifyKeys::AlgorithmLabelModifyKeys(ProgressObject* myProgObj, const LabelFile* labelIn, const map<int32_t, int32_t>& remap, LabelFile* labelOut, const int& column) : AbstractAlgorithm(myProgObj)
+AlgorithmLabelModifyKeys::AlgorithmLabelModifyKeys(ProgressObject* myProgObj, const LabelFile* labelIn, const map<int32_t, int32_t>& remap, LabelFile* labelOut, const int& column) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     const GiftiLabelTable* oldTable = labelIn->getLabelTable();
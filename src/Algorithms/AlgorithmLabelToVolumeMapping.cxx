@@ -146,7 +146,7 @@ void AlgorithmLabelToVolumeMapping::useParameters(OperationParameters* myParams,
 }
 
 AlgorithmLabelToVolumeMapping::AlgorithmLabelToVolumeMapping(ProgressObject* myProgObj, const LabelFile* myLabel, const SurfaceFile* mySurf, const VolumeSpace& myVolSpace,
-                                                             VolumeFile* myVolOut, const float& nearDist) : AbstractAlgorithm(myProgObj)
+                                                             VolumeFile* myVolOut, const float& nearDist) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (myLabel->getNumberOfNodes() != mySurf->getNumberOfNodes())
@@ -196,7 +196,7 @@ AlgorithmLabelToVolumeMapping::AlgorithmLabelToVolumeMapping(ProgressObject* myP
 
 AlgorithmLabelToVolumeMapping::AlgorithmLabelToVolumeMapping(ProgressObject* myProgObj, const LabelFile* myLabel, const SurfaceFile* mySurf, const VolumeSpace& myVolSpace,
                                                                  VolumeFile* myVolOut, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int& subDivs,
-                                                                 const bool& greedy, const bool& thickColumn) : AbstractAlgorithm(myProgObj)
+                                                                 const bool& greedy, const bool& thickColumn) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     int numNodes = mySurf->getNumberOfNodes();
     if (myLabel->getNumberOfNodes() != numNodes)
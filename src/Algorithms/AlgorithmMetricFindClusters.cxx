@@ -21,7 +21,10 @@
 #include "AlgorithmMetricFindClusters.h"
 #include "AlgorithmException.h"
 
+#include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
+#include "ConnectedComponentHelper.h"
 #include "GeodesicHelper.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
@@ -145,109 +148,89 @@ void AlgorithmMetricFindClusters::useParameters(OperationParameters* myParams, P
 
 namespace
 {
-    struct Cluster
-    {
-        Cluster() { area = 0.0; }
-        vector<int32_t> members;
-        double area;
-    };
-    
-    void processColumn(const float* data, const float* roiData, const float* nodeAreas, TopologyHelper* myTopoHelp, GeodesicHelper* myGeoHelp,
+    void processColumn(const float* data, const float* roiData, const float* nodeAreas, const ConnectedComponentHelper& myCompHelp, GeodesicHelper* myGeoHelp,
                        const float& threshVal, const float& minArea, const bool& lessThan, const float& areaRatio, const float& distanceCutoff,
-                       float* outData, int& markVal)
-    {
-        int numNodes = myTopoHelp->getNumberOfNodes();
-        vector<int> marked(numNodes, 0);
+                       vector<vector<int32_t> >& clustersOut, vector<char>& marked, vector<int32_t>& labels)
+    {//finds the clusters to keep, in order of lowest vertex, marking is done afterwards so columns can be processed in parallel
+        int numNodes = (int)myCompHelp.getNumberOfElements();
+        marked.resize(numNodes);
+        labels.resize(numNodes);
         if (lessThan)
         {
             for (int i = 0; i < numNodes; ++i)
             {
-                if ((roiData == NULL || roiData[i] > 0.0f) && data[i] < threshVal)
-                {
-                    marked[i] = 1;
-                }
+                marked[i] = ((roiData == NULL || roiData[i] > 0.0f) && data[i] < threshVal) ? 1 : 0;
             }
         } else {
             for (int i = 0; i < numNodes; ++i)
             {
-                if ((roiData == NULL || roiData[i] > 0.0f) && data[i] > threshVal)
-                {
-                    marked[i] = 1;
-                }
+                marked[i] = ((roiData == NULL || roiData[i] > 0.0f) && data[i] > threshVal) ? 1 : 0;
             }
         }
-        vector<Cluster> clusters;
-        float biggestSize = 0.0f;
-        int biggestCluster = -1;
-        for (int i = 0; i < numNodes; ++i)
+        int32_t numComponents = myCompHelp.labelComponents(marked.data(), labels.data());
+        vector<double> areas;
+        myCompHelp.sumPerComponent(labels.data(), numComponents, nodeAreas, areas);
+        vector<char> keep(numComponents, 0);
+        bool anyKept = false;
+        double biggestSize = 0.0;
+        int32_t biggestComponent = -1;
+        for (int32_t i = 0; i < numComponents; ++i)
         {
-            if (marked[i])
+            if (areas[i] > minArea)
             {
-                Cluster newCluster;
-                newCluster.members.push_back(i);
-                marked[i] = 0;//unmark it when added to list to prevent multiples
-                for (int index = 0; index < (int)newCluster.members.size(); ++index)//NOTE: vector grows inside loop
+                keep[i] = 1;
+                anyKept = true;
+                if (areas[i] > biggestSize)
                 {
-                    int node = newCluster.members[index];//keep list around so we can put it into the output immediately if it is large enough
-                    newCluster.area += nodeAreas[node];
-                    const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(node);
-                    int numNeigh = (int)neighbors.size();
-                    for (int n = 0; n < numNeigh; ++n)
-                    {
-                        const int32_t& neighbor = neighbors[n];
-                        if (marked[neighbor])
-                        {
-                            newCluster.members.push_back(neighbor);
-                            marked[neighbor] = 0;
-                        }
-                    }
+                    biggestSize = areas[i];
+                    biggestComponent = i;
                 }
-                if (newCluster.area > minArea)
+            }
+        }
+        if (anyKept && biggestComponent == -1) CaretLogWarning("clusters found, but none have positive area, check your vertex areas for negatives");
+        if (biggestComponent != -1 && areaRatio > 0.0f)
+        {
+            for (int32_t i = 0; i < numComponents; ++i)
+            {
+                if (keep[i] && i != biggestComponent && (areas[i] / biggestSize) < areaRatio)
                 {
-                    if (newCluster.area > biggestSize)
-                    {
-                        biggestSize = newCluster.area;
-                        biggestCluster = (int)clusters.size();
-                    }
-                    clusters.push_back(newCluster);
+                    keep[i] = 0;
                 }
             }
         }
-        vector<int32_t> pathScratch;
-        vector<float> distScratch;
-        if (!clusters.empty() && biggestCluster == -1) CaretLogWarning("clusters found, but none have positive area, check your vertex areas for negatives");
-        if (biggestCluster != -1 && (distanceCutoff > 0.0f || areaRatio > 0.0f))
+        int biggestCluster = -1;
+        if (biggestComponent != -1)
+        {
+            biggestCluster = 0;
+            for (int32_t i = 0; i < biggestComponent; ++i)
+            {
+                if (keep[i]) ++biggestCluster;
+            }
+        }
+        myCompHelp.getComponentMembers(labels.data(), numComponents, clustersOut, keep.data());
+        if (biggestCluster != -1 && distanceCutoff > 0.0f)
         {
-            for (size_t i = 0; i < clusters.size(); ++i)
+            CaretAssert(myGeoHelp != NULL);
+            vector<int32_t> pathScratch;
+            vector<float> distScratch;
+            for (size_t i = 0; i < clustersOut.size(); ++i)
             {
                 if ((int)i != biggestCluster)
                 {
-                    bool erase = false;
-                    if (areaRatio > 0.0f)
+                    myGeoHelp->getPathBetweenNodeLists(clustersOut[i], clustersOut[biggestCluster], distanceCutoff, pathScratch, distScratch, true);
+                    if (pathScratch.empty())//empty path means no path found
                     {
-                        if ((clusters[i].area / biggestSize) < areaRatio)
-                        {
-                            erase = true;
-                        }
-                    }
-                    if (!erase && distanceCutoff > 0.0f)
-                    {
-                        CaretAssert(myGeoHelp != NULL);
-                        myGeoHelp->getPathBetweenNodeLists(clusters[i].members, clusters[biggestCluster].members, distanceCutoff, pathScratch, distScratch, true);
-                        if (pathScratch.empty())//empty path means no path found
-                        {
-                            erase = true;
-                        }
-                    }
-                    if (erase)
-                    {
-                        clusters.erase(clusters.begin() + i);//remove it
+                        clustersOut.erase(clustersOut.begin() + i);//remove it
                         --i;//don't skip a cluster
                         if (biggestCluster > (int)i) --biggestCluster;//don't lose track of the biggest cluster
                     }
                 }
             }
         }
+    }
+    
+    void markClusters(const vector<vector<int32_t> >& clusters, float* outData, int& markVal)
+    {
         for (size_t i = 0; i < clusters.size(); ++i)
         {
             if (markVal == 0)
@@ -257,19 +240,34 @@ namespace
             }
             float tempVal = markVal;
             if ((int)tempVal != markVal) throw AlgorithmException("too many clusters, unable to mark them uniquely");
-            int numMembers = (int)clusters[i].members.size();
+            int numMembers = (int)clusters[i].size();
             for (int index = 0; index < numMembers; ++index)
             {
-                outData[clusters[i].members[index]] = tempVal;
+                outData[clusters[i][index]] = tempVal;
             }
             ++markVal;
         }
     }
+    
+    CaretPointer<GeodesicHelper> getGeoHelper(const SurfaceFile* mySurf, const CaretPointer<GeodesicHelperBase>& myGeoBase, const float& distanceCutoff)
+    {
+        CaretPointer<GeodesicHelper> ret;
+        if (distanceCutoff > 0.0f)//geodesic is only needed for distance cutoff
+        {
+            if (myGeoBase == NULL)
+            {
+                ret = mySurf->getGeodesicHelper();
+            } else {
+                ret.grabNew(new GeodesicHelper(myGeoBase));
+            }
+        }
+        return ret;
+    }
 }
 
 AlgorithmMetricFindClusters::AlgorithmMetricFindClusters(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric, const float& threshVal, const float& minArea,
                                                          MetricFile* myMetricOut, const bool& lessThan, const MetricFile* myRoi, const MetricFile* myAreas,
-                                                         const int& columnNum, const int& startVal, int* endVal, const float& areaRatio, const float& distanceCutoff) : AbstractAlgorithm(myProgObj)
+                                                         const int& columnNum, const int& startVal, int* endVal, const float& areaRatio, const float& distanceCutoff) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (startVal == 0)
@@ -303,39 +301,49 @@ AlgorithmMetricFindClusters::AlgorithmMetricFindClusters(ProgressObject* myProgO
         nodeAreas = myAreas->getValuePointerForColumn(0);
     }
     CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
-    CaretPointer<GeodesicHelper> myGeoHelp;
+    ConnectedComponentHelper myCompHelp(myTopoHelp);
     CaretPointer<GeodesicHelperBase> myGeoBase;
-    if (distanceCutoff > 0.0f)//geodesic is only needed for distance cutoff
+    if (distanceCutoff > 0.0f && myAreas != NULL)
     {
-        if (myAreas == NULL)
-        {
-            myGeoHelp = mySurf->getGeodesicHelper();
-        } else {
-            myGeoBase.grabNew(new GeodesicHelperBase(mySurf, myAreas->getValuePointerForColumn(0)));
-            myGeoHelp.grabNew(new GeodesicHelper(myGeoBase));
-        }
+        myGeoBase.grabNew(new GeodesicHelperBase(mySurf, myAreas->getValuePointerForColumn(0)));
     }
-    vector<int> toSearch;
     int markVal = startVal;//give each cluster a different value, including across maps
     if (columnNum == -1)
     {
         myMetricOut->setNumberOfNodesAndColumns(numNodes, numCols);
         myMetricOut->setStructure(mySurf->getStructure());
+        vector<vector<vector<int32_t> > > colClusters(numCols);
+#pragma omp CARET_PAR
+        {//each thread gets its own geodesic helper and scratch space
+            CaretPointer<GeodesicHelper> myGeoHelp = getGeoHelper(mySurf, myGeoBase, distanceCutoff);
+            vector<char> markScratch;
+            vector<int32_t> labelScratch;
+#pragma omp CARET_FOR schedule(dynamic)
+            for (int c = 0; c < numCols; ++c)
+            {
+                processColumn(myMetric->getValuePointerForColumn(c), roiData, nodeAreas, myCompHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff,
+                              colClusters[c], markScratch, labelScratch);
+            }
+        }
         for (int c = 0; c < numCols; ++c)
-        {
+        {//cluster values increase across columns, so mark them in order
             myMetricOut->setColumnName(c, myMetric->getColumnName(c));
             vector<float> outData(numNodes, 0.0f);
-            const float* data = myMetric->getValuePointerForColumn(c);
-            processColumn(data, roiData, nodeAreas, myTopoHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff, outData.data(), markVal);
+            markClusters(colClusters[c], outData.data(), markVal);
             myMetricOut->setValuesForColumn(c, outData.data());
         }
     } else {
         myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
         myMetricOut->setStructure(mySurf->getStructure());
         myMetricOut->setColumnName(0, myMetric->getColumnName(columnNum));
+        CaretPointer<GeodesicHelper> myGeoHelp = getGeoHelper(mySurf, myGeoBase, distanceCutoff);
+        vector<vector<int32_t> > clusters;
+        vector<char> markScratch;
+        vector<int32_t> labelScratch;
+        processColumn(myMetric->getValuePointerForColumn(columnNum), roiData, nodeAreas, myCompHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff,
+                      clusters, markScratch, labelScratch);
         vector<float> outData(numNodes, 0.0f);
-        const float* data = myMetric->getValuePointerForColumn(columnNum);
-        processColumn(data, roiData, nodeAreas, myTopoHelp, myGeoHelp, threshVal, minArea, lessThan, areaRatio, distanceCutoff, outData.data(), markVal);
+        markClusters(clusters, outData.data(), markVal);
         myMetricOut->setValuesForColumn(0, outData.data());
     }
     if (endVal != NULL) *endVal = markVal;
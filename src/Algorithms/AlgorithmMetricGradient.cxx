@@ -150,7 +150,7 @@ AlgorithmMetricGradient::AlgorithmMetricGradient(ProgressObject* myProgObj,
                                                  const bool myAvgNormals,
                                                  const int32_t myColumn,
                                                  const MetricFile* corrAreaMetric,
-                                                 const bool matchRoiColumns) : AbstractAlgorithm(myProgObj)
+                                                 const bool matchRoiColumns) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     ProgressObject* smoothProgress = NULL;
     if (myProgObj != NULL && myPresmooth > 0.0f)
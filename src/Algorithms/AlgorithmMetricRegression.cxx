@@ -129,7 +129,7 @@ void AlgorithmMetricRegression::useParameters(OperationParameters* myParams, Pro
 }
 
 AlgorithmMetricRegression::AlgorithmMetricRegression(ProgressObject* myProgObj, const MetricFile* myMetricIn, MetricFile* myMetricOut, const vector<pair<const MetricFile*, int> >& remove,
-                                                     const vector<pair<const MetricFile*, int> >& keep, const int& myColumn, const MetricFile* myRoi) : AbstractAlgorithm(myProgObj)
+                                                     const vector<pair<const MetricFile*, int> >& keep, const int& myColumn, const MetricFile* myRoi) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<vector<float> > regressCols;//because we are going to de-mean the input data
@@ -201,71 +201,51 @@ AlgorithmMetricRegression::AlgorithmMetricRegression(ProgressObject* myProgObj,
             demeanCol(thisMetric->getValuePointerForColumn(thisCol), numNodes, roiData, regressCols.back());
         }
     }
-    FloatMatrix xtrans(regressCols);//use naive matrix math - not particularly efficient, but it works
-    regressCols.clear();//don't need this any more, should call destructor on each member vector and release the memory
-    xtrans = xtrans.concatVert(FloatMatrix::ones(1, numUsedNodes));//add constant term
-    FloatMatrix toInvert = xtrans * xtrans.transpose();
-    int invertSize = toInvert.getNumberOfRows();
-    //a bit of a hack, but it should work, though this causes the work of inversion to be done twice
-    if (toInvert.reducedRowEchelon()[invertSize - 1][invertSize - 1] != 1.0f) throw AlgorithmException("regression encountered a non-invertible matrix, check your inputs for linear independence");
-    FloatMatrix solver = toInvert.inverse() * xtrans;//do most of the math in temporaries
-    if (myColumn == -1)
+    int numRegressors = (int)regressCols.size() + 1;//add constant term
+    FloatMatrix design(numUsedNodes, numRegressors);
+    for (int k = 0; k < numRegressors - 1; ++k)
     {
-        myMetricOut->setNumberOfNodesAndColumns(numNodes, numColumns);
-        myMetricOut->setStructure(myMetricIn->getStructure());
-        for (int i = 0; i < numColumns; ++i)
+        for (int m = 0; m < numUsedNodes; ++m)
         {
-            myMetricOut->setColumnName(i, myMetricIn->getColumnName(i) + " regressed");
-            *(myMetricOut->getPaletteColorMapping(i)) = *(myMetricIn->getPaletteColorMapping(i));
-            FloatMatrix y(numUsedNodes, 1);//create column vector for input - note that column vectors are extremely inefficient currently, as is copying the data...
-            const float* data = myMetricIn->getValuePointerForColumn(i);
-            int m = 0;
-            for (int j = 0; j < numNodes; ++j)
-            {
-                if (roiData == NULL || roiData[j] > 0.0f)
-                {
-                    y[m][0] = data[j];
-                    ++m;
-                }
-            }
-            FloatMatrix regressed = solver * y;
-            vector<float> outscratch(numNodes);
-            m = 0;
-            for (int j = 0; j < numNodes; ++j)
-            {
-                if (roiData == NULL || roiData[j] > 0.0f)
-                {
-                    outscratch[j] = data[j];
-                    for (int k = 0; k < removeCount; ++k)
-                    {
-                        outscratch[j] -= regressed[k][0] * xtrans[k][m];
-                    }
-                    ++m;
-                } else {
-                    outscratch[j] = 0.0f;
-                }
-            }
-            myMetricOut->setValuesForColumn(i, outscratch.data());
+            design[m][k] = regressCols[k][m];
         }
-    } else {
-        myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
-        myMetricOut->setStructure(myMetricIn->getStructure());
-        myMetricOut->setColumnName(0, myMetricIn->getColumnName(myColumn) + " regressed");
-        *(myMetricOut->getPaletteColorMapping(0)) = *(myMetricIn->getPaletteColorMapping(myColumn));
-        FloatMatrix y(numUsedNodes, 1);//create column vector for input - note that column vectors are extremely inefficient currently, as is copying the data...
-        const float* data = myMetricIn->getValuePointerForColumn(myColumn);
+    }
+    regressCols.clear();//don't need this any more, should call destructor on each member vector and release the memory
+    for (int m = 0; m < numUsedNodes; ++m)
+    {
+        design[m][numRegressors - 1] = 1.0f;
+    }
+    int firstColumn = 0, numOutColumns = numColumns;
+    if (myColumn != -1)
+    {
+        firstColumn = myColumn;
+        numOutColumns = 1;
+    }
+    FloatMatrix y(numUsedNodes, numOutColumns);//solve all columns at once, so the factorization of the design matrix is only done once
+    for (int i = 0; i < numOutColumns; ++i)
+    {
+        const float* data = myMetricIn->getValuePointerForColumn(firstColumn + i);
         int m = 0;
         for (int j = 0; j < numNodes; ++j)
         {
             if (roiData == NULL || roiData[j] > 0.0f)
             {
-                y[m][0] = data[j];
+                y[m][i] = data[j];
                 ++m;
             }
         }
-        FloatMatrix regressed = solver * y;
-        vector<float> outscratch(numNodes);
-        m = 0;
+    }
+    FloatMatrix regressed = design.solveLeastSquares(y);//QR, rather than inverting the normal equations
+    if (regressed.getNumberOfRows() == 0) throw AlgorithmException("regression encountered a non-invertible matrix, check your inputs for linear independence");
+    myMetricOut->setNumberOfNodesAndColumns(numNodes, numOutColumns);
+    myMetricOut->setStructure(myMetricIn->getStructure());
+    vector<float> outscratch(numNodes);
+    for (int i = 0; i < numOutColumns; ++i)
+    {
+        myMetricOut->setColumnName(i, myMetricIn->getColumnName(firstColumn + i) + " regressed");
+        *(myMetricOut->getPaletteColorMapping(i)) = *(myMetricIn->getPaletteColorMapping(firstColumn + i));
+        const float* data = myMetricIn->getValuePointerForColumn(firstColumn + i);
+        int m = 0;
         for (int j = 0; j < numNodes; ++j)
         {
             if (roiData == NULL || roiData[j] > 0.0f)
@@ -273,14 +253,14 @@ AlgorithmMetricRegression::AlgorithmMetricRegression(ProgressObject* myProgObj,
                 outscratch[j] = data[j];
                 for (int k = 0; k < removeCount; ++k)
                 {
-                    outscratch[j] -= regressed[k][0] * xtrans[k][m];
+                    outscratch[j] -= regressed[k][i] * design[m][k];
                 }
                 ++m;
             } else {
                 outscratch[j] = 0.0f;
             }
         }
-        myMetricOut->setValuesForColumn(0, outscratch.data());
+        myMetricOut->setValuesForColumn(i, outscratch.data());
     }
 }
 
@@ -21,11 +21,12 @@
 #include "AlgorithmMetricRemoveIslands.h"
 #include "AlgorithmException.h"
 
+#include "CaretOMP.h"
+#include "ConnectedComponentHelper.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 
-#include <utility>
 #include <vector>
 
 using namespace caret;
@@ -74,7 +75,7 @@ void AlgorithmMetricRemoveIslands::useParameters(OperationParameters* myParams,
 }
 
 AlgorithmMetricRemoveIslands::AlgorithmMetricRemoveIslands(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric,
-                                                           MetricFile* myMetricOut, const MetricFile* corrAreaMetric) : AbstractAlgorithm(myProgObj)
+                                                           MetricFile* myMetricOut, const MetricFile* corrAreaMetric) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     int numNodes = mySurf->getNumberOfNodes();
@@ -92,68 +93,45 @@ AlgorithmMetricRemoveIslands::AlgorithmMetricRemoveIslands(ProgressObject* myPro
     int numCols = myMetric->getNumberOfColumns();
     myMetricOut->setNumberOfNodesAndColumns(numNodes, numCols);
     myMetricOut->setStructure(myMetric->getStructure());
+    CaretPointer<TopologyHelper> myHelp = mySurf->getTopologyHelper();
+    ConnectedComponentHelper myCompHelp(myHelp);
     for (int col = 0; col < numCols; ++col)
     {
-        vector<pair<float, vector<int> > > areas;
-        vector<int> used(numNodes, 0);
-        CaretPointer<TopologyHelper> myHelp = mySurf->getTopologyHelper();
-        const float* roiData = myMetric->getValuePointerForColumn(col);
         myMetricOut->setColumnName(col, myMetric->getColumnName(col));
-        for (int i = 0; i < numNodes; ++i)
+    }
+#pragma omp CARET_PAR
+    {
+        vector<char> marked(numNodes);
+        vector<int32_t> labels(numNodes);
+        vector<double> areas;
+        vector<float> outscratch(numNodes);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int col = 0; col < numCols; ++col)
         {
-            if (used[i] == 0 && roiData[i] > 0.0f)
+            const float* roiData = myMetric->getValuePointerForColumn(col);
+            for (int i = 0; i < numNodes; ++i)
             {
-                areas.push_back(make_pair(0.0f, vector<int>()));
-                vector<int>& thisAreaMembers = areas.back().second;
-                float& thisSurfArea = areas.back().first;
-                thisAreaMembers.push_back(i);
-                thisSurfArea += areaData[i];
-                used[i] = 1;
-                vector<int> mystack;
-                mystack.push_back(i);
-                while (!mystack.empty())
-                {
-                    int curnode = mystack.back();
-                    mystack.pop_back();
-                    const vector<int32_t>& neighbors = myHelp->getNodeNeighbors(curnode);
-                    int numNeigh = (int)neighbors.size();
-                    for (int j = 0; j < numNeigh; ++j)
-                    {
-                        int thisneigh = neighbors[j];
-                        if (used[thisneigh] == 0 && roiData[thisneigh] > 0.0f)
-                        {
-                            used[thisneigh] = 1;
-                            thisAreaMembers.push_back(thisneigh);
-                            thisSurfArea += areaData[thisneigh];
-                            mystack.push_back(thisneigh);
-                        }
-                    }
-                }
+                marked[i] = (roiData[i] > 0.0f) ? 1 : 0;
             }
-        }
-        vector<float> outscratch(numNodes, 0.0f);
-        int numAreas = (int)areas.size();
-        if (numAreas > 0)
-        {
-            int bestIndex = 0;
-            float bestArea = areas[0].first;
-            for (int i = 1; i < numAreas; ++i)
+            int32_t numComponents = myCompHelp.labelComponents(marked.data(), labels.data());
+            myCompHelp.sumPerComponent(labels.data(), numComponents, areaData, areas);
+            int32_t bestIndex = -1;
+            for (int32_t i = 0; i < numComponents; ++i)
             {
-                float thisArea = (int)areas[i].first;
-                if (thisArea > bestArea)
+                if (bestIndex == -1 || areas[i] > areas[bestIndex])
                 {
                     bestIndex = i;
-                    bestArea = thisArea;
                 }
             }
-            const vector<int>& thisArea = areas[bestIndex].second;
-            int numAreaNodes = (int)thisArea.size();
-            for (int i = 0; i < numAreaNodes; ++i)
+            for (int i = 0; i < numNodes; ++i)
             {
-                outscratch[thisArea[i]] = 1.0f;//make it into a simple 0/1 metric, even if it wasn't before
+                outscratch[i] = (bestIndex != -1 && labels[i] == bestIndex) ? 1.0f : 0.0f;//make it into a simple 0/1 metric, even if it wasn't before
+            }
+#pragma omp critical
+            {//setting values also marks the file modified, don't do that concurrently
+                myMetricOut->setValuesForColumn(col, outscratch.data());
             }
         }
-        myMetricOut->setValuesForColumn(col, outscratch.data());
     }
 }
 
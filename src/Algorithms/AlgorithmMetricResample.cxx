@@ -27,6 +27,8 @@
 #include "SurfaceFile.h"
 #include "SurfaceResamplingHelper.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
@@ -69,6 +71,12 @@ OperationParameters* AlgorithmMetricResample::getParameters()
     
     ret->createOptionalParameter(10, "-largest", "use only the value of the vertex with the largest weight");
     
+    OptionalParameter* saveWeightsOpt = ret->createOptionalParameter(11, "-save-weights", "write the resampling weights to a binary file for reuse");
+    saveWeightsOpt->addStringParameter(1, "weights-file-out", "output - the output weights filename");//fake the output formatting
+    
+    OptionalParameter* loadWeightsOpt = ret->createOptionalParameter(12, "-load-weights", "use resampling weights from a file written by -save-weights instead of computing them");
+    loadWeightsOpt->addStringParameter(1, "weights-file", "the weights file");
+    
     AString myHelpText =
         AString("Resamples a metric file, given two spherical surfaces that are in register.  ") +
         "If ADAP_BARY_AREA is used, exactly one of -area-surfs or -area-metrics must be specified.\n\n" +
@@ -78,6 +86,9 @@ OperationParameters* AlgorithmMetricResample::getParameters()
         "when using -current-roi.\n\n" +
         "The -largest option results in nearest vertex behavior when used with BARYCENTRIC.  " +
         "When resampling a binary metric, consider thresholding at 0.5 after resampling rather than using -largest.\n\n" +
+        "When resampling many files between the same pair of meshes with the same areas and roi, use -save-weights once, and then -load-weights for the rest.  " +
+        "-load-weights cannot be combined with -area-surfs, -area-metrics, or -current-roi, as they were already applied when the file was written, " +
+        "and <method> is ignored, but the spheres must still be given and must match the vertex counts in the file.\n\n" +
         "The <method> argument must be one of the following:\n\n";
     
     vector<SurfaceResamplingMethodEnum::Enum> allEnums;
@@ -159,57 +170,110 @@ void AlgorithmMetricResample::useParameters(OperationParameters* myParams, Progr
         validRoiOut = validRoiOutOpt->getOutputMetric(1);
     }
     bool largest = myParams->getOptionalParameter(10)->m_present;
-    AlgorithmMetricResample(myProgObj, metricIn, curSphere, newSphere, myMethod, metricOut, curAreas, newAreas, currentRoi, validRoiOut, largest);
+    OptionalParameter* saveWeightsOpt = myParams->getOptionalParameter(11);
+    OptionalParameter* loadWeightsOpt = myParams->getOptionalParameter(12);
+    SurfaceResamplingHelper myWeights;
+    const SurfaceResamplingHelper* precomputedWeights = NULL;
+    if (loadWeightsOpt->m_present)
+    {
+        if (areaSurfsOpt->m_present || areaMetricsOpt->m_present || roiOpt->m_present)
+        {
+            throw AlgorithmException("-load-weights cannot be used with -area-surfs, -area-metrics, or -current-roi");
+        }
+        myWeights.readWeightsFile(loadWeightsOpt->getString(1));
+        precomputedWeights = &myWeights;
+    } else if (saveWeightsOpt->m_present) {
+        computeWeights(myWeights, curSphere, newSphere, myMethod, curAreas, newAreas, currentRoi);
+        precomputedWeights = &myWeights;
+    }
+    AlgorithmMetricResample(myProgObj, metricIn, curSphere, newSphere, myMethod, metricOut, curAreas, newAreas, currentRoi, validRoiOut, largest, precomputedWeights);
+    if (saveWeightsOpt->m_present)
+    {
+        myWeights.writeWeightsFile(saveWeightsOpt->getString(1));
+    }
 }
 
 AlgorithmMetricResample::AlgorithmMetricResample(ProgressObject* myProgObj, const MetricFile* metricIn, const SurfaceFile* curSphere, const SurfaceFile* newSphere,
                                                  const SurfaceResamplingMethodEnum::Enum& myMethod, MetricFile* metricOut, const MetricFile* curAreas, const MetricFile* newAreas,
-                                                 const MetricFile* currentRoi, MetricFile* validRoiOut, const bool& largest) : AbstractAlgorithm(myProgObj)
+                                                 const MetricFile* currentRoi, MetricFile* validRoiOut, const bool& largest,
+                                                 const SurfaceResamplingHelper* precomputedWeights) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (metricIn->getNumberOfNodes() != curSphere->getNumberOfNodes()) throw AlgorithmException("input metric has different number of nodes than input sphere");
-    if (currentRoi != NULL && currentRoi->getNumberOfNodes() != curSphere->getNumberOfNodes()) throw AlgorithmException("roi metric has different number of nodes than input sphere");
-    const float* curAreaData = NULL, *newAreaData = NULL;
-    switch (myMethod)
+    int numColumns = metricIn->getNumberOfColumns(), numNewNodes = newSphere->getNumberOfNodes();
+    SurfaceResamplingHelper myHelp;
+    if (precomputedWeights != NULL)
     {
-        case SurfaceResamplingMethodEnum::BARYCENTRIC:
-            break;
-        default:
-            if (curAreas == NULL || newAreas == NULL) throw AlgorithmException("specified method does area correction, but no vertex area data given");
-            if (curSphere->getNumberOfNodes() != curAreas->getNumberOfNodes()) throw AlgorithmException("current vertex area data has different number of nodes than current sphere");
-            if (newSphere->getNumberOfNodes() != newAreas->getNumberOfNodes()) throw AlgorithmException("new vertex area data has different number of nodes than new sphere");
-            curAreaData = curAreas->getValuePointerForColumn(0);
-            newAreaData = newAreas->getValuePointerForColumn(0);
+        if (precomputedWeights->getNumberOfCurrentNodes() != curSphere->getNumberOfNodes() || precomputedWeights->getNumberOfNewNodes() != numNewNodes)
+        {
+            throw AlgorithmException("resampling weights do not match the vertex counts of the spheres");
+        }
+    } else {
+        computeWeights(myHelp, curSphere, newSphere, myMethod, curAreas, newAreas, currentRoi);
+        precomputedWeights = &myHelp;
     }
-    int numColumns = metricIn->getNumberOfColumns(), numNewNodes = newSphere->getNumberOfNodes();
     metricOut->setNumberOfNodesAndColumns(numNewNodes, numColumns);
     metricOut->setStructure(metricIn->getStructure());
-    vector<float> colScratch(numNewNodes, 0.0f);
-    const float* roiCol = NULL;
-    if (currentRoi != NULL) roiCol = currentRoi->getValuePointerForColumn(0);
-    SurfaceResamplingHelper myHelp(myMethod, curSphere, newSphere, curAreaData, newAreaData, roiCol);
     if (validRoiOut != NULL)
     {
         validRoiOut->setNumberOfNodesAndColumns(numNewNodes, 1);
         validRoiOut->setStructure(metricIn->getStructure());
         vector<float> scratch(numNewNodes);
-        myHelp.getResampleValidROI(scratch.data());
+        precomputedWeights->getResampleValidROI(scratch.data());
         validRoiOut->setValuesForColumn(0, scratch.data());
     }
-    for (int i = 0; i < numColumns; ++i)
+    const int BLOCK_COLUMNS = 64;//resample several columns in one pass over the weights, without needing a second copy of the entire output
+    int blockSize = min(numColumns, BLOCK_COLUMNS);
+    vector<vector<float> > blockScratch(blockSize, vector<float>(numNewNodes, 0.0f));
+    for (int blockStart = 0; blockStart < numColumns; blockStart += BLOCK_COLUMNS)
     {
-        metricOut->setColumnName(i, metricIn->getColumnName(i));
-        *metricOut->getPaletteColorMapping(i) = *metricIn->getPaletteColorMapping(i);
+        int thisBlock = min(numColumns - blockStart, BLOCK_COLUMNS);
+        vector<const float*> inputs(thisBlock);
+        vector<float*> outputs(thisBlock);
+        for (int i = 0; i < thisBlock; ++i)
+        {
+            inputs[i] = metricIn->getValuePointerForColumn(blockStart + i);
+            outputs[i] = blockScratch[i].data();
+        }
         if (largest)
         {
-            myHelp.resampleLargest(metricIn->getValuePointerForColumn(i), colScratch.data());
+            for (int i = 0; i < thisBlock; ++i)
+            {
+                precomputedWeights->resampleLargest(inputs[i], outputs[i]);
+            }
         } else {
-            myHelp.resampleNormal(metricIn->getValuePointerForColumn(i), colScratch.data());
+            precomputedWeights->resampleNormal(inputs, outputs);
+        }
+        for (int i = 0; i < thisBlock; ++i)
+        {
+            metricOut->setColumnName(blockStart + i, metricIn->getColumnName(blockStart + i));
+            *metricOut->getPaletteColorMapping(blockStart + i) = *metricIn->getPaletteColorMapping(blockStart + i);
+            metricOut->setValuesForColumn(blockStart + i, outputs[i]);
         }
-        metricOut->setValuesForColumn(i, colScratch.data());
     }
 }
 
+void AlgorithmMetricResample::computeWeights(SurfaceResamplingHelper& weightsOut, const SurfaceFile* curSphere, const SurfaceFile* newSphere, const SurfaceResamplingMethodEnum::Enum& myMethod,
+                                             const MetricFile* curAreas, const MetricFile* newAreas, const MetricFile* currentRoi)
+{
+    if (currentRoi != NULL && currentRoi->getNumberOfNodes() != curSphere->getNumberOfNodes()) throw AlgorithmException("roi metric has different number of nodes than input sphere");
+    const float* curAreaData = NULL, *newAreaData = NULL;
+    switch (myMethod)
+    {
+        case SurfaceResamplingMethodEnum::BARYCENTRIC:
+            break;
+        default:
+            if (curAreas == NULL || newAreas == NULL) throw AlgorithmException("specified method does area correction, but no vertex area data given");
+            if (curSphere->getNumberOfNodes() != curAreas->getNumberOfNodes()) throw AlgorithmException("current vertex area data has different number of nodes than current sphere");
+            if (newSphere->getNumberOfNodes() != newAreas->getNumberOfNodes()) throw AlgorithmException("new vertex area data has different number of nodes than new sphere");
+            curAreaData = curAreas->getValuePointerForColumn(0);
+            newAreaData = newAreas->getValuePointerForColumn(0);
+    }
+    const float* roiCol = NULL;
+    if (currentRoi != NULL) roiCol = currentRoi->getValuePointerForColumn(0);
+    weightsOut = SurfaceResamplingHelper(myMethod, curSphere, newSphere, curAreaData, newAreaData, roiCol);
+}
+
 float AlgorithmMetricResample::getAlgorithmInternalWeight()
 {
     return 1.0f;//override this if needed, if the progress bar isn't smooth
@@ -26,6 +26,8 @@
 
 namespace caret {
     
+    class SurfaceResamplingHelper;
+    
     class AlgorithmMetricResample : public AbstractAlgorithm
     {
         AlgorithmMetricResample();
@@ -35,7 +37,11 @@ namespace caret {
     public:
         AlgorithmMetricResample(ProgressObject* myProgObj, const MetricFile* metricIn, const SurfaceFile* curSphere, const SurfaceFile* newSphere,
                                 const SurfaceResamplingMethodEnum::Enum& myMethod, MetricFile* metricOut, const MetricFile* curAreas = NULL,
-                                const MetricFile* newAreas = NULL, const MetricFile* currentRoi = NULL, MetricFile* validRoiOut = NULL, const bool& largest = false);
+                                const MetricFile* newAreas = NULL, const MetricFile* currentRoi = NULL, MetricFile* validRoiOut = NULL, const bool& largest = false,
+                                const SurfaceResamplingHelper* precomputedWeights = NULL);
+        ///checks the area and roi inputs and computes the resampling weights, for reuse or saving
+        static void computeWeights(SurfaceResamplingHelper& weightsOut, const SurfaceFile* curSphere, const SurfaceFile* newSphere, const SurfaceResamplingMethodEnum::Enum& myMethod,
+                                   const MetricFile* curAreas = NULL, const MetricFile* newAreas = NULL, const MetricFile* currentRoi = NULL);
         static OperationParameters* getParameters();
         static void useParameters(OperationParameters* myParams, ProgressObject* myProgObj);
         static AString getCommandSwitch();
@@ -22,15 +22,13 @@
 #include "AlgorithmException.h"
 
 #include "AlgorithmMetricSmoothing.h"
-#include "CaretAssert.h"
-#include "CaretHeap.h"
 #include "CaretOMP.h"
 #include "MetricFile.h"
 #include "SurfaceFile.h"
+#include "TFCEHelper.h"
 #include "TopologyHelper.h"
 
-#include <cmath>
-#include <set>
+#include <algorithm>
 #include <vector>
 
 using namespace caret;
@@ -130,7 +128,7 @@ void AlgorithmMetricTFCE::useParameters(OperationParameters* myParams, ProgressO
 }
 
 AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const SurfaceFile* mySurf, const MetricFile* myMetric, MetricFile* myMetricOut, const float& presmooth,
-                                         const MetricFile* myRoi, const float& param_e, const float& param_h, const int& columnNum, const MetricFile* corrAreaMetric) : AbstractAlgorithm(myProgObj)
+                                         const MetricFile* myRoi, const float& param_e, const float& param_h, const int& columnNum, const MetricFile* corrAreaMetric) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (mySurf->getNumberOfNodes() != myMetric->getNumberOfNodes()) throw AlgorithmException("metric and surface have different number of vertices");
@@ -147,6 +145,9 @@ AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const Surfac
         areaData = corrAreaMetric->getValuePointerForColumn(0);
     }
     if (myRoi != NULL) roiData = myRoi->getValuePointerForColumn(0);
+    int numNodes = mySurf->getNumberOfNodes();
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf->getTopologyHelper();
+    TFCEHelper myTFCE(myTopoHelp, areaData, roiData, param_e, param_h);//adjacency, areas and roi are shared by all columns
     if (columnNum == -1)
     {
         const MetricFile* toUse = myMetric;
@@ -157,16 +158,27 @@ AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const Surfac
             toUse = &postSmooth;
         }
         int numCols = myMetric->getNumberOfColumns();
-        myMetricOut->setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), numCols);
+        myMetricOut->setNumberOfNodesAndColumns(numNodes, numCols);
         myMetricOut->setStructure(mySurf->getStructure());
-#pragma omp CARET_PAR
+        int blockSize = 1;
+#ifdef CARET_OMP
+        blockSize = omp_get_max_threads() * 4;//enough columns per batch to keep all threads busy, without making a second copy of the entire output
+#endif
+        vector<vector<float> > outBlock(blockSize, vector<float>(numNodes));
+        for (int blockStart = 0; blockStart < numCols; blockStart += blockSize)
         {
-            vector<float> outcol(mySurf->getNumberOfNodes(), 0.0f);
-#pragma omp CARET_FOR
-            for (int col = 0; col < numCols; ++col)
+            int blockEnd = min(blockStart + blockSize, numCols);
+            vector<const float*> inCols;
+            vector<float*> outCols;
+            for (int col = blockStart; col < blockEnd; ++col)
+            {
+                inCols.push_back(toUse->getValuePointerForColumn(col));
+                outCols.push_back(outBlock[col - blockStart].data());
+            }
+            myTFCE.computeBatch(inCols, outCols);
+            for (int col = blockStart; col < blockEnd; ++col)
             {
-                processColumn(mySurf, toUse->getValuePointerForColumn(col), outcol.data(), roiData, param_e, param_h, areaData);
-                myMetricOut->setValuesForColumn(col, outcol.data());
+                myMetricOut->setValuesForColumn(col, outBlock[col - blockStart].data());
                 myMetricOut->setMapName(col, myMetric->getMapName(col));
             }
         }
@@ -180,198 +192,15 @@ AlgorithmMetricTFCE::AlgorithmMetricTFCE(ProgressObject* myProgObj, const Surfac
             toUse = &postSmooth;
             useCol = 0;
         }
-        myMetricOut->setNumberOfNodesAndColumns(mySurf->getNumberOfNodes(), 1);
+        myMetricOut->setNumberOfNodesAndColumns(numNodes, 1);
         myMetricOut->setStructure(mySurf->getStructure());
-        vector<float> outcol(mySurf->getNumberOfNodes(), 0.0f);
-        processColumn(mySurf, toUse->getValuePointerForColumn(useCol), outcol.data(), roiData, param_e, param_h, areaData);
+        vector<float> outcol(numNodes, 0.0f);
+        myTFCE.compute(toUse->getValuePointerForColumn(useCol), outcol.data());
         myMetricOut->setValuesForColumn(0, outcol.data());
         myMetricOut->setMapName(0, myMetric->getMapName(columnNum));
     }
 }
 
-void AlgorithmMetricTFCE::processColumn(const SurfaceFile* mySurf, const float* colData, float* outData, const float* roiData, const float& param_e, const float& param_h, const float* areaData)
-{
-    int numNodes = mySurf->getNumberOfNodes();
-    vector<double> accum(numNodes, 0.0);
-    CaretPointer<TopologyHelper> myHelper = mySurf->getTopologyHelper();
-    tfce_pos(myHelper, colData, accum.data(), roiData, param_e, param_h, areaData);
-    vector<float> negData(numNodes);
-    for (int i = 0; i < numNodes; ++i)
-    {
-        negData[i] = -colData[i];
-    }
-    tfce_pos(myHelper, negData.data(), accum.data(), roiData, param_e, param_h, areaData);//negatives and positives don't overlap, so reuse the accum array
-    for (int i = 0; i < numNodes; ++i)
-    {
-        if (roiData == NULL || roiData[i] > 0.0f)
-        {
-            if (colData[i] < 0.0f)
-            {
-                outData[i] = (float)-accum[i];
-            } else {
-                outData[i] = (float)accum[i];
-            }
-        } else {
-            outData[i] = 0.0f;
-        }
-    }
-}
-
-namespace
-{//hidden namespace just to make sure things don't collide
-    struct Cluster
-    {
-        double accumVal, totalArea;
-        vector<int> members;
-        float lastVal;
-        bool first;
-        Cluster()
-        {
-            first = true;
-            accumVal = 0.0;
-            totalArea = 0.0;
-        }
-        void addMember(const int& node, const float& val, const float& area, const float& param_e, const float& param_h)
-        {
-            update(val, param_e, param_h);
-            members.push_back(node);
-            totalArea += area;
-        }
-        void update(const float& bottomVal, const float& param_e, const float& param_h)
-        {
-            if (first)
-            {
-                lastVal = bottomVal;
-                first = false;
-            } else {
-                if (bottomVal != lastVal)//skip computing if there is no difference
-                {
-                    CaretAssert(bottomVal < lastVal);
-                    double integrated_h = param_h + 1.0f;//integral(x^h) = (x^(h + 1))/(h + 1) + C
-                    double newSlice = pow(totalArea, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
-                    accumVal += newSlice;
-                    lastVal = bottomVal;//computing in double precision, with float for inputs, puts the smallest difference between values far greater than the instability of the computation
-                }
-            }
-        }
-    };
-    
-    int allocCluster(vector<Cluster>& clusterList, set<int>& deadClusters)
-    {
-        if (deadClusters.empty())
-        {
-            clusterList.push_back(Cluster());
-            return (int)(clusterList.size() - 1);
-        } else {
-            set<int>::iterator iter = deadClusters.begin();
-            int ret = *iter;
-            deadClusters.erase(iter);
-            clusterList[ret] = Cluster();//reinitialize
-            return ret;
-        }
-    }
-}
-
-void AlgorithmMetricTFCE::tfce_pos(TopologyHelper* myHelper, const float* colData, double* accumData, const float* roiData, const float& param_e, const float& param_h, const float* areaData)
-{
-    int numNodes = myHelper->getNumberOfNodes();
-    vector<int> membership(numNodes, -1);//int is enough as long as numNodes is fine as an int, for obvious reasons
-    vector<Cluster> clusterList;
-    set<int> deadClusters;//to allow reallocation without changing indices
-    CaretSimpleMaxHeap<int, float> nodeHeap;
-    for (int i = 0; i < numNodes; ++i)
-    {
-        if ((roiData == NULL || roiData[i] > 0.0f) && colData[i] > 0.0f)
-        {
-            nodeHeap.push(i, colData[i]);
-        }
-    }
-    while (!nodeHeap.isEmpty())
-    {
-        float value;
-        int node = nodeHeap.pop(&value);
-        const vector<int32_t>& neighbors = myHelper->getNodeNeighbors(node);
-        int numNeigh = (int)neighbors.size();
-        set<int> touchingClusters;
-        for (int i = 0; i < numNeigh; ++i)
-        {
-            if (membership[neighbors[i]] != -1)
-            {
-                touchingClusters.insert(membership[neighbors[i]]);
-            }
-        }
-        int numTouching = (int)touchingClusters.size();
-        switch (numTouching)
-        {
-            case 0://make new cluster
-            {
-                int newCluster = allocCluster(clusterList, deadClusters);
-                clusterList[newCluster].addMember(node, value, areaData[node], param_e, param_h);
-                membership[node] = newCluster;
-                break;
-            }
-            case 1://add to cluster
-            {
-                int whichCluster = *(touchingClusters.begin());
-                clusterList[whichCluster].addMember(node, value, areaData[node], param_e, param_h);
-                membership[node] = whichCluster;
-                accumData[node] -= clusterList[whichCluster].accumVal;//the accum value is the current amount less than the peak value that the edge of the cluster has (this node is on the edge)
-                break;//so, when the cluster merges or reaches 0, we add the accum value to every member and zero the accum value of the merged cluster, and we get the correct value in the end (with far fewer flops than integrating everywhere)
-            }
-            default://merge all touching clusters
-            {
-                int mergedIndex = -1, biggestSize = 0;//find the biggest cluster (in number of members) and use as merged cluster, for optimization purposes
-                for (set<int>::iterator iter = touchingClusters.begin(); iter != touchingClusters.end(); ++iter)
-                {
-                    if ((int)clusterList[*iter].members.size() > biggestSize)
-                    {
-                        mergedIndex = *iter;
-                        biggestSize = (int)clusterList[*iter].members.size();
-                    }
-                }
-                CaretAssertVectorIndex(clusterList, mergedIndex);
-                Cluster& mergedCluster = clusterList[mergedIndex];
-                mergedCluster.update(value, param_e, param_h);//recalculate to align cluster bottoms
-                for (set<int>::iterator iter = touchingClusters.begin(); iter != touchingClusters.end(); ++iter)
-                {
-                    if (*iter != mergedIndex)//if we are the largest cluster, don't modify the per-vertex accum for members, so merges between small and large clusters are cheap
-                    {
-                        Cluster& thisCluster = clusterList[*iter];
-                        thisCluster.update(value, param_e, param_h);//recalculate to align cluster bottoms
-                        int numMembers = (int)thisCluster.members.size();
-                        double correctionVal = thisCluster.accumVal - mergedCluster.accumVal;//fix the accum values in the side cluster so we can add the merged cluster's accum to everything at the end
-                        for (int j = 0; j < numMembers; ++j)//add the correction value to every member so that we have the current integrated values correct
-                        {
-                            accumData[thisCluster.members[j]] += correctionVal;//apply the correction
-                            membership[thisCluster.members[j]] = mergedIndex;//change the membership lookup
-                        }
-                        mergedCluster.members.insert(mergedCluster.members.end(), thisCluster.members.begin(), thisCluster.members.end());//copy all members
-                        mergedCluster.totalArea += thisCluster.totalArea;
-                        deadClusters.insert(*iter);//kill it
-                        vector<int>().swap(clusterList[*iter].members);//also try to deallocate member list
-                    }
-                }
-                mergedCluster.addMember(node, value, areaData[node], param_e, param_h);//will not trigger recomputation, we already recomputed at this value
-                accumData[node] -= mergedCluster.accumVal;//the vertex they merge on must not get the peak value of the cluster, obviously, so again, record its difference from peak
-                membership[node] = mergedIndex;
-                break;//NOTE: do not reset the accum value of the merged cluster, we specifically avoided modifying the per-vertex accum for its members, so the cluster accum is still in play
-            }
-        }
-    }
-    int listSize = (int)clusterList.size();//final cleanup of accum values
-    for (int i = 0; i < listSize; ++i)
-    {
-        if (deadClusters.find(i) != deadClusters.end()) continue;//ignore clusters that don't exist
-        Cluster& thisCluster = clusterList[i];
-        thisCluster.update(0.0f, param_e, param_h);//update to include the to-zero slice
-        int numMembers = (int)thisCluster.members.size();
-        for (int j = 0; j < numMembers; ++j)
-        {
-            accumData[thisCluster.members[j]] += thisCluster.accumVal;//add the resulting slice to all members - their stored data contains the offset between the cluster peak and their corect value
-        }
-    }
-}
-
 float AlgorithmMetricTFCE::getAlgorithmInternalWeight()
 {
     return 1.0f;//override this if needed, if the progress bar isn't smooth
@@ -78,7 +78,7 @@ void AlgorithmSurfaceCurvature::useParameters(OperationParameters* myParams, Pro
     AlgorithmSurfaceCurvature(myProgObj, mySurf, meanOut, gaussOut);
 }
 
-AlgorithmSurfaceCurvature::AlgorithmSurfaceCurvature(ProgressObject* myProgObj, const SurfaceFile* mySurf, MetricFile* meanOut, MetricFile* gaussOut) : AbstractAlgorithm(myProgObj)
+AlgorithmSurfaceCurvature::AlgorithmSurfaceCurvature(ProgressObject* myProgObj, const SurfaceFile* mySurf, MetricFile* meanOut, MetricFile* gaussOut) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     int numNodes = mySurf->getNumberOfNodes();
@@ -136,7 +136,7 @@ AlgorithmSurfaceInflation::AlgorithmSurfaceInflation(ProgressObject* myProgObj,
                                                      const float strength,
                                                      const int32_t iterations,
                                                      const float inflationFactorIn)
-   : AbstractAlgorithm(myProgObj)
+   : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     std::vector<ProgressObject*> subAlgProgress;
     if (myProgObj != NULL) {
@@ -84,7 +84,7 @@ void AlgorithmVolumeDistortion::useParameters(OperationParameters* myParams, Pro
     AlgorithmVolumeDistortion(myProgObj, myWarp, distortionOut, myMethod);
 }
 
-AlgorithmVolumeDistortion::AlgorithmVolumeDistortion(ProgressObject* myProgObj, const WarpfieldFile& myWarp, VolumeFile* distortionOut, Method myMethod) : AbstractAlgorithm(myProgObj)
+AlgorithmVolumeDistortion::AlgorithmVolumeDistortion(ProgressObject* myProgObj, const WarpfieldFile& myWarp, VolumeFile* distortionOut, Method myMethod) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     switch (myMethod)
@@ -58,7 +58,7 @@ void AlgorithmVolumeFillHoles::useParameters(OperationParameters* myParams, Prog
     AlgorithmVolumeFillHoles(myProgObj, myVolIn, myVolOut);
 }
 
-AlgorithmVolumeFillHoles::AlgorithmVolumeFillHoles(ProgressObject* myProgObj, const VolumeFile* myVolIn, VolumeFile* myVolOut) : AbstractAlgorithm(myProgObj)
+AlgorithmVolumeFillHoles::AlgorithmVolumeFillHoles(ProgressObject* myProgObj, const VolumeFile* myVolIn, VolumeFile* myVolOut) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     const int STENCIL_SIZE = 18;//the easy way, and prepare for different stencils if we ever need them
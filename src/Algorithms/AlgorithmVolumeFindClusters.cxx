@@ -21,14 +21,14 @@
 #include "AlgorithmVolumeFindClusters.h"
 #include "AlgorithmException.h"
 
-#include "CaretAssert.h"
 #include "CaretLogger.h"
-#include "CaretPointer.h"
+#include "CaretOMP.h"
 #include "CaretPointLocator.h"
+#include "ConnectedComponentHelper.h"
 #include "VolumeFile.h"
-#include "VoxelIJK.h"
 
 #include <cmath>
+#include <utility>
 #include <vector>
 
 using namespace caret;
@@ -135,140 +135,118 @@ void AlgorithmVolumeFindClusters::useParameters(OperationParameters* myParams, P
 
 namespace
 {
-    void processSubvol(const float* inFrame, VolumeFile* volOut, const int64_t& outSubvol, const int64_t& outComponent, const float& threshValue, const float& minVolume,
-                       const bool& lessThan, const float* roiFrame, const float& sizeRatio, const float& distanceCutoff, int& markVal)
+    void linearIndexToSpace(const VolumeSpace& mySpace, const int64_t& index, float coordOut[3])
     {
-        vector<int64_t> dims = volOut->getDimensions();
-        int64_t frameSize = dims[0] * dims[1] * dims[2];
-        const VolumeSpace& mySpace = volOut->getVolumeSpace();
+        const int64_t* dims = mySpace.getDims();
+        int64_t ijk[3] = { index % dims[0], (index / dims[0]) % dims[1], index / (dims[0] * dims[1]) };
+        mySpace.indexToSpace(ijk, coordOut);
+    }
+    
+    void processSubvol(const float* inFrame, const VolumeSpace& mySpace, const ConnectedComponentHelper& myCompHelp, const float& threshValue, const float& minVolume,
+                       const bool& lessThan, const float* roiFrame, const float& sizeRatio, const float& distanceCutoff,
+                       vector<vector<int32_t> >& clustersOut, vector<char>& marked, vector<int32_t>& labels)
+    {//finds the clusters to keep, in order of lowest voxel index, marking is done afterwards so subvolumes can be processed in parallel
+        int64_t frameSize = myCompHelp.getNumberOfElements();
         Vector3D ivec, jvec, kvec, origin;
         mySpace.getSpacingVectors(ivec, jvec, kvec, origin);
         float voxelVolume = abs(ivec.dot(jvec.cross(kvec)));
         int64_t minVoxels = (int64_t)ceil(minVolume / voxelVolume);
-        vector<VoxelIJK> neighbors;
-        neighbors.push_back(VoxelIJK(1, 0, 0));
-        neighbors.push_back(VoxelIJK(-1, 0, 0));
-        neighbors.push_back(VoxelIJK(0, 1, 0));
-        neighbors.push_back(VoxelIJK(0, -1, 0));
-        neighbors.push_back(VoxelIJK(0, 0, 1));
-        neighbors.push_back(VoxelIJK(0, 0, -1));
-        vector<char> marked(frameSize, 0);
+        marked.resize(frameSize);
+        labels.resize(frameSize);
         if (lessThan)
         {
             for (int64_t i = 0; i < frameSize; ++i)
             {
-                if ((roiFrame == NULL || roiFrame[i] > 0.0f) && inFrame[i] < threshValue)
-                {
-                    marked[i] = 1;
-                }
+                marked[i] = ((roiFrame == NULL || roiFrame[i] > 0.0f) && inFrame[i] < threshValue) ? 1 : 0;
             }
         } else {
             for (int64_t i = 0; i < frameSize; ++i)
             {
-                if ((roiFrame == NULL || roiFrame[i] > 0.0f) && inFrame[i] > threshValue)
-                {
-                    marked[i] = 1;
-                }
+                marked[i] = ((roiFrame == NULL || roiFrame[i] > 0.0f) && inFrame[i] > threshValue) ? 1 : 0;
             }
         }
-        vector<vector<VoxelIJK> > clusters;
-        size_t biggestCount = 0;
-        int64_t biggestCluster = -1;
-        for (int64_t k = 0; k < dims[2]; ++k)
+        int32_t numComponents = myCompHelp.labelComponents(marked.data(), labels.data());
+        vector<double> counts;
+        myCompHelp.sumPerComponent(labels.data(), numComponents, NULL, counts);
+        vector<char> keep(numComponents, 0);
+        int64_t biggestCount = 0;
+        int32_t biggestComponent = -1;
+        for (int32_t i = 0; i < numComponents; ++i)
         {
-            for (int64_t j = 0; j < dims[1]; ++j)
+            int64_t thisCount = (int64_t)counts[i];
+            if (thisCount >= minVoxels)
             {
-                for (int64_t i = 0; i < dims[0]; ++i)
+                keep[i] = 1;
+                if (thisCount > biggestCount)
                 {
-                    int64_t myIndex = mySpace.getIndex(i, j, k);
-                    if (marked[myIndex])
-                    {
-                        vector<VoxelIJK> voxelList;
-                        voxelList.push_back(VoxelIJK(i, j, k));
-                        marked[myIndex] = 0;//don't let voxels get duplicated in the list
-                        for (int64_t index = 0; index < (int64_t)voxelList.size(); ++index)//NOTE: vector grows inside loop
-                        {
-                            const VoxelIJK& thisVoxel = voxelList[index];
-                            for (int n = 0; n < (int)neighbors.size(); ++n)
-                            {
-                                VoxelIJK neighVox(thisVoxel.m_ijk[0] + neighbors[n].m_ijk[0],
-                                                    thisVoxel.m_ijk[1] + neighbors[n].m_ijk[1],
-                                                    thisVoxel.m_ijk[2] + neighbors[n].m_ijk[2]);
-                                if (mySpace.indexValid(neighVox.m_ijk))
-                                {
-                                    int64_t neighIndex = mySpace.getIndex(neighVox.m_ijk);
-                                    if (marked[neighIndex])
-                                    {
-                                        voxelList.push_back(neighVox);
-                                        marked[neighIndex] = 0;
-                                    }
-                                }
-                            }
-                        }
-                        if ((int64_t)voxelList.size() >= minVoxels)
-                        {
-                            if (voxelList.size() > biggestCount)
-                            {
-                                biggestCount = voxelList.size();
-                                biggestCluster = (int64_t)clusters.size();
-                            }
-                            clusters.push_back(voxelList);
-                        }
-                    }
+                    biggestCount = thisCount;
+                    biggestComponent = i;
                 }
             }
         }
-        if (!clusters.empty()) CaretAssert(biggestCluster != -1);
-        if (biggestCluster != -1 && (distanceCutoff > 0.0f || sizeRatio > 0.0f))
+        if (biggestComponent != -1 && sizeRatio > 0.0f)
         {
-            CaretPointer<CaretPointLocator> myLocator;
-            if (distanceCutoff > 0.0f)
+            for (int32_t i = 0; i < numComponents; ++i)
             {
-                vector<float> biggestCoords;//gather coordinates of biggest cluster voxels
-                biggestCoords.reserve(biggestCount * 3);
-                for (size_t i = 0; i < clusters[biggestCluster].size(); ++i)
+                if (keep[i] && i != biggestComponent && ((float)counts[i]) / biggestCount < sizeRatio)
                 {
-                    float thisCoord[3];
-                    mySpace.indexToSpace(clusters[biggestCluster][i].m_ijk, thisCoord);
-                    biggestCoords.push_back(thisCoord[0]);
-                    biggestCoords.push_back(thisCoord[1]);
-                    biggestCoords.push_back(thisCoord[2]);
+                    keep[i] = 0;
                 }
-                myLocator.grabNew(new CaretPointLocator(biggestCoords.data(), biggestCoords.size()));
             }
-            for (size_t i = 0; i < clusters.size(); ++i)
+        }
+        int64_t biggestCluster = -1;
+        if (biggestComponent != -1)
+        {
+            biggestCluster = 0;
+            for (int32_t i = 0; i < biggestComponent; ++i)
+            {
+                if (keep[i]) ++biggestCluster;
+            }
+        }
+        myCompHelp.getComponentMembers(labels.data(), numComponents, clustersOut, keep.data());
+        if (biggestCluster != -1 && distanceCutoff > 0.0f)
+        {
+            vector<float> biggestCoords;//gather coordinates of biggest cluster voxels
+            const vector<int32_t>& biggestMembers = clustersOut[biggestCluster];
+            biggestCoords.reserve(biggestMembers.size() * 3);
+            for (size_t i = 0; i < biggestMembers.size(); ++i)
+            {
+                float thisCoord[3];
+                linearIndexToSpace(mySpace, biggestMembers[i], thisCoord);
+                biggestCoords.push_back(thisCoord[0]);
+                biggestCoords.push_back(thisCoord[1]);
+                biggestCoords.push_back(thisCoord[2]);
+            }
+            CaretPointLocator myLocator(biggestCoords.data(), biggestCoords.size());
+            for (size_t i = 0; i < clustersOut.size(); ++i)
             {
                 if ((int64_t)i != biggestCluster)
                 {
-                    bool erase = false;
-                    if (sizeRatio > 0.0f && ((float)clusters[i].size()) / biggestCount < sizeRatio)
+                    bool erase = true;//erase unless we find a point close enough to the biggest cluster
+                    for (size_t j = 0; j < clustersOut[i].size(); ++j)
                     {
-                        erase = true;
-                    }
-                    if (!erase && distanceCutoff > 0.0f)
-                    {
-                        erase = true;//erase unless we find a point close enough to the biggest cluster
-                        for (size_t j = 0; j < clusters[i].size(); ++j)
+                        float thisCoord[3];
+                        linearIndexToSpace(mySpace, clustersOut[i][j], thisCoord);
+                        int32_t ret = myLocator.closestPointLimited(thisCoord, distanceCutoff);
+                        if (ret == -1)
                         {
-                            float thisCoord[3];
-                            mySpace.indexToSpace(clusters[i][j].m_ijk, thisCoord);
-                            int32_t ret = myLocator->closestPointLimited(thisCoord, distanceCutoff);
-                            if (ret == -1)
-                            {
-                                erase = false;
-                                break;
-                            }
+                            erase = false;
+                            break;
                         }
                     }
                     if (erase)
                     {
-                        clusters.erase(clusters.begin() + i);//remove it
+                        clustersOut.erase(clustersOut.begin() + i);//remove it
                         --i;//don't skip a cluster
                         if (biggestCluster > (int64_t)i) --biggestCluster;//don't lose track of the biggest cluster
                     }
                 }
             }
         }
+    }
+    
+    void markClusters(const vector<vector<int32_t> >& clusters, float* outFrame, int& markVal)
+    {
         for (size_t i = 0; i < clusters.size(); ++i)
         {
             if (markVal == 0)
@@ -280,7 +258,7 @@ namespace
             if ((int)tempVal != markVal) throw AlgorithmException("too many clusters, unable to mark them uniquely");
             for (size_t index = 0; index < clusters[i].size(); ++index)
             {
-                volOut->setValue(tempVal, clusters[i][index].m_ijk, outSubvol, outComponent);
+                outFrame[clusters[i][index]] = tempVal;
             }
             ++markVal;
         }
@@ -289,7 +267,7 @@ namespace
 
 AlgorithmVolumeFindClusters::AlgorithmVolumeFindClusters(ProgressObject* myProgObj, const VolumeFile* volIn, const float& threshValue, const float& minVolume, VolumeFile* volOut,
                                                          const bool& lessThan, const VolumeFile* myRoi, const int& subvolNum, const int& startVal, int* endVal,
-                                                         const float& sizeRatio, const float& distanceCutoff) : AbstractAlgorithm(myProgObj)
+                                                         const float& sizeRatio, const float& distanceCutoff) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     if (startVal == 0)
@@ -304,30 +282,49 @@ AlgorithmVolumeFindClusters::AlgorithmVolumeFindClusters(ProgressObject* myProgO
         roiFrame = myRoi->getFrame();
     }
     vector<int64_t> dims = volIn->getDimensions();
-    int markVal = startVal;
+    ConnectedComponentHelper myCompHelp(dims.data());//face connectivity
+    vector<pair<int64_t, int64_t> > inFrames;//subvolume, component
     if (subvolNum == -1)
     {
         volOut->reinitialize(volIn->getOriginalDimensions(), volIn->getSform(), dims[4]);
-        volOut->setValueAllVoxels(0.0f);
         for (int64_t c = 0; c < dims[4]; ++c)
         {
             for (int64_t s = 0; s < dims[3]; ++s)
             {
-                const float* inFrame = volIn->getFrame(s, c);
-                processSubvol(inFrame, volOut, s, c, threshValue, minVolume, lessThan, roiFrame, sizeRatio, distanceCutoff, markVal);
+                inFrames.push_back(make_pair(s, c));
             }
         }
     } else {
         vector<int64_t> outDims = volIn->getOriginalDimensions();
         outDims.resize(3);
         volOut->reinitialize(outDims, volIn->getSform(), dims[4]);
-        volOut->setValueAllVoxels(0.0f);
         for (int64_t c = 0; c < dims[4]; ++c)
         {
-            const float* inFrame = volIn->getFrame(subvolNum, c);
-            processSubvol(inFrame, volOut, 0, c, threshValue, minVolume, lessThan, roiFrame, sizeRatio, distanceCutoff, markVal);
+            inFrames.push_back(make_pair((int64_t)subvolNum, c));
+        }
+    }
+    int64_t numFrames = (int64_t)inFrames.size();
+    vector<vector<vector<int32_t> > > frameClusters(numFrames);
+#pragma omp CARET_PAR
+    {
+        vector<char> markScratch;
+        vector<int32_t> labelScratch;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t f = 0; f < numFrames; ++f)
+        {
+            processSubvol(volIn->getFrame(inFrames[f].first, inFrames[f].second), mySpace, myCompHelp, threshValue, minVolume, lessThan, roiFrame, sizeRatio, distanceCutoff,
+                          frameClusters[f], markScratch, labelScratch);
         }
     }
+    int markVal = startVal;
+    vector<float> outFrame(dims[0] * dims[1] * dims[2]);
+    for (int64_t f = 0; f < numFrames; ++f)
+    {//cluster values increase across subvolumes, so mark them in order
+        outFrame.assign(outFrame.size(), 0.0f);
+        markClusters(frameClusters[f], outFrame.data(), markVal);
+        vector<vector<int32_t> >().swap(frameClusters[f]);//release memory as we go
+        volOut->setFrame(outFrame.data(), (subvolNum == -1 ? inFrames[f].first : 0), inFrames[f].second);
+    }
     if (endVal != NULL) *endVal = markVal;
 }
 
@@ -21,6 +21,8 @@
 #include "AlgorithmVolumeRemoveIslands.h"
 #include "AlgorithmException.h"
 
+#include "CaretOMP.h"
+#include "ConnectedComponentHelper.h"
 #include "VolumeFile.h"
 
 #include <vector>
@@ -58,96 +60,52 @@ void AlgorithmVolumeRemoveIslands::useParameters(OperationParameters* myParams,
     AlgorithmVolumeRemoveIslands(myProgObj, myVolIn, myVolOut);
 }
 
-AlgorithmVolumeRemoveIslands::AlgorithmVolumeRemoveIslands(ProgressObject* myProgObj, const VolumeFile* myVolIn, VolumeFile* myVolOut) : AbstractAlgorithm(myProgObj)
+AlgorithmVolumeRemoveIslands::AlgorithmVolumeRemoveIslands(ProgressObject* myProgObj, const VolumeFile* myVolIn, VolumeFile* myVolOut) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
-    const int STENCIL_SIZE = 18;//the easy way, and prepare for different stencils if we ever need them
-    const int stencil[STENCIL_SIZE] = { 0, 0, -1,
-                                  0, -1, 0,
-                                  -1, 0, 0,
-                                  1, 0, 0,
-                                  0, 1, 0,
-                                  0, 0, 1 };
     vector<int64_t> dims;
     myVolIn->getDimensions(dims);
     myVolOut->reinitialize(myVolIn->getOriginalDimensions(), myVolIn->getSform(), myVolIn->getNumberOfComponents(), myVolIn->getType());
+    ConnectedComponentHelper myCompHelp(dims.data());//face connectivity
+    int64_t frameSize = dims[0] * dims[1] * dims[2];
     for (int s = 0; s < dims[3]; ++s)
     {
         myVolOut->setMapName(s, myVolIn->getMapName(s));
-        for (int c = 0; c < dims[4]; ++c)
+    }
+    int64_t numFrames = dims[3] * dims[4];
+#pragma omp CARET_PAR
+    {
+        vector<char> marked(frameSize);
+        vector<int32_t> labels(frameSize);
+        vector<double> counts;
+        vector<float> outFrame(frameSize);
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t f = 0; f < numFrames; ++f)
         {
-            int64_t ijk[3];
-            vector<vector<int64_t> > parts;
-            vector<int> used(dims[0] * dims[1] * dims[2], 0);
+            int64_t s = f % dims[3], c = f / dims[3];
             const float* frame = myVolIn->getFrame(s, c);
-            for (ijk[2] = 0; ijk[2] < dims[2]; ++ijk[2])
+            for (int64_t i = 0; i < frameSize; ++i)
             {
-                for (ijk[1] = 0; ijk[1] < dims[1]; ++ijk[1])
-                {
-                    for (ijk[0] = 0; ijk[0] < dims[0]; ++ijk[0])
-                    {
-                        int64_t index = myVolIn->getIndex(ijk);
-                        if (used[index] == 0 && frame[index] > 0.0f)
-                        {
-                            parts.push_back(vector<int64_t>());
-                            vector<int64_t>& thispart = parts.back();
-                            thispart.push_back(ijk[0]);
-                            thispart.push_back(ijk[1]);
-                            thispart.push_back(ijk[2]);
-                            used[index] = 1;
-                            vector<int64_t> mystack;
-                            mystack.push_back(ijk[0]);
-                            mystack.push_back(ijk[1]);
-                            mystack.push_back(ijk[2]);
-                            while (!mystack.empty())
-                            {
-                                int64_t curSize = (int64_t)mystack.size();
-                                int64_t curvox[3] = { mystack[curSize - 3], mystack[curSize - 2], mystack[curSize - 1] };
-                                mystack.resize(curSize - 3);//basically pop_back
-                                for (int i = 0; i < STENCIL_SIZE; i += 3)
-                                {
-                                    int64_t neighbor[3] = { curvox[0] + stencil[i], curvox[1] + stencil[i + 1], curvox[2] + stencil[i + 2] };
-                                    if (myVolIn->indexValid(neighbor))
-                                    {
-                                        int64_t neighindex = myVolIn->getIndex(neighbor);
-                                        if (used[neighindex] == 0 && frame[neighindex] > 0.0f)
-                                        {
-                                            thispart.push_back(neighbor[0]);
-                                            thispart.push_back(neighbor[1]);
-                                            thispart.push_back(neighbor[2]);
-                                            used[neighindex] = 1;
-                                            mystack.push_back(neighbor[0]);
-                                            mystack.push_back(neighbor[1]);
-                                            mystack.push_back(neighbor[2]);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+                marked[i] = (frame[i] > 0.0f) ? 1 : 0;
             }
-            int64_t bestCount = -1, bestPart = -1, numParts = (int64_t)parts.size();
-            for (int64_t i = 0; i < numParts; ++i)
+            int32_t numComponents = myCompHelp.labelComponents(marked.data(), labels.data());
+            myCompHelp.sumPerComponent(labels.data(), numComponents, NULL, counts);
+            int32_t bestPart = -1;
+            for (int32_t i = 0; i < numComponents; ++i)
             {
-                int64_t thisCount = (int64_t)parts[i].size();
-                if (thisCount > bestCount)
+                if (bestPart == -1 || counts[i] > counts[bestPart])
                 {
-                    bestCount = thisCount;
                     bestPart = i;
                 }
             }
-            vector<float> outFrame(dims[0] * dims[1] * dims[2], 0.0f);
-            if (bestPart != -1)
+            for (int64_t i = 0; i < frameSize; ++i)
             {
-                vector<int64_t>& myPart = parts[bestPart];
-                for (int64_t i = 0; i < bestCount; i += 3)
-                {
-                    int64_t myIndex = myVolIn->getIndex(myPart.data() + i);
-                    outFrame[myIndex] = 1.0f;//make it a simple 0/1 volume, even if it wasn't before
-                }
+                outFrame[i] = (bestPart != -1 && labels[i] == bestPart) ? 1.0f : 0.0f;//make it a simple 0/1 volume, even if it wasn't before
+            }
+#pragma omp critical
+            {//setting a frame also marks the file modified, don't do that concurrently
+                myVolOut->setFrame(outFrame.data(), s, c);
             }
-            myVolOut->setFrame(outFrame.data(), s, c);
         }
     }
 }
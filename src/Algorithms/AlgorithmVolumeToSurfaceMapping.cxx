@@ -79,6 +79,10 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
     ribbonWeights->addVolumeOutputParameter(2, "weights-out", "volume to write the weights to");
     OptionalParameter* ribbonWeightsText = ribbonOpt->createOptionalParameter(6, "-output-weights-text", "write the voxel weights for all vertices to a text file");
     ribbonWeightsText->addStringParameter(1, "text-out", "output - the output text filename");//fake the output formatting
+    OptionalParameter* ribbonSaveWeights = ribbonOpt->createOptionalParameter(9, "-save-weights", "write the voxel weights for all vertices to a binary file for reuse");
+    ribbonSaveWeights->addStringParameter(1, "weights-file-out", "output - the output weights filename");//fake the output formatting
+    OptionalParameter* ribbonLoadWeights = ribbonOpt->createOptionalParameter(10, "-load-weights", "use voxel weights from a file written by -save-weights instead of computing them");
+    ribbonLoadWeights->addStringParameter(1, "weights-file", "the weights file");
     
     OptionalParameter* myelinStyleOpt = ret->createOptionalParameter(9, "-myelin-style", "use the method from myelin mapping");
     myelinStyleOpt->addVolumeParameter(1, "ribbon-roi", "an roi volume of the cortical ribbon for this hemisphere");
@@ -100,7 +104,10 @@ OperationParameters* AlgorithmVolumeToSurfaceMapping::getParameters()
         "voxels that don't have a positive value in the mask.  The subdivision number specifies how it approximates the amount of the volume the polyhedron " +
         "intersects, by splitting each voxel into NxNxN pieces, and checking whether the center of each piece is inside the polyhedron.  If you have very large " +
         "voxels, consider increasing this if you get zeros in your output.  " +
-        "The -gaussian option makes it act more like the myelin method, where the distance of a voxel from <surface> is used to downweight the voxel.\n\n" +
+        "The -gaussian option makes it act more like the myelin method, where the distance of a voxel from <surface> is used to downweight the voxel.  " +
+        "Computing the ribbon weights usually takes much longer than applying them, so when mapping many volumes in the same volume space onto the same surfaces, " +
+        "use -save-weights once, and then -load-weights for the remaining volumes.  " +
+        "-load-weights cannot be combined with the other options that change the weights, as they were already applied when the file was written.\n\n" +
         "The myelin style method uses part of the caret5 myelin mapping command to do the mapping: for each surface vertex, take all voxels that are in a cylinder " +
         "with width and height equal to cortical thickness, centered on the vertex and aligned with the surface normal, and that are also within the ribbon ROI, " +
         "and apply a gaussian kernel with the specified sigma to them to get the weights to use.  " +
@@ -224,27 +231,52 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
                 weightsOutVertex = (int)ribbonWeights->getInteger(1);
                 weightsOut = ribbonWeights->getOutputVolume(2);
             }
-            AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, myRoiVol, subdivisions, thinColumns,
-                                            mySubVol, gaussScale, weightsOutVertex, weightsOut);
             OptionalParameter* ribbonWeightsText = ribbonOpt->getOptionalParameter(6);
+            OptionalParameter* ribbonLoadWeights = ribbonOpt->getOptionalParameter(10);
+            OptionalParameter* ribbonSaveWeights = ribbonOpt->getOptionalParameter(9);
+            RibbonMappingWeights myWeights;
+            const RibbonMappingWeights* precomputedWeights = NULL;
+            if (ribbonLoadWeights->m_present)
+            {
+                if (myRoiVol != NULL || ribbonSubdiv->m_present || thinColumns || gaussianOpt->m_present)
+                {
+                    throw AlgorithmException("-load-weights cannot be used with -volume-roi, -voxel-subdiv, -thin-columns, or -gaussian");
+                }
+                myWeights.readFile(ribbonLoadWeights->getString(1));
+                precomputedWeights = &myWeights;
+            } else if (ribbonWeightsText->m_present || ribbonSaveWeights->m_present) {//compute them here only if we need them after the algorithm
+                const float* roiFrame = NULL;
+                if (myRoiVol != NULL)
+                {
+                    if (!myRoiVol->matchesVolumeSpace(myVolume)) throw AlgorithmException("roi volume is not in the same volume space as input volume");
+                    roiFrame = myRoiVol->getFrame();
+                }
+                if (!mySurface->hasNodeCorrespondence(*outerSurf) || !mySurface->hasNodeCorrespondence(*innerSurf))
+                {
+                    throw AlgorithmException("all surfaces must have vertex correspondence");
+                }
+                AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, subdivisions, thinColumns, mySurface, gaussScale);
+                precomputedWeights = &myWeights;
+            }
+            AlgorithmVolumeToSurfaceMapping(myProgObj, myVolume, mySurface, myMetricOut, innerSurf, outerSurf, myRoiVol, subdivisions, thinColumns,
+                                            mySubVol, gaussScale, weightsOutVertex, weightsOut, precomputedWeights);
+            if (ribbonSaveWeights->m_present)
+            {
+                myWeights.writeFile(ribbonSaveWeights->getString(1));
+            }
             if (ribbonWeightsText->m_present)
             {//do this after the algorithm, to let it do the error condition checking
                 ofstream outFile(ribbonWeightsText->getString(1).toLocal8Bit().constData());
                 if (!outFile) throw AlgorithmException("failed to open output textfile '" + ribbonWeightsText->getString(1) + "'");
-                vector<vector<VoxelWeight> > myWeights;
-                const float* roiFrame = NULL;
-                if (myRoiVol != NULL) roiFrame = myRoiVol->getFrame();
-                AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, subdivisions, thinColumns, mySurface, gaussScale);
-                for (int i = 0; i < (int)myWeights.size(); ++i)
+                const int64_t* myDims = myWeights.m_volSpace.getDims();
+                for (int64_t i = 0; i < myWeights.m_numVertices; ++i)
                 {
-                    outFile << i << ", " << myWeights[i].size();
-                    for (int j = 0; j < (int)myWeights[i].size(); ++j)
+                    outFile << i << ", " << myWeights.getNumWeights(i);
+                    for (int64_t j = myWeights.m_rowStart[i]; j < myWeights.m_rowStart[i + 1]; ++j)
                     {
-                        for (int v = 0; v < 3; ++v)
-                        {
-                            outFile << ", " << myWeights[i][j].ijk[v];
-                        }
-                        outFile << ", " << myWeights[i][j].weight;
+                        int64_t index = myWeights.m_voxelIndex[j];
+                        outFile << ", " << index % myDims[0] << ", " << (index / myDims[0]) % myDims[1] << ", " << index / (myDims[0] * myDims[1]);
+                        outFile << ", " << myWeights.m_weights[j];
                     }
                     outFile << endl;
                 }
@@ -267,7 +299,7 @@ void AlgorithmVolumeToSurfaceMapping::useParameters(OperationParameters* myParam
 
 //interpolation mapping
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
-                                                                 const VolumeFile::InterpType& myMethod, const int64_t& mySubVol) : AbstractAlgorithm(myProgObj)
+                                                                 const VolumeFile::InterpType& myMethod, const int64_t& mySubVol) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -363,7 +395,8 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                                                  const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const VolumeFile* roiVol,
                                                                  const int32_t& subdivisions, const bool& thinColumns, const int64_t& mySubVol, const float& gaussScale,
-                                                                 const int& weightsOutVertex, VolumeFile* weightsOut) : AbstractAlgorithm(myProgObj)
+                                                                 const int& weightsOutVertex, VolumeFile* weightsOut,
+                                                                 const RibbonMappingWeights* precomputedWeights) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -397,22 +430,36 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
         weightDims.resize(3);
         weightsOut->reinitialize(weightDims, myVolume->getSform());
     }
-    vector<vector<VoxelWeight> > myWeights;
-    const float* roiFrame = NULL;
-    if (roiVol != NULL) roiFrame = roiVol->getFrame();
-    precomputeWeightsRibbon(myWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, subdivisions, thinColumns, mySurface, gaussScale);
+    RibbonMappingWeights computedWeights;
+    const RibbonMappingWeights* myWeights = precomputedWeights;
+    if (myWeights == NULL)
+    {
+        const float* roiFrame = NULL;
+        if (roiVol != NULL) roiFrame = roiVol->getFrame();
+        precomputeWeightsRibbon(computedWeights, myVolume->getVolumeSpace(), innerSurf, outerSurf, roiFrame, subdivisions, thinColumns, mySurface, gaussScale);
+        myWeights = &computedWeights;
+    } else {
+        if (myWeights->m_numVertices != numNodes)
+        {
+            throw AlgorithmException("precomputed ribbon weights are for a different number of vertices than the surface");
+        }
+        if (!myWeights->m_volSpace.matches(myVolume->getVolumeSpace()))
+        {
+            throw AlgorithmException("precomputed ribbon weights are for a different volume space than the input volume");
+        }
+    }
     if (weightsOut != NULL)
     {
         weightsOut->setValueAllVoxels(0.0f);
-        const vector<VoxelWeight>& vertexWeights = myWeights[weightsOutVertex];
-        int numWeights = (int)vertexWeights.size();
-        for (int i = 0; i < numWeights; ++i)
+        const int64_t* myDims = myWeights->m_volSpace.getDims();
+        for (int64_t i = myWeights->m_rowStart[weightsOutVertex]; i < myWeights->m_rowStart[weightsOutVertex + 1]; ++i)
         {
-            weightsOut->setValue(vertexWeights[i].weight, vertexWeights[i].ijk);
+            int64_t index = myWeights->m_voxelIndex[i];
+            weightsOut->setValue(myWeights->m_weights[i], index % myDims[0], (index / myDims[0]) % myDims[1], index / (myDims[0] * myDims[1]));
         }
     }
-    CaretArray<float> myScratchArray(numNodes);
-    float* myScratch = myScratchArray.getArray();
+    vector<const float*> framesIn;
+    vector<int64_t> columnsOut;
     if (mySubVol == -1)
     {
         for (int64_t i = 0; i < myVolDims[3]; ++i)
@@ -427,26 +474,8 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
                 }
                 metricLabel += " ribbon constrained";
                 myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-                for (int64_t node = 0; node < numNodes; ++node)
-                {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, i, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                    }
-                }
-                myMetricOut->setValuesForColumn(thisCol, myScratch);
+                framesIn.push_back(myVolume->getFrame(i, j));
+                columnsOut.push_back(thisCol);
             }
         }
     } else {
@@ -460,31 +489,32 @@ AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject*
             metricLabel += " ribbon constrained";
             int64_t thisCol = j;
             myMetricOut->setColumnName(thisCol, metricLabel);
-#pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t node = 0; node < numNodes; ++node)
-            {
-                    myScratch[node] = 0.0f;
-                    float totalWeight = 0.0f;
-                    int numVoxels = (int)myWeights[node].size();
-                    for (int voxel = 0; voxel < numVoxels; ++voxel)
-                    {
-                        float thisWeight = myWeights[node][voxel].weight;
-                        totalWeight += thisWeight;
-                        myScratch[node] += thisWeight * myVolume->getValue(myWeights[node][voxel].ijk, mySubVol, j);
-                    }
-                    if (totalWeight != 0.0f)
-                    {
-                        myScratch[node] /= totalWeight;
-                    } else {
-                        myScratch[node] = 0.0f;
-                    }
-            }
-            myMetricOut->setValuesForColumn(thisCol, myScratch);
+            framesIn.push_back(myVolume->getFrame(mySubVol, j));
+            columnsOut.push_back(thisCol);
+        }
+    }
+    const int64_t FRAMES_PER_PASS = 64;//bounds the scratch memory, mapFrames blocks further internally
+    int64_t numFrames = (int64_t)framesIn.size();
+    int64_t scratchFrames = min(numFrames, FRAMES_PER_PASS);
+    vector<float> myScratch(scratchFrames * numNodes);
+    for (int64_t passStart = 0; passStart < numFrames; passStart += FRAMES_PER_PASS)
+    {
+        int64_t passSize = min(FRAMES_PER_PASS, numFrames - passStart);
+        vector<const float*> passIn(framesIn.begin() + passStart, framesIn.begin() + passStart + passSize);
+        vector<float*> passOut(passSize);
+        for (int64_t f = 0; f < passSize; ++f)
+        {
+            passOut[f] = myScratch.data() + f * numNodes;
+        }
+        myWeights->mapFrames(passIn, passOut);
+        for (int64_t f = 0; f < passSize; ++f)
+        {
+            myMetricOut->setValuesForColumn(columnsOut[passStart + f], passOut[f]);
         }
     }
 }
 
-void AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(vector<vector<VoxelWeight> >& myWeights, const VolumeSpace& volSpace,
+void AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(RibbonMappingWeights& myWeights, const VolumeSpace& volSpace,
                                                               const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const float* roiFrame,
                                                               const int& subdivisions, const bool& thinColumns, const SurfaceFile* gaussSurf, const float& gaussScale)
 {
@@ -503,21 +533,23 @@ void AlgorithmVolumeToSurfaceMapping::precomputeWeightsRibbon(vector<vector<Voxe
         }
         signedDistVol.reinitialize(volSpace);
         AlgorithmCreateSignedDistanceVolume(NULL, gaussSurf, &signedDistVol, NULL, maxThick * gaussScale * 3.0f, maxThick * gaussScale * 3.0f);//if we somehow have a voxel really far away compared to thickness, treat it as at least 3 sigma
+        const float* signedDistFrame = signedDistVol.getFrame();//same volume space, so the linear indices are valid in it
         for (int i = 0; i < numNodes; ++i)
         {//modify the weights from the ribbon helper
-            vector<VoxelWeight>& nodeWeights = myWeights[i];
-            for (int j = 0; j < (int)nodeWeights.size(); ++j)
+            float nodeSigma = thickness.getValue(i, 0) * gaussScale;
+            for (int64_t j = myWeights.m_rowStart[i]; j < myWeights.m_rowStart[i + 1]; ++j)
             {
-                float toSquare = signedDistVol.getValue(nodeWeights[j].ijk) / (thickness.getValue(i, 0) * gaussScale);//negatives are fine, we are going to square it
-                nodeWeights[j].weight *= exp(-toSquare * toSquare / 2);
+                float toSquare = signedDistFrame[myWeights.m_voxelIndex[j]] / nodeSigma;//negatives are fine, we are going to square it
+                myWeights.m_weights[j] *= exp(-toSquare * toSquare / 2);
             }
         }
+        myWeights.computeMappingInfo();
     }
 }
 
 //myelin style mapping
 AlgorithmVolumeToSurfaceMapping::AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
-                                                                 const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma, const int64_t& mySubVol, const bool& oldCutoffBug): AbstractAlgorithm(myProgObj)
+                                                                 const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma, const int64_t& mySubVol, const bool& oldCutoffBug): AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> myVolDims;
@@ -36,7 +36,7 @@ namespace caret {
         AlgorithmVolumeToSurfaceMapping();
         static void precomputeWeightsMyelin(std::vector<std::vector<VoxelWeight> >& myWeights, const SurfaceFile* mySurface, const VolumeFile* roiVol,
                                             const MetricFile* thickness, const float& sigma, const bool& oldCutoffBug);
-        static void precomputeWeightsRibbon(std::vector<std::vector<VoxelWeight> >& myWeights, const VolumeSpace& volSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
+        static void precomputeWeightsRibbon(RibbonMappingWeights& myWeights, const VolumeSpace& volSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
                                             const float* roiFrame, const int& subdivisions, const bool& thinColumns, const SurfaceFile* gaussSurf, const float& gaussScale);
         enum Method
         {
@@ -56,7 +56,7 @@ namespace caret {
                                         const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
                                         const VolumeFile* roiVol = NULL, const int32_t& subdivisions = 3, const bool& thinColumns = false,
                                         const int64_t& mySubVol = -1, const float& gaussScale = -1.0f,
-                                        const int& weightsOutVertex = -1, VolumeFile* weightsOut = NULL);
+                                        const int& weightsOutVertex = -1, VolumeFile* weightsOut = NULL, const RibbonMappingWeights* precomputedWeights = NULL);
         AlgorithmVolumeToSurfaceMapping(ProgressObject* myProgObj, const VolumeFile* myVolume, const SurfaceFile* mySurface, MetricFile* myMetricOut,
                                         const VolumeFile* roiVol, const MetricFile* thickness, const float& sigma, const int64_t& mySubVol = -1, const bool& oldCutoffBug = false);
         static OperationParameters* getParameters();
@@ -27,6 +27,8 @@
 #include "Vector3D.h"
 #include "WarpfieldFile.h"
 
+#include <algorithm>
+
 using namespace caret;
 using namespace std;
 
@@ -99,7 +101,7 @@ void AlgorithmVolumeWarpfieldResample::useParameters(OperationParameters* myPara
 }
 
 AlgorithmVolumeWarpfieldResample::AlgorithmVolumeWarpfieldResample(ProgressObject* myProgObj, const VolumeFile* inVol, const VolumeFile* warpfield,
-                                                                   const int64_t refDims[3], const vector<vector<float> >& refSform, const VolumeFile::InterpType& myMethod, VolumeFile* outVol) : AbstractAlgorithm(myProgObj)
+                                                                   const int64_t refDims[3], const vector<vector<float> >& refSform, const VolumeFile::InterpType& myMethod, VolumeFile* outVol) : AbstractAlgorithm(myProgObj, getCommandSwitch())
 {
     LevelProgress myProgress(myProgObj);
     vector<int64_t> warpDims;
@@ -127,6 +129,9 @@ AlgorithmVolumeWarpfieldResample::AlgorithmVolumeWarpfieldResample(ProgressObjec
     {
         outVol->setMapName(i, inVol->getMapName(i));
     }
+    const int64_t TILE_SIZE = 16;
+    const int64_t tilesI = (outDims[0] + TILE_SIZE - 1) / TILE_SIZE, tilesJ = (outDims[1] + TILE_SIZE - 1) / TILE_SIZE;
+    const int64_t numTiles = tilesI * tilesJ * outDims[2];
     for (int64_t c = 0; c < numComponents; ++c)
     {
         for (int64_t b = 0; b < numMaps; ++b)
@@ -136,11 +141,18 @@ AlgorithmVolumeWarpfieldResample::AlgorithmVolumeWarpfieldResample(ProgressObjec
                 inVol->validateSpline(b, c);//because deconvolve is parallel, but won't execute parallel if we are already in a parallel section
             }
 #pragma omp CARET_PARFOR schedule(dynamic)
-            for (int64_t k = 0; k < outDims[2]; ++k)
-            {
-                for (int64_t j = 0; j < outDims[1]; ++j)
+            for (int64_t tile = 0; tile < numTiles; ++tile)
+            {//square tiles in i and j map to compact regions of the input, which keeps the spline samples in cache
+                int64_t k = tile / (tilesI * tilesJ);
+                int64_t tileJ = (tile / tilesI) % tilesJ, tileI = tile % tilesI;
+                int64_t iStart = tileI * TILE_SIZE, iEnd = min(iStart + TILE_SIZE, outDims[0]);
+                int64_t jStart = tileJ * TILE_SIZE, jEnd = min(jStart + TILE_SIZE, outDims[1]);
+                float inCoords[TILE_SIZE * TILE_SIZE * 3], interpVals[TILE_SIZE * TILE_SIZE];
+                bool validDisplacements[TILE_SIZE * TILE_SIZE];
+                int64_t count = 0;
+                for (int64_t j = jStart; j < jEnd; ++j)
                 {
-                    for (int64_t i = 0; i < outDims[0]; ++i)
+                    for (int64_t i = iStart; i < iEnd; ++i)
                     {
                         Vector3D outCoord, inCoord, displacement;
                         outVol->indexToSpace(i, j, k, outCoord);
@@ -151,11 +163,29 @@ AlgorithmVolumeWarpfieldResample::AlgorithmVolumeWarpfieldResample(ProgressObjec
                             displacement[1] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, NULL, 1);
                             displacement[2] = warpfield->interpolateValue(outCoord, VolumeFile::TRILINEAR, NULL, 2);
                             inCoord = outCoord + displacement;
-                            float interpVal = inVol->interpolateValue(inCoord, myMethod, NULL, b, c);
-                            outVol->setValue(interpVal, i, j, k, b, c);
+                        } else {
+                            inCoord = outCoord;//placeholder, result is replaced below
+                        }
+                        validDisplacements[count] = validDisplacement;
+                        inCoords[count * 3] = inCoord[0];
+                        inCoords[count * 3 + 1] = inCoord[1];
+                        inCoords[count * 3 + 2] = inCoord[2];
+                        ++count;
+                    }
+                }
+                inVol->interpolateValues(inCoords, interpVals, count, myMethod, NULL, b, c);
+                count = 0;
+                for (int64_t j = jStart; j < jEnd; ++j)
+                {
+                    for (int64_t i = iStart; i < iEnd; ++i)
+                    {
+                        if (validDisplacements[count])
+                        {
+                            outVol->setValue(interpVals[count], i, j, k, b, c);
                         } else {
                             outVol->setValue(VolumeFile::INVALID_INTERP_VALUE, i, j, k, b, c);
                         }
+                        ++count;
                     }
                 }
             }
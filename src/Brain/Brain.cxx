@@ -36,6 +36,7 @@
 #include "BrowserTabContent.h"
 #include "CaretDataFileHelper.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPreferences.h"
 #include "ChartingDataManager.h"
 #include "ChartableTwoFileDelegate.h"
@@ -5324,6 +5325,303 @@ Brain::readDataFile(const DataFileTypeEnum::Enum dataFileType,
     return caretDataFileRead;
 }
 
+/**
+ * Can the given file be read by a worker thread when a spec file
+ * or scene is loaded?  Only local GIFTI and volume files qualify since
+ * reading them neither sends events nor registers event listeners, and
+ * adding them to the brain does not depend upon other files.  All other
+ * files are read on the main thread in spec file order.
+ *
+ * @param dataFileType
+ *    Type of the data file.
+ * @param dataFileName
+ *    Absolute name of the data file.
+ * @return
+ *    True if the file may be read concurrently.
+ */
+bool
+Brain::isDataFileReadConcurrently(const DataFileTypeEnum::Enum dataFileType,
+                                  const AString& dataFileName) const
+{
+    switch (dataFileType) {
+        case DataFileTypeEnum::LABEL:
+        case DataFileTypeEnum::METRIC:
+        case DataFileTypeEnum::RGBA:
+        case DataFileTypeEnum::SURFACE:
+        case DataFileTypeEnum::VOLUME:
+            break;
+        default:
+            return false;
+            break;
+    }
+    
+    if (DataFile::isFileOnNetwork(dataFileName)) {
+        return false;
+    }
+    
+    /*
+     * Missing files are left for readDataFile() to report
+     */
+    FileInformation fileInfo(dataFileName);
+    return fileInfo.exists();
+}
+
+/**
+ * Read data files using all available threads.  File objects are
+ * created and, if reading fails, deleted on the main thread since some
+ * of them register with the event manager.  The main thread sends
+ * progress events while the files are read and, if the user cancels,
+ * no further files are started.
+ *
+ * @param concurrentDataFiles
+ *    The files that are read.
+ * @param progressEvent
+ *    Event for reporting progress and detecting cancellation.
+ * @return
+ *    True if reading finished, false if the user cancelled in which
+ *    case all files that were read have been deleted.
+ */
+bool
+Brain::readDataFilesConcurrently(CONCURRENT_DATA_FILE_READ_MAP& concurrentDataFiles,
+                                 EventProgressUpdate& progressEvent)
+{
+    std::vector<ConcurrentDataFileRead*> filesToRead;
+    for (CONCURRENT_DATA_FILE_READ_MAP::iterator iter = concurrentDataFiles.begin();
+         iter != concurrentDataFiles.end();
+         iter++) {
+        ConcurrentDataFileRead& cdf = iter->second;
+        switch (cdf.m_dataFileType) {
+            case DataFileTypeEnum::LABEL:
+                cdf.m_caretDataFile = new LabelFile();
+                break;
+            case DataFileTypeEnum::METRIC:
+                cdf.m_caretDataFile = new MetricFile();
+                break;
+            case DataFileTypeEnum::RGBA:
+                cdf.m_caretDataFile = new RgbaFile();
+                break;
+            case DataFileTypeEnum::SURFACE:
+                cdf.m_caretDataFile = new Surface();
+                break;
+            case DataFileTypeEnum::VOLUME:
+                cdf.m_caretDataFile = new VolumeFile();
+                break;
+            default:
+                CaretAssertMessage(0, ("File type not supported for concurrent reading: "
+                                       + DataFileTypeEnum::toName(cdf.m_dataFileType)));
+                break;
+        }
+        if (cdf.m_caretDataFile != NULL) {
+            filesToRead.push_back(&cdf);
+        }
+    }
+    
+    const int32_t numberOfFiles = static_cast<int32_t>(filesToRead.size());
+    if (numberOfFiles <= 0) {
+        return true;
+    }
+    
+    ElapsedTimer timer;
+    timer.start();
+    
+    int32_t nextFileIndex = 0;
+    int32_t numberOfFilesRead = 0;
+    bool cancelledFlag = false;
+    
+#pragma omp CARET_PAR
+    {
+        bool mainThreadFlag = true;
+#ifdef CARET_OMP
+        mainThreadFlag = (omp_get_thread_num() == 0);
+#endif
+        
+        while (true) {
+            int32_t fileIndex = -1;
+            int32_t numberRead = 0;
+            bool allStartedFilesFinished = false;
+#pragma omp critical
+            {
+                if (( ! cancelledFlag)
+                    && (nextFileIndex < numberOfFiles)) {
+                    fileIndex = nextFileIndex;
+                    nextFileIndex++;
+                }
+                numberRead = numberOfFilesRead;
+                allStartedFilesFinished = (numberOfFilesRead == nextFileIndex);
+            }
+            
+            if (fileIndex >= 0) {
+                readDataFileConcurrently(*filesToRead[fileIndex]);
+#pragma omp critical
+                {
+                    numberOfFilesRead++;
+                    numberRead = numberOfFilesRead;
+                }
+            }
+            else if (( ! mainThreadFlag)
+                     || allStartedFilesFinished) {
+                break;
+            }
+            else {
+                /*
+                 * Main thread has no more files to read so it
+                 * keeps the progress display current while the
+                 * other threads finish their files.
+                 */
+                SystemUtilities::sleepSeconds(0.05);
+            }
+            
+            if (mainThreadFlag) {
+                const AString msg("Read "
+                                  + AString::number(numberRead)
+                                  + " of "
+                                  + AString::number(numberOfFiles)
+                                  + " data files");
+                if (progressEvent.getMaximumProgressValue() > 0) {
+                    progressEvent.setProgress(numberRead,
+                                              msg);
+                }
+                else {
+                    progressEvent.setProgressMessage(msg);
+                }
+                EventManager::get()->sendEvent(progressEvent.getPointer());
+                if (progressEvent.isCancelled()) {
+#pragma omp critical
+                    {
+                        cancelledFlag = true;
+                    }
+                }
+            }
+        }
+    }
+    
+    CaretLogInfo("Time to concurrently read "
+                 + AString::number(numberOfFilesRead)
+                 + " files was "
+                 + AString::number(timer.getElapsedTimeSeconds(), 'f', 3)
+                 + " seconds.");
+    
+    /*
+     * Files that failed to read are deleted on the main thread
+     */
+    for (std::vector<ConcurrentDataFileRead*>::iterator iter = filesToRead.begin();
+         iter != filesToRead.end();
+         iter++) {
+        ConcurrentDataFileRead* cdf = *iter;
+        if ( ! cdf->m_errorMessage.isEmpty()) {
+            delete cdf->m_caretDataFile;
+            cdf->m_caretDataFile = NULL;
+        }
+    }
+    
+    if (cancelledFlag) {
+        deleteConcurrentlyReadDataFiles(concurrentDataFiles);
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Read a file on a worker thread.  Any error is saved in the
+ * file's error message since exceptions may not leave a thread.
+ *
+ * @param concurrentDataFile
+ *    The file that is read.
+ */
+void
+Brain::readDataFileConcurrently(ConcurrentDataFileRead& concurrentDataFile)
+{
+    CaretAssert(concurrentDataFile.m_caretDataFile);
+    
+    const AString& filename = concurrentDataFile.m_dataFileName;
+    try {
+        concurrentDataFile.m_caretDataFile->readFile(filename);
+    }
+    catch (const DataFileException& dfe) {
+        concurrentDataFile.m_errorMessage = dfe.whatString();
+    }
+    catch (const std::bad_alloc&) {
+        concurrentDataFile.m_errorMessage = CaretDataFileHelper::createBadAllocExceptionMessage(filename);
+    }
+    catch (const std::exception& e) {
+        concurrentDataFile.m_errorMessage = (filename
+                                             + ": "
+                                             + AString(e.what()));
+    }
+    
+    if ( ! concurrentDataFile.m_errorMessage.isEmpty()) {
+        CaretLogWarning("Failed reading "
+                        + filename
+                        + ": "
+                        + concurrentDataFile.m_errorMessage);
+    }
+}
+
+/**
+ * Add a concurrently read file to the brain.  The brain takes
+ * ownership of the file.
+ *
+ * @param concurrentDataFile
+ *    The file that was read.
+ * @param structure
+ *    Structure from the spec file.
+ * @throws DataFileException
+ *    If the file failed to read or cannot be added.
+ */
+void
+Brain::addConcurrentlyReadDataFile(ConcurrentDataFileRead& concurrentDataFile,
+                                   const StructureEnum::Enum structure)
+{
+    CaretDataFile* caretDataFile = concurrentDataFile.m_caretDataFile;
+    concurrentDataFile.m_caretDataFile = NULL;
+    
+    if (caretDataFile == NULL) {
+        throw DataFileException(concurrentDataFile.m_errorMessage);
+    }
+    
+    /*
+     * In add mode, addReadOrReloadDataFile() only deletes files it
+     * creates itself, so a file rejected after it was read (invalid
+     * structure, missing surface, node count mismatch) must be
+     * deleted here unless the brain already took ownership of it.
+     */
+    try {
+        addReadOrReloadDataFile(FILE_MODE_ADD,
+                                caretDataFile,
+                                concurrentDataFile.m_dataFileType,
+                                structure,
+                                concurrentDataFile.m_dataFileName,
+                                false);
+    }
+    catch (...) {
+        if ( ! isFileValid(caretDataFile)) {
+            delete caretDataFile;
+        }
+        throw;
+    }
+}
+
+/**
+ * Delete concurrently read files that have not been added to the brain.
+ *
+ * @param concurrentDataFiles
+ *    The files.
+ */
+void
+Brain::deleteConcurrentlyReadDataFiles(CONCURRENT_DATA_FILE_READ_MAP& concurrentDataFiles)
+{
+    for (CONCURRENT_DATA_FILE_READ_MAP::iterator iter = concurrentDataFiles.begin();
+         iter != concurrentDataFiles.end();
+         iter++) {
+        ConcurrentDataFileRead& cdf = iter->second;
+        if (cdf.m_caretDataFile != NULL) {
+            delete cdf.m_caretDataFile;
+            cdf.m_caretDataFile = NULL;
+        }
+    }
+}
+
 /**
  * Processing performed after adding or removing a data file.
  */
@@ -5386,11 +5684,41 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
                                        "Starting to read selected files");
     EventManager::get()->sendEvent(progressUpdate.getPointer());
 
+    const int32_t numFileGroups = sf->getNumberOfDataFileTypeGroups();
+    
+    /*
+     * Files that do not depend upon other files are read concurrently
+     * but they are added to the brain, below, in spec file order.
+     */
+    CONCURRENT_DATA_FILE_READ_MAP concurrentDataFiles;
+    for (int32_t ig = 0; ig < numFileGroups; ig++) {
+        const SpecFileDataFileTypeGroup* group = sf->getDataFileTypeGroupByIndex(ig);
+        const DataFileTypeEnum::Enum dataFileType = group->getDataFileType();
+        const int32_t numFiles = group->getNumberOfFiles();
+        for (int32_t iFile = 0; iFile < numFiles; iFile++) {
+            const SpecFileDataFile* dataFileInfo = group->getFileInformation(iFile);
+            if (dataFileInfo->isLoadingSelected()) {
+                const AString filename = convertFilePathNameToAbsolutePathName(dataFileInfo->getFileName());
+                if (isDataFileReadConcurrently(dataFileType,
+                                               filename)) {
+                    concurrentDataFiles.insert(std::make_pair(dataFileInfo,
+                                                              ConcurrentDataFileRead(dataFileType,
+                                                                                     filename)));
+                }
+            }
+        }
+    }
+    if ( ! readDataFilesConcurrently(concurrentDataFiles,
+                                     progressUpdate)) {
+        resetBrain();
+        return;
+    }
+    fileReadCounter = static_cast<int32_t>(concurrentDataFiles.size());
+    
     /*
      * Note: Need to read palette first since some of the individual file
      * reading routines update palette coloring when file is read
      */
-    const int32_t numFileGroups = sf->getNumberOfDataFileTypeGroups();
     for (int32_t ig = -1; ig < numFileGroups; ig++) {
         const SpecFileDataFileTypeGroup* group = ((ig == -1)
                                                ? sf->getDataFileTypeGroupByType(DataFileTypeEnum::PALETTE)
@@ -5407,13 +5735,16 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
             if (dataFileInfo->isLoadingSelected()) {
                 const AString filename = dataFileInfo->getFileName();
                 const StructureEnum::Enum structure = dataFileInfo->getStructure();
+                
+                CONCURRENT_DATA_FILE_READ_MAP::iterator concurrentIter = concurrentDataFiles.find(dataFileInfo);
+                const bool wasReadConcurrentlyFlag = (concurrentIter != concurrentDataFiles.end());
 
                 /*
                  * Send event indicating progress of file reading
                  */
                 FileInformation fileInfo(dataFileInfo->getFileName());
                 progressUpdate.setProgress(fileReadCounter,
-                                           ("Reading "
+                                           ((wasReadConcurrentlyFlag ? "Adding " : "Reading ")
                                             + fileInfo.getFileName()));
                 EventManager::get()->sendEvent(progressUpdate.getPointer());
                 
@@ -5421,15 +5752,22 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
                  * If user cancelled, reset brain and get out!
                  */
                 if (progressUpdate.isCancelled()) {
+                    deleteConcurrentlyReadDataFiles(concurrentDataFiles);
                     resetBrain();
                     return;
                 }
                 
                 try {
-                    readDataFile(dataFileType,
-                                 structure,
-                                 filename,
-                                 false);
+                    if (wasReadConcurrentlyFlag) {
+                        addConcurrentlyReadDataFile(concurrentIter->second,
+                                                    structure);
+                    }
+                    else {
+                        readDataFile(dataFileType,
+                                     structure,
+                                     filename,
+                                     false);
+                    }
                 }
                 catch (const DataFileException& e) {
                     if (errorMessage.isEmpty() == false) {
@@ -5438,7 +5776,9 @@ Brain::loadFilesSelectedInSpecFile(EventSpecFileReadDataFiles* readSpecFileDataF
                     errorMessage += e.whatString();
                 }
                 
-                fileReadCounter++;
+                if ( ! wasReadConcurrentlyFlag) {
+                    fileReadCounter++;
+                }
             }
         }
     }
@@ -5658,6 +5998,40 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
     }
     m_nonModifiedFilesForRestoringScene.clear();
     
+    /*
+     * Files that do not depend upon other files are read concurrently
+     * but they are added to the brain, below, in spec file order.
+     * Files for a scene on the network are read on the main thread.
+     */
+    CONCURRENT_DATA_FILE_READ_MAP concurrentDataFiles;
+    if ( ! sceneFileOnNetwork) {
+        const int32_t numFileGroups = specFileToLoad->getNumberOfDataFileTypeGroups();
+        for (int32_t ig = 0; ig < numFileGroups; ig++) {
+            const SpecFileDataFileTypeGroup* group = specFileToLoad->getDataFileTypeGroupByIndex(ig);
+            const DataFileTypeEnum::Enum dataFileType = group->getDataFileType();
+            const int32_t numFiles = group->getNumberOfFiles();
+            for (int32_t iFile = 0; iFile < numFiles; iFile++) {
+                const SpecFileDataFile* fileInfo = group->getFileInformation(iFile);
+                if (fileInfo->isLoadingSelected()) {
+                    if (specFilesEntryToNonModifiedFile.find(fileInfo) == specFilesEntryToNonModifiedFile.end()) {
+                        const AString filename = convertFilePathNameToAbsolutePathName(fileInfo->getFileName());
+                        if (isDataFileReadConcurrently(dataFileType,
+                                                       filename)) {
+                            concurrentDataFiles.insert(std::make_pair(fileInfo,
+                                                                      ConcurrentDataFileRead(dataFileType,
+                                                                                             filename)));
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if ( ! readDataFilesConcurrently(concurrentDataFiles,
+                                     progressEvent)) {
+        resetBrain(keepSceneFiles,
+                   keepSpecFile);
+        return;
+    }
     
     /*
      * Load new files and add existing files that were previously loaded.
@@ -5681,6 +6055,7 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
                         progressEvent.setProgressMessage(msg);
                         EventManager::get()->sendEvent(progressEvent.getPointer());
                         if (progressEvent.isCancelled()) {
+                            deleteConcurrentlyReadDataFiles(concurrentDataFiles);
                             resetBrain(keepSceneFiles,
                                        keepSpecFile);
                             return;
@@ -5694,6 +6069,21 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
                                                 filename,
                                                 false);
                     }
+                    else if (concurrentDataFiles.find(fileInfo) != concurrentDataFiles.end()) {
+                        const QString msg = ("Adding "
+                                             + FileInformation(filename).getFileName());
+                        progressEvent.setProgressMessage(msg);
+                        EventManager::get()->sendEvent(progressEvent.getPointer());
+                        if (progressEvent.isCancelled()) {
+                            deleteConcurrentlyReadDataFiles(concurrentDataFiles);
+                            resetBrain(keepSceneFiles,
+                                       keepSpecFile);
+                            return;
+                        }
+                        
+                        addConcurrentlyReadDataFile(concurrentDataFiles.find(fileInfo)->second,
+                                                    fileInfo->getStructure());
+                    }
                     else {
                         const StructureEnum::Enum structure = fileInfo->getStructure();
                         
@@ -5702,6 +6092,7 @@ Brain::loadSpecFileFromScene(const SceneAttributes* sceneAttributes,
                         progressEvent.setProgressMessage(msg);
                         EventManager::get()->sendEvent(progressEvent.getPointer());
                         if (progressEvent.isCancelled()) {
+                            deleteConcurrentlyReadDataFiles(concurrentDataFiles);
                             resetBrain(keepSceneFiles,
                                        keepSpecFile);
                             return;
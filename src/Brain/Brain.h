@@ -21,6 +21,7 @@
  */
 /*LICENSE_END*/
 
+#include <map>
 #include <vector>
 #include <stdint.h>
 
@@ -78,6 +79,7 @@ namespace caret {
     class DisplayPropertiesVolume;
     class EventDataFileRead;
     class EventDataFileReload;
+    class EventProgressUpdate;
     class EventSpecFileReadDataFiles;
     class GapsAndMargins;
     class IdentificationManager;
@@ -95,6 +97,7 @@ namespace caret {
     class SceneFile;
     class SelectionManager;
     class SpecFile;
+    class SpecFileDataFile;
     class Surface;
     class SurfaceFile;
     class SurfaceProjectedItem;
@@ -461,6 +464,35 @@ namespace caret {
             FILE_MODE_RELOAD
         };
         
+        /**
+         * A data file from a spec file that is read by a worker thread
+         * and later added to the brain, in spec file order, on the
+         * main thread.
+         */
+        class ConcurrentDataFileRead {
+        public:
+            ConcurrentDataFileRead(const DataFileTypeEnum::Enum dataFileType,
+                                   const AString& dataFileName)
+            : m_dataFileType(dataFileType),
+            m_dataFileName(dataFileName),
+            m_caretDataFile(NULL) { }
+            
+            /** Type of the data file */
+            DataFileTypeEnum::Enum m_dataFileType;
+            
+            /** Absolute name of the data file */
+            AString m_dataFileName;
+            
+            /** File that was read, NULL once added to the brain or if reading failed */
+            CaretDataFile* m_caretDataFile;
+            
+            /** Error message if reading failed */
+            AString m_errorMessage;
+        };
+        
+        /** Data files read concurrently keyed by their spec file entry */
+        typedef std::map<const SpecFileDataFile*, ConcurrentDataFileRead> CONCURRENT_DATA_FILE_READ_MAP;
+        
         void addDataFile(CaretDataFile* caretDataFile);
         
         bool removeWithoutDeleteDataFile(const CaretDataFile* caretDataFile);
@@ -488,6 +520,19 @@ namespace caret {
                           const AString& dataFileName,
                           const bool markDataFileAsModified);
         
+        bool isDataFileReadConcurrently(const DataFileTypeEnum::Enum dataFileType,
+                                        const AString& dataFileName) const;
+        
+        bool readDataFilesConcurrently(CONCURRENT_DATA_FILE_READ_MAP& concurrentDataFiles,
+                                       EventProgressUpdate& progressEvent);
+        
+        static void readDataFileConcurrently(ConcurrentDataFileRead& concurrentDataFile);
+        
+        void addConcurrentlyReadDataFile(ConcurrentDataFileRead& concurrentDataFile,
+                                         const StructureEnum::Enum structure);
+        
+        static void deleteConcurrentlyReadDataFiles(CONCURRENT_DATA_FILE_READ_MAP& concurrentDataFiles);
+        
         void createModelChartTwo();
         
         /**
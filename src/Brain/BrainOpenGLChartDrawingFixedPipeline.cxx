@@ -20,6 +20,7 @@
 /*LICENSE_END*/
 
 #include <cmath>
+#include <memory>
 
 #define __BRAIN_OPEN_G_L_CHART_DRAWING_FIXED_PIPELINE_DECLARE__
 #include "BrainOpenGLChartDrawingFixedPipeline.h"
@@ -51,6 +52,9 @@
 #include "ConnectivityDataLoaded.h"
 #include "EventCaretMappableDataFileMapsViewedInOverlays.h"
 #include "EventManager.h"
+#include "GraphicsEngineDataOpenGL.h"
+#include "GraphicsPrimitiveV3f.h"
+#include "GraphicsPrimitiveV3fT3f.h"
 #include "IdentificationWithColor.h"
 #include "SelectionItemChartDataSeries.h"
 #include "SelectionItemChartFrequencySeries.h"
@@ -78,6 +82,7 @@ BrainOpenGLChartDrawingFixedPipeline::BrainOpenGLChartDrawingFixedPipeline()
     m_brain = NULL;
     m_fixedPipelineDrawing = NULL;
     m_identificationModeFlag = false;
+    m_matrixIdentificationDepth = 0.0;
 }
 
 /**
@@ -950,10 +955,10 @@ BrainOpenGLChartDrawingFixedPipeline::drawChartGraphicsMatrix(const int32_t view
     
     int32_t numberOfRows = 0;
     int32_t numberOfColumns = 0;
-    std::vector<float> matrixRGBA;
-    if (chartMatrixInterface->getMatrixDataRGBA(numberOfRows,
-                                       numberOfColumns,
-                                       matrixRGBA)) {
+    chartMatrixInterface->getMatrixDimensions(numberOfRows,
+                                              numberOfColumns);
+    if ((numberOfRows > 0)
+        && (numberOfColumns > 0)) {
         std::set<int32_t> selectedColumnIndices;
         std::set<int32_t> selectedRowIndices;
         
@@ -1088,114 +1093,24 @@ BrainOpenGLChartDrawingFixedPipeline::drawChartGraphicsMatrix(const int32_t view
                          0.0);
         }
         
-        int32_t rgbaOffset = 0;
-        std::vector<float> quadVerticesXYZ;
-        quadVerticesXYZ.reserve(numberOfRows * numberOfColumns * 3);
-        std::vector<float> quadVerticesFloatRGBA;
-        quadVerticesFloatRGBA.reserve(numberOfRows * numberOfColumns * 4);
-        std::vector<uint8_t> quadVerticesByteRGBA;
-        quadVerticesByteRGBA.reserve(numberOfRows * numberOfColumns * 4);
-        
-        float cellY = (numberOfRows - 1) * cellHeight;
-        for (int32_t rowIndex = 0; rowIndex < numberOfRows; rowIndex++) {
-            float cellX = 0;
-            for (int32_t columnIndex = 0; columnIndex < numberOfColumns; columnIndex++) {
-                CaretAssertVectorIndex(matrixRGBA, rgbaOffset+3);
-                const float* rgba = &matrixRGBA[rgbaOffset];
-                rgbaOffset += 4;
-                
-                uint8_t idRGBA[4];
-                if (m_identificationModeFlag) {
-                    addToChartMatrixIdentification(rowIndex,
-                                                   columnIndex,
-                                                   idRGBA);
-                }
-                
-                if (m_identificationModeFlag) {
-                    quadVerticesByteRGBA.push_back(idRGBA[0]);
-                    quadVerticesByteRGBA.push_back(idRGBA[1]);
-                    quadVerticesByteRGBA.push_back(idRGBA[2]);
-                    quadVerticesByteRGBA.push_back(idRGBA[3]);
-                }
-                else {
-                    quadVerticesFloatRGBA.push_back(rgba[0]);
-                    quadVerticesFloatRGBA.push_back(rgba[1]);
-                    quadVerticesFloatRGBA.push_back(rgba[2]);
-                    quadVerticesFloatRGBA.push_back(rgba[3]);
-                }
-                quadVerticesXYZ.push_back(cellX);
-                quadVerticesXYZ.push_back(cellY);
-                quadVerticesXYZ.push_back(0.0);
-                
-                if (m_identificationModeFlag) {
-                    quadVerticesByteRGBA.push_back(idRGBA[0]);
-                    quadVerticesByteRGBA.push_back(idRGBA[1]);
-                    quadVerticesByteRGBA.push_back(idRGBA[2]);
-                    quadVerticesByteRGBA.push_back(idRGBA[3]);
-                }
-                else {
-                    quadVerticesFloatRGBA.push_back(rgba[0]);
-                    quadVerticesFloatRGBA.push_back(rgba[1]);
-                    quadVerticesFloatRGBA.push_back(rgba[2]);
-                    quadVerticesFloatRGBA.push_back(rgba[3]);
-                }
-                quadVerticesXYZ.push_back(cellX + cellWidth);
-                quadVerticesXYZ.push_back(cellY);
-                quadVerticesXYZ.push_back(0.0);
-                
-                if (m_identificationModeFlag) {
-                    quadVerticesByteRGBA.push_back(idRGBA[0]);
-                    quadVerticesByteRGBA.push_back(idRGBA[1]);
-                    quadVerticesByteRGBA.push_back(idRGBA[2]);
-                    quadVerticesByteRGBA.push_back(idRGBA[3]);
-                }
-                else {
-                    quadVerticesFloatRGBA.push_back(rgba[0]);
-                    quadVerticesFloatRGBA.push_back(rgba[1]);
-                    quadVerticesFloatRGBA.push_back(rgba[2]);
-                    quadVerticesFloatRGBA.push_back(rgba[3]);
-                }
-                quadVerticesXYZ.push_back(cellX + cellWidth);
-                quadVerticesXYZ.push_back(cellY + cellHeight);
-                quadVerticesXYZ.push_back(0.0);
-                
-                if (m_identificationModeFlag) {
-                    quadVerticesByteRGBA.push_back(idRGBA[0]);
-                    quadVerticesByteRGBA.push_back(idRGBA[1]);
-                    quadVerticesByteRGBA.push_back(idRGBA[2]);
-                    quadVerticesByteRGBA.push_back(idRGBA[3]);
-                }
-                else {
-                    quadVerticesFloatRGBA.push_back(rgba[0]);
-                    quadVerticesFloatRGBA.push_back(rgba[1]);
-                    quadVerticesFloatRGBA.push_back(rgba[2]);
-                    quadVerticesFloatRGBA.push_back(rgba[3]);
-                }
-                quadVerticesXYZ.push_back(cellX);
-                quadVerticesXYZ.push_back(cellY + cellHeight);
-                quadVerticesXYZ.push_back(0.0);
-                
-                
-                cellX += cellWidth;
-            }
-            
-            cellY -= cellHeight;
-        }
-        
-        /*
-         * Draw the matrix elements.
-         */
         if (m_identificationModeFlag) {
-            CaretAssert((quadVerticesXYZ.size() / 3) == (quadVerticesByteRGBA.size() / 4));
-            const int32_t numberQuadVertices = static_cast<int32_t>(quadVerticesXYZ.size() / 3);
-            glBegin(GL_QUADS);
-            for (int32_t i = 0; i < numberQuadVertices; i++) {
-                CaretAssertVectorIndex(quadVerticesByteRGBA, i*4 + 3);
-                glColor4ubv(&quadVerticesByteRGBA[i*4]);
-                CaretAssertVectorIndex(quadVerticesXYZ, i*3 + 2);
-                glVertex3fv(&quadVerticesXYZ[i*3]);
+            /*
+             * Cells are 1.0 x 1.0 after scaling so the cell is found
+             * directly from the mouse location without drawing.
+             */
+            glPushMatrix();
+            glScalef(cellWidth, cellHeight, 1.0);
+            int32_t rowIndex = -1;
+            int32_t columnIndex = -1;
+            if (m_fixedPipelineDrawing->getMatrixCellFromMouse(numberOfRows,
+                                                               numberOfColumns,
+                                                               rowIndex,
+                                                               columnIndex,
+                                                               m_matrixIdentificationDepth)) {
+                m_identificationIndices.push_back(rowIndex);
+                m_identificationIndices.push_back(columnIndex);
             }
-            glEnd();
+            glPopMatrix();
         }
         else {
             /*
@@ -1205,16 +1120,22 @@ BrainOpenGLChartDrawingFixedPipeline::drawChartGraphicsMatrix(const int32_t view
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             
-            CaretAssert((quadVerticesXYZ.size() / 3) == (quadVerticesFloatRGBA.size() / 4));
-            const int32_t numberQuadVertices = static_cast<int32_t>(quadVerticesXYZ.size() / 3);
-            glBegin(GL_QUADS);
-            for (int32_t i = 0; i < numberQuadVertices; i++) {
-                CaretAssertVectorIndex(quadVerticesFloatRGBA, i*4 + 3);
-                glColor4fv(&quadVerticesFloatRGBA[i*4]);
-                CaretAssertVectorIndex(quadVerticesXYZ, i*3 + 2);
-                glVertex3fv(&quadVerticesXYZ[i*3]);
+            /*
+             * The matrix elements are drawn as one textured rectangle
+             * so drawing time does not grow with the number of elements.
+             * The file keeps the primitive (and its texture) until the
+             * coloring, data, or row ordering changes.
+             */
+            const CiftiMappableDataFile* ciftiMapFile = chartMatrixInterface->getMatrixChartCiftiMappableDataFile();
+            GraphicsPrimitiveV3fT3f* matrixPrimitive = ((ciftiMapFile != NULL)
+                                                        ? ciftiMapFile->getMatrixChartingTexturePrimitive(ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL)
+                                                        : NULL);
+            if (matrixPrimitive != NULL) {
+                glPushMatrix();
+                glScalef(cellWidth, cellHeight, 1.0);
+                GraphicsEngineDataOpenGL::draw(matrixPrimitive);
+                glPopMatrix();
             }
-            glEnd();
             
             glDisable(GL_BLEND);
 
@@ -1229,25 +1150,27 @@ BrainOpenGLChartDrawingFixedPipeline::drawChartGraphicsMatrix(const int32_t view
                 CaretPreferences::byteRgbToFloatRgb(gridLineColorBytes,
                                                     gridLineColorFloats);
                 gridLineColorFloats[3] = 1.0;
-                std::vector<float> outlineRGBA;
-                outlineRGBA.reserve(numberQuadVertices * 4);
-                for (int32_t i = 0; i < numberQuadVertices; i++) {
-                    outlineRGBA.push_back(gridLineColorFloats[0]);
-                    outlineRGBA.push_back(gridLineColorFloats[1]);
-                    outlineRGBA.push_back(gridLineColorFloats[2]);
-                    outlineRGBA.push_back(gridLineColorFloats[3]);
-                }
                 
-                glPolygonMode(GL_FRONT, GL_LINE);
-                glLineWidth(1.0);
-                glBegin(GL_QUADS);
-                for (int32_t i = 0; i < numberQuadVertices; i++) {
-                    CaretAssertVectorIndex(outlineRGBA, i*4 + 3);
-                    glColor4fv(&outlineRGBA[i*4]);
-                    CaretAssertVectorIndex(quadVerticesXYZ, i*3 + 2);
-                    glVertex3fv(&quadVerticesXYZ[i*3]);
+                /*
+                 * The outlines of all cells form a grid so only one line
+                 * per row boundary and one line per column boundary is drawn.
+                 */
+                std::unique_ptr<GraphicsPrimitiveV3f> gridPrimitive(GraphicsPrimitive::newPrimitiveV3f(GraphicsPrimitive::PrimitiveType::OPENGL_LINES,
+                                                                                                       gridLineColorFloats));
+                const float matrixWidth  = numberOfColumns * cellWidth;
+                const float matrixHeight = numberOfRows    * cellHeight;
+                for (int32_t rowIndex = 0; rowIndex <= numberOfRows; rowIndex++) {
+                    const float y = rowIndex * cellHeight;
+                    gridPrimitive->addVertex(0.0, y, 0.0);
+                    gridPrimitive->addVertex(matrixWidth, y, 0.0);
+                }
+                for (int32_t columnIndex = 0; columnIndex <= numberOfColumns; columnIndex++) {
+                    const float x = columnIndex * cellWidth;
+                    gridPrimitive->addVertex(x, 0.0, 0.0);
+                    gridPrimitive->addVertex(x, matrixHeight, 0.0);
                 }
-                glEnd();
+                gridPrimitive->setLineWidth(GraphicsPrimitive::LineWidthType::PIXELS, 1.0);
+                GraphicsEngineDataOpenGL::draw(gridPrimitive.get());
             }
             
             if ( (! selectedRowIndices.empty())
@@ -1474,36 +1397,6 @@ BrainOpenGLChartDrawingFixedPipeline::addToChartLineIdentification(const int32_t
     m_identificationIndices.push_back(chartLineIndex);
 }
 
-/**
- * Add an item for matrix identification.
- *
- * @param matrixRowIndex
- *     Index of the row
- * @param matrixColumnIndex
- *     Index of the column
- * @param rgbaForColorIdentificationOut
- *    Encoded identification in RGBA color OUTPUT
- */
-void
-BrainOpenGLChartDrawingFixedPipeline::addToChartMatrixIdentification(const int32_t matrixRowIndex,
-                                                                     const int32_t matrixColumnIndex,
-                                                                     uint8_t rgbaForColorIdentificationOut[4])
-{
-    const int32_t idIndex = m_identificationIndices.size() / IDENTIFICATION_INDICES_PER_MATRIX_ELEMENT;
-    
-    m_fixedPipelineDrawing->colorIdentification->addItem(rgbaForColorIdentificationOut,
-                                                         m_chartableMatrixSelectionTypeForIdentification,
-                                                         idIndex);
-    rgbaForColorIdentificationOut[3] = 255;
-    
-    /*
-     * If these items change, need to update reset and
-     * processing of identification.
-     */
-    m_identificationIndices.push_back(matrixRowIndex);
-    m_identificationIndices.push_back(matrixColumnIndex);
-}
-
 /**
  * Reset identification.
  */
@@ -1511,6 +1404,7 @@ void
 BrainOpenGLChartDrawingFixedPipeline::resetIdentification()
 {
     m_identificationIndices.clear();
+    m_matrixIdentificationDepth = 0.0;
     
     if (m_identificationModeFlag) {
         const int32_t estimatedNumberOfItems = 1000;
@@ -1624,15 +1518,13 @@ BrainOpenGLChartDrawingFixedPipeline::processIdentification()
         }
     }
     else if (m_chartableMatrixInterfaceBeingDrawnForIdentification != NULL) {
-        m_fixedPipelineDrawing->getIndexFromColorSelection(m_chartableMatrixSelectionTypeForIdentification,
-                                                           m_fixedPipelineDrawing->mouseX,
-                                                           m_fixedPipelineDrawing->mouseY,
-                                                           identifiedItemIndex,
-                                                           depth);
-        if (identifiedItemIndex >= 0) {
-            const int32_t idIndex = identifiedItemIndex * IDENTIFICATION_INDICES_PER_MATRIX_ELEMENT;
-            const int32_t rowIndex = m_identificationIndices[idIndex];
-            const int32_t columnIndex = m_identificationIndices[idIndex + 1];
+        /*
+         * Matrix element was found directly from the mouse location when drawn
+         */
+        if (static_cast<int32_t>(m_identificationIndices.size()) >= IDENTIFICATION_INDICES_PER_MATRIX_ELEMENT) {
+            const int32_t rowIndex = m_identificationIndices[0];
+            const int32_t columnIndex = m_identificationIndices[1];
+            depth = m_matrixIdentificationDepth;
             
             SelectionItemChartMatrix* chartMatrixID = m_brain->getSelectionManager()->getChartMatrixIdentification();
             if (chartMatrixID->isOtherScreenDepthCloserToViewer(depth)) {
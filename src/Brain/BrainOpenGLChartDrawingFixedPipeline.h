@@ -133,10 +133,6 @@ namespace caret {
                                           const int32_t lineIndex,
                                           uint8_t rgbaForColorIdentification[4]);
         
-        void addToChartMatrixIdentification(const int32_t matrixRowIndex,
-                                          const int32_t matrixColumnIndex,
-                                          uint8_t rgbaForColorIdentification[4]);
-        
         void resetIdentification();
         
         void processIdentification();
@@ -168,6 +164,9 @@ namespace caret {
         
         bool m_identificationModeFlag;
         
+        /** Screen depth of matrix element found for identification */
+        float m_matrixIdentificationDepth;
+        
         // ADD_NEW_MEMBERS_HERE
 
         static const int32_t IDENTIFICATION_INDICES_PER_CHART_LINE;
@@ -55,6 +55,7 @@
 #include "GraphicsPrimitiveV3f.h"
 #include "GraphicsPrimitiveV3fC4f.h"
 #include "GraphicsPrimitiveV3fC4ub.h"
+#include "GraphicsPrimitiveV3fT3f.h"
 #include "GraphicsShape.h"
 #include "IdentificationWithColor.h"
 #include "MathFunctions.h"
@@ -1242,16 +1243,11 @@ BrainOpenGLChartTwoDrawingFixedPipeline::drawMatrixChartContent(const ChartableT
                                                                 const float /*zooming*/,
                                                                 std::vector<MatrixRowColumnHighight*>& rowColumnHighlightingOut)
 {
-    GraphicsPrimitiveV3fC4f* matrixPrimitive = matrixChart->getMatrixChartingGraphicsPrimitive(chartViewingType,
-                                                                                               CiftiMappableDataFile::MatrixGridMode::FILLED);
+    GraphicsPrimitiveV3fT3f* matrixPrimitive = matrixChart->getMatrixChartingTexturePrimitive(chartViewingType);
     if (matrixPrimitive == NULL) {
         return;
     }
     
-    if (m_identificationModeFlag) {
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    }
-    
     glPushMatrix();
     glScalef(cellWidth, cellHeight, 1.0);
     /*
@@ -1262,29 +1258,33 @@ BrainOpenGLChartTwoDrawingFixedPipeline::drawMatrixChartContent(const ChartableT
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     if (m_identificationModeFlag) {
-        int32_t primitiveIndex = -1;
-        float   primitiveDepth = 0.0;
-        GraphicsEngineDataOpenGL::drawWithSelection(matrixPrimitive,
-                                                    m_fixedPipelineDrawing->mouseX,
-                                                    m_fixedPipelineDrawing->mouseY,
-                                                    primitiveIndex,
-                                                    primitiveDepth);
-        if (primitiveIndex >= 0) {
+        /*
+         * Cells are 1.0 x 1.0 so the cell is found directly
+         * from the mouse location without drawing.
+         */
+        int32_t numberOfRows = 0;
+        int32_t numberOfColumns = 0;
+        matrixChart->getMatrixDimensions(numberOfRows,
+                                         numberOfColumns);
+        
+        int32_t rowIndex = -1;
+        int32_t colIndex = -1;
+        float   cellDepth = 0.0;
+        if (m_fixedPipelineDrawing->getMatrixCellFromMouse(numberOfRows,
+                                                           numberOfColumns,
+                                                           rowIndex,
+                                                           colIndex,
+                                                           cellDepth)) {
             /*
-             * Two triangles per cell so divided the primitive index by two
+             * Cells hidden by the triangular viewing mode are not drawn
+             * so they must not be identified.
              */
-            CaretAssert(matrixPrimitive->getPrimitiveType() == GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES);
-            primitiveIndex /= 2;
-            
-            int32_t numberOfRows = 0;
-            int32_t numberOfColumns = 0;
-            matrixChart->getMatrixDimensions(numberOfRows,
-                                             numberOfColumns);
-            
-            const int32_t rowIndex = primitiveIndex / numberOfColumns;
-            const int32_t colIndex = primitiveIndex % numberOfColumns;
-            
-            if (m_selectionItemMatrix->isOtherScreenDepthCloserToViewer(primitiveDepth)) {
+            if (CiftiMappableDataFile::isMatrixChartCellDisplayed(chartViewingType,
+                                                                  numberOfRows,
+                                                                  numberOfColumns,
+                                                                  rowIndex,
+                                                                  colIndex)
+                && m_selectionItemMatrix->isOtherScreenDepthCloserToViewer(cellDepth)) {
                 m_selectionItemMatrix->setMatrixChart(const_cast<ChartableTwoFileMatrixChart*>(matrixChart),
                                                       rowIndex,
                                                       colIndex);
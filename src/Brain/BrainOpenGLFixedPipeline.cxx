@@ -47,6 +47,7 @@
 #include "BrainOpenGLPrimitiveDrawing.h"
 #include "BrainOpenGLVolumeObliqueSliceDrawing.h"
 #include "BrainOpenGLVolumeSliceDrawing.h"
+#include "BrainOpenGLVolumeSliceTextureCache.h"
 #include "BrainOpenGLShapeCone.h"
 #include "BrainOpenGLShapeCube.h"
 #include "BrainOpenGLShapeCylinder.h"
@@ -100,6 +101,7 @@
 #include "GiftiLabel.h"
 #include "GiftiLabelTable.h"
 #include "GraphicsEngineDataOpenGL.h"
+#include "GraphicsEngineDataOpenGLMesh.h"
 #include "GraphicsPrimitiveV3fC4ub.h"
 #include "GraphicsPrimitiveV3f.h"
 #include "GraphicsShape.h"
@@ -138,11 +140,13 @@
 #include "Plane.h"
 #include "SessionManager.h"
 #include "Surface.h"
+#include "SurfaceDecimationHelper.h"
 #include "SurfaceMontageViewport.h"
 #include "SurfaceNodeColoring.h"
 #include "SurfaceProjectedItem.h"
 #include "SurfaceProjectionBarycentric.h"
 #include "SurfaceProjectionVanEssen.h"
+#include "SurfaceRayHelper.h"
 #include "SurfaceSelectionModel.h"
 #include "TopologyHelper.h"
 #include "VolumeFile.h"
@@ -167,6 +171,7 @@ BrainOpenGLFixedPipeline::BrainOpenGLFixedPipeline(BrainOpenGLTextRenderInterfac
     this->initializeMembersBrainOpenGL();
     this->colorIdentification   = new IdentificationWithColor();
     m_annotationDrawing.grabNew(new BrainOpenGLAnnotationDrawingFixedPipeline(this));
+    m_volumeSliceTextureCache.grabNew(new BrainOpenGLVolumeSliceTextureCache());
     
     m_shapeSphere = NULL;
     m_shapeCone   = NULL;
@@ -1808,7 +1813,8 @@ BrainOpenGLFixedPipeline::drawSurface(Surface* surface,
                     glEnable(GL_POLYGON_OFFSET_FILL);
                     disableLighting();
                     this->drawSurfaceTrianglesWithVertexArrays(surface,
-                                                               NULL);
+                                                               NULL,
+                                                               false);
                     glDisable(GL_POLYGON_OFFSET_FILL);
                     
                     /*
@@ -1818,7 +1824,8 @@ BrainOpenGLFixedPipeline::drawSurface(Surface* surface,
                     setLineWidth(dps->getLinkSize());
                     glPolygonMode(GL_FRONT, GL_LINE);
                     this->drawSurfaceTrianglesWithVertexArrays(surface,
-                                                               nodeColoringRGBA);
+                                                               nodeColoringRGBA,
+                                                               false);
                     glPolygonMode(GL_FRONT, GL_FILL);
                     break;
                 case SurfaceDrawingTypeEnum::DRAW_AS_NODES:
@@ -1845,7 +1852,8 @@ BrainOpenGLFixedPipeline::drawSurface(Surface* surface,
                     }
 
                     this->drawSurfaceTrianglesWithVertexArrays(surface,
-                                                               nodeColoringRGBA);
+                                                               nodeColoringRGBA,
+                                                               true);
                     
                     if (borderAboveSurfaceOffset != 0.0) {
                         glDisable(GL_POLYGON_OFFSET_FILL);
@@ -2008,51 +2016,67 @@ BrainOpenGLFixedPipeline::drawSurfaceTriangles(Surface* surface,
             break;
     }
     
-    if (isSelect) {
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    }
-    
-    uint8_t rgba[4];
+    /*
+     * Ray casting finds the triangle without drawing the surface
+     * in identification colors
+     */
+    const bool rayCastFlag = (isSelect
+                              && m_brain->getSelectionManager()->isSurfacePickingWithRayCastingEnabled());
     
-    glBegin(GL_TRIANGLES);
-    for (int32_t i = 0; i < numTriangles; i++) {
-        const int32_t i3 = i * 3;
-        const int32_t n1 = triangles[i3];
-        const int32_t n2 = triangles[i3+1];
-        const int32_t n3 = triangles[i3+2];
-        
+    if ( ! rayCastFlag) {
         if (isSelect) {
-            this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
-            glColor3ubv(rgba);
-            glNormal3fv(&normals[n1*3]);
-            glVertex3fv(&coordinates[n1*3]);
-            glNormal3fv(&normals[n2*3]);
-            glVertex3fv(&coordinates[n2*3]);
-            glNormal3fv(&normals[n3*3]);
-            glVertex3fv(&coordinates[n3*3]);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         }
-        else {
-            glColor4fv(&nodeColoringRGBA[n1*4]);
-            glNormal3fv(&normals[n1*3]);
-            glVertex3fv(&coordinates[n1*3]);
-            glColor4fv(&nodeColoringRGBA[n2*4]);
-            glNormal3fv(&normals[n2*3]);
-            glVertex3fv(&coordinates[n2*3]);
-            glColor4fv(&nodeColoringRGBA[n3*4]);
-            glNormal3fv(&normals[n3*3]);
-            glVertex3fv(&coordinates[n3*3]);
+        
+        uint8_t rgba[4];
+        
+        glBegin(GL_TRIANGLES);
+        for (int32_t i = 0; i < numTriangles; i++) {
+            const int32_t i3 = i * 3;
+            const int32_t n1 = triangles[i3];
+            const int32_t n2 = triangles[i3+1];
+            const int32_t n3 = triangles[i3+2];
+            
+            if (isSelect) {
+                this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_TRIANGLE, i);
+                glColor3ubv(rgba);
+                glNormal3fv(&normals[n1*3]);
+                glVertex3fv(&coordinates[n1*3]);
+                glNormal3fv(&normals[n2*3]);
+                glVertex3fv(&coordinates[n2*3]);
+                glNormal3fv(&normals[n3*3]);
+                glVertex3fv(&coordinates[n3*3]);
+            }
+            else {
+                glColor4fv(&nodeColoringRGBA[n1*4]);
+                glNormal3fv(&normals[n1*3]);
+                glVertex3fv(&coordinates[n1*3]);
+                glColor4fv(&nodeColoringRGBA[n2*4]);
+                glNormal3fv(&normals[n2*3]);
+                glVertex3fv(&coordinates[n2*3]);
+                glColor4fv(&nodeColoringRGBA[n3*4]);
+                glNormal3fv(&normals[n3*3]);
+                glVertex3fv(&coordinates[n3*3]);
+            }
         }
+        glEnd();
     }
-    glEnd();
     
     if (isSelect) {
         int32_t triangleIndex = -1;
         float depth = -1.0;
-        this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_TRIANGLE, 
-                                         this->mouseX, 
-                                         this->mouseY,
-                                         triangleIndex,
-                                         depth);
+        if (rayCastFlag) {
+            getSurfaceTriangleFromRayCasting(surface,
+                                             triangleIndex,
+                                             depth);
+        }
+        else {
+            this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_TRIANGLE,
+                                             this->mouseX,
+                                             this->mouseY,
+                                             triangleIndex,
+                                             depth);
+        }
         
         
         if (triangleIndex >= 0) {
@@ -2340,7 +2364,6 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
         case MODE_IDENTIFICATION:
             if (nodeID->isEnabledForSelection()) {
                 isSelect = true;
-                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);            
             }
             else {
                 return;
@@ -2350,8 +2373,13 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
             break;
     }
     
-    uint8_t rgba[4];
-
+    /*
+     * Covered pixels of each node's point are computed
+     * instead of drawing the nodes in identification colors
+     */
+    const bool rayCastFlag = (isSelect
+                              && m_brain->getSelectionManager()->isSurfacePickingWithRayCastingEnabled());
+    
     float pointSize = dps->getNodeSize();
     if (isSelect) {
         if (pointSize < 2.0) {
@@ -2360,32 +2388,47 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
     }
     setPointSize(pointSize);
     
-    glBegin(GL_POINTS);
-    for (int32_t i = 0; i < numNodes; i++) {
-        const int32_t i3 = i * 3;
-        
+    if ( ! rayCastFlag) {
         if (isSelect) {
-            this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_NODE, i);
-            glColor3ubv(rgba);
-            glNormal3fv(&normals[i3]);
-            glVertex3fv(&coordinates[i3]);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         }
-        else {
-            glColor4fv(&nodeColoringRGBA[i*4]);
-            glNormal3fv(&normals[i3]);
-            glVertex3fv(&coordinates[i3]);
+        
+        uint8_t rgba[4];
+        
+        glBegin(GL_POINTS);
+        for (int32_t i = 0; i < numNodes; i++) {
+            const int32_t i3 = i * 3;
+            
+            if (isSelect) {
+                this->colorIdentification->addItem(rgba, SelectionItemDataTypeEnum::SURFACE_NODE, i);
+                glColor3ubv(rgba);
+                glNormal3fv(&normals[i3]);
+                glVertex3fv(&coordinates[i3]);
+            }
+            else {
+                glColor4fv(&nodeColoringRGBA[i*4]);
+                glNormal3fv(&normals[i3]);
+                glVertex3fv(&coordinates[i3]);
+            }
         }
+        glEnd();
     }
-    glEnd();
     
     if (isSelect) {
         int nodeIndex = -1;
         float depth = -1.0;
-        this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_NODE, 
-                                         this->mouseX, 
-                                         this->mouseY,
-                                         nodeIndex,
-                                         depth);
+        if (rayCastFlag) {
+            getSurfaceNodeFromPointCoverage(surface,
+                                            nodeIndex,
+                                            depth);
+        }
+        else {
+            this->getIndexFromColorSelection(SelectionItemDataTypeEnum::SURFACE_NODE,
+                                             this->mouseX,
+                                             this->mouseY,
+                                             nodeIndex,
+                                             depth);
+        }
         if (nodeIndex >= 0) {
             if (nodeID->isOtherScreenDepthCloserToViewer(depth)) {
                 nodeID->setBrain(surface->getBrainStructure()->getBrain());
@@ -2403,17 +2446,394 @@ BrainOpenGLFixedPipeline::drawSurfaceNodes(Surface* surface,
 }
 
 
+/**
+ * Find the matrix cell under the mouse without drawing.  The current
+ * transformations must place cells as 1.0 x 1.0 squares in the plane Z=0
+ * with the first column at X=0 and the first row at the top (Y equal to
+ * the number of rows).
+ *
+ * @param numberOfRows
+ *    Number of rows in the matrix.
+ * @param numberOfColumns
+ *    Number of columns in the matrix.
+ * @param rowIndexOut
+ *    Output with index of row under mouse.
+ * @param columnIndexOut
+ *    Output with index of column under mouse.
+ * @param depthOut
+ *    Output with window depth of the matrix, as would be read
+ *    from the depth buffer.
+ * @return
+ *    True if the mouse is over a cell, else false.
+ */
+bool
+BrainOpenGLFixedPipeline::getMatrixCellFromMouse(const int32_t numberOfRows,
+                                                 const int32_t numberOfColumns,
+                                                 int32_t& rowIndexOut,
+                                                 int32_t& columnIndexOut,
+                                                 float& depthOut)
+{
+    rowIndexOut    = -1;
+    columnIndexOut = -1;
+    depthOut       = -1.0;
+    
+    GLdouble modelviewMatrix[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelviewMatrix);
+    GLdouble projectionMatrix[16];
+    glGetDoublev(GL_PROJECTION_MATRIX, projectionMatrix);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    /*
+     * Intersect the ray through the center of the mouse pixel with Z=0
+     */
+    const double pixelCenterX = this->mouseX + 0.5;
+    const double pixelCenterY = this->mouseY + 0.5;
+    double nearXYZ[3], farXYZ[3];
+    if ( ! gluUnProject(pixelCenterX, pixelCenterY, 0.0,
+                        modelviewMatrix, projectionMatrix, viewport,
+                        &nearXYZ[0], &nearXYZ[1], &nearXYZ[2])) {
+        return false;
+    }
+    if ( ! gluUnProject(pixelCenterX, pixelCenterY, 1.0,
+                        modelviewMatrix, projectionMatrix, viewport,
+                        &farXYZ[0], &farXYZ[1], &farXYZ[2])) {
+        return false;
+    }
+    const double dz = farXYZ[2] - nearXYZ[2];
+    double x = nearXYZ[0];
+    double y = nearXYZ[1];
+    double depth = 0.0;
+    if (dz != 0.0) {
+        const double t = -nearXYZ[2] / dz;
+        if ((t < 0.0)
+            || (t > 1.0)) {
+            return false;
+        }
+        x += t * (farXYZ[0] - nearXYZ[0]);
+        y += t * (farXYZ[1] - nearXYZ[1]);
+        depth = t;
+    }
+    
+    if ((x < 0.0)
+        || (x >= numberOfColumns)
+        || (y < 0.0)
+        || (y >= numberOfRows)) {
+        return false;
+    }
+    
+    columnIndexOut = static_cast<int32_t>(x);
+    rowIndexOut    = numberOfRows - 1 - static_cast<int32_t>(y);
+    depthOut       = depth;
+    
+    return true;
+}
+
+/**
+ * Find the surface triangle under the mouse without drawing.  The ray
+ * through the center of the mouse pixel, from the near to the far
+ * clipping plane, is intersected with the surface's triangles.  The
+ * nearest intersection that is inside the clipping planes and not
+ * culled is the triangle that would be visible at the pixel.
+ *
+ * @param surface
+ *    Surface for identification.
+ * @param triangleIndexOut
+ *    Output with index of triangle, -1 if no triangle under mouse.
+ * @param depthOut
+ *    Output with window depth of intersection, as would be read
+ *    from the depth buffer.
+ */
+void
+BrainOpenGLFixedPipeline::getSurfaceTriangleFromRayCasting(const Surface* surface,
+                                                           int32_t& triangleIndexOut,
+                                                           float& depthOut)
+{
+    triangleIndexOut = -1;
+    depthOut = -1.0;
+    
+    GLdouble modelviewMatrix[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelviewMatrix);
+    GLdouble projectionMatrix[16];
+    glGetDoublev(GL_PROJECTION_MATRIX, projectionMatrix);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    const double pixelCenterX = this->mouseX + 0.5;
+    const double pixelCenterY = this->mouseY + 0.5;
+    double nearXYZ[3], farXYZ[3];
+    if ( ! gluUnProject(pixelCenterX, pixelCenterY, 0.0,
+                        modelviewMatrix, projectionMatrix, viewport,
+                        &nearXYZ[0], &nearXYZ[1], &nearXYZ[2])) {
+        return;
+    }
+    if ( ! gluUnProject(pixelCenterX, pixelCenterY, 1.0,
+                        modelviewMatrix, projectionMatrix, viewport,
+                        &farXYZ[0], &farXYZ[1], &farXYZ[2])) {
+        return;
+    }
+    const float rayStart[3] = { (float)nearXYZ[0], (float)nearXYZ[1], (float)nearXYZ[2] };
+    const float rayEnd[3]   = { (float)farXYZ[0],  (float)farXYZ[1],  (float)farXYZ[2]  };
+    
+    std::vector<SurfaceRayHelper::Hit> hits;
+    surface->getRayHelper()->getSegmentHits(rayStart, rayEnd, hits);
+    if (hits.empty()) {
+        return;
+    }
+    
+    const bool clippingFlag = m_clippingPlaneGroup->isSurfaceSelected();
+    const StructureEnum::Enum structure = surface->getStructure();
+    
+    const bool cullingFlag = (glIsEnabled(GL_CULL_FACE) == GL_TRUE);
+    GLint frontFace = GL_CCW;
+    glGetIntegerv(GL_FRONT_FACE, &frontFace);
+    GLint cullFaceMode = GL_BACK;
+    glGetIntegerv(GL_CULL_FACE_MODE, &cullFaceMode);
+    if (cullingFlag
+        && (cullFaceMode == GL_FRONT_AND_BACK)) {
+        return;
+    }
+    
+    /*
+     * Hits are sorted from nearest to farthest
+     */
+    for (std::vector<SurfaceRayHelper::Hit>::const_iterator iter = hits.begin();
+         iter != hits.end();
+         iter++) {
+        const SurfaceRayHelper::Hit& hit = *iter;
+        if (clippingFlag) {
+            if ( ! isCoordinateInsideClippingPlanesForStructure(structure, hit.point)) {
+                continue;
+            }
+        }
+        
+        if (cullingFlag) {
+            /*
+             * Facing is determined by the winding of the
+             * triangle in window coordinates
+             */
+            const int32_t* triangleNodes = surface->getTriangle(hit.triangle);
+            double windowXYZ[3][3];
+            for (int32_t j = 0; j < 3; j++) {
+                const float* xyz = surface->getCoordinate(triangleNodes[j]);
+                gluProject(xyz[0], xyz[1], xyz[2],
+                           modelviewMatrix, projectionMatrix, viewport,
+                           &windowXYZ[j][0], &windowXYZ[j][1], &windowXYZ[j][2]);
+            }
+            const double signedArea = (((windowXYZ[1][0] - windowXYZ[0][0]) * (windowXYZ[2][1] - windowXYZ[0][1]))
+                                       - ((windowXYZ[2][0] - windowXYZ[0][0]) * (windowXYZ[1][1] - windowXYZ[0][1])));
+            const bool counterClockwiseFlag = (signedArea > 0.0);
+            const bool frontFacingFlag = ((frontFace == GL_CCW)
+                                          ? counterClockwiseFlag
+                                          : ( ! counterClockwiseFlag));
+            if (frontFacingFlag == (cullFaceMode == GL_FRONT)) {
+                continue;
+            }
+        }
+        
+        double windowX, windowY, windowZ;
+        if (gluProject(hit.point[0], hit.point[1], hit.point[2],
+                       modelviewMatrix, projectionMatrix, viewport,
+                       &windowX, &windowY, &windowZ)) {
+            triangleIndexOut = hit.triangle;
+            depthOut = windowZ;
+        }
+        return;
+    }
+}
+
+/**
+ * Find the surface node under the mouse without drawing.  Each node
+ * is projected to the window and the pixels its point would cover,
+ * using the current point size, are compared to the mouse pixel.
+ * The nearest covering node is the one that would be visible at
+ * the pixel.
+ *
+ * @param surface
+ *    Surface for identification.
+ * @param nodeIndexOut
+ *    Output with index of node, -1 if no node under mouse.
+ * @param depthOut
+ *    Output with window depth of node, as would be read
+ *    from the depth buffer.
+ */
+void
+BrainOpenGLFixedPipeline::getSurfaceNodeFromPointCoverage(const Surface* surface,
+                                                          int32_t& nodeIndexOut,
+                                                          float& depthOut)
+{
+    nodeIndexOut = -1;
+    depthOut = -1.0;
+    
+    GLdouble modelviewMatrix[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelviewMatrix);
+    GLdouble projectionMatrix[16];
+    glGetDoublev(GL_PROJECTION_MATRIX, projectionMatrix);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLfloat pointSize = 1.0;
+    glGetFloatv(GL_POINT_SIZE, &pointSize);
+    
+    /*
+     * Points that are not antialiased are squares with an integer
+     * width.  Centers of odd width points are at pixel centers and
+     * centers of even width points are at pixel corners.
+     */
+    const int32_t pointWidth = std::max(1, static_cast<int32_t>(std::floor(pointSize + 0.5)));
+    const bool oddWidthFlag = ((pointWidth % 2) == 1);
+    const double halfWidth = pointWidth / 2.0;
+    const double pixelCenterX = this->mouseX + 0.5;
+    const double pixelCenterY = this->mouseY + 0.5;
+    
+    /*
+     * Projection times modelview transforms a coordinate to clip space
+     */
+    Matrix4x4 modelviewMatrix4x4;
+    modelviewMatrix4x4.setMatrixFromOpenGL(modelviewMatrix);
+    Matrix4x4 clipMatrix;
+    clipMatrix.setMatrixFromOpenGL(projectionMatrix);
+    clipMatrix.premultiply(modelviewMatrix4x4);
+    double m[4][4];
+    clipMatrix.getMatrix(m);
+    
+    const bool clippingFlag = m_clippingPlaneGroup->isSurfaceSelected();
+    const StructureEnum::Enum structure = surface->getStructure();
+    
+    const int32_t numNodes = surface->getNumberOfNodes();
+    const float* coordinates = surface->getCoordinate(0);
+    double nearestDepth = std::numeric_limits<double>::max();
+    for (int32_t i = 0; i < numNodes; i++) {
+        const float* xyz = &coordinates[i * 3];
+        double clip[4];
+        for (int32_t r = 0; r < 4; r++) {
+            clip[r] = (m[r][0] * xyz[0]) + (m[r][1] * xyz[1]) + (m[r][2] * xyz[2]) + m[r][3];
+        }
+        
+        /*
+         * A point is drawn only if its vertex is inside the view volume
+         */
+        const double w = clip[3];
+        if (w <= 0.0) {
+            continue;
+        }
+        if ((clip[0] < -w) || (clip[0] > w)
+            || (clip[1] < -w) || (clip[1] > w)
+            || (clip[2] < -w) || (clip[2] > w)) {
+            continue;
+        }
+        
+        const double windowX = viewport[0] + ((clip[0] / w) + 1.0) * viewport[2] / 2.0;
+        const double windowY = viewport[1] + ((clip[1] / w) + 1.0) * viewport[3] / 2.0;
+        const double windowZ = ((clip[2] / w) + 1.0) / 2.0;
+        
+        const double centerX = (oddWidthFlag
+                                ? (std::floor(windowX) + 0.5)
+                                : std::floor(windowX + 0.5));
+        const double centerY = (oddWidthFlag
+                                ? (std::floor(windowY) + 0.5)
+                                : std::floor(windowY + 0.5));
+        if ((std::fabs(pixelCenterX - centerX) >= halfWidth)
+            || (std::fabs(pixelCenterY - centerY) >= halfWidth)) {
+            continue;
+        }
+        
+        /*
+         * With equal depth, the first node drawn passes the depth test
+         */
+        if (windowZ < nearestDepth) {
+            if (clippingFlag) {
+                if ( ! isCoordinateInsideClippingPlanesForStructure(structure, xyz)) {
+                    continue;
+                }
+            }
+            nearestDepth = windowZ;
+            nodeIndexOut = i;
+        }
+    }
+    
+    if (nodeIndexOut >= 0) {
+        depthOut = nearestDepth;
+    }
+}
+
 /**
  * Draw a surface triangles with vertex arrays.
+ *
+ * The coordinates, normals, and triangles are kept in buffers owned by
+ * the surface and are shared by all tabs and windows.  Each coloring has
+ * its own buffer that is only reloaded when the coloring is changed.
+ * Colorings that are not owned by the surface are drawn from client memory.
+ *
  * @param surface
  *    Surface that is drawn.
  * @param nodeColoringRGBA
  *    RGBA coloring for the nodes.
+ * @param levelOfDetailFlag
+ *    If true, fewer triangles may be drawn when the surface is small
+ *    in the window.
  */
 void 
 BrainOpenGLFixedPipeline::drawSurfaceTrianglesWithVertexArrays(const Surface* surface,
-                                                               const float* nodeColoringRGBA)
+                                                               const float* nodeColoringRGBA,
+                                                               const bool levelOfDetailFlag)
 {
+    const int32_t numberOfNodes = surface->getNumberOfNodes();
+    const int32_t numberOfTriangles = surface->getNumberOfTriangles();
+    if ((numberOfNodes <= 0)
+        || (numberOfTriangles <= 0)) {
+        return;
+    }
+    
+    /*
+     * Decimated triangles use the surface's vertices
+     * so coordinates, normals, and coloring are unchanged
+     */
+    CaretPointer<const SurfaceDecimationHelper> decimationHelper;
+    int32_t levelOfDetail = 0;
+    if (levelOfDetailFlag) {
+        levelOfDetail = getSurfaceLevelOfDetail(surface,
+                                                decimationHelper);
+    }
+    
+    uint64_t colorModificationCounter = 0;
+    const int32_t colorIdentifier = surface->getNodeColoringRgbaIdentifier(nodeColoringRGBA,
+                                                                           colorModificationCounter);
+    if ((nodeColoringRGBA == NULL)
+        || (colorIdentifier >= 0)) {
+        GraphicsEngineDataOpenGLMesh* meshData = dynamic_cast<GraphicsEngineDataOpenGLMesh*>(surface->getGraphicsEngineDataForOpenGL());
+        if (meshData == NULL) {
+            meshData = new GraphicsEngineDataOpenGLMesh();
+            surface->setGraphicsEngineDataForOpenGL(meshData);
+        }
+        
+        meshData->updateGeometry(surface->getGeometryModificationCounter(),
+                                 numberOfNodes,
+                                 surface->getCoordinateData(),
+                                 surface->getNormalData(),
+                                 numberOfTriangles,
+                                 surface->getTriangle(0));
+        if (nodeColoringRGBA != NULL) {
+            meshData->updateColors(colorIdentifier,
+                                   colorModificationCounter,
+                                   nodeColoringRGBA);
+        }
+        else {
+            glColor3fv(m_backgroundColorFloat);
+        }
+        
+        if (levelOfDetail > 0) {
+            if ( ! meshData->hasLevelOfDetail(levelOfDetail)) {
+                meshData->updateLevelOfDetail(levelOfDetail,
+                                              decimationHelper->getLevelNumberOfTriangles(levelOfDetail - 1),
+                                              decimationHelper->getLevelTriangles(levelOfDetail - 1));
+            }
+        }
+        
+        meshData->draw(colorIdentifier,
+                       levelOfDetail);
+        return;
+    }
+    
     glEnableClientState(GL_VERTEX_ARRAY);
     if (nodeColoringRGBA != NULL) {
         glEnableClientState(GL_COLOR_ARRAY);
@@ -2436,17 +2856,124 @@ BrainOpenGLFixedPipeline::drawSurfaceTrianglesWithVertexArrays(const Surface* su
                     0, 
                     reinterpret_cast<const GLvoid*>(surface->getNormalVector(0)));
     
-    const int numTriangles = surface->getNumberOfTriangles();
+    int32_t numTriangles = surface->getNumberOfTriangles();
+    const int32_t* triangles = surface->getTriangle(0);
+    if (levelOfDetail > 0) {
+        numTriangles = decimationHelper->getLevelNumberOfTriangles(levelOfDetail - 1);
+        triangles    = decimationHelper->getLevelTriangles(levelOfDetail - 1);
+    }
     glDrawElements(GL_TRIANGLES, 
                    (3 * numTriangles), 
                    GL_UNSIGNED_INT,
-                   reinterpret_cast<const GLvoid*>(surface->getTriangle(0)));
+                   reinterpret_cast<const GLvoid*>(triangles));
     
     glDisableClientState(GL_VERTEX_ARRAY);
     glDisableClientState(GL_COLOR_ARRAY);
     glDisableClientState(GL_NORMAL_ARRAY);
 }
 
+/**
+ * Get the level of detail for drawing a surface's triangles.  The
+ * coarsest decimated level that still has a few triangles for each
+ * pixel covered by the surface's bounding box in the window is used,
+ * so small views, such as the viewports of a montage, draw far fewer
+ * triangles with no visible difference.  Decimated levels are built
+ * on a separate thread when one is first needed, and all triangles
+ * are drawn until the levels are finished.
+ *
+ * @param surface
+ *    Surface that is drawn.
+ * @param decimationHelperOut
+ *    Output with the surface's decimation helper if the
+ *    level of detail is greater than zero.
+ * @return
+ *    Zero to draw all triangles, otherwise one plus the
+ *    level in the decimation helper.
+ */
+int32_t
+BrainOpenGLFixedPipeline::getSurfaceLevelOfDetail(const Surface* surface,
+                                                  CaretPointer<const SurfaceDecimationHelper>& decimationHelperOut)
+{
+    const int32_t numberOfTriangles = surface->getNumberOfTriangles();
+    if (numberOfTriangles < (SurfaceDecimationHelper::MIN_LEVEL_TRIANGLES
+                             * SurfaceDecimationHelper::LEVEL_REDUCTION)) {
+        return 0;
+    }
+    
+    GLdouble modelviewMatrix[16];
+    glGetDoublev(GL_MODELVIEW_MATRIX, modelviewMatrix);
+    GLdouble projectionMatrix[16];
+    glGetDoublev(GL_PROJECTION_MATRIX, projectionMatrix);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    
+    /*
+     * Window extent of the bounding box
+     */
+    float bounds[6];
+    surface->getBoundingBox()->getBounds(bounds);
+    double windowMinX = std::numeric_limits<double>::max();
+    double windowMaxX = -std::numeric_limits<double>::max();
+    double windowMinY = std::numeric_limits<double>::max();
+    double windowMaxY = -std::numeric_limits<double>::max();
+    for (int32_t i = 0; i < 8; i++) {
+        const double xyz[3] = {
+            ((i & 1) ? bounds[1] : bounds[0]),
+            ((i & 2) ? bounds[3] : bounds[2]),
+            ((i & 4) ? bounds[5] : bounds[4])
+        };
+        double windowXYZ[3];
+        if ( ! gluProject(xyz[0], xyz[1], xyz[2],
+                          modelviewMatrix, projectionMatrix, viewport,
+                          &windowXYZ[0], &windowXYZ[1], &windowXYZ[2])) {
+            return 0;
+        }
+        if ((windowXYZ[2] < 0.0)
+            || (windowXYZ[2] > 1.0)) {
+            /*
+             * Corner is clipped, possibly behind the viewer, so
+             * its window position does not bound the surface
+             */
+            return 0;
+        }
+        windowMinX = std::min(windowMinX, windowXYZ[0]);
+        windowMaxX = std::max(windowMaxX, windowXYZ[0]);
+        windowMinY = std::min(windowMinY, windowXYZ[1]);
+        windowMaxY = std::max(windowMaxY, windowXYZ[1]);
+    }
+    windowMinX = std::max(windowMinX, static_cast<double>(viewport[0]));
+    windowMaxX = std::min(windowMaxX, static_cast<double>(viewport[0] + viewport[2]));
+    windowMinY = std::max(windowMinY, static_cast<double>(viewport[1]));
+    windowMaxY = std::min(windowMaxY, static_cast<double>(viewport[1] + viewport[3]));
+    const double pixelArea = (std::max(windowMaxX - windowMinX, 1.0)
+                              * std::max(windowMaxY - windowMinY, 1.0));
+    
+    /*
+     * About half of the triangles face away from the viewer
+     * and the surface does not fill its bounding box
+     */
+    const double trianglesPerPixel = 2.0;
+    const double minimumNumberOfTriangles = pixelArea * trianglesPerPixel;
+    if (numberOfTriangles <= (minimumNumberOfTriangles * SurfaceDecimationHelper::LEVEL_REDUCTION)) {
+        return 0;
+    }
+    
+    decimationHelperOut = surface->getDecimationHelper();
+    if (decimationHelperOut == NULL) {
+        return 0;
+    }
+    int32_t levelOfDetail = 0;
+    const int32_t numberOfLevels = decimationHelperOut->getNumberOfLevels();
+    for (int32_t i = 0; i < numberOfLevels; i++) {
+        if (decimationHelperOut->getLevelNumberOfTriangles(i) < minimumNumberOfTriangles) {
+            break;
+        }
+        levelOfDetail = i + 1;
+    }
+    
+    return levelOfDetail;
+}
+
 /**
  * Draw a surface's normal vectors.
  * @param surface
@@ -4179,6 +4706,13 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
         sortFiberOrientationsByDepth();
     }
     
+    /*
+     * Cones for fans are drawn after all fibers are processed with
+     * one draw call instead of one draw call for each cone
+     */
+    std::vector<float> coneMatrices;
+    std::vector<uint8_t> coneRGBA;
+    
     for (std::list<FiberOrientation*>::const_iterator iter = m_fiberOrientationsForDrawing.begin();
          iter != m_fiberOrientationsForDrawing.end();
          iter++) {
@@ -4379,33 +4913,48 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
                                                           * fodi->fanMultiplier),
                                                          vectorLength);
                         
+                        /*
+                         * Matrix4x4 operations are applied after the current
+                         * transform so they are in the reverse order of the
+                         * equivalent glTranslate/glRotate/glScale calls.
+                         */
+                        const uint8_t fiberRGBAByte[4] = {
+                            static_cast<uint8_t>(fiberRGBA[0] * 255.0),
+                            static_cast<uint8_t>(fiberRGBA[1] * 255.0),
+                            static_cast<uint8_t>(fiberRGBA[2] * 255.0),
+                            static_cast<uint8_t>(fiberRGBA[3] * 255.0)
+                        };
+                        float coneMatrix[16];
+                        
                         /*
                          * First cone
                          */
-                        glPushMatrix();
-                        glTranslatef(startXYZ[0], startXYZ[1], startXYZ[2]);
-                        glRotatef(-fiber->m_phi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glRotatef(-fiber->m_theta * radiansToDegrees, 0.0, 1.0, 0.0);
-                        glRotatef(-fiber->m_psi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glScalef(majorAxis * 2.0,
-                                 minorAxis * 2.0,
-                                 vectorLength);
-                        m_shapeCone->draw(fiberRGBA);
-                        glPopMatrix();
+                        Matrix4x4 firstConeMatrix;
+                        firstConeMatrix.scale(majorAxis * 2.0,
+                                              minorAxis * 2.0,
+                                              vectorLength);
+                        firstConeMatrix.rotateZ(-fiber->m_psi * radiansToDegrees);
+                        firstConeMatrix.rotateY(-fiber->m_theta * radiansToDegrees);
+                        firstConeMatrix.rotateZ(-fiber->m_phi * radiansToDegrees);
+                        firstConeMatrix.translate(startXYZ[0], startXYZ[1], startXYZ[2]);
+                        firstConeMatrix.getMatrixForOpenGL(coneMatrix);
+                        coneMatrices.insert(coneMatrices.end(), coneMatrix, coneMatrix + 16);
+                        coneRGBA.insert(coneRGBA.end(), fiberRGBAByte, fiberRGBAByte + 4);
                         
                         /*
                          * Second cone but pointing in opposite direction
                          */
-                        glPushMatrix();
-                        glTranslatef(startXYZ[0], startXYZ[1], startXYZ[2]);
-                        glRotatef(-fiber->m_phi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glRotatef(180.0 -fiber->m_theta * radiansToDegrees, 0.0, 1.0, 0.0);
-                        glRotatef(fiber->m_psi * radiansToDegrees, 0.0, 0.0, 1.0);
-                        glScalef(majorAxis * 2.0,
-                                 minorAxis * 2.0,
-                                 vectorLength);
-                        m_shapeCone->draw(fiberRGBA);
-                        glPopMatrix();
+                        Matrix4x4 secondConeMatrix;
+                        secondConeMatrix.scale(majorAxis * 2.0,
+                                               minorAxis * 2.0,
+                                               vectorLength);
+                        secondConeMatrix.rotateZ(fiber->m_psi * radiansToDegrees);
+                        secondConeMatrix.rotateY(180.0 - fiber->m_theta * radiansToDegrees);
+                        secondConeMatrix.rotateZ(-fiber->m_phi * radiansToDegrees);
+                        secondConeMatrix.translate(startXYZ[0], startXYZ[1], startXYZ[2]);
+                        secondConeMatrix.getMatrixForOpenGL(coneMatrix);
+                        coneMatrices.insert(coneMatrices.end(), coneMatrix, coneMatrix + 16);
+                        coneRGBA.insert(coneRGBA.end(), fiberRGBAByte, fiberRGBAByte + 4);
                         
                     }
                         break;
@@ -4424,6 +4973,13 @@ BrainOpenGLFixedPipeline::drawAllFiberOrientations(const FiberOrientationDisplay
         }
     }
     
+    /*
+     * Draw the cones in the same order as the fibers (furthest to
+     * nearest when sorted) so that alpha blending is unchanged
+     */
+    m_shapeCone->drawInstances(coneMatrices,
+                               coneRGBA);
+    
     /*
      * Now clear the list of fiber orientations for drawing.
      */
@@ -52,6 +52,7 @@ namespace caret {
     class BrainOpenGLShapeCylinder;
     class BrainOpenGLShapeRing;
     class BrainOpenGLShapeSphere;
+    class BrainOpenGLVolumeSliceTextureCache;
     class BrainOpenGLViewportContent;
     class BrowserTabContent;
     class CaretMappableDataFile;
@@ -65,6 +66,7 @@ namespace caret {
     class ImageFile;
     class Plane;
     class Surface;
+    class SurfaceDecimationHelper;
     class Model;
     class ModelChart;
     class ModelChartTwo;
@@ -203,11 +205,23 @@ namespace caret {
                               const float* nodeColoringRGBA);
         
         void drawSurfaceTrianglesWithVertexArrays(const Surface* surface,
-                                                  const float* nodeColoringRGBA);
+                                                  const float* nodeColoringRGBA,
+                                                  const bool levelOfDetailFlag);
+        
+        int32_t getSurfaceLevelOfDetail(const Surface* surface,
+                                        CaretPointer<const SurfaceDecimationHelper>& decimationHelperOut);
         
         void drawSurfaceTriangles(Surface* surface,
                                   const float* nodeColoringRGBA);
         
+        void getSurfaceTriangleFromRayCasting(const Surface* surface,
+                                              int32_t& triangleIndexOut,
+                                              float& depthOut);
+        
+        void getSurfaceNodeFromPointCoverage(const Surface* surface,
+                                             int32_t& nodeIndexOut,
+                                             float& depthOut);
+        
         void drawSurfaceNodeAttributes(Surface* surface);
         
         void drawSurfaceBorderBeingDrawn(const Surface* surface);
@@ -365,6 +379,12 @@ namespace caret {
                                         int32_t& index3Out,
                                         float& depthOut);
         
+        bool getMatrixCellFromMouse(const int32_t numberOfRows,
+                                    const int32_t numberOfColumns,
+                                    int32_t& rowIndexOut,
+                                    int32_t& columnIndexOut,
+                                    float& depthOut);
+        
         void setSelectedItemScreenXYZ(SelectionItem* item,
                                         const float itemXYZ[3]);
 
@@ -594,6 +614,9 @@ namespace caret {
         
         CaretPointer<BrainOpenGLAnnotationDrawingFixedPipeline> m_annotationDrawing;
         
+        /** Textures of volume slices kept between redraws */
+        CaretPointer<BrainOpenGLVolumeSliceTextureCache> m_volumeSliceTextureCache;
+        
         std::vector<AnnotationColorBar*> m_annotationColorBarsForDrawing;
         
         /** Some graphics using annotations for some elements so user can select and edit them */
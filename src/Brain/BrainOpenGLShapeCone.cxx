@@ -26,6 +26,8 @@
 #undef __BRAIN_OPEN_GL_SHAPE_CONE_DECLARE__
 
 #include "CaretAssert.h"
+#include "GraphicsPrimitiveV3fN3f.h"
+#include "GraphicsShape.h"
 #include "MathFunctions.h"
 
 using namespace caret;
@@ -238,6 +240,66 @@ BrainOpenGLShapeCone::~BrainOpenGLShapeCone()
     
 }
 
+/**
+ * Draw many cones with one draw call for each batch of cones
+ * instead of one draw call per cone.
+ *
+ * @param matrices
+ *     Transformation matrix for each cone in OpenGL (column-major)
+ *     order, as used by glMultMatrixf (16 elements per cone).
+ * @param rgba
+ *     RGBA coloring ranging 0 to 255 for each cone (4 elements per cone).
+ */
+void
+BrainOpenGLShapeCone::drawInstances(const std::vector<float>& matrices,
+                                    const std::vector<uint8_t>& rgba)
+{
+    const int32_t numberOfCones = static_cast<int32_t>(matrices.size() / 16);
+    if (numberOfCones <= 0) {
+        return;
+    }
+    CaretAssert(rgba.size() == (matrices.size() / 4));
+    
+    if ( ! m_instanceTrianglesPrimitive) {
+        /*
+         * Convert the side and cap triangle fans to triangles
+         * so that cones can be combined into one primitive
+         */
+        const uint8_t rgbaUnused[4] = { 0, 0, 0, 255 };
+        m_instanceTrianglesPrimitive.reset(GraphicsPrimitive::newPrimitiveV3fN3f(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES,
+                                                                                 rgbaUnused));
+        
+        const int32_t numSideVertices = static_cast<int32_t>(m_sidesTriangleFan.size());
+        for (int32_t j = 2; j < numSideVertices; j++) {
+            const int32_t fanIndices[3] = { 0, j - 1, j };
+            for (int32_t k = 0; k < 3; k++) {
+                const int32_t vertexIndex = m_sidesTriangleFan[fanIndices[k]] * 3;
+                CaretAssertVectorIndex(m_sideNormals, vertexIndex+2);
+                CaretAssertVectorIndex(m_coordinates, vertexIndex+2);
+                m_instanceTrianglesPrimitive->addVertex(&m_coordinates[vertexIndex],
+                                                        &m_sideNormals[vertexIndex]);
+            }
+        }
+        
+        const int32_t numCapVertices = static_cast<int32_t>(m_capTriangleFan.size());
+        for (int32_t j = 2; j < numCapVertices; j++) {
+            const int32_t fanIndices[3] = { 0, j - 1, j };
+            for (int32_t k = 0; k < 3; k++) {
+                const int32_t vertexIndex = m_capTriangleFan[fanIndices[k]] * 3;
+                CaretAssertVectorIndex(m_capNormals, vertexIndex+2);
+                CaretAssertVectorIndex(m_coordinates, vertexIndex+2);
+                m_instanceTrianglesPrimitive->addVertex(&m_coordinates[vertexIndex],
+                                                        &m_capNormals[vertexIndex]);
+            }
+        }
+    }
+    
+    GraphicsShape::drawInstancesByteColors(m_instanceTrianglesPrimitive.get(),
+                                           &matrices[0],
+                                           &rgba[0],
+                                           numberOfCones);
+}
+
 void
 BrainOpenGLShapeCone::setupOpenGLForShape(const BrainOpenGL::DrawMode drawMode)
 {
@@ -21,12 +21,15 @@
  */
 /*LICENSE_END*/
 
+#include <memory>
 #include <stdint.h>
 
 #include "BrainOpenGLShape.h"
 
 namespace caret {
 
+    class GraphicsPrimitiveV3fN3f;
+    
     class BrainOpenGLShapeCone : public BrainOpenGLShape {
         
     public:
@@ -40,6 +43,8 @@ namespace caret {
         BrainOpenGLShapeCone& operator=(const BrainOpenGLShapeCone&);
         
     public:
+        void drawInstances(const std::vector<float>& matrices,
+                           const std::vector<uint8_t>& rgba);
 
         // ADD_NEW_METHODS_HERE
 
@@ -80,6 +85,8 @@ namespace caret {
         std::vector<GLfloat> m_capNormals;
         
         bool m_isApplyColoring;
+        
+        std::unique_ptr<GraphicsPrimitiveV3fN3f> m_instanceTrianglesPrimitive;
     };
     
 #ifdef __BRAIN_OPEN_GL_SHAPE_CONE_DECLARE__
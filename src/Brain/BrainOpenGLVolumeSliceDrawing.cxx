@@ -33,6 +33,7 @@
 #include "BrainOpenGLAnnotationDrawingFixedPipeline.h"
 #include "BrainOpenGLPrimitiveDrawing.h"
 #include "BrainOpenGLViewportContent.h"
+#include "BrainOpenGLVolumeSliceTextureCache.h"
 #include "BrainordinateRegionOfInterest.h"
 #include "BrowserTabContent.h"
 #include "CaretAssert.h"
@@ -4659,7 +4660,26 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceVoxels(const float sliceNormal
     }
     
     /*
-     * There are two ways to draw the voxels.
+     * Unless identifying, draw the slice as a texture, so that
+     * a single quad is drawn no matter how many voxels are in the slice.
+     */
+    if ( ! m_identificationModeFlag) {
+        if (drawOrthogonalSliceVoxelsTexture(sliceNormalVector,
+                                             coordinate,
+                                             rowStep,
+                                             columnStep,
+                                             numberOfColumns,
+                                             numberOfRows,
+                                             sliceRGBA,
+                                             volumeInterface,
+                                             mapIndex,
+                                             sliceOpacity)) {
+            return;
+        }
+    }
+    
+    /*
+     * There are two ways to draw the voxels with quads.
      *
      * Quad Indices: This method submits each vertex (coordinate, normal, rgba)
      * one time BUT it submits EVERY vertex in the slice.  Note that the vertex
@@ -4733,6 +4753,130 @@ BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceVoxels(const float sliceNormal
     
 }
 
+/**
+ * Draw the voxels in an orthogonal slice as a single textured quad.
+ *
+ * The slice coloring is in a texture with nearest filtering so that
+ * each voxel is one texel, and one quadrilateral covering the slice is
+ * drawn.  The texture is kept between redraws by the volume slice texture
+ * cache and is only reloaded when the coloring of the slice changes.
+ * Alpha testing discards voxels that are not displayed so that, as with
+ * the quad drawing, they do not affect the depth buffer.  The number of
+ * vertices no longer depends upon the number of voxels, which matters
+ * most for high resolution volumes and montage views.
+ *
+ * Identification requires the quad drawing, since each voxel must
+ * be drawn with its own identification color.
+ *
+ * @param sliceNormalVector
+ *    Normal vector of the slice plane.
+ * @param coordinate
+ *    Coordinate of first voxel in the slice (bottom left as begin viewed)
+ * @param rowStep
+ *    Three-dimensional step to next row.
+ * @param columnStep
+ *    Three-dimensional step to next column.
+ * @param numberOfColumns
+ *    Number of columns in the slice.
+ * @param numberOfRows
+ *    Number of rows in the slice.
+ * @param sliceRGBA
+ *    RGBA coloring for voxels in the slice.
+ * @param volumeInterface
+ *    Volume being drawn.
+ * @param mapIndex
+ *    Selected map in the volume being drawn.
+ * @param sliceOpacity
+ *    Opacity from the overlay.
+ * @return
+ *    True if the slice was drawn, false if the slice is too large for
+ *    a texture and must be drawn with quads.
+ */
+bool
+BrainOpenGLVolumeSliceDrawing::drawOrthogonalSliceVoxelsTexture(const float sliceNormalVector[3],
+                                                                const float coordinate[3],
+                                                                const float rowStep[3],
+                                                                const float columnStep[3],
+                                                                const int64_t numberOfColumns,
+                                                                const int64_t numberOfRows,
+                                                                const std::vector<uint8_t>& sliceRGBA,
+                                                                const VolumeMappableInterface* volumeInterface,
+                                                                const int32_t mapIndex,
+                                                                const uint8_t sliceOpacity)
+{
+    CaretAssert(m_fixedPipelineDrawing->m_volumeSliceTextureCache);
+    
+    glPushAttrib(GL_ENABLE_BIT
+                 | GL_TEXTURE_BIT
+                 | GL_COLOR_BUFFER_BIT
+                 | GL_CURRENT_BIT);
+    
+    int64_t textureWidth  = 0;
+    int64_t textureHeight = 0;
+    if ( ! m_fixedPipelineDrawing->m_volumeSliceTextureCache->bindSliceTexture(m_fixedPipelineDrawing->getContextSharingGroupPointer(),
+                                                                               volumeInterface,
+                                                                               mapIndex,
+                                                                               coordinate,
+                                                                               numberOfColumns,
+                                                                               numberOfRows,
+                                                                               sliceRGBA,
+                                                                               sliceOpacity,
+                                                                               textureWidth,
+                                                                               textureHeight)) {
+        glPopAttrib();
+        return false;
+    }
+    
+    /*
+     * Modulate with white so that lighting, if enabled,
+     * affects the voxels as it does with colored quads
+     */
+    glEnable(GL_TEXTURE_2D);
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.0f);
+    glColor4ub(255, 255, 255, 255);
+    glNormal3fv(sliceNormalVector);
+    
+    const float maxS = static_cast<float>(numberOfColumns) / textureWidth;
+    const float maxT = static_cast<float>(numberOfRows) / textureHeight;
+    const float sliceWidthXYZ[3] = {
+        columnStep[0] * numberOfColumns,
+        columnStep[1] * numberOfColumns,
+        columnStep[2] * numberOfColumns
+    };
+    const float sliceHeightXYZ[3] = {
+        rowStep[0] * numberOfRows,
+        rowStep[1] * numberOfRows,
+        rowStep[2] * numberOfRows
+    };
+    
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f);
+    glVertex3f(coordinate[0],
+               coordinate[1],
+               coordinate[2]);
+    glTexCoord2f(maxS, 0.0f);
+    glVertex3f(coordinate[0] + sliceWidthXYZ[0],
+               coordinate[1] + sliceWidthXYZ[1],
+               coordinate[2] + sliceWidthXYZ[2]);
+    glTexCoord2f(maxS, maxT);
+    glVertex3f(coordinate[0] + sliceWidthXYZ[0] + sliceHeightXYZ[0],
+               coordinate[1] + sliceWidthXYZ[1] + sliceHeightXYZ[1],
+               coordinate[2] + sliceWidthXYZ[2] + sliceHeightXYZ[2]);
+    glTexCoord2f(0.0f, maxT);
+    glVertex3f(coordinate[0] + sliceHeightXYZ[0],
+               coordinate[1] + sliceHeightXYZ[1],
+               coordinate[2] + sliceHeightXYZ[2]);
+    glEnd();
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    glPopAttrib();
+    
+    return true;
+}
+
 /**
  * Draw the voxels in an orthogonal slice with single quads.
  *
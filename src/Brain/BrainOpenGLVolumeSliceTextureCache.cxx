@@ -0,0 +1,307 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cstring>
+
+#define __BRAIN_OPEN_GL_VOLUME_SLICE_TEXTURE_CACHE_DECLARE__
+#include "BrainOpenGLVolumeSliceTextureCache.h"
+#undef __BRAIN_OPEN_GL_VOLUME_SLICE_TEXTURE_CACHE_DECLARE__
+
+#include "CaretAssert.h"
+#include "CaretOpenGLInclude.h"
+#include "EventGraphicsOpenGLCreateTextureName.h"
+#include "EventManager.h"
+#include "GraphicsOpenGLTextureName.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::BrainOpenGLVolumeSliceTextureCache
+ * \brief Keeps textures of orthogonal volume slices between redraws.
+ * \ingroup Brain
+ *
+ * A texture is kept for each slice of each map that is drawn, identified
+ * by the volume, map, and position of the slice.  The coloring loaded into
+ * a texture is kept with it, and the texture is reloaded only when the
+ * coloring of the slice differs.  So any change that affects the slice
+ * coloring (map data, palette, thresholding, label selection, opacity)
+ * updates the texture while redraws that do not change the coloring
+ * (rotating, panning, drawing other tabs or montage slices) reuse it.
+ *
+ * Least recently used textures are removed when the slice coloring kept
+ * for all textures exceeds a fixed size.
+ */
+
+/**
+ * Constructor.
+ */
+BrainOpenGLVolumeSliceTextureCache::BrainOpenGLVolumeSliceTextureCache()
+: CaretObject()
+{
+
+}
+
+/**
+ * Destructor.
+ */
+BrainOpenGLVolumeSliceTextureCache::~BrainOpenGLVolumeSliceTextureCache()
+{
+    clear();
+}
+
+/**
+ * Remove all of the slice textures.
+ */
+void
+BrainOpenGLVolumeSliceTextureCache::clear()
+{
+    for (std::list<SliceTexture*>::iterator iter = m_sliceTextures.begin();
+         iter != m_sliceTextures.end();
+         iter++) {
+        delete *iter;
+    }
+    m_sliceTextures.clear();
+    m_numberOfBytesInSlices = 0;
+}
+
+/**
+ * Bind the texture containing a slice, creating or reloading the texture
+ * if the coloring of the slice has changed since the texture was loaded.
+ * The slice is in the bottom left corner of the texture, whose dimensions
+ * are powers of two so that this works with any version of OpenGL.
+ *
+ * @param openglContextPointer
+ *    Pointer to the current OpenGL context sharing group.
+ * @param volume
+ *    Volume containing the slice.
+ * @param mapIndex
+ *    Index of map in the volume.
+ * @param firstVoxelXYZ
+ *    Coordinate of first voxel in the slice.
+ * @param numberOfColumns
+ *    Number of columns in the slice.
+ * @param numberOfRows
+ *    Number of rows in the slice.
+ * @param sliceRGBA
+ *    RGBA coloring for voxels in the slice.
+ * @param sliceOpacity
+ *    Opacity from the overlay used for voxels that are displayed.
+ * @param textureWidthOut
+ *    Output with width of the texture.
+ * @param textureHeightOut
+ *    Output with height of the texture.
+ * @return
+ *    True if the texture is bound, false if the slice is larger
+ *    than the maximum texture size.
+ */
+bool
+BrainOpenGLVolumeSliceTextureCache::bindSliceTexture(void* openglContextPointer,
+                                                     const VolumeMappableInterface* volume,
+                                                     const int32_t mapIndex,
+                                                     const float firstVoxelXYZ[3],
+                                                     const int64_t numberOfColumns,
+                                                     const int64_t numberOfRows,
+                                                     const std::vector<uint8_t>& sliceRGBA,
+                                                     const uint8_t sliceOpacity,
+                                                     int64_t& textureWidthOut,
+                                                     int64_t& textureHeightOut)
+{
+    const int64_t numberOfSliceBytes = numberOfColumns * numberOfRows * 4;
+    CaretAssert(static_cast<int64_t>(sliceRGBA.size()) >= numberOfSliceBytes);
+
+    SliceTexture* sliceTexture = NULL;
+    for (std::list<SliceTexture*>::iterator iter = m_sliceTextures.begin();
+         iter != m_sliceTextures.end();
+         iter++) {
+        SliceTexture* st = *iter;
+        if ((st->m_openglContextPointer == openglContextPointer)
+            && (st->m_volume == volume)
+            && (st->m_mapIndex == mapIndex)
+            && (st->m_numberOfColumns == numberOfColumns)
+            && (st->m_numberOfRows == numberOfRows)
+            && (st->m_firstVoxelXYZ[0] == firstVoxelXYZ[0])
+            && (st->m_firstVoxelXYZ[1] == firstVoxelXYZ[1])
+            && (st->m_firstVoxelXYZ[2] == firstVoxelXYZ[2])) {
+            sliceTexture = st;
+
+            /*
+             * Most recently used is first
+             */
+            m_sliceTextures.erase(iter);
+            m_sliceTextures.push_front(sliceTexture);
+            break;
+        }
+    }
+
+    if (sliceTexture == NULL) {
+        GLint maximumTextureSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maximumTextureSize);
+
+        int64_t textureWidth = 1;
+        while (textureWidth < numberOfColumns) {
+            textureWidth *= 2;
+        }
+        int64_t textureHeight = 1;
+        while (textureHeight < numberOfRows) {
+            textureHeight *= 2;
+        }
+        if ((textureWidth > maximumTextureSize)
+            || (textureHeight > maximumTextureSize)) {
+            return false;
+        }
+
+        EventGraphicsOpenGLCreateTextureName createEvent;
+        EventManager::get()->sendEvent(createEvent.getPointer());
+        GraphicsOpenGLTextureName* textureName = createEvent.getOpenGLTextureName();
+        if (textureName == NULL) {
+            return false;
+        }
+
+        sliceTexture = new SliceTexture();
+        sliceTexture->m_openglContextPointer = openglContextPointer;
+        sliceTexture->m_volume = volume;
+        sliceTexture->m_mapIndex = mapIndex;
+        sliceTexture->m_firstVoxelXYZ[0] = firstVoxelXYZ[0];
+        sliceTexture->m_firstVoxelXYZ[1] = firstVoxelXYZ[1];
+        sliceTexture->m_firstVoxelXYZ[2] = firstVoxelXYZ[2];
+        sliceTexture->m_numberOfColumns = numberOfColumns;
+        sliceTexture->m_numberOfRows = numberOfRows;
+        sliceTexture->m_textureWidth = textureWidth;
+        sliceTexture->m_textureHeight = textureHeight;
+        sliceTexture->m_textureName.reset(textureName);
+
+        /*
+         * Storage for the texture is allocated once with the padding
+         * transparent since the edge of the slice may sample it
+         */
+        glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glBindTexture(GL_TEXTURE_2D, textureName->getTextureName());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        std::vector<uint8_t> transparentRGBA(textureWidth * textureHeight * 4, 0);
+        glTexImage2D(GL_TEXTURE_2D,
+                     0,
+                     GL_RGBA,
+                     textureWidth,
+                     textureHeight,
+                     0,
+                     GL_RGBA,
+                     GL_UNSIGNED_BYTE,
+                     &transparentRGBA[0]);
+        glPopClientAttrib();
+
+        m_sliceTextures.push_front(sliceTexture);
+        m_numberOfBytesInSlices += numberOfSliceBytes;
+
+        sliceTexture->m_sliceRGBA.assign(sliceRGBA.begin(),
+                                         sliceRGBA.begin() + numberOfSliceBytes);
+        sliceTexture->m_sliceOpacity = sliceOpacity;
+        loadTexture(sliceTexture);
+
+        removeLeastRecentlyUsedTextures();
+    }
+    else {
+        glBindTexture(GL_TEXTURE_2D, sliceTexture->m_textureName->getTextureName());
+
+        if ((sliceTexture->m_sliceOpacity != sliceOpacity)
+            || (std::memcmp(&sliceTexture->m_sliceRGBA[0],
+                            &sliceRGBA[0],
+                            numberOfSliceBytes) != 0)) {
+            std::memcpy(&sliceTexture->m_sliceRGBA[0],
+                        &sliceRGBA[0],
+                        numberOfSliceBytes);
+            sliceTexture->m_sliceOpacity = sliceOpacity;
+            loadTexture(sliceTexture);
+        }
+    }
+
+    textureWidthOut  = sliceTexture->m_textureWidth;
+    textureHeightOut = sliceTexture->m_textureHeight;
+
+    return true;
+}
+
+/**
+ * Load the slice coloring into the bound texture.  Voxels that are
+ * displayed use the overlay's opacity and voxels that are not
+ * displayed are transparent.
+ *
+ * @param sliceTexture
+ *    The slice texture.
+ */
+void
+BrainOpenGLVolumeSliceTextureCache::loadTexture(SliceTexture* sliceTexture) const
+{
+    const int64_t numberOfVoxels = sliceTexture->m_numberOfColumns * sliceTexture->m_numberOfRows;
+    const std::vector<uint8_t>& sliceRGBA = sliceTexture->m_sliceRGBA;
+    std::vector<uint8_t> textureRGBA(numberOfVoxels * 4, 0);
+    for (int64_t i = 0; i < numberOfVoxels; i++) {
+        const int64_t i4 = i * 4;
+        if (sliceRGBA[i4 + 3] > 0) {
+            textureRGBA[i4]     = sliceRGBA[i4];
+            textureRGBA[i4 + 1] = sliceRGBA[i4 + 1];
+            textureRGBA[i4 + 2] = sliceRGBA[i4 + 2];
+            textureRGBA[i4 + 3] = sliceTexture->m_sliceOpacity;
+        }
+    }
+
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    0,
+                    0,
+                    0,
+                    sliceTexture->m_numberOfColumns,
+                    sliceTexture->m_numberOfRows,
+                    GL_RGBA,
+                    GL_UNSIGNED_BYTE,
+                    &textureRGBA[0]);
+    glPopClientAttrib();
+}
+
+/**
+ * Remove the least recently used textures while the slice coloring
+ * kept by the textures exceeds the maximum size.  The most recently
+ * used texture is never removed.
+ */
+void
+BrainOpenGLVolumeSliceTextureCache::removeLeastRecentlyUsedTextures()
+{
+    while ((m_numberOfBytesInSlices > s_maximumNumberOfBytesInSlices)
+           && (m_sliceTextures.size() > 1)) {
+        SliceTexture* sliceTexture = m_sliceTextures.back();
+        m_sliceTextures.pop_back();
+        m_numberOfBytesInSlices -= static_cast<int64_t>(sliceTexture->m_sliceRGBA.size());
+
+        /*
+         * Destruction of the texture name deletes the
+         * texture in the context in which it was created
+         */
+        delete sliceTexture;
+    }
+}
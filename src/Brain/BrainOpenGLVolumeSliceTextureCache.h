@@ -0,0 +1,113 @@
+#ifndef __BRAIN_OPEN_GL_VOLUME_SLICE_TEXTURE_CACHE_H__
+#define __BRAIN_OPEN_GL_VOLUME_SLICE_TEXTURE_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014 Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "CaretObject.h"
+
+namespace caret {
+
+    class GraphicsOpenGLTextureName;
+    class VolumeMappableInterface;
+
+    class BrainOpenGLVolumeSliceTextureCache : public CaretObject {
+
+    public:
+        BrainOpenGLVolumeSliceTextureCache();
+
+        virtual ~BrainOpenGLVolumeSliceTextureCache();
+
+        bool bindSliceTexture(void* openglContextPointer,
+                              const VolumeMappableInterface* volume,
+                              const int32_t mapIndex,
+                              const float firstVoxelXYZ[3],
+                              const int64_t numberOfColumns,
+                              const int64_t numberOfRows,
+                              const std::vector<uint8_t>& sliceRGBA,
+                              const uint8_t sliceOpacity,
+                              int64_t& textureWidthOut,
+                              int64_t& textureHeightOut);
+
+        void clear();
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        /**
+         * A texture containing one slice and the coloring
+         * that was last loaded into the texture.
+         */
+        class SliceTexture {
+        public:
+            void* m_openglContextPointer = NULL;
+
+            const VolumeMappableInterface* m_volume = NULL;
+
+            int32_t m_mapIndex = -1;
+
+            float m_firstVoxelXYZ[3] = { 0.0f, 0.0f, 0.0f };
+
+            int64_t m_numberOfColumns = 0;
+
+            int64_t m_numberOfRows = 0;
+
+            int64_t m_textureWidth = 0;
+
+            int64_t m_textureHeight = 0;
+
+            uint8_t m_sliceOpacity = 0;
+
+            std::vector<uint8_t> m_sliceRGBA;
+
+            std::unique_ptr<GraphicsOpenGLTextureName> m_textureName;
+        };
+
+        BrainOpenGLVolumeSliceTextureCache(const BrainOpenGLVolumeSliceTextureCache&);
+
+        BrainOpenGLVolumeSliceTextureCache& operator=(const BrainOpenGLVolumeSliceTextureCache&);
+
+        void loadTexture(SliceTexture* sliceTexture) const;
+
+        void removeLeastRecentlyUsedTextures();
+
+        /** Slice textures with most recently used first */
+        std::list<SliceTexture*> m_sliceTextures;
+
+        /** Bytes of slice coloring kept by the slice textures */
+        int64_t m_numberOfBytesInSlices = 0;
+
+        static const int64_t s_maximumNumberOfBytesInSlices;
+
+        // ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __BRAIN_OPEN_GL_VOLUME_SLICE_TEXTURE_CACHE_DECLARE__
+    /* Enough for the slices of a large montage of several layers of 1mm volumes */
+    const int64_t BrainOpenGLVolumeSliceTextureCache::s_maximumNumberOfBytesInSlices = 64 * 1024 * 1024;
+#endif // __BRAIN_OPEN_GL_VOLUME_SLICE_TEXTURE_CACHE_DECLARE__
+
+} // namespace
+#endif  //__BRAIN_OPEN_GL_VOLUME_SLICE_TEXTURE_CACHE_H__
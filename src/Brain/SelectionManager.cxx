@@ -130,6 +130,8 @@ SelectionManager::SelectionManager()
     
     m_lastSelectedItem = NULL;
     
+    m_surfacePickingWithRayCastingEnabled = true;
+    
     reset();
     
     EventManager::get()->addEventListener(this,
@@ -892,4 +894,27 @@ SelectionManager::setLastSelectedItem(const SelectionItem* lastItem)
     }
 }
 
+/**
+ * @return True if surface nodes and triangles are identified by
+ * intersecting the ray through the mouse with the surface, false
+ * if they are identified by drawing them in identification colors
+ * and reading back the pixel under the mouse.
+ */
+bool
+SelectionManager::isSurfacePickingWithRayCastingEnabled() const
+{
+    return m_surfacePickingWithRayCastingEnabled;
+}
+
+/**
+ * Set identification of surface nodes and triangles by ray casting.
+ *
+ * @param status
+ *     New status.
+ */
+void
+SelectionManager::setSurfacePickingWithRayCastingEnabled(const bool status)
+{
+    m_surfacePickingWithRayCastingEnabled = status;
+}
 
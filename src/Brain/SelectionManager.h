@@ -164,6 +164,10 @@ namespace caret {
         
         void setAllSelectionsEnabled(const bool status);
         
+        bool isSurfacePickingWithRayCastingEnabled() const;
+        
+        void setSurfacePickingWithRayCastingEnabled(const bool status);
+        
     private:
         SelectionManager(const SelectionManager&);
 
@@ -233,6 +237,9 @@ namespace caret {
         
         /** Last selected item DOES NOT GET PUT IN m_allSelectionItems */
         SelectionItem* m_lastSelectedItem;
+        
+        /** Identify surface nodes and triangles without drawing them in identification colors */
+        bool m_surfacePickingWithRayCastingEnabled;
     };
     
 #ifdef __SELECTION_MANAGER_DECLARE__
@@ -23,6 +23,8 @@
 #include "SurfaceNodeColoring.h"
 #undef __SURFACE_NODE_COLORING_DECLARE__
 
+#include <algorithm>
+
 #include "Brain.h"
 #include "BrainordinateRegionOfInterest.h"
 #include "BrainStructure.h"
@@ -30,6 +32,7 @@
 #include "EventBrowserTabGet.h"
 #include "CaretAssert.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "CaretPreferences.h"
 #include "CiftiBrainordinateDataSeriesFile.h"
 #include "CiftiBrainordinateLabelFile.h"
@@ -286,7 +289,8 @@ SurfaceNodeColoring::showBrainordinateHighlightRegionOfInterest(const Brain* bra
  * Assign color components to surface nodes. 
  *
  * @param surface
- *    Surface that has its nodes colored.
+ *    Surface that has its nodes colored and caches the coloring
+ *    of each overlay layer.
  * @param overlaySet
  *    Surface overlay assignments for surface.
  * @param rgbaNodeColors
@@ -295,7 +299,7 @@ SurfaceNodeColoring::showBrainordinateHighlightRegionOfInterest(const Brain* bra
 void 
 SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPropertiesLabels,
                                        const int32_t browserTabIndex,
-                                       const Surface* surface,
+                                       Surface* surface,
                                        OverlaySet* overlaySet,
                                        float* rgbaNodeColors)
 {
@@ -331,206 +335,75 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
             overlay->getSelectionData(mapFiles,
                                       selectedMapFile,
                                       selectedMapIndex);
-            
-            DataFileTypeEnum::Enum mapDataFileType = DataFileTypeEnum::UNKNOWN;
-            if (selectedMapFile != NULL) {
-                mapDataFileType = selectedMapFile->getDataFileType();
+            if (selectedMapFile == NULL) {
+                continue;
             }
             
-            bool isColoringValid = false;
-            switch (mapDataFileType) {
-                case DataFileTypeEnum::ANNOTATION:
-                    break;
-                case DataFileTypeEnum::BORDER:
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE:
-                {
-                    CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
-                                                                                    cmf,
-                                                                                    selectedMapIndex,
-                                                                                    numNodes,
-                                                                                    overlayRGBV);
-                }
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC:
-                {
-                    CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
-                                                                                    cmf,
-                                                                                    selectedMapIndex,
-                                                                                    numNodes,
-                                                                                    overlayRGBV);
-                }
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
-                    isColoringValid = this->assignCiftiDenseLabelColoring(displayPropertiesLabels,
-                                                                     browserTabIndex,
-                                                                     brainStructure,
-                                                                          surface,
-                                                                      dynamic_cast<CiftiBrainordinateLabelFile*>(selectedMapFile),
-                                                                     selectedMapIndex,
-                                                                      numNodes,
-                                                                      overlayRGBV);
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE_PARCEL:
-                {
-                    CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
-                                                                            cmf,
-                                                                                    selectedMapIndex,
-                                                                            numNodes,
-                                                                            overlayRGBV);
+            /*
+             * Layer coloring is cached by the surface and reused until it is
+             * invalidated.  Label coloring depends upon the selections in the
+             * tab's display group (or the tab itself), all other coloring is
+             * the same in all tabs.
+             */
+            int32_t layerTabIndex = -1;
+            DisplayGroupEnum::Enum layerDisplayGroup = DisplayGroupEnum::DISPLAY_GROUP_TAB;
+            if (selectedMapFile->isMappedWithLabelTable()
+                && (displayPropertiesLabels != NULL)) {
+                layerDisplayGroup = displayPropertiesLabels->getDisplayGroupForTab(browserTabIndex);
+                if (layerDisplayGroup == DisplayGroupEnum::DISPLAY_GROUP_TAB) {
+                    layerTabIndex = browserTabIndex;
                 }
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
-                    isColoringValid = this->assignCiftiScalarColoring(brainStructure,
-                                                                 dynamic_cast<CiftiBrainordinateScalarFile*>(selectedMapFile),
-                                                                      selectedMapIndex,
-                                                                 numNodes,
-                                                                 overlayRGBV);
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
-                    isColoringValid = this->assignCiftiDataSeriesColoring(brainStructure,
-                                                                      dynamic_cast<CiftiBrainordinateDataSeriesFile*>(selectedMapFile),
-                                                                          selectedMapIndex,
-                                                                      numNodes,
-                                                                      overlayRGBV);
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_FIBER_ORIENTATIONS_TEMPORARY:
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_FIBER_TRAJECTORY_TEMPORARY:
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_PARCEL:
-                {
-                    CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
-                                                                            cmf,
-                                                                                    selectedMapIndex,
-                                                                            numNodes,
-                                                                            overlayRGBV);
-                }
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_PARCEL_DENSE:
-                {
-                    CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
-                                                                            cmf,
-                                                                                    selectedMapIndex,
-                                                                            numNodes,
-                                                                            overlayRGBV);
+            }
+            
+            const float* layerRGBV = NULL;
+            if ((selectedMapIndex < 0)
+                || ( ! surface->getOverlayLayerColoring(selectedMapFile,
+                                                        selectedMapIndex,
+                                                        layerTabIndex,
+                                                        layerDisplayGroup,
+                                                        layerRGBV))) {
+                const bool isColoringValid = assignOverlayLayerColoring(displayPropertiesLabels,
+                                                                        browserTabIndex,
+                                                                        brainStructure,
+                                                                        surface,
+                                                                        selectedMapFile,
+                                                                        selectedMapIndex,
+                                                                        numNodes,
+                                                                        overlayRGBV);
+                if (isColoringValid) {
+                    layerRGBV = overlayRGBV;
                 }
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
-                {
-                    CiftiParcelLabelFile* cplf = dynamic_cast<CiftiParcelLabelFile*>(selectedMapFile);
-                    isColoringValid = assignCiftiParcelLabelColoring(displayPropertiesLabels,
-                                                   browserTabIndex,
-                                                   brainStructure,
-                                                                     surface,
-                                                   cplf,
-                                                   selectedMapIndex,
-                                                   numNodes,
-                                                   overlayRGBV);
+                
+                if (selectedMapIndex >= 0) {
+                    surface->setOverlayLayerColoring(selectedMapFile,
+                                                     selectedMapIndex,
+                                                     layerTabIndex,
+                                                     layerDisplayGroup,
+                                                     selectedMapFile->isMapThresholdedWithFile(selectedMapIndex),
+                                                     layerRGBV);
                 }
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
-                    isColoringValid = this->assignCiftiParcelScalarColoring(brainStructure,
-                                                                            dynamic_cast<CiftiParcelScalarFile*>(selectedMapFile),
-                                                                            selectedMapIndex,
-                                                                            numNodes,
-                                                                            overlayRGBV);
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
-                    isColoringValid = this->assignCiftiParcelSeriesColoring(brainStructure,
-                                                                            dynamic_cast<CiftiParcelSeriesFile*>(selectedMapFile),
-                                                                            selectedMapIndex,
-                                                                            numNodes,
-                                                                            overlayRGBV);
-                    break;
-                case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
-                    break;
-                case DataFileTypeEnum::FOCI:
-                    break;
-                case DataFileTypeEnum::IMAGE:
-                    break;
-                case DataFileTypeEnum::LABEL:
-                    isColoringValid = this->assignLabelColoring(displayPropertiesLabels,
-                                                                browserTabIndex,
-                                                                brainStructure,
-                                                                surface,
-                                                                dynamic_cast<LabelFile*>(selectedMapFile),
-                                                                selectedMapIndex,
-                                                                numNodes, 
-                                                                overlayRGBV);
-                    break;
-                case DataFileTypeEnum::METRIC:
-                    isColoringValid = this->assignMetricColoring(brainStructure, 
-                                                                 dynamic_cast<MetricFile*>(selectedMapFile),
-                                                                 selectedMapIndex,
-                                                                 numNodes, 
-                                                                 overlayRGBV);
-                    break;
-                case DataFileTypeEnum::PALETTE:
-                    break;
-                case DataFileTypeEnum::RGBA:
-                    isColoringValid = this->assignRgbaColoring(brainStructure, 
-                                                               dynamic_cast<RgbaFile*>(selectedMapFile),
-                                                               selectedMapIndex,
-                                                               numNodes, 
-                                                               overlayRGBV);
-                    break;
-                case DataFileTypeEnum::SCENE:
-                    break;
-                case DataFileTypeEnum::SPECIFICATION:
-                    break;
-                case DataFileTypeEnum::SURFACE:
-                    break;
-                case DataFileTypeEnum::VOLUME:
-                    break;
-                case DataFileTypeEnum::UNKNOWN:
-                    break;
             }
             
-            if (isColoringValid) {
-                const float opacity = overlay->getOpacity();
-                const float oneMinusOpacity = 1.0 - opacity;
+            if (layerRGBV != NULL) {
+                /*
+                 * The first overlay has nothing to blend with, so like an
+                 * opaque overlay, it gives no weight to the underlaying colors.
+                 * Every node is written, without branches, so the loop can be vectorized.
+                 */
+                const float opacity = std::min(overlay->getOpacity(), 1.0f);
+                const float underlayWeight = (firstOverlayFlag
+                                              ? 0.0f
+                                              : (1.0f - opacity));
                 
                 for (int32_t i = 0; i < numNodes; i++) {
                     const int32_t i4 = i * 4;
-                    const float valid = overlayRGBV[i4 + 3];
-                    if (valid > 0.0 ) {
-                        if (opacity < 1.0) {
-                            if (firstOverlayFlag) {
-                                /*
-                                 * When first overlay, there is nothing to 
-                                 * blend with
-                                 */
-                                rgbaNodeColors[i4]   = (overlayRGBV[i4]   * opacity);
-                                rgbaNodeColors[i4+1] = (overlayRGBV[i4+1] * opacity);
-                                rgbaNodeColors[i4+2] = (overlayRGBV[i4+2] * opacity);
-                            }
-                            else {
-                                /*
-                                 * Blend with underlaying colors
-                                 */
-                                rgbaNodeColors[i4]   = (overlayRGBV[i4]   * opacity)
-                                + (rgbaNodeColors[i4] * oneMinusOpacity);
-                                rgbaNodeColors[i4+1] = (overlayRGBV[i4+1] * opacity)
-                                + (rgbaNodeColors[i4+1] * oneMinusOpacity);
-                                rgbaNodeColors[i4+2] = (overlayRGBV[i4+2] * opacity)
-                                + (rgbaNodeColors[i4+2] * oneMinusOpacity);
-                            }
-                        }
-                        else {
-                            /*
-                             * No opacity so simple replace coloring
-                             */
-                            rgbaNodeColors[i4] = overlayRGBV[i4];
-                            rgbaNodeColors[i4+1] = overlayRGBV[i4+1];
-                            rgbaNodeColors[i4+2] = overlayRGBV[i4+2];
-                        }
-                    }
+                    const bool valid = (layerRGBV[i4 + 3] > 0.0f);
+                    const float red   = (layerRGBV[i4]   * opacity) + (rgbaNodeColors[i4]   * underlayWeight);
+                    const float green = (layerRGBV[i4+1] * opacity) + (rgbaNodeColors[i4+1] * underlayWeight);
+                    const float blue  = (layerRGBV[i4+2] * opacity) + (rgbaNodeColors[i4+2] * underlayWeight);
+                    rgbaNodeColors[i4]   = (valid ? red   : rgbaNodeColors[i4]);
+                    rgbaNodeColors[i4+1] = (valid ? green : rgbaNodeColors[i4+1]);
+                    rgbaNodeColors[i4+2] = (valid ? blue  : rgbaNodeColors[i4+2]);
                 }
                 
                 firstOverlayFlag = false;
@@ -557,6 +430,203 @@ SurfaceNodeColoring::colorSurfaceNodes(const DisplayPropertiesLabels* displayPro
     delete[] overlayRGBV;
 }
 
+/**
+ * Assign the coloring of one overlay layer to surface nodes.
+ *
+ * @param displayPropertiesLabels
+ *    Display properties for labels.
+ * @param browserTabIndex
+ *    Index of browser tab.
+ * @param brainStructure
+ *    The brain structure that contains the data files.
+ * @param surface
+ *    Surface that has its nodes colored.
+ * @param selectedMapFile
+ *    Map file selected in the overlay.
+ * @param selectedMapIndex
+ *    Index of map selected in the overlay.
+ * @param numberOfNodes
+ *    Number of nodes in surface.
+ * @param rgbv
+ *    Color components set by this method.
+ *    Red, green, blue, valid.  If the valid component is
+ *    zero, it indicates that the overlay did not assign
+ *    any coloring to the node.
+ * @return
+ *    True if coloring is valid, else false.
+ */
+bool
+SurfaceNodeColoring::assignOverlayLayerColoring(const DisplayPropertiesLabels* displayPropertiesLabels,
+                                                const int32_t browserTabIndex,
+                                                const BrainStructure* brainStructure,
+                                                const Surface* surface,
+                                                CaretMappableDataFile* selectedMapFile,
+                                                const int32_t selectedMapIndex,
+                                                const int32_t numberOfNodes,
+                                                float* rgbv)
+{
+    CaretAssert(selectedMapFile);
+    
+    const DataFileTypeEnum::Enum mapDataFileType = selectedMapFile->getDataFileType();
+    
+    bool isColoringValid = false;
+    switch (mapDataFileType) {
+        case DataFileTypeEnum::ANNOTATION:
+            break;
+        case DataFileTypeEnum::BORDER:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE:
+        {
+            CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
+            isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
+                                                                            cmf,
+                                                                            selectedMapIndex,
+                                                                            numberOfNodes,
+                                                                            rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_DYNAMIC:
+        {
+            CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
+            isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
+                                                                            cmf,
+                                                                            selectedMapIndex,
+                                                                            numberOfNodes,
+                                                                            rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_LABEL:
+            isColoringValid = this->assignCiftiDenseLabelColoring(displayPropertiesLabels,
+                                                             browserTabIndex,
+                                                             brainStructure,
+                                                                  surface,
+                                                              dynamic_cast<CiftiBrainordinateLabelFile*>(selectedMapFile),
+                                                             selectedMapIndex,
+                                                              numberOfNodes,
+                                                              rgbv);
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_PARCEL:
+        {
+            CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
+            isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
+                                                                    cmf,
+                                                                            selectedMapIndex,
+                                                                    numberOfNodes,
+                                                                    rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_SCALAR:
+            isColoringValid = this->assignCiftiScalarColoring(brainStructure,
+                                                         dynamic_cast<CiftiBrainordinateScalarFile*>(selectedMapFile),
+                                                              selectedMapIndex,
+                                                         numberOfNodes,
+                                                         rgbv);
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_DENSE_TIME_SERIES:
+            isColoringValid = this->assignCiftiDataSeriesColoring(brainStructure,
+                                                              dynamic_cast<CiftiBrainordinateDataSeriesFile*>(selectedMapFile),
+                                                                  selectedMapIndex,
+                                                              numberOfNodes,
+                                                              rgbv);
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_FIBER_ORIENTATIONS_TEMPORARY:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_FIBER_TRAJECTORY_TEMPORARY:
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL:
+        {
+            CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
+            isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
+                                                                    cmf,
+                                                                            selectedMapIndex,
+                                                                    numberOfNodes,
+                                                                    rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_DENSE:
+        {
+            CiftiMappableConnectivityMatrixDataFile* cmf = dynamic_cast<CiftiMappableConnectivityMatrixDataFile*>(selectedMapFile);
+            isColoringValid = assignCiftiMappableConnectivityMatrixColoring(brainStructure,
+                                                                    cmf,
+                                                                            selectedMapIndex,
+                                                                    numberOfNodes,
+                                                                    rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
+        {
+            CiftiParcelLabelFile* cplf = dynamic_cast<CiftiParcelLabelFile*>(selectedMapFile);
+            isColoringValid = assignCiftiParcelLabelColoring(displayPropertiesLabels,
+                                           browserTabIndex,
+                                           brainStructure,
+                                                             surface,
+                                           cplf,
+                                           selectedMapIndex,
+                                           numberOfNodes,
+                                           rgbv);
+        }
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
+            isColoringValid = this->assignCiftiParcelScalarColoring(brainStructure,
+                                                                    dynamic_cast<CiftiParcelScalarFile*>(selectedMapFile),
+                                                                    selectedMapIndex,
+                                                                    numberOfNodes,
+                                                                    rgbv);
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
+            isColoringValid = this->assignCiftiParcelSeriesColoring(brainStructure,
+                                                                    dynamic_cast<CiftiParcelSeriesFile*>(selectedMapFile),
+                                                                    selectedMapIndex,
+                                                                    numberOfNodes,
+                                                                    rgbv);
+            break;
+        case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
+            break;
+        case DataFileTypeEnum::FOCI:
+            break;
+        case DataFileTypeEnum::IMAGE:
+            break;
+        case DataFileTypeEnum::LABEL:
+            isColoringValid = this->assignLabelColoring(displayPropertiesLabels,
+                                                        browserTabIndex,
+                                                        brainStructure,
+                                                        surface,
+                                                        dynamic_cast<LabelFile*>(selectedMapFile),
+                                                        selectedMapIndex,
+                                                        numberOfNodes, 
+                                                        rgbv);
+            break;
+        case DataFileTypeEnum::METRIC:
+            isColoringValid = this->assignMetricColoring(brainStructure, 
+                                                         dynamic_cast<MetricFile*>(selectedMapFile),
+                                                         selectedMapIndex,
+                                                         numberOfNodes, 
+                                                         rgbv);
+            break;
+        case DataFileTypeEnum::PALETTE:
+            break;
+        case DataFileTypeEnum::RGBA:
+            isColoringValid = this->assignRgbaColoring(brainStructure, 
+                                                       dynamic_cast<RgbaFile*>(selectedMapFile),
+                                                       selectedMapIndex,
+                                                       numberOfNodes, 
+                                                       rgbv);
+            break;
+        case DataFileTypeEnum::SCENE:
+            break;
+        case DataFileTypeEnum::SPECIFICATION:
+            break;
+        case DataFileTypeEnum::SURFACE:
+            break;
+        case DataFileTypeEnum::VOLUME:
+            break;
+        case DataFileTypeEnum::UNKNOWN:
+            break;
+    }
+    
+    return isColoringValid;
+}
+
 /**
  * Assign label coloring to nodes
  * @param brainStructure
@@ -692,10 +762,12 @@ SurfaceNodeColoring::assignLabelTableColors(const GiftiLabelTable* labelTable,
     outlineRGBA[3] = 1.0;
     
     /*
-     * Assign colors from labels to nodes
+     * Assign colors from labels to nodes.  Each node only
+     * reads the labels and topology, so nodes are independent.
      */
-    float nodeRGBA[4];
+#pragma omp CARET_PARFOR schedule(dynamic, 4096)
     for (int32_t i = 0; i < numberOfIndices; i++) {
+        float nodeRGBA[4];
         CaretAssertVectorIndex(labelIndices, i);
         const int32_t labelKey= static_cast<int32_t>(labelIndices[i]);
         const GiftiLabel* label = labelTable->getLabel(labelKey);
@@ -32,6 +32,7 @@ namespace caret {
     class Brain;
     class BrainStructure;
     class BrowserTabContent;
+    class CaretMappableDataFile;
     class CiftiMappableConnectivityMatrixDataFile;
     class CiftiBrainordinateDataSeriesFile;
     class CiftiBrainordinateLabelFile;
@@ -81,10 +82,19 @@ namespace caret {
         
         void colorSurfaceNodes(const DisplayPropertiesLabels* dpl,
                                const int32_t browserTabIndex,
-                               const Surface* surface,
+                               Surface* surface,
                                OverlaySet* overlaySet,
                                float* rgbaNodeColors);
         
+        bool assignOverlayLayerColoring(const DisplayPropertiesLabels* displayPropertiesLabels,
+                                        const int32_t browserTabIndex,
+                                        const BrainStructure* brainStructure,
+                                        const Surface* surface,
+                                        CaretMappableDataFile* selectedMapFile,
+                                        const int32_t selectedMapIndex,
+                                        const int32_t numberOfNodes,
+                                        float* rgbv);
+        
         bool assignLabelColoring(const DisplayPropertiesLabels* dpl,
                                  const int32_t browserTabIndex,
                                  const BrainStructure* brainStructure,
@@ -22,9 +22,8 @@
 
 #include "DataFileException.h"
 
-#include <QStringList>
-
 #include <algorithm>
+#include <limits>
 
 using namespace std;
 using namespace caret;
@@ -53,7 +52,7 @@ void CiftiBrainModelsMap::addSurfaceModel(const int64_t& numberOfNodes, const St
     myModel.m_type = SURFACE;
     myModel.m_brainStructure = structure;
     myModel.m_surfaceNumberOfNodes = numberOfNodes;
-    myModel.m_nodeIndices = nodeList;
+    myModel.m_nodeIndices.grabNew(new vector<int64_t>(nodeList));
     myModel.setupSurface(getNextStart());//do internal setup - also does error checking
     m_modelsInfo.push_back(myModel);
     m_surfUsed[structure] = m_modelsInfo.size() - 1;
@@ -66,33 +65,42 @@ void CiftiBrainModelsMap::BrainModelPriv::setupSurface(const int64_t& start)
         throw DataFileException("surface must have at least 1 vertex");
     }
     m_modelStart = start;
-    int64_t listSize = (int64_t)m_nodeIndices.size();
+    const vector<int64_t>& nodeIndices = getNodeIndices();
+    int64_t listSize = (int64_t)nodeIndices.size();
     if (listSize == 0)
     {
         throw DataFileException("vertex list must have nonzero length");//NOTE: technically not required by Cifti-1, remove if problematic
     }
     m_modelEnd = start + listSize;//one after last
     vector<bool> used(m_surfaceNumberOfNodes, false);
-    m_nodeToIndexLookup = vector<int64_t>(m_surfaceNumberOfNodes, -1);//reset all to -1 to start
+    vector<int64_t>* lookup = new vector<int64_t>(m_surfaceNumberOfNodes, -1);//reset all to -1 to start
+    m_nodeToIndexLookup.grabNew(lookup);//owned before anything can throw
     for (int64_t i = 0; i < listSize; ++i)
     {
-        if (m_nodeIndices[i] < 0)
+        if (nodeIndices[i] < 0)
         {
             throw DataFileException("vertex list contains negative index");
         }
-        if (m_nodeIndices[i] >= m_surfaceNumberOfNodes)
+        if (nodeIndices[i] >= m_surfaceNumberOfNodes)
         {
             throw DataFileException("vertex list contains an index that don't exist in the surface");
         }
-        if (used[m_nodeIndices[i]])
+        if (used[nodeIndices[i]])
         {
             throw DataFileException("vertex list contains reused index");
         }
-        used[m_nodeIndices[i]] = true;
-        m_nodeToIndexLookup[m_nodeIndices[i]] = start + i;
+        used[nodeIndices[i]] = true;
+        (*lookup)[nodeIndices[i]] = start + i;
     }
 }
 
+const vector<int64_t>& CiftiBrainModelsMap::BrainModelPriv::getArray(const CaretPointer<const vector<int64_t> >& array)
+{
+    static const vector<int64_t> emptyArray;//models that haven't been set up yet, or the other type's array
+    if (array == NULL) return emptyArray;
+    return *array;
+}
+
 void CiftiBrainModelsMap::addVolumeModel(const StructureEnum::Enum& structure, const vector<int64_t>& ijkList)
 {
     if (m_volUsed.find(structure) != m_volUsed.end())
@@ -118,9 +126,8 @@ void CiftiBrainModelsMap::addVolumeModel(const StructureEnum::Enum& structure, c
         }
         dims = m_volSpace.getDims();
     }
-    CaretCompact3DLookup<std::pair<int64_t, StructureEnum::Enum> > tempLookup = m_voxelToIndexLookup;//a copy of the lookup should be faster than other methods of checking for overlap and repeat
     int64_t nextStart = getNextStart();
-    for (int64_t index = 0; index < numElems; ++index)//do all error checking before adding to lookup
+    for (int64_t index = 0; index < numElems; ++index)//do all error checking before building the lookup
     {
         int64_t index3 = index * 3;
         if (ijkList[index3] < 0 || ijkList[index3 + 1] < 0 || ijkList[index3 + 2] < 0)
@@ -134,29 +141,176 @@ void CiftiBrainModelsMap::addVolumeModel(const StructureEnum::Enum& structure, c
             throw DataFileException("found invalid index triple in voxel list: (" + AString::number(ijkList[index3]) + ", "
                                   + AString::number(ijkList[index3 + 1]) + ", " + AString::number(ijkList[index3 + 2]) + ")");
         }
-        if (tempLookup.find(ijkList[index3], ijkList[index3 + 1], ijkList[index3 + 2]) != NULL)
-        {
-            throw DataFileException("volume models may not reuse voxels, either internally or from other structures");
-        }
-        tempLookup.at(ijkList[index3], ijkList[index3 + 1], ijkList[index3 + 2]) = pair<int64_t, StructureEnum::Enum>(nextStart + index, structure);
     }
-    m_voxelToIndexLookup = tempLookup;
     BrainModelPriv myModel;
     myModel.m_type = VOXELS;
     myModel.m_brainStructure = structure;
-    myModel.m_voxelIndicesIJK = ijkList;
+    myModel.m_voxelIndicesIJK.grabNew(new vector<int64_t>(ijkList));
     myModel.m_modelStart = nextStart;
     myModel.m_modelEnd = nextStart + numElems;//one after last
     m_modelsInfo.push_back(myModel);
+    try
+    {
+        m_voxelLookup.grabNew(new VoxelLookup(m_modelsInfo));//building the new lookup is also the check for overlap and repeat
+    } catch (...) {
+        m_modelsInfo.pop_back();//leave the map as it was
+        throw;
+    }
     m_volUsed[structure] = m_modelsInfo.size() - 1;
 }
 
+namespace
+{
+    int popCount64(uint64_t x)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(x);
+#else
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+    
+    uint64_t hashIJK(const int64_t& i, const int64_t& j, const int64_t& k)
+    {
+        uint64_t ret = (uint64_t)i * 0x9E3779B97F4A7C15ULL ^ (uint64_t)j * 0xC2B2AE3D27D4EB4FULL ^ (uint64_t)k * 0x165667B19E3779F9ULL;
+        return ret ^ (ret >> 29);
+    }
+}
+
+CiftiBrainModelsMap::VoxelLookup::VoxelLookup(const vector<BrainModelPriv>& models)
+{
+    int64_t numVoxels = 0;
+    int64_t maxIJK[3] = { 0, 0, 0 };
+    for (int i = 0; i < (int)models.size(); ++i)
+    {
+        if (models[i].m_type != VOXELS) continue;
+        const vector<int64_t>& ijkList = models[i].getVoxelIndicesIJK();
+        for (int64_t i3 = 0; i3 < (int64_t)ijkList.size(); i3 += 3)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                if (numVoxels == 0 || ijkList[i3 + axis] < m_min[axis]) m_min[axis] = ijkList[i3 + axis];
+                if (numVoxels == 0 || ijkList[i3 + axis] > maxIJK[axis]) maxIJK[axis] = ijkList[i3 + axis];
+            }
+            ++numVoxels;
+        }
+    }
+    if (numVoxels == 0)
+    {
+        for (int axis = 0; axis < 3; ++axis) m_min[axis] = 0;
+    }
+    double boxSize = 1.0;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        boxSize *= (double)maxIJK[axis] - (double)m_min[axis] + 1.0;//in double, because the cifti-1 parsing path hasn't checked against the volume dimensions yet
+        m_dims[axis] = 0;
+    }
+    m_dense = (boxSize <= 256.0 * numVoxels + 65536.0);//dense costs about 2 bits per bounding box voxel, the hash table about 70 bytes per voxel
+    m_hashMask = 0;
+    if (m_dense)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            m_dims[axis] = maxIJK[axis] - m_min[axis] + 1;
+        }
+        int64_t numWords = (m_dims[0] * m_dims[1] * m_dims[2] + 63) / 64;
+        m_bits.resize(numWords, 0);
+        for (int i = 0; i < (int)models.size(); ++i)
+        {
+            if (models[i].m_type != VOXELS) continue;
+            const vector<int64_t>& ijkList = models[i].getVoxelIndicesIJK();
+            for (int64_t i3 = 0; i3 < (int64_t)ijkList.size(); i3 += 3)
+            {
+                int64_t linear = ((ijkList[i3 + 2] - m_min[2]) * m_dims[1] + ijkList[i3 + 1] - m_min[1]) * m_dims[0] + ijkList[i3] - m_min[0];
+                uint64_t mask = ((uint64_t)1) << (linear & 63);
+                if ((m_bits[linear >> 6] & mask) != 0)
+                {
+                    throw DataFileException("volume models may not reuse voxels, either internally or from other structures");
+                }
+                m_bits[linear >> 6] |= mask;
+            }
+        }
+        m_wordRank.resize(numWords);
+        int64_t total = 0;
+        for (int64_t w = 0; w < numWords; ++w)
+        {
+            m_wordRank[w] = total;
+            total += popCount64(m_bits[w]);
+        }
+        CaretAssert(total == numVoxels);
+        m_entryIndex.resize(numVoxels);
+        m_entryStructure.resize(numVoxels);
+    } else {
+        int64_t tableSize = 1;
+        while (tableSize < 2 * numVoxels) tableSize *= 2;//at most half full
+        m_hashMask = (uint64_t)(tableSize - 1);
+        m_hashIJK.resize(tableSize * 3);
+        m_entryIndex.resize(tableSize, -1);
+        m_entryStructure.resize(tableSize);
+    }
+    for (int i = 0; i < (int)models.size(); ++i)
+    {
+        if (models[i].m_type != VOXELS) continue;
+        const vector<int64_t>& ijkList = models[i].getVoxelIndicesIJK();
+        for (int64_t i3 = 0; i3 < (int64_t)ijkList.size(); i3 += 3)
+        {
+            int64_t entry;
+            if (m_dense)
+            {
+                entry = findEntry(ijkList[i3], ijkList[i3 + 1], ijkList[i3 + 2]);
+            } else {
+                uint64_t slot = hashIJK(ijkList[i3], ijkList[i3 + 1], ijkList[i3 + 2]) & m_hashMask;
+                while (m_entryIndex[slot] != -1)
+                {
+                    if (m_hashIJK[slot * 3] == ijkList[i3] && m_hashIJK[slot * 3 + 1] == ijkList[i3 + 1] && m_hashIJK[slot * 3 + 2] == ijkList[i3 + 2])
+                    {
+                        throw DataFileException("volume models may not reuse voxels, either internally or from other structures");
+                    }
+                    slot = (slot + 1) & m_hashMask;
+                }
+                m_hashIJK[slot * 3] = ijkList[i3];
+                m_hashIJK[slot * 3 + 1] = ijkList[i3 + 1];
+                m_hashIJK[slot * 3 + 2] = ijkList[i3 + 2];
+                entry = (int64_t)slot;
+            }
+            CaretAssert(entry >= 0);
+            m_entryIndex[entry] = models[i].m_modelStart + i3 / 3;
+            m_entryStructure[entry] = models[i].m_brainStructure;
+        }
+    }
+}
+
+int64_t CiftiBrainModelsMap::VoxelLookup::findEntry(const int64_t& i, const int64_t& j, const int64_t& k) const
+{
+    if (m_dense)
+    {//compare before subtracting, so that weirdness like huge negatives can't overflow
+        if (i < m_min[0] || i >= m_min[0] + m_dims[0] ||
+            j < m_min[1] || j >= m_min[1] + m_dims[1] ||
+            k < m_min[2] || k >= m_min[2] + m_dims[2]) return -1;
+        int64_t linear = ((k - m_min[2]) * m_dims[1] + j - m_min[1]) * m_dims[0] + i - m_min[0];
+        uint64_t word = m_bits[linear >> 6];
+        uint64_t mask = ((uint64_t)1) << (linear & 63);
+        if ((word & mask) == 0) return -1;
+        return m_wordRank[linear >> 6] + popCount64(word & (mask - 1));
+    }
+    uint64_t slot = hashIJK(i, j, k) & m_hashMask;
+    while (m_entryIndex[slot] != -1)
+    {
+        if (m_hashIJK[slot * 3] == i && m_hashIJK[slot * 3 + 1] == j && m_hashIJK[slot * 3 + 2] == k) return (int64_t)slot;
+        slot = (slot + 1) & m_hashMask;
+    }
+    return -1;
+}
+
 void CiftiBrainModelsMap::clear()
 {
     m_modelsInfo.clear();
     m_haveVolumeSpace = false;
     m_ignoreVolSpace = false;
-    m_voxelToIndexLookup.clear();
+    m_voxelLookup.grabNew(NULL);
     m_surfUsed.clear();
     m_volUsed.clear();
 }
@@ -172,8 +326,8 @@ int64_t CiftiBrainModelsMap::getIndexForNode(const int64_t& node, const Structur
     CaretAssertVectorIndex(m_modelsInfo, iter->second);
     const BrainModelPriv& myModel = m_modelsInfo[iter->second];
     if (node >= myModel.m_surfaceNumberOfNodes) return -1;
-    CaretAssertVectorIndex(myModel.m_nodeToIndexLookup, node);
-    return myModel.m_nodeToIndexLookup[node];
+    CaretAssertVectorIndex(myModel.getNodeToIndexLookup(), node);
+    return myModel.getNodeToIndexLookup()[node];
 }
 
 int64_t CiftiBrainModelsMap::getIndexForVoxel(const int64_t* ijk, StructureEnum::Enum* structureOut) const
@@ -183,16 +337,53 @@ int64_t CiftiBrainModelsMap::getIndexForVoxel(const int64_t* ijk, StructureEnum:
 
 int64_t CiftiBrainModelsMap::getIndexForVoxel(const int64_t& i, const int64_t& j, const int64_t& k, StructureEnum::Enum* structureOut) const
 {
-    const pair<int64_t, StructureEnum::Enum>* iter = m_voxelToIndexLookup.find(i, j, k);//the lookup tolerates weirdness like negatives
-    if (iter == NULL) return -1;
-    if (structureOut != NULL) *structureOut = iter->second;
-    return iter->first;
+    if (m_voxelLookup == NULL) return -1;
+    int64_t entry = m_voxelLookup->findEntry(i, j, k);//the lookup tolerates weirdness like negatives
+    if (entry == -1) return -1;
+    if (structureOut != NULL) *structureOut = m_voxelLookup->m_entryStructure[entry];
+    return m_voxelLookup->m_entryIndex[entry];
 }
 
-CiftiBrainModelsMap::IndexInfo CiftiBrainModelsMap::getInfoForIndex(const int64_t index) const
+vector<int64_t> CiftiBrainModelsMap::getIndicesForNodes(const vector<int64_t>& nodeList, const StructureEnum::Enum& structure) const
+{
+    int64_t numNodes = (int64_t)nodeList.size();
+    vector<int64_t> ret(numNodes, -1);
+    map<StructureEnum::Enum, int>::const_iterator iter = m_surfUsed.find(structure);
+    if (iter == m_surfUsed.end()) return ret;
+    CaretAssertVectorIndex(m_modelsInfo, iter->second);
+    const BrainModelPriv& myModel = m_modelsInfo[iter->second];//only find the model once
+    const vector<int64_t>& nodeToIndexLookup = myModel.getNodeToIndexLookup();
+    for (int64_t i = 0; i < numNodes; ++i)
+    {
+        if (nodeList[i] >= 0 && nodeList[i] < myModel.m_surfaceNumberOfNodes)
+        {
+            ret[i] = nodeToIndexLookup[nodeList[i]];
+        }
+    }
+    return ret;
+}
+
+vector<int64_t> CiftiBrainModelsMap::getIndicesForVoxels(const vector<int64_t>& ijkList, vector<StructureEnum::Enum>* structuresOut) const
+{
+    CaretAssert(ijkList.size() % 3 == 0);
+    int64_t numVoxels = (int64_t)ijkList.size() / 3;
+    vector<int64_t> ret(numVoxels, -1);
+    if (structuresOut != NULL) structuresOut->assign(numVoxels, StructureEnum::INVALID);
+    if (m_voxelLookup == NULL) return ret;
+    const VoxelLookup& myLookup = *m_voxelLookup;
+    for (int64_t i = 0; i < numVoxels; ++i)
+    {
+        int64_t entry = myLookup.findEntry(ijkList[i * 3], ijkList[i * 3 + 1], ijkList[i * 3 + 2]);
+        if (entry == -1) continue;
+        ret[i] = myLookup.m_entryIndex[entry];
+        if (structuresOut != NULL) (*structuresOut)[i] = myLookup.m_entryStructure[entry];
+    }
+    return ret;
+}
+
+int CiftiBrainModelsMap::findModelForIndex(const int64_t& index) const
 {
     CaretAssert(index >= 0 && index < getLength());
-    IndexInfo ret;
     int numModels = (int)m_modelsInfo.size();
     int low = 0, high = numModels - 1;//bisection search
     while (low != high)
@@ -212,16 +403,53 @@ CiftiBrainModelsMap::IndexInfo CiftiBrainModelsMap::getInfoForIndex(const int64_
         }
     }
     CaretAssert(index >= m_modelsInfo[low].m_modelStart && index < m_modelsInfo[low].m_modelEnd);//otherwise we have a broken invariant
+    return low;
+}
+
+CiftiBrainModelsMap::IndexInfo CiftiBrainModelsMap::getInfoForIndex(const int64_t index) const
+{
+    IndexInfo ret;
+    int low = findModelForIndex(index);
     ret.m_structure = m_modelsInfo[low].m_brainStructure;
     ret.m_type = m_modelsInfo[low].m_type;
     if (ret.m_type == SURFACE)
     {
-        ret.m_surfaceNode = m_modelsInfo[low].m_nodeIndices[index - m_modelsInfo[low].m_modelStart];
+        ret.m_surfaceNode = m_modelsInfo[low].getNodeIndices()[index - m_modelsInfo[low].m_modelStart];
     } else {
         int64_t baseIndex = 3 * (index - m_modelsInfo[low].m_modelStart);
-        ret.m_ijk[0] = m_modelsInfo[low].m_voxelIndicesIJK[baseIndex];
-        ret.m_ijk[1] = m_modelsInfo[low].m_voxelIndicesIJK[baseIndex + 1];
-        ret.m_ijk[2] = m_modelsInfo[low].m_voxelIndicesIJK[baseIndex + 2];
+        const vector<int64_t>& voxelIndices = m_modelsInfo[low].getVoxelIndicesIJK();
+        ret.m_ijk[0] = voxelIndices[baseIndex];
+        ret.m_ijk[1] = voxelIndices[baseIndex + 1];
+        ret.m_ijk[2] = voxelIndices[baseIndex + 2];
+    }
+    return ret;
+}
+
+vector<CiftiBrainModelsMap::IndexInfo> CiftiBrainModelsMap::getInfoForIndices(const vector<int64_t>& indices) const
+{
+    int64_t numIndices = (int64_t)indices.size();
+    vector<IndexInfo> ret(numIndices);
+    int curModel = -1;
+    for (int64_t i = 0; i < numIndices; ++i)
+    {
+        const int64_t& index = indices[i];
+        if (curModel == -1 || index < m_modelsInfo[curModel].m_modelStart || index >= m_modelsInfo[curModel].m_modelEnd)
+        {//indices usually come in runs within a model, so only search when we leave the current one
+            curModel = findModelForIndex(index);
+        }
+        const BrainModelPriv& myModel = m_modelsInfo[curModel];
+        ret[i].m_structure = myModel.m_brainStructure;
+        ret[i].m_type = myModel.m_type;
+        if (myModel.m_type == SURFACE)
+        {
+            ret[i].m_surfaceNode = myModel.getNodeIndices()[index - myModel.m_modelStart];
+        } else {
+            int64_t baseIndex = 3 * (index - myModel.m_modelStart);
+            const vector<int64_t>& voxelIndices = myModel.getVoxelIndicesIJK();
+            ret[i].m_ijk[0] = voxelIndices[baseIndex];
+            ret[i].m_ijk[1] = voxelIndices[baseIndex + 1];
+            ret[i].m_ijk[2] = voxelIndices[baseIndex + 2];
+        }
     }
     return ret;
 }
@@ -260,7 +488,7 @@ const vector<int64_t>& CiftiBrainModelsMap::getNodeList(const StructureEnum::Enu
         throw DataFileException("getNodeList called for nonexistant structure");//throw if it doesn't exist, because we don't have a reference to return - things should identify which structures exist before calling this
     }
     CaretAssertVectorIndex(m_modelsInfo, iter->second);
-    return m_modelsInfo[iter->second].m_nodeIndices;
+    return m_modelsInfo[iter->second].getNodeIndices();
 }
 
 vector<CiftiBrainModelsMap::SurfaceMap> CiftiBrainModelsMap::getSurfaceMap(const StructureEnum::Enum& structure) const
@@ -273,12 +501,13 @@ vector<CiftiBrainModelsMap::SurfaceMap> CiftiBrainModelsMap::getSurfaceMap(const
     }
     CaretAssertVectorIndex(m_modelsInfo, iter->second);
     const BrainModelPriv& myModel = m_modelsInfo[iter->second];
-    int64_t numUsed = (int64_t)myModel.m_nodeIndices.size();
+    const vector<int64_t>& nodeIndices = myModel.getNodeIndices();
+    int64_t numUsed = (int64_t)nodeIndices.size();
     ret.resize(numUsed);
     for (int64_t i = 0; i < numUsed; ++i)
     {
         ret[i].m_ciftiIndex = myModel.m_modelStart + i;
-        ret[i].m_surfaceNode = myModel.m_nodeIndices[i];
+        ret[i].m_surfaceNode = nodeIndices[i];
     }
     return ret;
 }
@@ -325,7 +554,8 @@ vector<CiftiBrainModelsMap::VolumeMap> CiftiBrainModelsMap::getFullVolumeMap() c
         if (m_modelsInfo[i].m_type == VOXELS)
         {
             const BrainModelPriv& myModel = m_modelsInfo[i];
-            int64_t listSize = (int64_t)myModel.m_voxelIndicesIJK.size();
+            const vector<int64_t>& voxelIndices = myModel.getVoxelIndicesIJK();
+            int64_t listSize = (int64_t)voxelIndices.size();
             CaretAssert(listSize % 3 == 0);
             int64_t numUsed = listSize / 3;
             if (ret.size() == 0) ret.reserve(numUsed);//keep it from doing multiple expansion copies on the first model
@@ -334,9 +564,9 @@ vector<CiftiBrainModelsMap::VolumeMap> CiftiBrainModelsMap::getFullVolumeMap() c
                 int64_t i3 = i * 3;
                 VolumeMap temp;
                 temp.m_ciftiIndex = myModel.m_modelStart + i;
-                temp.m_ijk[0] = myModel.m_voxelIndicesIJK[i3];
-                temp.m_ijk[1] = myModel.m_voxelIndicesIJK[i3 + 1];
-                temp.m_ijk[2] = myModel.m_voxelIndicesIJK[i3 + 2];
+                temp.m_ijk[0] = voxelIndices[i3];
+                temp.m_ijk[1] = voxelIndices[i3 + 1];
+                temp.m_ijk[2] = voxelIndices[i3 + 2];
                 ret.push_back(temp);
             }
         }
@@ -379,7 +609,8 @@ vector<CiftiBrainModelsMap::VolumeMap> CiftiBrainModelsMap::getVolumeStructureMa
     }
     CaretAssertVectorIndex(m_modelsInfo, iter->second);
     const BrainModelPriv& myModel = m_modelsInfo[iter->second];
-    int64_t listSize = (int64_t)myModel.m_voxelIndicesIJK.size();
+    const vector<int64_t>& voxelIndices = myModel.getVoxelIndicesIJK();
+    int64_t listSize = (int64_t)voxelIndices.size();
     CaretAssert(listSize % 3 == 0);
     int64_t numUsed = listSize / 3;
     ret.resize(numUsed);
@@ -387,9 +618,9 @@ vector<CiftiBrainModelsMap::VolumeMap> CiftiBrainModelsMap::getVolumeStructureMa
     {
         int64_t i3 = i * 3;
         ret[i].m_ciftiIndex = myModel.m_modelStart + i;
-        ret[i].m_ijk[0] = myModel.m_voxelIndicesIJK[i3];
-        ret[i].m_ijk[1] = myModel.m_voxelIndicesIJK[i3 + 1];
-        ret[i].m_ijk[2] = myModel.m_voxelIndicesIJK[i3 + 2];
+        ret[i].m_ijk[0] = voxelIndices[i3];
+        ret[i].m_ijk[1] = voxelIndices[i3 + 1];
+        ret[i].m_ijk[2] = voxelIndices[i3 + 2];
     }
     return ret;
 }
@@ -402,7 +633,7 @@ const vector<int64_t>& CiftiBrainModelsMap::getVoxelList(const StructureEnum::En
         throw DataFileException("getVoxelList called for nonexistant structure");//throw if it doesn't exist, because we don't have a reference to return - things should identify which structures exist before calling this
     }
     CaretAssertVectorIndex(m_modelsInfo, iter->second);
-    return m_modelsInfo[iter->second].m_voxelIndicesIJK;
+    return m_modelsInfo[iter->second].getVoxelIndicesIJK();
 }
 
 bool CiftiBrainModelsMap::hasVolumeData() const
@@ -422,11 +653,12 @@ void CiftiBrainModelsMap::setVolumeSpace(const VolumeSpace& space)
     {
         CaretAssertVectorIndex(m_modelsInfo, iter->second);
         const BrainModelPriv& myModel = m_modelsInfo[iter->second];
-        int64_t listSize = (int64_t)myModel.m_voxelIndicesIJK.size();
+        const vector<int64_t>& voxelIndices = myModel.getVoxelIndicesIJK();
+        int64_t listSize = (int64_t)voxelIndices.size();
         CaretAssert(listSize % 3 == 0);
         for (int64_t i3 = 0; i3 < listSize; i3 += 3)
         {
-            if (!space.indexValid(myModel.m_voxelIndicesIJK[i3], myModel.m_voxelIndicesIJK[i3 + 1], myModel.m_voxelIndicesIJK[i3 + 2]))
+            if (!space.indexValid(voxelIndices[i3], voxelIndices[i3 + 1], voxelIndices[i3 + 2]))
             {
                 throw DataFileException("invalid voxel found for volume space");
             }
@@ -523,18 +755,18 @@ bool CiftiBrainModelsMap::BrainModelPriv::operator==(const BrainModelPriv& rhs)
     if (m_type == SURFACE)
     {
         if (m_surfaceNumberOfNodes != rhs.m_surfaceNumberOfNodes) return false;
-        int64_t listSize = (int64_t)m_nodeIndices.size();
-        CaretAssert((int64_t)rhs.m_nodeIndices.size() == listSize);//this should already be checked by start/end above
-        for (int64_t i = 0; i < listSize; ++i)
+        if (m_nodeIndices != rhs.m_nodeIndices)//shared arrays are equal without looking at them
         {
-            if (m_nodeIndices[i] != rhs.m_nodeIndices[i]) return false;
+            const vector<int64_t>& myNodes = getNodeIndices(), &rhsNodes = rhs.getNodeIndices();
+            CaretAssert(rhsNodes.size() == myNodes.size());//this should already be checked by start/end above
+            if (myNodes != rhsNodes) return false;
         }
     } else {
-        int64_t listSize = (int64_t)m_voxelIndicesIJK.size();
-        CaretAssert((int64_t)rhs.m_voxelIndicesIJK.size() == listSize);//this should already be checked by start/end above
-        for (int64_t i = 0; i < listSize; ++i)
+        if (m_voxelIndicesIJK != rhs.m_voxelIndicesIJK)
         {
-            if (m_voxelIndicesIJK[i] != rhs.m_voxelIndicesIJK[i]) return false;
+            const vector<int64_t>& myVoxels = getVoxelIndicesIJK(), &rhsVoxels = rhs.getVoxelIndicesIJK();
+            CaretAssert(rhsVoxels.size() == myVoxels.size());//this should already be checked by start/end above
+            if (myVoxels != rhsVoxels) return false;
         }
     }
     return true;
@@ -887,26 +1119,62 @@ void CiftiBrainModelsMap::ParseHelperModel::parseBrainModel2(QXmlStreamReader& x
     CaretAssert(xml.isEndElement() && xml.name() == "BrainModel");
 }
 
+namespace
+{
+    bool isIndexArraySpace(const ushort& c)
+    {//same as the ascii part of \s, which is what the array text used to be split on
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+    }
+}
+
 vector<int64_t> CiftiBrainModelsMap::ParseHelperModel::readIndexArray(QXmlStreamReader& xml)
 {
     vector<int64_t> ret;
     QString text = xml.readElementText();//raises error if it encounters a start element
     if (xml.hasError()) return ret;
-    QStringList separated = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
-    int64_t numElems = separated.size();
+    const ushort* chars = text.utf16();//parse the characters in place, splitting into a QStringList makes a QString per index
+    int64_t length = text.size(), numElems = 0;
+    for (int64_t pos = 0; pos < length; ++pos)//count first so we allocate only once
+    {
+        if (!isIndexArraySpace(chars[pos]) && (pos == 0 || isIndexArraySpace(chars[pos - 1]))) ++numElems;
+    }
     ret.reserve(numElems);
-    for (int64_t i = 0; i < numElems; ++i)
+    int64_t pos = 0;
+    while (true)
     {
-        bool ok = false;
-        ret.push_back(separated[i].toLongLong(&ok));
+        while (pos < length && isIndexArraySpace(chars[pos])) ++pos;
+        if (pos == length) break;
+        int64_t tokenStart = pos;
+        bool negative = false;
+        if (chars[pos] == '-' || chars[pos] == '+')
+        {
+            negative = (chars[pos] == '-');
+            ++pos;
+        }
+        bool ok = (pos < length && chars[pos] >= '0' && chars[pos] <= '9');
+        int64_t value = 0;
+        while (pos < length && chars[pos] >= '0' && chars[pos] <= '9')
+        {
+            int64_t digit = chars[pos] - '0';
+            if (value > (numeric_limits<int64_t>::max() - digit) / 10)
+            {
+                ok = false;//don't silently wrap on absurd values
+            } else {
+                value = value * 10 + digit;
+            }
+            ++pos;
+        }
+        if (pos < length && !isIndexArraySpace(chars[pos])) ok = false;
         if (!ok)
         {
-            throw DataFileException("found noninteger in index array: " + separated[i]);
+            while (pos < length && !isIndexArraySpace(chars[pos])) ++pos;
+            throw DataFileException("found noninteger in index array: " + text.mid(tokenStart, pos - tokenStart));
         }
-        if (ret.back() < 0)
+        if (negative && value != 0)
         {
-            throw DataFileException("found negative integer in index array: " + separated[i]);
+            throw DataFileException("found negative integer in index array: " + text.mid(tokenStart, pos - tokenStart));
         }
+        ret.push_back(value);
     }
     return ret;
 }
@@ -929,11 +1197,12 @@ void CiftiBrainModelsMap::writeXML1(QXmlStreamWriter& xml) const
             xml.writeAttribute("SurfaceNumberOfNodes", QString::number(myModel.m_surfaceNumberOfNodes));
             xml.writeStartElement("NodeIndices");
             QString text = "";
-            int64_t numNodes = (int64_t)myModel.m_nodeIndices.size();
+            const vector<int64_t>& nodeIndices = myModel.getNodeIndices();
+            int64_t numNodes = (int64_t)nodeIndices.size();
             for (int64_t j = 0; j < numNodes; ++j)
             {
                 if (j != 0) text += " ";
-                text += QString::number(myModel.m_nodeIndices[j]);
+                text += QString::number(nodeIndices[j]);
             }
             xml.writeCharacters(text);
             xml.writeEndElement();
@@ -941,11 +1210,12 @@ void CiftiBrainModelsMap::writeXML1(QXmlStreamWriter& xml) const
             xml.writeAttribute("ModelType", "CIFTI_MODEL_TYPE_VOXELS");
             xml.writeStartElement("VoxelIndicesIJK");
             QString text = "";
-            int64_t listSize = (int64_t)myModel.m_voxelIndicesIJK.size();
+            const vector<int64_t>& voxelIndices = myModel.getVoxelIndicesIJK();
+            int64_t listSize = (int64_t)voxelIndices.size();
             CaretAssert(listSize % 3 == 0);
             for (int64_t j = 0; j < listSize; j += 3)
             {
-                text += QString::number(myModel.m_voxelIndicesIJK[j]) + " " + QString::number(myModel.m_voxelIndicesIJK[j + 1]) + " " + QString::number(myModel.m_voxelIndicesIJK[j + 2]) + "\n";
+                text += QString::number(voxelIndices[j]) + " " + QString::number(voxelIndices[j + 1]) + " " + QString::number(voxelIndices[j + 2]) + "\n";
             }
             xml.writeCharacters(text);
             xml.writeEndElement();
@@ -976,11 +1246,12 @@ void CiftiBrainModelsMap::writeXML2(QXmlStreamWriter& xml) const
             xml.writeAttribute("SurfaceNumberOfVertices", QString::number(myModel.m_surfaceNumberOfNodes));
             xml.writeStartElement("VertexIndices");
             QString text = "";
-            int64_t numNodes = (int64_t)myModel.m_nodeIndices.size();
+            const vector<int64_t>& nodeIndices = myModel.getNodeIndices();
+            int64_t numNodes = (int64_t)nodeIndices.size();
             for (int64_t j = 0; j < numNodes; ++j)
             {
                 if (j != 0) text += " ";
-                text += QString::number(myModel.m_nodeIndices[j]);
+                text += QString::number(nodeIndices[j]);
             }
             xml.writeCharacters(text);
             xml.writeEndElement();
@@ -988,11 +1259,12 @@ void CiftiBrainModelsMap::writeXML2(QXmlStreamWriter& xml) const
             xml.writeAttribute("ModelType", "CIFTI_MODEL_TYPE_VOXELS");
             xml.writeStartElement("VoxelIndicesIJK");
             QString text = "";
-            int64_t listSize = (int64_t)myModel.m_voxelIndicesIJK.size();
+            const vector<int64_t>& voxelIndices = myModel.getVoxelIndicesIJK();
+            int64_t listSize = (int64_t)voxelIndices.size();
             CaretAssert(listSize % 3 == 0);
             for (int64_t j = 0; j < listSize; j += 3)
             {
-                text += QString::number(myModel.m_voxelIndicesIJK[j]) + " " + QString::number(myModel.m_voxelIndicesIJK[j + 1]) + " " + QString::number(myModel.m_voxelIndicesIJK[j + 2]) + "\n";
+                text += QString::number(voxelIndices[j]) + " " + QString::number(voxelIndices[j + 1]) + " " + QString::number(voxelIndices[j + 2]) + "\n";
             }
             xml.writeCharacters(text);
             xml.writeEndElement();
@@ -23,7 +23,7 @@
 
 #include "CiftiMappingType.h"
 
-#include "CaretCompact3DLookup.h"
+#include "CaretPointer.h"
 #include "StructureEnum.h"
 #include "VolumeSpace.h"
 
@@ -77,6 +77,10 @@ namespace caret
         int64_t getIndexForVoxel(const int64_t* ijk, StructureEnum::Enum* structureOut = NULL) const;
         int64_t getIndexForVoxel(const int64_t& i, const int64_t& j, const int64_t& k, StructureEnum::Enum* structureOut = NULL) const;
         IndexInfo getInfoForIndex(const int64_t index) const;
+        ///batch versions of the above, entries that aren't in the map get -1
+        std::vector<int64_t> getIndicesForNodes(const std::vector<int64_t>& nodeList, const StructureEnum::Enum& structure) const;
+        std::vector<int64_t> getIndicesForVoxels(const std::vector<int64_t>& ijkList, std::vector<StructureEnum::Enum>* structuresOut = NULL) const;//ijkList is i, j, k triples, like getVoxelList
+        std::vector<IndexInfo> getInfoForIndices(const std::vector<int64_t>& indices) const;
         std::vector<SurfaceMap> getSurfaceMap(const StructureEnum::Enum& structure) const;
         std::vector<VolumeMap> getFullVolumeMap() const;
         std::vector<VolumeMap> getVolumeStructureMap(const StructureEnum::Enum& structure) const;
@@ -111,11 +115,15 @@ namespace caret
             ModelType m_type;
             StructureEnum::Enum m_brainStructure;
             int64_t m_surfaceNumberOfNodes;
-            std::vector<int64_t> m_nodeIndices;
-            std::vector<int64_t> m_voxelIndicesIJK;
+            CaretPointer<const std::vector<int64_t> > m_nodeIndices;//index arrays are immutable once set, so copies of the map (cached XML, clones) share them instead of copying
+            CaretPointer<const std::vector<int64_t> > m_voxelIndicesIJK;
             
             int64_t m_modelStart, m_modelEnd;//stuff only needed for optimization - models are kept in sorted order by their index ranges
-            std::vector<int64_t> m_nodeToIndexLookup;
+            CaretPointer<const std::vector<int64_t> > m_nodeToIndexLookup;
+            const std::vector<int64_t>& getNodeIndices() const { return getArray(m_nodeIndices); }
+            const std::vector<int64_t>& getVoxelIndicesIJK() const { return getArray(m_voxelIndicesIJK); }
+            const std::vector<int64_t>& getNodeToIndexLookup() const { return getArray(m_nodeToIndexLookup); }
+            static const std::vector<int64_t>& getArray(const CaretPointer<const std::vector<int64_t> >& array);
             bool operator==(const BrainModelPriv& rhs) const;
             bool operator!=(const BrainModelPriv& rhs) const { return !((*this) == rhs); }
             void setupSurface(const int64_t& start);
@@ -124,8 +132,22 @@ namespace caret
         bool m_haveVolumeSpace, m_ignoreVolSpace;//second is needed for parsing cifti-1
         std::vector<BrainModelPriv> m_modelsInfo;
         std::map<StructureEnum::Enum, int> m_surfUsed, m_volUsed;
-        CaretCompact3DLookup<std::pair<int64_t, StructureEnum::Enum> > m_voxelToIndexLookup;//make one unified lookup rather than separate lookups per volume structure
+        struct VoxelLookup
+        {//one unified lookup rather than separate lookups per volume structure
+            int64_t m_min[3], m_dims[3];//bounding box of all voxels in the map
+            bool m_dense;
+            std::vector<uint64_t> m_bits;//dense: one bit per voxel in the bounding box
+            std::vector<int64_t> m_wordRank;//dense: number of set bits before each word, so entries are ordered by linear index
+            std::vector<int64_t> m_hashIJK;//sparse: open addressing table of voxel triples, used when the bounding box is mostly empty
+            uint64_t m_hashMask;
+            std::vector<int64_t> m_entryIndex;//cifti index for each entry, -1 for empty hash slots
+            std::vector<StructureEnum::Enum> m_entryStructure;
+            explicit VoxelLookup(const std::vector<BrainModelPriv>& models);//throws if a voxel is used twice
+            int64_t findEntry(const int64_t& i, const int64_t& j, const int64_t& k) const;
+        };
+        CaretPointer<const VoxelLookup> m_voxelLookup;//immutable once built, so copies of the map share it
         int64_t getNextStart() const;
+        int findModelForIndex(const int64_t& index) const;
         struct ParseHelperModel
         {//specifically to allow the parsed elements to be sorted before using addSurfaceModel/addVolumeModel
             ModelType m_type;
@@ -24,12 +24,17 @@
 #include "CaretAssert.h"
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
+#include "CaretMutex.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "MultiDimArray.h"
 #include "MultiDimIterator.h"
 #include "NiftiIO.h"
 
+#include <QHash>
+
+#include <list>
+
 using namespace std;
 using namespace caret;
 
@@ -97,6 +102,48 @@ namespace
         return (endian == CiftiFile::ANY);
     }
     
+    //parsing the XML is a visible part of opening a dense file, and group analyses open many files with the same grayordinates and XML
+    struct CiftiXMLCacheEntry
+    {
+        uint m_hash;
+        QByteArray m_bytes;//compare the full extension on a hash match, parsed XML must never come from a different file's header
+        CiftiXML m_xml;
+    };
+    list<CiftiXMLCacheEntry> s_xmlCache;//most recently used first
+    CaretMutex s_xmlCacheMutex;
+    const int XML_CACHE_MAX_ENTRIES = 4;//a full dconn XML is a few MB of text plus the parsed maps, so keep this small
+    
+    void readCiftiXMLCached(const QByteArray& bytes, CiftiXML& xmlOut)
+    {
+        uint hash = qHash(bytes);
+        {
+            CaretMutexLocker locked(&s_xmlCacheMutex);
+            for (list<CiftiXMLCacheEntry>::iterator iter = s_xmlCache.begin(); iter != s_xmlCache.end(); ++iter)
+            {
+                if (iter->m_hash == hash && iter->m_bytes == bytes)
+                {
+                    s_xmlCache.splice(s_xmlCache.begin(), s_xmlCache, iter);
+                    xmlOut = s_xmlCache.front().m_xml;//copies of brain models maps share their index arrays and voxel lookup
+                    return;
+                }
+            }
+        }
+        xmlOut.readXML(bytes);//parse without holding the lock, a parse error throws before anything is cached
+        CaretMutexLocker locked(&s_xmlCacheMutex);
+        CiftiXMLCacheEntry newEntry;
+        newEntry.m_hash = hash;
+        newEntry.m_bytes = bytes;
+        newEntry.m_xml = xmlOut;
+        s_xmlCache.push_front(newEntry);
+        while ((int)s_xmlCache.size() > XML_CACHE_MAX_ENTRIES) s_xmlCache.pop_back();
+    }
+    
+}
+
+void CiftiFile::clearXMLCache()
+{
+    CaretMutexLocker locked(&s_xmlCacheMutex);
+    s_xmlCache.clear();
 }
 
 CiftiFile::ReadImplInterface::~ReadImplInterface()
@@ -473,7 +520,7 @@ CiftiOnDiskImpl::CiftiOnDiskImpl(const QString& filename)
         }
     }
     if (whichExt == -1) throw DataFileException("no cifti extension found in file '" + filename + "'");
-    m_xml.readXML(QByteArray(myHeader.m_extensions[whichExt]->m_bytes.data(), myHeader.m_extensions[whichExt]->m_bytes.size()));//CiftiXML should be under 2GB
+    readCiftiXMLCached(QByteArray(myHeader.m_extensions[whichExt]->m_bytes.data(), myHeader.m_extensions[whichExt]->m_bytes.size()), m_xml);//CiftiXML should be under 2GB
     vector<int64_t> dimCheck = m_nifti.getDimensions();
     if (dimCheck.size() < 5)
     {
@@ -86,6 +86,8 @@ namespace caret
         
         void setRow(const float* dataIn, const int64_t& index);//backwards compatibility for old CiftiFile
         
+        static void clearXMLCache();//parsed XML of recently opened files is kept for reuse, programs clear it before checking for leaked objects
+        
         class ReadImplInterface
         {
         public:
@@ -0,0 +1,103 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiGroupBlockReader.h"
+
+#include "CaretAssert.h"
+#include "CaretOMP.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+
+#include <algorithm>
+#include <exception>
+
+using namespace std;
+using namespace caret;
+
+namespace
+{
+    const int64_t GROUP_BLOCK_BYTES = ((int64_t)1) << 28;//read about 256MB of input rows per block, across all files
+}
+
+CiftiGroupBlockReader::CiftiGroupBlockReader(const vector<const CiftiFile*>& inputs, const int64_t& outputBytesPerRow)
+{
+    CaretAssert(!inputs.empty());
+    int numInputs = (int)inputs.size();
+    m_bufferIndex.resize(numInputs);
+    int64_t totalRowBytes = outputBytesPerRow;
+    for (int i = 0; i < numInputs; ++i)
+    {
+        CaretAssert(inputs[i] != NULL);
+        vector<const CiftiFile*>::iterator iter = find(m_uniqueFiles.begin(), m_uniqueFiles.end(), inputs[i]);
+        m_bufferIndex[i] = (int)(iter - m_uniqueFiles.begin());
+        if (iter == m_uniqueFiles.end())
+        {
+            m_uniqueFiles.push_back(inputs[i]);
+            m_uniqueRowLengths.push_back(inputs[i]->getCiftiXML().getDimensionLength(CiftiXML::ALONG_ROW));
+            totalRowBytes += m_uniqueRowLengths.back() * sizeof(float);
+        }
+    }
+    m_numRows = inputs[0]->getCiftiXML().getDimensionLength(CiftiXML::ALONG_COLUMN);
+    m_blockRows = max((int64_t)1, min(m_numRows, GROUP_BLOCK_BYTES / max((int64_t)1, totalRowBytes)));
+    m_buffers.resize(m_uniqueFiles.size());
+}
+
+void CiftiGroupBlockReader::readBlock(const int64_t& startRow, const int64_t& numRows)
+{
+    CaretAssert(startRow >= 0 && numRows <= m_blockRows && startRow + numRows <= m_numRows);
+    int numUnique = (int)m_uniqueFiles.size();
+    AString errorMessage;
+#pragma omp CARET_PARFOR schedule(dynamic)
+    for (int i = 0; i < numUnique; ++i)
+    {
+        try
+        {
+            int64_t thisRowLength = m_uniqueRowLengths[i];
+            m_buffers[i].resize(numRows * thisRowLength);
+            for (int64_t row = 0; row < numRows; ++row)
+            {
+                m_uniqueFiles[i]->getRow(m_buffers[i].data() + row * thisRowLength, startRow + row);
+            }
+        } catch (CaretException& e) {//exceptions can't leave an openmp region
+#pragma omp critical
+            {
+                errorMessage = e.whatString();
+            }
+        } catch (std::exception& e) {//such as bad_alloc from the buffers
+#pragma omp critical
+            {
+                errorMessage = e.what();
+            }
+        }
+    }
+    if (errorMessage != "") throw DataFileException(errorMessage);
+}
+
+const float* CiftiGroupBlockReader::getBlockData(const int& inputIndex) const
+{
+    CaretAssertVectorIndex(m_bufferIndex, inputIndex);
+    return m_buffers[m_bufferIndex[inputIndex]].data();
+}
+
+int64_t CiftiGroupBlockReader::getRowLength(const int& inputIndex) const
+{
+    CaretAssertVectorIndex(m_bufferIndex, inputIndex);
+    return m_uniqueRowLengths[m_bufferIndex[inputIndex]];
+}
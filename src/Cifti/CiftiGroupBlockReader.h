@@ -0,0 +1,66 @@
+#ifndef __CIFTI_GROUP_BLOCK_READER_H__
+#define __CIFTI_GROUP_BLOCK_READER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret
+{
+    
+    class CiftiFile;
+    
+    ///reads blocks of rows from a group of 2D cifti files with the same number of rows, with different files read concurrently
+    ///a single CiftiFile can't read from multiple threads, so an input given more than once is only read once
+    class CiftiGroupBlockReader
+    {
+        std::vector<const CiftiFile*> m_uniqueFiles;
+        std::vector<int> m_bufferIndex;
+        std::vector<int64_t> m_uniqueRowLengths;
+        std::vector<std::vector<float> > m_buffers;
+        int64_t m_numRows, m_blockRows;
+        
+        CiftiGroupBlockReader(const CiftiGroupBlockReader&);
+        CiftiGroupBlockReader& operator=(const CiftiGroupBlockReader&);
+    public:
+        ///outputBytesPerRow is memory the caller uses for each row of a block, which is included when choosing the block size
+        CiftiGroupBlockReader(const std::vector<const CiftiFile*>& inputs, const int64_t& outputBytesPerRow = 0);
+        
+        ///number of rows in the files
+        int64_t getNumberOfRows() const { return m_numRows; }
+        
+        ///number of rows read by a full block, chosen to keep the buffers at about 256MB
+        int64_t getBlockRows() const { return m_blockRows; }
+        
+        ///read rows [startRow, startRow + numRows) of every distinct input, throws DataFileException if any read fails
+        void readBlock(const int64_t& startRow, const int64_t& numRows);
+        
+        ///rows of the last block read for an input, each row is the length of that input's rows
+        const float* getBlockData(const int& inputIndex) const;
+        
+        ///length of the rows of an input
+        int64_t getRowLength(const int& inputIndex) const;
+    };
+    
+}
+
+#endif //__CIFTI_GROUP_BLOCK_READER_H__
@@ -279,8 +279,9 @@ void CiftiXML::readXML(const QString& text)
 
 void CiftiXML::readXML(const QByteArray& data)
 {
-    QString text(data);//constructing a qstring appears to be the simplest way to remove trailing nulls, which otherwise trip an "Extra content at end of document" error
-    readXML(text);//then put it through the string reader, just to simplify code paths
+    int length = (int)qstrnlen(data.constData(), data.size());//stop at the first null, like QString(QByteArray) did - trailing nulls otherwise trip an "Extra content at end of document" error
+    QXmlStreamReader xml(QByteArray::fromRawData(data.constData(), length));//let the reader decode the bytes itself, rather than converting the whole document to a QString first
+    readXML(xml);
 }
 
 int32_t CiftiXML::getIntentInfo(const CiftiVersion& writingVersion, char intentNameOut[16]) const
@@ -29,6 +29,7 @@
 #include "CaretHttpManager.h"
 #include "CaretCommandLine.h"
 #include "CaretLogger.h"
+#include "CiftiFile.h"
 #include "CommandOperationManager.h"
 #include "ProgramParameters.h"
 #include "SessionManager.h"
@@ -151,6 +152,7 @@ int main(int argc, char* argv[]) {
          */
         SessionManager::deleteSessionManager();
         CaretHttpManager::deleteHttpManager();//does this belong in some other singleton manager?
+        CiftiFile::clearXMLCache();//parsed XML kept for reopening files, would show up as objects not deleted
         myApp.processEvents();//since we don't exec(), let it clean up any ->deleteLater()s
     }
     /*
@@ -0,0 +1,160 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CommandInputFileCache.h"
+
+#include "CaretDataFile.h"
+#include "CaretLogger.h"
+#include "CaretMappableDataFile.h"
+#include "SurfaceFile.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include <algorithm>
+
+using namespace caret;
+using namespace std;
+
+list<CommandInputFileCache::Entry> CommandInputFileCache::s_entries;
+int CommandInputFileCache::s_maxFiles = 0;
+int64_t CommandInputFileCache::s_maxBytes = ((int64_t)4) << 30;
+int64_t CommandInputFileCache::s_totalBytes = 0;
+
+bool CommandInputFileCache::getFileKey(const AString& fileName, AString& canonicalPathOut, int64_t& modifiedMSecsOut, int64_t& sizeOut)
+{
+    QFileInfo myInfo(fileName);
+    if (!myInfo.exists() || !myInfo.isFile()) return false;//don't try to cache remote files, or anything else odd
+    canonicalPathOut = myInfo.canonicalFilePath();
+    modifiedMSecsOut = myInfo.lastModified().toMSecsSinceEpoch();
+    sizeOut = myInfo.size();
+    return true;
+}
+
+const CaretDataFile* CommandInputFileCache::findFile(const AString& fileName)
+{
+    AString canonicalPath;
+    int64_t modifiedMSecs, size;
+    if (!getFileKey(fileName, canonicalPath, modifiedMSecs, size)) return NULL;
+    for (list<Entry>::iterator iter = s_entries.begin(); iter != s_entries.end(); ++iter)
+    {
+        if (iter->m_canonicalPath == canonicalPath)
+        {
+            if (iter->m_modifiedMSecs != modifiedMSecs || iter->m_size != size)
+            {//file changed on disk, the caller will read it again
+                removeEntry(iter);
+                return NULL;
+            }
+            s_entries.splice(s_entries.begin(), s_entries, iter);//mark as most recently used
+            CaretLogFine("using cached copy of input file '" + fileName + "'");
+            return s_entries.front().m_file;
+        }
+    }
+    return NULL;
+}
+
+int64_t CommandInputFileCache::getCacheableSize(const CaretDataFile* file, const AString& fileName)
+{
+    int64_t ret = -1;
+    const CaretMappableDataFile* mappable = dynamic_cast<const CaretMappableDataFile*>(file);
+    const SurfaceFile* surface = dynamic_cast<const SurfaceFile*>(file);
+    if (mappable != NULL)
+    {
+        ret = mappable->getDataSizeUncompressedInBytes();
+    } else if (surface != NULL) {
+        ret = ((int64_t)surface->getNumberOfNodes()) * 3 * sizeof(float) + ((int64_t)surface->getNumberOfTriangles()) * 3 * sizeof(int32_t);
+    } else {//borders and foci are small, their size on disk is a good enough estimate
+        ret = QFileInfo(fileName).size();
+    }
+    if (ret > s_maxBytes / 4)
+    {
+        CaretLogFine("not caching input file '" + fileName + "', " + AString::number(ret) + " bytes is too large");
+        return -1;
+    }
+    return ret;
+}
+
+void CommandInputFileCache::addFile(const AString& fileName, CaretDataFile* file, const int64_t& dataBytes)
+{
+    CaretPointer<CaretDataFile> myFile(file);//take ownership before anything can throw
+    Entry newEntry;
+    if (!getFileKey(fileName, newEntry.m_canonicalPath, newEntry.m_modifiedMSecs, newEntry.m_size)) return;
+    for (list<Entry>::iterator iter = s_entries.begin(); iter != s_entries.end(); ++iter)
+    {
+        if (iter->m_canonicalPath == newEntry.m_canonicalPath)
+        {//same file read as a different type, or changed on disk
+            removeEntry(iter);
+            break;
+        }
+    }
+    newEntry.m_dataBytes = dataBytes;
+    newEntry.m_file = myFile;
+    s_entries.push_front(newEntry);
+    s_totalBytes += dataBytes;
+    trimToLimits();
+}
+
+void CommandInputFileCache::removeEntry(const list<Entry>::iterator& iter)
+{
+    s_totalBytes -= iter->m_dataBytes;
+    s_entries.erase(iter);
+}
+
+void CommandInputFileCache::trimToLimits()
+{//least recently used are at the back
+    while (!s_entries.empty() && ((int)s_entries.size() > s_maxFiles || s_totalBytes > s_maxBytes))
+    {
+        removeEntry(--s_entries.end());
+    }
+}
+
+void CommandInputFileCache::setMaximumFiles(const int& maxFiles)
+{
+    s_maxFiles = max(0, maxFiles);
+    trimToLimits();
+}
+
+void CommandInputFileCache::setMaximumBytes(const int64_t& maxBytes)
+{
+    s_maxBytes = max((int64_t)0, maxBytes);
+    trimToLimits();
+}
+
+void CommandInputFileCache::invalidateFile(const AString& fileName)
+{
+    if (s_entries.empty()) return;
+    QFileInfo myInfo(fileName);
+    AString canonicalPath = myInfo.canonicalFilePath();//empty if it doesn't exist, and then it can't be in the cache
+    if (canonicalPath == "") return;
+    for (list<Entry>::iterator iter = s_entries.begin(); iter != s_entries.end(); ++iter)
+    {
+        if (iter->m_canonicalPath == canonicalPath)
+        {
+            removeEntry(iter);
+            return;
+        }
+    }
+}
+
+void CommandInputFileCache::clear()
+{
+    s_entries.clear();
+    s_totalBytes = 0;
+}
@@ -0,0 +1,96 @@
+#ifndef __COMMAND_INPUT_FILE_CACHE_H__
+#define __COMMAND_INPUT_FILE_CACHE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretPointer.h"
+#include "AString.h"
+
+#include <list>
+
+namespace caret {
+
+    class CaretDataFile;
+    
+    /// Keeps recently read command input files in memory, so that batch mode doesn't parse the same file for every command that uses it
+    class CommandInputFileCache
+    {
+        struct Entry
+        {
+            AString m_canonicalPath;
+            int64_t m_modifiedMSecs, m_size;
+            int64_t m_dataBytes;//in-memory size, counted against the byte budget
+            CaretPointer<CaretDataFile> m_file;
+        };
+        static std::list<Entry> s_entries;//most recently used first
+        static int s_maxFiles;
+        static int64_t s_maxBytes, s_totalBytes;
+        static bool getFileKey(const AString& fileName, AString& canonicalPathOut, int64_t& modifiedMSecsOut, int64_t& sizeOut);
+        static const CaretDataFile* findFile(const AString& fileName);
+        ///returns the in-memory size of the file's data, or -1 if it is too large to be worth keeping
+        static int64_t getCacheableSize(const CaretDataFile* file, const AString& fileName);
+        static void addFile(const AString& fileName, CaretDataFile* file, const int64_t& dataBytes);//takes ownership
+        static void removeEntry(const std::list<Entry>::iterator& iter);
+        static void trimToLimits();
+    public:
+        ///set how many files to keep, 0 (the default) disables caching
+        static void setMaximumFiles(const int& maxFiles);
+        static int getMaximumFiles() { return s_maxFiles; }
+        ///set how much file data to keep, files larger than a quarter of this are not kept at all
+        static void setMaximumBytes(const int64_t& maxBytes);
+        static int64_t getMaximumBytes() { return s_maxBytes; }
+        ///forget a file, because something is about to write it (the modification time usually catches this, but may not have enough resolution)
+        static void invalidateFile(const AString& fileName);
+        static void clear();
+        ///read a file, or copy it from the cache if it hasn't changed on disk - the caller gets its own copy, as some commands modify their inputs
+        template <typename T>
+        static CaretPointer<T> readFile(const AString& fileName);
+    };
+    
+    template <typename T>
+    CaretPointer<T> CommandInputFileCache::readFile(const AString& fileName)
+    {
+        CaretPointer<T> ret;
+        if (s_maxFiles > 0)
+        {
+            const T* cached = dynamic_cast<const T*>(findFile(fileName));
+            if (cached != NULL)
+            {
+                ret.grabNew(new T(*cached));
+                return ret;
+            }
+        }
+        ret.grabNew(new T());
+        ret->readFile(fileName);
+        if (s_maxFiles > 0)
+        {
+            const int64_t dataBytes = getCacheableSize(ret, fileName);
+            if (dataBytes >= 0)//don't make the extra copy of files that won't be kept
+            {
+                addFile(fileName, new T(*ret), dataBytes);
+            }
+        }
+        return ret;
+    }
+    
+}
+
+#endif //__COMMAND_INPUT_FILE_CACHE_H__
@@ -241,16 +241,67 @@
 #include "CommandUnitTest.h"
 #include "ProgramParameters.h"
 
+#include "CaretCommandLine.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
+#include "CommandInputFileCache.h"
 #include "dot_wrapper.h"
+#include "ElapsedTimer.h"
 #include "StructureEnum.h"
 
+#include <fstream>
 #include <iostream>
 #include <map>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    //dot.h has no way to ask which implementation is in use, so remember what -simd last asked for
+    DotSIMDEnum::Enum currentSIMDImpl = DOT_AUTO;
+    
+    //puts back the global option state after each batch line, including when it throws, as global options only apply to the line they are on
+    struct BatchLineStateRestorer
+    {
+        LogLevelEnum::Enum m_logLevel;
+        DotSIMDEnum::Enum m_simdImpl;
+        BatchLineStateRestorer()
+        {
+            m_logLevel = CaretLogger::getLogger()->getLevel();
+            m_simdImpl = currentSIMDImpl;
+        }
+        ~BatchLineStateRestorer()
+        {
+            CaretLogger::getLogger()->setLevel(m_logLevel);
+            if (currentSIMDImpl != m_simdImpl)
+            {
+                dot_set_impl(m_simdImpl);
+                currentSIMDImpl = m_simdImpl;
+            }
+        }
+    };
+    
+    //writes the -profile output when the command finishes, including when it throws
+    struct ProfileWriter
+    {
+        AString m_fileName, m_commandLine;
+        bool m_active;
+        ProfileWriter() { m_active = false; }
+        ~ProfileWriter()
+        {
+            if (!m_active) return;
+            try
+            {
+                CaretProfiler::writeTrace(m_fileName, m_commandLine);
+            } catch (CaretException& e) {
+                CaretLogWarning(e.whatString());//don't throw from a destructor
+            }
+            CaretProfiler::disable();
+        }
+    };
+}
+
 /**
  * Get the command operation manager.
  *
@@ -284,6 +335,7 @@ CommandOperationManager::deleteCommandOperationManager()
  */
 CommandOperationManager::CommandOperationManager()
 {
+    this->inBatchMode = false;
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmBorderResample()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmBorderToVertices()));
     this->commandOperations.push_back(new CommandParser(new AutoAlgorithmCiftiAllLabelsToROIs()));
@@ -572,6 +624,7 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
         const DotSIMDEnum::Enum impl = DotSIMDEnum::fromName(globalOptionArgs[0], &valid);
         if (!valid) throw CommandException("unrecognized SIMD type: '" + globalOptionArgs[0] + "'");
         DotSIMDEnum::Enum retval = dot_set_impl(impl);
+        currentSIMDImpl = impl;
         if (impl != DOT_AUTO && retval != impl)
         {
             CaretLogWarning("SIMD type '" + DotSIMDEnum::toName(impl) + "' not supported (could be cpu, compiler, or build options), using '" + DotSIMDEnum::toName(retval) + "'");
@@ -593,6 +646,19 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
         ciftiMax = globalOptionArgs[1].toDouble(&valid);
         if (!valid) throw CommandException("non-numeric option to -cifti-output-range: '" + globalOptionArgs[1] + "'");
     }
+    ProfileWriter myProfileWriter;
+    if (getGlobalOption(parameters, "-profile", 1, globalOptionArgs))
+    {
+        if (CaretProfiler::isEnabled())
+        {//batch mode with -profile on the -batch command
+            CaretLogWarning("already profiling, ignoring '-profile " + globalOptionArgs[0] + "'");
+        } else {
+            myProfileWriter.m_fileName = globalOptionArgs[0];
+            myProfileWriter.m_commandLine = caret_global_commandLine;
+            myProfileWriter.m_active = true;
+            CaretProfiler::enable();
+        }
+    }
 
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
@@ -604,6 +670,7 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
     
     AString commandSwitch;
     commandSwitch = fixUnicode(parameters.nextString("Command Name"), false);
+    CaretProfilerSection commandSection(commandSwitch, "command");
     
     //hardcode program name, instead of taking it from the parameters, so that it doesn't include path or show wrapper script details
     const AString myProgramName = "wb_command";
@@ -628,6 +695,31 @@ CommandOperationManager::runCommand(ProgramParameters& parameters)
         printDeprecatedCommands();
     } else if (commandSwitch == "-all-commands-help") {
         printAllCommandsHelpInfo(myProgramName);
+    } else if (commandSwitch == "-batch") {
+        if (!parameters.hasNext())
+        {
+            printBatchHelp(myProgramName);
+            return;
+        }
+        AString scriptName = parameters.nextString("batch script");
+        int maxCachedFiles = 16;
+        int64_t maxCachedMB = 4096;
+        while (parameters.hasNext())
+        {
+            AString option = parameters.nextString("batch option");
+            if (option == "-cache-files")
+            {
+                maxCachedFiles = parameters.nextInt("number of files to cache");
+                if (maxCachedFiles < 0) throw CommandException("number of files to cache must not be negative");
+            } else if (option == "-cache-memory") {
+                maxCachedMB = parameters.nextLong("megabytes of files to cache");
+                if (maxCachedMB < 0) throw CommandException("megabytes of files to cache must not be negative");
+            } else {
+                throw CommandException("unrecognized option to -batch: '" + option + "'");
+            }
+        }
+        parameters.verifyAllParametersProcessed();
+        runBatch(scriptName, maxCachedFiles, maxCachedMB * 1024 * 1024);
     } else {
         
         CommandOperation* operation = NULL;
@@ -716,12 +808,17 @@ AString CommandOperationManager::doCompletion(ProgramParameters& parameters, con
     {//can't tab complete a literal number
         return "";
     }
-    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
+    OptionInfo profileInfo = parseGlobalOption(parameters, "-profile", 1, globalOptionArgs, true);
+    if (profileInfo.specified && !profileInfo.complete)
+    {
+        return "fileglob *.json";
+    }
+    ret = "wordlist -disable-provenance\\ -logging\\ -simd\\ -cifti-output-datatype\\ -cifti-output-range\\ -profile";//we could prevent suggesting an already-provided global option, but that would be a bit surprising
     const uint64_t numberOfCommands = this->commandOperations.size();
     const uint64_t numberOfDeprecated = this->deprecatedOperations.size();
     if (!parameters.hasNext())
     {//suggest all commands, including deprecated and informational (order doesn't matter, bash sorts them before displaying)
-        ret += "\\ -help\\ -arguments-help\\ -cifti-help\\ -gifti-help\\ -parallel-help\\ -version\\ -list-commands\\ -list-deprecated-commands\\ -all-commands-help";
+        ret += "\\ -help\\ -batch\\ -arguments-help\\ -cifti-help\\ -gifti-help\\ -parallel-help\\ -version\\ -list-commands\\ -list-deprecated-commands\\ -all-commands-help";
         for (uint64_t i = 0; i < numberOfCommands; i++)
         {
             ret += "\\ " + commandOperations[i]->getCommandLineSwitch();
@@ -977,6 +1074,9 @@ void CommandOperationManager::printHelpInfo()
     cout << "   -list-deprecated-commands   list deprecated subcommands" << endl;
     cout << "   -all-commands-help          show all processing subcommands and their help" << endl;
     cout << "                                  info - VERY LONG" << endl;
+    cout << endl << "Batch processing:" << endl;
+    cout << "   -batch <script>             run many commands in one process, see -batch" << endl;
+    cout << "                                  with no arguments for details" << endl;
     cout << endl;
     cout << "To get the help information of a processing subcommand, run it without any" << endl;
     cout << "   additional arguments." << endl;
@@ -1089,9 +1189,11 @@ void CommandOperationManager::printGlobalOptions()
     cout << endl;//add a line after the logging types for readability
     //guide for wrap, assuming 80 columns:                                                  |
     cout << "   -simd <type>                      set the SIMD implementation to use" << endl;
-    cout << "                                        (currently used only for correlation," << endl;
-    cout << "                                        default AUTO which selects fastest" << endl;
-    cout << "                                        supported), valid values are:" << endl;
+    cout << "                                        (currently used only by" << endl;
+    cout << "                                        -cifti-correlation and" << endl;
+    cout << "                                        -cifti-correlation-gradient, default" << endl;
+    cout << "                                        AUTO which selects fastest supported)," << endl;
+    cout << "                                        valid values are:" << endl;
     vector<DotSIMDEnum::Enum> simdTypes = DotSIMDEnum::getAllEnums();
     for (vector<DotSIMDEnum::Enum>::iterator iter = simdTypes.begin();
          iter != simdTypes.end();
@@ -1099,6 +1201,14 @@ void CommandOperationManager::printGlobalOptions()
         cout << "         " << DotSIMDEnum::toName(*iter) << endl;
     }
     cout << endl;
+    //guide for wrap, assuming 80 columns:                                                  |
+    cout << "   -profile <file>                   write a timing profile of the command to" << endl;
+    cout << "                                        a file, in chrome trace event JSON" << endl;
+    cout << "                                        format (open it with chrome://tracing" << endl;
+    cout << "                                        or ui.perfetto.dev), including file" << endl;
+    cout << "                                        sizes read and written, peak memory," << endl;
+    cout << "                                        and average busy threads" << endl;
+    cout << endl;
 }
 
 void CommandOperationManager::printCiftiHelp()
@@ -1216,6 +1326,205 @@ void CommandOperationManager::printParallelHelp(const AString& programName)
     cout << endl;//guide for wrap, assuming 80 columns:                                     |
 }
 
+void CommandOperationManager::printBatchHelp(const AString& programName)
+{
+    cout << "RUN MANY COMMANDS IN ONE PROCESS" << endl;
+    cout << "   " << programName << " -batch <script> [-cache-files <count>] [-cache-memory <MB>]" << endl;
+    cout << endl;//guide for wrap, assuming 80 columns:                                     |
+    cout << "   Reads commands from the script file (use '-' for standard input), one per" << endl;
+    cout << "   line, each written as the arguments that would follow '" << programName << "'" << endl;
+    cout << "   on the command line.  A leading '" << programName << "' on a line is ignored.  Words" << endl;
+    cout << "   are separated by whitespace, and can be quoted with ' or \" as in bash, a" << endl;
+    cout << "   backslash at the end of a line continues the command on the next line, and" << endl;
+    cout << "   lines starting with # are comments.  Global options must be given on each" << endl;
+    cout << "   line they are to apply to.  Commands are run in order, and the batch stops" << endl;
+    cout << "   at the first command that fails.  The time each command took is printed to" << endl;
+    cout << "   standard error." << endl;
+    cout << endl;//guide for wrap, assuming 80 columns:                                     |
+    cout << "   Input surface, metric, label, volume, border, and foci files are kept in" << endl;
+    cout << "   memory after they are read, so later commands that use the same file don't" << endl;
+    cout << "   need to read it again, unless the file has changed on disk.  -cache-files" << endl;
+    cout << "   sets how many files to keep (default 16), 0 disables this.  -cache-memory" << endl;
+    cout << "   sets how many megabytes of file data to keep (default 4096), and files" << endl;
+    cout << "   larger than a quarter of this are not kept.  Cifti files are not kept, as" << endl;
+    cout << "   they are generally read from disk as needed." << endl;
+    cout << endl;//guide for wrap, assuming 80 columns:                                     |
+    cout << "   Example script:" << endl;
+    cout << endl;
+    cout << "-metric-smoothing sub1.L.midthickness.surf.gii sub1.L.thickness.shape.gii 2 \\" << endl;
+    cout << "    sub1.L.thickness_s2.shape.gii" << endl;
+    cout << "-metric-smoothing sub1.L.midthickness.surf.gii sub1.L.curvature.shape.gii 2 \\" << endl;
+    cout << "    sub1.L.curvature_s2.shape.gii" << endl;
+    cout << endl;
+}
+
+bool CommandOperationManager::splitBatchLine(const AString& line, vector<AString>& argumentsOut, bool& inSingleQuote, bool& inDoubleQuote, AString& currentArgument, bool& haveArgument)
+{//returns true if the command continues on the next line
+    int length = line.length();
+    for (int i = 0; i < length; ++i)
+    {
+        QChar c = line[i];
+        if (inSingleQuote)
+        {
+            if (c == '\'')
+            {
+                inSingleQuote = false;
+            } else {
+                currentArgument += c;
+            }
+            continue;
+        }
+        if (inDoubleQuote)
+        {
+            if (c == '"')
+            {
+                inDoubleQuote = false;
+            } else if (c == '\\' && i + 1 < length && (line[i + 1] == '"' || line[i + 1] == '\\' || line[i + 1] == '$' || line[i + 1] == '`')) {
+                ++i;
+                currentArgument += line[i];
+            } else if (c == '\\' && i + 1 == length) {
+                return true;//newline is removed inside double quotes when escaped
+            } else {
+                currentArgument += c;
+            }
+            continue;
+        }
+        if (c.isSpace())
+        {
+            if (haveArgument)
+            {
+                argumentsOut.push_back(currentArgument);
+                currentArgument = "";
+                haveArgument = false;
+            }
+        } else if (c == '#' && !haveArgument) {
+            break;//comment, to end of line
+        } else if (c == '\'') {
+            inSingleQuote = true;
+            haveArgument = true;
+        } else if (c == '"') {
+            inDoubleQuote = true;
+            haveArgument = true;
+        } else if (c == '\\') {
+            if (i + 1 == length)
+            {
+                if (haveArgument)
+                {
+                    argumentsOut.push_back(currentArgument);
+                    currentArgument = "";
+                    haveArgument = false;
+                }
+                return true;
+            }
+            ++i;
+            currentArgument += line[i];
+            haveArgument = true;
+        } else {
+            currentArgument += c;
+            haveArgument = true;
+        }
+    }
+    if (inSingleQuote || inDoubleQuote)
+    {
+        currentArgument += '\n';//quoted newline is part of the argument
+        return true;
+    }
+    if (haveArgument)
+    {
+        argumentsOut.push_back(currentArgument);
+        currentArgument = "";
+        haveArgument = false;
+    }
+    return false;
+}
+
+void CommandOperationManager::runBatch(const AString& scriptName, const int& maxCachedFiles, const int64_t& maxCachedBytes)
+{
+    if (inBatchMode) throw CommandException("-batch can't be used inside a batch script");
+    ifstream scriptFile;
+    istream* input = &cin;
+    if (scriptName != "-")
+    {
+        scriptFile.open(scriptName.toLocal8Bit().constData());
+        if (!scriptFile) throw CommandException("unable to open batch script '" + scriptName + "'");
+        input = &scriptFile;
+    }
+    const AString batchCommandLine = caret_global_commandLine;
+    inBatchMode = true;
+    CommandInputFileCache::setMaximumFiles(maxCachedFiles);
+    CommandInputFileCache::setMaximumBytes(maxCachedBytes);
+    ElapsedTimer totalTimer;
+    totalTimer.start();
+    int numCommands = 0;
+    int lineNumber = 0;
+    try
+    {
+        string rawLine;
+        while (getline(*input, rawLine))
+        {
+            ++lineNumber;
+            int firstLine = lineNumber;
+            vector<AString> arguments;
+            bool inSingleQuote = false, inDoubleQuote = false, haveArgument = false;
+            AString currentArgument;
+            bool continued = true;
+            while (continued)
+            {
+                if (!rawLine.empty() && rawLine[rawLine.size() - 1] == '\r') rawLine.resize(rawLine.size() - 1);//tolerate windows line endings
+                continued = splitBatchLine(AString::fromLocal8Bit(rawLine.c_str()), arguments, inSingleQuote, inDoubleQuote, currentArgument, haveArgument);
+                if (continued)
+                {
+                    if (!getline(*input, rawLine))
+                    {
+                        if (inSingleQuote || inDoubleQuote) throw CommandException("unterminated quote in batch command starting on line " + AString::number(firstLine));
+                        continued = false;
+                        if (haveArgument) arguments.push_back(currentArgument);
+                    } else {
+                        ++lineNumber;
+                    }
+                }
+            }
+            if (!arguments.empty() && (arguments[0] == "wb_command" || arguments[0].endsWith("/wb_command")))
+            {
+                arguments.erase(arguments.begin());
+            }
+            if (arguments.empty()) continue;
+            vector<QByteArray> argStorage(1, QByteArray("wb_command"));//use the normal constructor, so the program name is set the same way
+            for (size_t i = 0; i < arguments.size(); ++i)
+            {
+                argStorage.push_back(arguments[i].toLocal8Bit());
+            }
+            vector<const char*> argPointers(argStorage.size());
+            for (size_t i = 0; i < argStorage.size(); ++i)
+            {
+                argPointers[i] = argStorage[i].constData();
+            }
+            ProgramParameters lineParameters((int)argPointers.size(), argPointers.data());
+            caret_global_commandLine_init(lineParameters);//provenance and error messages should show the individual command
+            CaretLogFine("Running: " + caret_global_commandLine);
+            ElapsedTimer commandTimer;
+            commandTimer.start();
+            try
+            {
+                BatchLineStateRestorer myRestorer;
+                runCommand(lineParameters);
+            } catch (CaretException& e) {
+                throw CommandException("batch command on line " + AString::number(firstLine) + " failed: " + e.whatString());
+            }
+            ++numCommands;
+            cerr << "batch line " << firstLine << ", " << arguments[0].toLocal8Bit().constData() << ": " << commandTimer.getElapsedTimeSeconds() << " seconds" << endl;
+        }
+    } catch (...) {
+        inBatchMode = false;
+        CommandInputFileCache::setMaximumFiles(0);//release memory
+        throw;//caret_global_commandLine is left as the failing command, for the error message
+    }
+    inBatchMode = false;
+    CommandInputFileCache::setMaximumFiles(0);
+    caret_global_commandLine = batchCommandLine;
+    cerr << "batch finished " << numCommands << " commands in " << totalTimer.getElapsedTimeSeconds() << " seconds" << endl;
+}
+
 void CommandOperationManager::printVersionInfo()
 {
     ApplicationInformation myInfo;
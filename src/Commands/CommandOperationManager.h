@@ -77,6 +77,12 @@ namespace caret {
         
         void printVersionInfo();
         
+        void printBatchHelp(const AString& programName);
+        
+        void runBatch(const AString& scriptName, const int& maxCachedFiles, const int64_t& maxCachedBytes);
+        
+        static bool splitBatchLine(const AString& line, std::vector<AString>& argumentsOut, bool& inSingleQuote, bool& inDoubleQuote, AString& currentArgument, bool& haveArgument);
+        
         bool getGlobalOption(ProgramParameters& parameters, const AString& optionString, const int& numArgs, std::vector<AString>& arguments);
         
         struct OptionInfo
@@ -94,6 +100,8 @@ namespace caret {
     private:
         std::vector<CommandOperation*> commandOperations, deprecatedOperations;
         
+        bool inBatchMode;
+        
         static CommandOperationManager* singletonCommandOperationManager;
     };
     
@@ -27,7 +27,9 @@
 #include "CaretCommandLine.h"
 #include "CaretDataFileHelper.h"
 #include "CaretLogger.h"
+#include "CaretProfiler.h"
 #include "CiftiFile.h"
+#include "CommandInputFileCache.h"
 #include "DataFileException.h"
 #include "FileInformation.h"
 #include "FociFile.h"
@@ -82,6 +84,14 @@ void CommandParser::setCiftiOutputDTypeNoScale(const int16_t& dtype)
     m_ciftiScale = false;
 }
 
+int64_t CommandParser::getFileSizeForProfile(const AString& fileName)
+{
+    if (!CaretProfiler::isEnabled()) return -1;
+    FileInformation myInfo(fileName);
+    if (!myInfo.isLocalFile() || !myInfo.exists()) return -1;
+    return myInfo.size();
+}
+
 void CommandParser::executeOperation(ProgramParameters& parameters)
 {
     CaretPointer<OperationParameters> myAlgParams(m_autoOper->getParameters());//could be an autopointer, but this is safer
@@ -92,12 +102,18 @@ void CommandParser::executeOperation(ProgramParameters& parameters)
     m_parentProvenance = "";//in case someone tries to use the same instance more than once
     m_workingDir = QDir::currentPath();//get the current path, in case some stupid command changes the working directory
     //these get set on output files during writeOutput (and for on-disk in provenanceBeforeOperation)
-    parseComponent(myAlgParams.getPointer(), parameters, myOutAssoc);//parsing block
-    parameters.verifyAllParametersProcessed();
-    makeOnDiskOutputs(myOutAssoc);//check for input on-disk files used as output on-disk files
+    {
+        CaretProfilerSection parseSection("parse arguments and read inputs", "parse");
+        parseComponent(myAlgParams.getPointer(), parameters, myOutAssoc);//parsing block
+        parameters.verifyAllParametersProcessed();
+        makeOnDiskOutputs(myOutAssoc);//check for input on-disk files used as output on-disk files
+    }
     //code to show what arguments map to what parameters should go here
     if (m_doProvenance) provenanceBeforeOperation(myOutAssoc);
-    m_autoOper->useParameters(myAlgParams.getPointer(), NULL);//TODO: progress status for caret_command? would probably get messed up by any command info output
+    {
+        CaretProfilerSection executeSection(m_autoOper->getCommandSwitch(), "operation");
+        m_autoOper->useParameters(myAlgParams.getPointer(), NULL);//TODO: progress status for caret_command? would probably get messed up by any command info output
+    }
     vector<AString> uncheckedWarnings = myAlgParams->findUncheckedParams("the command");
     for (size_t i = 0; i < uncheckedWarnings.size(); ++i)
     {
@@ -105,6 +121,7 @@ void CommandParser::executeOperation(ProgramParameters& parameters)
     }
     if (m_doProvenance) provenanceAfterOperation(myOutAssoc);
     //TODO: deallocate input files - give abstract parameter a virtual deallocate method? use CaretPointer and rely on reference counting?
+    CaretProfilerSection writeSection("write outputs", "write");
     writeOutput(myOutAssoc);
 }
 
@@ -167,8 +184,9 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::BORDER:
                 {
-                    CaretPointer<BorderFile> myFile(new BorderFile());
-                    myFile->readFile(nextArg);
+                    CaretProfilerSection readSection("read " + nextArg, "read");
+                    CaretPointer<BorderFile> myFile = CommandInputFileCache::readFile<BorderFile>(nextArg);//in batch mode, this may copy a cached read of the file
+                    readSection.setBytes(getFileSizeForProfile(nextArg));
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -192,6 +210,7 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 case OperationParametersEnum::CIFTI:
                 {
                     FileInformation myInfo(nextArg);
+                    CaretProfilerSection readSection("open " + nextArg, "read");//reads only the header and XML, data is read as the operation needs it
                     CaretPointer<CiftiFile> myFile(new CiftiFile());
                     myFile->openFile(nextArg);
                     m_inputCiftiNames[myInfo.getCanonicalFilePath()] = myFile;//track input cifti, so we can check their size
@@ -231,8 +250,9 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::FOCI:
                 {
-                    CaretPointer<FociFile> myFile(new FociFile());
-                    myFile->readFile(nextArg);
+                    CaretProfilerSection readSection("read " + nextArg, "read");
+                    CaretPointer<FociFile> myFile = CommandInputFileCache::readFile<FociFile>(nextArg);
+                    readSection.setBytes(getFileSizeForProfile(nextArg));
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -266,8 +286,9 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::LABEL:
                 {
-                    CaretPointer<LabelFile> myFile(new LabelFile());
-                    myFile->readFile(nextArg);
+                    CaretProfilerSection readSection("read " + nextArg, "read");
+                    CaretPointer<LabelFile> myFile = CommandInputFileCache::readFile<LabelFile>(nextArg);
+                    readSection.setBytes(getFileSizeForProfile(nextArg));
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -290,8 +311,9 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::METRIC:
                 {
-                    CaretPointer<MetricFile> myFile(new MetricFile());
-                    myFile->readFile(nextArg);
+                    CaretProfilerSection readSection("read " + nextArg, "read");
+                    CaretPointer<MetricFile> myFile = CommandInputFileCache::readFile<MetricFile>(nextArg);
+                    readSection.setBytes(getFileSizeForProfile(nextArg));
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -324,8 +346,9 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::SURFACE:
                 {
-                    CaretPointer<SurfaceFile> myFile(new SurfaceFile());
-                    myFile->readFile(nextArg);
+                    CaretProfilerSection readSection("read " + nextArg, "read");
+                    CaretPointer<SurfaceFile> myFile = CommandInputFileCache::readFile<SurfaceFile>(nextArg);
+                    readSection.setBytes(getFileSizeForProfile(nextArg));
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -348,8 +371,9 @@ void CommandParser::parseComponent(ParameterComponent* myComponent, ProgramParam
                 }
                 case OperationParametersEnum::VOLUME:
                 {
-                    CaretPointer<VolumeFile> myFile(new VolumeFile());
-                    myFile->readFile(nextArg);
+                    CaretProfilerSection readSection("read " + nextArg, "read");
+                    CaretPointer<VolumeFile> myFile = CommandInputFileCache::readFile<VolumeFile>(nextArg);
+                    readSection.setBytes(getFileSizeForProfile(nextArg));
                     if (m_doProvenance)
                     {
                         const GiftiMetaData* md = myFile->getFileMetaData();
@@ -985,6 +1009,8 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
     for (uint32_t i = 0; i < outAssociation.size(); ++i)
     {
         AbstractParameter* myParam = outAssociation[i].m_param;
+        CommandInputFileCache::invalidateFile(outAssociation[i].m_fileName);//don't let a later batch command use a stale cached read of a file we are overwriting
+        CaretProfilerSection writeSection("write " + outAssociation[i].m_fileName, "write");
         switch (myParam->getType())
         {
             case OperationParametersEnum::BOOL://ignores the name you give the output for now, but what gives primitive type output and how is it used?
@@ -1046,6 +1072,7 @@ void CommandParser::writeOutput(const vector<OutputAssoc>& outAssociation)
                 CaretAssertMessage(false, "Writing of this parameter type has not been implemented in this parser");//assert instead of throw because this is a code error, not a user error
                 throw CommandException("Internal parsing error, please let the developers know what you just tried to do");//but don't let release pass by it either
         }
+        writeSection.setBytes(getFileSizeForProfile(outAssociation[i].m_fileName));
     }
 }
 
@@ -60,6 +60,7 @@ namespace caret {
         void provenanceAfterOperation(const std::vector<OutputAssoc>& outAssociation);
         void makeOnDiskOutputs(const std::vector<OutputAssoc>& outAssociation);//ensures on-disk inputs aren't used as on-disk outputs, keeping outputs in-memory when needed
         void writeOutput(const std::vector<OutputAssoc>& outAssociation);
+        static int64_t getFileSizeForProfile(const AString& fileName);//-1 when not profiling, so we don't stat files for nothing
         AString getIndentString(int desired);
         void addHelpComponent(AString& info, ParameterComponent* myComponent, int curIndent);
         void addHelpOptions(AString& info, ParameterComponent* myAlgParams, int curIndent);
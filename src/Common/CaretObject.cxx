@@ -25,10 +25,24 @@
 #include "CaretObject.h"
 #undef __CARET_OBJECT_DECLARE_H__
 
+#include "CaretMutex.h"
 #include "SystemUtilities.h"
 
 using namespace caret;
 
+#ifndef NDEBUG
+/**
+ * @return Mutex guarding the allocated object tracker since objects
+ * may be created and destroyed by worker threads.
+ */
+static CaretMutex&
+allocatedObjectsMutex()
+{
+    static CaretMutex s_mutex;
+    return s_mutex;
+}
+#endif
+
 /**
  * Constructor.
  *
@@ -58,7 +72,11 @@ CaretObject::~CaretObject()
      * Erase returns the number of objects deleted.
      * If zero, then the object has already been deleted.
      */
-    uint64_t numDeleted = CaretObject::allocatedObjects.erase(this);
+    uint64_t numDeleted = 0;
+    {
+        CaretMutexLocker locker(&allocatedObjectsMutex());
+        numDeleted = CaretObject::allocatedObjects.erase(this);
+    }
     if (numDeleted <= 0) {
         std::cerr << "Destructor for a CaretObject called but the object is not allocated "
                   << "and this implies that the object has already been deleted.";
@@ -81,6 +99,7 @@ CaretObject::initializeMembersCaretObject()
 #ifndef NDEBUG
     SystemBacktrace myBacktrace;
     SystemUtilities::getBackTrace(myBacktrace);
+    CaretMutexLocker locker(&allocatedObjectsMutex());
     CaretObject::allocatedObjects.insert(
                std::make_pair(this,
                               myBacktrace));
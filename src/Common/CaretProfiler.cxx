@@ -0,0 +1,257 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretProfiler.h"
+
+#include "CaretException.h"
+
+#include <QElapsedTimer>
+
+#include <ctime>
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace caret;
+using namespace std;
+
+bool CaretProfiler::s_enabled = false;
+vector<CaretProfiler::Section> CaretProfiler::s_sections;
+int64_t CaretProfiler::s_generation = 0;
+int CaretProfiler::s_numThreads = 0;
+CaretMutex CaretProfiler::s_mutex;
+
+namespace
+{
+    QElapsedTimer s_clock;//not an ElapsedTimer, as that is a CaretObject, and would show up in the undeleted object list
+    
+    //each thread has its own stack of open sections, so sections begun inside parallel regions don't close each other
+    struct OpenSections
+    {
+        int64_t m_generation;
+        int m_threadIndex;
+        vector<int64_t> m_handles;
+        OpenSections() : m_generation(-1), m_threadIndex(0) { }
+    };
+    thread_local OpenSections s_openSections;
+}
+
+vector<int64_t>& CaretProfiler::getOpenSections(int& threadIndexOut)
+{
+    if (s_openSections.m_generation != s_generation)
+    {//first use by this thread since the profiler was enabled
+        s_openSections.m_generation = s_generation;
+        s_openSections.m_handles.clear();
+        ++s_numThreads;
+        s_openSections.m_threadIndex = s_numThreads;
+    }
+    threadIndexOut = s_openSections.m_threadIndex;
+    return s_openSections.m_handles;
+}
+
+int64_t CaretProfiler::getElapsedNSecs()
+{
+    return s_clock.nsecsElapsed();
+}
+
+double CaretProfiler::getProcessCpuSeconds()
+{//clock() is cpu time of all threads on posix, but is wall time on windows
+    return ((double)clock()) / CLOCKS_PER_SEC;
+}
+
+int64_t CaretProfiler::getPeakRSSBytes()
+{
+#ifdef _WIN32
+    return -1;
+#else
+    struct rusage myUsage;
+    if (getrusage(RUSAGE_SELF, &myUsage) != 0) return -1;
+#ifdef __APPLE__
+    return myUsage.ru_maxrss;//bytes on mac
+#else
+    return ((int64_t)myUsage.ru_maxrss) * 1024;//kilobytes on linux
+#endif
+#endif
+}
+
+void CaretProfiler::enable()
+{
+    CaretMutexLocker locked(&s_mutex);
+    s_sections.clear();
+    ++s_generation;
+    s_numThreads = 0;
+    s_clock.start();
+    s_enabled = true;
+}
+
+void CaretProfiler::disable()
+{
+    CaretMutexLocker locked(&s_mutex);
+    s_enabled = false;
+    s_sections.clear();
+    ++s_generation;
+}
+
+int64_t CaretProfiler::beginSection(const AString& name, const AString& category)
+{
+    if (!s_enabled) return -1;
+    CaretMutexLocker locked(&s_mutex);
+    int threadIndex;
+    vector<int64_t>& openSections = getOpenSections(threadIndex);
+    Section newSection;
+    newSection.m_name = name;
+    newSection.m_category = category;
+    newSection.m_startNSecs = getElapsedNSecs();
+    newSection.m_durationNSecs = -1;
+    newSection.m_startCpuSeconds = getProcessCpuSeconds();
+    newSection.m_cpuSeconds = 0.0;
+    newSection.m_bytes = -1;
+    newSection.m_peakRSSBytes = -1;
+    newSection.m_isMarker = false;
+    newSection.m_threadIndex = threadIndex;
+    s_sections.push_back(newSection);
+    int64_t ret = (int64_t)s_sections.size() - 1;
+    openSections.push_back(ret);
+    return ret;
+}
+
+void CaretProfiler::endSection(const int64_t& handle, const int64_t& bytes)
+{
+    if (!s_enabled || handle < 0) return;
+    CaretMutexLocker locked(&s_mutex);
+    if (handle >= (int64_t)s_sections.size()) return;//profiler was restarted since the section began
+    int threadIndex;
+    vector<int64_t>& openSections = getOpenSections(threadIndex);
+    bool found = false;
+    for (size_t i = 0; i < openSections.size(); ++i)
+    {
+        if (openSections[i] == handle)
+        {
+            found = true;
+            break;
+        }
+    }
+    if (!found) return;
+    int64_t nowNSecs = getElapsedNSecs();
+    double nowCpu = getProcessCpuSeconds();
+    int64_t peakRSS = getPeakRSSBytes();
+    while (!openSections.empty())
+    {//close anything still open inside this section too
+        Section& mySection = s_sections[openSections.back()];
+        mySection.m_durationNSecs = nowNSecs - mySection.m_startNSecs;
+        mySection.m_cpuSeconds = nowCpu - mySection.m_startCpuSeconds;
+        mySection.m_peakRSSBytes = peakRSS;
+        bool done = (openSections.back() == handle);
+        if (done) mySection.m_bytes = bytes;
+        openSections.pop_back();
+        if (done) break;
+    }
+}
+
+void CaretProfiler::addMarker(const AString& name)
+{
+    if (!s_enabled) return;
+    CaretMutexLocker locked(&s_mutex);
+    int threadIndex;
+    getOpenSections(threadIndex);
+    Section newSection;
+    newSection.m_name = name;
+    newSection.m_category = "task";
+    newSection.m_startNSecs = getElapsedNSecs();
+    newSection.m_durationNSecs = -1;
+    newSection.m_startCpuSeconds = 0.0;
+    newSection.m_cpuSeconds = 0.0;
+    newSection.m_bytes = -1;
+    newSection.m_peakRSSBytes = -1;
+    newSection.m_isMarker = true;
+    newSection.m_threadIndex = threadIndex;
+    s_sections.push_back(newSection);
+}
+
+AString CaretProfiler::jsonEscape(const AString& in)
+{
+    AString ret;
+    for (int i = 0; i < in.size(); ++i)
+    {
+        QChar c = in[i];
+        if (c == '"' || c == '\\')
+        {
+            ret += '\\';
+            ret += c;
+        } else if (c.unicode() < 0x20) {
+            ret += "\\u" + AString::number(c.unicode(), 16).rightJustified(4, '0');
+        } else {
+            ret += c;
+        }
+    }
+    return ret;
+}
+
+void CaretProfiler::writeTrace(const AString& fileName, const AString& commandLine)
+{
+    CaretMutexLocker locked(&s_mutex);
+    ofstream output(fileName.toLocal8Bit().constData());
+    if (!output) throw CaretException("unable to open profile output file '" + fileName + "'");
+    int64_t nowNSecs = getElapsedNSecs();
+    double nowCpu = getProcessCpuSeconds();
+    output << "{\"traceEvents\":[" << endl;
+    for (size_t i = 0; i < s_sections.size(); ++i)
+    {
+        const Section& mySection = s_sections[i];
+        if (i != 0) output << "," << endl;
+        output << "{\"name\":\"" << jsonEscape(mySection.m_name).toUtf8().constData() << "\",\"cat\":\"" << jsonEscape(mySection.m_category).toUtf8().constData() << "\",";
+        output << "\"pid\":1,\"tid\":" << mySection.m_threadIndex << ",\"ts\":" << (mySection.m_startNSecs / 1000);
+        if (mySection.m_isMarker)
+        {
+            output << ",\"ph\":\"i\",\"s\":\"t\"}";
+            continue;
+        }
+        int64_t durationNSecs = mySection.m_durationNSecs;
+        double cpuSeconds = mySection.m_cpuSeconds;
+        if (durationNSecs < 0)
+        {//still open, happens for the outermost section
+            durationNSecs = nowNSecs - mySection.m_startNSecs;
+            cpuSeconds = nowCpu - mySection.m_startCpuSeconds;
+        }
+        output << ",\"ph\":\"X\",\"dur\":" << (durationNSecs / 1000) << ",\"args\":{";
+        output << "\"cpu_seconds\":" << cpuSeconds;
+        if (durationNSecs > 0)
+        {//average number of busy threads
+            output << ",\"thread_utilization\":" << (cpuSeconds / (durationNSecs * 1e-9));
+        }
+        if (mySection.m_bytes >= 0)
+        {
+            output << ",\"bytes\":" << mySection.m_bytes;
+        }
+        if (mySection.m_peakRSSBytes >= 0)
+        {
+            output << ",\"peak_rss_bytes\":" << mySection.m_peakRSSBytes;
+        }
+        output << "}}";
+    }
+    output << endl << "]," << endl;
+    output << "\"displayTimeUnit\":\"ms\"," << endl;
+    output << "\"otherData\":{\"command\":\"" << jsonEscape(commandLine).toUtf8().constData() << "\",\"total_seconds\":" << (nowNSecs * 1e-9);
+    output << ",\"cpu_seconds\":" << nowCpu << ",\"peak_rss_bytes\":" << getPeakRSSBytes() << "}" << endl;
+    output << "}" << endl;
+    if (!output) throw CaretException("error writing profile output file '" + fileName + "'");
+}
@@ -0,0 +1,89 @@
+#ifndef __CARET_PROFILER_H__
+#define __CARET_PROFILER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+#include "CaretMutex.h"
+
+#include <vector>
+
+#include "stdint.h"
+
+namespace caret {
+
+    ///records a tree of timed sections (for wb_command -profile), does nothing unless enabled
+    class CaretProfiler
+    {
+        struct Section
+        {
+            AString m_name, m_category;
+            int64_t m_startNSecs, m_durationNSecs;//duration -1 while open, or for markers
+            double m_startCpuSeconds, m_cpuSeconds;
+            int64_t m_bytes;//-1 if not applicable
+            int64_t m_peakRSSBytes;//-1 if unknown
+            bool m_isMarker;
+            int m_threadIndex;//sections nest per thread, this is the trace's tid
+        };
+        static bool s_enabled;
+        static std::vector<Section> s_sections;
+        static int64_t s_generation;//incremented by enable() and disable(), so threads can tell their open sections are stale
+        static int s_numThreads;
+        static CaretMutex s_mutex;
+        static std::vector<int64_t>& getOpenSections(int& threadIndexOut);//of the calling thread, call only with s_mutex locked
+        static int64_t getElapsedNSecs();
+        static double getProcessCpuSeconds();
+        static AString jsonEscape(const AString& in);
+    public:
+        ///start recording, discarding anything previously recorded
+        static void enable();
+        static void disable();
+        static bool isEnabled() { return s_enabled; }
+        
+        ///start a section nested in the calling thread's currently open section, returns a handle to end it with, or -1 if not enabled
+        static int64_t beginSection(const AString& name, const AString& category);
+        ///end a section, and any sections still open inside it - bytes is for sections that read or write files
+        static void endSection(const int64_t& handle, const int64_t& bytes = -1);
+        ///record a point in time inside the current section, like a task description
+        static void addMarker(const AString& name);
+        
+        ///peak resident memory of the process so far, -1 if not available on this platform
+        static int64_t getPeakRSSBytes();
+        
+        ///write what was recorded as chrome trace event format JSON (viewable in chrome://tracing or perfetto)
+        static void writeTrace(const AString& fileName, const AString& commandLine);
+    };
+    
+    ///ends the section when it goes out of scope, so exceptions don't leave sections open
+    class CaretProfilerSection
+    {
+        int64_t m_handle, m_bytes;
+        CaretProfilerSection(const CaretProfilerSection&);
+        CaretProfilerSection& operator=(const CaretProfilerSection&);
+    public:
+        CaretProfilerSection(const AString& name, const AString& category) : m_bytes(-1) { m_handle = CaretProfiler::beginSection(name, category); }
+        void setBytes(const int64_t& bytes) { m_bytes = bytes; }
+        ~CaretProfilerSection() { CaretProfiler::endSection(m_handle, m_bytes); }
+    };
+    
+}
+
+#endif //__CARET_PROFILER_H__
@@ -0,0 +1,220 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CorrelationEngine.h"
+
+#include "CaretAssert.h"
+
+#include <cmath>
+
+using namespace caret;
+using namespace std;
+
+CorrelationEngine::CorrelationEngine(const int64_t& inputLength, const vector<float>* weights)
+{
+    m_inputLength = inputLength;
+    m_preparedLength = inputLength;
+    m_weightedMode = false;
+    m_binaryWeights = true;
+    m_weightSum = 0.0;
+    if (weights != NULL)
+    {
+        CaretAssert((int64_t)weights->size() == inputLength);
+        for (int64_t i = 0; i < inputLength; ++i)
+        {
+            float val = (*weights)[i];
+            CaretAssert(val >= 0.0f);
+            if (val != 0.0f)
+            {
+                m_weightSum += val;
+                m_weights.push_back(val);
+                m_sqrtWeights.push_back(sqrt(val));
+                m_weightIndexes.push_back(i);
+                if (val != 1.0f)
+                {
+                    m_binaryWeights = false;
+                }
+            }
+        }
+        if (!m_binaryWeights || (int64_t)m_weightIndexes.size() != inputLength)//all weights being 1 is the same as unweighted
+        {
+            m_weightedMode = true;
+            m_preparedLength = (int64_t)m_weightIndexes.size();
+        }
+    }
+    m_zeroRow.resize(m_preparedLength, 0.0f);//stands in for missing rows of a partial tile
+}
+
+void CorrelationEngine::computeRowStatistics(const float* row, float& meanOut, float& rootResidSqrOut) const
+{
+    double accum = 0.0;
+    if (m_weightedMode)
+    {
+        if (m_binaryWeights)
+        {
+            for (int64_t i = 0; i < m_preparedLength; ++i)
+            {
+                accum += row[m_weightIndexes[i]];
+            }
+            meanOut = accum / m_preparedLength;
+            accum = 0.0;
+            for (int64_t i = 0; i < m_preparedLength; ++i)
+            {
+                float tempf = row[m_weightIndexes[i]] - meanOut;
+                accum += tempf * tempf;
+            }
+        } else {
+            for (int64_t i = 0; i < m_preparedLength; ++i)
+            {
+                accum += m_weights[i] * row[m_weightIndexes[i]];
+            }
+            meanOut = accum / m_weightSum;
+            accum = 0.0;
+            for (int64_t i = 0; i < m_preparedLength; ++i)
+            {
+                float tempf = row[m_weightIndexes[i]] - meanOut;
+                accum += m_weights[i] * tempf * tempf;
+            }
+        }
+    } else {
+        for (int64_t i = 0; i < m_inputLength; ++i)
+        {
+            accum += row[i];
+        }
+        meanOut = accum / m_inputLength;
+        accum = 0.0;
+        for (int64_t i = 0; i < m_inputLength; ++i)
+        {
+            float tempf = row[i] - meanOut;
+            accum += tempf * tempf;
+        }
+    }
+    rootResidSqrOut = sqrt(accum);
+}
+
+void CorrelationEngine::prepareRow(float* row, const float& mean) const
+{
+    if (m_weightedMode)//COMPACT data, subtract mean, multiply by square root of weights if applicable
+    {
+        if (m_binaryWeights)
+        {
+            for (int64_t i = 0; i < m_preparedLength; ++i)
+            {
+                row[i] = row[m_weightIndexes[i]] - mean;
+            }
+        } else {
+            for (int64_t i = 0; i < m_preparedLength; ++i)
+            {
+                row[i] = m_sqrtWeights[i] * (row[m_weightIndexes[i]] - mean);//this is so the numerator doesn't get squared weights applied, since this happens to both rows
+            }
+        }
+    } else {
+        for (int64_t i = 0; i < m_inputLength; ++i)
+        {
+            row[i] -= mean;
+        }
+    }
+}
+
+int64_t CorrelationEngine::getPanelSize(const int64_t& numRows) const
+{
+    return ((numRows + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE * m_preparedLength;
+}
+
+void CorrelationEngine::packPanel(const float* const* preparedRows, const int64_t& numRows, float* panelOut) const
+{
+    for (int64_t tileStart = 0; tileStart < numRows; tileStart += TILE_SIZE)
+    {
+        float* tile = panelOut + tileStart * m_preparedLength;//tiles are TILE_SIZE * length floats each
+        for (int64_t j = 0; j < TILE_SIZE; ++j)
+        {
+            const float* row = (tileStart + j < numRows) ? preparedRows[tileStart + j] : m_zeroRow.data();
+            for (int64_t k = 0; k < m_preparedLength; ++k)
+            {
+                tile[k * TILE_SIZE + j] = row[k];
+            }
+        }
+    }
+}
+
+void CorrelationEngine::correlateTile(const float* const* preparedRowsA, const float* rootResidSqrA, const int64_t& numRowsA,
+                                      const float* panelTileB, const float* rootResidSqrB, const int64_t& numRowsB,
+                                      float* out, const int64_t& outStride, const bool& fisherZ) const
+{
+    CaretAssert(numRowsA > 0 && numRowsA <= TILE_SIZE);
+    CaretAssert(numRowsB > 0 && numRowsB <= TILE_SIZE);
+    const float* rowsA[TILE_SIZE];
+    for (int i = 0; i < TILE_SIZE; ++i)
+    {
+        rowsA[i] = (i < numRowsA) ? preparedRowsA[i] : m_zeroRow.data();
+    }
+    double accum[TILE_SIZE][TILE_SIZE];
+    for (int i = 0; i < TILE_SIZE; ++i)
+    {
+        for (int j = 0; j < TILE_SIZE; ++j)
+        {
+            accum[i][j] = 0.0;
+        }
+    }
+    for (int64_t k = 0; k < m_preparedLength; ++k)
+    {
+        const float* tileCol = panelTileB + k * TILE_SIZE;//the TILE_SIZE B values for this column are contiguous
+        for (int i = 0; i < TILE_SIZE; ++i)
+        {
+            const float aVal = rowsA[i][k];
+            for (int j = 0; j < TILE_SIZE; ++j)
+            {
+                accum[i][j] += aVal * tileCol[j];//product in float, sum in double, same as dsdot
+            }
+        }
+    }
+    for (int i = 0; i < numRowsA; ++i)
+    {
+        for (int j = 0; j < numRowsB; ++j)
+        {
+            out[i * outStride + j] = finishCorrelation(accum[i][j], rootResidSqrA[i], rootResidSqrB[j], fisherZ);
+        }
+    }
+}
+
+float CorrelationEngine::correlatePair(const float* preparedRowA, const float& rootResidSqrA, const float* preparedRowB, const float& rootResidSqrB, const bool& fisherZ) const
+{
+    double accum = 0.0;
+    for (int64_t k = 0; k < m_preparedLength; ++k)
+    {
+        accum += preparedRowA[k] * preparedRowB[k];
+    }
+    return finishCorrelation(accum, rootResidSqrA, rootResidSqrB, fisherZ);
+}
+
+float CorrelationEngine::finishCorrelation(const double& dotProduct, const float& rootResidSqrA, const float& rootResidSqrB, const bool& fisherZ)
+{
+    double r = dotProduct / (rootResidSqrA * rootResidSqrB);
+    if (fisherZ)
+    {
+        if (r > 0.999999) r = 0.999999;//prevent inf
+        if (r < -0.999999) r = -0.999999;//prevent -inf
+        return 0.5 * log((1 + r) / (1 - r));
+    } else {
+        if (r > 1.0) r = 1.0;//don't output anything silly
+        if (r < -1.0) r = -1.0;
+        return r;
+    }
+}
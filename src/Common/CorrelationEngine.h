@@ -0,0 +1,82 @@
+#ifndef __CORRELATION_ENGINE_H__
+#define __CORRELATION_ENGINE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace caret
+{
+
+    ///shared row normalization and blocked dot products for correlating rows of two matrices
+    ///rows are prepared once (compacted to nonzero weights, mean removed, scaled by sqrt of weight), then correlated in
+    ///TILE_SIZE x TILE_SIZE tiles against a packed panel of the other side's rows, with the division and fisher z in the epilogue
+    ///all dot products use float products summed in double in column order, so results match a plain per-pair dot product exactly
+    class CorrelationEngine
+    {
+        int64_t m_inputLength, m_preparedLength;
+        bool m_weightedMode, m_binaryWeights;
+        double m_weightSum;
+        std::vector<int64_t> m_weightIndexes;
+        std::vector<float> m_weights, m_sqrtWeights, m_zeroRow;
+    public:
+        enum
+        {
+            TILE_SIZE = 4
+        };
+
+        ///weights must be nonnegative and have inputLength elements, NULL or all ones means unweighted
+        CorrelationEngine(const int64_t& inputLength, const std::vector<float>* weights = NULL);
+
+        int64_t getInputLength() const { return m_inputLength; }
+
+        ///length of a row after prepareRow, which is shorter than the input when some weights are zero
+        int64_t getPreparedLength() const { return m_preparedLength; }
+
+        ///(weighted) mean and root of sum of squared residuals of an input row
+        void computeRowStatistics(const float* row, float& meanOut, float& rootResidSqrOut) const;
+
+        ///modifies an input row in place into the form used by the dot products, using the mean from computeRowStatistics
+        void prepareRow(float* row, const float& mean) const;
+
+        ///number of floats needed by packPanel for the given number of rows
+        int64_t getPanelSize(const int64_t& numRows) const;
+
+        ///interleave prepared rows into tiles of TILE_SIZE rows, zero padding the last tile
+        void packPanel(const float* const* preparedRows, const int64_t& numRows, float* panelOut) const;
+
+        ///correlate up to TILE_SIZE prepared rows against one tile of a packed panel, writing out[i * outStride + j] for the valid rows and columns
+        void correlateTile(const float* const* preparedRowsA, const float* rootResidSqrA, const int64_t& numRowsA,
+                           const float* panelTileB, const float* rootResidSqrB, const int64_t& numRowsB,
+                           float* out, const int64_t& outStride, const bool& fisherZ) const;
+
+        ///correlate a single pair of prepared rows
+        float correlatePair(const float* preparedRowA, const float& rootResidSqrA, const float* preparedRowB, const float& rootResidSqrB, const bool& fisherZ) const;
+
+        ///turn a dot product of prepared rows into a clamped correlation or fisher z value
+        static float finishCorrelation(const double& dotProduct, const float& rootResidSqrA, const float& rootResidSqrB, const bool& fisherZ);
+    };
+
+}
+
+#endif //__CORRELATION_ENGINE_H__
@@ -141,6 +141,25 @@ Event::getEventProcessCount() const
     return this->eventProcessedCount;
 }
 
+/**
+ * An invalidation event only marks cached data as out of date, so
+ * sending an identical invalidation again, before anything could
+ * have rebuilt the cached data, has no effect and the event manager
+ * may skip it.  Subclasses that are invalidation events override this.
+ *
+ * @param invalidatedObjectOut
+ *    Output with the object whose cached data is invalidated, or
+ *    NULL if all cached data is invalidated.
+ * @return
+ *    True if this is an invalidation event.
+ */
+bool
+Event::isInvalidationEvent(const void*& invalidatedObjectOut) const
+{
+    invalidatedObjectOut = NULL;
+    return false;
+}
+
 /**
  * Get String representation of caret object.
  * @return String containing caret object.
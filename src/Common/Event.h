@@ -52,6 +52,8 @@ namespace caret {
         
         int32_t getEventProcessCount() const;
         
+        virtual bool isInvalidationEvent(const void*& invalidatedObjectOut) const;
+        
     protected:
         Event(const EventTypeEnum::Enum eventType);
         
@@ -18,6 +18,7 @@
  */
 /*LICENSE_END*/
 
+#include <QElapsedTimer>
 #include <QThread>
 
 #include <algorithm>
@@ -37,6 +38,12 @@
 #include "SystemUtilities.h"
 
 using namespace caret;
+
+namespace
+{
+    QElapsedTimer s_instrumentationClock;//not an ElapsedTimer, as that is a CaretObject
+}
+
 /**
  * \class  caret::EventManager
  * \brief  The event manager.
@@ -65,6 +72,19 @@ using namespace caret;
  * event will create the new window.  Other receivers may
  * want to know AFTER the window has been created in which
  * case these receivers will use addProcessedEventListener().
+ *
+ * Listeners receive an event in the order they were added.  A listener
+ * added while an event is being sent does not receive that event, and
+ * a listener removed while an event is being sent does not receive it
+ * if it had not yet received it.
+ *
+ * An invalidation event (see Event::isInvalidationEvent()) is not sent
+ * when it repeats the previous invalidation and no other event has been
+ * sent since then, as the listeners' caches are already invalid.
+ *
+ * The number of events of each type is always counted.  When
+ * instrumentation is enabled, the time spent sending each type
+ * of event is also recorded, see getInstrumentationReport().
  */
 
 /**
@@ -74,6 +94,16 @@ EventManager::EventManager()
 {
     m_eventIssuedCounter = 0;
     m_eventBlockingCounter.resize(EventTypeEnum::EVENT_COUNT, 0);
+    m_sendEventDepth = 0;
+    m_removedListenersPending = false;
+    m_lastInvalidationEventType = EventTypeEnum::EVENT_INVALID;
+    m_lastInvalidatedObject = NULL;
+    m_lastInvalidationEventIssuedCounter = -1;
+    m_eventTypeIssuedCounter.resize(EventTypeEnum::EVENT_COUNT, 0);
+    m_eventTypeCoalescedCounter.resize(EventTypeEnum::EVENT_COUNT, 0);
+    m_instrumentationEnabled = false;
+    m_eventTypeTotalNanoseconds.resize(EventTypeEnum::EVENT_COUNT, 0);
+    m_eventTypeSelfNanoseconds.resize(EventTypeEnum::EVENT_COUNT, 0);
 }
 
 /**
@@ -85,7 +115,7 @@ EventManager::~EventManager()
      * Verify that all listeners were removed.
      */ 
     for (int32_t i = 0; i < EventTypeEnum::EVENT_COUNT; i++) {
-        EVENT_LISTENER_CONTAINER el = m_eventListeners[i];
+        const EVENT_LISTENER_CONTAINER& el = m_eventListeners[i];
         if (el.empty() == false) {
             EventTypeEnum::Enum enumValue = static_cast<EventTypeEnum::Enum>(i);
             std::cout 
@@ -101,7 +131,7 @@ EventManager::~EventManager()
      * Verify that all processed listeners were removed.
      */ 
     for (int32_t i = 0; i < EventTypeEnum::EVENT_COUNT; i++) {
-        EVENT_LISTENER_CONTAINER el = m_eventProcessedListeners[i];
+        const EVENT_LISTENER_CONTAINER& el = m_eventProcessedListeners[i];
         if (el.empty() == false) {
             EventTypeEnum::Enum enumValue = static_cast<EventTypeEnum::Enum>(i);
             std::cout 
@@ -167,15 +197,8 @@ void
 EventManager::addEventListener(EventListenerInterface* eventListener,
                                const EventTypeEnum::Enum listenForEventType)
 {
-#ifdef CONTAINER_VECTOR
-    m_eventListeners[listenForEventType].push_back(eventListener);
-#elif CONTAINER_HASH_SET
-    m_eventListeners[listenForEventType].insert(eventListener);
-#elif CONTAINER_SET
-    m_eventListeners[listenForEventType].insert(eventListener);
-#else
-    INTENTIONAL_COMPILER_ERROR_MISSING_CONTAINER_TYPE
-#endif
+    addListenerToContainer(m_eventListeners[listenForEventType],
+                           eventListener);
 }
 
 /**
@@ -191,15 +214,8 @@ void
 EventManager::addProcessedEventListener(EventListenerInterface* eventListener,
                                const EventTypeEnum::Enum listenForEventType)
 {
-#ifdef CONTAINER_VECTOR
-    m_eventProcessedListeners[listenForEventType].push_back(eventListener);
-#elif CONTAINER_HASH_SET
-    m_eventProcessedListeners[listenForEventType].insert(eventListener);
-#elif CONTAINER_SET
-    m_eventProcessedListeners[listenForEventType].insert(eventListener);
-#else
-    INTENTIONAL_COMPILER_ERROR_MISSING_CONTAINER_TYPE
-#endif
+    addListenerToContainer(m_eventProcessedListeners[listenForEventType],
+                           eventListener);
 }
 
 /**
@@ -214,38 +230,85 @@ void
 EventManager::removeEventFromListener(EventListenerInterface* eventListener,
                                   const EventTypeEnum::Enum listenForEventType)
 {
-#ifdef CONTAINER_VECTOR
     /*
      * Remove from NORMAL listeners
      */
-    EVENT_LISTENER_CONTAINER& listeners = m_eventListeners[listenForEventType];
-    EVENT_LISTENER_CONTAINER_ITERATOR eventIter = std::find(listeners.begin(),
-                                                            listeners.end(),
-                                                            eventListener);
-    if (eventIter != listeners.end()) {
-        listeners.erase(eventIter);
-    }
-
+    removeListenerFromContainer(m_eventListeners[listenForEventType],
+                                eventListener);
+    
     /*
      * Remove from PROCESSED listeners
      * These are issued AFTER all of the NORMAL listeners have been notified
      */
-    EVENT_LISTENER_CONTAINER& processedListeners = m_eventProcessedListeners[listenForEventType];
-    EVENT_LISTENER_CONTAINER_ITERATOR processedEventIter = std::find(processedListeners.begin(),
-                                                                     processedListeners.end(),
-                                                                     eventListener);
-    if (processedEventIter != processedListeners.end()) {
-        processedListeners.erase(processedEventIter);
+    removeListenerFromContainer(m_eventProcessedListeners[listenForEventType],
+                                eventListener);
+}
+
+/**
+ * Add a listener to a container if it is not already in the container.
+ *
+ * @param listeners
+ *     The container.
+ * @param eventListener
+ *     Listener that is added.
+ */
+void
+EventManager::addListenerToContainer(EVENT_LISTENER_CONTAINER& listeners,
+                                     EventListenerInterface* eventListener)
+{
+    CaretAssert(eventListener);
+    if (std::find(listeners.begin(),
+                  listeners.end(),
+                  eventListener) == listeners.end()) {
+        listeners.push_back(eventListener);
+    }
+}
+
+/**
+ * Remove a listener from a container.  If an event is being sent,
+ * the listener is set to NULL so that the positions of the other
+ * listeners do not change, and it is erased later.
+ *
+ * @param listeners
+ *     The container.
+ * @param eventListener
+ *     Listener that is removed.
+ */
+void
+EventManager::removeListenerFromContainer(EVENT_LISTENER_CONTAINER& listeners,
+                                          EventListenerInterface* eventListener)
+{
+    EVENT_LISTENER_CONTAINER_ITERATOR iter = std::find(listeners.begin(),
+                                                       listeners.end(),
+                                                       eventListener);
+    if (iter != listeners.end()) {
+        if (m_sendEventDepth > 0) {
+            *iter = NULL;
+            m_removedListenersPending = true;
+        }
+        else {
+            listeners.erase(iter);
+        }
+    }
+}
+
+/**
+ * Erase listeners that were removed while an event was being sent.
+ */
+void
+EventManager::eraseRemovedListeners()
+{
+    CaretAssert(m_sendEventDepth == 0);
+    EventListenerInterface* nullListener = NULL;
+    for (int32_t i = 0; i < EventTypeEnum::EVENT_COUNT; i++) {
+        EVENT_LISTENER_CONTAINER& listeners = m_eventListeners[i];
+        listeners.erase(std::remove(listeners.begin(), listeners.end(), nullListener),
+                        listeners.end());
+        EVENT_LISTENER_CONTAINER& processedListeners = m_eventProcessedListeners[i];
+        processedListeners.erase(std::remove(processedListeners.begin(), processedListeners.end(), nullListener),
+                                 processedListeners.end());
     }
-#elif CONTAINER_HASH_SET
-    m_eventListeners[listenForEventType].erase(eventListener);
-    m_eventProcessedListeners[listenForEventType].erase(eventListener);
-#elif CONTAINER_SET
-    m_eventListeners[listenForEventType].erase(eventListener);
-    m_eventProcessedListeners[listenForEventType].erase(eventListener);
-#else
-    INTENTIONAL_COMPILER_ERROR_MISSING_CONTAINER_TYPE
-#endif
+    m_removedListenersPending = false;
 }
 
 /**
@@ -271,60 +334,71 @@ void
 EventManager::sendEvent(Event* event)
 {   
     EventTypeEnum::Enum eventType = event->getEventType();
-    const AString eventNumberString = AString::number(m_eventIssuedCounter);
-    const AString eventMessagePrefix = ("Event "
-                                        + eventNumberString
-                                        + ": "
-                                        + event->toString() 
-                                        + " from thread: " 
-                                        + AString::number((uint64_t)QThread::currentThread())
-                                        + " ");
-    
     const int32_t eventTypeIndex = static_cast<int32_t>(eventType);
     CaretAssertVectorIndex(m_eventBlockingCounter, eventTypeIndex);
     if (m_eventBlockingCounter[eventTypeIndex] > 0) {
-        AString msg = (eventMessagePrefix
-                       + " is blocked.  Blocking counter="
-                       + AString::number(m_eventBlockingCounter[eventTypeIndex]));
-        CaretLogFiner(msg);
+        /*
+         * The logging macro only builds the message when it is logged,
+         * which matters as some events have an expensive toString().
+         */
+        CaretLogFiner("Event "
+                      + AString::number(m_eventIssuedCounter)
+                      + ": "
+                      + event->toString()
+                      + " from thread: "
+                      + AString::number((uint64_t)QThread::currentThread())
+                      + "  is blocked.  Blocking counter="
+                      + AString::number(m_eventBlockingCounter[eventTypeIndex]));
+        return;
     }
-    else {
-        if (eventType == EventTypeEnum::EVENT_ALERT_USER) {
-            /*
-             * Only send the ALERT USER event if there is a GUI.
-             * Otherwise, simply log the alert message.
-             */
-            EventAlertUser* alertEvent = dynamic_cast<EventAlertUser*>(event);
-            CaretAssert(alertEvent);
-            
-            if (ApplicationInformation::getApplicationType() != ApplicationTypeEnum::APPLICATION_TYPE_GRAPHICAL_USER_INTERFACE) {
-                CaretLogSevere(alertEvent->getMessage());
-                return;
-            }
-        }
-        
+    
+    if (eventType == EventTypeEnum::EVENT_ALERT_USER) {
         /*
-         * Get listeners for event.
+         * Only send the ALERT USER event if there is a GUI.
+         * Otherwise, simply log the alert message.
          */
-        EVENT_LISTENER_CONTAINER listeners = m_eventListeners[eventType];
+        EventAlertUser* alertEvent = dynamic_cast<EventAlertUser*>(event);
+        CaretAssert(alertEvent);
         
-        const AString eventNumberString = AString::number(m_eventIssuedCounter);
+        if (ApplicationInformation::getApplicationType() != ApplicationTypeEnum::APPLICATION_TYPE_GRAPHICAL_USER_INTERFACE) {
+            CaretLogSevere(alertEvent->getMessage());
+            return;
+        }
+    }
+    
+    /*
+     * Invalidation only marks caches as out of date so an invalidation
+     * that repeats the previous one, with no event sent in between
+     * that could have rebuilt the caches, does nothing.
+     */
+    const void* invalidatedObject = NULL;
+    const bool invalidationFlag = event->isInvalidationEvent(invalidatedObject);
+    if (invalidationFlag
+        && (eventType == m_lastInvalidationEventType)
+        && (m_eventIssuedCounter == m_lastInvalidationEventIssuedCounter)
+        && ((m_lastInvalidatedObject == NULL)
+            || (m_lastInvalidatedObject == invalidatedObject))) {
+        m_eventTypeCoalescedCounter[eventTypeIndex]++;
+        return;
+    }
+    
+    {
+        /*
+         * Guards restore the depth and timing of nested events
+         * if a listener throws an exception.  The depth guard
+         * is destroyed first so that time to erase removed
+         * listeners is included in the event's time.
+         */
+        SendEventTimingGuard timingGuard(this,
+                                         eventTypeIndex);
+        SendEventDepthGuard depthGuard(this);
         
         /*
          * Send event to each of the listeners.
          */
-        for (EVENT_LISTENER_CONTAINER_ITERATOR iter = listeners.begin();
-             iter != listeners.end();
-             iter++) {
-            EventListenerInterface* listener = *iter;
-
-            listener->receiveEvent(event);
-            
-            if (event->isError()) {
-                CaretLogWarning("Event " + eventNumberString + " had error: " + event->toString() + ": " + event->getErrorMessage());
-                break;
-            }
-        }
+        sendEventToListeners(event,
+                             m_eventListeners[eventTypeIndex],
+                             "");
         
         /*
          * Verify event was processed.
@@ -333,23 +407,131 @@ EventManager::sendEvent(Event* event)
             /*
              * Send event to each of the PROCESSED listeners.
              */
-            EVENT_LISTENER_CONTAINER processedListeners = m_eventProcessedListeners[eventType];
-            for (EVENT_LISTENER_CONTAINER_ITERATOR iter = processedListeners.begin();
-                 iter != processedListeners.end();
-                 iter++) {
-                EventListenerInterface* listener = *iter;
-                listener->receiveEvent(event);
-                
-                if (event->isError()) {
-                    CaretLogWarning("Event " + eventNumberString + " had error: " + event->toString());
-                    break;
-                }
-            }
+            sendEventToListeners(event,
+                                 m_eventProcessedListeners[eventTypeIndex],
+                                 "processed ");
         }
-        else {
+    }
+    
+    m_eventIssuedCounter++;
+    m_eventTypeIssuedCounter[eventTypeIndex]++;
+    
+    if (invalidationFlag) {
+        m_lastInvalidationEventType = eventType;
+        m_lastInvalidatedObject = invalidatedObject;
+        m_lastInvalidationEventIssuedCounter = m_eventIssuedCounter;
+    }
+}
+
+/**
+ * Constructor increments the depth of nested calls to sendEvent().
+ *
+ * @param eventManager
+ *    The event manager.
+ */
+EventManager::SendEventDepthGuard::SendEventDepthGuard(EventManager* eventManager)
+: m_eventManager(eventManager)
+{
+    m_eventManager->m_sendEventDepth++;
+}
+
+/**
+ * Destructor decrements the depth of nested calls to sendEvent() and
+ * erases listeners removed while sending events after the outermost call.
+ */
+EventManager::SendEventDepthGuard::~SendEventDepthGuard()
+{
+    m_eventManager->m_sendEventDepth--;
+    if ((m_eventManager->m_sendEventDepth == 0)
+        && m_eventManager->m_removedListenersPending) {
+        m_eventManager->eraseRemovedListeners();
+    }
+}
+
+/**
+ * Constructor starts timing an event when instrumentation is enabled.
+ *
+ * @param eventManager
+ *    The event manager.
+ * @param eventTypeIndex
+ *    Index of the type of event that is sent.
+ */
+EventManager::SendEventTimingGuard::SendEventTimingGuard(EventManager* eventManager,
+                                                         const int32_t eventTypeIndex)
+: m_eventManager(eventManager),
+m_eventTypeIndex(eventTypeIndex),
+m_timingFlag(eventManager->m_instrumentationEnabled),
+m_startNanoseconds(0)
+{
+    if (m_timingFlag) {
+        m_startNanoseconds = s_instrumentationClock.nsecsElapsed();
+        m_eventManager->m_nestedEventNanoseconds.push_back(0);
+    }
+}
+
+/**
+ * Destructor adds the time spent sending the event to the totals for
+ * its type and to the nested time of the enclosing event.
+ */
+EventManager::SendEventTimingGuard::~SendEventTimingGuard()
+{
+    std::vector<int64_t>& nestedEventNanoseconds = m_eventManager->m_nestedEventNanoseconds;
+    if (m_timingFlag
+        && ( ! nestedEventNanoseconds.empty())) {
+        const int64_t totalNanoseconds = s_instrumentationClock.nsecsElapsed() - m_startNanoseconds;
+        const int64_t nestedNanoseconds = nestedEventNanoseconds.back();
+        nestedEventNanoseconds.pop_back();
+        m_eventManager->m_eventTypeTotalNanoseconds[m_eventTypeIndex] += totalNanoseconds;
+        m_eventManager->m_eventTypeSelfNanoseconds[m_eventTypeIndex] += (totalNanoseconds - nestedNanoseconds);
+        if ( ! nestedEventNanoseconds.empty()) {
+            nestedEventNanoseconds.back() += totalNanoseconds;
         }
+    }
+}
 
-        m_eventIssuedCounter++;
+/**
+ * Send an event to the listeners in a container.  Listeners are
+ * accessed by index, as a listener may add listeners, which may
+ * reallocate the container.
+ *
+ * @param event
+ *    Event that is sent.
+ * @param listeners
+ *    The listeners.
+ * @param processedText
+ *    Text for the error message identifying the container.
+ */
+void
+EventManager::sendEventToListeners(Event* event,
+                                   const EVENT_LISTENER_CONTAINER& listeners,
+                                   const AString& processedText)
+{
+    /*
+     * Listeners added while sending this event do not receive it
+     */
+    const int64_t numberOfListeners = static_cast<int64_t>(listeners.size());
+    for (int64_t i = 0; i < numberOfListeners; i++) {
+        EventListenerInterface* listener = listeners[i];
+        if (listener == NULL) {
+            /*
+             * Removed while sending this event
+             */
+            continue;
+        }
+        
+        listener->receiveEvent(event);
+        
+        if (event->isError()) {
+            CaretLogWarning("Event "
+                            + AString::number(m_eventIssuedCounter)
+                            + " had error for "
+                            + processedText
+                            + "listener: "
+                            + event->toString()
+                            + ": "
+                            + event->getErrorMessage());
+            break;
+        }
     }
 }
 
@@ -529,6 +711,121 @@ EventManager::getEventIssuedCounter() const
     return m_eventIssuedCounter;
 }
 
+/**
+ * @return The number of events of the given type that have been sent
+ * since instrumentation was last reset.
+ *
+ * @param eventType
+ *    Type of event.
+ */
+int64_t
+EventManager::getEventTypeIssuedCounter(const EventTypeEnum::Enum eventType) const
+{
+    const int32_t eventTypeIndex = static_cast<int32_t>(eventType);
+    CaretAssertVectorIndex(m_eventTypeIssuedCounter, eventTypeIndex);
+    return m_eventTypeIssuedCounter[eventTypeIndex];
+}
+
+/**
+ * Enable or disable instrumentation.  When enabled, the time spent
+ * sending each type of event is recorded.  Enabling instrumentation
+ * resets the counts and times.
+ *
+ * @param enabled
+ *    New instrumentation status.
+ */
+void
+EventManager::setInstrumentationEnabled(const bool enabled)
+{
+    if (enabled
+        && ( ! m_instrumentationEnabled)) {
+        resetInstrumentation();
+        s_instrumentationClock.start();
+    }
+    m_instrumentationEnabled = enabled;
+}
+
+/**
+ * @return True if instrumentation is enabled.
+ */
+bool
+EventManager::isInstrumentationEnabled() const
+{
+    return m_instrumentationEnabled;
+}
+
+/**
+ * Reset the counts and times for each event type.
+ */
+void
+EventManager::resetInstrumentation()
+{
+    std::fill(m_eventTypeIssuedCounter.begin(), m_eventTypeIssuedCounter.end(), 0);
+    std::fill(m_eventTypeCoalescedCounter.begin(), m_eventTypeCoalescedCounter.end(), 0);
+    std::fill(m_eventTypeTotalNanoseconds.begin(), m_eventTypeTotalNanoseconds.end(), 0);
+    std::fill(m_eventTypeSelfNanoseconds.begin(), m_eventTypeSelfNanoseconds.end(), 0);
+}
+
+/**
+ * Get a report of the event types that were sent, sorted with the
+ * event types that took the most time, excluding time in events they
+ * caused to be sent, first.  Times are only available when
+ * instrumentation is enabled.
+ *
+ * @param maximumNumberOfEventTypes
+ *    Maximum number of event types in the report, negative for all.
+ * @return
+ *    Text of the report.
+ */
+AString
+EventManager::getInstrumentationReport(const int32_t maximumNumberOfEventTypes) const
+{
+    std::vector<std::pair<int64_t, int32_t> > selfTimeAndType;
+    int64_t totalCount = 0;
+    int64_t totalCoalesced = 0;
+    for (int32_t i = 0; i < EventTypeEnum::EVENT_COUNT; i++) {
+        if ((m_eventTypeIssuedCounter[i] > 0)
+            || (m_eventTypeCoalescedCounter[i] > 0)) {
+            selfTimeAndType.push_back(std::make_pair(-m_eventTypeSelfNanoseconds[i], i));
+            totalCount += m_eventTypeIssuedCounter[i];
+            totalCoalesced += m_eventTypeCoalescedCounter[i];
+        }
+    }
+    std::sort(selfTimeAndType.begin(), selfTimeAndType.end());
+    
+    AString report("Events sent: "
+                   + AString::number(totalCount)
+                   + ", coalesced: "
+                   + AString::number(totalCoalesced));
+    int32_t numberOfTypes = static_cast<int32_t>(selfTimeAndType.size());
+    if ((maximumNumberOfEventTypes >= 0)
+        && (maximumNumberOfEventTypes < numberOfTypes)) {
+        numberOfTypes = maximumNumberOfEventTypes;
+    }
+    for (int32_t i = 0; i < numberOfTypes; i++) {
+        const int32_t eventTypeIndex = selfTimeAndType[i].second;
+        const EventTypeEnum::Enum eventType = static_cast<EventTypeEnum::Enum>(eventTypeIndex);
+        AString line("    "
+                     + EventTypeEnum::toName(eventType)
+                     + ": count="
+                     + AString::number(m_eventTypeIssuedCounter[eventTypeIndex]));
+        if (m_eventTypeCoalescedCounter[eventTypeIndex] > 0) {
+            line += (" coalesced="
+                     + AString::number(m_eventTypeCoalescedCounter[eventTypeIndex]));
+        }
+        line += (" self(ms)="
+                 + AString::number(m_eventTypeSelfNanoseconds[eventTypeIndex] / 1.0e6, 'f', 3)
+                 + " total(ms)="
+                 + AString::number(m_eventTypeTotalNanoseconds[eventTypeIndex] / 1.0e6, 'f', 3)
+                 + " listeners="
+                 + AString::number(m_eventListeners[eventTypeIndex].size()
+                                   + m_eventProcessedListeners[eventTypeIndex].size()));
+        report.appendWithNewLine(line);
+    }
+    
+    return report;
+}
+
 /**
  * Verify that all listeners have been removed from the given event listener.
  *
@@ -542,8 +839,12 @@ EventManager::verifyAllListenersRemoved(EventListenerInterface* eventListener)
     
     for (int32_t i = 0; i < EventTypeEnum::EVENT_COUNT; i++) {
         const EventTypeEnum::Enum eventType = static_cast<EventTypeEnum::Enum>(i);
-        if ((m_eventListeners[eventType].find(eventListener) != m_eventListeners[eventType].end())
-            || (m_eventProcessedListeners[eventType].find(eventListener) != m_eventProcessedListeners[eventType].end())) {
+        if ((std::find(m_eventListeners[eventType].begin(),
+                       m_eventListeners[eventType].end(),
+                       eventListener) != m_eventListeners[eventType].end())
+            || (std::find(m_eventProcessedListeners[eventType].begin(),
+                          m_eventProcessedListeners[eventType].end(),
+                          eventListener) != m_eventProcessedListeners[eventType].end())) {
             eventNames.appendWithNewLine("    "
                                   + EventTypeEnum::toName(eventType));
         }
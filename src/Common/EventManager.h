@@ -23,48 +23,17 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include "CaretObject.h"
 
 #include "EventTypeEnum.h"
 
-//#define CONTAINER_VECTOR 1
-//#define CONTAINER_HASH_SET 1
-#define CONTAINER_SET 1
-
-#ifdef CONTAINER_VECTOR
-#include <vector>
-#elif CONTAINER_HASH_SET
-#include <functional>
-#include "CaretHashSet.h"
-#elif CONTAINER_SET
-#include <set>
-#else
-   INTENTIONAL_COMPILER_ERROR_MISSING_CONTAINER_TYPE
-#endif
-
 namespace caret {
 
     class Event;
     class EventListenerInterface;
     
-#ifdef CONTAINER_HASH_SET
-    class EventListenerCompareHash {
-    public:
-        bool operator()(const EventListenerInterface* e1,
-                        const EventListenerInterface* e2) const {
-            return (e1 == e2);
-        }
-    };
-    
-    class EventListenerInterfaceHash {
-    public:
-        size_t operator()(const EventListenerInterface* p) const {
-            EventListenerInterface* el = const_cast<EventListenerInterface*>(p);
-            return reinterpret_cast<size_t>((void*)el);
-        }
-    };
-#endif // CONTAINER_HASH_SET
-    
     class EventManager : public CaretObject {
         
     public:
@@ -94,6 +63,16 @@ namespace caret {
         
         int64_t getEventIssuedCounter() const;
         
+        int64_t getEventTypeIssuedCounter(const EventTypeEnum::Enum eventType) const;
+        
+        void setInstrumentationEnabled(const bool enabled);
+        
+        bool isInstrumentationEnabled() const;
+        
+        void resetInstrumentation();
+        
+        AString getInstrumentationReport(const int32_t maximumNumberOfEventTypes = -1) const;
+        
     private:
         EventManager();
         
@@ -102,25 +81,75 @@ namespace caret {
         void verifyAllListenersRemoved(EventListenerInterface* eventListener);
         
         /**
-         * Define the container
+         * Container for listeners, contiguous so that sending an event
+         * is a walk through an array.  While an event is being sent,
+         * removed listeners are set to NULL and erased after the
+         * outermost sendEvent() finishes.
          */
-#ifdef CONTAINER_VECTOR
         typedef std::vector<EventListenerInterface*> EVENT_LISTENER_CONTAINER;
-#elif CONTAINER_HASH_SET
-        typedef caret::hash_set<EventListenerInterface*,
-                                   EventListenerInterfaceHash,
-                                   EventListenerCompareHash> EVENT_LISTENER_CONTAINER;
-#elif CONTAINER_SET
-        typedef std::set<EventListenerInterface*> EVENT_LISTENER_CONTAINER;
-#else
-        INTENTIONAL_COMPILER_ERROR_MISSING_CONTAINER_TYPE
-#endif
         
         /**
          * Iterator for the container 
          */
         typedef EVENT_LISTENER_CONTAINER::iterator EVENT_LISTENER_CONTAINER_ITERATOR;
         
+        void addListenerToContainer(EVENT_LISTENER_CONTAINER& listeners,
+                                    EventListenerInterface* eventListener);
+        
+        void removeListenerFromContainer(EVENT_LISTENER_CONTAINER& listeners,
+                                         EventListenerInterface* eventListener);
+        
+        void sendEventToListeners(Event* event,
+                                  const EVENT_LISTENER_CONTAINER& listeners,
+                                  const AString& processedText);
+        
+        void eraseRemovedListeners();
+        
+        /**
+         * Increments the depth of nested calls to sendEvent() and, when
+         * destroyed, decrements it and erases removed listeners after
+         * the outermost call, even if a listener throws an exception.
+         */
+        class SendEventDepthGuard {
+        public:
+            SendEventDepthGuard(EventManager* eventManager);
+            
+            ~SendEventDepthGuard();
+            
+        private:
+            SendEventDepthGuard(const SendEventDepthGuard&);
+            
+            SendEventDepthGuard& operator=(const SendEventDepthGuard&);
+            
+            EventManager* m_eventManager;
+        };
+        
+        /**
+         * Records the time spent sending an event, when instrumentation
+         * is enabled, and keeps the nested event times balanced even if
+         * a listener throws an exception.
+         */
+        class SendEventTimingGuard {
+        public:
+            SendEventTimingGuard(EventManager* eventManager,
+                                 const int32_t eventTypeIndex);
+            
+            ~SendEventTimingGuard();
+            
+        private:
+            SendEventTimingGuard(const SendEventTimingGuard&);
+            
+            SendEventTimingGuard& operator=(const SendEventTimingGuard&);
+            
+            EventManager* m_eventManager;
+            
+            const int32_t m_eventTypeIndex;
+            
+            bool m_timingFlag;
+            
+            int64_t m_startNanoseconds;
+        };
+        
         /**
          * The event listeners
          */
@@ -137,6 +166,39 @@ namespace caret {
         /** A counter for blocking events of each type */
         std::vector<int64_t> m_eventBlockingCounter;
         
+        /** Depth of nested calls to sendEvent() */
+        int32_t m_sendEventDepth;
+        
+        /** Listeners were removed while sending an event and NULL entries need to be erased */
+        bool m_removedListenersPending;
+        
+        /** Type of the last invalidation event that was sent, for coalescing */
+        EventTypeEnum::Enum m_lastInvalidationEventType;
+        
+        /** Object invalidated by the last invalidation event, NULL if everything */
+        const void* m_lastInvalidatedObject;
+        
+        /** Value of the event issued counter after the last invalidation event was sent */
+        int64_t m_lastInvalidationEventIssuedCounter;
+        
+        /** Number of times each event type was issued */
+        std::vector<int64_t> m_eventTypeIssuedCounter;
+        
+        /** Number of times each event type was not sent since it repeated an invalidation */
+        std::vector<int64_t> m_eventTypeCoalescedCounter;
+        
+        /** Instrumentation records the time spent sending each event type */
+        bool m_instrumentationEnabled;
+        
+        /** Time spent sending each event type, including nested events */
+        std::vector<int64_t> m_eventTypeTotalNanoseconds;
+        
+        /** Time spent sending each event type, excluding nested events */
+        std::vector<int64_t> m_eventTypeSelfNanoseconds;
+        
+        /** Time spent in nested events for each level of sendEvent() being timed */
+        std::vector<int64_t> m_nestedEventNanoseconds;
+        
         static EventManager* s_singletonEventManager;
         
         friend EventListenerInterface;
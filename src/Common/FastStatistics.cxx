@@ -20,7 +20,8 @@
 /*LICENSE_END*/
 
 #include "FastStatistics.h"
-#include "CaretPointer.h"
+#include "CaretAssert.h"
+#include "CaretOMP.h"
 
 #include <algorithm>
 #include <cmath>
@@ -31,6 +32,51 @@ using namespace std;
 
 const int64_t NUM_BUCKETS_PERCENTILE_HIST = 10000;//10,000 maximum to deal with some outliers outliers until I think of a better fix
 
+namespace
+{
+    const int64_t CHUNK_SIZE = 1 << 16;//fixed size chunks, and merging in chunk order, so that results don't depend on the number of threads
+    
+    struct StatsChunk
+    {
+        int64_t m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount;
+        float m_min, m_max, m_mostPos, m_leastPos, m_leastNeg, m_mostNeg, m_leastAbs, m_mostAbs;
+        double m_sum;
+        bool m_haveValue;
+        StatsChunk()
+        {
+            m_posCount = 0;
+            m_zeroCount = 0;
+            m_negCount = 0;
+            m_infCount = 0;
+            m_negInfCount = 0;
+            m_nanCount = 0;
+            m_min = 0.0f;
+            m_max = 0.0f;
+            m_mostNeg = 0.0f;
+            m_leastNeg = -numeric_limits<float>::max();
+            m_leastPos = numeric_limits<float>::max();
+            m_mostPos = 0.0f;
+            m_leastAbs = numeric_limits<float>::max();
+            m_mostAbs = 0.0f;
+            m_sum = 0.0;
+            m_haveValue = false;
+        }
+    };
+    
+    //a percentile histogram is filled in the same pass as the standard deviation, so it needs its range up front
+    struct PercentileBuckets
+    {
+        float m_min, m_bucketSize;
+        bool m_active;//false when the range is empty, Histogram::setBucketCounts doesn't need counts then
+        PercentileBuckets(const int64_t& count, const float& low, const float& high, const int& numBuckets)
+        {
+            m_active = (count > 0 && high > low);
+            m_min = low;
+            m_bucketSize = (high - low) / numBuckets;
+        }
+    };
+}
+
 FastStatistics::FastStatistics()
 {
     reset();
@@ -64,170 +110,146 @@ void FastStatistics::reset()
 }
 
 void FastStatistics::update(const float* data, const int64_t& dataCount)
+{
+    updateInRange(data, dataCount, -numeric_limits<float>::max(), numeric_limits<float>::max());//every finite value is in range
+}
+
+void FastStatistics::update(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive)
+{
+    updateInRange(data, dataCount, minThreshInclusive, maxThreshInclusive);
+}
+
+void FastStatistics::updateInRange(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive)
 {
     reset();
-    CaretArray<float> positives(dataCount), negatives(dataCount), absolutes(dataCount);
-    double sum = 0.0;//for numerical stability
-    bool first = true;//so min can be positive and max can be negative
-    for (int64_t i = 0; i < dataCount; ++i)
+    const int64_t numChunks = (dataCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    vector<StatsChunk> chunks(numChunks);
+#pragma omp CARET_PARFOR schedule(dynamic) if(numChunks > 1)
+    for (int64_t chunk = 0; chunk < numChunks; ++chunk)
     {
-        if (data[i] != data[i])
+        StatsChunk& my = chunks[chunk];
+        double sum = 0.0;//for numerical stability
+        const int64_t end = min(dataCount, (chunk + 1) * CHUNK_SIZE);
+        for (int64_t i = chunk * CHUNK_SIZE; i < end; ++i)
         {
-            ++m_nanCount;
-            continue;//skip NaNs
-        }
-        if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
-        {
-            ++m_zeroCount;
-        } else {
-            if (data[i] < 0.0f)
+            if (data[i] != data[i])
             {
-                if (data[i] * 2.0f == data[i])
-                {
-                    ++m_negInfCount;
-                    continue;//skip neg infs
-                } else {
-                    negatives[m_negCount] = data[i];
-                    ++m_negCount;
-                    if (data[i] > m_leastNeg) m_leastNeg = data[i];
-                    if (data[i] < m_mostNeg) m_mostNeg = data[i];
-                    
-                    absolutes[m_absCount] = -data[i];
-                    if (absolutes[m_absCount] > m_mostAbs)  m_mostAbs  = absolutes[m_absCount];
-                    if (absolutes[m_absCount] < m_leastAbs) m_leastAbs = absolutes[m_absCount];
-                    ++m_absCount;
-                }
+                ++my.m_nanCount;
+                continue;//skip NaNs
+            }
+            if (data[i] < -1.0f && (data[i] * 2.0f == data[i]))
+            {
+                ++my.m_negInfCount;
+                continue;//skip and count all infs, ignoring the range for now
+            }
+            if (data[i] > 1.0f && (data[i] * 2.0f == data[i]))
+            {
+                ++my.m_infCount;
+                continue;//ditto
+            }
+            if (data[i] < minThreshInclusive || data[i] > maxThreshInclusive)
+            {//we now have only numerical values
+                continue;//skip them if they are outside the range
+            }
+            if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
+            {
+                ++my.m_zeroCount;
             } else {
-                if (data[i] * 2.0f == data[i])
+                if (data[i] < 0.0f)
                 {
-                    ++m_infCount;
-                    continue;//skip infs
+                    ++my.m_negCount;
+                    if (data[i] > my.m_leastNeg) my.m_leastNeg = data[i];
+                    if (data[i] < my.m_mostNeg) my.m_mostNeg = data[i];
+                    if (-data[i] > my.m_mostAbs) my.m_mostAbs = -data[i];
+                    if (-data[i] < my.m_leastAbs) my.m_leastAbs = -data[i];
                 } else {
-                    positives[m_posCount] = data[i];
-                    ++m_posCount;
-                    if (data[i] > m_mostPos) m_mostPos = data[i];
-                    if (data[i] < m_leastPos) m_leastPos = data[i];
-                    
-                    absolutes[m_absCount] = data[i];
-                    if (absolutes[m_absCount] > m_mostAbs)  m_mostAbs  = absolutes[m_absCount];
-                    if (absolutes[m_absCount] < m_leastAbs) m_leastAbs = absolutes[m_absCount];
-                    ++m_absCount;
+                    ++my.m_posCount;
+                    if (data[i] > my.m_mostPos) my.m_mostPos = data[i];
+                    if (data[i] < my.m_leastPos) my.m_leastPos = data[i];
+                    if (data[i] > my.m_mostAbs) my.m_mostAbs = data[i];
+                    if (data[i] < my.m_leastAbs) my.m_leastAbs = data[i];
                 }
             }
+            if (data[i] > my.m_max || !my.m_haveValue) my.m_max = data[i];
+            if (data[i] < my.m_min || !my.m_haveValue) my.m_min = data[i];
+            sum += data[i];//use a two-pass method for stability, only do mean this pass
+            my.m_haveValue = true;
         }
-        if (data[i] > m_max || first) m_max = data[i];
-        if (data[i] < m_min || first) m_min = data[i];
-        sum += data[i];//use a two-pass method for stability, only do mean this pass
-        first = false;
+        my.m_sum = sum;
     }
-    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
-    m_mean = sum / totalGood;
-    float tempf;
-    double sum2 = 0.0;
-    for (int64_t i = 0; i < dataCount; ++i)
-    {
-        if (data[i] != data[i]) continue;//skip NaNs
-        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
-        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
-        tempf = data[i] - m_mean;
-        sum2 += tempf * tempf;
-    }
-    if (totalGood > 0)
-    {
-        m_stdDevPop = sqrt(sum2 / totalGood);
-        if (totalGood > 1)
+    double sum = 0.0;
+    bool first = true;//so min can be positive and max can be negative
+    for (int64_t chunk = 0; chunk < numChunks; ++chunk)
+    {//merge in order
+        const StatsChunk& my = chunks[chunk];
+        m_posCount += my.m_posCount;
+        m_zeroCount += my.m_zeroCount;
+        m_negCount += my.m_negCount;
+        m_infCount += my.m_infCount;
+        m_negInfCount += my.m_negInfCount;
+        m_nanCount += my.m_nanCount;
+        sum += my.m_sum;
+        if (my.m_leastNeg > m_leastNeg) m_leastNeg = my.m_leastNeg;
+        if (my.m_mostNeg < m_mostNeg) m_mostNeg = my.m_mostNeg;
+        if (my.m_mostPos > m_mostPos) m_mostPos = my.m_mostPos;
+        if (my.m_leastPos < m_leastPos) m_leastPos = my.m_leastPos;
+        if (my.m_mostAbs > m_mostAbs) m_mostAbs = my.m_mostAbs;
+        if (my.m_leastAbs < m_leastAbs) m_leastAbs = my.m_leastAbs;
+        if (my.m_haveValue)
         {
-            m_stdDevSample = sqrt(sum2 / (totalGood - 1));
+            if (my.m_max > m_max || first) m_max = my.m_max;
+            if (my.m_min < m_min || first) m_min = my.m_min;
+            first = false;
         }
     }
+    m_absCount = m_negCount + m_posCount;
+    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
+    m_mean = sum / totalGood;
     int usebuckets = min(NUM_BUCKETS_PERCENTILE_HIST, dataCount);
-    m_negPercentHist.update(usebuckets, negatives, m_negCount);
-    m_posPercentHist.update(usebuckets, positives, m_posCount);
-    m_absPercentHist.update(usebuckets, absolutes, m_absCount);
-    
-    if (m_negCount <= 0)
-    {
-        m_leastNeg = 0.0;
-        m_mostNeg  = 0.0;
-    }
-    if (m_posCount <= 0)
-    {
-        m_leastPos = 0.0;
-        m_mostPos  = 0.0;
-    }
-    if (m_absCount <= 0)
+    const PercentileBuckets negBuckets(m_negCount, m_mostNeg, m_leastNeg, usebuckets);//same ranges a histogram of only those values would find
+    const PercentileBuckets posBuckets(m_posCount, m_leastPos, m_mostPos, usebuckets);
+    const PercentileBuckets absBuckets(m_absCount, m_leastAbs, m_mostAbs, usebuckets);
+    vector<double> chunkSum2(numChunks);
+    vector<int64_t> negCounts(usebuckets, 0), posCounts(usebuckets, 0), absCounts(usebuckets, 0);
+#pragma omp CARET_PAR if(numChunks > 1)
     {
-        m_leastAbs = 0.0;
-        m_mostAbs  = 0.0;
-    }
-}
-
-void FastStatistics::update(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive)
-{
-    reset();
-    CaretArray<float> positives(dataCount), negatives(dataCount), absolutes(dataCount);
-    double sum = 0.0;//for numerical stability
-    bool first = true;//so min can be positive and max can be negative
-    for (int64_t i = 0; i < dataCount; ++i)
-    {
-        if (data[i] != data[i])
-        {
-            ++m_nanCount;
-            continue;//skip NaNs
-        }
-        if (data[i] < -1.0f && (data[i] * 2.0f == data[i]))
-        {
-            ++m_negInfCount;
-            continue;//skip and count all infs, ignoring the range for now
-        }
-        if (data[i] > 1.0f && (data[i] * 2.0f == data[i]))
+        vector<int64_t> myNeg(negBuckets.m_active ? usebuckets : 0, 0), myPos(posBuckets.m_active ? usebuckets : 0, 0), myAbs(absBuckets.m_active ? usebuckets : 0, 0);//per-thread sub-histograms
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t chunk = 0; chunk < numChunks; ++chunk)
         {
-            ++m_infCount;
-            continue;//ditto
-        }
-        if (data[i] < minThreshInclusive || data[i] > maxThreshInclusive)
-        {//we now have only numerical values
-            continue;//skip them if they are outside the range
-        }
-        if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
-        {
-            ++m_zeroCount;
-        } else {
-            if (data[i] < 0.0f)
+            float tempf;
+            double sum2 = 0.0;
+            const int64_t end = min(dataCount, (chunk + 1) * CHUNK_SIZE);
+            for (int64_t i = chunk * CHUNK_SIZE; i < end; ++i)
             {
-                negatives[m_negCount] = data[i];
-                ++m_negCount;
-                if (data[i] > m_leastNeg) m_leastNeg = data[i];
-                if (data[i] < m_mostNeg) m_mostNeg = data[i];
-                
-                absolutes[m_absCount] = -data[i];
-                ++m_absCount;
-            } else {
-                positives[m_posCount] = data[i];
-                ++m_posCount;
-                if (data[i] > m_mostPos) m_mostPos = data[i];
-                if (data[i] < m_leastPos) m_leastPos = data[i];
-                
-                absolutes[m_absCount] = data[i];
-                ++m_absCount;
+                if (data[i] != data[i]) continue;//skip NaNs
+                if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
+                if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
+                if (data[i] < minThreshInclusive || data[i] > maxThreshInclusive) continue;//the mean only used values in range
+                tempf = data[i] - m_mean;
+                sum2 += tempf * tempf;
+                if (data[i] < 0.0f)
+                {
+                    if (negBuckets.m_active) ++myNeg[Histogram::getBucketIndex(data[i], negBuckets.m_min, negBuckets.m_bucketSize, usebuckets)];
+                    if (absBuckets.m_active) ++myAbs[Histogram::getBucketIndex(-data[i], absBuckets.m_min, absBuckets.m_bucketSize, usebuckets)];
+                } else if (data[i] > 0.0f) {
+                    if (posBuckets.m_active) ++myPos[Histogram::getBucketIndex(data[i], posBuckets.m_min, posBuckets.m_bucketSize, usebuckets)];
+                    if (absBuckets.m_active) ++myAbs[Histogram::getBucketIndex(data[i], absBuckets.m_min, absBuckets.m_bucketSize, usebuckets)];
+                }
             }
+            chunkSum2[chunk] = sum2;
+        }
+#pragma omp critical
+        {
+            for (int i = 0; i < (int)myNeg.size(); ++i) negCounts[i] += myNeg[i];
+            for (int i = 0; i < (int)myPos.size(); ++i) posCounts[i] += myPos[i];
+            for (int i = 0; i < (int)myAbs.size(); ++i) absCounts[i] += myAbs[i];
         }
-        if (data[i] > m_max || first) m_max = data[i];
-        if (data[i] < m_min || first) m_min = data[i];
-        sum += data[i];//use a two-pass method for stability, only do mean this pass
-        first = false;
     }
-    int64_t totalGood = (m_negCount + m_zeroCount + m_posCount);
-    m_mean = sum / totalGood;
-    float tempf;
     double sum2 = 0.0;
-    for (int64_t i = 0; i < dataCount; ++i)
+    for (int64_t chunk = 0; chunk < numChunks; ++chunk)
     {
-        if (data[i] != data[i]) continue;//skip NaNs
-        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
-        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
-        tempf = data[i] - m_mean;
-        sum2 += tempf * tempf;
+        sum2 += chunkSum2[chunk];
     }
     if (totalGood > 0)
     {
@@ -237,11 +259,6 @@ void FastStatistics::update(const float* data, const int64_t& dataCount, const f
             m_stdDevSample = sqrt(sum2 / (totalGood - 1));
         }
     }
-    int usebuckets = min(NUM_BUCKETS_PERCENTILE_HIST, dataCount);
-    m_negPercentHist.update(usebuckets, negatives, m_negCount);//10,000 will probably allow us to approximate the percentiles pretty closely, and eats only 80K of memory each
-    m_posPercentHist.update(usebuckets, positives, m_posCount);
-    m_absPercentHist.update(usebuckets, absolutes, m_absCount);
-    
     if (m_negCount <= 0)
     {
         m_leastNeg = 0.0;
@@ -257,6 +274,9 @@ void FastStatistics::update(const float* data, const int64_t& dataCount, const f
         m_leastAbs = 0.0;
         m_mostAbs  = 0.0;
     }
+    m_negPercentHist.setBucketCounts(negCounts, m_mostNeg, m_leastNeg, 0, 0, m_negCount);//10,000 will probably allow us to approximate the percentiles pretty closely, and eats only 80K of memory each
+    m_posPercentHist.setBucketCounts(posCounts, m_leastPos, m_mostPos, m_posCount, 0, 0);
+    m_absPercentHist.setBucketCounts(absCounts, m_leastAbs, m_mostAbs, m_absCount, 0, 0);
 }
 
 float FastStatistics::getApproxNegativePercentile(const float& percent) const
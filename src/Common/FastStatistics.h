@@ -37,6 +37,8 @@ namespace caret
         
         void reset();
         
+        void updateInRange(const float* data, const int64_t& dataCount, const float& minThreshInclusive, const float& maxThreshInclusive);
+        
         static float getValuePercentileHelper(const Histogram& histogram, const float numberOfDataValues, const bool negativeDataFlag, const float value);
 
     public:
@@ -22,35 +22,149 @@
 #include "CaretAssert.h"
 #include "CaretException.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "FloatMatrix.h"
 #include "MatrixFunctions.h"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace caret;
 using namespace std;
 
-bool FloatMatrix::checkDimensions() const
+namespace
 {
-   uint64_t rows = m_matrix.size(), cols;
-   if (rows == 0) return true;//treat it as fine for now
-   cols = m_matrix[0].size();
-   for (uint64_t i = 1; i < rows; ++i)
+   //block sizes for multiply: a block of rows of the result is accumulated in doubles (8 * 512 doubles = 32KB),
+   //while each row of the right matrix is read once per block of rows
+   const int64_t MULTIPLY_ROW_BLOCK = 8;
+   const int64_t MULTIPLY_COL_BLOCK = 512;
+   
+   //result = left * right, all contiguous row-major, accumulating in double in the same order as MatrixFunctions::multiply
+   void blockedMultiply(const float* left, const float* right, float* result, const int64_t leftRows, const int64_t inner, const int64_t rightCols)
    {
-      if (m_matrix[i].size() != cols)
+      const int64_t numRowBlocks = (leftRows + MULTIPLY_ROW_BLOCK - 1) / MULTIPLY_ROW_BLOCK;
+#pragma omp CARET_PARFOR schedule(dynamic) if(leftRows * inner * rightCols >= 1000000)
+      for (int64_t rowBlock = 0; rowBlock < numRowBlocks; ++rowBlock)
       {
-         return false;
+         double accum[MULTIPLY_ROW_BLOCK * MULTIPLY_COL_BLOCK];
+         const int64_t firstRow = rowBlock * MULTIPLY_ROW_BLOCK, afterLastRow = min(firstRow + MULTIPLY_ROW_BLOCK, leftRows);
+         for (int64_t firstCol = 0; firstCol < rightCols; firstCol += MULTIPLY_COL_BLOCK)
+         {
+            const int64_t blockCols = min(MULTIPLY_COL_BLOCK, rightCols - firstCol);
+            for (int64_t i = 0; i < (afterLastRow - firstRow) * MULTIPLY_COL_BLOCK; ++i)
+            {
+               accum[i] = 0.0;
+            }
+            for (int64_t k = 0; k < inner; ++k)
+            {
+               const float* rightRow = right + k * rightCols + firstCol;
+               for (int64_t row = firstRow; row < afterLastRow; ++row)
+               {
+                  const float leftVal = left[row * inner + k];
+                  double* accumRow = accum + (row - firstRow) * MULTIPLY_COL_BLOCK;
+                  for (int64_t j = 0; j < blockCols; ++j)
+                  {
+                     accumRow[j] += leftVal * rightRow[j];//product in float, sum in double, same as before
+                  }
+               }
+            }
+            for (int64_t row = firstRow; row < afterLastRow; ++row)
+            {
+               const double* accumRow = accum + (row - firstRow) * MULTIPLY_COL_BLOCK;
+               float* resultRow = result + row * rightCols + firstCol;
+               for (int64_t j = 0; j < blockCols; ++j)
+               {
+                  resultRow[j] = accumRow[j];
+               }
+            }
+         }
       }
    }
-   return true;
+   
+   //apply the householder reflection (I - 2 * v * v' / vnormsqr) to the rows firstRow and later of a row-major matrix with the given number of columns
+   //done a row at a time so that the data is read contiguously, and multithreaded across the columns when there are many
+   void applyHouseholder(const vector<double>& v, const double vnormsqr, double* matrix, const int64_t firstRow, const int64_t numRows, const int64_t numCols)
+   {
+      const int64_t COL_CHUNK = 256;
+      const int64_t numChunks = (numCols + COL_CHUNK - 1) / COL_CHUNK;
+#pragma omp CARET_PARFOR schedule(dynamic) if((numRows - firstRow) * numCols >= 100000)
+      for (int64_t chunk = 0; chunk < numChunks; ++chunk)
+      {
+         const int64_t firstCol = chunk * COL_CHUNK, afterLastCol = min(firstCol + COL_CHUNK, numCols);
+         double dots[COL_CHUNK];
+         for (int64_t j = firstCol; j < afterLastCol; ++j)
+         {
+            dots[j - firstCol] = 0.0;
+         }
+         for (int64_t i = firstRow; i < numRows; ++i)
+         {
+            const double vi = v[i - firstRow];
+            const double* row = matrix + i * numCols;
+            for (int64_t j = firstCol; j < afterLastCol; ++j)
+            {
+               dots[j - firstCol] += vi * row[j];
+            }
+         }
+         for (int64_t j = firstCol; j < afterLastCol; ++j)
+         {
+            dots[j - firstCol] *= 2.0 / vnormsqr;
+         }
+         for (int64_t i = firstRow; i < numRows; ++i)
+         {
+            const double vi = v[i - firstRow];
+            double* row = matrix + i * numCols;
+            for (int64_t j = firstCol; j < afterLastCol; ++j)
+            {
+               row[j] -= vi * dots[j - firstCol];
+            }
+         }
+      }
+   }
+
+}
+
+bool FloatMatrix::checkDimensions() const
+{
+   if (m_numRows < 0 || m_numCols < 0) return false;
+   return ((int64_t)m_data.size() == m_numRows * m_numCols);
+}
+
+vector<vector<float> > FloatMatrix::toVectorVector() const
+{
+   vector<vector<float> > ret(m_numRows);
+   for (int64_t i = 0; i < m_numRows; ++i)
+   {
+      ret[i].assign(m_data.begin() + i * m_numCols, m_data.begin() + (i + 1) * m_numCols);
+   }
+   return ret;
+}
+
+void FloatMatrix::setFromVectorVector(const vector<vector<float> >& matrixIn)
+{
+   m_numRows = (int64_t)matrixIn.size();
+   m_numCols = 0;
+   if (m_numRows > 0)
+   {
+      m_numCols = (int64_t)matrixIn[0].size();
+   }
+   m_data.resize(m_numRows * m_numCols);
+   for (int64_t i = 0; i < m_numRows; ++i)
+   {
+      CaretAssert((int64_t)matrixIn[i].size() == m_numCols);
+      std::copy(matrixIn[i].begin(), matrixIn[i].begin() + m_numCols, m_data.begin() + i * m_numCols);
+   }
 }
 
 FloatMatrix::FloatMatrix(const vector<vector<float> >& matrixIn)
 {
-   m_matrix = matrixIn;
+   setFromVectorVector(matrixIn);
    CaretAssert(checkDimensions());
 }
 
 FloatMatrix::FloatMatrix(const int64_t& rows, const int64_t& cols)
 {
+    m_numRows = 0;
+    m_numCols = 0;
     resize(rows, cols, true);
 }
 
@@ -62,93 +176,145 @@ bool FloatMatrix::operator!=(const FloatMatrix& right) const
 FloatMatrix FloatMatrix::operator*(const FloatMatrix& right) const
 {
    FloatMatrix ret;
-   MatrixFunctions::multiply<float, float, float, double>(m_matrix, right.m_matrix, ret.m_matrix);
+   if (m_numCols != right.m_numRows) return ret;//0x0 on error, like MatrixFunctions
+   if (m_numRows == 0 || m_numCols == 0 || right.m_numCols == 0) return ret;
+   ret.resize(m_numRows, right.m_numCols, true);
+   blockedMultiply(m_data.data(), right.m_data.data(), ret.m_data.data(), m_numRows, m_numCols, right.m_numCols);
    return ret;
 }
 
 FloatMatrix& FloatMatrix::operator*=(const FloatMatrix& right)
 {
-   MatrixFunctions::multiply<float, float, float, double>(m_matrix, right.m_matrix, m_matrix);//would need a copy anyway, so let it make the copy internally
+   *this = (*this) * right;//would need a copy anyway
    return *this;
 }
 
 FloatMatrix FloatMatrix::concatHoriz(const FloatMatrix& right) const
 {
    FloatMatrix ret;
-   MatrixFunctions::horizCat(m_matrix, right.m_matrix, ret.m_matrix);
+   if (m_numRows != right.m_numRows) return ret;
+   ret.resize(m_numRows, m_numCols + right.m_numCols, true);
+   for (int64_t i = 0; i < m_numRows; ++i)
+   {
+      std::copy(m_data.begin() + i * m_numCols, m_data.begin() + (i + 1) * m_numCols, ret.m_data.begin() + i * ret.m_numCols);
+      std::copy(right.m_data.begin() + i * right.m_numCols, right.m_data.begin() + (i + 1) * right.m_numCols, ret.m_data.begin() + i * ret.m_numCols + m_numCols);
+   }
    return ret;
 }
 
 FloatMatrix FloatMatrix::concatVert(const FloatMatrix& bottom) const
 {
    FloatMatrix ret;
-   MatrixFunctions::vertCat(m_matrix, bottom.m_matrix, ret.m_matrix);
+   if (m_numRows == 0)
+   {
+      return bottom;
+   }
+   if (bottom.m_numRows == 0)
+   {
+      return *this;
+   }
+   if (m_numCols != bottom.m_numCols) return ret;
+   ret.m_numRows = m_numRows + bottom.m_numRows;
+   ret.m_numCols = m_numCols;
+   ret.m_data.reserve(ret.m_numRows * ret.m_numCols);
+   ret.m_data.insert(ret.m_data.end(), m_data.begin(), m_data.end());
+   ret.m_data.insert(ret.m_data.end(), bottom.m_data.begin(), bottom.m_data.end());
    return ret;
 }
 
 FloatMatrix FloatMatrix::getRange(const int64_t firstRow, const int64_t afterLastRow, const int64_t firstCol, const int64_t afterLastCol) const
 {
    FloatMatrix ret;
-   MatrixFunctions::getChunk(firstRow, afterLastRow, firstCol, afterLastCol, m_matrix, ret.m_matrix);
+   if (firstRow < 0 || firstCol < 0 || afterLastRow > m_numRows || afterLastCol > m_numCols) return ret;
+   if (afterLastRow <= firstRow || afterLastCol <= firstCol) return ret;
+   ret.resize(afterLastRow - firstRow, afterLastCol - firstCol, true);
+   for (int64_t i = firstRow; i < afterLastRow; ++i)
+   {
+      std::copy(m_data.begin() + i * m_numCols + firstCol, m_data.begin() + i * m_numCols + afterLastCol, ret.m_data.begin() + (i - firstRow) * ret.m_numCols);
+   }
    return ret;
 }
 
 FloatMatrix FloatMatrix::identity(const int64_t rows)
 {
-   FloatMatrix ret;
-   MatrixFunctions::identity(rows, ret.m_matrix);
+   FloatMatrix ret = zeros(rows, rows);
+   for (int64_t i = 0; i < rows; ++i)
+   {
+      ret.m_data[i * rows + i] = 1.0f;
+   }
    return ret;
 }
 
 FloatMatrix FloatMatrix::inverse() const
-{
-   FloatMatrix ret;
-   MatrixFunctions::inverse(m_matrix, ret.m_matrix);
-   return ret;
+{//small matrices only in practice, use the same gauss-jordan code as before so results don't change
+   vector<vector<float> > result;
+   MatrixFunctions::inverse(toVectorVector(), result);
+   return FloatMatrix(result);
 }
 
 FloatMatrix& FloatMatrix::operator*=(const float& right)
 {
-   MatrixFunctions::multiply(m_matrix, right, m_matrix);//internally makes a copy
+   for (int64_t i = 0; i < (int64_t)m_data.size(); ++i)
+   {
+      m_data[i] *= right;
+   }
    return *this;
 }
 
 FloatMatrix FloatMatrix::operator+(const FloatMatrix& right) const
 {
-   FloatMatrix ret;
-   MatrixFunctions::add(m_matrix, right.m_matrix, ret.m_matrix);
+   FloatMatrix ret(*this);
+   ret += right;
    return ret;
 }
 
 FloatMatrix& FloatMatrix::operator+=(const FloatMatrix& right)
 {
-   MatrixFunctions::add(m_matrix, right.m_matrix, m_matrix);
+   if (m_numRows != right.m_numRows || m_numCols != right.m_numCols)
+   {
+      *this = FloatMatrix();
+      return *this;
+   }
+   for (int64_t i = 0; i < (int64_t)m_data.size(); ++i)
+   {
+      m_data[i] += right.m_data[i];
+   }
    return *this;
 }
 
 FloatMatrix& FloatMatrix::operator+=(const float& right)
 {
-   MatrixFunctions::add(m_matrix, right, m_matrix);
+   for (int64_t i = 0; i < (int64_t)m_data.size(); ++i)
+   {
+      m_data[i] += right;
+   }
    return *this;
 }
 
 FloatMatrix FloatMatrix::operator-(const FloatMatrix& right) const
 {
-   FloatMatrix ret;
-   MatrixFunctions::subtract(m_matrix, right.m_matrix, ret.m_matrix);
+   FloatMatrix ret(*this);
+   ret -= right;
    return ret;
 }
 
 FloatMatrix& FloatMatrix::operator-=(const FloatMatrix& right)
 {
-   MatrixFunctions::subtract(m_matrix, right.m_matrix, m_matrix);
+   if (m_numRows != right.m_numRows || m_numCols != right.m_numCols)
+   {
+      *this = FloatMatrix();
+      return *this;
+   }
+   for (int64_t i = 0; i < (int64_t)m_data.size(); ++i)
+   {
+      m_data[i] -= right.m_data[i];
+   }
    return *this;
 }
 
 FloatMatrix& FloatMatrix::operator-=(const float& right)
 {
-   MatrixFunctions::add(m_matrix, (-right), m_matrix);
-   return *this;
+   return ((*this) += (-right));
 }
 
 FloatMatrix& FloatMatrix::operator/=(const float& right)
@@ -162,74 +328,92 @@ bool FloatMatrix::operator==(const FloatMatrix& right) const
    {
       return true;//short circuit true on pointer equivalence
    }
-   int64_t i, j, rows = (int64_t)m_matrix.size(), cols;
-   if (rows != (int64_t)right.m_matrix.size())
+   if (m_numRows != right.m_numRows)
    {
       return false;
    }
-   if (rows == 0)
+   if (m_numRows == 0)
    {
-      return true;//don't try to get the second dimension
+      return true;//don't compare the second dimension
    }
-   cols = (int64_t)m_matrix[0].size();
-   if (cols != (int64_t)right.m_matrix[0].size())
+   if (m_numCols != right.m_numCols)
    {
       return false;
    }
-   for (i = 0; i < rows; ++i)
-   {
-      for (j = 0; j < cols; ++j)
-      {
-         if (m_matrix[i][j] != right.m_matrix[i][j])
-         {
-            return false;
-         }
-      }
-   }
-   return true;
+   return (m_data == right.m_data);
 }
 
 void FloatMatrix::getDimensions(int64_t& rows, int64_t& cols) const
 {
-   rows = (int64_t)m_matrix.size();
-   if (rows == 0)
-   {
-      cols = 0;
-   } else {
-      cols = (int64_t)m_matrix[0].size();
-   }
+   rows = m_numRows;
+   cols = m_numCols;
 }
 
 FloatMatrixRowRef FloatMatrix::operator[](const int64_t& index)
 {
-   CaretAssert(index > -1 && index < (int64_t)m_matrix.size());
-   FloatMatrixRowRef ret(m_matrix[index]);
+   CaretAssert(index > -1 && index < m_numRows);
+   FloatMatrixRowRef ret(m_data.data() + index * m_numCols, m_numCols);
    return ret;
 }
 
 ConstFloatMatrixRowRef FloatMatrix::operator[](const int64_t& index) const
 {
-   CaretAssert(index > -1 && index < (int64_t)m_matrix.size());
-   ConstFloatMatrixRowRef ret(m_matrix[index]);
+   CaretAssert(index > -1 && index < m_numRows);
+   ConstFloatMatrixRowRef ret(m_data.data() + index * m_numCols, m_numCols);
    return ret;
 }
 
 FloatMatrix FloatMatrix::reducedRowEchelon() const
-{
-   FloatMatrix ret(*this);
-   MatrixFunctions::rref(ret.m_matrix);
-   return ret;
+{//same code as before, so results don't change
+   vector<vector<float> > result = toVectorVector();
+   MatrixFunctions::rref(result);
+   return FloatMatrix(result);
 }
 
 void FloatMatrix::resize(const int64_t rows, const int64_t cols, const bool destructive)
 {
-   MatrixFunctions::resize(rows, cols, m_matrix, destructive);
+   if (rows < 0 || cols < 0)
+   {
+      *this = FloatMatrix();
+      return;
+   }
+   if (destructive || cols == m_numCols || m_numRows == 0)
+   {//same row layout, so contents within bounds stay in place (or we don't care)
+      m_data.resize(rows * cols);
+   } else {
+      vector<float> newData(rows * cols, 0.0f);
+      const int64_t copyRows = min(rows, m_numRows), copyCols = min(cols, m_numCols);
+      for (int64_t i = 0; i < copyRows; ++i)
+      {
+         std::copy(m_data.begin() + i * m_numCols, m_data.begin() + i * m_numCols + copyCols, newData.begin() + i * cols);
+      }
+      m_data.swap(newData);
+   }
+   m_numRows = rows;
+   m_numCols = cols;
+   CaretAssert(checkDimensions());
 }
 
 FloatMatrix FloatMatrix::transpose() const
 {
    FloatMatrix ret;
-   MatrixFunctions::transpose(m_matrix, ret.m_matrix);
+   ret.resize(m_numCols, m_numRows, true);
+   const int64_t BLOCK = 32;//transpose in tiles so both reads and writes stay in cache
+   for (int64_t ib = 0; ib < m_numRows; ib += BLOCK)
+   {
+      const int64_t iend = min(ib + BLOCK, m_numRows);
+      for (int64_t jb = 0; jb < m_numCols; jb += BLOCK)
+      {
+         const int64_t jend = min(jb + BLOCK, m_numCols);
+         for (int64_t i = ib; i < iend; ++i)
+         {
+            for (int64_t j = jb; j < jend; ++j)
+            {
+               ret.m_data[j * m_numRows + i] = m_data[i * m_numCols + j];
+            }
+         }
+      }
+   }
    return ret;
 }
 
@@ -238,6 +422,7 @@ float FloatMatrix::determinant() const
     int64_t numRows = getNumberOfRows(), numCols = getNumberOfColumns();
     if (numRows != numCols) throw CaretException("determinant() called on non-square matrix");
     if (numRows == 0) return 1;//whatever
+    const FloatMatrix& m_matrix = *this;
     if (numRows == 1) return m_matrix[0][0];
     if (numRows == 2) return m_matrix[0][0] * m_matrix[1][1] - m_matrix[0][1] * m_matrix[1][0];
     if (numRows == 3) return m_matrix[0][0] * m_matrix[1][1] * m_matrix[2][2] +
@@ -260,31 +445,89 @@ float FloatMatrix::determinant() const
     return ret;
 }
 
+FloatMatrix FloatMatrix::solveLeastSquares(const FloatMatrix& rhs) const
+{
+   FloatMatrix ret;
+   const int64_t numRows = m_numRows, numCols = m_numCols, numRHS = rhs.m_numCols;
+   if (rhs.m_numRows != numRows || numCols == 0 || numRows < numCols) return ret;
+   vector<double> A(m_data.begin(), m_data.end()), B(rhs.m_data.begin(), rhs.m_data.end());
+   vector<double> origNorms(numCols, 0.0);
+   for (int64_t i = 0; i < numRows; ++i)
+   {
+      for (int64_t j = 0; j < numCols; ++j)
+      {
+         origNorms[j] += A[i * numCols + j] * A[i * numCols + j];
+      }
+   }
+   vector<double> v;
+   for (int64_t j = 0; j < numCols; ++j)
+   {//householder QR, applying Q' to the right hand sides as we go, so Q is never stored
+      double normsqr = 0.0;
+      for (int64_t i = j; i < numRows; ++i)
+      {
+         normsqr += A[i * numCols + j] * A[i * numCols + j];
+      }
+      double norm = sqrt(normsqr);
+      if (!(norm > sqrt(origNorms[j]) * 1e-10)) return ret;//rank deficient (also catches NaN)
+      const double alpha = (A[j * numCols + j] > 0.0 ? -norm : norm);
+      v.resize(numRows - j);
+      for (int64_t i = j; i < numRows; ++i)
+      {
+         v[i - j] = A[i * numCols + j];
+      }
+      v[0] -= alpha;
+      const double vnormsqr = normsqr - A[j * numCols + j] * A[j * numCols + j] + v[0] * v[0];
+      applyHouseholder(v, vnormsqr, A.data(), j, numRows, numCols);//also zeros column j below the diagonal
+      A[j * numCols + j] = alpha;
+      if (numRHS > 0)
+      {
+         applyHouseholder(v, vnormsqr, B.data(), j, numRows, numRHS);
+      }
+   }
+   ret.resize(numCols, numRHS, true);
+   for (int64_t c = 0; c < numRHS; ++c)
+   {//back substitution with R
+      for (int64_t i = numCols - 1; i >= 0; --i)
+      {
+         double accum = B[i * numRHS + c];
+         for (int64_t k = i + 1; k < numCols; ++k)
+         {
+            accum -= A[i * numCols + k] * ret.m_data[k * numRHS + c];
+         }
+         ret.m_data[i * numRHS + c] = accum / A[i * numCols + i];
+      }
+   }
+   return ret;
+}
+
 FloatMatrix FloatMatrix::zeros(const int64_t rows, const int64_t cols)
 {
    FloatMatrix ret;
-   MatrixFunctions::zeros(rows, cols, ret.m_matrix);
+   ret.resize(rows, cols, true);
+   std::fill(ret.m_data.begin(), ret.m_data.end(), 0.0f);
    return ret;
 }
 
 FloatMatrix FloatMatrix::ones(const int64_t rows, const int64_t cols)
 {
    FloatMatrix ret;
-   MatrixFunctions::ones(rows, cols, ret.m_matrix);
+   ret.resize(rows, cols, true);
+   std::fill(ret.m_data.begin(), ret.m_data.end(), 1.0f);
    return ret;
 }
 
-const vector<vector<float> >& FloatMatrix::getMatrix() const
+vector<vector<float> > FloatMatrix::getMatrix() const
 {
-   return m_matrix;
+   return toVectorVector();
 }
 
 void FloatMatrix::getAffineVectors(Vector3D& xvec, Vector3D& yvec, Vector3D& zvec, Vector3D& offset) const
 {
-    if (m_matrix.size() < 3 || m_matrix.size() > 4 || m_matrix[0].size() != 4)
+    if (m_numRows < 3 || m_numRows > 4 || m_numCols != 4)
     {
         throw CaretException("getAffineVectors called on incorrectly sized matrix");
     }
+    const FloatMatrix& m_matrix = *this;
     xvec[0] = m_matrix[0][0]; xvec[1] = m_matrix[1][0]; xvec[2] = m_matrix[2][0];
     yvec[0] = m_matrix[0][1]; yvec[1] = m_matrix[1][1]; yvec[2] = m_matrix[2][1];
     zvec[0] = m_matrix[0][2]; zvec[1] = m_matrix[1][2]; zvec[2] = m_matrix[2][2];
@@ -300,24 +543,24 @@ FloatMatrix FloatMatrix::operator-() const
    return ret;
 }
 
-FloatMatrixRowRef::FloatMatrixRowRef(vector<float>& therow) : m_row(therow)
+FloatMatrixRowRef::FloatMatrixRowRef(float* therow, const int64_t numCols) : m_row(therow), m_numCols(numCols)
 {
 }
 
 FloatMatrixRowRef& FloatMatrixRowRef::operator=(const FloatMatrixRowRef& right)
 {
-   if (&m_row == &(right.m_row))
-   {//just in case vector isn't smart enough to check self assignment
+   if (m_row == right.m_row)
+   {
       return *this;
    }
-   CaretAssert(m_row.size() == right.m_row.size());//maybe this should be an exception, not an assertion?
-   m_row = right.m_row;
+   CaretAssert(m_numCols == right.m_numCols);//maybe this should be an exception, not an assertion?
+   std::copy(right.m_row, right.m_row + m_numCols, m_row);
    return *this;
 }
 
 FloatMatrixRowRef& FloatMatrixRowRef::operator=(const float& right)
 {
-   for (int64_t i = 0; i < (int64_t)m_row.size(); ++i)
+   for (int64_t i = 0; i < m_numCols; ++i)
    {
       m_row[i] = right;
    }
@@ -326,35 +569,35 @@ FloatMatrixRowRef& FloatMatrixRowRef::operator=(const float& right)
 
 float& FloatMatrixRowRef::operator[](const int64_t& index)
 {
-   CaretAssert(index > -1 && index < (int64_t)m_row.size());//instead of segfaulting, explicitly check in debug
+   CaretAssert(index > -1 && index < m_numCols);//instead of segfaulting, explicitly check in debug
    return m_row[index];
 }
 
-FloatMatrixRowRef::FloatMatrixRowRef(FloatMatrixRowRef& right) : m_row(right.m_row)
+FloatMatrixRowRef::FloatMatrixRowRef(FloatMatrixRowRef& right) : m_row(right.m_row), m_numCols(right.m_numCols)
 {
 }
 
 FloatMatrixRowRef& FloatMatrixRowRef::operator=(const ConstFloatMatrixRowRef& right)
 {
-   if (&m_row == &(right.m_row))
-   {//just in case vector isn't smart enough to check self assignment
+   if (m_row == right.m_row)
+   {
       return *this;
    }
-   CaretAssert(m_row.size() == right.m_row.size());
-   m_row = right.m_row;
+   CaretAssert(m_numCols == right.m_numCols);
+   std::copy(right.m_row, right.m_row + m_numCols, m_row);
    return *this;
 }
 
 const float& ConstFloatMatrixRowRef::operator[](const int64_t& index)
 {
-   CaretAssert(index > -1 && index < (int64_t)m_row.size());//instead of segfaulting, explicitly check in debug
+   CaretAssert(index > -1 && index < m_numCols);//instead of segfaulting, explicitly check in debug
    return m_row[index];
 }
 
-ConstFloatMatrixRowRef::ConstFloatMatrixRowRef(const ConstFloatMatrixRowRef& right) : m_row(right.m_row)
+ConstFloatMatrixRowRef::ConstFloatMatrixRowRef(const ConstFloatMatrixRowRef& right) : m_row(right.m_row), m_numCols(right.m_numCols)
 {
 }
 
-ConstFloatMatrixRowRef::ConstFloatMatrixRowRef(const vector<float>& therow) : m_row(therow)
+ConstFloatMatrixRowRef::ConstFloatMatrixRowRef(const float* therow, const int64_t numCols) : m_row(therow), m_numCols(numCols)
 {
 }
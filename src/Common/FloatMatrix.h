@@ -30,36 +30,41 @@ namespace caret {
 
    class ConstFloatMatrixRowRef
    {//needed to do [][] on a const FloatMatrix
-      const std::vector<float>& m_row;
-      ConstFloatMatrixRowRef();//disallow default construction, this contains a reference
+      const float* m_row;
+      int64_t m_numCols;
+      ConstFloatMatrixRowRef();//disallow default construction, this points into the matrix
    public:
       ConstFloatMatrixRowRef(const ConstFloatMatrixRowRef& right);//copy constructor
-      ConstFloatMatrixRowRef(const std::vector<float>& therow);
+      ConstFloatMatrixRowRef(const float* therow, const int64_t numCols);
       const float& operator[](const int64_t& index);//access element
       friend class FloatMatrixRowRef;//so it can check if it points to the same row
    };
 
    class FloatMatrixRowRef
-   {//needed to ensure some joker doesn't call mymatrix[1].resize();, while still allowing mymatrix[1][2] = 5; and mymatrix[1] = mymatrix[2];
-      std::vector<float>& m_row;
-      FloatMatrixRowRef();//disallow default construction, this contains a reference
+   {//needed to ensure some joker doesn't resize a row, while still allowing mymatrix[1][2] = 5; and mymatrix[1] = mymatrix[2];
+      float* m_row;
+      int64_t m_numCols;
+      FloatMatrixRowRef();//disallow default construction, this points into the matrix
    public:
       FloatMatrixRowRef(FloatMatrixRowRef& right);//copy constructor
-      FloatMatrixRowRef(std::vector<float>& therow);
+      FloatMatrixRowRef(float* therow, const int64_t numCols);
       FloatMatrixRowRef& operator=(const FloatMatrixRowRef& right);//NOTE: copy row contents!
       FloatMatrixRowRef& operator=(const ConstFloatMatrixRowRef& right);//NOTE: copy row contents!
       FloatMatrixRowRef& operator=(const float& right);//NOTE: set all row values!
       float& operator[](const int64_t& index);//access element
    };
 
-   ///class for using single precision matrices (insulates other code from the MatrixFunctions templated header)
-   ///errors will result in a matrix of size 0x0, or an assertion failure if the underlying vector<vector> isn't rectangular
+   ///class for using single precision matrices, stored contiguously in row-major order
+   ///errors will result in a matrix of size 0x0, or an assertion failure if a vector<vector> used to construct it isn't rectangular
    class FloatMatrix
    {
-      std::vector<std::vector<float> > m_matrix;
+      std::vector<float> m_data;//row-major, element (i, j) is at i * m_numCols + j
+      int64_t m_numRows, m_numCols;
       bool checkDimensions() const;//put this inside asserts at the end of functions
+      std::vector<std::vector<float> > toVectorVector() const;
+      void setFromVectorVector(const std::vector<std::vector<float> >& matrixIn);
    public:
-      FloatMatrix() { };//to make the compiler happy
+      FloatMatrix() : m_numRows(0), m_numCols(0) { };//to make the compiler happy
       ///construct from a simple vector<vector<float> >
       FloatMatrix(const std::vector<std::vector<float> >& matrixIn);
       ///construct uninitialized with given size
@@ -76,7 +81,7 @@ namespace caret {
       FloatMatrix operator+(const FloatMatrix& right) const;//add
       FloatMatrix operator-(const FloatMatrix& right) const;//subtract
       FloatMatrix operator-() const;//negate
-      FloatMatrix operator*(const FloatMatrix& right) const;//multiply
+      FloatMatrix operator*(const FloatMatrix& right) const;//multiply - cache blocked and multithreaded for large matrices
       bool operator==(const FloatMatrix& right) const;//compare
       bool operator!=(const FloatMatrix& right) const;//anti-compare
       ///return the inverse
@@ -87,6 +92,8 @@ namespace caret {
       FloatMatrix transpose() const;
       ///determinant - warning, uses slow O(n!) recursive algorithm
       float determinant() const;
+      ///least squares solution X of this * X = rhs for each column of rhs, using householder QR in double precision - returns 0x0 if this is rank deficient
+      FloatMatrix solveLeastSquares(const FloatMatrix& rhs) const;
       ///resize the matrix - keeps contents within bounds unless destructive is true (destructive is faster)
       void resize(const int64_t rows, const int64_t cols, const bool destructive = false);
       ///get the range of values from first until one before afterLast, as a new matrix
@@ -98,17 +105,17 @@ namespace caret {
       ///get the dimensions
       void getDimensions(int64_t& rows, int64_t& cols) const;
       ///get the matrix as a vector<vector>
-      const std::vector<std::vector<float> >& getMatrix() const;
+      std::vector<std::vector<float> > getMatrix() const;
+      ///get the contiguous row-major data
+      float* getData() { return m_data.data(); }
+      ///get the contiguous row-major data
+      const float* getData() const { return m_data.data(); }
       ///separate 3x4 or 4x4 into Vector3Ds, throw on wrong dimensions
       void getAffineVectors(Vector3D& xvec, Vector3D& yvec, Vector3D& zvec, Vector3D& offset) const;
       ///get number of rows
-      int64_t getNumberOfRows() const { return (int64_t)m_matrix.size(); }
+      int64_t getNumberOfRows() const { return m_numRows; }
       ///get number of columns
-      int64_t getNumberOfColumns() const
-      {
-          if (m_matrix.size() == 0) return 0;
-          return (int64_t)m_matrix[0].size();
-      }
+      int64_t getNumberOfColumns() const { return m_numCols; }
       
       ///return a matrix of zeros
       static FloatMatrix zeros(const int64_t rows, const int64_t cols);
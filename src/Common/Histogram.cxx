@@ -21,11 +21,55 @@
 
 #include "Histogram.h"
 #include "CaretAssert.h"
+#include "CaretOMP.h"
+
+#include <algorithm>
 #include <cmath>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    const int64_t CHUNK_SIZE = 1 << 16;//fixed size chunks, so that results don't depend on the number of threads
+    
+    struct ClassCounts
+    {
+        int64_t m_posCount, m_zeroCount, m_negCount, m_infCount, m_negInfCount, m_nanCount;
+        ClassCounts()
+        {
+            m_posCount = 0;
+            m_zeroCount = 0;
+            m_negCount = 0;
+            m_infCount = 0;
+            m_negInfCount = 0;
+            m_nanCount = 0;
+        }
+        void add(const ClassCounts& other)
+        {
+            m_posCount += other.m_posCount;
+            m_zeroCount += other.m_zeroCount;
+            m_negCount += other.m_negCount;
+            m_infCount += other.m_infCount;
+            m_negInfCount += other.m_negInfCount;
+            m_nanCount += other.m_nanCount;
+        }
+    };
+    
+    struct RangeChunk
+    {
+        ClassCounts m_counts;
+        float m_min, m_max;
+        bool m_haveValue;
+        RangeChunk()
+        {
+            m_min = 0.0f;
+            m_max = 0.0f;
+            m_haveValue = false;
+        }
+    };
+}
+
 Histogram::Histogram(const int& numBuckets)
 {
     resize(numBuckets);
@@ -88,51 +132,81 @@ void Histogram::update(const float* data, const int64_t& dataCount)
 {
     int numBuckets = (int)m_buckets.size();
     reset();
-    bool first = true;
-    for (int64_t i = 0; i < dataCount; ++i)
+    const int64_t numChunks = (dataCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    vector<RangeChunk> chunks(numChunks);
+#pragma omp CARET_PARFOR schedule(dynamic) if(numChunks > 1)
+    for (int64_t chunk = 0; chunk < numChunks; ++chunk)
     {//count value classes
-        if (data[i] != data[i])
+        RangeChunk& myChunk = chunks[chunk];
+        ClassCounts& myCounts = myChunk.m_counts;
+        const int64_t end = min(dataCount, (chunk + 1) * CHUNK_SIZE);
+        for (int64_t i = chunk * CHUNK_SIZE; i < end; ++i)
         {
-            ++m_nanCount;
-            continue;//skip NaNs
-        }
-        if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
-        {
-            ++m_zeroCount;
-        } else {
-            if (data[i] < 0.0f)
+            if (data[i] != data[i])
+            {
+                ++myCounts.m_nanCount;
+                continue;//skip NaNs
+            }
+            if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
             {
-                if (data[i] * 2.0f == data[i])
+                ++myCounts.m_zeroCount;
+            } else {
+                if (data[i] < 0.0f)
                 {
-                    ++m_negInfCount;
-                    continue;//skip neg infs
+                    if (data[i] * 2.0f == data[i])
+                    {
+                        ++myCounts.m_negInfCount;
+                        continue;//skip neg infs
+                    } else {
+                        ++myCounts.m_negCount;
+                    }
                 } else {
-                    ++m_negCount;
+                    if (data[i] * 2.0f == data[i])
+                    {
+                        ++myCounts.m_infCount;
+                        continue;//skip infs
+                    } else {
+                        ++myCounts.m_posCount;
+                    }
                 }
+            }
+            if (!myChunk.m_haveValue)
+            {
+                myChunk.m_haveValue = true;
+                myChunk.m_min = data[i];
+                myChunk.m_max = data[i];
             } else {
-                if (data[i] * 2.0f == data[i])
+                if (data[i] > myChunk.m_max)
                 {
-                    ++m_infCount;
-                    continue;//skip infs
-                } else {
-                    ++m_posCount;
+                    myChunk.m_max = data[i];
+                } else if (data[i] < myChunk.m_min) {//skip testing for new minimum if we found a new maximum
+                    myChunk.m_min = data[i];
                 }
             }
         }
+    }
+    ClassCounts totals;
+    bool first = true;
+    for (int64_t chunk = 0; chunk < numChunks; ++chunk)
+    {
+        totals.add(chunks[chunk].m_counts);
+        if (!chunks[chunk].m_haveValue) continue;
         if (first)
         {
             first = false;
-            m_bucketMin = data[i];
-            m_bucketMax = data[i];
+            m_bucketMin = chunks[chunk].m_min;
+            m_bucketMax = chunks[chunk].m_max;
         } else {
-            if (data[i] > m_bucketMax)
-            {
-                m_bucketMax = data[i];
-            } else if (data[i] < m_bucketMin) {//skip testing for new minimum if we found a new maximum
-                m_bucketMin = data[i];
-            }
+            if (chunks[chunk].m_max > m_bucketMax) m_bucketMax = chunks[chunk].m_max;
+            if (chunks[chunk].m_min < m_bucketMin) m_bucketMin = chunks[chunk].m_min;
         }
     }
+    m_posCount = totals.m_posCount;
+    m_zeroCount = totals.m_zeroCount;
+    m_negCount = totals.m_negCount;
+    m_infCount = totals.m_infCount;
+    m_negInfCount = totals.m_negInfCount;
+    m_nanCount = totals.m_nanCount;
     if (first)
     {
         m_bucketMin = m_bucketMax = 0.0f;
@@ -140,47 +214,35 @@ void Histogram::update(const float* data, const int64_t& dataCount)
     }
     if (m_bucketMin == m_bucketMax)
     {
-        int64_t totalValid = m_negCount + m_posCount + m_zeroCount;
-        for (int i = 0; i < numBuckets - 1; ++i)
-        {
-            m_cumulative[i] = (i + 1) * totalValid / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
-            if (i == 0)
+        spreadEvenly(m_negCount + m_posCount + m_zeroCount);
+        return;
+    }
+    float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
+#pragma omp CARET_PAR if(numChunks > 1)
+    {
+        vector<int64_t> myBuckets(numBuckets, 0);//per-thread sub-histogram, merged at the end
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t chunk = 0; chunk < numChunks; ++chunk)
+        {//determine histogram
+            const int64_t end = min(dataCount, (chunk + 1) * CHUNK_SIZE);
+            for (int64_t i = chunk * CHUNK_SIZE; i < end; ++i)
             {
-                m_buckets[i] = m_cumulative[i];
-            } else {
-                m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
+                if (data[i] != data[i]) continue;//exclude NaN
+                if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
+                if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
+                ++myBuckets[getBucketIndex(data[i], m_bucketMin, bucketsize, numBuckets)];
             }
-        }//display is already zeroed, so just return
-        m_cumulative[numBuckets - 1] = totalValid;//make sure the last one has all of them
-        if (numBuckets > 1)
+        }
+#pragma omp critical
         {
-            m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
-        } else {
-            m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
+            for (int i = 0; i < numBuckets; ++i)
+            {
+                m_buckets[i] += myBuckets[i];
+            }
         }
-        return;
-    }
-    float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
-    for (int64_t i = 0; i < dataCount; ++i)
-    {//determine histogram
-        if (data[i] != data[i]) continue;//exclude NaN
-        if (data[i] < -1.0f && (data[i] * 2.0f == data[i])) continue;//exclude -inf
-        if (data[i] > 1.0f && (data[i] * 2.0f == data[i])) continue;//exclude inf
-        int bucket = (int)((data[i] - m_bucketMin) / bucketsize);//doesn't really matter whether small negative floats truncate to a 0 integer
-        if (bucket < 0) bucket = 0;//because of this
-        if (bucket >= numBuckets) bucket = numBuckets - 1;
-        CaretAssertVectorIndex(m_buckets, bucket);
-        ++m_buckets[bucket];
     }
     computeCumulative();
-    m_displayHeightMax = 0.0;
-    for (int i = 0; i < numBuckets; ++i)
-    {//compute display values by normalizing by bucket size
-        m_display[i] = m_buckets[i] / bucketsize;
-        if (m_display[i] > m_displayHeightMax) {
-            m_displayHeightMax = m_display[i];
-        }
-    }
+    computeDisplay();
 }
 
 void Histogram::update(const int32_t& numBuckets,
@@ -255,67 +317,122 @@ void Histogram::update(const float* data, const int64_t& dataCount, float mostPo
                     m_posCount = equalCount;
                 }
             }
-            for (int i = 0; i < numBuckets - 1; ++i)
-            {
-                m_cumulative[i] = (i + 1) * equalCount / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
-                if (i == 0)
-                {
-                    m_buckets[i] = m_cumulative[i];
-                } else {
-                    m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
-                }
-            }//display is already zeroed, so just return
-            m_cumulative[numBuckets - 1] = equalCount;//make sure the last one has all of them
-            if (numBuckets > 1)
-            {
-                m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
-            } else {
-                m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
-            }
+            spreadEvenly(equalCount);
         }
         return;
     }
     float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
-    for (int64_t i = 0; i < dataCount; ++i)//do the histogram
-    {//count value classes
-        if (data[i] != data[i])
-        {
-            ++m_nanCount;
-            continue;//skip NaNs
-        }
-        if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
+    const int64_t numChunks = (dataCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+#pragma omp CARET_PAR if(numChunks > 1)
+    {
+        vector<int64_t> myBuckets(numBuckets, 0);//per-thread sub-histogram and counts, merged at the end
+        ClassCounts myCounts;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t chunk = 0; chunk < numChunks; ++chunk)
         {
-            if (!includeZeroValues) continue;//don't count what is excluded
-            ++m_zeroCount;
-        } else {
-            if (data[i] < 0.0f)
-            {
-                if (data[i] * 2.0f == data[i])
+            const int64_t end = min(dataCount, (chunk + 1) * CHUNK_SIZE);
+            for (int64_t i = chunk * CHUNK_SIZE; i < end; ++i)//do the histogram
+            {//count value classes
+                if (data[i] != data[i])
                 {
-                    ++m_negInfCount;
-                    continue;//skip neg infs
-                } else {
-                    if (data[i] > leastNegativeValueInclusive || data[i] < mostNegativeValueInclusive) continue;//exclude negatives outside range
-                    ++m_negCount;
+                    ++myCounts.m_nanCount;
+                    continue;//skip NaNs
                 }
-            } else {
-                if (data[i] * 2.0f == data[i])
+                if (data[i] == 0.0f)//test exactly zero (negative zero also tests equal), in case someone wants stats on something with miniscule values (percent of surface area per node?)
                 {
-                    ++m_infCount;
-                    continue;//skip infs
+                    if (!includeZeroValues) continue;//don't count what is excluded
+                    ++myCounts.m_zeroCount;
                 } else {
-                    if (data[i] > mostPositiveValueInclusive || data[i] < leastPositiveValueInclusive) continue;//exclude negatives outside range
-                    ++m_posCount;
+                    if (data[i] < 0.0f)
+                    {
+                        if (data[i] * 2.0f == data[i])
+                        {
+                            ++myCounts.m_negInfCount;
+                            continue;//skip neg infs
+                        } else {
+                            if (data[i] > leastNegativeValueInclusive || data[i] < mostNegativeValueInclusive) continue;//exclude negatives outside range
+                            ++myCounts.m_negCount;
+                        }
+                    } else {
+                        if (data[i] * 2.0f == data[i])
+                        {
+                            ++myCounts.m_infCount;
+                            continue;//skip infs
+                        } else {
+                            if (data[i] > mostPositiveValueInclusive || data[i] < leastPositiveValueInclusive) continue;//exclude negatives outside range
+                            ++myCounts.m_posCount;
+                        }
+                    }
                 }
+                ++myBuckets[getBucketIndex(data[i], m_bucketMin, bucketsize, numBuckets)];
+            }
+        }
+#pragma omp critical
+        {
+            for (int i = 0; i < numBuckets; ++i)
+            {
+                m_buckets[i] += myBuckets[i];
             }
+            m_posCount += myCounts.m_posCount;
+            m_zeroCount += myCounts.m_zeroCount;
+            m_negCount += myCounts.m_negCount;
+            m_infCount += myCounts.m_infCount;
+            m_negInfCount += myCounts.m_negInfCount;
+            m_nanCount += myCounts.m_nanCount;
         }
-        int bucket = (int)((data[i] - m_bucketMin) / bucketsize);//doesn't really matter whether small negative floats truncate to a 0 integer
-        if (bucket < 0) bucket = 0;//because of this
-        if (bucket >= numBuckets) bucket = numBuckets - 1;
-        CaretAssertVectorIndex(m_buckets, bucket);
-        ++m_buckets[bucket];
     }
     computeCumulative();
+    computeDisplay();
+}
+
+void Histogram::setBucketCounts(const vector<int64_t>& counts, const float& histMin, const float& histMax,
+                                const int64_t& posCount, const int64_t& zeroCount, const int64_t& negCount)
+{
+    resize((int)counts.size());
+    reset();
+    m_posCount = posCount;
+    m_zeroCount = zeroCount;
+    m_negCount = negCount;
+    int64_t totalValid = posCount + zeroCount + negCount;
+    if (totalValid == 0) return;//same as update() with no valid data
+    m_bucketMin = histMin;
+    m_bucketMax = histMax;
+    if (histMin == histMax)
+    {
+        spreadEvenly(totalValid);
+        return;
+    }
+    m_buckets = counts;
+    computeCumulative();
+    computeDisplay();
+}
+
+void Histogram::spreadEvenly(const int64_t& totalCount)
+{
+    int numBuckets = (int)m_buckets.size();
+    for (int i = 0; i < numBuckets - 1; ++i)
+    {
+        m_cumulative[i] = (i + 1) * totalCount / numBuckets;//so, its not particularly useful if our range is zero, but split them evenly among buckets just for kicks
+        if (i == 0)
+        {
+            m_buckets[i] = m_cumulative[i];
+        } else {
+            m_buckets[i] = m_cumulative[i] - m_cumulative[i - 1];
+        }
+    }//display is already zeroed
+    m_cumulative[numBuckets - 1] = totalCount;//make sure the last one has all of them
+    if (numBuckets > 1)
+    {
+        m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1] - m_cumulative[numBuckets - 2];
+    } else {
+        m_buckets[numBuckets - 1] = m_cumulative[numBuckets - 1];
+    }
+}
+
+void Histogram::computeDisplay()
+{
+    int numBuckets = (int)m_buckets.size();
+    float bucketsize = (m_bucketMax - m_bucketMin) / numBuckets;
     m_displayHeightMax = 0.0;
     for (int i = 0; i < numBuckets; ++i)
     {//compute display values by normalizing by bucket size
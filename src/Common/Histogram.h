@@ -43,6 +43,10 @@ namespace caret
         
         void computeCumulative();
         
+        void computeDisplay();
+        
+        void spreadEvenly(const int64_t& totalCount);
+        
         void update(const float* data,
                     const int64_t& dataCount,
                     float mostPositiveValueInclusive,
@@ -71,6 +75,20 @@ namespace caret
                     float mostNegativeValueInclusive,
                     const bool& includeZeroValues);
         
+        ///set from bucket counts accumulated elsewhere (for instance, several histograms filled in one pass over the data)
+        ///counts must use getBucketIndex with the bucket size of the given range, unless the range is empty, and the class counts must add up to the valid values
+        void setBucketCounts(const std::vector<int64_t>& counts, const float& histMin, const float& histMax,
+                             const int64_t& posCount, const int64_t& zeroCount, const int64_t& negCount);
+        
+        ///which bucket a finite value belongs to, given the low edge of the low bucket and the bucket size
+        static int getBucketIndex(const float& value, const float& histMin, const float& bucketSize, const int& numBuckets)
+        {
+            int bucket = (int)((value - histMin) / bucketSize);//doesn't really matter whether small negative floats truncate to a 0 integer
+            if (bucket < 0) bucket = 0;//because of this
+            if (bucket >= numBuckets) bucket = numBuckets - 1;
+            return bucket;
+        }
+        
         ///get raw counts (useful mathematically)
         const std::vector<int64_t>& getHistogramCounts() const { return m_buckets; }
         
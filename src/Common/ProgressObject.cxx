@@ -20,6 +20,7 @@
 
 #include "ProgressObject.h"
 #include "CaretAssert.h"
+#include "CaretProfiler.h"
 #include "EventProgressUpdate.h"
 #include "EventManager.h"
 
@@ -231,6 +232,7 @@ void LevelProgress::reportProgress(const float currentTotal)
 
 void LevelProgress::setTask(const AString& taskDescription)
 {//maybe this should be in a setter in m_progObjRef, here for coherence with progress reporting
+    CaretProfiler::addMarker(taskDescription);//the command line doesn't use progress objects, but task descriptions are still useful when profiling
     if (m_progObjRef == NULL) return;
     m_progObjRef->m_description = taskDescription;
     EventProgressUpdate myUpdate(m_progObjRef);
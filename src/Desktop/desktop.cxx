@@ -48,6 +48,7 @@
 #include "CaretHttpManager.h"
 #include "CaretLogger.h"
 #include "CaretPreferences.h"
+#include "CiftiFile.h"
 #include "CommandOperationManager.h"
 #include "EventBrowserWindowNew.h"
 #include "EventManager.h"
@@ -693,6 +694,11 @@ main(int argc, char* argv[])
         SessionManager::deleteSessionManager();
         
         CaretHttpManager::deleteHttpManager();
+        
+        /*
+         * Parsed CIFTI XML kept for reopening files
+         */
+        CiftiFile::clearXMLCache();
     }
     
     /*
@@ -1332,6 +1332,30 @@ CaretMappableDataFile::getMapThresholdFileSelectionModel(const int32_t mapIndex)
     return m_mapThresholdFileSelectionModels[mapIndex].get();
 }
 
+/**
+ * Is the map thresholded with data from a map file (possibly another
+ * file) so that its coloring depends upon that file?
+ *
+ * @param mapIndex
+ *     Index of the map.
+ * @return
+ *     True if the map's palette uses file thresholding, else false.
+ */
+bool
+CaretMappableDataFile::isMapThresholdedWithFile(const int32_t mapIndex) const
+{
+    if ( ! isMappedWithPalette()) {
+        return false;
+    }
+    
+    const PaletteColorMapping* pcm = getMapPaletteColorMapping(mapIndex);
+    if (pcm == NULL) {
+        return false;
+    }
+    
+    return (pcm->getThresholdType() == PaletteThresholdTypeEnum::THRESHOLD_TYPE_FILE);
+}
+
 /**
  * Update the charting delegate after changes (add a row/column, etc.)
  * are made to the data file.
@@ -501,6 +501,8 @@ namespace caret {
         
         CaretMappableDataFileAndMapSelectionModel* getMapThresholdFileSelectionModel(const int32_t mapIndex);
         
+        bool isMapThresholdedWithFile(const int32_t mapIndex) const;
+        
         /**
          * Are all brainordinates in this file also in the given file?  
          * That is, the brainordinates are equal to or a subset of the brainordinates
@@ -423,6 +423,22 @@ ChartableTwoFileMatrixChart::getMatrixChartingGraphicsPrimitive(const ChartTwoMa
                                                             gridMode);
 }
 
+/**
+ * @return The graphics primitive containing the matrix drawn as a single
+ * textured rectangle.  All cells are of dimension 1.0 x 1.0
+ *
+ * @param matrixViewMode
+ *     The matrix visualization mode (upper/lower).
+ */
+GraphicsPrimitiveV3fT3f*
+ChartableTwoFileMatrixChart::getMatrixChartingTexturePrimitive(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode) const
+{
+    const CiftiMappableDataFile* ciftiMapFile = getCiftiMappableDataFile();
+    CaretAssert(ciftiMapFile);
+    
+    return ciftiMapFile->getMatrixChartingTexturePrimitive(matrixViewMode);
+}
+
 /** 
  * @return Identifier for the matrix primitives alternative color used for the grid coloring 
  */
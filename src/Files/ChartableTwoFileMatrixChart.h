@@ -36,6 +36,7 @@ namespace caret {
     class CiftiParcelSeriesFile;
     class CiftiScalarDataSeriesFile;
     class GraphicsPrimitiveV3fC4f;
+    class GraphicsPrimitiveV3fT3f;
     
     class ChartableTwoFileMatrixChart : public ChartableTwoFileBaseChart {
         
@@ -62,6 +63,8 @@ namespace caret {
         GraphicsPrimitiveV3fC4f* getMatrixChartingGraphicsPrimitive(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode,
                                                                     const CiftiMappableDataFile::MatrixGridMode gridMode) const;
         
+        GraphicsPrimitiveV3fT3f* getMatrixChartingTexturePrimitive(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode) const;
+        
         int32_t getMatrixChartGraphicsPrimitiveGridColorIdentifier() const;
         
         bool isMatrixTriangularViewingModeSupported() const;
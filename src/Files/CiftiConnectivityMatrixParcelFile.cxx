@@ -668,6 +668,11 @@ CiftiConnectivityMatrixParcelFile::setSelectedParcelLabelFileAndMapForReordering
     m_parcelReorderingModel->setSelectedParcelLabelFileAndMapForReordering(selectedParcelLabelFile,
                                                                            selectedParcelLabelFileMapIndex,
                                                                            enabledStatus);
+    
+    /*
+     * Matrix rows are drawn in the reordered order
+     */
+    invalidateMatrixChartingPrimitives();
 }
 
 /**
@@ -1578,15 +1578,23 @@ CiftiFiberTrajectoryFile::loadMapAverageDataForVoxelIndices(const int64_t volume
         return;
     }
     
-    std::vector<int64_t> rowIndicesToLoad;
     const int32_t numberOfVoxels = static_cast<int32_t>(voxelIndices.size());
+    std::vector<int64_t> voxelIJKs;
+    voxelIJKs.reserve(numberOfVoxels * 3);
     for (int32_t i = 0; i < numberOfVoxels; i++) {
-        /*
-         * Get and load row for voxel
-         */
-        const int64_t rowIndex = colMap.getIndexForVoxel(voxelIndices[i].m_ijk);
-        if (rowIndex >= 0) {
-            rowIndicesToLoad.push_back(rowIndex);
+        voxelIJKs.insert(voxelIJKs.end(),
+                         voxelIndices[i].m_ijk,
+                         voxelIndices[i].m_ijk + 3);
+    }
+    
+    /*
+     * Get and load rows for voxels, in one pass through the lookup
+     */
+    const std::vector<int64_t> rowIndices = colMap.getIndicesForVoxels(voxelIJKs);
+    std::vector<int64_t> rowIndicesToLoad;
+    for (int32_t i = 0; i < numberOfVoxels; i++) {
+        if (rowIndices[i] >= 0) {
+            rowIndicesToLoad.push_back(rowIndices[i]);
         }
     }
     
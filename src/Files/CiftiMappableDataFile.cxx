@@ -18,6 +18,7 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <set>
 
 #define __CIFTI_MAPPABLE_DATA_FILE_DECLARE__
@@ -37,6 +38,7 @@
 #include "CiftiFile.h"
 #include "CiftiMappableConnectivityMatrixDataFile.h"
 #include "CaretMappableDataFileAndMapSelectionModel.h"
+#include "CaretOMP.h"
 #include "CiftiParcelLabelFile.h"
 #include "CiftiParcelReordering.h"
 #include "CiftiParcelScalarFile.h"
@@ -54,6 +56,7 @@
 #include "GiftiLabelTable.h"
 #include "GiftiMetaData.h"
 #include "GraphicsPrimitiveV3fC4f.h"
+#include "GraphicsPrimitiveV3fT3f.h"
 #include "GroupAndNameHierarchyModel.h"
 #include "Histogram.h"
 #include "MapFileDataSelector.h"
@@ -298,7 +301,26 @@ CiftiMappableDataFile::receiveEvent(Event* event)
         CaretAssert(colorInvalidateEvent);
         colorInvalidateEvent->setEventProcessed();
         
-        invalidateColoringInAllMaps();
+        /*
+         * When only another file's coloring changed, this file's
+         * coloring remains valid unless it is thresholded with a file.
+         */
+        const CaretMappableDataFile* mapFile = colorInvalidateEvent->getMapFile();
+        bool invalidateFlag = ((mapFile == NULL)
+                               || (mapFile == this));
+        if ( ! invalidateFlag) {
+            const int32_t numMaps = getNumberOfMaps();
+            for (int32_t iMap = 0; iMap < numMaps; iMap++) {
+                if (isMapThresholdedWithFile(iMap)) {
+                    invalidateFlag = true;
+                    break;
+                }
+            }
+        }
+        
+        if (invalidateFlag) {
+            invalidateColoringInAllMaps();
+        }
     }
 }
 
@@ -1399,6 +1421,15 @@ CiftiMappableDataFile::setMapData(const int32_t mapIndex,
     m_forceUpdateOfGroupAndNameHierarchy = true;
     
     m_mapContent[mapIndex]->updateForChangeInMapData();
+    
+    /*
+     * Only the edited map's statistics are recomputed, but
+     * statistics for the whole file include this map.
+     */
+    m_fileFastStatistics.grabNew(NULL);
+    m_fileHistogram.grabNew(NULL);
+    m_fileHistorgramLimitedValues.grabNew(NULL);
+    invalidateMatrixChartingPrimitives();
 }
 
 /**
@@ -1412,6 +1443,10 @@ CiftiMappableDataFile::updateForChangeInMapDataWithMapIndex(const int32_t mapInd
 {
     CaretAssertVectorIndex(m_mapContent, mapIndex);
     m_mapContent[mapIndex]->updateForChangeInMapData();
+    m_fileFastStatistics.grabNew(NULL);
+    m_fileHistogram.grabNew(NULL);
+    m_fileHistorgramLimitedValues.grabNew(NULL);
+    invalidateMatrixChartingPrimitives();
 }
 
 
@@ -1431,9 +1466,21 @@ CiftiMappableDataFile::invalidateColoringInAllMaps()
      * Force recreation of matrix so that it receives updates to coloring
      * and in particular, matrix grid outline coloring
      */
+    invalidateMatrixChartingPrimitives();
+    invalidateHistogramChartColoring();
+}
+
+/**
+ * Invalidate the primitives used to draw the file as a matrix chart
+ * so that they are recreated the next time the matrix is drawn.  Must
+ * be called when the matrix coloring, data, or row ordering changes.
+ */
+void
+CiftiMappableDataFile::invalidateMatrixChartingPrimitives()
+{
     m_matrixGraphicsPrimitive.reset();
     m_matrixGraphicsOutlinePrimitive.reset();
-    invalidateHistogramChartColoring();
+    m_matrixGraphicsTexturePrimitive.reset();
 }
 
 /**
@@ -1602,65 +1649,11 @@ CiftiMappableDataFile::getMatrixChartingGraphicsPrimitive(const ChartTwoMatrixTr
                         const float* rgba = &matrixRGBA[rgbaOffset];
                         rgbaOffset += 4;
                         
-                        bool drawCellFlag = true;
-                        if (matrixViewMode != ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL) {
-                            if (numberOfRows == numberOfColumns) {
-                                drawCellFlag = false;
-                                switch (matrixViewMode) {
-                                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL:
-                                        break;
-                                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL_NO_DIAGONAL:
-                                        if (rowIndex != columnIndex) {
-                                            drawCellFlag = true;
-                                        }
-                                        break;
-                                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_LOWER_NO_DIAGONAL:
-                                        if (rowIndex > columnIndex) {
-                                            drawCellFlag = true;
-                                        }
-                                        break;
-                                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_UPPER_NO_DIAGONAL:
-                                        if (rowIndex < columnIndex) {
-                                            drawCellFlag = true;
-                                        }
-                                        break;
-                                }
-                            }
-                            else {
-                                drawCellFlag = true;
-                                
-                                /*
-                                 * Diagonals for non-square matrices not allowed
-                                 */
-                                const bool allowNonSquareMatrixDiagonalsFlag = false;
-                                if (allowNonSquareMatrixDiagonalsFlag) {
-                                    drawCellFlag = false;
-                                    const float slope = static_cast<float>(numberOfRows) / static_cast<float>(numberOfColumns);
-                                    const int32_t diagonalRow = static_cast<int32_t>(slope * columnIndex);
-                                    
-                                    switch (matrixViewMode) {
-                                        case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL:
-                                            drawCellFlag = true;
-                                            break;
-                                        case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL_NO_DIAGONAL:
-                                            if (rowIndex != diagonalRow) {
-                                                drawCellFlag = true;
-                                            }
-                                            break;
-                                        case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_LOWER_NO_DIAGONAL:
-                                            if (rowIndex > diagonalRow) {
-                                                drawCellFlag = true;
-                                            }
-                                            break;
-                                        case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_UPPER_NO_DIAGONAL:
-                                            if (rowIndex < diagonalRow) {
-                                                drawCellFlag = true;
-                                            }
-                                            break;
-                                    }
-                                }
-                            }
-                        }
+                        const bool drawCellFlag = isMatrixChartCellDisplayed(matrixViewMode,
+                                                                             numberOfRows,
+                                                                             numberOfColumns,
+                                                                             rowIndex,
+                                                                             columnIndex);
                         
                         switch (gridMode) {
                             case MatrixGridMode::FILLED:
@@ -1719,6 +1712,475 @@ CiftiMappableDataFile::getMatrixChartingGraphicsPrimitive(const ChartTwoMatrixTr
 }
 
 
+/**
+ * Is a cell of a matrix displayed for the given triangular viewing mode?
+ *
+ * @param matrixViewMode
+ *     The matrix visualization mode (upper/lower).
+ * @param numberOfRows
+ *     Number of rows in the matrix.
+ * @param numberOfColumns
+ *     Number of columns in the matrix.
+ * @param rowIndex
+ *     Row index of the cell.
+ * @param columnIndex
+ *     Column index of the cell.
+ * @return
+ *     True if the cell is displayed, else false.
+ */
+bool
+CiftiMappableDataFile::isMatrixChartCellDisplayed(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode,
+                                                  const int32_t numberOfRows,
+                                                  const int32_t numberOfColumns,
+                                                  const int32_t rowIndex,
+                                                  const int32_t columnIndex)
+{
+    bool drawCellFlag = true;
+    if (matrixViewMode != ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL) {
+        if (numberOfRows == numberOfColumns) {
+            drawCellFlag = false;
+            switch (matrixViewMode) {
+                case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL:
+                    break;
+                case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL_NO_DIAGONAL:
+                    if (rowIndex != columnIndex) {
+                        drawCellFlag = true;
+                    }
+                    break;
+                case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_LOWER_NO_DIAGONAL:
+                    if (rowIndex > columnIndex) {
+                        drawCellFlag = true;
+                    }
+                    break;
+                case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_UPPER_NO_DIAGONAL:
+                    if (rowIndex < columnIndex) {
+                        drawCellFlag = true;
+                    }
+                    break;
+            }
+        }
+        else {
+            drawCellFlag = true;
+            
+            /*
+             * Diagonals for non-square matrices not allowed
+             */
+            const bool allowNonSquareMatrixDiagonalsFlag = false;
+            if (allowNonSquareMatrixDiagonalsFlag) {
+                drawCellFlag = false;
+                const float slope = static_cast<float>(numberOfRows) / static_cast<float>(numberOfColumns);
+                const int32_t diagonalRow = static_cast<int32_t>(slope * columnIndex);
+                
+                switch (matrixViewMode) {
+                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL:
+                        drawCellFlag = true;
+                        break;
+                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL_NO_DIAGONAL:
+                        if (rowIndex != diagonalRow) {
+                            drawCellFlag = true;
+                        }
+                        break;
+                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_LOWER_NO_DIAGONAL:
+                        if (rowIndex > diagonalRow) {
+                            drawCellFlag = true;
+                        }
+                        break;
+                    case ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_UPPER_NO_DIAGONAL:
+                        if (rowIndex < diagonalRow) {
+                            drawCellFlag = true;
+                        }
+                        break;
+                }
+            }
+        }
+    }
+    
+    return drawCellFlag;
+}
+
+/**
+ * @return The graphics primitive containing the matrix drawn as one
+ * rectangle with the cell coloring in a texture.  The rectangle has
+ * the same dimensions as the primitive from getMatrixChartingGraphicsPrimitive(),
+ * one unit per cell, and row zero at the top.  Unlike that primitive, the
+ * size of this primitive does not grow with the number of cells so large
+ * matrices remain interactive when panned and zoomed.  NULL if the file
+ * is not a matrix.
+ *
+ * The texture is padded to a power of two in each dimension so that it is
+ * not resampled when mipmaps are built.  Magnification uses the nearest
+ * texel so cells remain sharp edged when zoomed and minification uses the
+ * mipmaps.  When a dimension of the matrix exceeds the maximum texture
+ * dimension, each texel is the average of a square block of cells
+ * (weighted by alpha so that cells that are not displayed do not darken
+ * the result).  Cells are colored a block of rows at a time and averaged
+ * straight into the texture, so RGBA for the full size matrix is never
+ * created.
+ *
+ * @param matrixViewMode
+ *     The matrix visualization mode (upper/lower).
+ */
+GraphicsPrimitiveV3fT3f*
+CiftiMappableDataFile::getMatrixChartingTexturePrimitive(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode) const
+{
+    if (m_matrixGraphicsTexturePrimitive != NULL) {
+        if (m_matrixGraphicsTextureViewMode == matrixViewMode) {
+            return m_matrixGraphicsTexturePrimitive.get();
+        }
+    }
+    m_matrixGraphicsTexturePrimitive.reset();
+    m_matrixGraphicsTextureViewMode = matrixViewMode;
+    
+    bool useMapFileHelperFlag = false;
+    std::vector<int32_t> sourceRowIndices;
+    if ( ! getMatrixForChartingRowSources(useMapFileHelperFlag,
+                                          sourceRowIndices)) {
+        return NULL;
+    }
+    const int32_t numberOfRows    = m_ciftiFile->getNumberOfRows();
+    const int32_t numberOfColumns = m_ciftiFile->getNumberOfColumns();
+    if ((numberOfRows <= 0)
+        || (numberOfColumns <= 0)) {
+        return NULL;
+    }
+    
+    /*
+     * Supported by nearly all OpenGL implementations and keeps
+     * the image at or below 64 megabytes
+     */
+    const int32_t maximumTextureDimension = 4096;
+    
+    const int32_t largestDimension = std::max(numberOfRows, numberOfColumns);
+    const int32_t cellsPerTexel = ((largestDimension + maximumTextureDimension - 1)
+                                   / maximumTextureDimension);
+    const int32_t imageRows    = (numberOfRows    + cellsPerTexel - 1) / cellsPerTexel;
+    const int32_t imageColumns = (numberOfColumns + cellsPerTexel - 1) / cellsPerTexel;
+    
+    int32_t textureWidth = 1;
+    while (textureWidth < imageColumns) {
+        textureWidth *= 2;
+    }
+    int32_t textureHeight = 1;
+    while (textureHeight < imageRows) {
+        textureHeight *= 2;
+    }
+    
+    /*
+     * Each block of rows covers whole rows of texels and
+     * about a million cells.
+     */
+    const int64_t cellsPerBlock = 1024 * 1024;
+    const int32_t imageRowsPerBlock = static_cast<int32_t>(std::max(static_cast<int64_t>(1),
+                                                                    cellsPerBlock / (static_cast<int64_t>(cellsPerTexel) * numberOfColumns)));
+    
+    /*
+     * Padding is transparent.  The first row of the image is at
+     * the bottom of the texture but matrix row zero is at the top.
+     */
+    std::vector<uint8_t> imageRGBA(static_cast<int64_t>(textureWidth) * textureHeight * 4, 0);
+    std::vector<float> blockRGBA;
+    for (int32_t firstImageRow = 0; firstImageRow < imageRows; firstImageRow += imageRowsPerBlock) {
+        const int32_t lastImageRow = std::min(firstImageRow + imageRowsPerBlock, imageRows);
+        const int32_t blockFirstRow = firstImageRow * cellsPerTexel;
+        const int32_t blockNumberOfRows = std::min(lastImageRow * cellsPerTexel, numberOfRows) - blockFirstRow;
+        if ( ! getMatrixForChartingRowsRGBA(useMapFileHelperFlag,
+                                            sourceRowIndices,
+                                            blockFirstRow,
+                                            blockNumberOfRows,
+                                            blockRGBA)) {
+            return NULL;
+        }
+        
+        /*
+         * Cells not displayed due to the triangular view receive alpha zero
+         */
+        if (matrixViewMode != ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL) {
+            int64_t alphaOffset = 3;
+            for (int32_t rowIndex = blockFirstRow; rowIndex < (blockFirstRow + blockNumberOfRows); rowIndex++) {
+                for (int32_t columnIndex = 0; columnIndex < numberOfColumns; columnIndex++) {
+                    if ( ! isMatrixChartCellDisplayed(matrixViewMode,
+                                                      numberOfRows,
+                                                      numberOfColumns,
+                                                      rowIndex,
+                                                      columnIndex)) {
+                        CaretAssertVectorIndex(blockRGBA, alphaOffset);
+                        blockRGBA[alphaOffset] = 0.0f;
+                    }
+                    alphaOffset += 4;
+                }
+            }
+        }
+        
+#pragma omp CARET_PARFOR schedule(dynamic, 16)
+        for (int32_t imageRowIndex = firstImageRow; imageRowIndex < lastImageRow; imageRowIndex++) {
+            const int32_t firstRow = imageRowIndex * cellsPerTexel;
+            const int32_t lastRow  = std::min(firstRow + cellsPerTexel, numberOfRows);
+            uint8_t* texelRGBA = &imageRGBA[static_cast<int64_t>(imageRows - 1 - imageRowIndex) * textureWidth * 4];
+            
+            for (int32_t imageColumnIndex = 0; imageColumnIndex < imageColumns; imageColumnIndex++) {
+                const int32_t firstColumn = imageColumnIndex * cellsPerTexel;
+                const int32_t lastColumn  = std::min(firstColumn + cellsPerTexel, numberOfColumns);
+                
+                float weightedRGB[3] = { 0.0f, 0.0f, 0.0f };
+                float alphaSum = 0.0f;
+                for (int32_t rowIndex = firstRow; rowIndex < lastRow; rowIndex++) {
+                    const float* rgba = &blockRGBA[(static_cast<int64_t>(rowIndex - blockFirstRow) * numberOfColumns + firstColumn) * 4];
+                    for (int32_t columnIndex = firstColumn; columnIndex < lastColumn; columnIndex++) {
+                        weightedRGB[0] += rgba[0] * rgba[3];
+                        weightedRGB[1] += rgba[1] * rgba[3];
+                        weightedRGB[2] += rgba[2] * rgba[3];
+                        alphaSum += rgba[3];
+                        rgba += 4;
+                    }
+                }
+                
+                if (alphaSum > 0.0f) {
+                    const float numberOfCells = (lastRow - firstRow) * (lastColumn - firstColumn);
+                    const float texelFloatRGBA[4] = {
+                        weightedRGB[0] / alphaSum,
+                        weightedRGB[1] / alphaSum,
+                        weightedRGB[2] / alphaSum,
+                        alphaSum / numberOfCells
+                    };
+                    for (int32_t i = 0; i < 4; i++) {
+                        const float value = std::min(std::max(texelFloatRGBA[i], 0.0f), 1.0f);
+                        texelRGBA[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+                    }
+                }
+                texelRGBA += 4;
+            }
+        }
+    }
+    
+    GraphicsPrimitiveV3fT3f* primitive = GraphicsPrimitive::newPrimitiveV3fT3f(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLE_STRIP,
+                                                                               &imageRGBA[0],
+                                                                               textureWidth,
+                                                                               textureHeight);
+    primitive->setTextureMagnificationFilter(GraphicsPrimitive::TextureFilteringType::NEAREST);
+    primitive->setUsageTypeAll(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_MANY_TIMES);
+    
+    /*
+     * Texture coordinates are chosen so that each texel covers exactly
+     * 'cellsPerTexel' cells even when the last block of rows or
+     * columns is partial.
+     */
+    const float sMax = (static_cast<float>(numberOfColumns) / cellsPerTexel) / textureWidth;
+    const float tMax = static_cast<float>(imageRows) / textureHeight;
+    const float tMin = (imageRows - (static_cast<float>(numberOfRows) / cellsPerTexel)) / textureHeight;
+    const float xMax = numberOfColumns;
+    const float yMax = numberOfRows;
+    primitive->addVertex(0.0f, 0.0f, 0.0f, tMin);
+    primitive->addVertex(xMax, 0.0f, sMax, tMin);
+    primitive->addVertex(0.0f, yMax, 0.0f, tMax);
+    primitive->addVertex(xMax, yMax, sMax, tMax);
+    
+    m_matrixGraphicsTexturePrimitive.reset(primitive);
+    
+    return m_matrixGraphicsTexturePrimitive.get();
+}
+
+/**
+ * Find where each row of the charting matrix comes from, so that the
+ * matrix can be colored a block of rows at a time.
+ *
+ * @param useMapFileHelperFlagOut
+ *    True if each column is colored with its own label table or palette,
+ *    false if the file's palette colors all of the data.
+ * @param sourceRowIndicesOut
+ *    For each row of the charting matrix, the row of the file it
+ *    contains, or -1 if no row of the file is placed there.
+ * @return
+ *    True if the file can be charted as a matrix, else false.
+ */
+bool
+CiftiMappableDataFile::getMatrixForChartingRowSources(bool& useMapFileHelperFlagOut,
+                                                      std::vector<int32_t>& sourceRowIndicesOut) const
+{
+    CaretAssert(m_ciftiFile);
+    
+    bool useMatrixFileHelperFlag = false;
+    std::vector<int32_t> parcelReorderedRowIndices;
+    if ( ! getMatrixForChartingHelperType(useMapFileHelperFlagOut,
+                                          useMatrixFileHelperFlag,
+                                          parcelReorderedRowIndices)) {
+        return false;
+    }
+    
+    const int32_t numberOfRows = m_ciftiFile->getNumberOfRows();
+    if (( ! parcelReorderedRowIndices.empty())
+        && (static_cast<int32_t>(parcelReorderedRowIndices.size()) != numberOfRows)) {
+        const AString msg = AString("rowIndices size=%1 is different than "
+                                    "number of rows in the matrix=%2.").arg(parcelReorderedRowIndices.size()).arg(numberOfRows);
+        CaretAssertMessage(0, msg);
+        CaretLogSevere(msg);
+        return false;
+    }
+    
+    if (useMapFileHelperFlagOut) {
+        const CiftiXML& ciftiXML = m_ciftiFile->getCiftiXML();
+        const CiftiMappingType::MappingType rowMappingType = ciftiXML.getMappingType(CiftiXML::ALONG_ROW);
+        bool validMapTypeFlag = false;
+        if (isMappedWithLabelTable()) {
+            validMapTypeFlag = (rowMappingType == CiftiMappingType::LABELS);
+        }
+        else if (isMappedWithPalette()) {
+            validMapTypeFlag = ((rowMappingType == CiftiMappingType::SCALARS)
+                                || (rowMappingType == CiftiMappingType::SERIES));
+        }
+        if ( ! validMapTypeFlag) {
+            const AString badMapTypeMessage("Matrix charts supports only maps in columns at this time for LABEL, SCALAR, and SERIES data");
+            CaretAssertMessage(0, badMapTypeMessage);
+            CaretLogSevere(badMapTypeMessage);
+            return false;
+        }
+        
+        /*
+         * Reordering is not applied to files colored by column
+         */
+        sourceRowIndicesOut.resize(numberOfRows);
+        for (int32_t i = 0; i < numberOfRows; i++) {
+            sourceRowIndicesOut[i] = i;
+        }
+    }
+    else {
+        if ( ! isMappedWithPalette()) {
+            CaretAssertMessage(0, "Only palette mapped files supported at this time.");
+            return false;
+        }
+        
+        /*
+         * Reordering gives the destination of each row of the file
+         */
+        if (parcelReorderedRowIndices.empty()) {
+            sourceRowIndicesOut.resize(numberOfRows);
+            for (int32_t i = 0; i < numberOfRows; i++) {
+                sourceRowIndicesOut[i] = i;
+            }
+        }
+        else {
+            sourceRowIndicesOut.assign(numberOfRows, -1);
+            for (int32_t iRow = 0; iRow < numberOfRows; iRow++) {
+                const int32_t destinationRow = parcelReorderedRowIndices[iRow];
+                if ((destinationRow >= 0)
+                    && (destinationRow < numberOfRows)) {
+                    sourceRowIndicesOut[destinationRow] = iRow;
+                }
+            }
+        }
+    }
+    
+    return true;
+}
+
+/**
+ * Get the RGBA coloring for a block of rows of the charting matrix.
+ *
+ * @param useMapFileHelperFlag
+ *    True if each column is colored with its own label table or palette.
+ * @param sourceRowIndices
+ *    Row of the file for each row of the charting matrix.
+ * @param firstRow
+ *    First row of the block.
+ * @param numberOfRowsInBlock
+ *    Number of rows in the block.
+ * @param rgbaOut
+ *    RGBA coloring output with number of elements
+ *    (numberOfRowsInBlock * number of columns * 4).
+ * @return
+ *    True if output data is valid, else false.
+ */
+bool
+CiftiMappableDataFile::getMatrixForChartingRowsRGBA(const bool useMapFileHelperFlag,
+                                                    const std::vector<int32_t>& sourceRowIndices,
+                                                    const int32_t firstRow,
+                                                    const int32_t numberOfRowsInBlock,
+                                                    std::vector<float>& rgbaOut) const
+{
+    CaretAssert(m_ciftiFile);
+    
+    const int32_t numberOfColumns = m_ciftiFile->getNumberOfColumns();
+    const int64_t numberOfData = static_cast<int64_t>(numberOfRowsInBlock) * numberOfColumns;
+    if (numberOfData <= 0) {
+        return false;
+    }
+    
+    /*
+     * Rows that no row of the file is placed in are zero
+     */
+    std::vector<float> data(numberOfData, 0.0f);
+    for (int32_t iRow = 0; iRow < numberOfRowsInBlock; iRow++) {
+        CaretAssertVectorIndex(sourceRowIndices, firstRow + iRow);
+        const int32_t sourceRow = sourceRowIndices[firstRow + iRow];
+        if (sourceRow >= 0) {
+            m_ciftiFile->getRow(&data[static_cast<int64_t>(iRow) * numberOfColumns],
+                                sourceRow);
+        }
+    }
+    
+    rgbaOut.resize(numberOfData * 4);
+    CiftiMappableDataFile* nonConstMapFile = const_cast<CiftiMappableDataFile*>(this);
+    
+    if (useMapFileHelperFlag) {
+        /*
+         * Color each column using its label table or palette, and then
+         * add the column's coloring into the output coloring.
+         */
+        const bool useLabelTableFlag = isMappedWithLabelTable();
+        std::vector<float> columnData(numberOfRowsInBlock);
+        std::vector<float> columnRGBA(numberOfRowsInBlock * 4);
+        for (int32_t iCol = 0; iCol < numberOfColumns; iCol++) {
+            for (int32_t iRow = 0; iRow < numberOfRowsInBlock; iRow++) {
+                columnData[iRow] = data[static_cast<int64_t>(iRow) * numberOfColumns + iCol];
+            }
+            if (useLabelTableFlag) {
+                const GiftiLabelTable* labelTable = getMapLabelTable(iCol);
+                NodeAndVoxelColoring::colorIndicesWithLabelTable(labelTable,
+                                                                 &columnData[0],
+                                                                 numberOfRowsInBlock,
+                                                                 &columnRGBA[0]);
+            }
+            else {
+                const PaletteColorMapping* pcm = getMapPaletteColorMapping(iCol);
+                CaretAssert(pcm);
+                NodeAndVoxelColoring::colorScalarsWithPalette(nonConstMapFile->getFileFastStatistics(),
+                                                              pcm,
+                                                              &columnData[0],
+                                                              pcm,
+                                                              &columnData[0],
+                                                              numberOfRowsInBlock,
+                                                              &columnRGBA[0]);
+            }
+            
+            for (int32_t iRow = 0; iRow < numberOfRowsInBlock; iRow++) {
+                const int64_t rgbaOffset = ((static_cast<int64_t>(iRow) * numberOfColumns) + iCol) * 4;
+                CaretAssertVectorIndex(rgbaOut, rgbaOffset + 3);
+                const int32_t columnRgbaOffset = (iRow * 4);
+                CaretAssertVectorIndex(columnRGBA, columnRgbaOffset + 3);
+                rgbaOut[rgbaOffset]   = columnRGBA[columnRgbaOffset];
+                rgbaOut[rgbaOffset+1] = columnRGBA[columnRgbaOffset+1];
+                rgbaOut[rgbaOffset+2] = columnRGBA[columnRgbaOffset+2];
+                rgbaOut[rgbaOffset+3] = columnRGBA[columnRgbaOffset+3];
+            }
+        }
+    }
+    else {
+        /*
+         * One palette and the file's statistics color all of the data
+         */
+        const PaletteColorMapping* pcm = m_ciftiFile->getCiftiXML().getFilePalette();
+        CaretAssert(pcm);
+        NodeAndVoxelColoring::colorScalarsWithPalette(nonConstMapFile->getFileFastStatistics(),
+                                                      pcm,
+                                                      &data[0],
+                                                      pcm,
+                                                      &data[0],
+                                                      numberOfData,
+                                                      &rgbaOut[0]);
+    }
+    
+    return true;
+}
+
 /**
  * Get the matrix RGBA coloring for this matrix data creator.
  *
@@ -1739,8 +2201,50 @@ CiftiMappableDataFile::getMatrixForChartingRGBA(int32_t& numberOfRowsOut,
 {
     bool useMapFileHelperFlag = false;
     bool useMatrixFileHelperFlag = false;
-    
     std::vector<int32_t> parcelReorderedRowIndices;
+    if ( ! getMatrixForChartingHelperType(useMapFileHelperFlag,
+                                          useMatrixFileHelperFlag,
+                                          parcelReorderedRowIndices)) {
+        return false;
+    }
+    
+    bool validDataFlag = false;
+    if (useMapFileHelperFlag) {
+        validDataFlag = helpMapFileLoadChartDataMatrixRGBA(numberOfRowsOut,
+                                                                         numberOfColumnsOut,
+                                                                         parcelReorderedRowIndices,
+                                                                         rgbaOut);
+    }
+    else if (useMatrixFileHelperFlag) {
+        validDataFlag = helpMatrixFileLoadChartDataMatrixRGBA(numberOfRowsOut,
+                                                                            numberOfColumnsOut,
+                                                                            parcelReorderedRowIndices,
+                                                                            rgbaOut);
+    }
+    
+    return validDataFlag;
+}
+
+/**
+ * Find how the matrix chart of this file is colored.
+ *
+ * @param useMapFileHelperFlagOut
+ *    True if each column is colored with its own label table or palette.
+ * @param useMatrixFileHelperFlagOut
+ *    True if the file's palette colors all of the data.
+ * @param parcelReorderedRowIndicesOut
+ *    Parcel reordering of the rows, empty if not reordered.
+ * @return
+ *    True if the file supports matrix display, else false.
+ */
+bool
+CiftiMappableDataFile::getMatrixForChartingHelperType(bool& useMapFileHelperFlagOut,
+                                                      bool& useMatrixFileHelperFlagOut,
+                                                      std::vector<int32_t>& parcelReorderedRowIndicesOut) const
+{
+    useMapFileHelperFlagOut = false;
+    useMatrixFileHelperFlagOut = false;
+    parcelReorderedRowIndicesOut.clear();
     
     switch (getDataFileType()) {
         case DataFileTypeEnum::CONNECTIVITY_DENSE:
@@ -1757,7 +2261,7 @@ CiftiMappableDataFile::getMatrixForChartingRGBA(int32_t& numberOfRowsOut,
             break;
         case DataFileTypeEnum::CONNECTIVITY_PARCEL:
         {
-            useMatrixFileHelperFlag    = true;
+            useMatrixFileHelperFlagOut    = true;
             
             const CiftiConnectivityMatrixParcelFile* parcelConnFile = dynamic_cast<const CiftiConnectivityMatrixParcelFile*>(this);
             CaretAssert(parcelConnFile);
@@ -1776,7 +2280,7 @@ CiftiMappableDataFile::getMatrixForChartingRGBA(int32_t& numberOfRowsOut,
                     const CiftiParcelReordering* parcelReordering = parcelConnFile->getParcelReordering(parcelLabelReorderingFile,
                                                                                                         parcelLabelFileMapIndex);
                     if (parcelReordering != NULL) {
-                        parcelReorderedRowIndices = parcelReordering->getReorderedParcelIndices();
+                        parcelReorderedRowIndicesOut = parcelReordering->getReorderedParcelIndices();
                     }
                 }
             }
@@ -1786,7 +2290,7 @@ CiftiMappableDataFile::getMatrixForChartingRGBA(int32_t& numberOfRowsOut,
             break;
         case DataFileTypeEnum::CONNECTIVITY_PARCEL_LABEL:
         {
-            useMapFileHelperFlag = true;
+            useMapFileHelperFlagOut = true;
             
             const CiftiParcelLabelFile* parcelLabelFile = dynamic_cast<const CiftiParcelLabelFile*>(this);
             CaretAssert(parcelLabelFile);
@@ -1805,7 +2309,7 @@ CiftiMappableDataFile::getMatrixForChartingRGBA(int32_t& numberOfRowsOut,
                     const CiftiParcelReordering* parcelReordering = parcelLabelFile->getParcelReordering(parcelLabelReorderingFile,
                                                                                                          parcelLabelFileMapIndex);
                     if (parcelReordering != NULL) {
-                        parcelReorderedRowIndices = parcelReordering->getReorderedParcelIndices();
+                        parcelReorderedRowIndicesOut = parcelReordering->getReorderedParcelIndices();
                     }
                 }
             }
@@ -1813,7 +2317,7 @@ CiftiMappableDataFile::getMatrixForChartingRGBA(int32_t& numberOfRowsOut,
             break;
         case DataFileTypeEnum::CONNECTIVITY_PARCEL_SCALAR:
         {
-            useMapFileHelperFlag = true;
+            useMapFileHelperFlagOut = true;
             
             const CiftiParcelScalarFile* parcelScalarFile = dynamic_cast<const CiftiParcelScalarFile*>(this);
             CaretAssert(parcelScalarFile);
@@ -1832,7 +2336,7 @@ CiftiMappableDataFile::getMatrixForChartingRGBA(int32_t& numberOfRowsOut,
                     const CiftiParcelReordering* parcelReordering = parcelScalarFile->getParcelReordering(parcelLabelReorderingFile,
                                                                                                           parcelLabelFileMapIndex);
                     if (parcelReordering != NULL) {
-                        parcelReorderedRowIndices = parcelReordering->getReorderedParcelIndices();
+                        parcelReorderedRowIndicesOut = parcelReordering->getReorderedParcelIndices();
                     }
                 }
             }
@@ -1840,7 +2344,7 @@ CiftiMappableDataFile::getMatrixForChartingRGBA(int32_t& numberOfRowsOut,
             break;
         case DataFileTypeEnum::CONNECTIVITY_PARCEL_SERIES:
         {
-            useMapFileHelperFlag = true;
+            useMapFileHelperFlagOut = true;
             
             const CiftiParcelSeriesFile* parcelSeriesFile = dynamic_cast<const CiftiParcelSeriesFile*>(this);
             CaretAssert(parcelSeriesFile);
@@ -1858,14 +2362,14 @@ CiftiMappableDataFile::getMatrixForChartingRGBA(int32_t& numberOfRowsOut,
                     const CiftiParcelReordering* parcelReordering = parcelSeriesFile->getParcelReordering(parcelLabelReorderingFile,
                                                                                                           parcelLabelFileMapIndex);
                     if (parcelReordering != NULL) {
-                        parcelReorderedRowIndices = parcelReordering->getReorderedParcelIndices();
+                        parcelReorderedRowIndicesOut = parcelReordering->getReorderedParcelIndices();
                     }
                 }
             }
         }
             break;
         case DataFileTypeEnum::CONNECTIVITY_SCALAR_DATA_SERIES:
-            useMatrixFileHelperFlag = true;
+            useMatrixFileHelperFlagOut = true;
             break;
         case DataFileTypeEnum::ANNOTATION:
             break;
@@ -1899,27 +2403,13 @@ CiftiMappableDataFile::getMatrixForChartingRGBA(int32_t& numberOfRowsOut,
             break;
     }
     
-    if (( ! useMapFileHelperFlag)
-        && ( ! useMatrixFileHelperFlag)) {
+    if (( ! useMapFileHelperFlagOut)
+        && ( ! useMatrixFileHelperFlagOut)) {
         CaretAssertMessage(0, "Trying to get matrix from a file that does not support matrix display");
         return false;
     }
     
-    bool validDataFlag = false;
-    if (useMapFileHelperFlag) {
-        validDataFlag = helpMapFileLoadChartDataMatrixRGBA(numberOfRowsOut,
-                                                                         numberOfColumnsOut,
-                                                                         parcelReorderedRowIndices,
-                                                                         rgbaOut);
-    }
-    else if (useMatrixFileHelperFlag) {
-        validDataFlag = helpMatrixFileLoadChartDataMatrixRGBA(numberOfRowsOut,
-                                                                            numberOfColumnsOut,
-                                                                            parcelReorderedRowIndices,
-                                                                            rgbaOut);
-    }
-    
-    return validDataFlag;
+    return true;
 }
 
 /**
@@ -2534,8 +3024,7 @@ CiftiMappableDataFile::updateScalarColoringForMap(const int32_t mapIndex)
      */
     
     invalidateHistogramChartColoring();
-    m_matrixGraphicsPrimitive.reset();
-    m_matrixGraphicsOutlinePrimitive.reset();
+    invalidateMatrixChartingPrimitives();
 }
 
 /**
@@ -43,6 +43,7 @@ namespace caret {
     class CiftiXML;
     class FastStatistics;
     class GraphicsPrimitiveV3fC4f;
+    class GraphicsPrimitiveV3fT3f;
     class GroupAndNameHierarchyModel;
     class Histogram;
     class SparseVolumeIndexer;
@@ -495,6 +496,14 @@ namespace caret {
         GraphicsPrimitiveV3fC4f* getMatrixChartingGraphicsPrimitive(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode,
                                                                     const MatrixGridMode gridMode) const;
         
+        GraphicsPrimitiveV3fT3f* getMatrixChartingTexturePrimitive(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode) const;
+        
+        static bool isMatrixChartCellDisplayed(const ChartTwoMatrixTriangularViewingModeEnum::Enum matrixViewMode,
+                                               const int32_t numberOfRows,
+                                               const int32_t numberOfColumns,
+                                               const int32_t rowIndex,
+                                               const int32_t columnIndex);
+        
         /** Identifier for the matrix primitives alternative color used for the grid coloring */
         int32_t getMatrixChartGraphicsPrimitiveGridColorIdentifier() const { return 1; }
         
@@ -513,6 +522,8 @@ namespace caret {
         
         void updateForChangeInMapDataWithMapIndex(const int32_t mapIndex);
         
+        void invalidateMatrixChartingPrimitives();
+        
         ChartDataCartesian* helpLoadChartDataForSurfaceNode(const StructureEnum::Enum structure,
                                                        const int32_t nodeIndex);
         
@@ -535,6 +546,19 @@ namespace caret {
                                                    std::vector<float>& rgbaOut) const;
         
     private:
+        bool getMatrixForChartingHelperType(bool& useMapFileHelperFlagOut,
+                                            bool& useMatrixFileHelperFlagOut,
+                                            std::vector<int32_t>& parcelReorderedRowIndicesOut) const;
+        
+        bool getMatrixForChartingRowSources(bool& useMapFileHelperFlagOut,
+                                            std::vector<int32_t>& sourceRowIndicesOut) const;
+        
+        bool getMatrixForChartingRowsRGBA(const bool useMapFileHelperFlag,
+                                          const std::vector<int32_t>& sourceRowIndices,
+                                          const int32_t firstRow,
+                                          const int32_t numberOfRowsInBlock,
+                                          std::vector<float>& rgbaOut) const;
+        
         class MapContent : public CaretObjectTracksModification {
             
         public:
@@ -762,6 +786,12 @@ namespace caret {
         /** Primitive for grid outline around matrix cells */
         mutable std::unique_ptr<GraphicsPrimitiveV3fC4f> m_matrixGraphicsOutlinePrimitive;
         
+        /** Primitive for matrix cells drawn as a single textured rectangle */
+        mutable std::unique_ptr<GraphicsPrimitiveV3fT3f> m_matrixGraphicsTexturePrimitive;
+        
+        /** Triangular viewing mode used when the texture primitive was created */
+        mutable ChartTwoMatrixTriangularViewingModeEnum::Enum m_matrixGraphicsTextureViewMode = ChartTwoMatrixTriangularViewingModeEnum::MATRIX_VIEW_FULL;
+        
         mutable uint8_t m_previousMatrixGridRGBA[4] = { 0, 1, 2, 3 };
         
         int32_t m_fileHistogramNumberOfBuckets = 100;
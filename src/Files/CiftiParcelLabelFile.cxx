@@ -519,6 +519,11 @@ CiftiParcelLabelFile::setSelectedParcelLabelFileAndMapForReordering(CiftiParcelL
     m_parcelReorderingModel->setSelectedParcelLabelFileAndMapForReordering(selectedParcelLabelFile,
                                                                            selectedParcelLabelFileMapIndex,
                                                                            enabledStatus);
+    
+    /*
+     * Matrix rows are drawn in the reordered order
+     */
+    invalidateMatrixChartingPrimitives();
 }
 
 /**
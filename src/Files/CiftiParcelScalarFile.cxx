@@ -596,6 +596,11 @@ CiftiParcelScalarFile::setSelectedParcelLabelFileAndMapForReordering(CiftiParcel
     m_parcelReorderingModel->setSelectedParcelLabelFileAndMapForReordering(selectedParcelLabelFile,
                                                                            selectedParcelLabelFileMapIndex,
                                                                            enabledStatus);
+    
+    /*
+     * Matrix rows are drawn in the reordered order
+     */
+    invalidateMatrixChartingPrimitives();
 }
 
 /**
@@ -295,6 +295,11 @@ CiftiParcelSeriesFile::setSelectedParcelLabelFileAndMapForReordering(CiftiParcel
     m_parcelReorderingModel->setSelectedParcelLabelFileAndMapForReordering(selectedParcelLabelFile,
                                                                            selectedParcelLabelFileMapIndex,
                                                                            enabledStatus);
+    
+    /*
+     * Matrix rows are drawn in the reordered order
+     */
+    invalidateMatrixChartingPrimitives();
 }
 
 /**
@@ -0,0 +1,273 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "ConnectedComponentHelper.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "TopologyHelper.h"
+
+#include <cstdlib>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+ConnectedComponentHelper::ConnectedComponentHelper(const TopologyHelper* myTopoHelp)
+{
+    CaretAssert(myTopoHelp != NULL);
+    m_isVolume = false;
+    m_numElements = myTopoHelp->getNumberOfNodes();
+    m_dims[0] = 0; m_dims[1] = 0; m_dims[2] = 0;
+    m_lowerStart.resize(m_numElements + 1);
+    m_lowerStart[0] = 0;
+    for (int32_t i = 0; i < (int32_t)m_numElements; ++i)
+    {//each edge only needs to be unioned once, so only keep the direction toward the lower index
+        const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(i);
+        for (int n = 0; n < (int)neighbors.size(); ++n)
+        {
+            if (neighbors[n] < i) m_lowerNeighbors.push_back(neighbors[n]);
+        }
+        m_lowerStart[i + 1] = (int64_t)m_lowerNeighbors.size();
+    }
+}
+
+ConnectedComponentHelper::ConnectedComponentHelper(const int64_t dims[3], const int& connectivity)
+{
+    if (connectivity != 6 && connectivity != 18 && connectivity != 26)
+    {
+        throw CaretException("voxel connectivity must be 6, 18, or 26");
+    }
+    m_isVolume = true;
+    m_dims[0] = dims[0]; m_dims[1] = dims[1]; m_dims[2] = dims[2];
+    m_numElements = dims[0] * dims[1] * dims[2];
+    if (m_numElements > numeric_limits<int32_t>::max())
+    {
+        throw CaretException("volume has too many voxels for connected components labeling");
+    }
+    for (int k = -1; k <= 1; ++k)
+    {
+        for (int j = -1; j <= 1; ++j)
+        {
+            for (int i = -1; i <= 1; ++i)
+            {
+                int dist = abs(i) + abs(j) + abs(k);
+                if (dist == 0) continue;
+                if (connectivity == 6 && dist > 1) continue;
+                if (connectivity == 18 && dist > 2) continue;
+                if (k < 0 || (k == 0 && (j < 0 || (j == 0 && i < 0))))//lower linear index
+                {
+                    m_lowerStencil.push_back(i);
+                    m_lowerStencil.push_back(j);
+                    m_lowerStencil.push_back(k);
+                }
+            }
+        }
+    }
+}
+
+int32_t ConnectedComponentHelper::findRoot(int32_t* parents, int32_t elem)
+{
+    while (parents[elem] != elem)
+    {
+        parents[elem] = parents[parents[elem]];//path halving
+        elem = parents[elem];
+    }
+    return elem;
+}
+
+void ConnectedComponentHelper::unionRoots(int32_t* parents, int32_t first, int32_t second)
+{
+    first = findRoot(parents, first);
+    second = findRoot(parents, second);
+    if (first == second) return;
+    if (first < second)//keep the lowest index as the root, so a parent is never higher than its child
+    {
+        parents[second] = first;
+    } else {
+        parents[first] = second;
+    }
+}
+
+void ConnectedComponentHelper::unionRange(const char* mask, int32_t* parents, const int64_t& start, const int64_t& end, vector<int32_t>& deferredOut) const
+{//only touches parents inside [start, end), edges reaching below start are saved for the serial merge
+    if (start >= end) return;
+    if (m_isVolume)
+    {
+        int stencilSize = (int)m_lowerStencil.size();
+        int64_t ijk[3] = { start % m_dims[0], (start / m_dims[0]) % m_dims[1], start / (m_dims[0] * m_dims[1]) };
+        for (int64_t index = start; index < end; ++index)
+        {
+            if (mask[index] != 0)
+            {
+                for (int s = 0; s < stencilSize; s += 3)
+                {
+                    int64_t neighIJK[3] = { ijk[0] + m_lowerStencil[s], ijk[1] + m_lowerStencil[s + 1], ijk[2] + m_lowerStencil[s + 2] };
+                    if (neighIJK[0] < 0 || neighIJK[0] >= m_dims[0] || neighIJK[1] < 0 || neighIJK[1] >= m_dims[1] || neighIJK[2] < 0) continue;
+                    int64_t neighIndex = neighIJK[0] + m_dims[0] * (neighIJK[1] + m_dims[1] * neighIJK[2]);
+                    if (mask[neighIndex] != 0)
+                    {
+                        if (neighIndex >= start)
+                        {
+                            unionRoots(parents, (int32_t)index, (int32_t)neighIndex);
+                        } else {
+                            deferredOut.push_back((int32_t)index);
+                            deferredOut.push_back((int32_t)neighIndex);
+                        }
+                    }
+                }
+            }
+            ++ijk[0];
+            if (ijk[0] == m_dims[0])
+            {
+                ijk[0] = 0;
+                ++ijk[1];
+                if (ijk[1] == m_dims[1])
+                {
+                    ijk[1] = 0;
+                    ++ijk[2];
+                }
+            }
+        }
+    } else {
+        for (int64_t index = start; index < end; ++index)
+        {
+            if (mask[index] != 0)
+            {
+                for (int64_t n = m_lowerStart[index]; n < m_lowerStart[index + 1]; ++n)
+                {
+                    int32_t neighbor = m_lowerNeighbors[n];
+                    if (mask[neighbor] != 0)
+                    {
+                        if (neighbor >= start)
+                        {
+                            unionRoots(parents, (int32_t)index, neighbor);
+                        } else {
+                            deferredOut.push_back((int32_t)index);
+                            deferredOut.push_back(neighbor);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+int32_t ConnectedComponentHelper::labelComponents(const char* mask, int32_t* labelsOut) const
+{
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        labelsOut[i] = (mask[i] != 0) ? (int32_t)i : -1;
+    }
+    vector<vector<int32_t> > deferred;
+#pragma omp CARET_PAR if(m_numElements >= 65536)
+    {
+        int numThreads = 1, myThread = 0;
+#ifdef CARET_OMP
+        numThreads = omp_get_num_threads();
+        myThread = omp_get_thread_num();
+#endif
+#pragma omp CARET_SINGLE
+        {
+            deferred.resize(numThreads);
+        }//implicit barrier
+        int64_t start = m_numElements * myThread / numThreads, end = m_numElements * (myThread + 1) / numThreads;
+        unionRange(mask, labelsOut, start, end, deferred[myThread]);
+    }
+    for (size_t t = 0; t < deferred.size(); ++t)
+    {//merge the edges that cross chunk boundaries
+        const vector<int32_t>& thisDeferred = deferred[t];
+        for (size_t i = 0; i < thisDeferred.size(); i += 2)
+        {
+            unionRoots(labelsOut, thisDeferred[i], thisDeferred[i + 1]);
+        }
+    }
+    int32_t numComponents = 0;
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {//parents are never higher than children, so every lower entry has already been converted to its component number
+        int32_t parent = labelsOut[i];
+        if (parent < 0) continue;
+        if (parent == (int32_t)i)
+        {
+            labelsOut[i] = numComponents;
+            ++numComponents;
+        } else {
+            labelsOut[i] = labelsOut[parent];
+        }
+    }
+    return numComponents;
+}
+
+void ConnectedComponentHelper::sumPerComponent(const int32_t* labels, const int32_t& numComponents, const float* weights, vector<double>& sumsOut) const
+{
+    sumsOut.assign(numComponents, 0.0);
+    if (weights == NULL)
+    {
+        for (int64_t i = 0; i < m_numElements; ++i)
+        {
+            if (labels[i] >= 0) sumsOut[labels[i]] += 1.0;
+        }
+    } else {
+        for (int64_t i = 0; i < m_numElements; ++i)
+        {
+            if (labels[i] >= 0) sumsOut[labels[i]] += weights[i];
+        }
+    }
+}
+
+void ConnectedComponentHelper::maxPerComponent(const int32_t* labels, const int32_t& numComponents, const float* values, vector<float>& maxOut) const
+{
+    maxOut.assign(numComponents, -numeric_limits<float>::infinity());
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if (labels[i] >= 0 && values[i] > maxOut[labels[i]]) maxOut[labels[i]] = values[i];
+    }
+}
+
+void ConnectedComponentHelper::getComponentMembers(const int32_t* labels, const int32_t& numComponents, vector<vector<int32_t> >& membersOut, const char* keep) const
+{
+    vector<int32_t> outIndex(numComponents, -1);
+    vector<int64_t> counts;
+    int32_t numOut = 0;
+    for (int32_t c = 0; c < numComponents; ++c)
+    {
+        if (keep == NULL || keep[c] != 0)
+        {
+            outIndex[c] = numOut;
+            ++numOut;
+        }
+    }
+    counts.resize(numOut, 0);
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if (labels[i] >= 0 && outIndex[labels[i]] >= 0) ++counts[outIndex[labels[i]]];
+    }
+    membersOut.clear();
+    membersOut.resize(numOut);
+    for (int32_t c = 0; c < numOut; ++c)
+    {
+        membersOut[c].reserve(counts[c]);
+    }
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        if (labels[i] >= 0 && outIndex[labels[i]] >= 0) membersOut[outIndex[labels[i]]].push_back((int32_t)i);
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef __CONNECTED_COMPONENT_HELPER_H__
+#define __CONNECTED_COMPONENT_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+#include <cstddef>
+#include <vector>
+
+namespace caret
+{
+
+    class TopologyHelper;
+
+    ///union-find connected components of a mask over surface vertices or voxels
+    ///components are numbered in order of their lowest member index, matching what a scan-order flood fill would give
+    ///all labeling and reduction functions are const, so one helper can be shared between threads working on different maps
+    class ConnectedComponentHelper
+    {
+        int64_t m_numElements;
+        bool m_isVolume;
+        //surface: neighbors with lower index than each vertex, in CSR form
+        std::vector<int64_t> m_lowerStart;
+        std::vector<int32_t> m_lowerNeighbors;
+        //volume: the half of the stencil that points to lower linear indices, as ijk triples
+        int64_t m_dims[3];
+        std::vector<int> m_lowerStencil;
+
+        static int32_t findRoot(int32_t* parents, int32_t elem);
+        static void unionRoots(int32_t* parents, int32_t first, int32_t second);
+        void unionRange(const char* mask, int32_t* parents, const int64_t& start, const int64_t& end, std::vector<int32_t>& deferredOut) const;
+    public:
+        ///use surface vertex neighbors as edges
+        ConnectedComponentHelper(const TopologyHelper* myTopoHelp);
+        ///use voxel adjacency, connectivity must be 6 (faces), 18 (faces and edges), or 26 (faces, edges and corners)
+        ConnectedComponentHelper(const int64_t dims[3], const int& connectivity = 6);
+
+        int64_t getNumberOfElements() const { return m_numElements; }
+
+        ///labelsOut must have getNumberOfElements() elements, gets -1 for elements outside the mask, returns the number of components
+        ///parallel over chunks of elements when called outside of a parallel region
+        int32_t labelComponents(const char* mask, int32_t* labelsOut) const;
+
+        ///sum of weights per component, or number of members if weights is NULL
+        void sumPerComponent(const int32_t* labels, const int32_t& numComponents, const float* weights, std::vector<double>& sumsOut) const;
+
+        ///maximum value per component
+        void maxPerComponent(const int32_t* labels, const int32_t& numComponents, const float* values, std::vector<float>& maxOut) const;
+
+        ///member lists of the selected components, in increasing index order, selected as nonzero entries of keep, or all if keep is NULL
+        void getComponentMembers(const int32_t* labels, const int32_t& numComponents, std::vector<std::vector<int32_t> >& membersOut, const char* keep = NULL) const;
+    };
+
+}
+
+#endif //__CONNECTED_COMPONENT_HELPER_H__
@@ -26,13 +26,30 @@
 using namespace caret;
 
 /**
- * Construct an event for invalidating surface coloring.
+ * Construct an event for invalidating all surface coloring.
  */
 EventSurfaceColoringInvalidate::EventSurfaceColoringInvalidate()
-: Event(EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE)
+: Event(EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE),
+m_mapFile(NULL)
 {
 }
 
+/**
+ * Construct an event for invalidating surface coloring after
+ * a change that only affects the coloring of one map file,
+ * such as an edit of its palette.  Overlay coloring from other
+ * files that does not depend upon the map file remains valid.
+ *
+ * @param mapFile
+ *    The map file whose coloring has changed.
+ */
+EventSurfaceColoringInvalidate::EventSurfaceColoringInvalidate(const CaretMappableDataFile* mapFile)
+: Event(EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE),
+m_mapFile(mapFile)
+{
+    CaretAssert(mapFile);
+}
+
 /**
  *  Destructore.
  */
@@ -41,3 +58,29 @@ EventSurfaceColoringInvalidate::~EventSurfaceColoringInvalidate()
     
 }
 
+/**
+ * @return The map file whose coloring has changed, or NULL
+ * if all coloring is invalid.
+ */
+const CaretMappableDataFile*
+EventSurfaceColoringInvalidate::getMapFile() const
+{
+    return m_mapFile;
+}
+
+/**
+ * Surface coloring invalidation only marks coloring as out of date.
+ *
+ * @param invalidatedObjectOut
+ *    Output with the map file whose coloring is invalidated, or
+ *    NULL if all coloring is invalidated.
+ * @return
+ *    True, always.
+ */
+bool
+EventSurfaceColoringInvalidate::isInvalidationEvent(const void*& invalidatedObjectOut) const
+{
+    invalidatedObjectOut = m_mapFile;
+    return true;
+}
+
@@ -26,19 +26,28 @@
 namespace caret {
 
     class BrainStructure;
+    class CaretMappableDataFile;
     
-    /// Invalidate all surface coloring
+    /// Invalidate all surface coloring, or only the coloring from one map file
     class EventSurfaceColoringInvalidate : public Event {
         
     public:
         EventSurfaceColoringInvalidate();
         
+        EventSurfaceColoringInvalidate(const CaretMappableDataFile* mapFile);
+        
         virtual ~EventSurfaceColoringInvalidate();
         
+        const CaretMappableDataFile* getMapFile() const;
+        
+        virtual bool isInvalidationEvent(const void*& invalidatedObjectOut) const;
+        
     private:
         EventSurfaceColoringInvalidate(const EventSurfaceColoringInvalidate&);
         
         EventSurfaceColoringInvalidate& operator=(const EventSurfaceColoringInvalidate&);      
+        
+        const CaretMappableDataFile* m_mapFile;
     };
 
 } // namespace
@@ -38,6 +38,7 @@
 #include "GroupAndNameHierarchyItem.h"
 #include "Palette.h"
 #include "PaletteColorMapping.h"
+#include "PaletteLookupTable.h"
 #include "MathFunctions.h"
 
 using namespace caret;
@@ -197,6 +198,38 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
                              rgbaNegativeOne);
     const bool rgbaNegativeOneValid = (rgbaNegativeOne[3] > 0.0);
     
+    /*
+     * The palette's lookup table is kept by the palette, so it
+     * is sampled once instead of searched for every scalar.
+     */
+    const PaletteLookupTable* paletteLookupTable = palette->getLookupTable(interpolateFlag);
+    
+    /*
+     * Threshold test for all scalars, as a mask, since the test
+     * depends only on the threshold values and not on the palette.
+     */
+    std::vector<uint8_t> thresholdPassedMask;
+    if ( ! skipThresholdTesting) {
+        thresholdPassedMask.resize(numberOfScalars);
+        uint8_t* maskPointer = &thresholdPassedMask[0];
+        if (showOutsideFlag) {
+#pragma omp CARET_PARFOR schedule(static)
+            for (int64_t i = 0; i < numberOfScalars; i++) {
+                const float threshold = thresholdValues[i];
+                maskPointer[i] = ((threshold > thresholdMaximum)
+                                  | (threshold < thresholdMinimum));
+            }
+        }
+        else {
+#pragma omp CARET_PARFOR schedule(static)
+            for (int64_t i = 0; i < numberOfScalars; i++) {
+                const float threshold = thresholdValues[i];
+                maskPointer[i] = ((threshold >= thresholdMinimum)
+                                  & (threshold <= thresholdMaximum));
+            }
+        }
+    }
+    
     /*
      * Color all scalars.
      */
@@ -294,9 +327,8 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
              * Color scalar using palette
              */
             float rgba[4];
-            palette->getPaletteColor(normalValue,
-                                     interpolateFlag,
-                                     rgba);
+            paletteLookupTable->getPaletteColor(normalValue,
+                                                rgba);
             if (rgba[3] > 0.0f) {
                 rgbaOut[0] = rgba[0];
                 rgbaOut[1] = rgba[1];
@@ -310,24 +342,8 @@ NodeAndVoxelColoring::colorScalarsWithPalettePrivate(const FastStatistics* stati
          * Threshold is done last so colors are still set
          * but if threshold test fails, alpha is set invalid.
          */
-        bool thresholdPassedFlag = false;
-        if (skipThresholdTesting) {
-            thresholdPassedFlag = true;
-        }
-        else if (showOutsideFlag) {
-            if (threshold > thresholdMaximum) {
-                thresholdPassedFlag = true;
-            }
-            else if (threshold < thresholdMinimum) {
-                thresholdPassedFlag = true;
-            }
-        }
-        else {
-            if ((threshold >= thresholdMinimum) &&
-                (threshold <= thresholdMaximum)) {
-                thresholdPassedFlag = true;
-            }
-        }
+        const bool thresholdPassedFlag = (skipThresholdTesting
+                                          || (thresholdPassedMask[i] != 0));
         if (thresholdPassedFlag == false) {
             rgbaOut[3] = 0.0;
             if (showMappedThresholdFailuresInGreen) {
@@ -47,14 +47,20 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SO
 
 #include "RibbonMappingHelper.h"
 
+#include "CaretAssert.h"
 #include "CaretException.h"
+#include "CaretOMP.h"
+#include "DataFileException.h"
 #include "FloatMatrix.h"
 #include "MathFunctions.h"
+#include "SparseWeightsFile.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include "VolumeSpace.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 using namespace caret;
 using namespace std;
@@ -263,94 +269,315 @@ namespace
         return ((float)inside) / (divisions * divisions * divisions * 2);
     }
     
+    void computeVertexWeights(vector<VoxelWeight>& weightsOut, const int64_t& node, const VolumeSpace& myVolSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
+                              const TopologyHelper* myTopoHelp, const float* roiFrame, const int& numDivisions, const bool& thinColumn,
+                              const Vector3D& ivec, const Vector3D& jvec, const Vector3D& kvec)
+    {
+        weightsOut.clear();
+        const float* outerCoords = outerSurf->getCoordinateData();
+        const float* innerCoords = innerSurf->getCoordinateData();
+        const int64_t* myDims = myVolSpace.getDims();
+        float tempf;
+        int64_t node3 = node * 3;
+        PolyInfo myPoly(innerSurf, outerSurf, node, thinColumn);//build the polygon
+        Vector3D minIndex, maxIndex, tempvec;
+        myVolSpace.spaceToIndex(innerCoords + node3, minIndex);//find the bounding box in VOLUME INDEX SPACE, starting with the center nodes
+        maxIndex = minIndex;
+        myVolSpace.spaceToIndex(outerCoords + node3, tempvec);
+        for (int i = 0; i < 3; ++i)
+        {
+            if (tempvec[i] < minIndex[i]) minIndex[i] = tempvec[i];
+            if (tempvec[i] > maxIndex[i]) maxIndex[i] = tempvec[i];
+        }
+        int numNeigh;
+        const int* myNeighList = myTopoHelp->getNodeNeighbors(node, numNeigh);//and now the neighbors
+        for (int j = 0; j < numNeigh; ++j)
+        {
+            int neigh3 = myNeighList[j] * 3;
+            myVolSpace.spaceToIndex(outerCoords + neigh3, tempvec);
+            for (int i = 0; i < 3; ++i)
+            {
+                if (tempvec[i] < minIndex[i]) minIndex[i] = tempvec[i];
+                if (tempvec[i] > maxIndex[i]) maxIndex[i] = tempvec[i];
+            }
+            myVolSpace.spaceToIndex(innerCoords + neigh3, tempvec);
+            for (int i = 0; i < 3; ++i)
+            {
+                if (tempvec[i] < minIndex[i]) minIndex[i] = tempvec[i];
+                if (tempvec[i] > maxIndex[i]) maxIndex[i] = tempvec[i];
+            }
+        }
+        int startIndex[3], endIndex[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            startIndex[i] = (int)ceil(minIndex[i] - 0.5f);//give an extra half voxel in order to get anything which could have some polygon in it
+            endIndex[i] = (int)floor(maxIndex[i] + 0.5f) + 1;//ditto, plus the one-after end convention
+            if (startIndex[i] < 0) startIndex[i] = 0;//keep it inside the volume boundaries
+            if (endIndex[i] > myDims[i]) endIndex[i] = myDims[i];
+        }
+        int64_t ijk[3];
+        for (ijk[0] = startIndex[0]; ijk[0] < endIndex[0]; ++ijk[0])
+        {
+            for (ijk[1] = startIndex[1]; ijk[1] < endIndex[1]; ++ijk[1])
+            {
+                for (ijk[2] = startIndex[2]; ijk[2] < endIndex[2]; ++ijk[2])
+                {
+                    if (roiFrame == NULL || roiFrame[myVolSpace.getIndex(ijk)] > 0.0f)
+                    {
+                        tempf = computeVoxelFraction(myVolSpace, ijk, myPoly, numDivisions, ivec, jvec, kvec);
+                        if (tempf != 0.0f)
+                        {
+                            weightsOut.push_back(VoxelWeight(tempf, ijk));
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    void checkRibbonInputs(const SurfaceFile* innerSurf, const SurfaceFile* outerSurf, const int& numDivisions)
+    {
+        if (!innerSurf->hasNodeCorrespondence(*outerSurf))
+        {
+            throw CaretException("input surfaces to ribbon mapping do not have vertex correspondence");
+        }
+        if (numDivisions < 1)
+        {
+            throw CaretException("number of voxel subdivisions must be positive for ribbon mapping");
+        }
+    }
+    
+    const char RIBBON_WEIGHTS_MAGIC[] = "\0\0\0\0rmw\0";
+    const int32_t RIBBON_WEIGHTS_VERSION = 2;
+    
 }
 
 void RibbonMappingHelper::computeWeightsRibbon(vector<vector<VoxelWeight> >& myWeightsOut, const VolumeSpace& myVolSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
                                                const float* roiFrame, const int& numDivisions, const bool& thinColumn)
 {
-    if (!innerSurf->hasNodeCorrespondence(*outerSurf))
-    {
-        throw CaretException("input surfaces to ribbon mapping do not have vertex correspondence");
-    }
-    if (numDivisions < 1)
-    {
-        throw CaretException("number of voxel subdivisions must be positive for ribbon mapping");
-    }
+    checkRibbonInputs(innerSurf, outerSurf, numDivisions);
     int64_t numNodes = outerSurf->getNumberOfNodes();
     myWeightsOut.resize(numNodes);
     Vector3D origin, ivec, jvec, kvec;//these are the spatial projections of the ijk unit vectors (also, the offset that specifies the origin)
     myVolSpace.getSpacingVectors(ivec, jvec, kvec, origin);
-    const float* outerCoords = outerSurf->getCoordinateData();
-    const float* innerCoords = innerSurf->getCoordinateData();
-    const int64_t* myDims = myVolSpace.getDims();
 #pragma omp CARET_PAR
     {
         int maxVoxelCount = 10;//guess for preallocating vectors
         CaretPointer<TopologyHelper> myTopoHelp = innerSurf->getTopologyHelper();
+        vector<VoxelWeight> scratchWeights;
 #pragma omp CARET_FOR schedule(dynamic)
         for (int64_t node = 0; node < numNodes; ++node)
         {
+            computeVertexWeights(scratchWeights, node, myVolSpace, innerSurf, outerSurf, myTopoHelp, roiFrame, numDivisions, thinColumn, ivec, jvec, kvec);
             myWeightsOut[node].clear();
-            myWeightsOut[node].reserve(maxVoxelCount);
-            float tempf;
-            int64_t node3 = node * 3;
-            PolyInfo myPoly(innerSurf, outerSurf, node, thinColumn);//build the polygon
-            Vector3D minIndex, maxIndex, tempvec;
-            myVolSpace.spaceToIndex(innerCoords + node3, minIndex);//find the bounding box in VOLUME INDEX SPACE, starting with the center nodes
-            maxIndex = minIndex;
-            myVolSpace.spaceToIndex(outerCoords + node3, tempvec);
-            for (int i = 0; i < 3; ++i)
+            myWeightsOut[node].reserve(max(maxVoxelCount, (int)scratchWeights.size()));
+            myWeightsOut[node].insert(myWeightsOut[node].end(), scratchWeights.begin(), scratchWeights.end());
+            if ((int)myWeightsOut[node].size() > maxVoxelCount)
+            {//capacity() would use more memory
+                maxVoxelCount = myWeightsOut[node].size();
+            }
+        }
+    }
+}
+
+void RibbonMappingHelper::computeWeightsRibbon(RibbonMappingWeights& myWeightsOut, const VolumeSpace& myVolSpace, const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
+                                               const float* roiFrame, const int& numDivisions, const bool& thinColumn)
+{
+    checkRibbonInputs(innerSurf, outerSurf, numDivisions);
+    const int64_t* myDims = myVolSpace.getDims();
+    if (myDims[0] * myDims[1] * myDims[2] > numeric_limits<int32_t>::max())
+    {
+        throw CaretException("volume is too large for compact ribbon mapping weights");
+    }
+    int64_t numNodes = outerSurf->getNumberOfNodes();
+    Vector3D origin, ivec, jvec, kvec;
+    myVolSpace.getSpacingVectors(ivec, jvec, kvec, origin);
+    vector<vector<int32_t> > nodeIndices(numNodes);//8 bytes per weight while computing, instead of the 28 of VoxelWeight
+    vector<vector<float> > nodeWeights(numNodes);
+#pragma omp CARET_PAR
+    {
+        CaretPointer<TopologyHelper> myTopoHelp = innerSurf->getTopologyHelper();
+        vector<VoxelWeight> scratchWeights;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t node = 0; node < numNodes; ++node)
+        {
+            computeVertexWeights(scratchWeights, node, myVolSpace, innerSurf, outerSurf, myTopoHelp, roiFrame, numDivisions, thinColumn, ivec, jvec, kvec);
+            int numWeights = (int)scratchWeights.size();
+            nodeIndices[node].resize(numWeights);
+            nodeWeights[node].resize(numWeights);
+            for (int i = 0; i < numWeights; ++i)
             {
-                if (tempvec[i] < minIndex[i]) minIndex[i] = tempvec[i];
-                if (tempvec[i] > maxIndex[i]) maxIndex[i] = tempvec[i];
+                nodeIndices[node][i] = (int32_t)myVolSpace.getIndex(scratchWeights[i].ijk);
+                nodeWeights[node][i] = scratchWeights[i].weight;
             }
-            int numNeigh;
-            const int* myNeighList = myTopoHelp->getNodeNeighbors(node, numNeigh);//and now the neighbors
-            for (int j = 0; j < numNeigh; ++j)
+        }
+    }
+    myWeightsOut.m_volSpace = myVolSpace;
+    myWeightsOut.m_numVertices = numNodes;
+    myWeightsOut.m_rowStart.resize(numNodes + 1);
+    myWeightsOut.m_rowStart[0] = 0;
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        myWeightsOut.m_rowStart[node + 1] = myWeightsOut.m_rowStart[node] + (int64_t)nodeIndices[node].size();
+    }
+    myWeightsOut.m_voxelIndex.resize(myWeightsOut.m_rowStart[numNodes]);
+    myWeightsOut.m_weights.resize(myWeightsOut.m_rowStart[numNodes]);
+#pragma omp CARET_PARFOR schedule(dynamic, 1024)
+    for (int64_t node = 0; node < numNodes; ++node)
+    {
+        int64_t start = myWeightsOut.m_rowStart[node];
+        copy(nodeIndices[node].begin(), nodeIndices[node].end(), myWeightsOut.m_voxelIndex.begin() + start);
+        copy(nodeWeights[node].begin(), nodeWeights[node].end(), myWeightsOut.m_weights.begin() + start);
+        vector<int32_t>().swap(nodeIndices[node]);//release as we go
+        vector<float>().swap(nodeWeights[node]);
+    }
+    myWeightsOut.computeMappingInfo();
+}
+
+void RibbonMappingWeights::setFromVoxelWeights(const vector<vector<VoxelWeight> >& weightsIn, const VolumeSpace& volSpace)
+{
+    const int64_t* myDims = volSpace.getDims();
+    if (myDims[0] * myDims[1] * myDims[2] > numeric_limits<int32_t>::max())
+    {
+        throw CaretException("volume is too large for compact ribbon mapping weights");
+    }
+    m_volSpace = volSpace;
+    m_numVertices = (int64_t)weightsIn.size();
+    m_rowStart.resize(m_numVertices + 1);
+    m_rowStart[0] = 0;
+    for (int64_t i = 0; i < m_numVertices; ++i)
+    {
+        m_rowStart[i + 1] = m_rowStart[i] + (int64_t)weightsIn[i].size();
+    }
+    m_voxelIndex.resize(m_rowStart[m_numVertices]);
+    m_weights.resize(m_rowStart[m_numVertices]);
+    for (int64_t i = 0; i < m_numVertices; ++i)
+    {
+        int64_t base = m_rowStart[i];
+        int64_t numWeights = (int64_t)weightsIn[i].size();
+        for (int64_t j = 0; j < numWeights; ++j)
+        {
+            m_voxelIndex[base + j] = (int32_t)volSpace.getIndex(weightsIn[i][j].ijk);
+            m_weights[base + j] = weightsIn[i][j].weight;
+        }
+    }
+    computeMappingInfo();
+}
+
+void RibbonMappingWeights::writeFile(const AString& filename) const
+{
+    CaretAssert((int64_t)m_rowStart.size() == m_numVertices + 1);
+    const int64_t* myDims = m_volSpace.getDims();
+    const vector<vector<float> >& mySform = m_volSpace.getSform();
+    vector<int64_t> dims(myDims, myDims + 3);
+    vector<float> sform(12);
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            sform[i * 4 + j] = mySform[i][j];
+        }
+    }
+    SparseWeightsFile::writeFile(filename, RIBBON_WEIGHTS_MAGIC, RIBBON_WEIGHTS_VERSION, "ribbon weights", myDims[0] * myDims[1] * myDims[2],
+                                 m_rowStart, m_voxelIndex, m_weights, dims, sform);
+}
+
+void RibbonMappingWeights::readFile(const AString& filename)
+{
+    RibbonMappingWeights newWeights;//don't modify the existing weights if the file is bad
+    int64_t frameSize;
+    vector<int64_t> dims;
+    vector<float> sform;
+    SparseWeightsFile::readFile(filename, RIBBON_WEIGHTS_MAGIC, RIBBON_WEIGHTS_VERSION, "ribbon weights", frameSize,
+                                newWeights.m_rowStart, newWeights.m_voxelIndex, newWeights.m_weights, 3, dims, 12, sform);
+    if (dims[0] < 1 || dims[1] < 1 || dims[2] < 1 || dims[0] * dims[1] * dims[2] != frameSize)
+    {
+        throw DataFileException("impossible dimensions in ribbon weights file");
+    }
+    m_volSpace.setSpace(dims.data(), sform.data());
+    m_numVertices = (int64_t)newWeights.m_rowStart.size() - 1;
+    m_rowStart.swap(newWeights.m_rowStart);
+    m_voxelIndex.swap(newWeights.m_voxelIndex);
+    m_weights.swap(newWeights.m_weights);
+    computeMappingInfo();
+}
+
+void RibbonMappingWeights::computeMappingInfo()
+{
+    const int64_t numTotal = (int64_t)m_voxelIndex.size();
+    m_usedVoxels.assign(m_voxelIndex.begin(), m_voxelIndex.end());
+    sort(m_usedVoxels.begin(), m_usedVoxels.end());
+    m_usedVoxels.erase(unique(m_usedVoxels.begin(), m_usedVoxels.end()), m_usedVoxels.end());
+    m_usedIndex.resize(numTotal);
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t i = 0; i < numTotal; ++i)
+    {
+        m_usedIndex[i] = (int32_t)(lower_bound(m_usedVoxels.begin(), m_usedVoxels.end(), m_voxelIndex[i]) - m_usedVoxels.begin());
+    }
+    m_totalWeights.resize(m_numVertices);
+    for (int64_t node = 0; node < m_numVertices; ++node)
+    {
+        float total = 0.0f;
+        for (int64_t i = m_rowStart[node]; i < m_rowStart[node + 1]; ++i)
+        {
+            total += m_weights[i];
+        }
+        m_totalWeights[node] = total;
+    }
+}
+
+void RibbonMappingWeights::mapFrames(const vector<const float*>& framesIn, const vector<float*>& framesOut) const
+{
+    CaretAssert(framesIn.size() == framesOut.size());
+    const int64_t numFrames = (int64_t)framesIn.size();
+    if (numFrames == 0) return;
+    CaretAssert((int64_t)m_usedIndex.size() == (int64_t)m_voxelIndex.size() && (int64_t)m_totalWeights.size() == m_numVertices);
+    //the ribbon only touches a small fraction of the voxels, so gather those voxels from a block of frames into voxel-major order,
+    //then each weight multiplies a contiguous run of values instead of reading the same voxel from many different frames
+    const int64_t numUsed = (int64_t)m_usedVoxels.size();
+    const int BLOCK = 16;//frames per pass, the accumulator array should fit in registers
+    vector<float> gathered(numUsed * BLOCK, 0.0f);
+    for (int64_t blockStart = 0; blockStart < numFrames; blockStart += BLOCK)
+    {
+        int blockSize = (int)min((int64_t)BLOCK, numFrames - blockStart);
+#pragma omp CARET_PARFOR schedule(static)
+        for (int64_t v = 0; v < numUsed; ++v)
+        {
+            float* dest = gathered.data() + v * BLOCK;
+            int32_t voxel = m_usedVoxels[v];
+            for (int f = 0; f < blockSize; ++f)
             {
-                int neigh3 = myNeighList[j] * 3;
-                myVolSpace.spaceToIndex(outerCoords + neigh3, tempvec);
-                for (int i = 0; i < 3; ++i)
-                {
-                    if (tempvec[i] < minIndex[i]) minIndex[i] = tempvec[i];
-                    if (tempvec[i] > maxIndex[i]) maxIndex[i] = tempvec[i];
-                }
-                myVolSpace.spaceToIndex(innerCoords + neigh3, tempvec);
-                for (int i = 0; i < 3; ++i)
-                {
-                    if (tempvec[i] < minIndex[i]) minIndex[i] = tempvec[i];
-                    if (tempvec[i] > maxIndex[i]) maxIndex[i] = tempvec[i];
-                }
+                dest[f] = framesIn[blockStart + f][voxel];
             }
-            int startIndex[3], endIndex[3];
-            for (int i = 0; i < 3; ++i)
+        }
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+        for (int64_t node = 0; node < m_numVertices; ++node)
+        {
+            float accum[BLOCK];
+            for (int f = 0; f < BLOCK; ++f)
             {
-                startIndex[i] = (int)ceil(minIndex[i] - 0.5f);//give an extra half voxel in order to get anything which could have some polygon in it
-                endIndex[i] = (int)floor(maxIndex[i] + 0.5f) + 1;//ditto, plus the one-after end convention
-                if (startIndex[i] < 0) startIndex[i] = 0;//keep it inside the volume boundaries
-                if (endIndex[i] > myDims[i]) endIndex[i] = myDims[i];
+                accum[f] = 0.0f;
             }
-            int64_t ijk[3];
-            for (ijk[0] = startIndex[0]; ijk[0] < endIndex[0]; ++ijk[0])
+            for (int64_t i = m_rowStart[node]; i < m_rowStart[node + 1]; ++i)
             {
-                for (ijk[1] = startIndex[1]; ijk[1] < endIndex[1]; ++ijk[1])
+                const float thisWeight = m_weights[i];
+                const float* src = gathered.data() + m_usedIndex[i] * (int64_t)BLOCK;
+                for (int f = 0; f < BLOCK; ++f)//full width so it vectorizes, extra lanes are never written out
                 {
-                    for (ijk[2] = startIndex[2]; ijk[2] < endIndex[2]; ++ijk[2])
-                    {
-                        if (roiFrame == NULL || roiFrame[myVolSpace.getIndex(ijk)] > 0.0f)
-                        {
-                            tempf = computeVoxelFraction(myVolSpace, ijk, myPoly, numDivisions, ivec, jvec, kvec);
-                            if (tempf != 0.0f)
-                            {
-                                myWeightsOut[node].push_back(VoxelWeight(tempf, ijk));
-                            }
-                        }
-                    }
+                    accum[f] += thisWeight * src[f];
                 }
             }
-            if ((int)myWeightsOut[node].size() > maxVoxelCount)
-            {//capacity() would use more memory
-                maxVoxelCount = myWeightsOut[node].size();
+            if (m_totalWeights[node] != 0.0f)
+            {
+                for (int f = 0; f < blockSize; ++f)
+                {
+                    framesOut[blockStart + f][node] = accum[f] / m_totalWeights[node];
+                }
+            } else {
+                for (int f = 0; f < blockSize; ++f)
+                {
+                    framesOut[blockStart + f][node] = 0.0f;
+                }
             }
         }
     }
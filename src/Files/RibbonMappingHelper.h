@@ -21,6 +21,9 @@
  */
 /*LICENSE_END*/
 
+#include "AString.h"
+#include "VolumeSpace.h"
+
 #include "stdint.h"
 #include <cstddef>
 #include <vector>
@@ -29,7 +32,6 @@ namespace caret
 {
     
     class SurfaceFile;
-    class VolumeSpace;
     
     struct VoxelWeight
     {//for precomputation in ribbon/myelin style volume to surface mapping
@@ -45,6 +47,28 @@ namespace caret
         }
     };
     
+    ///compressed sparse row form of per-vertex voxel weights, using linear voxel indices within a frame, so it can be reused across many volumes in the same space
+    struct RibbonMappingWeights
+    {
+        VolumeSpace m_volSpace;
+        int64_t m_numVertices;
+        std::vector<int64_t> m_rowStart;//weights for vertex i are elements m_rowStart[i] to m_rowStart[i + 1] - 1, size is m_numVertices + 1
+        std::vector<int32_t> m_voxelIndex;//linear index into a single frame
+        std::vector<float> m_weights;
+        std::vector<int32_t> m_usedVoxels;//sorted voxels that have any weight, used by mapFrames
+        std::vector<int32_t> m_usedIndex;//position of each weight's voxel in m_usedVoxels
+        std::vector<float> m_totalWeights;//sum of the weights of each vertex
+        RibbonMappingWeights() { m_numVertices = 0; }
+        ///compute m_usedVoxels, m_usedIndex and m_totalWeights - must be called again after changing the weights directly, before mapFrames
+        void computeMappingInfo();
+        void setFromVoxelWeights(const std::vector<std::vector<VoxelWeight> >& weightsIn, const VolumeSpace& volSpace);
+        int64_t getNumWeights(const int64_t& vertex) const { return m_rowStart[vertex + 1] - m_rowStart[vertex]; }
+        void readFile(const AString& filename);
+        void writeFile(const AString& filename) const;
+        ///map many frames in the same volume space at once, each vertex is the weighted average of its voxels (0 if no weight), each output frame must have m_numVertices elements
+        void mapFrames(const std::vector<const float*>& framesIn, const std::vector<float*>& framesOut) const;
+    };
+    
     class RibbonMappingHelper
     {
     public:
@@ -52,6 +76,10 @@ namespace caret
         static void computeWeightsRibbon(std::vector<std::vector<VoxelWeight> >& myWeightsOut, const VolumeSpace& myVolSpace,
                                          const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
                                          const float* roiFrame = NULL, const int& numDivisions = 3, const bool& thinColumn = false);
+        ///same, but directly into the compact form
+        static void computeWeightsRibbon(RibbonMappingWeights& myWeightsOut, const VolumeSpace& myVolSpace,
+                                         const SurfaceFile* innerSurf, const SurfaceFile* outerSurf,
+                                         const float* roiFrame = NULL, const int& numDivisions = 3, const bool& thinColumn = false);
     };
 
 }
@@ -71,12 +71,7 @@ SparseVolumeIndexer::SparseVolumeIndexer(const CiftiBrainModelsMap& ciftiBrainMo
     if ( ! ciftiBrainModelsMap.hasVolumeData()) {
         return;
     }
-    m_volumeSpace = ciftiBrainModelsMap.getVolumeSpace();
-    std::vector<CiftiBrainModelsMap::VolumeMap> ciftiVoxelMapping = ciftiBrainModelsMap.getFullVolumeMap();
-    const int32_t numberOfCiftiVolumeVoxels = static_cast<int32_t>(ciftiVoxelMapping.size());
-    if (numberOfCiftiVolumeVoxels <= 0) {
-        return;
-    }
+    m_volumeSpace = ciftiBrainModelsMap.getVolumeSpace();//volume models can't be empty, so there is at least one voxel
     
     /*
      * Make sure orthogonal
@@ -92,45 +87,11 @@ SparseVolumeIndexer::SparseVolumeIndexer(const CiftiBrainModelsMap& ciftiBrainMo
         return;
     }
     
-    for (std::vector<CiftiBrainModelsMap::VolumeMap>::const_iterator iter = ciftiVoxelMapping.begin();
-         iter != ciftiVoxelMapping.end();
-         iter++) {
-        const CiftiBrainModelsMap::VolumeMap& vm = *iter;
-        
-        m_voxelIndexLookup.at(vm.m_ijk) = vm.m_ciftiIndex;
-    }
-    
-    bool validateFlag = true;
-    if (validateFlag) {
-        AString validateString;
-        for (std::vector<CiftiBrainModelsMap::VolumeMap>::const_iterator iter = ciftiVoxelMapping.begin();
-             iter != ciftiVoxelMapping.end();
-             iter++) {
-            const CiftiBrainModelsMap::VolumeMap& vm = *iter;
-            const int64_t* foundOffset = m_voxelIndexLookup.find(vm.m_ijk);
-            if (foundOffset != NULL) {
-                if (*foundOffset != vm.m_ciftiIndex) {
-                    validateString.appendWithNewLine("IJK ("
-                                                     + AString::fromNumbers(vm.m_ijk, 3, ",")
-                                                     + " should have lookup value "
-                                                     + AString::number(vm.m_ciftiIndex)
-                                                     + " but has value "
-                                                     + AString::number(*foundOffset));
-                }
-            }
-            else {
-                validateString.appendWithNewLine("IJK ("
-                                                 + AString::fromNumbers(vm.m_ijk, 3, ",")
-                                                 + " should have lookup value "
-                                                 + AString::number(vm.m_ciftiIndex)
-                                                 + " but was not found.");
-            }
-        }
-        if (validateString.isEmpty() == false) {
-            CaretLogSevere("Sparse Indexer Errors:\n"
-                           + validateString);
-        }
-    }
+    /*
+     * The brain models map already has a voxel lookup, and copies
+     * of the map share it, so there is no need to build another one.
+     */
+    m_brainModelsMap.grabNew(new CiftiBrainModelsMap(ciftiBrainModelsMap));
     
     m_dataValid = true;
 }
@@ -259,6 +220,9 @@ SparseVolumeIndexer::getOffsetForIndices(const int64_t i,
                                          const int64_t k) const
 {
     if (m_dataValid) {
+        if (m_brainModelsMap != NULL) {
+            return m_brainModelsMap->getIndexForVoxel(i, j, k);
+        }
         const int64_t* offset = m_voxelIndexLookup.find(i, j, k);
         if (offset != NULL) {
             return *offset;
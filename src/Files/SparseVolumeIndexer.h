@@ -23,6 +23,7 @@
 
 #include "CaretCompact3DLookup.h"
 #include "CaretObject.h"
+#include "CaretPointer.h"
 #include "CiftiBrainModelsMap.h"
 #include "CiftiParcelsMap.h"
 #include "VolumeSpace.h"
@@ -83,6 +84,9 @@ namespace caret {
         
         CaretCompact3DLookup<int64_t> m_voxelIndexLookup;
         
+        /** Copy of brain models map, its voxel lookup is shared rather than rebuilt */
+        CaretPointer<const CiftiBrainModelsMap> m_brainModelsMap;
+        
         VolumeSpace m_volumeSpace;
     };
     
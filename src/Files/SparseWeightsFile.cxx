@@ -0,0 +1,153 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SparseWeightsFile.h"
+
+#include "ByteOrderEnum.h"
+#include "ByteSwapping.h"
+#include "CaretAssert.h"
+#include "CaretBinaryFile.h"
+#include "DataFileException.h"
+
+#include <cstring>
+#include <limits>
+
+using namespace std;
+using namespace caret;
+
+namespace
+{
+    const int64_t NUM_COUNTS = 3;//rows, columns, weights
+}
+
+void SparseWeightsFile::writeFile(const AString& filename, const char* magic, const int32_t& version, const AString& description, const int64_t& numColumns,
+                                  const vector<int64_t>& rowStart, const vector<int32_t>& columnIndex, const vector<float>& weights,
+                                  const vector<int64_t>& extraInts, const vector<float>& extraFloats)
+{
+    CaretAssert(!rowStart.empty() && rowStart.back() == (int64_t)columnIndex.size() && columnIndex.size() == weights.size());
+    if (filename.endsWith(".gz"))
+    {
+        throw DataFileException(description + " files cannot be written compressed");
+    }
+    CaretBinaryFile myFile(filename, CaretBinaryFile::WRITE_TRUNCATE);
+    myFile.write(magic, 8);
+    int32_t outVersion = version;
+    vector<int64_t> header(NUM_COUNTS);
+    header[0] = (int64_t)rowStart.size() - 1;
+    header[1] = numColumns;
+    header[2] = (int64_t)weights.size();
+    header.insert(header.end(), extraInts.begin(), extraInts.end());
+    vector<float> floatHeader = extraFloats;
+    bool swap = ByteOrderEnum::isSystemBigEndian();//file is always little endian
+    if (swap)
+    {
+        ByteSwapping::swapBytes(&outVersion, 1);
+        ByteSwapping::swapBytes(header.data(), header.size());
+        ByteSwapping::swapBytes(floatHeader.data(), floatHeader.size());
+    }
+    myFile.write(&outVersion, sizeof(int32_t));
+    myFile.write(header.data(), header.size() * sizeof(int64_t));
+    if (!floatHeader.empty()) myFile.write(floatHeader.data(), floatHeader.size() * sizeof(float));
+    if (swap)
+    {
+        vector<int64_t> swappedStart = rowStart;
+        vector<int32_t> swappedIndex = columnIndex;
+        vector<float> swappedWeights = weights;
+        ByteSwapping::swapBytes(swappedStart.data(), swappedStart.size());
+        ByteSwapping::swapBytes(swappedIndex.data(), swappedIndex.size());
+        ByteSwapping::swapBytes(swappedWeights.data(), swappedWeights.size());
+        myFile.write(swappedStart.data(), swappedStart.size() * sizeof(int64_t));
+        myFile.write(swappedIndex.data(), swappedIndex.size() * sizeof(int32_t));
+        myFile.write(swappedWeights.data(), swappedWeights.size() * sizeof(float));
+    } else {
+        myFile.write(rowStart.data(), rowStart.size() * sizeof(int64_t));
+        myFile.write(columnIndex.data(), columnIndex.size() * sizeof(int32_t));
+        myFile.write(weights.data(), weights.size() * sizeof(float));
+    }
+    myFile.close();
+}
+
+void SparseWeightsFile::readFile(const AString& filename, const char* magic, const int32_t& version, const AString& description, int64_t& numColumnsOut,
+                                 vector<int64_t>& rowStartOut, vector<int32_t>& columnIndexOut, vector<float>& weightsOut,
+                                 const int& numExtraInts, vector<int64_t>& extraIntsOut, const int& numExtraFloats, vector<float>& extraFloatsOut)
+{
+    if (filename.endsWith(".gz"))
+    {
+        throw DataFileException(description + " files cannot be read while compressed");
+    }
+    CaretBinaryFile myFile(filename, CaretBinaryFile::READ);
+    char buf[8];
+    myFile.read(buf, 8);
+    if (memcmp(buf, magic, 8) != 0) throw DataFileException("file '" + filename + "' is not a " + description + " file");
+    int32_t fileVersion;
+    vector<int64_t> header(NUM_COUNTS + numExtraInts);
+    vector<float> floatHeader(numExtraFloats);
+    myFile.read(&fileVersion, sizeof(int32_t));
+    myFile.read(header.data(), header.size() * sizeof(int64_t));
+    if (numExtraFloats > 0) myFile.read(floatHeader.data(), floatHeader.size() * sizeof(float));
+    bool swap = ByteOrderEnum::isSystemBigEndian();
+    if (swap)
+    {
+        ByteSwapping::swapBytes(&fileVersion, 1);
+        ByteSwapping::swapBytes(header.data(), header.size());
+        ByteSwapping::swapBytes(floatHeader.data(), floatHeader.size());
+    }
+    if (fileVersion != version) throw DataFileException("unsupported " + description + " file version: " + AString::number(fileVersion));
+    int64_t numRows = header[0], numColumns = header[1], numTotal = header[2];
+    if (numRows < 0 || numColumns < 0 || numColumns > numeric_limits<int32_t>::max() || numTotal < 0)
+    {
+        throw DataFileException("impossible dimensions in " + description + " file");
+    }
+    const int64_t dataBytes = myFile.size() - myFile.pos();//size is known, as compressed files were rejected above
+    const int64_t rowBytes = sizeof(int64_t), weightBytes = sizeof(int32_t) + sizeof(float);
+    if (numRows >= dataBytes / rowBytes ||//written this way to avoid overflow before anything is allocated
+        (dataBytes - (numRows + 1) * rowBytes) % weightBytes != 0 ||
+        (dataBytes - (numRows + 1) * rowBytes) / weightBytes != numTotal)
+    {
+        throw DataFileException("size of file '" + filename + "' does not match the dimensions in its " + description + " header");
+    }
+    vector<int64_t> rowStart(numRows + 1);
+    vector<int32_t> columnIndex(numTotal);
+    vector<float> weights(numTotal);
+    myFile.read(rowStart.data(), rowStart.size() * sizeof(int64_t));
+    myFile.read(columnIndex.data(), numTotal * sizeof(int32_t));
+    myFile.read(weights.data(), numTotal * sizeof(float));
+    if (swap)
+    {
+        ByteSwapping::swapBytes(rowStart.data(), rowStart.size());
+        ByteSwapping::swapBytes(columnIndex.data(), columnIndex.size());
+        ByteSwapping::swapBytes(weights.data(), weights.size());
+    }
+    if (rowStart[0] != 0 || rowStart[numRows] != numTotal) throw DataFileException(description + " file is inconsistent");
+    for (int64_t i = 0; i < numRows; ++i)
+    {
+        if (rowStart[i + 1] < rowStart[i]) throw DataFileException(description + " file is inconsistent");
+    }
+    for (int64_t i = 0; i < numTotal; ++i)
+    {
+        if (columnIndex[i] < 0 || columnIndex[i] >= numColumns) throw DataFileException("impossible index found in " + description + " file");
+    }
+    numColumnsOut = numColumns;
+    rowStartOut.swap(rowStart);
+    columnIndexOut.swap(columnIndex);
+    weightsOut.swap(weights);
+    extraIntsOut.assign(header.begin() + NUM_COUNTS, header.end());
+    extraFloatsOut.swap(floatHeader);
+}
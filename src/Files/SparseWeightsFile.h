@@ -0,0 +1,48 @@
+#ifndef __SPARSE_WEIGHTS_FILE_H__
+#define __SPARSE_WEIGHTS_FILE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "AString.h"
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret {
+
+    ///reading and writing of binary files of precomputed compressed sparse row weights, shared by ribbon mapping and surface resampling weights
+    ///layout is an 8 byte magic string, int32 version, int64 number of rows, columns, and weights, any int64 and float header values specific to the kind of file,
+    ///then the row starts (int64, one more than the number of rows), column indices (int32) and weights (float), all little endian
+    struct SparseWeightsFile
+    {
+        ///description is used in error messages, like "ribbon weights"
+        static void writeFile(const AString& filename, const char* magic, const int32_t& version, const AString& description, const int64_t& numColumns,
+                              const std::vector<int64_t>& rowStart, const std::vector<int32_t>& columnIndex, const std::vector<float>& weights,
+                              const std::vector<int64_t>& extraInts, const std::vector<float>& extraFloats);
+        ///checks the magic, version, row starts and column indices, the outputs are not modified if the file is bad
+        static void readFile(const AString& filename, const char* magic, const int32_t& version, const AString& description, int64_t& numColumnsOut,
+                             std::vector<int64_t>& rowStartOut, std::vector<int32_t>& columnIndexOut, std::vector<float>& weightsOut,
+                             const int& numExtraInts, std::vector<int64_t>& extraIntsOut, const int& numExtraFloats, std::vector<float>& extraFloatsOut);
+    };
+
+}
+
+#endif //__SPARSE_WEIGHTS_FILE_H__
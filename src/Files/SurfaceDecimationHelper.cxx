@@ -0,0 +1,471 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceDecimationHelper.h"
+
+#include "CaretAssert.h"
+#include "SurfaceFile.h"
+
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    ///sum of squared distances to a set of weighted planes, stored as the upper triangle of a symmetric 4x4 matrix
+    struct Quadric
+    {
+        double m_elem[10];
+        Quadric()
+        {
+            for (int i = 0; i < 10; ++i) m_elem[i] = 0.0;
+        }
+        void addPlane(const double normal[3], const double& offset, const double& weight)
+        {
+            const double plane[4] = { normal[0], normal[1], normal[2], offset };
+            int index = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                for (int j = i; j < 4; ++j)
+                {
+                    m_elem[index] += weight * plane[i] * plane[j];
+                    ++index;
+                }
+            }
+        }
+        void add(const Quadric& rhs)
+        {
+            for (int i = 0; i < 10; ++i) m_elem[i] += rhs.m_elem[i];
+        }
+        double evaluate(const float point[3]) const
+        {
+            const double x = point[0], y = point[1], z = point[2];
+            return m_elem[0] * x * x + 2.0 * m_elem[1] * x * y + 2.0 * m_elem[2] * x * z + 2.0 * m_elem[3] * x
+                   + m_elem[4] * y * y + 2.0 * m_elem[5] * y * z + 2.0 * m_elem[6] * y
+                   + m_elem[7] * z * z + 2.0 * m_elem[8] * z
+                   + m_elem[9];
+        }
+    };
+
+    ///cheapest move of a node onto a neighbor, stale if the node has been queued again since
+    struct Collapse
+    {
+        double m_cost;
+        int32_t m_node;
+        bool operator<(const Collapse& rhs) const
+        {
+            return m_cost > rhs.m_cost;//priority_queue gives the largest first, we want the lowest cost
+        }
+    };
+
+    void triangleNormal(const float* coords, const int32_t tri[3], double normalOut[3])
+    {//not normalized, length is twice the area
+        const float* v0 = coords + tri[0] * 3;
+        const float* v1 = coords + tri[1] * 3;
+        const float* v2 = coords + tri[2] * 3;
+        const double e1[3] = { (double)v1[0] - v0[0], (double)v1[1] - v0[1], (double)v1[2] - v0[2] };
+        const double e2[3] = { (double)v2[0] - v0[0], (double)v2[1] - v0[1], (double)v2[2] - v0[2] };
+        normalOut[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normalOut[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normalOut[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    }
+
+    ///state of the mesh while it is being decimated
+    struct DecimationMesh
+    {
+        const float* m_coords;
+        vector<int32_t> m_tris;
+        vector<char> m_triAlive;
+        vector<vector<int32_t> > m_nodeTris;//may contain dead triangles
+        vector<Quadric> m_quadrics;
+        vector<char> m_nodeLocked;//boundary or nonmanifold nodes are never moved
+        vector<char> m_nodeAlive;
+        vector<double> m_queuedCost;//infinity when not queued
+        priority_queue<Collapse> m_queue;
+        vector<int32_t> m_changed;
+        int64_t m_numAlive;
+
+        void getNeighbors(const int32_t& node, vector<int32_t>& neighborsOut) const
+        {//sorted, with each neighbor once per alive triangle it shares with the node
+            neighborsOut.clear();
+            const vector<int32_t>& myTris = m_nodeTris[node];
+            for (size_t i = 0; i < myTris.size(); ++i)
+            {
+                if (!m_triAlive[myTris[i]]) continue;
+                const int32_t* thisTri = m_tris.data() + myTris[i] * 3;
+                for (int j = 0; j < 3; ++j)
+                {
+                    if (thisTri[j] != node) neighborsOut.push_back(thisTri[j]);
+                }
+            }
+            sort(neighborsOut.begin(), neighborsOut.end());
+        }
+
+        double collapseCost(const int32_t& from, const int32_t& to) const
+        {
+            Quadric combined = m_quadrics[from];
+            combined.add(m_quadrics[to]);
+            return combined.evaluate(m_coords + to * 3);
+        }
+
+        void pushNode(const int32_t& node, const double& cost)
+        {
+            Collapse myCollapse;
+            myCollapse.m_cost = cost;
+            myCollapse.m_node = node;
+            m_queuedCost[node] = cost;
+            m_queue.push(myCollapse);
+        }
+
+        void queueNode(const int32_t& node, vector<int32_t>& scratch)
+        {
+            if (m_nodeLocked[node]) return;
+            getNeighbors(node, scratch);
+            if (scratch.empty()) return;
+            double cost = collapseCost(node, scratch[0]);
+            for (size_t i = 1; i < scratch.size(); ++i)
+            {
+                if (scratch[i] != scratch[i - 1]) cost = min(cost, collapseCost(node, scratch[i]));
+            }
+            pushNode(node, cost);
+        }
+
+        ///the cheapest neighbor the node can be moved onto, or -1
+        int32_t findTarget(const int32_t& node, double& costOut, vector<pair<double, int32_t> >& candidates, vector<int32_t>& scratch1, vector<int32_t>& scratch2) const
+        {
+            getNeighbors(node, scratch1);
+            candidates.clear();
+            for (size_t i = 0; i < scratch1.size(); ++i)
+            {
+                if (i == 0 || scratch1[i] != scratch1[i - 1]) candidates.push_back(make_pair(collapseCost(node, scratch1[i]), scratch1[i]));
+            }
+            sort(candidates.begin(), candidates.end());
+            for (size_t i = 0; i < candidates.size(); ++i)
+            {
+                if (isCollapseAllowed(node, candidates[i].second, scratch1, scratch2))
+                {
+                    costOut = candidates[i].first;
+                    return candidates[i].second;
+                }
+            }
+            return -1;
+        }
+
+        bool isCollapseAllowed(const int32_t& from, const int32_t& to, vector<int32_t>& scratch1, vector<int32_t>& scratch2) const
+        {
+            getNeighbors(from, scratch1);
+            getNeighbors(to, scratch2);
+            int shared = 0;
+            for (size_t i = 0; i < scratch1.size(); ++i)
+            {
+                if (scratch1[i] == to) ++shared;
+            }
+            if (shared != 2) return false;//edge must have exactly two triangles
+            scratch1.erase(unique(scratch1.begin(), scratch1.end()), scratch1.end());
+            scratch2.erase(unique(scratch2.begin(), scratch2.end()), scratch2.end());
+            int common = 0;
+            size_t i = 0, j = 0;
+            while (i < scratch1.size() && j < scratch2.size())
+            {
+                if (scratch1[i] < scratch2[j])
+                {
+                    ++i;
+                } else if (scratch2[j] < scratch1[i]) {
+                    ++j;
+                } else {
+                    ++common;
+                    ++i;
+                    ++j;
+                }
+            }
+            if (common != 2) return false;//link condition, otherwise the collapse would pinch the surface
+            const vector<int32_t>& myTris = m_nodeTris[from];
+            for (size_t t = 0; t < myTris.size(); ++t)
+            {
+                if (!m_triAlive[myTris[t]]) continue;
+                const int32_t* thisTri = m_tris.data() + myTris[t] * 3;
+                if (thisTri[0] == to || thisTri[1] == to || thisTri[2] == to) continue;//removed by the collapse
+                int32_t moved[3] = { thisTri[0], thisTri[1], thisTri[2] };
+                for (int k = 0; k < 3; ++k)
+                {
+                    if (moved[k] == from) moved[k] = to;
+                }
+                double before[3], after[3];
+                triangleNormal(m_coords, thisTri, before);
+                triangleNormal(m_coords, moved, after);
+                if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0) return false;//would flip or flatten a triangle
+            }
+            return true;
+        }
+
+        void collapse(const int32_t& from, const int32_t& to, vector<int32_t>& scratch)
+        {
+            vector<int32_t>& fromTris = m_nodeTris[from];
+            vector<int32_t>& toTris = m_nodeTris[to];
+            for (size_t t = 0; t < fromTris.size(); ++t)
+            {
+                int32_t triangle = fromTris[t];
+                if (!m_triAlive[triangle]) continue;
+                int32_t* thisTri = m_tris.data() + triangle * 3;
+                if (thisTri[0] == to || thisTri[1] == to || thisTri[2] == to)
+                {
+                    m_triAlive[triangle] = 0;
+                    --m_numAlive;
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        if (thisTri[k] != from && thisTri[k] != to) removeDeadTriangles(thisTri[k]);
+                    }
+                } else {
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        if (thisTri[k] == from) thisTri[k] = to;
+                    }
+                    toTris.push_back(triangle);
+                }
+            }
+            fromTris.clear();
+            removeDeadTriangles(to);
+            m_nodeAlive[from] = 0;
+            m_quadrics[to].add(m_quadrics[from]);
+            queueNode(to, scratch);
+            getNeighbors(to, m_changed);
+            m_changed.erase(unique(m_changed.begin(), m_changed.end()), m_changed.end());
+            for (size_t i = 0; i < m_changed.size(); ++i)
+            {//a neighbor's cost of moving onto this node only goes up, unless it is a new neighbor, in which case it may be lower than what is queued
+             //costs that went up are caught when the neighbor comes out of the queue
+                int32_t neighbor = m_changed[i];
+                if (m_nodeLocked[neighbor]) continue;
+                double cost = collapseCost(neighbor, to);
+                if (cost < m_queuedCost[neighbor]) pushNode(neighbor, cost);
+            }
+        }
+
+        void removeDeadTriangles(const int32_t& node)
+        {
+            vector<int32_t>& myTris = m_nodeTris[node];
+            size_t kept = 0;
+            for (size_t t = 0; t < myTris.size(); ++t)
+            {
+                if (m_triAlive[myTris[t]]) myTris[kept++] = myTris[t];
+            }
+            myTris.resize(kept);
+        }
+
+        void getAliveTriangles(vector<int32_t>& trianglesOut) const
+        {
+            trianglesOut.clear();
+            trianglesOut.reserve(m_numAlive * 3);
+            int64_t numTris = (int64_t)m_triAlive.size();
+            for (int64_t t = 0; t < numTris; ++t)
+            {
+                if (m_triAlive[t]) trianglesOut.insert(trianglesOut.end(), m_tris.begin() + t * 3, m_tris.begin() + t * 3 + 3);
+            }
+        }
+    };
+}
+
+SurfaceDecimationHelper::SurfaceDecimationHelper(const SurfaceFile* mySurf)
+{
+    CaretAssert(mySurf != NULL);
+    if (mySurf->getNumberOfTriangles() < 1) return;
+    decimate(mySurf->getNumberOfNodes(), mySurf->getCoordinateData(), mySurf->getNumberOfTriangles(), mySurf->getTriangle(0));
+}
+
+SurfaceDecimationHelper::SurfaceDecimationHelper(const int32_t& numNodes, const float* coords, const int32_t& numTris, const int32_t* triangles)
+{
+    decimate(numNodes, coords, numTris, triangles);
+}
+
+void SurfaceDecimationHelper::decimate(const int32_t& numNodes, const float* coords, const int32_t& numTris, const int32_t* triangles)
+{
+    if (numNodes < 1) return;
+    vector<int32_t> targets;
+    for (int32_t target = numTris / LEVEL_REDUCTION; target >= MIN_LEVEL_TRIANGLES; target /= LEVEL_REDUCTION)
+    {
+        targets.push_back(target);
+    }
+    if (targets.empty()) return;
+    DecimationMesh myMesh;
+    myMesh.m_coords = coords;
+    myMesh.m_tris.assign(triangles, triangles + numTris * 3);
+    myMesh.m_triAlive.assign(numTris, 1);
+    myMesh.m_nodeTris.resize(numNodes);
+    myMesh.m_quadrics.resize(numNodes);
+    myMesh.m_nodeLocked.assign(numNodes, 0);
+    myMesh.m_nodeAlive.assign(numNodes, 1);
+    myMesh.m_queuedCost.assign(numNodes, numeric_limits<double>::infinity());
+    myMesh.m_numAlive = numTris;
+    for (int32_t t = 0; t < numTris; ++t)
+    {
+        const int32_t* thisTri = myMesh.m_tris.data() + t * 3;
+        if (thisTri[0] == thisTri[1] || thisTri[1] == thisTri[2] || thisTri[0] == thisTri[2])
+        {//has no area, so it isn't drawn anyway
+            myMesh.m_triAlive[t] = 0;
+            --myMesh.m_numAlive;
+            continue;
+        }
+        double normal[3];
+        triangleNormal(myMesh.m_coords, thisTri, normal);
+        double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int j = 0; j < 3; ++j)
+        {
+            myMesh.m_nodeTris[thisTri[j]].push_back(t);
+        }
+        if (length > 0.0)
+        {
+            for (int j = 0; j < 3; ++j) normal[j] /= length;
+            const float* v0 = myMesh.m_coords + thisTri[0] * 3;
+            double offset = -(normal[0] * v0[0] + normal[1] * v0[1] + normal[2] * v0[2]);
+            for (int j = 0; j < 3; ++j)
+            {
+                myMesh.m_quadrics[thisTri[j]].addPlane(normal, offset, length / 2.0);//weight by area
+            }
+        }
+    }
+    vector<int32_t> scratch1, scratch2;
+    for (int32_t node = 0; node < numNodes; ++node)
+    {//every edge of an interior node is in exactly two triangles
+        myMesh.getNeighbors(node, scratch1);
+        if (scratch1.empty())
+        {
+            myMesh.m_nodeLocked[node] = 1;
+            continue;
+        }
+        size_t start = 0;
+        while (start < scratch1.size())
+        {
+            size_t end = start;
+            while (end < scratch1.size() && scratch1[end] == scratch1[start]) ++end;
+            if (end - start != 2)
+            {
+                myMesh.m_nodeLocked[node] = 1;
+                break;
+            }
+            start = end;
+        }
+    }
+    for (int32_t node = 0; node < numNodes; ++node)
+    {
+        myMesh.queueNode(node, scratch1);
+    }
+    vector<pair<double, int32_t> > candidates;
+    int64_t previousCount = myMesh.m_numAlive;
+    size_t nextTarget = 0;
+    while (nextTarget < targets.size())
+    {
+        if (myMesh.m_numAlive <= targets[nextTarget])
+        {
+            m_levelTriangles.push_back(vector<int32_t>());
+            myMesh.getAliveTriangles(m_levelTriangles.back());
+            previousCount = myMesh.m_numAlive;
+            ++nextTarget;
+            continue;
+        }
+        if (myMesh.m_queue.empty())
+        {//ran out of allowed collapses, keep the result only if it is a useful reduction
+            if (myMesh.m_numAlive < previousCount * 3 / 4)
+            {
+                m_levelTriangles.push_back(vector<int32_t>());
+                myMesh.getAliveTriangles(m_levelTriangles.back());
+            }
+            break;
+        }
+        Collapse myCollapse = myMesh.m_queue.top();
+        myMesh.m_queue.pop();
+        int32_t from = myCollapse.m_node;
+        if (!myMesh.m_nodeAlive[from] || myMesh.m_queuedCost[from] != myCollapse.m_cost) continue;//stale
+        double cost;
+        int32_t to = myMesh.findTarget(from, cost, candidates, scratch1, scratch2);
+        if (to < 0)
+        {//queued again when a neighbor collapses
+            myMesh.m_queuedCost[from] = numeric_limits<double>::infinity();
+            continue;
+        }
+        if (cost > myCollapse.m_cost)
+        {//cost went up since it was queued, something else may be cheaper now
+            myMesh.pushNode(from, cost);
+            continue;
+        }
+        myMesh.collapse(from, to, scratch1);
+    }
+}
+
+int32_t SurfaceDecimationHelper::getLevelNumberOfTriangles(const int32_t& level) const
+{
+    CaretAssertVectorIndex(m_levelTriangles, level);
+    return (int32_t)(m_levelTriangles[level].size() / 3);
+}
+
+const int32_t* SurfaceDecimationHelper::getLevelTriangles(const int32_t& level) const
+{
+    CaretAssertVectorIndex(m_levelTriangles, level);
+    return m_levelTriangles[level].data();
+}
+
+namespace
+{
+    class DecimationRunnable : public QRunnable
+    {
+        CaretPointer<SurfaceDecimationBuild> m_build;
+    public:
+        DecimationRunnable(const CaretPointer<SurfaceDecimationBuild>& build) : m_build(build) { }
+        void run() { m_build->run(); }
+    };
+}
+
+SurfaceDecimationBuild::SurfaceDecimationBuild(const SurfaceFile* mySurf)
+{
+    CaretAssert(mySurf != NULL);
+    m_numNodes = mySurf->getNumberOfNodes();
+    m_coords.assign(mySurf->getCoordinateData(), mySurf->getCoordinateData() + m_numNodes * 3);
+    if (mySurf->getNumberOfTriangles() > 0)
+    {
+        m_triangles.assign(mySurf->getTriangle(0), mySurf->getTriangle(0) + mySurf->getNumberOfTriangles() * 3);
+    }
+}
+
+CaretPointer<SurfaceDecimationBuild> SurfaceDecimationBuild::start(const SurfaceFile* mySurf)
+{
+    CaretPointer<SurfaceDecimationBuild> ret(new SurfaceDecimationBuild(mySurf));
+    QThreadPool::globalInstance()->start(new DecimationRunnable(ret));//the pool deletes the runnable when it finishes
+    return ret;
+}
+
+void SurfaceDecimationBuild::run()
+{
+    CaretPointer<SurfaceDecimationHelper> myHelper(new SurfaceDecimationHelper(m_numNodes, m_coords.data(), (int32_t)(m_triangles.size() / 3), m_triangles.data()));
+    vector<float>().swap(m_coords);//no longer needed
+    vector<int32_t>().swap(m_triangles);
+    CaretMutexLocker myLock(&m_helperMutex);
+    m_helper = myHelper;
+}
+
+CaretPointer<const SurfaceDecimationHelper> SurfaceDecimationBuild::getHelper() const
+{
+    CaretMutexLocker myLock(&m_helperMutex);
+    return m_helper;
+}
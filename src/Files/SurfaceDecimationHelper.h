@@ -0,0 +1,84 @@
+#ifndef __SURFACE_DECIMATION_HELPER_H__
+#define __SURFACE_DECIMATION_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CaretMutex.h"
+#include "CaretPointer.h"
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret
+{
+
+    class SurfaceFile;
+
+    ///coarser versions of a surface's triangles for drawing small views, made by quadric error edge collapses
+    ///each collapse moves a node onto one of its neighbors, so decimated triangles use the original node indices, and coordinates, normals and coloring of the full surface apply unchanged
+    class SurfaceDecimationHelper
+    {
+        std::vector<std::vector<int32_t> > m_levelTriangles;
+        void decimate(const int32_t& numNodes, const float* coords, const int32_t& numTris, const int32_t* triangles);
+    public:
+        ///levels are not made for surfaces with fewer triangles than this
+        static const int32_t MIN_LEVEL_TRIANGLES = 2000;
+
+        ///each level has about this fraction of the triangles of the previous one
+        static const int32_t LEVEL_REDUCTION = 4;
+
+        SurfaceDecimationHelper(const SurfaceFile* mySurf);
+
+        ///coords has 3 floats per node, triangles has 3 node indices per triangle
+        SurfaceDecimationHelper(const int32_t& numNodes, const float* coords, const int32_t& numTris, const int32_t* triangles);
+
+        ///number of decimated levels, level 0 has the most triangles, the full surface is not included
+        int32_t getNumberOfLevels() const { return (int32_t)m_levelTriangles.size(); }
+
+        int32_t getLevelNumberOfTriangles(const int32_t& level) const;
+
+        ///node indices of the level's triangles, three per triangle, in the winding of the full surface
+        const int32_t* getLevelTriangles(const int32_t& level) const;
+    };
+
+    ///builds a SurfaceDecimationHelper on a separate thread, from copies of the coordinates and triangles, so the surface can change or be deleted while it runs
+    class SurfaceDecimationBuild
+    {
+        int32_t m_numNodes;
+        std::vector<float> m_coords;
+        std::vector<int32_t> m_triangles;
+        mutable CaretMutex m_helperMutex;
+        CaretPointer<SurfaceDecimationHelper> m_helper;
+        SurfaceDecimationBuild(const SurfaceFile* mySurf);
+    public:
+        ///start building, the thread keeps its own reference to the build until it finishes
+        static CaretPointer<SurfaceDecimationBuild> start(const SurfaceFile* mySurf);
+
+        ///build the helper in the calling thread, called by the thread from start()
+        void run();
+
+        ///the finished helper, or NULL while it is being built
+        CaretPointer<const SurfaceDecimationHelper> getHelper() const;
+    };
+
+}
+
+#endif //__SURFACE_DECIMATION_HELPER_H__
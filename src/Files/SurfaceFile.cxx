@@ -24,6 +24,7 @@
 #include <QThread>
 
 #include "BoundingBox.h"
+#include "CaretMappableDataFile.h"
 #include "DataFileException.h"
 #include "DataFileTypeEnum.h"
 #include "SurfaceFile.h"
@@ -34,6 +35,7 @@
 #include "DescriptiveStatistics.h"
 #include "FastStatistics.h"
 #include "EventSurfaceColoringInvalidate.h"
+#include "GraphicsEngineData.h"
 
 #include "GiftiFile.h"
 #include "GiftiMetaDataXmlElements.h"
@@ -45,6 +47,8 @@
 #include "GeodesicHelper.h"
 #include "PlainTextStringBuilder.h"
 #include "SignedDistanceHelper.h"
+#include "SurfaceDecimationHelper.h"
+#include "SurfaceRayHelper.h"
 #include "TopologyHelper.h"
 
 using namespace caret;
@@ -53,10 +57,18 @@ using namespace caret;
  * Constructor.
  */
 SurfaceFile::SurfaceFile()
-: GiftiTypeFile(DataFileTypeEnum::SURFACE)
+: GiftiTypeFile(DataFileTypeEnum::SURFACE),
+m_nodeColoringModificationCounter(0),
+m_overlayLayerColoringUseCounter(0),
+m_geometryModificationCounter(0)
 {
     m_skipSanityCheck = false;//NOTE: this is NOT in the initializeMembersSurfaceFile method, because that method gets used at the top of the validate function,
                               //which is used by setNumberOfNodesAndTriangles, which temporarily puts it the triangles into an invalid state, which is why this flag exists
+    for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS; i++) {//not in initializeMembersSurfaceFile, modification counters must never go backwards
+        this->surfaceNodeColoringModifiedForBrowserTabs[i] = 0;
+        this->surfaceMontageNodeColoringModifiedForBrowserTabs[i] = 0;
+        this->wholeBrainNodeColoringModifiedForBrowserTabs[i] = 0;
+    }
     this->initializeMembersSurfaceFile();
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE);
 }
@@ -68,9 +80,17 @@ SurfaceFile::SurfaceFile()
  *     Surface file that is copied.
  */
 SurfaceFile::SurfaceFile(const SurfaceFile& sf)
-: GiftiTypeFile(sf), EventListenerInterface()
+: GiftiTypeFile(sf), EventListenerInterface(),
+m_nodeColoringModificationCounter(0),
+m_overlayLayerColoringUseCounter(0),
+m_geometryModificationCounter(0)
 {
     m_skipSanityCheck = false;//see above
+    for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS; i++) {//not in initializeMembersSurfaceFile, modification counters must never go backwards
+        this->surfaceNodeColoringModifiedForBrowserTabs[i] = 0;
+        this->surfaceMontageNodeColoringModifiedForBrowserTabs[i] = 0;
+        this->wholeBrainNodeColoringModifiedForBrowserTabs[i] = 0;
+    }
     this->initializeMembersSurfaceFile();
     this->copyHelperSurfaceFile(sf);
     EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE);
@@ -137,6 +157,7 @@ SurfaceFile::clear()
     GiftiTypeFile::clear();
     invalidateHelpers();
     this->invalidateNodeColoringForBrowserTabs();
+    this->invalidateOverlayLayerColoring(NULL);
 }
 
 /**
@@ -322,6 +343,7 @@ void SurfaceFile::setNumberOfNodesAndTriangles(const int32_t& nodes, const int32
     giftiFile->clearAndKeepMetadata();
     invalidateHelpers();
     this->invalidateNodeColoringForBrowserTabs();
+    this->invalidateOverlayLayerColoring(NULL);
     std::vector<int64_t> dims(2);
     dims[1] = 3;
     dims[0] = nodes;
@@ -525,6 +547,8 @@ SurfaceFile::initializeMembersSurfaceFile()
     m_geoHelperIndex = 0;
     m_topoHelperIndex = 0;
     m_normalsComputed = false;
+    m_overlayLayerColorings.clear();
+    ++m_geometryModificationCounter;
 }
 
 /**
@@ -565,6 +589,7 @@ void
 SurfaceFile::invalidateNormals()
 {
     m_normalsComputed = false;
+    ++m_geometryModificationCounter;
 }
 /**
  * Compute surface normals.
@@ -577,6 +602,7 @@ SurfaceFile::computeNormals()
         return;
     }
     m_normalsComputed = true;
+    ++m_geometryModificationCounter;
     int32_t numCoords = this->getNumberOfNodes();
     if (numCoords > 0) {
         this->normalVectors.resize(numCoords * 3);
@@ -884,6 +910,16 @@ void SurfaceFile::invalidateHelpers()
         CaretMutexLocker myLock3(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    if (m_rayHelper != NULL)
+    {
+        CaretMutexLocker myLock5(&m_rayHelperMutex);
+        m_rayHelper.grabNew(NULL);
+    }
+    if (m_decimationBuild != NULL)
+    {
+        CaretMutexLocker myLock6(&m_decimationBuildMutex);
+        m_decimationBuild.grabNew(NULL);//a build that is still running only finishes into its own copy
+    }
 }
 
 /**
@@ -989,6 +1025,8 @@ SurfaceFile::applyMatrix(const Matrix4x4& matrix)
         }
     }
     
+    invalidateNormals();
+    invalidateHelpers();
     computeNormals();
     
     setModified();
@@ -1188,6 +1226,29 @@ CaretPointer<const CaretPointLocator> SurfaceFile::getPointLocator() const
     return m_locator;
 }
 
+CaretPointer<const SurfaceRayHelper> SurfaceFile::getRayHelper() const
+{
+    if (m_rayHelper == NULL)
+    {
+        CaretMutexLocker myLock(&m_rayHelperMutex);
+        if (m_rayHelper == NULL)//test again AFTER lock to avoid race conditions
+        {
+            m_rayHelper.grabNew(new SurfaceRayHelper(this));
+        }
+    }
+    return m_rayHelper;
+}
+
+CaretPointer<const SurfaceDecimationHelper> SurfaceFile::getDecimationHelper() const
+{//building takes over a second for large surfaces, so it shouldn't stall drawing
+    CaretMutexLocker myLock(&m_decimationBuildMutex);
+    if (m_decimationBuild == NULL)
+    {
+        m_decimationBuild = SurfaceDecimationBuild::start(this);
+    }
+    return m_decimationBuild->getHelper();
+}
+
 void SurfaceFile::clearCachedHelpers() const
 {
     {
@@ -1212,6 +1273,14 @@ void SurfaceFile::clearCachedHelpers() const
         CaretMutexLocker locked(&m_locatorMutex);
         m_locator.grabNew(NULL);
     }
+    {
+        CaretMutexLocker locked(&m_rayHelperMutex);
+        m_rayHelper.grabNew(NULL);
+    }
+    {
+        CaretMutexLocker locked(&m_decimationBuildMutex);
+        m_decimationBuild.grabNew(NULL);
+    }
 }
 
 /**
@@ -1353,6 +1422,157 @@ SurfaceFile::invalidateNodeColoringForBrowserTabs()
     }    
 }
 
+/**
+ * Invalidate the coloring of overlay layers.
+ *
+ * @param mapFile
+ *    Only coloring from this map file, and coloring that depends upon
+ *    other files, is invalidated.  If NULL, all layer coloring is invalidated.
+ */
+void
+SurfaceFile::invalidateOverlayLayerColoring(const CaretMappableDataFile* mapFile)
+{
+    if (mapFile == NULL) {
+        m_overlayLayerColorings.clear();
+        return;
+    }
+    
+    std::vector<OverlayLayerColoring>::iterator validEnd = m_overlayLayerColorings.begin();
+    for (std::vector<OverlayLayerColoring>::iterator iter = m_overlayLayerColorings.begin();
+         iter != m_overlayLayerColorings.end();
+         iter++) {
+        if ((iter->m_mapFile != mapFile)
+            && ( ! iter->m_dependsOnOtherFilesFlag)) {
+            if (validEnd != iter) {
+                *validEnd = std::move(*iter);
+            }
+            ++validEnd;
+        }
+    }
+    m_overlayLayerColorings.erase(validEnd,
+                                  m_overlayLayerColorings.end());
+}
+
+/**
+ * Get the cached coloring of an overlay layer.
+ *
+ * @param mapFile
+ *    Map file in the overlay.
+ * @param mapIndex
+ *    Index of map in the overlay.
+ * @param browserTabIndex
+ *    Index of browser tab, or -1 if the coloring is the same in all tabs
+ *    of the display group.
+ * @param displayGroup
+ *    Display group used by the coloring.
+ * @param rgbvOut
+ *    Output with red, green, blue, valid for each node, or NULL if
+ *    the layer colors no nodes.  Only valid until the next call to
+ *    setOverlayLayerColoring().
+ * @return
+ *    True if the layer's coloring is cached, else false.
+ */
+bool
+SurfaceFile::getOverlayLayerColoring(const CaretMappableDataFile* mapFile,
+                                     const int32_t mapIndex,
+                                     const int32_t browserTabIndex,
+                                     const DisplayGroupEnum::Enum displayGroup,
+                                     const float*& rgbvOut)
+{
+    rgbvOut = NULL;
+    
+    CaretAssert(mapFile);
+    const AString mapUniqueID = mapFile->getMapUniqueID(mapIndex);
+    for (std::vector<OverlayLayerColoring>::iterator iter = m_overlayLayerColorings.begin();
+         iter != m_overlayLayerColorings.end();
+         iter++) {
+        if ((iter->m_mapFile == mapFile)
+            && (iter->m_mapIndex == mapIndex)
+            && (iter->m_browserTabIndex == browserTabIndex)
+            && (iter->m_displayGroup == displayGroup)
+            && (iter->m_mapUniqueID == mapUniqueID)) {
+            if (( ! iter->m_rgbv.empty())
+                && (static_cast<int64_t>(iter->m_rgbv.size()) != (static_cast<int64_t>(this->getNumberOfNodes()) * 4))) {
+                /*
+                 * Coloring is for a different number of nodes
+                 */
+                CaretAssertMessage(0, "Cached overlay layer coloring does not match the number of nodes");
+                m_overlayLayerColorings.erase(iter);
+                return false;
+            }
+            ++m_overlayLayerColoringUseCounter;
+            iter->m_lastUsed = m_overlayLayerColoringUseCounter;
+            if ( ! iter->m_rgbv.empty()) {
+                rgbvOut = &iter->m_rgbv[0];
+            }
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/**
+ * Cache the coloring of an overlay layer.  When the number of cached
+ * layers reaches a limit, the least recently used layer is removed.
+ *
+ * @param mapFile
+ *    Map file in the overlay.
+ * @param mapIndex
+ *    Index of map in the overlay.
+ * @param browserTabIndex
+ *    Index of browser tab, or -1 if the coloring is the same in all tabs
+ *    of the display group.
+ * @param displayGroup
+ *    Display group used by the coloring.
+ * @param dependsOnOtherFilesFlag
+ *    True if the coloring also depends upon other map files.
+ * @param rgbv
+ *    Red, green, blue, valid for each node, or NULL if the layer
+ *    colors no nodes.
+ */
+void
+SurfaceFile::setOverlayLayerColoring(const CaretMappableDataFile* mapFile,
+                                     const int32_t mapIndex,
+                                     const int32_t browserTabIndex,
+                                     const DisplayGroupEnum::Enum displayGroup,
+                                     const bool dependsOnOtherFilesFlag,
+                                     const float* rgbv)
+{
+    CaretAssert(mapFile);
+    
+    /*
+     * Each layer uses four floats per node so limit the memory used
+     */
+    const int32_t maximumNumberOfLayers = 32;
+    if (static_cast<int32_t>(m_overlayLayerColorings.size()) >= maximumNumberOfLayers) {
+        std::vector<OverlayLayerColoring>::iterator oldest = m_overlayLayerColorings.begin();
+        for (std::vector<OverlayLayerColoring>::iterator iter = m_overlayLayerColorings.begin();
+             iter != m_overlayLayerColorings.end();
+             iter++) {
+            if (iter->m_lastUsed < oldest->m_lastUsed) {
+                oldest = iter;
+            }
+        }
+        m_overlayLayerColorings.erase(oldest);
+    }
+    
+    OverlayLayerColoring layer;
+    layer.m_mapFile         = mapFile;
+    layer.m_mapUniqueID     = mapFile->getMapUniqueID(mapIndex);
+    layer.m_mapIndex        = mapIndex;
+    layer.m_browserTabIndex = browserTabIndex;
+    layer.m_displayGroup    = displayGroup;
+    layer.m_dependsOnOtherFilesFlag = dependsOnOtherFilesFlag;
+    ++m_overlayLayerColoringUseCounter;
+    layer.m_lastUsed = m_overlayLayerColoringUseCounter;
+    if (rgbv != NULL) {
+        layer.m_rgbv.assign(rgbv,
+                            rgbv + this->getNumberOfNodes() * 4);
+    }
+    m_overlayLayerColorings.push_back(std::move(layer));
+}
+
 /**
  * Allocate node coloring for a single surface in a browser tab.
  * @param browserTabIndex
@@ -1479,6 +1699,8 @@ SurfaceFile::setSurfaceNodeColoringRgbaForBrowserTab(const int32_t browserTabInd
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    ++m_nodeColoringModificationCounter;
+    this->surfaceNodeColoringModifiedForBrowserTabs[browserTabIndex] = m_nodeColoringModificationCounter;
 }
 
 /**
@@ -1526,6 +1748,8 @@ SurfaceFile::setSurfaceMontageNodeColoringRgbaForBrowserTab(const int32_t browse
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    ++m_nodeColoringModificationCounter;
+    this->surfaceMontageNodeColoringModifiedForBrowserTabs[browserTabIndex] = m_nodeColoringModificationCounter;
 }
 
 
@@ -1573,6 +1797,75 @@ SurfaceFile::setWholeBrainNodeColoringRgbaForBrowserTab(const int32_t browserTab
     for (int32_t i = 0; i < numberOfComponentsRGBA; i++) {
         rgba[i] = rgbaNodeColorComponents[i];
     }
+    ++m_nodeColoringModificationCounter;
+    this->wholeBrainNodeColoringModifiedForBrowserTabs[browserTabIndex] = m_nodeColoringModificationCounter;
+}
+
+/**
+ * Find which of the colorings is stored at the given memory so that
+ * graphics buffers containing the coloring can be kept between draws.
+ *
+ * @param rgba
+ *    Pointer returned by one of the get*NodeColoringRgbaForBrowserTab() methods.
+ * @param modificationCounterOut
+ *    Output containing a counter that changes whenever this coloring is set.
+ * @return
+ *    Non-negative identifier of the coloring, or negative if the
+ *    memory does not contain any of this surface's colorings.
+ */
+int32_t
+SurfaceFile::getNodeColoringRgbaIdentifier(const float* rgba,
+                                           uint64_t& modificationCounterOut) const
+{
+    modificationCounterOut = 0;
+    if (rgba == NULL) {
+        return -1;
+    }
+    
+    const int32_t numTabs = BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS;
+    for (int32_t i = 0; i < numTabs; i++) {
+        if (( ! this->surfaceNodeColoringForBrowserTabs[i].empty())
+            && (this->surfaceNodeColoringForBrowserTabs[i].data() == rgba)) {
+            modificationCounterOut = this->surfaceNodeColoringModifiedForBrowserTabs[i];
+            return i;
+        }
+        if (( ! this->surfaceMontageNodeColoringForBrowserTabs[i].empty())
+            && (this->surfaceMontageNodeColoringForBrowserTabs[i].data() == rgba)) {
+            modificationCounterOut = this->surfaceMontageNodeColoringModifiedForBrowserTabs[i];
+            return (numTabs + i);
+        }
+        if (( ! this->wholeBrainNodeColoringForBrowserTabs[i].empty())
+            && (this->wholeBrainNodeColoringForBrowserTabs[i].data() == rgba)) {
+            modificationCounterOut = this->wholeBrainNodeColoringModifiedForBrowserTabs[i];
+            return (numTabs * 2 + i);
+        }
+    }
+    
+    return -1;
+}
+
+/**
+ * @return Data the OpenGL graphics engine associated with
+ * this surface (may be NULL).
+ */
+GraphicsEngineData*
+SurfaceFile::getGraphicsEngineDataForOpenGL() const
+{
+    return m_graphicsEngineDataForOpenGL.get();
+}
+
+/**
+ * Set the data the OpenGL graphics engine associates with this surface.
+ * This surface takes ownership of the data.  The data is not copied
+ * when the surface is copied.
+ *
+ * @param graphicsEngineDataForOpenGL
+ *     The graphics engine data.
+ */
+void
+SurfaceFile::setGraphicsEngineDataForOpenGL(GraphicsEngineData* graphicsEngineDataForOpenGL) const
+{
+    m_graphicsEngineDataForOpenGL.reset(graphicsEngineDataForOpenGL);
 }
 
 /**
@@ -1592,6 +1885,7 @@ SurfaceFile::receiveEvent(Event* event)
         invalidateEvent->setEventProcessed();
         
         this->invalidateNodeColoringForBrowserTabs();
+        this->invalidateOverlayLayerColoring(invalidateEvent->getMapFile());
     }    
 }
 
@@ -22,12 +22,14 @@
  */
 /*LICENSE_END*/
 
+#include <memory>
 #include <vector>
 #include <stdint.h>
 
 #include "BrainConstants.h"
 #include "CaretMutex.h"
 #include "CaretPointer.h"
+#include "DisplayGroupEnum.h"
 #include "EventManager.h"
 #include "EventListenerInterface.h"
 #include "GiftiTypeFile.h"
@@ -36,16 +38,21 @@
 namespace caret {
 
     class BoundingBox;
+    class CaretMappableDataFile;
     class CaretPointLocator;
     class DescriptiveStatistics;
     class FastStatistics;
     class GeodesicHelper;
     class GeodesicHelperBase;
     class GiftiDataArray;
+    class GraphicsEngineData;
     class Matrix4x4;
     class PlainTextStringBuilder;
     class SignedDistanceHelper;
     class SignedDistanceHelperBase;
+    class SurfaceDecimationBuild;
+    class SurfaceDecimationHelper;
+    class SurfaceRayHelper;
     class TopologyHelper;
     class TopologyHelperBase;
     
@@ -138,6 +145,13 @@ namespace caret {
         
         CaretPointer<const CaretPointLocator> getPointLocator() const;
         
+        ///triangle hierarchy for finding where a segment (such as a pick ray) crosses the surface
+        CaretPointer<const SurfaceRayHelper> getRayHelper() const;
+        
+        ///coarser versions of the triangles, for drawing the surface when it is small on the screen
+        ///they are built on a separate thread, so this returns NULL until they are finished
+        CaretPointer<const SurfaceDecimationHelper> getDecimationHelper() const;
+        
         void clearCachedHelpers() const;
         
         const BoundingBox* getBoundingBox() const;
@@ -174,6 +188,31 @@ namespace caret {
         void setWholeBrainNodeColoringRgbaForBrowserTab(const int32_t browserTabIndex,
                                               const float* rgbaNodeColorComponents);
 
+        int32_t getNodeColoringRgbaIdentifier(const float* rgba,
+                                              uint64_t& modificationCounterOut) const;
+        
+        bool getOverlayLayerColoring(const CaretMappableDataFile* mapFile,
+                                     const int32_t mapIndex,
+                                     const int32_t browserTabIndex,
+                                     const DisplayGroupEnum::Enum displayGroup,
+                                     const float*& rgbvOut);
+        
+        void setOverlayLayerColoring(const CaretMappableDataFile* mapFile,
+                                     const int32_t mapIndex,
+                                     const int32_t browserTabIndex,
+                                     const DisplayGroupEnum::Enum displayGroup,
+                                     const bool dependsOnOtherFilesFlag,
+                                     const float* rgbv);
+        
+        /**
+         * @return Counter that changes whenever the coordinates or triangles may have changed.
+         */
+        uint64_t getGeometryModificationCounter() const { return m_geometryModificationCounter; }
+        
+        GraphicsEngineData* getGraphicsEngineDataForOpenGL() const;
+        
+        void setGraphicsEngineDataForOpenGL(GraphicsEngineData* graphicsEngineDataForOpenGL) const;
+        
         void invalidateNormals();
         
         void translateToCenterOfMass();
@@ -208,8 +247,36 @@ namespace caret {
         void initializeMembersSurfaceFile();
         
     private:
+        /**
+         * Coloring of one overlay layer (a map from a map file) before
+         * it is blended with the other overlays.
+         */
+        struct OverlayLayerColoring {
+            const CaretMappableDataFile* m_mapFile;
+            
+            AString m_mapUniqueID;
+            
+            int32_t m_mapIndex;
+            
+            /** Tab index, or -1 if the coloring is the same in all tabs of the display group */
+            int32_t m_browserTabIndex;
+            
+            DisplayGroupEnum::Enum m_displayGroup;
+            
+            /** Coloring may also depend upon other map files (file thresholding) */
+            bool m_dependsOnOtherFilesFlag;
+            
+            /** Value of m_overlayLayerColoringUseCounter when last used */
+            uint64_t m_lastUsed;
+            
+            /** Red, green, blue, valid for each node, empty if the layer colors no nodes */
+            std::vector<float> m_rgbv;
+        };
+        
         void invalidateNodeColoringForBrowserTabs();
         
+        void invalidateOverlayLayerColoring(const CaretMappableDataFile* mapFile);
+        
         void allocateSurfaceNodeColoringForBrowserTab(const int32_t browserTabIndex,
                                                       const bool zeroizeColorsFlag);
         
@@ -246,6 +313,30 @@ namespace caret {
          */
         std::vector<float> wholeBrainNodeColoringForBrowserTabs[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
         
+        /** Value of m_nodeColoringModificationCounter when each single surface coloring was set. */
+        uint64_t surfaceNodeColoringModifiedForBrowserTabs[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
+        
+        /** Value of m_nodeColoringModificationCounter when each surface montage coloring was set. */
+        uint64_t surfaceMontageNodeColoringModifiedForBrowserTabs[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
+        
+        /** Value of m_nodeColoringModificationCounter when each whole brain coloring was set. */
+        uint64_t wholeBrainNodeColoringModifiedForBrowserTabs[BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_TABS];
+        
+        /** Incremented each time any coloring is set */
+        uint64_t m_nodeColoringModificationCounter;
+        
+        /** Overlay layer coloring shared by all tabs and by single, montage, and whole brain coloring */
+        std::vector<OverlayLayerColoring> m_overlayLayerColorings;
+        
+        /** Incremented each time an overlay layer coloring is used */
+        uint64_t m_overlayLayerColoringUseCounter;
+        
+        /** Incremented each time the coordinates or triangles may have changed */
+        uint64_t m_geometryModificationCounter;
+        
+        /** Graphics buffers for drawing the surface, not copied */
+        mutable std::unique_ptr<GraphicsEngineData> m_graphicsEngineDataForOpenGL;
+        
         /** Points to memory containing the coordinates. */
         float* coordinatePointer;
         
@@ -292,12 +383,18 @@ namespace caret {
         ///used to search for the closest point in the surface
         mutable CaretPointer<CaretPointLocator> m_locator;
         
+        ///used to find where segments cross the surface
+        mutable CaretPointer<SurfaceRayHelper> m_rayHelper;
+        
+        ///used to draw the surface with fewer triangles
+        mutable CaretPointer<SurfaceDecimationBuild> m_decimationBuild;
+        
         ///used to track when the surface file gets changed
         void invalidateHelpers();
         
         mutable BoundingBox* boundingBox;
         
-        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex;
+        mutable CaretMutex m_topoHelperMutex, m_geoHelperMutex, m_locatorMutex, m_distHelperMutex, m_rayHelperMutex, m_decimationBuildMutex;
     };
 
 } // namespace
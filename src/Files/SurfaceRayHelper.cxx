@@ -0,0 +1,208 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "SurfaceRayHelper.h"
+
+#include "CaretAssert.h"
+#include "SurfaceFile.h"
+
+#include <algorithm>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    struct CentroidLess
+    {
+        const float* m_centroids;
+        int m_axis;
+        CentroidLess(const float* centroids, const int& axis) : m_centroids(centroids), m_axis(axis) { }
+        bool operator()(const int32_t& left, const int32_t& right) const
+        {
+            return m_centroids[left * 3 + m_axis] < m_centroids[right * 3 + m_axis];
+        }
+    };
+}
+
+SurfaceRayHelper::SurfaceRayHelper(const SurfaceFile* mySurf)
+{
+    CaretAssert(mySurf != NULL);
+    int32_t numNodes = mySurf->getNumberOfNodes();
+    int32_t numTris = mySurf->getNumberOfTriangles();
+    if (numNodes < 1 || numTris < 1) return;
+    m_coordList.assign(mySurf->getCoordinateData(), mySurf->getCoordinateData() + numNodes * 3);
+    m_triangleList.assign(mySurf->getTriangle(0), mySurf->getTriangle(0) + numTris * 3);
+    vector<float> centroids(numTris * 3);
+    m_triOrder.resize(numTris);
+    for (int32_t i = 0; i < numTris; ++i)
+    {
+        m_triOrder[i] = i;
+        const int32_t* thisTri = m_triangleList.data() + i * 3;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            centroids[i * 3 + axis] = (m_coordList[thisTri[0] * 3 + axis] + m_coordList[thisTri[1] * 3 + axis] + m_coordList[thisTri[2] * 3 + axis]) / 3.0f;
+        }
+    }
+    m_nodes.reserve(2 * (numTris / LEAF_SIZE) + 1);
+    m_nodes.resize(1);
+    vector<int32_t> stack;//triples of node index, first triangle, number of triangles
+    stack.push_back(0);
+    stack.push_back(0);
+    stack.push_back(numTris);
+    while (!stack.empty())
+    {
+        int32_t count = stack.back(); stack.pop_back();
+        int32_t first = stack.back(); stack.pop_back();
+        int32_t nodeIndex = stack.back(); stack.pop_back();
+        float boxMin[3], boxMax[3], centMin[3], centMax[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            boxMin[axis] = m_coordList[m_triangleList[m_triOrder[first] * 3] * 3 + axis];
+            boxMax[axis] = boxMin[axis];
+            centMin[axis] = centroids[m_triOrder[first] * 3 + axis];
+            centMax[axis] = centMin[axis];
+        }
+        for (int32_t i = first; i < first + count; ++i)
+        {
+            const int32_t* thisTri = m_triangleList.data() + m_triOrder[i] * 3;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                for (int j = 0; j < 3; ++j)
+                {
+                    float coord = m_coordList[thisTri[j] * 3 + axis];
+                    if (coord < boxMin[axis]) boxMin[axis] = coord;
+                    if (coord > boxMax[axis]) boxMax[axis] = coord;
+                }
+                float cent = centroids[m_triOrder[i] * 3 + axis];
+                if (cent < centMin[axis]) centMin[axis] = cent;
+                if (cent > centMax[axis]) centMax[axis] = cent;
+            }
+        }
+        int splitAxis = 0;
+        for (int axis = 1; axis < 3; ++axis)
+        {
+            if (centMax[axis] - centMin[axis] > centMax[splitAxis] - centMin[splitAxis]) splitAxis = axis;
+        }
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            m_nodes[nodeIndex].m_min[axis] = boxMin[axis];
+            m_nodes[nodeIndex].m_max[axis] = boxMax[axis];
+        }
+        if (count <= LEAF_SIZE || centMax[splitAxis] <= centMin[splitAxis])//also stop if all centroids are the same, splitting can't help
+        {
+            m_nodes[nodeIndex].m_first = first;
+            m_nodes[nodeIndex].m_count = count;
+            continue;
+        }
+        int32_t half = count / 2;
+        nth_element(m_triOrder.begin() + first, m_triOrder.begin() + first + half, m_triOrder.begin() + first + count, CentroidLess(centroids.data(), splitAxis));
+        int32_t childIndex = (int32_t)m_nodes.size();
+        m_nodes.resize(childIndex + 2);//invalidates references, so only use indices above
+        m_nodes[nodeIndex].m_first = childIndex;
+        m_nodes[nodeIndex].m_count = 0;
+        stack.push_back(childIndex);
+        stack.push_back(first);
+        stack.push_back(half);
+        stack.push_back(childIndex + 1);
+        stack.push_back(first + half);
+        stack.push_back(count - half);
+    }
+}
+
+bool SurfaceRayHelper::segmentHitsBox(const BoxNode& node, const double start[3], const double invDelta[3]) const
+{
+    double tmin = 0.0, tmax = 1.0;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (invDelta[axis] == 0.0)//segment doesn't move on this axis
+        {
+            if (start[axis] < node.m_min[axis] || start[axis] > node.m_max[axis]) return false;
+        } else {
+            double t1 = (node.m_min[axis] - start[axis]) * invDelta[axis];
+            double t2 = (node.m_max[axis] - start[axis]) * invDelta[axis];
+            if (t1 > t2) swap(t1, t2);
+            if (t1 > tmin) tmin = t1;
+            if (t2 < tmax) tmax = t2;
+            if (tmin > tmax) return false;
+        }
+    }
+    return true;
+}
+
+void SurfaceRayHelper::getSegmentHits(const float start[3], const float end[3], vector<Hit>& hitsOut) const
+{
+    hitsOut.clear();
+    if (m_nodes.empty()) return;
+    double dstart[3], delta[3], invDelta[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        dstart[axis] = start[axis];
+        delta[axis] = (double)end[axis] - start[axis];
+        invDelta[axis] = (delta[axis] != 0.0) ? 1.0 / delta[axis] : 0.0;
+    }
+    vector<int32_t> stack(1, 0);
+    while (!stack.empty())
+    {
+        const BoxNode& node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!segmentHitsBox(node, dstart, invDelta)) continue;
+        if (node.m_count == 0)
+        {
+            stack.push_back(node.m_first);
+            stack.push_back(node.m_first + 1);
+            continue;
+        }
+        for (int32_t i = node.m_first; i < node.m_first + node.m_count; ++i)
+        {//Moller-Trumbore, accepting either winding
+            int32_t triangle = m_triOrder[i];
+            const int32_t* thisTri = m_triangleList.data() + triangle * 3;
+            const float* v0 = m_coordList.data() + thisTri[0] * 3;
+            const float* v1 = m_coordList.data() + thisTri[1] * 3;
+            const float* v2 = m_coordList.data() + thisTri[2] * 3;
+            double e1[3] = { (double)v1[0] - v0[0], (double)v1[1] - v0[1], (double)v1[2] - v0[2] };
+            double e2[3] = { (double)v2[0] - v0[0], (double)v2[1] - v0[1], (double)v2[2] - v0[2] };
+            double p[3] = { delta[1] * e2[2] - delta[2] * e2[1], delta[2] * e2[0] - delta[0] * e2[2], delta[0] * e2[1] - delta[1] * e2[0] };
+            double det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+            if (det == 0.0) continue;//segment is parallel to the triangle
+            double invDet = 1.0 / det;
+            double s[3] = { dstart[0] - v0[0], dstart[1] - v0[1], dstart[2] - v0[2] };
+            double u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * invDet;
+            if (u < 0.0 || u > 1.0) continue;
+            double q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+            double v = (delta[0] * q[0] + delta[1] * q[1] + delta[2] * q[2]) * invDet;
+            if (v < 0.0 || u + v > 1.0) continue;
+            double t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * invDet;
+            if (t < 0.0 || t > 1.0) continue;
+            Hit thisHit;
+            thisHit.triangle = triangle;
+            thisHit.fraction = (float)t;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                thisHit.point[axis] = (float)(dstart[axis] + t * delta[axis]);
+            }
+            thisHit.baryWeights[0] = (float)(1.0 - u - v);
+            thisHit.baryWeights[1] = (float)u;
+            thisHit.baryWeights[2] = (float)v;
+            hitsOut.push_back(thisHit);
+        }
+    }
+    sort(hitsOut.begin(), hitsOut.end());
+}
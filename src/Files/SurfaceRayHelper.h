@@ -0,0 +1,65 @@
+#ifndef __SURFACE_RAY_HELPER_H__
+#define __SURFACE_RAY_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+#include <vector>
+
+namespace caret
+{
+
+    class SurfaceFile;
+
+    ///bounding volume hierarchy over the triangles of a surface, for finding where a line segment (such as a pick ray) crosses the surface
+    ///copies what it needs from the SurfaceFile, and all queries are const, so it can be shared between threads
+    class SurfaceRayHelper
+    {
+        struct BoxNode
+        {
+            float m_min[3], m_max[3];
+            int32_t m_first;//leaf: first index into m_triOrder, otherwise: index of first child (second child is next)
+            int32_t m_count;//leaf: number of triangles, 0 for non-leaf
+        };
+        static const int32_t LEAF_SIZE = 4;
+        std::vector<float> m_coordList;
+        std::vector<int32_t> m_triangleList;
+        std::vector<int32_t> m_triOrder;
+        std::vector<BoxNode> m_nodes;
+        bool segmentHitsBox(const BoxNode& node, const double start[3], const double invDelta[3]) const;
+    public:
+        struct Hit
+        {
+            int32_t triangle;
+            float fraction;//position along the segment, 0 at start, 1 at end
+            float point[3];
+            float baryWeights[3];//weights of the triangle's three nodes, in triangle order
+            bool operator<(const Hit& rhs) const { return fraction < rhs.fraction; }
+        };
+        SurfaceRayHelper(const SurfaceFile* mySurf);
+
+        ///all crossings of triangles (either side) by the segment from start to end, sorted from start to end
+        void getSegmentHits(const float start[3], const float end[3], std::vector<Hit>& hitsOut) const;
+    };
+
+}
+
+#endif //__SURFACE_RAY_HELPER_H__
@@ -28,22 +28,31 @@
 #include "CaretAssert.h"
 #include "CaretException.h"
 #include "CaretOMP.h"
+#include "DataFileException.h"
 #include "GeodesicHelper.h"
 #include "SignedDistanceHelper.h"
+#include "SparseWeightsFile.h"
 #include "SurfaceFile.h"
 #include "TopologyHelper.h"
 #include "Vector3D.h"
 
-#include <set>
+#include <algorithm>
 #include <map>
 
 using namespace std;
 using namespace caret;
 
+namespace
+{
+    const char RESAMPLE_WEIGHTS_MAGIC[] = "\0\0\0\0srw\0";
+    const int32_t RESAMPLE_WEIGHTS_VERSION = 2;
+}
+
 SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
                                                  const float* currentAreas, const float* newAreas, const float* currentRoi)
 {
     if (!checkSphere(currentSphere) || !checkSphere(newSphere)) throw CaretException("input surfaces to SurfaceResamplingHelper must be spheres");
+    m_numCurrentNodes = currentSphere->getNumberOfNodes();
     SurfaceFile currentSphereMod, newSphereMod;
     changeRadius(100.0f, currentSphere, &currentSphereMod);
     changeRadius(100.0f, newSphere, &newSphereMod);
@@ -62,17 +71,17 @@ SurfaceResamplingHelper::SurfaceResamplingHelper(const SurfaceResamplingMethodEn
 
 void SurfaceResamplingHelper::resampleNormal(const float* input, float* output, const float& invalidVal) const
 {
-    int numNodes = (int)m_weights.size() - 1;
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int i = 0; i < numNodes; ++i)
+    int64_t numNodes = m_weights.getNumRows();
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < numNodes; ++i)
     {
-        WeightElem* end = m_weights[i + 1], *elem = m_weights[i];
+        int64_t end = m_weights.start[i + 1], elem = m_weights.start[i];
         if (elem != end)
         {
             double accum = 0.0;
             for (; elem != end; ++elem)
             {
-                accum += input[elem->node] * elem->weight;//don't need to divide afterwards, because the weights already sum to 1
+                accum += input[m_weights.nodes[elem]] * m_weights.weights[elem];//don't need to divide afterwards, because the weights already sum to 1
             }
             output[i] = accum;
         } else {
@@ -81,22 +90,78 @@ void SurfaceResamplingHelper::resampleNormal(const float* input, float* output,
     }
 }
 
+void SurfaceResamplingHelper::resampleNormal(const vector<const float*>& inputs, const vector<float*>& outputs, const float& invalidVal) const
+{
+    CaretAssert(inputs.size() == outputs.size());
+    const int64_t numMaps = (int64_t)inputs.size();
+    if (numMaps == 0) return;
+    const int64_t numNodes = m_weights.getNumRows();
+    const int BLOCK = 16;//maps per pass
+    //gather a block of maps into node-major order, so each weight reads a contiguous run of values instead of one value from each map
+    vector<float> gathered(m_numCurrentNodes * BLOCK, 0.0f);
+    for (int64_t blockStart = 0; blockStart < numMaps; blockStart += BLOCK)
+    {
+        int blockSize = (int)min((int64_t)BLOCK, numMaps - blockStart);
+#pragma omp CARET_PARFOR schedule(static)
+        for (int64_t node = 0; node < m_numCurrentNodes; ++node)
+        {
+            float* dest = gathered.data() + node * BLOCK;
+            for (int m = 0; m < blockSize; ++m)
+            {
+                dest[m] = inputs[blockStart + m][node];
+            }
+        }
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+        for (int64_t i = 0; i < numNodes; ++i)
+        {
+            int64_t end = m_weights.start[i + 1], elem = m_weights.start[i];
+            if (elem != end)
+            {
+                double accum[BLOCK];
+                for (int m = 0; m < BLOCK; ++m)
+                {
+                    accum[m] = 0.0;
+                }
+                for (; elem != end; ++elem)
+                {
+                    const float thisWeight = m_weights.weights[elem];
+                    const float* src = gathered.data() + m_weights.nodes[elem] * (int64_t)BLOCK;
+                    for (int m = 0; m < BLOCK; ++m)//full width so it vectorizes, extra lanes are never written out
+                    {
+                        accum[m] += src[m] * thisWeight;//same operation order as the single map version, so results are identical
+                    }
+                }
+                for (int m = 0; m < blockSize; ++m)
+                {
+                    outputs[blockStart + m][i] = accum[m];
+                }
+            } else {
+                for (int m = 0; m < blockSize; ++m)
+                {
+                    outputs[blockStart + m][i] = invalidVal;
+                }
+            }
+        }
+    }
+}
+
 void SurfaceResamplingHelper::resample3DCoord(const float* input, float* output) const
 {
-    int numNodes = (int)m_weights.size() - 1;
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int i = 0; i < numNodes; ++i)
+    int64_t numNodes = m_weights.getNumRows();
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < numNodes; ++i)
     {
         double tempvec[3] = { 0.0, 0.0, 0.0 };
-        WeightElem* end = m_weights[i + 1];
-        for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+        int64_t end = m_weights.start[i + 1];
+        for (int64_t elem = m_weights.start[i]; elem != end; ++elem)
         {
-            const float* coord = input + elem->node * 3;
-            tempvec[0] += coord[0] * elem->weight;//don't need to divide afterwards, because the weights already sum to 1
-            tempvec[1] += coord[1] * elem->weight;
-            tempvec[2] += coord[2] * elem->weight;
+            const float* coord = input + m_weights.nodes[elem] * 3;
+            const float thisWeight = m_weights.weights[elem];
+            tempvec[0] += coord[0] * thisWeight;//don't need to divide afterwards, because the weights already sum to 1
+            tempvec[1] += coord[1] * thisWeight;
+            tempvec[2] += coord[2] * thisWeight;
         }
-        int i3 = i * 3;
+        int64_t i3 = i * 3;
         output[i3] = tempvec[0];
         output[i3 + 1] = tempvec[1];
         output[i3 + 2] = tempvec[2];
@@ -105,28 +170,29 @@ void SurfaceResamplingHelper::resample3DCoord(const float* input, float* output)
 
 void SurfaceResamplingHelper::resamplePopular(const int32_t* input, int32_t* output, const int32_t& invalidVal) const
 {
-    int numNodes = (int)m_weights.size() - 1;
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int i = 0; i < numNodes; ++i)
+    int64_t numNodes = m_weights.getNumRows();
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < numNodes; ++i)
     {
         map<int32_t, float> accum;
         float maxweight = -1.0f;
         int32_t bestlabel = invalidVal;
-        WeightElem* end = m_weights[i + 1];
-        for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+        int64_t end = m_weights.start[i + 1];
+        for (int64_t elem = m_weights.start[i]; elem != end; ++elem)
         {
-            int32_t label = input[elem->node];
+            int32_t label = input[m_weights.nodes[elem]];
+            const float thisWeight = m_weights.weights[elem];
             map<int, float>::iterator iter = accum.find(label);
             if (iter == accum.end())
             {
-                accum[label] = elem->weight;
-                if (elem->weight > maxweight)
+                accum[label] = thisWeight;
+                if (thisWeight > maxweight)
                 {
-                    maxweight = elem->weight;
+                    maxweight = thisWeight;
                     bestlabel = label;
                 }
             } else {
-                iter->second += elem->weight;
+                iter->second += thisWeight;
                 if (iter->second > maxweight)
                 {
                     maxweight = iter->second;
@@ -140,19 +206,19 @@ void SurfaceResamplingHelper::resamplePopular(const int32_t* input, int32_t* out
 
 void SurfaceResamplingHelper::resampleLargest(const float* input, float* output, const float& invalidVal) const
 {
-    int numNodes = (int)m_weights.size() - 1;
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int i = 0; i < numNodes; ++i)
+    int64_t numNodes = m_weights.getNumRows();
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < numNodes; ++i)
     {
-        WeightElem* end = m_weights[i + 1];
+        int64_t end = m_weights.start[i + 1];
         float largest = -1.0f;
         int largestNode = -1;
-        for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+        for (int64_t elem = m_weights.start[i]; elem != end; ++elem)
         {
-            if (elem->weight > largest)
+            if (m_weights.weights[elem] > largest)
             {
-                largest = elem->weight;
-                largestNode = elem->node;
+                largest = m_weights.weights[elem];
+                largestNode = m_weights.nodes[elem];
             }
         }
         if (largestNode != -1)
@@ -166,19 +232,19 @@ void SurfaceResamplingHelper::resampleLargest(const float* input, float* output,
 
 void SurfaceResamplingHelper::resampleLargest(const int32_t* input, int32_t* output, const int32_t& invalidVal) const
 {
-    int numNodes = (int)m_weights.size() - 1;
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int i = 0; i < numNodes; ++i)
+    int64_t numNodes = m_weights.getNumRows();
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t i = 0; i < numNodes; ++i)
     {
-        WeightElem* end = m_weights[i + 1];
+        int64_t end = m_weights.start[i + 1];
         float largest = -1.0f;
         int largestNode = -1;
-        for (WeightElem* elem = m_weights[i]; elem != end; ++elem)
+        for (int64_t elem = m_weights.start[i]; elem != end; ++elem)
         {
-            if (elem->weight > largest)
+            if (m_weights.weights[elem] > largest)
             {
-                largest = elem->weight;
-                largestNode = elem->node;
+                largest = m_weights.weights[elem];
+                largestNode = m_weights.nodes[elem];
             }
         }
         if (largestNode != -1)
@@ -192,10 +258,10 @@ void SurfaceResamplingHelper::resampleLargest(const int32_t* input, int32_t* out
 
 void SurfaceResamplingHelper::getResampleValidROI(float* output) const
 {
-    int numNodes = (int)m_weights.size() - 1;
-    for (int i = 0; i < numNodes; ++i)
+    int64_t numNodes = m_weights.getNumRows();
+    for (int64_t i = 0; i < numNodes; ++i)
     {
-        if (m_weights[i] != m_weights[i + 1])
+        if (m_weights.start[i] != m_weights.start[i + 1])
         {
             output[i] = 1.0f;
         } else {
@@ -204,6 +270,31 @@ void SurfaceResamplingHelper::getResampleValidROI(float* output) const
     }
 }
 
+void SurfaceResamplingHelper::writeWeightsFile(const AString& filename) const
+{
+    if (m_weights.getNumRows() == 0) throw DataFileException("no resampling weights to write");
+    SparseWeightsFile::writeFile(filename, RESAMPLE_WEIGHTS_MAGIC, RESAMPLE_WEIGHTS_VERSION, "resampling weights", m_numCurrentNodes,
+                                 m_weights.start, m_weights.nodes, m_weights.weights, vector<int64_t>(), vector<float>());
+}
+
+void SurfaceResamplingHelper::readWeightsFile(const AString& filename)
+{
+    WeightRows newWeights;//don't modify the existing weights if the file is bad
+    int64_t numCurrentNodes;
+    vector<int64_t> extraInts;
+    vector<float> extraFloats;
+    SparseWeightsFile::readFile(filename, RESAMPLE_WEIGHTS_MAGIC, RESAMPLE_WEIGHTS_VERSION, "resampling weights", numCurrentNodes,
+                                newWeights.start, newWeights.nodes, newWeights.weights, 0, extraInts, 0, extraFloats);
+    if (numCurrentNodes < 1 || newWeights.getNumRows() < 1)
+    {
+        throw DataFileException("impossible dimensions in resampling weights file");
+    }
+    m_weights.start.swap(newWeights.start);
+    m_weights.nodes.swap(newWeights.nodes);
+    m_weights.weights.swap(newWeights.weights);
+    m_numCurrentNodes = numCurrentNodes;
+}
+
 void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn, const SurfaceFile* currentSphere, const SurfaceFile* newSphere, SurfaceFile* surfaceOut)
 {
     if (cutSurfaceIn->getNumberOfNodes() != currentSphere->getNumberOfNodes()) throw CaretException("input surface has different number of nodes than input sphere");
@@ -401,91 +492,111 @@ void SurfaceResamplingHelper::resampleCutSurface(const SurfaceFile* cutSurfaceIn
 void SurfaceResamplingHelper::computeWeightsAdapBaryArea(const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
                                                          const float* currentAreas, const float* newAreas, const float* currentRoi)
 {
-    vector<map<int, float> > forward, reverse, reverse_gather;
+    WeightRows forward, reverse, reverse_gather;
     makeBarycentricWeights(currentSphere, newSphere, forward, NULL);//don't use an roi until after we have done area correction, because area correction MUST ignore ROI
     makeBarycentricWeights(newSphere, currentSphere, reverse, NULL);
-    int numNewNodes = (int)forward.size(), numOldNodes = currentSphere->getNumberOfNodes();
-    reverse_gather.resize(numNewNodes);
-    for (int oldNode = 0; oldNode < numOldNodes; ++oldNode)//this loop can't be parallelized
-    {
-        for (map<int, float>::iterator iter = reverse[oldNode].begin(); iter != reverse[oldNode].end(); ++iter)//convert scattering weights to gathering weights
-        {
-            reverse_gather[iter->first][oldNode] = iter->second;
-        }
-    }
-    vector<map<int, float> > adap_gather(numNewNodes);
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int newNode = 0; newNode < numNewNodes; ++newNode)
+    int64_t numNewNodes = forward.getNumRows(), numOldNodes = currentSphere->getNumberOfNodes();
+    transposeWeights(reverse, numNewNodes, reverse_gather);//convert scattering weights to gathering weights
+    WeightRows adap_gather;
+    vector<char> useforward(numNewNodes);//not vector<bool>, so it can be modified in parallel
+    adap_gather.start.resize(numNewNodes + 1);
+    adap_gather.start[0] = 0;
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t newNode = 0; newNode < numNewNodes; ++newNode)
     {
-        set<int> forwardused;//build set of all nodes used by forward weights (really only 3, but this is a bit cleaner and more generic)
-        for (map<int, float>::iterator iter = forward[newNode].begin(); iter != forward[newNode].end(); ++iter)
-        {
-            forwardused.insert(iter->first);
-        }
-        bool useforward = true;
-        for (map<int, float>::iterator iter = reverse_gather[newNode].begin(); iter != reverse_gather[newNode].end(); ++iter)
+        useforward[newNode] = 1;
+        for (int64_t r = reverse_gather.start[newNode]; r < reverse_gather.start[newNode + 1]; ++r)
         {
-            if (forwardused.find(iter->first) == forwardused.end())
+            bool found = false;//forward weights only have up to 3 entries, so just search them
+            for (int64_t f = forward.start[newNode]; f < forward.start[newNode + 1]; ++f)
+            {
+                if (forward.nodes[f] == reverse_gather.nodes[r])
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
             {
-                useforward = false;//if the reverse scatter weights include something the forward gather weights don't, use reverse scatter
+                useforward[newNode] = 0;//if the reverse scatter weights include something the forward gather weights don't, use reverse scatter
                 break;
             }
         }
-        if (useforward)
-        {
-            adap_gather[newNode] = forward[newNode];
-        } else {
-            adap_gather[newNode] = reverse_gather[newNode];
-        }
-        for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)//begin area correction by multiplying by target node area
+    }
+    for (int64_t newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        const WeightRows& source = useforward[newNode] ? forward : reverse_gather;
+        adap_gather.start[newNode + 1] = adap_gather.start[newNode] + source.start[newNode + 1] - source.start[newNode];
+    }
+    adap_gather.nodes.resize(adap_gather.start[numNewNodes]);
+    adap_gather.weights.resize(adap_gather.start[numNewNodes]);
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        const WeightRows& source = useforward[newNode] ? forward : reverse_gather;
+        int64_t dest = adap_gather.start[newNode];
+        for (int64_t s = source.start[newNode]; s < source.start[newNode + 1]; ++s, ++dest)
         {
-            iter->second *= newAreas[newNode];//begin the process of area correction by multiplying by gathering node areas
+            adap_gather.nodes[dest] = source.nodes[s];
+            adap_gather.weights[dest] = source.weights[s] * newAreas[newNode];//begin the process of area correction by multiplying by gathering node areas
         }
     }
     vector<float> correctionSum(numOldNodes, 0.0f);
-    for (int newNode = 0; newNode < numNewNodes; ++newNode)//this loop is separate because it can't be parallelized
+    int64_t numTotal = adap_gather.start[numNewNodes];
+    for (int64_t i = 0; i < numTotal; ++i)//this loop is separate because it can't be parallelized
     {
-        for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)
-        {
-            correctionSum[iter->first] += iter->second;//now, sum the scattering weights to prepare for first normalization
-        }
+        correctionSum[adap_gather.nodes[i]] += adap_gather.weights[i];//now, sum the scattering weights to prepare for first normalization
     }
-#pragma omp CARET_PARFOR schedule(dynamic)
-    for (int newNode = 0; newNode < numNewNodes; ++newNode)
+    vector<int64_t> keptCount(numNewNodes);
+#pragma omp CARET_PARFOR schedule(dynamic, 256)
+    for (int64_t newNode = 0; newNode < numNewNodes; ++newNode)
     {
         double weightsum = 0.0f;
-        vector<map<int, float>::iterator> toRemove;
-        for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)
+        int64_t end = adap_gather.start[newNode + 1], kept = adap_gather.start[newNode];
+        for (int64_t i = adap_gather.start[newNode]; i < end; ++i)
         {
-            if (currentRoi == NULL || currentRoi[iter->first] > 0.0f)
+            int32_t node = adap_gather.nodes[i];
+            if (currentRoi == NULL || currentRoi[node] > 0.0f)
             {
-                iter->second *= currentAreas[iter->first] / correctionSum[iter->first];//divide the weights by their scatter sum, then multiply by current areas
-                weightsum += iter->second;//and compute the sum
-            } else {
-                toRemove.push_back(iter);
+                adap_gather.weights[i] *= currentAreas[node] / correctionSum[node];//divide the weights by their scatter sum, then multiply by current areas
+                weightsum += adap_gather.weights[i];//and compute the sum
+                adap_gather.nodes[kept] = node;//shift the kept weights down over the removed ones, within this row
+                adap_gather.weights[kept] = adap_gather.weights[i];
+                ++kept;
             }
         }
-        int numToRemove = (int)toRemove.size();
-        for (int i = 0; i < numToRemove; ++i)
-        {
-            adap_gather[newNode].erase(toRemove[i]);
-        }
+        keptCount[newNode] = kept - adap_gather.start[newNode];
         if (weightsum != 0.0f)//this shouldn't happen unless no nodes remain due to roi, or node areas can be zero
         {
-            for (map<int, float>::iterator iter = adap_gather[newNode].begin(); iter != adap_gather[newNode].end(); ++iter)
+            for (int64_t i = adap_gather.start[newNode]; i < kept; ++i)
             {
-                iter->second /= weightsum;//and normalize to a sum of 1
+                adap_gather.weights[i] /= weightsum;//and normalize to a sum of 1
             }
         }
     }
-    compactWeights(adap_gather);//and compact them into the internal weight storage
+    m_weights.start.resize(numNewNodes + 1);//and compact them into the internal weight storage
+    m_weights.start[0] = 0;
+    for (int64_t newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        m_weights.start[newNode + 1] = m_weights.start[newNode] + keptCount[newNode];
+    }
+    m_weights.nodes.resize(m_weights.start[numNewNodes]);
+    m_weights.weights.resize(m_weights.start[numNewNodes]);
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t newNode = 0; newNode < numNewNodes; ++newNode)
+    {
+        int64_t source = adap_gather.start[newNode];
+        for (int64_t i = m_weights.start[newNode]; i < m_weights.start[newNode + 1]; ++i, ++source)
+        {
+            m_weights.nodes[i] = adap_gather.nodes[source];
+            m_weights.weights[i] = adap_gather.weights[source];
+        }
+    }
 }
 
 void SurfaceResamplingHelper::computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi)
 {
-    vector<map<int, float> > forward;
-    makeBarycentricWeights(currentSphere, newSphere, forward, currentRoi);//this should ensure they sum to 1, so we are done
-    compactWeights(forward);
+    makeBarycentricWeights(currentSphere, newSphere, m_weights, currentRoi);//this should ensure they sum to 1, so we are done
 }
 
 bool SurfaceResamplingHelper::checkSphere(const SurfaceFile* surface)
@@ -533,83 +644,117 @@ void SurfaceResamplingHelper::changeRadius(const float& radius, const SurfaceFil
     output->setCoordinates(newCoordData.data());
 }
 
-void SurfaceResamplingHelper::compactWeights(const vector<map<int, float> >& weights)
-{
-    int compactsize = 0;
-    int numNodes = (int)weights.size();
-    m_weights = CaretArray<WeightElem*>(numNodes + 1);//include a "one-after" pointer
-    for (int i = 0; i < numNodes; ++i)
+void SurfaceResamplingHelper::transposeWeights(const WeightRows& weights, const int64_t& numColumns, WeightRows& transposeOut)
+{//counting sort by column, rows are visited in increasing order, so each output row comes out sorted
+    int64_t numRows = weights.getNumRows(), numTotal = (int64_t)weights.nodes.size();
+    transposeOut.start.assign(numColumns + 1, 0);
+    for (int64_t i = 0; i < numTotal; ++i)
+    {
+        ++transposeOut.start[weights.nodes[i] + 1];
+    }
+    for (int64_t c = 0; c < numColumns; ++c)
     {
-        compactsize += (int)weights[i].size();
+        transposeOut.start[c + 1] += transposeOut.start[c];
     }
-    m_storagechunk = CaretArray<WeightElem>(compactsize);
-    int curpos = 0;
-    for (int i = 0; i < numNodes; ++i)
+    transposeOut.nodes.resize(numTotal);
+    transposeOut.weights.resize(numTotal);
+    vector<int64_t> position(transposeOut.start.begin(), transposeOut.start.end() - 1);
+    for (int64_t row = 0; row < numRows; ++row)
     {
-        m_weights[i] = m_storagechunk + curpos;
-        for (map<int, float>::const_iterator iter = weights[i].begin(); iter != weights[i].end(); ++iter)
+        for (int64_t i = weights.start[row]; i < weights.start[row + 1]; ++i)
         {
-            m_storagechunk[curpos] = WeightElem(iter->first, iter->second);
-            ++curpos;
+            int64_t dest = position[weights.nodes[i]]++;
+            transposeOut.nodes[dest] = (int32_t)row;
+            transposeOut.weights[dest] = weights.weights[i];
         }
     }
-    CaretAssert(curpos == compactsize);
-    m_weights[numNodes] = m_storagechunk + compactsize;
 }
 
-void SurfaceResamplingHelper::makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, vector<map<int, float> >& weights, const float* currentRoi)
+namespace
 {
-    int numToNodes = to->getNumberOfNodes();
-    weights.resize(numToNodes);
-    const float* toCoordData = to->getCoordinateData();
-    if (currentRoi == NULL)
+    struct BaryRow
     {
-#pragma omp CARET_PAR
-        {
-            CaretPointer<SignedDistanceHelper> mySignedHelp = from->getSignedDistanceHelper();
-#pragma omp CARET_FOR schedule(dynamic)
-            for (int i = 0; i < numToNodes; ++i)
+        int32_t nodes[3];
+        float weights[3];
+        int count;
+        void set(const int32_t& node, const float& weight)
+        {//keep sorted by node, and a repeated node replaces the earlier weight
+            int pos = 0;
+            while (pos < count && nodes[pos] < node) ++pos;
+            if (pos < count && nodes[pos] == node)
             {
-                BarycentricInfo myInfo;
-                mySignedHelp->barycentricWeights(toCoordData + i * 3, myInfo);
-                if (myInfo.baryWeights[0] != 0.0f) weights[i][myInfo.nodes[0]] = myInfo.baryWeights[0];
-                if (myInfo.baryWeights[1] != 0.0f) weights[i][myInfo.nodes[1]] = myInfo.baryWeights[1];
-                if (myInfo.baryWeights[2] != 0.0f) weights[i][myInfo.nodes[2]] = myInfo.baryWeights[2];
+                weights[pos] = weight;
+                return;
             }
+            for (int i = count; i > pos; --i)
+            {
+                nodes[i] = nodes[i - 1];
+                weights[i] = weights[i - 1];
+            }
+            nodes[pos] = node;
+            weights[pos] = weight;
+            ++count;
         }
-    } else {
+    };
+}
+
+void SurfaceResamplingHelper::makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, WeightRows& weights, const float* currentRoi)
+{
+    int numToNodes = to->getNumberOfNodes();
+    vector<BaryRow> rows(numToNodes);//at most 3 weights per node, so fill fixed size rows in parallel, then compact
+    const float* toCoordData = to->getCoordinateData();
 #pragma omp CARET_PAR
+    {
+        CaretPointer<SignedDistanceHelper> mySignedHelp = from->getSignedDistanceHelper();
+#pragma omp CARET_FOR schedule(dynamic, 64)
+        for (int i = 0; i < numToNodes; ++i)
         {
-            CaretPointer<SignedDistanceHelper> mySignedHelp = from->getSignedDistanceHelper();
-#pragma omp CARET_FOR schedule(dynamic)
-            for (int i = 0; i < numToNodes; ++i)
+            BarycentricInfo myInfo;
+            BaryRow& myRow = rows[i];
+            myRow.count = 0;
+            mySignedHelp->barycentricWeights(toCoordData + i * 3, myInfo);
+            if (currentRoi == NULL)
             {
-                BarycentricInfo myInfo;
-                float weightsum = 0.0f;//there are only 3 weights, so don't bother with double precision
-                mySignedHelp->barycentricWeights(toCoordData + i * 3, myInfo);
-                if (myInfo.baryWeights[0] != 0.0f && currentRoi[myInfo.nodes[0]] > 0.0f)
+                for (int j = 0; j < 3; ++j)
                 {
-                    weights[i][myInfo.nodes[0]] = myInfo.baryWeights[0];
-                    weightsum += myInfo.baryWeights[0];
+                    if (myInfo.baryWeights[j] != 0.0f) myRow.set(myInfo.nodes[j], myInfo.baryWeights[j]);
                 }
-                if (myInfo.baryWeights[1] != 0.0f && currentRoi[myInfo.nodes[1]] > 0.0f)
-                {
-                    weights[i][myInfo.nodes[1]] = myInfo.baryWeights[1];
-                    weightsum += myInfo.baryWeights[1];
-                }
-                if (myInfo.baryWeights[2] != 0.0f && currentRoi[myInfo.nodes[2]] > 0.0f)
+            } else {
+                float weightsum = 0.0f;//there are only 3 weights, so don't bother with double precision
+                for (int j = 0; j < 3; ++j)
                 {
-                    weights[i][myInfo.nodes[2]] = myInfo.baryWeights[2];
-                    weightsum += myInfo.baryWeights[2];
+                    if (myInfo.baryWeights[j] != 0.0f && currentRoi[myInfo.nodes[j]] > 0.0f)
+                    {
+                        myRow.set(myInfo.nodes[j], myInfo.baryWeights[j]);
+                        weightsum += myInfo.baryWeights[j];
+                    }
                 }
                 if (weightsum != 0.0f)
                 {
-                    for (map<int, float>::iterator iter = weights[i].begin(); iter != weights[i].end(); ++iter)
+                    for (int j = 0; j < myRow.count; ++j)
                     {
-                        iter->second /= weightsum;
+                        myRow.weights[j] /= weightsum;
                     }
                 }
             }
         }
     }
+    weights.start.resize(numToNodes + 1);
+    weights.start[0] = 0;
+    for (int i = 0; i < numToNodes; ++i)
+    {
+        weights.start[i + 1] = weights.start[i] + rows[i].count;
+    }
+    weights.nodes.resize(weights.start[numToNodes]);
+    weights.weights.resize(weights.start[numToNodes]);
+#pragma omp CARET_PARFOR schedule(static)
+    for (int i = 0; i < numToNodes; ++i)
+    {
+        int64_t base = weights.start[i];
+        for (int j = 0; j < rows[i].count; ++j)
+        {
+            weights.nodes[base + j] = rows[i].nodes[j];
+            weights.weights[base + j] = rows[i].weights[j];
+        }
+    }
 }
@@ -21,10 +21,10 @@
  */
 /*LICENSE_END*/
 
-#include "CaretPointer.h"
+#include "AString.h"
 #include "SurfaceResamplingMethodEnum.h"
 
-#include <map>
+#include "stdint.h"
 #include <vector>
 
 namespace caret {
@@ -33,27 +33,30 @@ namespace caret {
     
     class SurfaceResamplingHelper
     {
-        struct WeightElem
+        ///compressed sparse row weights, the weights for row i are elements start[i] to start[i + 1] - 1, sorted by increasing node
+        struct WeightRows
         {
-            int node;
-            float weight;
-            WeightElem() { }
-            WeightElem(const int& nodeIn, const float& weightIn) : node(nodeIn), weight(weightIn) { }
+            std::vector<int64_t> start;
+            std::vector<int32_t> nodes;
+            std::vector<float> weights;
+            int64_t getNumRows() const { return start.empty() ? 0 : (int64_t)start.size() - 1; }
         };
-        CaretArray<WeightElem> m_storagechunk;
-        CaretArray<WeightElem*> m_weights;
+        WeightRows m_weights;
+        int64_t m_numCurrentNodes;
         static bool checkSphere(const SurfaceFile* surface);
         static void changeRadius(const float& radius, const SurfaceFile* input, SurfaceFile* output);
         void computeWeightsAdapBaryArea(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentAreas, const float* newAreas, const float* currentRoi);
         void computeWeightsBarycentric(const SurfaceFile* currentSphere, const SurfaceFile* newSphere, const float* currentRoi);
-        static void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, std::vector<std::map<int, float> >& weights, const float* currentRoi);
-        void compactWeights(const std::vector<std::map<int, float> >& weights);
+        static void makeBarycentricWeights(const SurfaceFile* from, const SurfaceFile* to, WeightRows& weights, const float* currentRoi);
+        static void transposeWeights(const WeightRows& weights, const int64_t& numColumns, WeightRows& transposeOut);
     public:
-        SurfaceResamplingHelper() { }
+        SurfaceResamplingHelper() { m_numCurrentNodes = 0; }
         SurfaceResamplingHelper(const SurfaceResamplingMethodEnum::Enum& myMethod, const SurfaceFile* currentSphere, const SurfaceFile* newSphere,
                                 const float* currentAreas = NULL, const float* newAreas = NULL, const float* currentRoi = NULL);
         ///resample real-valued data by means of weights
         void resampleNormal(const float* input, float* output, const float& invalidVal = 0.0f) const;
+        ///resample many maps in one pass over the weights, each input must have getNumberOfCurrentNodes() elements, each output getNumberOfNewNodes()
+        void resampleNormal(const std::vector<const float*>& inputs, const std::vector<float*>& outputs, const float& invalidVal = 0.0f) const;
         ///resample 3D coordinate data by means of weights
         void resample3DCoord(const float* input, float* output) const;
         ///resample label-like data according to which value gets the largest weight sum
@@ -65,6 +68,12 @@ namespace caret {
         ///get the ROI of nodes that have data within the input ROI
         void getResampleValidROI(float* output) const;
         
+        int64_t getNumberOfCurrentNodes() const { return m_numCurrentNodes; }
+        int64_t getNumberOfNewNodes() const { return m_weights.getNumRows(); }
+        ///save the weights (including any area correction and roi), so they can be reused without the spheres
+        void writeWeightsFile(const AString& filename) const;
+        void readWeightsFile(const AString& filename);
+        
         ///resample a cut surface - not something you will apply multiple times, so static method
         static void resampleCutSurface(const SurfaceFile* cutSurfaceIn, const SurfaceFile* curSphere, const SurfaceFile* newSphere, SurfaceFile* surfaceOut);
     };
@@ -0,0 +1,264 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "TFCEHelper.h"
+
+#include "CaretAssert.h"
+#include "CaretException.h"
+#include "CaretOMP.h"
+#include "TopologyHelper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    struct DescendingValue
+    {
+        bool operator()(const pair<float, int32_t>& left, const pair<float, int32_t>& right) const
+        {
+            if (left.first != right.first) return left.first > right.first;
+            return left.second < right.second;
+        }
+    };
+}
+
+TFCEHelper::TFCEHelper(const TopologyHelper* myTopoHelp, const float* areaData, const float* roiData, const float& param_e, const float& param_h)
+{
+    CaretAssert(myTopoHelp != NULL && areaData != NULL);
+    m_isVolume = false;
+    m_numElements = myTopoHelp->getNumberOfNodes();
+    m_dims[0] = 0; m_dims[1] = 0; m_dims[2] = 0;
+    m_param_e = param_e;
+    m_param_h = param_h;
+    m_uniformWeight = 0.0f;
+    m_weights.assign(areaData, areaData + m_numElements);
+    if (roiData != NULL)
+    {
+        m_roi.resize(m_numElements);
+        for (int64_t i = 0; i < m_numElements; ++i)
+        {
+            m_roi[i] = (roiData[i] > 0.0f) ? 1 : 0;
+        }
+    }
+    m_neighStart.resize(m_numElements + 1);
+    m_neighStart[0] = 0;
+    for (int32_t i = 0; i < (int32_t)m_numElements; ++i)
+    {
+        const vector<int32_t>& neighbors = myTopoHelp->getNodeNeighbors(i);
+        m_neighbors.insert(m_neighbors.end(), neighbors.begin(), neighbors.end());
+        m_neighStart[i + 1] = (int64_t)m_neighbors.size();
+    }
+}
+
+TFCEHelper::TFCEHelper(const int64_t dims[3], const float& voxelVolume, const float* roiFrame, const float& param_e, const float& param_h)
+{
+    m_isVolume = true;
+    m_dims[0] = dims[0]; m_dims[1] = dims[1]; m_dims[2] = dims[2];
+    m_numElements = dims[0] * dims[1] * dims[2];
+    if (m_numElements > numeric_limits<int32_t>::max())
+    {
+        throw CaretException("volume has too many voxels for TFCE");
+    }
+    m_param_e = param_e;
+    m_param_h = param_h;
+    m_uniformWeight = voxelVolume;
+    if (roiFrame != NULL)
+    {
+        m_roi.resize(m_numElements);
+        for (int64_t i = 0; i < m_numElements; ++i)
+        {
+            m_roi[i] = (roiFrame[i] > 0.0f) ? 1 : 0;
+        }
+    }
+}
+
+int32_t TFCEHelper::findRoot(Scratch& scratch, const int32_t& elem) const
+{
+    int32_t* parent = scratch.parent.data();
+    int32_t root = elem;
+    scratch.path.clear();
+    while (parent[root] != root)
+    {
+        scratch.path.push_back(root);
+        root = parent[root];
+    }
+    double* offset = scratch.offset.data();
+    for (int i = (int)scratch.path.size() - 2; i >= 0; --i)
+    {//from the top down, so each parent's offset is already relative to the root
+        int32_t node = scratch.path[i];
+        offset[node] += offset[parent[node]];
+        parent[node] = root;
+    }
+    return root;
+}
+
+void TFCEHelper::addTouching(Scratch& scratch, const int32_t& neighbor, const signed char& mySign) const
+{
+    if (scratch.parent[neighbor] == -1 || scratch.sign[neighbor] != mySign) return;//positive and negative clusters never touch
+    int32_t root = findRoot(scratch, neighbor);
+    for (size_t i = 0; i < scratch.touching.size(); ++i)
+    {
+        if (scratch.touching[i] == root) return;
+    }
+    scratch.touching.push_back(root);
+}
+
+void TFCEHelper::update(Scratch& scratch, const int32_t& root, const float& bottomVal, const double& bottomPow) const
+{
+    if (bottomVal != scratch.lastVal[root])//skip computing if there is no difference
+    {
+        CaretAssert(bottomVal < scratch.lastVal[root]);
+        double integrated_h = m_param_h + 1.0;//integral(x^h) = (x^(h + 1))/(h + 1) + C
+        scratch.accum[root] += pow(scratch.area[root], m_param_e) * (scratch.lastPow[root] - bottomPow) / integrated_h;
+        scratch.lastVal[root] = bottomVal;
+        scratch.lastPow[root] = bottomPow;
+    }
+}
+
+void TFCEHelper::computeMap(const float* dataIn, float* dataOut, Scratch& scratch) const
+{
+    if (m_numElements == 0) return;
+    scratch.parent.assign(m_numElements, -1);//-1 means not reached by the sweep yet
+    scratch.sign.resize(m_numElements);
+    scratch.size.resize(m_numElements);
+    scratch.offset.resize(m_numElements);
+    scratch.area.resize(m_numElements);
+    scratch.accum.resize(m_numElements);
+    scratch.lastPow.resize(m_numElements);
+    scratch.lastVal.resize(m_numElements);
+    scratch.order.clear();
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        scratch.sign[i] = 0;
+        if (m_roi.empty() || m_roi[i] != 0)
+        {
+            if (dataIn[i] > 0.0f)
+            {
+                scratch.sign[i] = 1;
+                scratch.order.push_back(make_pair(dataIn[i], (int32_t)i));
+            } else if (dataIn[i] < 0.0f) {
+                scratch.sign[i] = -1;
+                scratch.order.push_back(make_pair(-dataIn[i], (int32_t)i));
+            }
+        }
+    }
+    sort(scratch.order.begin(), scratch.order.end(), DescendingValue());
+    double integrated_h = m_param_h + 1.0;
+    int64_t orderSize = (int64_t)scratch.order.size();
+    for (int64_t o = 0; o < orderSize; ++o)
+    {
+        float value = scratch.order[o].first;
+        int32_t elem = scratch.order[o].second;
+        signed char mySign = scratch.sign[elem];
+        double valuePow = pow((double)value, integrated_h);
+        double weight = m_weights.empty() ? m_uniformWeight : m_weights[elem];
+        scratch.touching.clear();
+        if (m_isVolume)
+        {
+            int64_t ijk[3] = { elem % m_dims[0], (elem / m_dims[0]) % m_dims[1], elem / (m_dims[0] * m_dims[1]) };
+            int64_t rowSize = m_dims[0], sliceSize = m_dims[0] * m_dims[1];
+            if (ijk[0] > 0) addTouching(scratch, elem - 1, mySign);
+            if (ijk[0] < m_dims[0] - 1) addTouching(scratch, elem + 1, mySign);
+            if (ijk[1] > 0) addTouching(scratch, elem - rowSize, mySign);
+            if (ijk[1] < m_dims[1] - 1) addTouching(scratch, elem + rowSize, mySign);
+            if (ijk[2] > 0) addTouching(scratch, elem - sliceSize, mySign);
+            if (ijk[2] < m_dims[2] - 1) addTouching(scratch, elem + sliceSize, mySign);
+        } else {
+            for (int64_t n = m_neighStart[elem]; n < m_neighStart[elem + 1]; ++n)
+            {
+                addTouching(scratch, m_neighbors[n], mySign);
+            }
+        }
+        if (scratch.touching.empty())
+        {//new cluster
+            scratch.parent[elem] = elem;
+            scratch.size[elem] = 1;
+            scratch.offset[elem] = 0.0;
+            scratch.area[elem] = weight;
+            scratch.accum[elem] = 0.0;
+            scratch.lastVal[elem] = value;
+            scratch.lastPow[elem] = valuePow;
+            continue;
+        }
+        int32_t merged = scratch.touching[0];
+        for (size_t t = 0; t < scratch.touching.size(); ++t)
+        {//bring all touching clusters down to this value, and merge into the one with the most members
+            int32_t root = scratch.touching[t];
+            update(scratch, root, value, valuePow);
+            if (scratch.size[root] > scratch.size[merged]) merged = root;
+        }
+        for (size_t t = 0; t < scratch.touching.size(); ++t)
+        {
+            int32_t root = scratch.touching[t];
+            if (root == merged) continue;
+            scratch.parent[root] = merged;
+            scratch.offset[root] = scratch.accum[root] - scratch.accum[merged];//members of this cluster got its integral so far, and will get the merged cluster's integral from here on
+            scratch.size[merged] += scratch.size[root];
+            scratch.area[merged] += scratch.area[root];
+        }
+        scratch.parent[elem] = merged;
+        scratch.offset[elem] = -scratch.accum[merged];//joining at the current level, so it doesn't get any of the integral above it
+        scratch.size[merged] += 1;
+        scratch.area[merged] += weight;
+    }
+    for (int64_t o = 0; o < orderSize; ++o)
+    {//integrate all remaining clusters down to zero
+        int32_t elem = scratch.order[o].second;
+        if (scratch.parent[elem] == elem) update(scratch, elem, 0.0f, 0.0);
+    }
+    for (int64_t i = 0; i < m_numElements; ++i)
+    {
+        dataOut[i] = 0.0f;
+    }
+    for (int64_t o = 0; o < orderSize; ++o)
+    {
+        int32_t elem = scratch.order[o].second;
+        int32_t root = findRoot(scratch, elem);
+        double result = scratch.accum[root];
+        if (root != elem) result += scratch.offset[elem];
+        dataOut[elem] = (float)(scratch.sign[elem] * result);
+    }
+}
+
+void TFCEHelper::compute(const float* dataIn, float* dataOut) const
+{
+    Scratch scratch;
+    computeMap(dataIn, dataOut, scratch);
+}
+
+void TFCEHelper::computeBatch(const vector<const float*>& dataIn, const vector<float*>& dataOut) const
+{
+    CaretAssert(dataIn.size() == dataOut.size());
+    int64_t numMaps = (int64_t)dataIn.size();
+#pragma omp CARET_PAR
+    {
+        Scratch scratch;
+#pragma omp CARET_FOR schedule(dynamic)
+        for (int64_t m = 0; m < numMaps; ++m)
+        {
+            computeMap(dataIn[m], dataOut[m], scratch);
+        }
+    }
+}
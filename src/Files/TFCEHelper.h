@@ -0,0 +1,81 @@
+#ifndef __TFCE_HELPER_H__
+#define __TFCE_HELPER_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "stdint.h"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace caret
+{
+
+    class TopologyHelper;
+
+    ///threshold-free cluster enhancement on a surface or a face-connected voxel grid
+    ///the adjacency, element weights and roi are set up once, so many maps (permutations, etc) can share them
+    ///each map is a single sweep in order of decreasing magnitude, with clusters merged by union-find, where each element
+    ///stores its offset from its parent's integral, so merging clusters never has to touch the members of either cluster
+    class TFCEHelper
+    {
+        struct Scratch
+        {
+            std::vector<std::pair<float, int32_t> > order;
+            std::vector<int32_t> parent, size, touching, path;
+            std::vector<double> offset, area, accum, lastPow;
+            std::vector<float> lastVal;
+            std::vector<signed char> sign;
+        };
+        int64_t m_numElements;
+        bool m_isVolume;
+        //surface: full neighbor lists in CSR form
+        std::vector<int64_t> m_neighStart;
+        std::vector<int32_t> m_neighbors;
+        //volume
+        int64_t m_dims[3];
+        std::vector<float> m_weights;//per-vertex area, empty for volume
+        float m_uniformWeight;
+        std::vector<char> m_roi;//empty means everything is in the roi
+        double m_param_e, m_param_h;
+
+        int32_t findRoot(Scratch& scratch, const int32_t& elem) const;
+        void addTouching(Scratch& scratch, const int32_t& neighbor, const signed char& mySign) const;
+        void update(Scratch& scratch, const int32_t& root, const float& bottomVal, const double& bottomPow) const;
+        void computeMap(const float* dataIn, float* dataOut, Scratch& scratch) const;
+    public:
+        ///areaData gives the weight of each vertex, roiData can be NULL
+        TFCEHelper(const TopologyHelper* myTopoHelp, const float* areaData, const float* roiData, const float& param_e, const float& param_h);
+        ///6-connected voxels all weighted by voxelVolume, roiFrame can be NULL
+        TFCEHelper(const int64_t dims[3], const float& voxelVolume, const float* roiFrame, const float& param_e, const float& param_h);
+
+        int64_t getNumberOfElements() const { return m_numElements; }
+
+        ///positive and negative values are enhanced separately, output has the sign of the input, and is zero outside the roi
+        void compute(const float* dataIn, float* dataOut) const;
+
+        ///process many maps, in parallel over maps, each thread reuses its sweep buffers
+        void computeBatch(const std::vector<const float*>& dataIn, const std::vector<float*>& dataOut) const;
+    };
+
+}
+
+#endif //__TFCE_HELPER_H__
@@ -17,6 +17,7 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 /*LICENSE_END*/
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <sstream>
@@ -462,6 +463,48 @@ float VolumeFile::interpolateValue(const float coordIn1, const float coordIn2, c
     return INVALID_INTERP_VALUE;
 }
 
+void VolumeFile::interpolateValues(const float* coordsIn, float* valuesOut, const int64_t& count, InterpType interp, bool* validOut,
+                                   const int64_t brickIndex, const int64_t component) const
+{
+    if (interp != CUBIC || m_singleSliceFlag)
+    {//the other methods are cheap per point
+        for (int64_t p = 0; p < count; ++p)
+        {
+            valuesOut[p] = interpolateValue(coordsIn + p * 3, interp, (validOut == NULL ? NULL : validOut + p), brickIndex, component);
+        }
+        return;
+    }
+    const int64_t* dimensions = getDimensionsPtr();
+    const int64_t whichFrame = component * dimensions[3] + brickIndex;
+    validateSpline(brickIndex, component);
+    const int BATCH = 256;
+    float indices[BATCH * 3];
+    bool valid[BATCH];
+    for (int64_t batchStart = 0; batchStart < count; batchStart += BATCH)
+    {
+        const int batchSize = (int)min((int64_t)BATCH, count - batchStart);
+        for (int p = 0; p < batchSize; ++p)
+        {
+            float* pointIndex = indices + p * 3;
+            spaceToIndex(coordsIn + (batchStart + p) * 3, pointIndex);
+            int64_t ind1low = floor(pointIndex[0]);//same validity rule as interpolateValue
+            int64_t ind2low = floor(pointIndex[1]);
+            int64_t ind3low = floor(pointIndex[2]);
+            valid[p] = indexValid(ind1low, ind2low, ind3low, brickIndex, component) && indexValid(ind1low + 1, ind2low + 1, ind3low + 1, brickIndex, component);
+            if (!valid[p])
+            {
+                pointIndex[0] = -1.0f;//let the spline reject it cheaply
+            }
+        }
+        m_frameSplines[whichFrame].sample(indices, valuesOut + batchStart, batchSize);
+        for (int p = 0; p < batchSize; ++p)
+        {
+            if (!valid[p]) valuesOut[batchStart + p] = INVALID_INTERP_VALUE;
+            if (validOut != NULL) validOut[batchStart + p] = valid[p];
+        }
+    }
+}
+
 void VolumeFile::validateSpline(const int64_t brickIndex, const int64_t component) const
 {
     const int64_t* dimensions = getDimensionsPtr();
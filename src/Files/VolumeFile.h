@@ -174,6 +174,10 @@ namespace caret {
 
         float interpolateValue(const float coordIn1, const float coordIn2, const float coordIn3, InterpType interp = TRILINEAR, bool* validOut = NULL, const int64_t brickIndex = 0, const int64_t component = 0) const;
 
+        ///interpolate many interleaved coordinate triplets at once, same results as interpolateValue, validOut may be NULL
+        void interpolateValues(const float* coordsIn, float* valuesOut, const int64_t& count, InterpType interp = TRILINEAR, bool* validOut = NULL,
+                               const int64_t brickIndex = 0, const int64_t component = 0) const;
+
         ///returns true if volume space matches in spatial dimensions and sform
         bool matchesVolumeSpace(const VolumeFile* right) const;
         
@@ -40,121 +40,52 @@ VolumeSpline::VolumeSpline()
 
 VolumeSpline::VolumeSpline(const float* frame, const int64_t framedims[3])
 {
-    m_ignoredNonNumeric = false;
     m_dims[0] = framedims[0];
     m_dims[1] = framedims[1];
     m_dims[2] = framedims[2];
-    m_deconv = CaretArray<float>(m_dims[0] * m_dims[1] * m_dims[2]);
-    CaretArray<float> scratchArray(m_dims[0] * max(m_dims[1], m_dims[2])), deconvScratch(max(m_dims[0], max(m_dims[1], m_dims[2])));//allocate as much as we will need, even if we don't use it all yet
-    predeconvolve(deconvScratch, m_dims[0]);
-    for (int k = 0; k < m_dims[2]; ++k)
+    const int64_t frameSize = m_dims[0] * m_dims[1] * m_dims[2];
+    const int64_t sliceSize = m_dims[0] * m_dims[1];
+    m_deconv = CaretArray<float>(frameSize);
+    float* deconv = m_deconv.getArray();
+    bool ignoredNonNumeric = false;
+#pragma omp CARET_PARFOR schedule(static) reduction(||:ignoredNonNumeric)
+    for (int64_t index = 0; index < frameSize; ++index)
     {
-        int64_t index = m_dims[0] * m_dims[1] * k;
-        int64_t index2 = 0;
-        for (int j = 0; j < m_dims[1]; ++j)
-        {
-            for (int i = 0; i < m_dims[0]; ++i)
-            {
-                float tempf = frame[index];
-                if (MathFunctions::isNumeric(tempf))
-                {
-                    scratchArray[index2] = tempf;
-                } else {
-                    scratchArray[index2] = 0.0f;
-                    m_ignoredNonNumeric = true;
-                }
-                ++index;
-                ++index2;
-            }
-        }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int j = 0; j < m_dims[1]; ++j)
-        {
-            int64_t privIndex = j * m_dims[0];
-            deconvolve(scratchArray.getArray() + privIndex, deconvScratch, m_dims[0]);
-        }
-        index = m_dims[0] * m_dims[1] * k;
-        index2 = 0;
-        for (int j = 0; j < m_dims[1]; ++j)
+        float tempf = frame[index];
+        if (MathFunctions::isNumeric(tempf))
         {
-            for (int i = 0; i < m_dims[0]; ++i)
-            {
-                m_deconv[index] = scratchArray[index2];
-                ++index;
-                ++index2;
-            }
+            deconv[index] = tempf;
+        } else {
+            deconv[index] = 0.0f;
+            ignoredNonNumeric = true;
         }
     }
-    predeconvolve(deconvScratch, m_dims[1]);
-    for (int k = 0; k < m_dims[2]; ++k)
+    m_ignoredNonNumeric = ignoredNonNumeric;
+    CaretArray<float> backsubsI(m_dims[0]), backsubsJ(m_dims[1]), backsubsK(m_dims[2]);
+    predeconvolve(backsubsI, m_dims[0]);
+    predeconvolve(backsubsJ, m_dims[1]);
+    predeconvolve(backsubsK, m_dims[2]);
+    //i-rows are contiguous, so deconvolve them in place, one row per iteration
+    const int64_t numIRows = m_dims[1] * m_dims[2];
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t row = 0; row < numIRows; ++row)
     {
-        int64_t indexbase = k * m_dims[1] * m_dims[0];
-        int64_t index = indexbase;
-        for (int j = 0; j < m_dims[1]; ++j)
-        {
-            int64_t index2 = j;
-            for (int i = 0; i < m_dims[0]; ++i)
-            {
-                scratchArray[index2] = m_deconv[index];//read linearly from frame while writing transposed should be slightly faster, because cache can stay dirty?
-                index2 += m_dims[1];
-                ++index;
-            }
-        }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < m_dims[0]; ++i)
-        {
-            int64_t privindex = i * m_dims[1];
-            deconvolve(scratchArray.getArray() + privindex, deconvScratch, m_dims[1]);
-        }
-        index = 0;
-        for (int i = 0; i < m_dims[0]; ++i)
-        {
-            int64_t index2 = i + indexbase;
-            for (int j = 0; j < m_dims[1]; ++j)
-            {
-                m_deconv[index2] = scratchArray[index];//even though scratch should be cached now, if writing to frame collides, reading linearly should give better behavior
-                ++index;
-                index2 += m_dims[0];
-            }
-        }
+        deconvolve(deconv + row * m_dims[0], backsubsI, m_dims[0]);
     }
-    predeconvolve(deconvScratch, m_dims[2]);
-    for (int j = 0; j < m_dims[1]; ++j)//finally, use a similar strategy to do linear reads instead of widely interleaved reads for k-rows
+    //for j and k, do all the lines in a slab together, so that the recurrence steps across whole i-rows instead of transposing into scratch
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t k = 0; k < m_dims[2]; ++k)
     {
-        int64_t indexbase = j * m_dims[0];
-        int64_t increment = m_dims[1] * m_dims[0];
-        for (int k = 0; k < m_dims[2]; ++k)
-        {
-            int64_t index = indexbase + k * increment;
-            int64_t index2 = k;
-            for (int i = 0; i < m_dims[0]; ++i)
-            {
-                scratchArray[index2] = m_deconv[index];
-                index2 += m_dims[2];
-                ++index;
-            }
-        }
-#pragma omp CARET_PARFOR schedule(dynamic)
-        for (int i = 0; i < m_dims[0]; ++i)
-        {
-            int64_t privindex = i * m_dims[2];
-            deconvolve(scratchArray.getArray() + privindex, deconvScratch, m_dims[2]);
-        }
-        for (int i = 0; i < m_dims[0]; ++i)
-        {
-            int64_t index = indexbase + i;
-            int64_t index2 = i * m_dims[2];
-            for (int k = 0; k < m_dims[2]; ++k)
-            {
-                m_deconv[index] = scratchArray[index2];
-                index += increment;
-                ++index2;
-            }
-        }
+        deconvolveLines(deconv + k * sliceSize, backsubsJ, m_dims[1], m_dims[0], m_dims[0]);
+    }
+#pragma omp CARET_PARFOR schedule(static)
+    for (int64_t j = 0; j < m_dims[1]; ++j)
+    {
+        deconvolveLines(deconv + j * m_dims[0], backsubsK, m_dims[2], sliceSize, m_dims[0]);
     }
 }
 
-float VolumeSpline::sample(const float& ifloat, const float& jfloat, const float& kfloat)
+float VolumeSpline::sample(const float& ifloat, const float& jfloat, const float& kfloat) const
 {
     if (m_dims[0] < 2 || ifloat < 0.0f || jfloat < 0.0f || kfloat < 0.0f || ifloat > m_dims[0] - 1 || jfloat > m_dims[1] - 1 || kfloat > m_dims[2] - 1) return 0.0f;//yeesh
     const int64_t zstep = m_dims[0] * m_dims[1];
@@ -165,6 +96,9 @@ float VolumeSpline::sample(const float& ifloat, const float& jfloat, const float
     int64_t lowi = (int64_t)iparti;
     int64_t lowj = (int64_t)ipartj;
     int64_t lowk = (int64_t)ipartk;
+    if (lowi > 0 && lowi == m_dims[0] - 1) { --lowi; fparti = 1.0f; }//exactly on the last sample, use the last interval so we don't read past the end
+    if (lowj > 0 && lowj == m_dims[1] - 1) { --lowj; fpartj = 1.0f; }
+    if (lowk > 0 && lowk == m_dims[2] - 1) { --lowk; fpartk = 1.0f; }
     bool lowedgei = (lowi < 1);
     bool lowedgej = (lowj < 1);
     bool lowedgek = (lowk < 1);
@@ -230,9 +164,110 @@ float VolumeSpline::sample(const float& ifloat, const float& jfloat, const float
     }
 }
 
+void VolumeSpline::sample(const float* ijkIn, float* valuesOut, const int64_t& count) const
+{
+    const int BATCH = 64;//compute spline weights for a batch of points with simple loops that vectorize, then gather
+    const int64_t zstep = m_dims[0] * m_dims[1];
+    const float* deconv = m_deconv.getArray();
+    float weights[3][4][BATCH];
+    int64_t lowIndex[3][BATCH];
+    bool interior[BATCH];
+    for (int64_t batchStart = 0; batchStart < count; batchStart += BATCH)
+    {
+        const int batchSize = (int)min((int64_t)BATCH, count - batchStart);
+        const float* batchIJK = ijkIn + batchStart * 3;
+        for (int p = 0; p < batchSize; ++p)
+        {
+            interior[p] = (m_dims[0] >= 2);
+        }
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const int64_t axisDim = m_dims[axis];
+            for (int p = 0; p < batchSize; ++p)
+            {
+                float index = batchIJK[p * 3 + axis];
+                float ipart = floor(index);
+                float frac = index - ipart;
+                float frac2 = frac * frac;
+                float frac3 = frac2 * frac;
+                weights[axis][0][p] = (-frac3 + 3.0f * frac2 - 3.0f * frac + 1.0f) / 6.0f;//same blending function as CubicSpline::bspline
+                weights[axis][1][p] = (3.0f * frac3 - 6.0f * frac2 + 4.0f) / 6.0f;
+                weights[axis][2][p] = (-3.0f * frac3 + 3.0f * frac2 + 3.0f * frac + 1.0f) / 6.0f;
+                weights[axis][3][p] = frac3 / 6.0f;
+                //NaN fails both comparisons, so it also goes to the scalar fallback
+                bool inside = (ipart >= 1.0f && ipart < axisDim - 2);
+                lowIndex[axis][p] = inside ? (int64_t)ipart : 0;
+                interior[p] = interior[p] && inside;
+            }
+        }
+        for (int p = 0; p < batchSize; ++p)
+        {
+            if (!interior[p])
+            {//near an edge or outside, rare enough that the conditional version is fine
+                valuesOut[batchStart + p] = sample(batchIJK + p * 3);
+                continue;
+            }
+            const float* basePtr = deconv + (lowIndex[0][p] - 1) + m_dims[0] * (lowIndex[1][p] - 1) + zstep * (lowIndex[2][p] - 1);
+            const float wi0 = weights[0][0][p], wi1 = weights[0][1][p], wi2 = weights[0][2][p], wi3 = weights[0][3][p];
+            float ktemp[4];
+            for (int k = 0; k < 4; ++k)
+            {
+                float jtemp[4];
+                const float* rowPtr = basePtr + k * zstep;
+                for (int j = 0; j < 4; ++j)
+                {
+                    jtemp[j] = rowPtr[0] * wi0 + rowPtr[1] * wi1 + rowPtr[2] * wi2 + rowPtr[3] * wi3;
+                    rowPtr += m_dims[0];
+                }
+                ktemp[k] = jtemp[0] * weights[1][0][p] + jtemp[1] * weights[1][1][p] + jtemp[2] * weights[1][2][p] + jtemp[3] * weights[1][3][p];
+            }
+            valuesOut[batchStart + p] = ktemp[0] * weights[2][0][p] + ktemp[1] * weights[2][1][p] + ktemp[2] * weights[2][2][p] + ktemp[3] * weights[2][3][p];
+        }
+    }
+}
+
+void VolumeSpline::deconvolveLines(float* data, const float* backsubs, const int64_t& length, const int64_t& stride, const int64_t& count)
+{//same arithmetic as deconvolve(), element n of line m is data[m + n * stride]
+    if (length < 2) return;//a single sample with repeated edges is already deconvolved
+    const float A = 1.0f / 6.0f, B = 2.0f / 3.0f;
+    for (int64_t m = 0; m < count; ++m)
+    {
+        data[m] /= B + A;
+    }
+    for (int64_t n = 1; n < length - 1; ++n)
+    {
+        float* cur = data + n * stride;
+        const float* prev = cur - stride;
+        const float denom = B - A * backsubs[n - 1];
+        for (int64_t m = 0; m < count; ++m)
+        {
+            cur[m] = (cur[m] - A * prev[m]) / denom;
+        }
+    }
+    {
+        float* cur = data + (length - 1) * stride;
+        const float* prev = cur - stride;
+        const float denom = B + A - A * backsubs[length - 2];
+        for (int64_t m = 0; m < count; ++m)
+        {
+            cur[m] = (cur[m] - A * prev[m]) / denom;
+        }
+    }
+    for (int64_t n = length - 2; n >= 0; --n)
+    {
+        float* cur = data + n * stride;
+        const float* next = cur + stride;
+        const float backsub = backsubs[n];
+        for (int64_t m = 0; m < count; ++m)
+        {
+            cur[m] -= backsub * next[m];
+        }
+    }
+}
+
 void VolumeSpline::deconvolve(float* data, const float* backsubs, const int64_t& length)
 {
-    if (length < 1) return;
+    if (length < 2) return;//a single sample with repeated edges is already deconvolved
     const float A = 1.0f / 6.0f, B = 2.0f / 3.0f;//the coefficients of a bspline at center and +/-1
     //forward pass simulating gaussian elimination on matrix of bspline kernels and data
     data[0] /= B + A;//repeat final value for data outside the bounding box, to prevent bright edges
@@ -31,13 +31,16 @@ namespace caret {
         bool m_ignoredNonNumeric;
         int64_t m_dims[3];
         CaretArray<float> m_deconv;//don't do lazy deconvolution, it doesn't save much time, and takes more memory and slightly longer if you have to do the whole volume anyway
-        void deconvolve(float* data, const float* backsubs, const int64_t& length);//use CaretArray so that it doesn't reallocate like a vector on copy, and the data is static once computed
-        void predeconvolve(float* backsubs, const int64_t& length);//since the back substitution on the same size array uses the same coefficients, precompute them
+        static void deconvolve(float* data, const float* backsubs, const int64_t& length);//use CaretArray so that it doesn't reallocate like a vector on copy, and the data is static once computed
+        static void deconvolveLines(float* data, const float* backsubs, const int64_t& length, const int64_t& stride, const int64_t& count);//many interleaved lines at once, so the inner loop is contiguous
+        static void predeconvolve(float* backsubs, const int64_t& length);//since the back substitution on the same size array uses the same coefficients, precompute them
     public:
         VolumeSpline();
         VolumeSpline(const float* frame, const int64_t framedims[3]);
-        float sample(const float& i, const float& j, const float& k);
-        float sample(const float ijk[3]) { return sample(ijk[0], ijk[1], ijk[2]); }
+        float sample(const float& i, const float& j, const float& k) const;
+        float sample(const float ijk[3]) const { return sample(ijk[0], ijk[1], ijk[2]); }
+        ///sample many points at once, ijkIn is count interleaved index triplets - for best cache behavior, give nearby points in sequence
+        void sample(const float* ijkIn, float* valuesOut, const int64_t& count) const;
         bool ignoredNonNumeric() const { return m_ignoredNonNumeric; }
     };
     
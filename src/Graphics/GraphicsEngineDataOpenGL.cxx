@@ -383,11 +383,21 @@ GraphicsEngineDataOpenGL::loadTextureImageDataBuffer(GraphicsPrimitive* primitiv
             
             glBindTexture(GL_TEXTURE_2D, openGLTextureName);
             
+            GLint magnificationFilter = GL_LINEAR;
+            switch (primitive->m_textureMagnificationFilter) {
+                case GraphicsPrimitive::TextureFilteringType::LINEAR:
+                    magnificationFilter = GL_LINEAR;
+                    break;
+                case GraphicsPrimitive::TextureFilteringType::NEAREST:
+                    magnificationFilter = GL_NEAREST;
+                    break;
+            }
+            
             bool useMipMapFlag = true;
             if (useMipMapFlag) {
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magnificationFilter);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
                 
                 /*
@@ -682,25 +692,28 @@ GraphicsEngineDataOpenGL::drawSpheresPrimitive(const GraphicsPrimitive* primitiv
         case GraphicsPrimitive::VertexColorType::PER_VERTEX_RGBA:
         {
             const int32_t numberOfVertices = primitive->getNumberOfVertices();
-            for (int32_t i = 0; i < numberOfVertices; i++) {
-                const int32_t i3 = i * 3;
-                CaretAssertVectorIndex(primitive->m_xyz, i3 + 2);
-                const int32_t i4 = i * 4;
-                
-                switch (primitive->m_colorDataType) {
-                    case GraphicsPrimitive::ColorDataType::FLOAT_RGBA:
-                        CaretAssert(0);
-                        break;
-                    case GraphicsPrimitive::ColorDataType::UNSIGNED_BYTE_RGBA:
-                        CaretAssertVectorIndex(primitive->m_unsignedByteRGBA, i4 + 3);
-                        GraphicsShape::drawSphereByteColor(&primitive->m_xyz[i3],
-                                                           &primitive->m_unsignedByteRGBA[i4],
-                                                           sizeValue);
-                        break;
-                    case GraphicsPrimitive::ColorDataType::NONE:
-                        CaretAssert(0);
-                        break;
-                }
+            if (numberOfVertices <= 0) {
+                return;
+            }
+            
+            switch (primitive->m_colorDataType) {
+                case GraphicsPrimitive::ColorDataType::FLOAT_RGBA:
+                    CaretAssert(0);
+                    break;
+                case GraphicsPrimitive::ColorDataType::UNSIGNED_BYTE_RGBA:
+                    /*
+                     * All spheres are drawn as instances of one sphere
+                     */
+                    CaretAssertVectorIndex(primitive->m_xyz, (numberOfVertices - 1) * 3 + 2);
+                    CaretAssertVectorIndex(primitive->m_unsignedByteRGBA, (numberOfVertices - 1) * 4 + 3);
+                    GraphicsShape::drawSpheresByteColors(&primitive->m_xyz[0],
+                                                         &primitive->m_unsignedByteRGBA[0],
+                                                         numberOfVertices,
+                                                         sizeValue);
+                    break;
+                case GraphicsPrimitive::ColorDataType::NONE:
+                    CaretAssert(0);
+                    break;
             }
         }
             break;
@@ -0,0 +1,365 @@
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#define __GRAPHICS_ENGINE_DATA_OPEN_G_L_MESH_DECLARE__
+#include "GraphicsEngineDataOpenGLMesh.h"
+#undef __GRAPHICS_ENGINE_DATA_OPEN_G_L_MESH_DECLARE__
+
+#include "CaretAssert.h"
+#include "EventGraphicsOpenGLCreateBufferObject.h"
+#include "EventManager.h"
+#include "GraphicsOpenGLBufferObject.h"
+
+using namespace caret;
+
+
+
+/**
+ * \class caret::GraphicsEngineDataOpenGLMesh
+ * \brief OpenGL buffers for an indexed triangle mesh, such as a surface.
+ * \ingroup Graphics
+ *
+ * Coordinates, normal vectors, and triangles are kept in buffers that
+ * are only reloaded when the owner's geometry modification counter
+ * changes.  Each coloring of the mesh (for example, one per tab) has its
+ * own buffer that is only reloaded when that coloring's modification
+ * counter changes, so drawing the same mesh in many viewports does
+ * not send any vertex data to the graphics card.
+ *
+ * Coarser levels of detail are additional triangle buffers that
+ * use a subset of the same vertices, so coordinates, normal
+ * vectors, and colorings are shared by all levels.
+ *
+ * Buffers are created in the shared OpenGL context so the data is
+ * shared by all windows.
+ */
+
+/**
+ * Constructor.
+ */
+GraphicsEngineDataOpenGLMesh::GraphicsEngineDataOpenGLMesh()
+: GraphicsEngineData()
+{
+
+}
+
+/**
+ * Destructor.
+ */
+GraphicsEngineDataOpenGLMesh::~GraphicsEngineDataOpenGLMesh()
+{
+}
+
+/**
+ * @return A new OpenGL buffer object.
+ */
+GraphicsOpenGLBufferObject*
+GraphicsEngineDataOpenGLMesh::createBufferObject()
+{
+    EventGraphicsOpenGLCreateBufferObject createEvent;
+    EventManager::get()->sendEvent(createEvent.getPointer());
+    GraphicsOpenGLBufferObject* bufferObject = createEvent.getOpenGLBufferObject();
+    CaretAssert(bufferObject);
+    return bufferObject;
+}
+
+/**
+ * Load data into a buffer.
+ *
+ * @param target
+ *     The OpenGL buffer target.
+ * @param bufferObject
+ *     The buffer object.
+ * @param sizeBytes
+ *     Size of the data in bytes.
+ * @param data
+ *     The data.
+ * @param usageHint
+ *     OpenGL usage hint for the buffer.
+ * @param replaceDataFlag
+ *     If true, the buffer already has storage for exactly this size
+ *     and only the data is replaced.
+ */
+void
+GraphicsEngineDataOpenGLMesh::loadBuffer(const GLenum target,
+                                         GraphicsOpenGLBufferObject* bufferObject,
+                                         const GLsizeiptr sizeBytes,
+                                         const GLvoid* data,
+                                         const GLenum usageHint,
+                                         const bool replaceDataFlag)
+{
+    CaretAssert(bufferObject);
+    CaretAssert(bufferObject->getBufferObjectName());
+
+    glBindBuffer(target,
+                 bufferObject->getBufferObjectName());
+    if (replaceDataFlag) {
+        glBufferSubData(target,
+                        0,
+                        sizeBytes,
+                        data);
+    }
+    else {
+        glBufferData(target,
+                     sizeBytes,
+                     data,
+                     usageHint);
+    }
+    glBindBuffer(target,
+                 0);
+}
+
+/**
+ * Load the coordinates, normal vectors, and triangles if the modification
+ * counter is different from the one used when they were last loaded.
+ *
+ * @param modificationCounter
+ *     Modification counter of the mesh's geometry.
+ * @param numberOfVertices
+ *     Number of vertices.
+ * @param xyz
+ *     Coordinates, three per vertex.
+ * @param normalVectors
+ *     Normal vectors, three per vertex.
+ * @param numberOfTriangles
+ *     Number of triangles.
+ * @param triangleVertexIndices
+ *     Vertex indices, three per triangle.
+ */
+void
+GraphicsEngineDataOpenGLMesh::updateGeometry(const uint64_t modificationCounter,
+                                             const int32_t numberOfVertices,
+                                             const float* xyz,
+                                             const float* normalVectors,
+                                             const int32_t numberOfTriangles,
+                                             const int32_t* triangleVertexIndices)
+{
+    if ((m_coordinateBufferObject != NULL)
+        && (modificationCounter == m_geometryModificationCounter)) {
+        return;
+    }
+
+    CaretAssert(xyz);
+    CaretAssert(normalVectors);
+    CaretAssert(triangleVertexIndices);
+
+    const bool sameVerticesFlag  = ((m_coordinateBufferObject != NULL)
+                                    && (numberOfVertices == m_numberOfVertices));
+    const bool sameTrianglesFlag = ((m_triangleBufferObject != NULL)
+                                    && (numberOfTriangles == m_numberOfTriangles));
+    if (m_coordinateBufferObject == NULL) {
+        m_coordinateBufferObject.reset(createBufferObject());
+        m_normalVectorBufferObject.reset(createBufferObject());
+        m_triangleBufferObject.reset(createBufferObject());
+    }
+
+    if ( ! sameVerticesFlag) {
+        /*
+         * Colors are per-vertex so they are no longer valid
+         */
+        m_colorBuffers.clear();
+    }
+    
+    /*
+     * Levels of detail are made from the geometry
+     */
+    m_levelOfDetailTriangleBuffers.clear();
+
+    const GLsizeiptr vertexSizeBytes = numberOfVertices * 3 * sizeof(float);
+    loadBuffer(GL_ARRAY_BUFFER,
+               m_coordinateBufferObject.get(),
+               vertexSizeBytes,
+               xyz,
+               GL_STATIC_DRAW,
+               sameVerticesFlag);
+    loadBuffer(GL_ARRAY_BUFFER,
+               m_normalVectorBufferObject.get(),
+               vertexSizeBytes,
+               normalVectors,
+               GL_STATIC_DRAW,
+               sameVerticesFlag);
+    loadBuffer(GL_ELEMENT_ARRAY_BUFFER,
+               m_triangleBufferObject.get(),
+               numberOfTriangles * 3 * sizeof(int32_t),
+               triangleVertexIndices,
+               GL_STATIC_DRAW,
+               sameTrianglesFlag);
+
+    m_numberOfVertices  = numberOfVertices;
+    m_numberOfTriangles = numberOfTriangles;
+    m_geometryModificationCounter = modificationCounter;
+}
+
+/**
+ * Load a coloring if its modification counter is different from the
+ * one used when it was last loaded.  Must be called after updateGeometry().
+ *
+ * @param colorIdentifier
+ *     Identifies the coloring (non-negative).
+ * @param modificationCounter
+ *     Modification counter of the coloring.
+ * @param rgba
+ *     The coloring, four floats per vertex.
+ */
+void
+GraphicsEngineDataOpenGLMesh::updateColors(const int32_t colorIdentifier,
+                                           const uint64_t modificationCounter,
+                                           const float* rgba)
+{
+    CaretAssert(colorIdentifier >= 0);
+    CaretAssert(rgba);
+
+    ColorBuffer& colorBuffer = m_colorBuffers[colorIdentifier];
+    if ((colorBuffer.m_bufferObject != NULL)
+        && (colorBuffer.m_modificationCounter == modificationCounter)) {
+        return;
+    }
+
+    if (colorBuffer.m_bufferObject == NULL) {
+        colorBuffer.m_bufferObject.reset(createBufferObject());
+    }
+
+    const GLsizeiptr colorSizeBytes = m_numberOfVertices * 4 * sizeof(float);
+    loadBuffer(GL_ARRAY_BUFFER,
+               colorBuffer.m_bufferObject.get(),
+               colorSizeBytes,
+               rgba,
+               GL_DYNAMIC_DRAW,
+               (colorSizeBytes == colorBuffer.m_sizeBytes));
+
+    colorBuffer.m_sizeBytes = colorSizeBytes;
+    colorBuffer.m_modificationCounter = modificationCounter;
+}
+
+/**
+ * @return True if triangles for the given level of detail have been
+ * loaded since the geometry was last loaded.
+ *
+ * @param levelOfDetail
+ *     The level of detail (greater than zero).
+ */
+bool
+GraphicsEngineDataOpenGLMesh::hasLevelOfDetail(const int32_t levelOfDetail) const
+{
+    return (m_levelOfDetailTriangleBuffers.find(levelOfDetail) != m_levelOfDetailTriangleBuffers.end());
+}
+
+/**
+ * Load triangles for a level of detail.  The triangles must use the
+ * vertices loaded with updateGeometry(), which must be called first.
+ *
+ * @param levelOfDetail
+ *     The level of detail (greater than zero, zero is all triangles).
+ * @param numberOfTriangles
+ *     Number of triangles.
+ * @param triangleVertexIndices
+ *     Vertex indices, three per triangle.
+ */
+void
+GraphicsEngineDataOpenGLMesh::updateLevelOfDetail(const int32_t levelOfDetail,
+                                                  const int32_t numberOfTriangles,
+                                                  const int32_t* triangleVertexIndices)
+{
+    CaretAssert(levelOfDetail > 0);
+    CaretAssert(triangleVertexIndices);
+    
+    TriangleBuffer& triangleBuffer = m_levelOfDetailTriangleBuffers[levelOfDetail];
+    if (triangleBuffer.m_bufferObject == NULL) {
+        triangleBuffer.m_bufferObject.reset(createBufferObject());
+    }
+    
+    loadBuffer(GL_ELEMENT_ARRAY_BUFFER,
+               triangleBuffer.m_bufferObject.get(),
+               numberOfTriangles * 3 * sizeof(int32_t),
+               triangleVertexIndices,
+               GL_STATIC_DRAW,
+               (numberOfTriangles == triangleBuffer.m_numberOfTriangles));
+    triangleBuffer.m_numberOfTriangles = numberOfTriangles;
+}
+
+/**
+ * Draw the triangles.  Lighting, polygon mode, and blending
+ * are set by the caller.
+ *
+ * @param colorIdentifier
+ *     Identifies the coloring loaded with updateColors().  If negative,
+ *     the current OpenGL color is used for all vertices.
+ * @param levelOfDetail
+ *     Zero draws all triangles, otherwise identifies the triangles
+ *     loaded with updateLevelOfDetail().
+ */
+void
+GraphicsEngineDataOpenGLMesh::draw(const int32_t colorIdentifier,
+                                   const int32_t levelOfDetail)
+{
+    if (m_coordinateBufferObject == NULL) {
+        return;
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_coordinateBufferObject->getBufferObjectName());
+    glVertexPointer(3, GL_FLOAT, 0, (GLvoid*)0);
+
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 m_normalVectorBufferObject->getBufferObjectName());
+    glNormalPointer(GL_FLOAT, 0, (GLvoid*)0);
+
+    if (colorIdentifier >= 0) {
+        std::map<int32_t, ColorBuffer>::iterator iter = m_colorBuffers.find(colorIdentifier);
+        CaretAssert(iter != m_colorBuffers.end());
+        if (iter != m_colorBuffers.end()) {
+            glEnableClientState(GL_COLOR_ARRAY);
+            glBindBuffer(GL_ARRAY_BUFFER,
+                         iter->second.m_bufferObject->getBufferObjectName());
+            glColorPointer(4, GL_FLOAT, 0, (GLvoid*)0);
+        }
+    }
+
+    GraphicsOpenGLBufferObject* triangleBufferObject = m_triangleBufferObject.get();
+    int32_t numberOfTriangles = m_numberOfTriangles;
+    if (levelOfDetail > 0) {
+        std::map<int32_t, TriangleBuffer>::iterator iter = m_levelOfDetailTriangleBuffers.find(levelOfDetail);
+        CaretAssert(iter != m_levelOfDetailTriangleBuffers.end());
+        if (iter != m_levelOfDetailTriangleBuffers.end()) {
+            triangleBufferObject = iter->second.m_bufferObject.get();
+            numberOfTriangles    = iter->second.m_numberOfTriangles;
+        }
+    }
+    
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 triangleBufferObject->getBufferObjectName());
+    glDrawElements(GL_TRIANGLES,
+                   (3 * numberOfTriangles),
+                   GL_UNSIGNED_INT,
+                   (GLvoid*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER,
+                 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                 0);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+}
+
@@ -0,0 +1,124 @@
+#ifndef __GRAPHICS_ENGINE_DATA_OPEN_G_L_MESH_H__
+#define __GRAPHICS_ENGINE_DATA_OPEN_G_L_MESH_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <map>
+#include <memory>
+
+#include "CaretOpenGLInclude.h"
+#include "GraphicsEngineData.h"
+
+namespace caret {
+
+    class GraphicsOpenGLBufferObject;
+
+    class GraphicsEngineDataOpenGLMesh : public GraphicsEngineData {
+
+    public:
+        GraphicsEngineDataOpenGLMesh();
+
+        virtual ~GraphicsEngineDataOpenGLMesh();
+
+        void updateGeometry(const uint64_t modificationCounter,
+                            const int32_t numberOfVertices,
+                            const float* xyz,
+                            const float* normalVectors,
+                            const int32_t numberOfTriangles,
+                            const int32_t* triangleVertexIndices);
+
+        void updateColors(const int32_t colorIdentifier,
+                          const uint64_t modificationCounter,
+                          const float* rgba);
+
+        bool hasLevelOfDetail(const int32_t levelOfDetail) const;
+
+        void updateLevelOfDetail(const int32_t levelOfDetail,
+                                 const int32_t numberOfTriangles,
+                                 const int32_t* triangleVertexIndices);
+
+        void draw(const int32_t colorIdentifier,
+                  const int32_t levelOfDetail);
+
+        // ADD_NEW_METHODS_HERE
+
+    private:
+        /**
+         * A buffer containing per-vertex RGBA and the modification
+         * counter of the coloring when it was loaded.
+         */
+        struct ColorBuffer {
+            std::unique_ptr<GraphicsOpenGLBufferObject> m_bufferObject;
+
+            uint64_t m_modificationCounter = 0;
+
+            GLsizeiptr m_sizeBytes = 0;
+        };
+
+        /**
+         * A buffer containing a reduced set of triangles
+         * that use the same vertices.
+         */
+        struct TriangleBuffer {
+            std::unique_ptr<GraphicsOpenGLBufferObject> m_bufferObject;
+
+            int32_t m_numberOfTriangles = 0;
+        };
+
+        GraphicsEngineDataOpenGLMesh(const GraphicsEngineDataOpenGLMesh&);
+
+        GraphicsEngineDataOpenGLMesh& operator=(const GraphicsEngineDataOpenGLMesh&);
+
+        static GraphicsOpenGLBufferObject* createBufferObject();
+
+        static void loadBuffer(const GLenum target,
+                               GraphicsOpenGLBufferObject* bufferObject,
+                               const GLsizeiptr sizeBytes,
+                               const GLvoid* data,
+                               const GLenum usageHint,
+                               const bool replaceDataFlag);
+
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_coordinateBufferObject;
+
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_normalVectorBufferObject;
+
+        std::unique_ptr<GraphicsOpenGLBufferObject> m_triangleBufferObject;
+
+        std::map<int32_t, ColorBuffer> m_colorBuffers;
+
+        std::map<int32_t, TriangleBuffer> m_levelOfDetailTriangleBuffers;
+
+        uint64_t m_geometryModificationCounter = 0;
+
+        int32_t m_numberOfVertices = 0;
+
+        int32_t m_numberOfTriangles = 0;
+
+// ADD_NEW_MEMBERS_HERE
+
+    };
+
+#ifdef __GRAPHICS_ENGINE_DATA_OPEN_G_L_MESH_DECLARE__
+    // <PLACE DECLARATIONS OF STATIC MEMBERS HERE>
+#endif // __GRAPHICS_ENGINE_DATA_OPEN_G_L_MESH_DECLARE__
+
+} // namespace
+#endif  //__GRAPHICS_ENGINE_DATA_OPEN_G_L_MESH_H__
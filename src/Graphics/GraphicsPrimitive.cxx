@@ -32,6 +32,7 @@
 #include "GraphicsPrimitiveV3fC4f.h"
 #include "GraphicsPrimitiveV3fC4ub.h"
 #include "GraphicsPrimitiveV3fN3f.h"
+#include "GraphicsPrimitiveV3fN3fC4ub.h"
 #include "GraphicsPrimitiveV3fT3f.h"
 
 using namespace caret;
@@ -131,6 +132,7 @@ GraphicsPrimitive::copyHelperGraphicsPrimitive(const GraphicsPrimitive& obj)
     m_textureImageBytesRGBA       = obj.m_textureImageBytesRGBA;
     m_textureImageWidth           = obj.m_textureImageWidth;
     m_textureImageHeight          = obj.m_textureImageHeight;
+    m_textureMagnificationFilter  = obj.m_textureMagnificationFilter;
 
     m_graphicsEngineDataForOpenGL.reset();
 }
@@ -1459,6 +1461,22 @@ GraphicsPrimitive::setTextureImage(const uint8_t* imageBytesRGBA,
     }
 }
 
+/**
+ * Set the filtering used when the texture is magnified.  Linear
+ * filtering (the default) gives a smooth appearance and is best for
+ * photographic images.  Nearest filtering keeps each texel a sharp
+ * edged block and is best when texels represent discrete data
+ * such as the cells of a matrix.
+ *
+ * @param textureFilter
+ *     New filtering for magnification.
+ */
+void
+GraphicsPrimitive::setTextureMagnificationFilter(const TextureFilteringType textureFilter)
+{
+    m_textureMagnificationFilter = textureFilter;
+}
+
 /**
  * Get the OpenGL graphics engine data in this instance.
  *
@@ -1550,6 +1568,20 @@ GraphicsPrimitive::newPrimitiveV3f(const GraphicsPrimitive::PrimitiveType primit
     return primitive;
 }
 
+/**
+ * @return A new primitive for XYZ with normal vectors and unsigned byte RGBA.
+ * Caller is responsible for deleting the returned pointer.
+ *
+ * @param primitiveType
+ *     Type of primitive drawn (triangles, lines, etc.)
+ */
+GraphicsPrimitiveV3fN3fC4ub*
+GraphicsPrimitive::newPrimitiveV3fN3fC4ub(const GraphicsPrimitive::PrimitiveType primitiveType)
+{
+    GraphicsPrimitiveV3fN3fC4ub* primitive = new GraphicsPrimitiveV3fN3fC4ub(primitiveType);
+    return primitive;
+}
+
 /**
  * @return A new primitive for XYZ with float RGBA.  Caller is responsible
  * for deleting the returned pointer.
@@ -38,6 +38,7 @@ namespace caret {
     class GraphicsPrimitiveV3fC4f;
     class GraphicsPrimitiveV3fC4ub;
     class GraphicsPrimitiveV3fN3f;
+    class GraphicsPrimitiveV3fN3fC4ub;
     class GraphicsPrimitiveV3fT3f;
     
     class GraphicsPrimitive : public CaretObject, public EventListenerInterface {
@@ -95,6 +96,16 @@ namespace caret {
             FLOAT_STR
         };
         
+        /**
+         * Filtering used when a texture is magnified
+         */
+        enum class TextureFilteringType {
+            /** Weighted average of nearest texels, smooth appearance */
+            LINEAR,
+            /** Nearest texel, texels appear as sharp edged blocks */
+            NEAREST
+        };
+        
         /**
          * Type of primitives for drawing.  There are NO primitives equivalent to
          * OpenGL's GL_QUAD_STRIP and GL_POLYGON.  The reason is that these
@@ -265,6 +276,8 @@ namespace caret {
         static GraphicsPrimitiveV3fN3f* newPrimitiveV3fN3f(const GraphicsPrimitive::PrimitiveType primitiveType,
                                                            const uint8_t unsignedByteRGBA[4]);
         
+        static GraphicsPrimitiveV3fN3fC4ub* newPrimitiveV3fN3fC4ub(const GraphicsPrimitive::PrimitiveType primitiveType);
+        
         static GraphicsPrimitiveV3fC4f* newPrimitiveV3fC4f(const GraphicsPrimitive::PrimitiveType primitiveType);
         
         static GraphicsPrimitiveV3fC4ub* newPrimitiveV3fC4ub(const GraphicsPrimitive::PrimitiveType primitiveType);
@@ -330,6 +343,13 @@ namespace caret {
          */
         inline TextureDataType getTextureDataType() const { return m_textureDataType; }
         
+        /**
+         * @return Filtering used when the texture is magnified.
+         */
+        inline TextureFilteringType getTextureMagnificationFilter() const { return m_textureMagnificationFilter; }
+        
+        void setTextureMagnificationFilter(const TextureFilteringType textureFilter);
+        
         /**
          * @return The float coordinates.
          */
@@ -337,6 +357,11 @@ namespace caret {
         
         void replaceFloatXYZ(const std::vector<float>& xyz);
         
+        /**
+         * @return The float normal vectors (empty if primitive has no normal vectors).
+         */
+        const std::vector<float>& getFloatNormalVectorXYZ() const { return m_floatNormalVectorXYZ; }
+        
         /**
          * @return The number of vertices
          */
@@ -447,6 +472,8 @@ namespace caret {
         
         int32_t m_textureImageHeight = -1;
         
+        TextureFilteringType m_textureMagnificationFilter = TextureFilteringType::LINEAR;
+        
         mutable PointSizeType m_pointSizeType = PointSizeType::PIXELS;
         
         mutable float m_pointDiameterValue = 1.0f;
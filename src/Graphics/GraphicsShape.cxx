@@ -23,7 +23,9 @@
 #include "GraphicsShape.h"
 #undef __GRAPHICS_SHAPE_DECLARE__
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include "CaretAssert.h"
 #include "CaretLogger.h"
@@ -32,6 +34,7 @@
 #include "GraphicsPrimitiveV3f.h"
 #include "GraphicsPrimitiveV3fC4ub.h"
 #include "GraphicsPrimitiveV3fN3f.h"
+#include "GraphicsPrimitiveV3fN3fC4ub.h"
 #include "MathFunctions.h"
 #include "Matrix4x4.h"
 
@@ -88,6 +91,13 @@ GraphicsShape::deleteAllPrimitives()
      * is deleted.
      */
     s_byteSquarePrimitive.reset();
+    s_sphereTrianglesPrimitive.reset();
+    
+    for (auto ip : s_instancesPrimitives) {
+        delete ip;
+    }
+    s_instancesPrimitives.clear();
+    s_numberOfInstancesVerticesKept = 0;
 }
 
 
@@ -533,6 +543,22 @@ GraphicsShape::drawSpheresByteColor(const float xyz[],
     
     CaretAssert(spherePrimitive);
     
+    if (numberOfSpheres > 1) {
+        /*
+         * Many spheres are drawn as instances in a few
+         * draw calls instead of one draw call per sphere
+         */
+        std::vector<uint8_t> spheresRGBA(numberOfSpheres * 4);
+        for (int32_t i = 0; i < numberOfSpheres; i++) {
+            std::copy(rgba, rgba + 4, &spheresRGBA[i * 4]);
+        }
+        drawSpheresByteColors(xyz,
+                              &spheresRGBA[0],
+                              numberOfSpheres,
+                              diameter);
+        return;
+    }
+    
     spherePrimitive->replaceAllVertexSolidByteRGBA(rgba);
     
     for (int32_t i = 0; i < numberOfSpheres; i++) {
@@ -546,6 +572,282 @@ GraphicsShape::drawSpheresByteColor(const float xyz[],
 }
 
 
+/**
+ * Draw spheres, each with its own color, at the given XYZ coordinates.
+ * The spheres are drawn as instances of one sphere shape so that
+ * drawing requires a few draw calls instead of one per sphere.
+ *
+ * @param xyz
+ *     XYZ-coordinates of spheres (must be allocated for
+ *     "numberOfSpheres")
+ * @param rgba
+ *     RGBA color for each sphere (must be allocated for
+ *     "numberOfSpheres")
+ * @param numberOfSpheres
+ *     Number of spheres
+ * @param diameter
+ *    Diameter of the spheres.
+ */
+void
+GraphicsShape::drawSpheresByteColors(const float xyz[],
+                                     const uint8_t rgba[],
+                                     const int32_t numberOfSpheres,
+                                     const float diameter)
+{
+    if (numberOfSpheres <= 0) {
+        return;
+    }
+    CaretAssert(xyz);
+    CaretAssert(rgba);
+    
+    if ( ! s_sphereTrianglesPrimitive) {
+        /*
+         * Instances are combined into one primitive so the sphere
+         * must be independent triangles, not triangle strips.
+         */
+        const int32_t numLatLonDivisions = 10;
+        s_sphereTrianglesPrimitive.reset(createSpherePrimitiveTriangles(numLatLonDivisions));
+    }
+    CaretAssert(s_sphereTrianglesPrimitive);
+    
+    /*
+     * Transform for each sphere scales the unit diameter
+     * sphere and then translates it to the sphere's location
+     */
+    std::vector<float> matrices(numberOfSpheres * 16, 0.0f);
+    for (int32_t i = 0; i < numberOfSpheres; i++) {
+        const int32_t i3  = i * 3;
+        const int32_t i16 = i * 16;
+        matrices[i16]      = diameter;
+        matrices[i16 + 5]  = diameter;
+        matrices[i16 + 10] = diameter;
+        matrices[i16 + 12] = xyz[i3];
+        matrices[i16 + 13] = xyz[i3 + 1];
+        matrices[i16 + 14] = xyz[i3 + 2];
+        matrices[i16 + 15] = 1.0f;
+    }
+    
+    drawInstancesByteColors(s_sphereTrianglesPrimitive.get(),
+                            &matrices[0],
+                            rgba,
+                            numberOfSpheres);
+}
+
+/**
+ * Draw instances of a shape with each instance having its own
+ * transformation and color.  OpenGL instanced drawing requires
+ * shaders that are not used by the fixed pipeline, so the shape's
+ * vertices and normal vectors are transformed for each instance
+ * and placed, with the instance's color, into one primitive that
+ * is drawn with a single draw call.  Large numbers of instances are
+ * split into batches to limit the memory used by each primitive.
+ * The instances are drawn in the order given.
+ *
+ * The primitives are kept and drawn again, without transforming the
+ * shape, as long as the same shape is drawn with the same matrices
+ * and colors.  So foci, identification symbols, and fiber fans
+ * are only transformed when they change, not on every redraw.
+ * The shape primitive must remain valid until deleteAllPrimitives()
+ * is called.
+ *
+ * @param trianglesPrimitive
+ *     Primitive containing the shape's triangles with normal vectors.
+ * @param matrices
+ *     Transformation matrix for each instance in OpenGL (column-major)
+ *     order, as used by glMultMatrixf (16 elements per instance).
+ * @param rgba
+ *     RGBA color for each instance (4 elements per instance).
+ * @param numberOfInstances
+ *     Number of instances.
+ */
+void
+GraphicsShape::drawInstancesByteColors(const GraphicsPrimitive* trianglesPrimitive,
+                                       const float matrices[],
+                                       const uint8_t rgba[],
+                                       const int32_t numberOfInstances)
+{
+    if (numberOfInstances <= 0) {
+        return;
+    }
+    CaretAssert(trianglesPrimitive);
+    CaretAssert(matrices);
+    CaretAssert(rgba);
+    CaretAssert(trianglesPrimitive->getPrimitiveType() == GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES);
+    
+    const int32_t numberOfShapeVertices = trianglesPrimitive->getNumberOfVertices();
+    if (numberOfShapeVertices <= 0) {
+        return;
+    }
+    
+    for (std::list<InstancesPrimitives*>::iterator iter = s_instancesPrimitives.begin();
+         iter != s_instancesPrimitives.end();
+         iter++) {
+        InstancesPrimitives* ip = *iter;
+        if ((ip->m_shapePrimitive == trianglesPrimitive)
+            && (ip->m_numberOfShapeVertices == numberOfShapeVertices)
+            && (static_cast<int32_t>(ip->m_rgba.size()) == (numberOfInstances * 4))
+            && (std::memcmp(&ip->m_matrices[0], matrices, numberOfInstances * 16 * sizeof(float)) == 0)
+            && (std::memcmp(&ip->m_rgba[0], rgba, numberOfInstances * 4) == 0)) {
+            /*
+             * Most recently used is first
+             */
+            s_instancesPrimitives.erase(iter);
+            s_instancesPrimitives.push_front(ip);
+            
+            for (auto& primitive : ip->m_primitives) {
+                GraphicsEngineDataOpenGL::draw(primitive.get());
+            }
+            return;
+        }
+    }
+    
+    /*
+     * About 28MB of vertex data (xyz, normal, rgba) for each draw call
+     */
+    const int32_t maximumVerticesPerDraw = 1024 * 1024;
+    const int32_t instancesPerDraw = std::max(maximumVerticesPerDraw / numberOfShapeVertices,
+                                              1);
+    
+    const int64_t numberOfVertices = static_cast<int64_t>(numberOfInstances) * numberOfShapeVertices;
+    if (numberOfVertices > s_maximumInstancesVerticesKept) {
+        /*
+         * Too large to keep, draw a batch at a time
+         */
+        for (int32_t iFirst = 0; iFirst < numberOfInstances; iFirst += instancesPerDraw) {
+            const int32_t iLast = std::min(iFirst + instancesPerDraw,
+                                           numberOfInstances);
+            std::unique_ptr<GraphicsPrimitiveV3fN3fC4ub> primitive(createInstancesPrimitive(trianglesPrimitive,
+                                                                                            matrices,
+                                                                                            rgba,
+                                                                                            iFirst,
+                                                                                            iLast - iFirst));
+            primitive->setUsageTypeAll(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_FEW_TIMES);
+            GraphicsEngineDataOpenGL::draw(primitive.get());
+        }
+        return;
+    }
+    
+    InstancesPrimitives* ip = new InstancesPrimitives();
+    ip->m_shapePrimitive = trianglesPrimitive;
+    ip->m_numberOfShapeVertices = numberOfShapeVertices;
+    ip->m_numberOfVertices = numberOfVertices;
+    ip->m_matrices.assign(matrices, matrices + numberOfInstances * 16);
+    ip->m_rgba.assign(rgba, rgba + numberOfInstances * 4);
+    for (int32_t iFirst = 0; iFirst < numberOfInstances; iFirst += instancesPerDraw) {
+        const int32_t iLast = std::min(iFirst + instancesPerDraw,
+                                       numberOfInstances);
+        GraphicsPrimitiveV3fN3fC4ub* primitive = createInstancesPrimitive(trianglesPrimitive,
+                                                                          matrices,
+                                                                          rgba,
+                                                                          iFirst,
+                                                                          iLast - iFirst);
+        primitive->setUsageTypeAll(GraphicsPrimitive::UsageType::MODIFIED_ONCE_DRAWN_MANY_TIMES);
+        ip->m_primitives.push_back(std::unique_ptr<GraphicsPrimitiveV3fN3fC4ub>(primitive));
+    }
+    s_instancesPrimitives.push_front(ip);
+    s_numberOfInstancesVerticesKept += numberOfVertices;
+    
+    for (auto& primitive : ip->m_primitives) {
+        GraphicsEngineDataOpenGL::draw(primitive.get());
+    }
+    
+    /*
+     * Remove least recently used instances, but never the ones just drawn
+     */
+    while ((s_numberOfInstancesVerticesKept > s_maximumInstancesVerticesKept)
+           && (s_instancesPrimitives.size() > 1)) {
+        InstancesPrimitives* lastIP = s_instancesPrimitives.back();
+        s_instancesPrimitives.pop_back();
+        s_numberOfInstancesVerticesKept -= lastIP->m_numberOfVertices;
+        delete lastIP;
+    }
+}
+
+/**
+ * Create a primitive containing instances of a shape, each with its
+ * own transformation and color.  Vertices are transformed by the
+ * instance's matrix.  Normal vectors are transformed by the cofactor
+ * matrix of the upper 3x3, which is the inverse transpose scaled by the
+ * determinant, so that non-uniform scaling is handled, and normalized.
+ *
+ * @param trianglesPrimitive
+ *     Primitive containing the shape's triangles with normal vectors.
+ * @param matrices
+ *     Transformation matrix for each instance in OpenGL (column-major)
+ *     order, as used by glMultMatrixf (16 elements per instance).
+ * @param rgba
+ *     RGBA color for each instance (4 elements per instance).
+ * @param firstInstance
+ *     Index of first instance placed into the primitive.
+ * @param numberOfInstances
+ *     Number of instances placed into the primitive.
+ * @return
+ *     Primitive with the instances' triangles.  Caller takes ownership.
+ */
+GraphicsPrimitiveV3fN3fC4ub*
+GraphicsShape::createInstancesPrimitive(const GraphicsPrimitive* trianglesPrimitive,
+                                        const float matrices[],
+                                        const uint8_t rgba[],
+                                        const int32_t firstInstance,
+                                        const int32_t numberOfInstances)
+{
+    CaretAssert(trianglesPrimitive);
+    CaretAssert(trianglesPrimitive->getPrimitiveType() == GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES);
+    
+    const std::vector<float>& shapeXYZ     = trianglesPrimitive->getFloatXYZ();
+    const std::vector<float>& shapeNormals = trianglesPrimitive->getFloatNormalVectorXYZ();
+    const int32_t numberOfShapeVertices = trianglesPrimitive->getNumberOfVertices();
+    const bool haveNormalsFlag = (shapeNormals.size() == shapeXYZ.size());
+    
+    GraphicsPrimitiveV3fN3fC4ub* primitive = GraphicsPrimitive::newPrimitiveV3fN3fC4ub(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES);
+    primitive->reserveForNumberOfVertices(numberOfInstances * numberOfShapeVertices);
+    
+    const int32_t iLast = firstInstance + numberOfInstances;
+    for (int32_t i = firstInstance; i < iLast; i++) {
+        const float* m = &matrices[i * 16];
+        const uint8_t* instanceRGBA = &rgba[i * 4];
+        
+        /*
+         * Columns of the cofactor matrix are cross products
+         * of the columns of the upper 3x3.
+         */
+        const float* c0 = &m[0];
+        const float* c1 = &m[4];
+        const float* c2 = &m[8];
+        float n0[3], n1[3], n2[3];
+        MathFunctions::crossProduct(c1, c2, n0);
+        MathFunctions::crossProduct(c2, c0, n1);
+        MathFunctions::crossProduct(c0, c1, n2);
+        const float determinant = MathFunctions::dotProduct(c0, n0);
+        const float normalSign = ((determinant < 0.0f) ? -1.0f : 1.0f);
+        
+        for (int32_t k = 0; k < numberOfShapeVertices; k++) {
+            const int32_t k3 = k * 3;
+            const float* v = &shapeXYZ[k3];
+            const float xyz[3] = {
+                m[0] * v[0] + m[4] * v[1] + m[8]  * v[2] + m[12],
+                m[1] * v[0] + m[5] * v[1] + m[9]  * v[2] + m[13],
+                m[2] * v[0] + m[6] * v[1] + m[10] * v[2] + m[14]
+            };
+            
+            float normal[3] = { 0.0f, 0.0f, 1.0f };
+            if (haveNormalsFlag) {
+                const float* n = &shapeNormals[k3];
+                normal[0] = normalSign * (n0[0] * n[0] + n1[0] * n[1] + n2[0] * n[2]);
+                normal[1] = normalSign * (n0[1] * n[0] + n1[1] * n[1] + n2[1] * n[2]);
+                normal[2] = normalSign * (n0[2] * n[0] + n1[2] * n[1] + n2[2] * n[2]);
+                MathFunctions::normalizeVector(normal);
+            }
+            
+            primitive->addVertex(xyz,
+                                 normal,
+                                 instanceRGBA);
+        }
+    }
+    
+    return primitive;
+}
+
 /**
  * Draw a filled circle at the given XYZ coordinate
  *
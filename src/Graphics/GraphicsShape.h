@@ -22,8 +22,10 @@
 /*LICENSE_END*/
 
 
+#include <list>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "CaretObject.h"
 #include "GraphicsPrimitive.h"
@@ -34,6 +36,7 @@ namespace caret {
 
     class GraphicsPrimitiveV3f;
     class GraphicsPrimitiveV3fN3f;
+    class GraphicsPrimitiveV3fN3fC4ub;
     
     class GraphicsShape : public CaretObject {
         
@@ -102,6 +105,22 @@ namespace caret {
                                          const uint8_t rgba[4],
                                          const float diameter);
         
+        static void drawSpheresByteColors(const float xyz[],
+                                          const uint8_t rgba[],
+                                          const int32_t numberOfSpheres,
+                                          const float diameter);
+        
+        static void drawInstancesByteColors(const GraphicsPrimitive* trianglesPrimitive,
+                                            const float matrices[],
+                                            const uint8_t rgba[],
+                                            const int32_t numberOfInstances);
+        
+        static GraphicsPrimitiveV3fN3fC4ub* createInstancesPrimitive(const GraphicsPrimitive* trianglesPrimitive,
+                                                                     const float matrices[],
+                                                                     const uint8_t rgba[],
+                                                                     const int32_t firstInstance,
+                                                                     const int32_t numberOfInstances);
+        
         static void drawCircleFilled(const float xyz[3],
                                      const uint8_t rgba[4],
                                      const float diameter);
@@ -197,6 +216,35 @@ namespace caret {
         
         static std::unique_ptr<GraphicsPrimitiveV3f> s_byteSquarePrimitive;
         
+        static std::unique_ptr<GraphicsPrimitiveV3fN3f> s_sphereTrianglesPrimitive;
+        
+        /**
+         * Primitives with the instances of a shape drawn with
+         * the matrices and colors used to create them
+         */
+        class InstancesPrimitives {
+        public:
+            const GraphicsPrimitive* m_shapePrimitive = NULL;
+            
+            int32_t m_numberOfShapeVertices = 0;
+            
+            int64_t m_numberOfVertices = 0;
+            
+            std::vector<float> m_matrices;
+            
+            std::vector<uint8_t> m_rgba;
+            
+            std::vector<std::unique_ptr<GraphicsPrimitiveV3fN3fC4ub>> m_primitives;
+        };
+        
+        /** Instances primitives with most recently drawn first */
+        static std::list<InstancesPrimitives*> s_instancesPrimitives;
+        
+        /** Vertices in all of the instances primitives */
+        static int64_t s_numberOfInstancesVerticesKept;
+        
+        static const int64_t s_maximumInstancesVerticesKept;
+        
         static std::map<int32_t, GraphicsPrimitive*> s_byteSpherePrimitives;
         
         static std::map<int32_t, GraphicsPrimitive*> s_byteCirclePrimitives;
@@ -213,6 +261,11 @@ namespace caret {
     std::map<int32_t, GraphicsPrimitive*> GraphicsShape::s_byteCirclePrimitives;
     std::map<GraphicsShape::RingKey, GraphicsPrimitive*> GraphicsShape::s_byteRingPrimitives;
     std::unique_ptr<GraphicsPrimitiveV3f> GraphicsShape::s_byteSquarePrimitive;
+    std::unique_ptr<GraphicsPrimitiveV3fN3f> GraphicsShape::s_sphereTrianglesPrimitive;
+    std::list<GraphicsShape::InstancesPrimitives*> GraphicsShape::s_instancesPrimitives;
+    int64_t GraphicsShape::s_numberOfInstancesVerticesKept = 0;
+    /* About 56MB of vertex data, enough for several thousand foci */
+    const int64_t GraphicsShape::s_maximumInstancesVerticesKept = 2 * 1024 * 1024;
 #endif // __GRAPHICS_SHAPE_DECLARE__
 
 } // namespace
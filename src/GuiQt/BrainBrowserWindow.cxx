@@ -2688,19 +2688,38 @@ BrainBrowserWindow::processShowIdentifyBrainordinateDialog()
 void
 BrainBrowserWindow::processDevelopGraphicsTiming()
 {
+    /*
+     * Also record the events sent while drawing so that the
+     * event types that dominate a redraw can be identified
+     */
+    EventManager* eventManager = EventManager::get();
+    const bool eventInstrumentationFlag = eventManager->isInstrumentationEnabled();
+    eventManager->setInstrumentationEnabled(true);
+    eventManager->resetInstrumentation();
+    
     ElapsedTimer et;
     et.start();
     
     const int32_t numTimes = 5;
     for (int32_t i = 0; i < numTimes; i++) {
-        EventManager::get()->sendEvent(EventGraphicsUpdateOneWindow(m_browserWindowIndex).getPointer());
+        eventManager->sendEvent(EventGraphicsUpdateOneWindow(m_browserWindowIndex).getPointer());
     }
     
     const float time = et.getElapsedTimeSeconds() / numTimes;
     const AString timeString = AString::number(time, 'f', 5);
     
+    eventManager->setInstrumentationEnabled(eventInstrumentationFlag);
+    CaretLogInfo("Events sent while drawing graphics "
+                 + AString::number(numTimes)
+                 + " times:\n"
+                 + eventManager->getInstrumentationReport());
+    
     const AString msg = ("Time to draw graphics (seconds): "
-                         + timeString);
+                         + timeString
+                         + "\n\nEvent types taking the most time, "
+                         + AString::number(numTimes)
+                         + " draws:\n"
+                         + eventManager->getInstrumentationReport(8));
     WuQMessageBox::informationOk(this, msg);
 }
 
@@ -172,6 +172,11 @@ MapSettingsColorBarPaletteOptionsWidget::applyToAllFilesToolButtonClicked()
             }
         }
         
+        /*
+         * Palette may have been copied to other files
+         */
+        EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+        
         updateColoringAndGraphics();
     }
 }
@@ -188,7 +193,11 @@ MapSettingsColorBarPaletteOptionsWidget::updateColoringAndGraphics()
     else {
         m_mapFile->updateScalarColoringForMap(m_mapFileIndex);
     }
-    EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+    
+    /*
+     * Only coloring from this file is invalid
+     */
+    EventManager::get()->sendEvent(EventSurfaceColoringInvalidate(m_mapFile).getPointer());
     EventManager::get()->sendEvent(EventGraphicsUpdateAllWindows().getPointer());
 }
 
@@ -22,8 +22,10 @@
 #include "OperationException.h"
 
 #include "CaretAssert.h"
+#include "CaretOMP.h"
 #include "CaretPointer.h"
 #include "CiftiFile.h"
+#include "CiftiGroupBlockReader.h"
 
 #include <algorithm>
 
@@ -140,7 +142,7 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         default:
             CaretAssert(false);
     }
-    int64_t curCol = 0, scratchRowLength = 0;
+    int64_t curCol = 0;
     for (int i = 0; i < numInputs; ++i)
     {
         const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
@@ -150,7 +152,6 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
         int numColumnOpts = (int)columnOpts.size();
         if (numColumnOpts > 0)
         {
-            scratchRowLength = max(scratchRowLength, thisXML.getDimensionLength(CiftiXML::ALONG_ROW));//if we use the entire row, we don't need a separate scratch row for it
             if (doLoop)
             {
                 for (int j = 0; j < numColumnOpts; ++j)
@@ -256,53 +257,79 @@ void OperationCiftiMerge::useParameters(OperationParameters* myParams, ProgressO
     }
     ciftiOut->setCiftiXML(outXML);
     int64_t numRows = baseColMapping.getLength();
-    vector<float> outRow(numOutColumns), scratchRow(scratchRowLength);
-    for (int64_t row = 0; row < numRows; ++row)
+    vector<vector<int64_t> > inputColumns(numInputs);//work out the column selections once, rather than parsing them again for every row
+    vector<const CiftiFile*> inputFiles(numInputs);
+    for (int i = 0; i < numInputs; ++i)
+    {
+        inputFiles[i] = myInputs[i]->getCifti(1);
+    }
+    CiftiGroupBlockReader myReader(inputFiles, numOutColumns * sizeof(float));
+    for (int i = 0; i < numInputs; ++i)
     {
-        curCol = 0;
-        for (int i = 0; i < numInputs; ++i)
+        const CiftiXML& thisXML = inputFiles[i]->getCiftiXML();
+        const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
+        int numColumnOpts = (int)columnOpts.size();
+        if (numColumnOpts > 0)
         {
-            const CiftiFile* ciftiIn = myInputs[i]->getCifti(1);
-            vector<int64_t> thisDims = ciftiIn->getDimensions();
-            const CiftiXML& thisXML = ciftiIn->getCiftiXML();
-            const vector<ParameterComponent*>& columnOpts = *(myInputs[i]->getRepeatableParameterInstances(2));
-            int numColumnOpts = (int)columnOpts.size();
-            if (numColumnOpts > 0)
+            for (int j = 0; j < numColumnOpts; ++j)
             {
-                ciftiIn->getRow(scratchRow.data(), row);
-                for (int j = 0; j < numColumnOpts; ++j)
+                int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
+                OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
+                if (upToOpt->m_present)
                 {
-                    int64_t initialColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(columnOpts[j]->getString(1));//this function has the 1-indexing convention built in
-                    OptionalParameter* upToOpt = columnOpts[j]->getOptionalParameter(2);//we already checked that these strings give a valid column
-                    if (upToOpt->m_present)
+                    int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
+                    bool reverse = upToOpt->getOptionalParameter(2)->m_present;
+                    if (reverse)
                     {
-                        int finalColumn = thisXML.getMap(CiftiXML::ALONG_ROW)->getIndexFromNumberOrName(upToOpt->getString(1));//ditto
-                        bool reverse = upToOpt->getOptionalParameter(2)->m_present;
-                        if (reverse)
+                        for (int c = finalColumn; c >= initialColumn; --c)
                         {
-                            for (int c = finalColumn; c >= initialColumn; --c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
-                        } else {
-                            for (int c = initialColumn; c <= finalColumn; ++c)
-                            {
-                                outRow[curCol] = scratchRow[c];
-                                ++curCol;
-                            }
+                            inputColumns[i].push_back(c);
                         }
                     } else {
-                        outRow[curCol] = scratchRow[initialColumn];
-                        ++curCol;
+                        for (int c = initialColumn; c <= finalColumn; ++c)
+                        {
+                            inputColumns[i].push_back(c);
+                        }
                     }
+                } else {
+                    inputColumns[i].push_back(initialColumn);
+                }
+            }
+        } else {
+            for (int64_t c = 0; c < myReader.getRowLength(i); ++c)
+            {
+                inputColumns[i].push_back(c);
+            }
+        }
+    }
+    int64_t blockRows = myReader.getBlockRows();
+    vector<float> outBlock;
+    for (int64_t startRow = 0; startRow < numRows; startRow += blockRows)
+    {
+        int64_t thisBlockRows = min(blockRows, numRows - startRow);
+        myReader.readBlock(startRow, thisBlockRows);
+        outBlock.resize(thisBlockRows * numOutColumns);
+#pragma omp CARET_PARFOR schedule(dynamic)
+        for (int64_t row = 0; row < thisBlockRows; ++row)
+        {
+            float* outRow = outBlock.data() + row * numOutColumns;
+            int64_t outCol = 0;
+            for (int i = 0; i < numInputs; ++i)
+            {
+                const float* inRow = myReader.getBlockData(i) + row * myReader.getRowLength(i);
+                const vector<int64_t>& thisColumns = inputColumns[i];
+                int64_t numSelected = (int64_t)thisColumns.size();
+                for (int64_t c = 0; c < numSelected; ++c)
+                {
+                    outRow[outCol + c] = inRow[thisColumns[c]];
                 }
-            } else {
-                ciftiIn->getRow(outRow.data() + curCol, row);
-                curCol += thisDims[0];
+                outCol += numSelected;
             }
+            CaretAssert(outCol == numOutColumns);
+        }
+        for (int64_t row = 0; row < thisBlockRows; ++row)
+        {
+            ciftiOut->setRow(outBlock.data() + row * numOutColumns, startRow + row);
         }
-        CaretAssert(curCol == numOutColumns);
-        ciftiOut->setRow(outRow.data(), row);
     }
 }
@@ -171,15 +171,7 @@ void OperationConvertMatrix4ToWorkbenchSparse::useParameters(OperationParameters
     }
     if ((int64_t)voxelIndices.size() != sparseDims[0] * 3) throw OperationException("voxel list file contains the wrong number of voxels, expected " +
                                                                                     AString::number(sparseDims[0] * 3) + " integers, read " + AString::number(voxelIndices.size()));
-    vector<int64_t> rowReorder(sparseDims[0], -1);
-    for (int64_t i = 0; i < (int64_t)voxelIndices.size(); i += 3)
-    {
-        int64_t tempInd = rowMap.getIndexForVoxel(voxelIndices.data() + i);
-        if (tempInd != -1)
-        {
-            rowReorder[i / 3] = tempInd;
-        }
-    }
+    vector<int64_t> rowReorder = rowMap.getIndicesForVoxels(voxelIndices);//-1 for voxels not in the map
     CaretSparseFileWriter mywriter(outFileName, myXML);//NOTE: CaretSparseFile has a different encoding of fibers, ALWAYS use getFibersRow, etc
     vector<int64_t> indicesIn, indicesOut;//this method knows about sparseness, does sorting of indexes in order to avoid scanning full rows
     vector<FiberFractions> fibersIn, fibersOut;//can be slower if matrix isn't very sparse, but that is a problem for other reasons anyway
@@ -19,6 +19,7 @@
  */
 /*LICENSE_END*/
 
+#include <algorithm>
 #include <cstdio>
 #include <fstream>
 
@@ -42,7 +43,9 @@
 #include "CaretAssert.h"
 #include "CaretPreferences.h"
 #include "CaretLogger.h"
+#include "CaretOMP.h"
 #include "DataFileException.h"
+#include "ElapsedTimer.h"
 #include "EventBrowserTabGet.h"
 #include "EventBrowserWindowContent.h"
 #include "EventMapYokingSelectMap.h"
@@ -124,6 +127,16 @@ OperationShowScene::getParameters()
     connDbOpt->addStringParameter(1, "Username", "Connectome DB Username");
     connDbOpt->addStringParameter(2, "Password", "Connectome DB Password");
     
+    const QString sceneRangeSwitch("-scene-range");
+    OptionalParameter* sceneRangeOpt = ret->createOptionalParameter(10, sceneRangeSwitch, "Show a range of scenes instead of the scene given by scene-name-or-number");
+    sceneRangeOpt->addIntegerParameter(1, "first", "number (starting at one) of the first scene");
+    sceneRangeOpt->addIntegerParameter(2, "last", "number (starting at one) of the last scene");
+    
+    const QString sceneSwitch("-scene");
+    ParameterComponent* sceneOpt = ret->createRepeatableParameter(11, sceneSwitch, "Show an additional scene from the scene file");
+    sceneOpt->addStringParameter(1, "scene-name-or-number", "name or number (starting at one) of the scene in the scene file");
+    sceneOpt->addStringParameter(2, "image-file-name", "output image file name for the scene");
+    
     AString helpText("Render content of browser windows displayed in a scene "
                      "into image file(s).  The image file name should be "
                      "similar to \"capture.png\".  If there is only one image "
@@ -168,6 +181,18 @@ OperationShowScene::getParameters()
                  "      of the graphics region, the width and height specified\n"
                  "      on the command line is used for the size of the \n"
                  "      output image.\n"
+                 "\n"
+                 "Many scenes from the scene file are shown by one command using\n"
+                 "the \"" + sceneRangeSwitch + "\" option and/or the \"" + sceneSwitch + "\" option.  With \"" + sceneRangeSwitch + "\",\n"
+                 "the scene number is inserted into the image name, so scenes 8 to 12\n"
+                 "with image name \"capture.png\" produce \"capture_08.png\" to \n"
+                 "\"capture_12.png\".  Data files that are used by consecutive scenes\n"
+                 "and are not modified by a scene are read only one time, so ordering\n"
+                 "scenes by the data they use is fastest.  Images are written in \n"
+                 "parallel while the following scenes are drawn.  When more than one\n"
+                 "scene is shown, a scene that fails does not stop the remaining\n"
+                 "scenes and the time taken and number of images per minute are\n"
+                 "printed when all scenes have been shown.\n"
                  );
     
     
@@ -255,345 +280,494 @@ OperationShowScene::useParameters(OperationParameters* myParams,
                                                      password);
 
     /*
-     * Read the scene file and load the scene
+     * Read the scene file and find the scenes that are shown
+     * along with the name of the image file for each scene
      */
     SceneFile sceneFile;
     sceneFile.readFile(sceneFileName);
-    Scene* scene = sceneFile.getSceneWithName(sceneNameOrNumber);
-    if (scene == NULL) {
-        bool valid = false;
-        const int32_t sceneIndexStartAtOne = sceneNameOrNumber.toInt(&valid);
-        if (valid) {
-            const int32_t sceneIndex = sceneIndexStartAtOne - 1;
-            if ((sceneIndex >= 0)
-                && (sceneIndex < sceneFile.getNumberOfScenes())) {
-                scene = sceneFile.getSceneAtIndex(sceneIndex);
-            }
-            else {
-                throw OperationException("Scene index is invalid");
-            }
+    
+    std::vector<std::pair<Scene*, AString> > scenesAndImageNames;
+    OptionalParameter* sceneRangeOpt = myParams->getOptionalParameter(10);
+    if (sceneRangeOpt->m_present) {
+        const int32_t firstSceneNumber = static_cast<int32_t>(sceneRangeOpt->getInteger(1));
+        const int32_t lastSceneNumber  = static_cast<int32_t>(sceneRangeOpt->getInteger(2));
+        if ((firstSceneNumber < 1)
+            || (lastSceneNumber > sceneFile.getNumberOfScenes())
+            || (firstSceneNumber > lastSceneNumber)) {
+            throw OperationException("Scene range "
+                                     + AString::number(firstSceneNumber)
+                                     + " to "
+                                     + AString::number(lastSceneNumber)
+                                     + " is invalid, scene file contains "
+                                     + AString::number(sceneFile.getNumberOfScenes())
+                                     + " scenes");
         }
-        else {
-            throw OperationException("Scene name is invalid");
+        const int32_t numberWidth = AString::number(lastSceneNumber).length();
+        for (int32_t sceneNumber = firstSceneNumber; sceneNumber <= lastSceneNumber; sceneNumber++) {
+            scenesAndImageNames.push_back(std::make_pair(sceneFile.getSceneAtIndex(sceneNumber - 1),
+                                                         insertNumberIntoFileName(imageFileName,
+                                                                                  sceneNumber,
+                                                                                  numberWidth)));
         }
     }
-    
-    /*
-     * Enable voxel coloring since it is defaulted off for commands
-     */
-    VolumeFile::setVoxelColoringEnabled(true);
-    
-    SceneAttributes sceneAttributes(SceneTypeEnum::SCENE_TYPE_FULL,
-                                    scene);
-    
-    if (doNotUseSceneColorsFlag) {
-        sceneAttributes.setUseSceneForegroundAndBackgroundColors(false);
+    else {
+        scenesAndImageNames.push_back(std::make_pair(getSceneWithNameOrNumber(sceneFile,
+                                                                              sceneNameOrNumber),
+                                                     imageFileName));
     }
     
-    /*
-     * Restore the scene
-     */
-    const SceneClass* guiManagerClass = scene->getClassWithName("guiManager");
-    if (guiManagerClass->getName() != "guiManager") {
-        throw OperationException("Top level scene class should be guiManager but it is: "
-                                 + guiManagerClass->getName());
+    const std::vector<ParameterComponent*>& sceneInstances = *(myParams->getRepeatableParameterInstances(11));
+    for (std::vector<ParameterComponent*>::const_iterator iter = sceneInstances.begin();
+         iter != sceneInstances.end();
+         iter++) {
+        ParameterComponent* sceneInstance = *iter;
+        scenesAndImageNames.push_back(std::make_pair(getSceneWithNameOrNumber(sceneFile,
+                                                                              sceneInstance->getString(1)),
+                                                     FileInformation(sceneInstance->getString(2)).getAbsoluteFilePath()));
     }
     
-    SessionManager* sessionManager = SessionManager::get();
-    sessionManager->restoreFromScene(&sceneAttributes,
-                                     guiManagerClass->getClass("m_sessionManager"));
+    const int32_t numberOfScenes = static_cast<int32_t>(scenesAndImageNames.size());
+    CaretAssert(numberOfScenes > 0);
     
     /*
-     * Get the error message but continue processing since the error
-     * may not affect the scene.  Print error message later.
+     * Enable voxel coloring since it is defaulted off for commands
      */
-    const AString sceneErrorMessage = sceneAttributes.getErrorMessage();
-    
-    if (sessionManager->getNumberOfBrains() <= 0) {
-        throw OperationException("Scene loading failure, SessionManager contains no Brains");
-    }
-    Brain* brain = SessionManager::get()->getBrain(0);
-    
-    const GapsAndMargins* gapsAndMargins = brain->getGapsAndMargins();
-    
-    bool missingWindowMessageHasBeenDisplayed = false;
+    VolumeFile::setVoxelColoringEnabled(true);
     
     /*
-     * Apply map yoking
+     * The Mesa context and the OpenGL rendering are created once and
+     * used for all scenes so that graphics data (buffers, textures)
+     * of files shared by scenes is not recreated for each scene.
+     * Images are encoded and written in parallel, in groups of one
+     * image per thread, while later scenes are restored and drawn.
      */
-    if (mapYokingGroup != MapYokingGroupEnum::MAP_YOKING_GROUP_OFF) {
-        MapYokingGroupEnum::setSelectedMapIndex(mapYokingGroup, mapYokingMapIndex);
-        
-        EventMapYokingSelectMap yokeEvent(mapYokingGroup,
-                                          NULL,
-                                          mapYokingMapIndex,
-                                          true);
-        EventManager::get()->sendEvent(yokeEvent.getPointer());
-    }
+    OSMesaContext mesaContext = 0;
+    CaretPointer<BrainOpenGL> brainOpenGL;
+    std::vector<unsigned char> imageBuffer;
+    std::vector<ImageToWrite> imagesToWrite;
+    int32_t maximumImagesToWrite = 1;
+#ifdef CARET_OMP
+    maximumImagesToWrite = std::max(1, omp_get_max_threads());
+#endif
     
-    std::vector<const BrowserWindowContent*> allBrowserWindowContent;
-    for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_WINDOWS; i++) {
-        std::unique_ptr<EventBrowserWindowContent> browserContentEvent = EventBrowserWindowContent::getWindowContent(i);
-        EventManager::get()->sendEvent(browserContentEvent->getPointer());
-        const BrowserWindowContent* bwc = browserContentEvent->getBrowserWindowContent();
-        CaretAssert(bwc);
-        if (bwc->isValid()) {
-            allBrowserWindowContent.push_back(bwc);
-        }
-    }
-    const int32_t numberOfWindows = static_cast<int32_t>(allBrowserWindowContent.size());
-    if (numberOfWindows <= 0) {
-        throw OperationException("No BrowserWindowContent was found for showing as scene");
-    }
+    ElapsedTimer timer;
+    timer.start();
+    int32_t numberOfImages = 0;
+    AString failedScenesMessage;
+    int32_t numberOfFailedScenes = 0;
     
-    /*
-     * Restore windows
-     */
-    for (int32_t iWindow = 0; iWindow < numberOfWindows; iWindow++) {
-        CaretAssertVectorIndex(allBrowserWindowContent, iWindow);
-        const auto bwc = allBrowserWindowContent[iWindow];
+    for (int32_t iScene = 0; iScene < numberOfScenes; iScene++) {
+        Scene* scene = scenesAndImageNames[iScene].first;
+        CaretAssert(scene);
+        const AString sceneImageFileName = scenesAndImageNames[iScene].second;
         
-        const bool restoreToTabTiles = bwc->isTileTabsEnabled();
-        const int32_t windowIndex = bwc->getWindowIndex();
-        
-        int32_t imageWidth  = userImageWidth;
-        int32_t imageHeight = userImageHeight;
-        
-        if (useWindowSizeForImageSizeFlag) {
+        try {
+            SceneAttributes sceneAttributes(SceneTypeEnum::SCENE_TYPE_FULL,
+                                            scene);
+            
+            if (doNotUseSceneColorsFlag) {
+                sceneAttributes.setUseSceneForegroundAndBackgroundColors(false);
+            }
+            
             /*
-             * Requires version AFTER 1.2.0-pre1
+             * Restore the scene.  Files that are not modified and are used by
+             * the previous scene are kept by the Brain and are not read again.
              */
-            const float geomWidth = bwc->getSceneGraphicsWidth();
-            const float geomHeight = bwc->getSceneGraphicsHeight();
-            if ((geomWidth > 0)
-                && (geomHeight > 0)) {
-                imageWidth = geomWidth;
-                imageHeight = geomHeight;
+            const SceneClass* guiManagerClass = scene->getClassWithName("guiManager");
+            if (guiManagerClass->getName() != "guiManager") {
+                throw OperationException("Top level scene class should be guiManager but it is: "
+                                         + guiManagerClass->getName());
             }
-            else {
-                if ((imageWidth <= 0)
-                    || (imageHeight <= 0)) {
-                    const QString msg("Option "
-                                      + useWindowSizeParam->m_optionSwitch
-                                      + " is used but window size not found in scene and width="
-                                      + QString::number(imageWidth)
-                                      + " height="
-                                      + QString::number(imageWidth)
-                                      + " on command line is invalid.");
-                    
-                    throw OperationException(msg);
+            
+            SessionManager* sessionManager = SessionManager::get();
+            sessionManager->restoreFromScene(&sceneAttributes,
+                                             guiManagerClass->getClass("m_sessionManager"));
+            
+            /*
+             * Get the error message but continue processing since the error
+             * may not affect the scene.  Print error message later.
+             */
+            const AString sceneErrorMessage = sceneAttributes.getErrorMessage();
+            
+            if (sessionManager->getNumberOfBrains() <= 0) {
+                throw OperationException("Scene loading failure, SessionManager contains no Brains");
+            }
+            Brain* brain = SessionManager::get()->getBrain(0);
+            
+            const GapsAndMargins* gapsAndMargins = brain->getGapsAndMargins();
+            
+            bool missingWindowMessageHasBeenDisplayed = false;
+            
+            /*
+             * Apply map yoking
+             */
+            if (mapYokingGroup != MapYokingGroupEnum::MAP_YOKING_GROUP_OFF) {
+                MapYokingGroupEnum::setSelectedMapIndex(mapYokingGroup, mapYokingMapIndex);
+                
+                EventMapYokingSelectMap yokeEvent(mapYokingGroup,
+                                                  NULL,
+                                                  mapYokingMapIndex,
+                                                  true);
+                EventManager::get()->sendEvent(yokeEvent.getPointer());
+            }
+            
+            std::vector<const BrowserWindowContent*> allBrowserWindowContent;
+            for (int32_t i = 0; i < BrainConstants::MAXIMUM_NUMBER_OF_BROWSER_WINDOWS; i++) {
+                std::unique_ptr<EventBrowserWindowContent> browserContentEvent = EventBrowserWindowContent::getWindowContent(i);
+                EventManager::get()->sendEvent(browserContentEvent->getPointer());
+                const BrowserWindowContent* bwc = browserContentEvent->getBrowserWindowContent();
+                CaretAssert(bwc);
+                if (bwc->isValid()) {
+                    allBrowserWindowContent.push_back(bwc);
                 }
+            }
+            const int32_t numberOfWindows = static_cast<int32_t>(allBrowserWindowContent.size());
+            if (numberOfWindows <= 0) {
+                throw OperationException("No BrowserWindowContent was found for showing as scene");
+            }
+            
+            /*
+             * Restore windows
+             */
+            for (int32_t iWindow = 0; iWindow < numberOfWindows; iWindow++) {
+                CaretAssertVectorIndex(allBrowserWindowContent, iWindow);
+                const auto bwc = allBrowserWindowContent[iWindow];
                 
-                if ( ! missingWindowMessageHasBeenDisplayed) {
-                    const QString msg("Option \""
-                                      + useWindowSizeParam->m_optionSwitch
-                                      + "\" is used but window size not found in scene.\n"
-                                      "   Scene was created prior to implementation of this option.\n"
-                                      "   Image size will be width="
-                                      + QString::number(imageWidth)
-                                      + " and height="
-                                      + QString::number(imageHeight)
-                                      + " as specified on command line.\n"
-                                      "   Recreating the scene will allow use of the option.\n");
-                    CaretLogWarning(msg);
-                    
+                const bool restoreToTabTiles = bwc->isTileTabsEnabled();
+                const int32_t windowIndex = bwc->getWindowIndex();
+                
+                int32_t imageWidth  = userImageWidth;
+                int32_t imageHeight = userImageHeight;
+                
+                if (useWindowSizeForImageSizeFlag) {
                     /*
-                     * Avoid message being displayed more than once when
-                     * there are more than one windows.
+                     * Requires version AFTER 1.2.0-pre1
                      */
-                    missingWindowMessageHasBeenDisplayed = true;
+                    const float geomWidth = bwc->getSceneGraphicsWidth();
+                    const float geomHeight = bwc->getSceneGraphicsHeight();
+                    if ((geomWidth > 0)
+                        && (geomHeight > 0)) {
+                        imageWidth = geomWidth;
+                        imageHeight = geomHeight;
+                    }
+                    else {
+                        if ((imageWidth <= 0)
+                            || (imageHeight <= 0)) {
+                            const QString msg("Option "
+                                              + useWindowSizeParam->m_optionSwitch
+                                              + " is used but window size not found in scene and width="
+                                              + QString::number(imageWidth)
+                                              + " height="
+                                              + QString::number(imageWidth)
+                                              + " on command line is invalid.");
+                            
+                            throw OperationException(msg);
+                        }
+                        
+                        if ( ! missingWindowMessageHasBeenDisplayed) {
+                            const QString msg("Option \""
+                                              + useWindowSizeParam->m_optionSwitch
+                                              + "\" is used but window size not found in scene.\n"
+                                              "   Scene was created prior to implementation of this option.\n"
+                                              "   Image size will be width="
+                                              + QString::number(imageWidth)
+                                              + " and height="
+                                              + QString::number(imageHeight)
+                                              + " as specified on command line.\n"
+                                              "   Recreating the scene will allow use of the option.\n");
+                            CaretLogWarning(msg);
+                            
+                            /*
+                             * Avoid message being displayed more than once when
+                             * there are more than one windows.
+                             */
+                            missingWindowMessageHasBeenDisplayed = true;
+                        }
+                    }
                 }
-            }
-        }
-        
-        if ((imageWidth <= 0)
-            || (imageHeight <= 0)) {
-            throw OperationException("Invalid image size width="
-                                     + QString::number(imageWidth)
-                                     + " height="
-                                     + QString::number(imageHeight));
-        }
-        
-        int windowViewport[4] = { 0, 0, imageWidth, imageHeight };
-        
-        const int windowWidth  = windowViewport[2];
-        const int windowHeight = windowViewport[3];
-        
-        //
-        // Create the Mesa Context
-        //
-        const int depthBits = 16;
-        const int stencilBits = 0;
-        const int accumBits = 0;
-        OSMesaContext mesaContext = OSMesaCreateContextExt(OSMESA_RGBA,
-                                                           depthBits,
-                                                           stencilBits,
-                                                           accumBits,
-                                                           NULL);
-        if (mesaContext == 0) {
-            throw ("Creating Mesa Context failed.");
-        }
-        
-        //
-        // Allocate image buffer
-        //
-        const int32_t imageBufferSize =imageWidth * imageHeight * 4 * sizeof(unsigned char);
-        unsigned char* imageBuffer = new unsigned char[imageBufferSize];
-        if (imageBuffer == 0) {
-            throw OperationException("Allocating image buffer size="
-                                     + QString::number(imageBufferSize)
-                                     + " failed.");
-        }
-        
-        //
-        // Assign buffer to Mesa Context and make current
-        //
-        if (OSMesaMakeCurrent(mesaContext,
-                              imageBuffer,
-                              GL_UNSIGNED_BYTE,
-                              imageWidth,
-                              imageHeight) == 0) {
-            throw OperationException("Assigning buffer to context and make current failed.");
-        }
-        
-        /*
-         * If tile tabs was saved to the scene, restore it as the scenes tile tabs configuration
-         */
-        if (restoreToTabTiles) {
-            CaretPointer<BrainOpenGL> brainOpenGL(createBrainOpenGL());
-            
-            TileTabsConfiguration* tileTabsConfiguration = bwc->getSceneTileTabsConfiguration();
-            CaretAssert(tileTabsConfiguration);
-            if ((tileTabsConfiguration->getMaximumNumberOfRows() > 0)
-                && (tileTabsConfiguration->getMaximumNumberOfColumns() > 0)) {
                 
-                const std::vector<int32_t> tabIndices = bwc->getSceneTabIndices();
-                if ( ! tabIndices.empty()) {
-                    std::vector<BrowserTabContent*> allTabContent;
-                    const int32_t numTabs = static_cast<int32_t>(tabIndices.size());
-                    for (int32_t iTab = 0; iTab < numTabs; iTab++) {
-                        CaretAssertVectorIndex(tabIndices, iTab);
-                        const int32_t tabIndex = tabIndices[iTab];
-                        EventBrowserTabGet getTabContent(tabIndex);
-                        EventManager::get()->sendEvent(getTabContent.getPointer());
-                        BrowserTabContent* tabContent = getTabContent.getBrowserTab();
-                        if (tabContent == NULL) {
-                            throw OperationException("Failed to obtain tab number "
-                                                     + AString::number(tabIndex + 1)
-                                                     + " for window "
-                                                     + AString::number(windowIndex + 1));
+                if ((imageWidth <= 0)
+                    || (imageHeight <= 0)) {
+                    throw OperationException("Invalid image size width="
+                                             + QString::number(imageWidth)
+                                             + " height="
+                                             + QString::number(imageHeight));
+                }
+                
+                int windowViewport[4] = { 0, 0, imageWidth, imageHeight };
+                
+                const int windowWidth  = windowViewport[2];
+                const int windowHeight = windowViewport[3];
+                
+                //
+                // Create the Mesa Context
+                //
+                if (mesaContext == 0) {
+                    const int depthBits = 16;
+                    const int stencilBits = 0;
+                    const int accumBits = 0;
+                    mesaContext = OSMesaCreateContextExt(OSMESA_RGBA,
+                                                         depthBits,
+                                                         stencilBits,
+                                                         accumBits,
+                                                         NULL);
+                    if (mesaContext == 0) {
+                        throw OperationException("Creating Mesa Context failed.");
+                    }
+                }
+                
+                //
+                // Allocate image buffer
+                //
+                const int64_t imageBufferSize = (static_cast<int64_t>(imageWidth) * imageHeight
+                                                 * 4 * sizeof(unsigned char));
+                try {
+                    imageBuffer.resize(imageBufferSize);
+                }
+                catch (const std::bad_alloc&) {
+                    throw OperationException("Allocating image buffer size="
+                                             + QString::number(imageBufferSize)
+                                             + " failed.");
+                }
+                
+                //
+                // Assign buffer to Mesa Context and make current
+                //
+                if (OSMesaMakeCurrent(mesaContext,
+                                      &imageBuffer[0],
+                                      GL_UNSIGNED_BYTE,
+                                      imageWidth,
+                                      imageHeight) == 0) {
+                    throw OperationException("Assigning buffer to context and make current failed.");
+                }
+                
+                if (brainOpenGL.getPointer() == NULL) {
+                    brainOpenGL.grabNew(createBrainOpenGL());
+                }
+                
+                const int32_t outputImageIndex = ((numberOfWindows > 1)
+                                                  ? iWindow
+                                                  : -1);
+                
+                /*
+                 * If tile tabs was saved to the scene, restore it as the scenes tile tabs configuration
+                 */
+                if (restoreToTabTiles) {
+                    TileTabsConfiguration* tileTabsConfiguration = bwc->getSceneTileTabsConfiguration();
+                    CaretAssert(tileTabsConfiguration);
+                    if ((tileTabsConfiguration->getMaximumNumberOfRows() > 0)
+                        && (tileTabsConfiguration->getMaximumNumberOfColumns() > 0)) {
+                        
+                        const std::vector<int32_t> tabIndices = bwc->getSceneTabIndices();
+                        if ( ! tabIndices.empty()) {
+                            std::vector<BrowserTabContent*> allTabContent;
+                            const int32_t numTabs = static_cast<int32_t>(tabIndices.size());
+                            for (int32_t iTab = 0; iTab < numTabs; iTab++) {
+                                CaretAssertVectorIndex(tabIndices, iTab);
+                                const int32_t tabIndex = tabIndices[iTab];
+                                EventBrowserTabGet getTabContent(tabIndex);
+                                EventManager::get()->sendEvent(getTabContent.getPointer());
+                                BrowserTabContent* tabContent = getTabContent.getBrowserTab();
+                                if (tabContent == NULL) {
+                                    throw OperationException("Failed to obtain tab number "
+                                                             + AString::number(tabIndex + 1)
+                                                             + " for window "
+                                                             + AString::number(windowIndex + 1));
+                                }
+                                allTabContent.push_back(tabContent);
+                            }
+                            
+                            const int32_t numTabContent = static_cast<int32_t>(allTabContent.size());
+                            if (numTabContent <= 0) {
+                                throw OperationException("Failed to find any tab content");
+                            }
+                            std::vector<int32_t> rowHeights;
+                            std::vector<int32_t> columnWidths;
+                            if ( ! tileTabsConfiguration->getRowHeightsAndColumnWidthsForWindowSize(windowWidth,
+                                                                                                    windowHeight,
+                                                                                                    numTabContent,
+                                                                                                    rowHeights,
+                                                                                                    columnWidths)) {
+                                throw OperationException("Tile Tabs Row/Column sizing failed !!!");
+                            }
+                            
+                            const int32_t tabIndexToHighlight = -1;
+                            std::vector<BrainOpenGLViewportContent*> viewports =
+                            BrainOpenGLViewportContent::createViewportContentForTileTabs(allTabContent,
+                                                                                         tileTabsConfiguration,
+                                                                                         gapsAndMargins,
+                                                                                         windowIndex,
+                                                                                         windowViewport,
+                                                                                         tabIndexToHighlight);
+                            
+                            std::vector<const BrainOpenGLViewportContent*> constViewports(viewports.begin(),
+                                                                                          viewports.end());
+                            brainOpenGL->drawModels(windowIndex,
+                                                    brain,
+                                                    mesaContext,
+                                                    constViewports);
+                            
+                            imagesToWrite.push_back(ImageToWrite(sceneImageFileName,
+                                                                 outputImageIndex,
+                                                                 imageBuffer,
+                                                                 imageWidth,
+                                                                 imageHeight));
+                            
+                            for (std::vector<BrainOpenGLViewportContent*>::iterator vpIter = viewports.begin();
+                                 vpIter != viewports.end();
+                                 vpIter++) {
+                                delete *vpIter;
+                            }
+                            viewports.clear();
                         }
-                        allTabContent.push_back(tabContent);
                     }
-                    
-                    const int32_t numTabContent = static_cast<int32_t>(allTabContent.size());
-                    if (numTabContent <= 0) {
-                        throw OperationException("Failed to find any tab content");
+                    else {
+                        throw OperationException("Tile tabs configuration is corrupted.");
                     }
-                    std::vector<int32_t> rowHeights;
-                    std::vector<int32_t> columnWidths;
-                    if ( ! tileTabsConfiguration->getRowHeightsAndColumnWidthsForWindowSize(windowWidth,
-                                                                                            windowHeight,
-                                                                                            numTabContent,
-                                                                                            rowHeights,
-                                                                                            columnWidths)) {
-                        throw OperationException("Tile Tabs Row/Column sizing failed !!!");
+                }
+                else {
+                    const int32_t selectedTabIndex = bwc->getSceneSelectedTabIndex();
+                    
+                    EventBrowserTabGet getTabContent(selectedTabIndex);
+                    EventManager::get()->sendEvent(getTabContent.getPointer());
+                    BrowserTabContent* tabContent = getTabContent.getBrowserTab();
+                    if (tabContent == NULL) {
+                        throw OperationException("Failed to obtain tab number "
+                                                 + AString::number(selectedTabIndex + 1)
+                                                 + " for window "
+                                                 + AString::number(iWindow + 1));
                     }
                     
-                    const int32_t tabIndexToHighlight = -1;
-                    std::vector<BrainOpenGLViewportContent*> viewports =
-                    BrainOpenGLViewportContent::createViewportContentForTileTabs(allTabContent,
-                                                                                 tileTabsConfiguration,
-                                                                                 gapsAndMargins,
-                                                                                 windowIndex,
-                                                                                 windowViewport,
-                                                                                 tabIndexToHighlight);
+                    CaretPointer<BrainOpenGLViewportContent> content(NULL);
+                    std::vector<BrowserTabContent*> allTabs;
+                    allTabs.push_back(tabContent);
+                    content.grabNew(BrainOpenGLViewportContent::createViewportForSingleTab(allTabs,
+                                                                                           tabContent,
+                                                                                           gapsAndMargins,
+                                                                                           windowIndex,
+                                                                                           windowViewport));
+                    std::vector<const BrainOpenGLViewportContent*> viewportContents;
+                    viewportContents.push_back(content);
                     
-                    std::vector<const BrainOpenGLViewportContent*> constViewports(viewports.begin(),
-                                                                                  viewports.end());
                     brainOpenGL->drawModels(windowIndex,
                                             brain,
                                             mesaContext,
-                                            constViewports);
+                                            viewportContents);
                     
-                    const int32_t outputImageIndex = ((numberOfWindows > 1)
-                                                      ? iWindow
-                                                      : -1);
-                    
-                    writeImage(imageFileName,
-                               outputImageIndex,
-                               imageBuffer,
-                               imageWidth,
-                               imageHeight);
-                    
-                    for (std::vector<BrainOpenGLViewportContent*>::iterator vpIter = viewports.begin();
-                         vpIter != viewports.end();
-                         vpIter++) {
-                        delete *vpIter;
-                    }
-                    viewports.clear();
+                    imagesToWrite.push_back(ImageToWrite(sceneImageFileName,
+                                                         outputImageIndex,
+                                                         imageBuffer,
+                                                         imageWidth,
+                                                         imageHeight));
+                }
+                
+                numberOfImages++;
+                if (static_cast<int32_t>(imagesToWrite.size()) >= maximumImagesToWrite) {
+                    writeImages(imagesToWrite);
                 }
             }
-            else {
-                throw OperationException("Tile tabs configuration is corrupted.");
+            
+            /*
+             * Print error messages
+             */
+            if ( ! sceneErrorMessage.isEmpty()) {
+                std::cerr << "ERRORS loading scene, output image may be incorrect." << std::endl;
+                std::cerr << sceneErrorMessage << std::endl;
             }
         }
-        else {
-            CaretPointer<BrainOpenGL> brainOpenGL(createBrainOpenGL());
-            
-            const int32_t selectedTabIndex = bwc->getSceneSelectedTabIndex();
-            
-            EventBrowserTabGet getTabContent(selectedTabIndex);
-            EventManager::get()->sendEvent(getTabContent.getPointer());
-            BrowserTabContent* tabContent = getTabContent.getBrowserTab();
-            if (tabContent == NULL) {
-                throw OperationException("Failed to obtain tab number "
-                                         + AString::number(selectedTabIndex + 1)
-                                         + " for window "
-                                         + AString::number(iWindow + 1));
+        catch (const OperationException& e) {
+            if (numberOfScenes == 1) {
+                writeImages(imagesToWrite);
+                brainOpenGL.grabNew(NULL);
+                if (mesaContext != 0) {
+                    OSMesaDestroyContext(mesaContext);
+                }
+                throw;
             }
             
-            CaretPointer<BrainOpenGLViewportContent> content(NULL);
-            std::vector<BrowserTabContent*> allTabs;
-            allTabs.push_back(tabContent);
-            content.grabNew(BrainOpenGLViewportContent::createViewportForSingleTab(allTabs,
-                                                                                   tabContent,
-                                                                                   gapsAndMargins,
-                                                                                   windowIndex,
-                                                                                   windowViewport));
-            std::vector<const BrainOpenGLViewportContent*> viewportContents;
-            viewportContents.push_back(content);
-            
-            brainOpenGL->drawModels(windowIndex,
-                                    brain,
-                                    mesaContext,
-                                    viewportContents);
-            
-            const int32_t outputImageIndex = ((numberOfWindows > 1)
-                                              ? iWindow
-                                              : -1);
-            
-            writeImage(imageFileName,
-                       outputImageIndex,
-                       imageBuffer,
-                       imageWidth,
-                       imageHeight);
+            /*
+             * When showing many scenes, a failed scene does
+             * not prevent the remaining scenes from being shown
+             */
+            const AString msg("Scene \""
+                              + scene->getName()
+                              + "\" failed: "
+                              + e.whatString());
+            std::cerr << msg << std::endl;
+            failedScenesMessage.appendWithNewLine(msg);
+            numberOfFailedScenes++;
         }
-        
-        /*
-         * Free image memory and Mesa context
-         */
-        delete[] imageBuffer;
-        OSMesaDestroyContext(mesaContext);
     }
     
+    writeImages(imagesToWrite);
+    
     /*
-     * Print error messages
+     * OpenGL must be destroyed before the Mesa context
      */
-    if ( ! sceneErrorMessage.isEmpty()) {
-        std::cerr << "ERRORS loading scene, output image may be incorrect." << std::endl;
-        std::cerr << sceneErrorMessage << std::endl;
+    brainOpenGL.grabNew(NULL);
+    if (mesaContext != 0) {
+        OSMesaDestroyContext(mesaContext);
+    }
+    
+    if (numberOfScenes > 1) {
+        const double elapsedSeconds = timer.getElapsedTimeSeconds();
+        const double imagesPerMinute = ((elapsedSeconds > 0.0)
+                                        ? (numberOfImages * 60.0 / elapsedSeconds)
+                                        : 0.0);
+        std::cout << "Showed "
+        << (numberOfScenes - numberOfFailedScenes) << " of " << numberOfScenes << " scenes, "
+        << numberOfImages << " images in "
+        << AString::number(elapsedSeconds, 'f', 2) << " seconds ("
+        << AString::number(imagesPerMinute, 'f', 1) << " images per minute)" << std::endl;
+    }
+    
+    if (numberOfFailedScenes > 0) {
+        throw OperationException(AString::number(numberOfFailedScenes)
+                                 + " of "
+                                 + AString::number(numberOfScenes)
+                                 + " scenes failed:\n"
+                                 + failedScenesMessage);
+    }
+}
+
+/**
+ * Find a scene by name or by number (starting at one).
+ *
+ * @param sceneFile
+ *     Scene file containing the scene.
+ * @param sceneNameOrNumber
+ *     Name or number of the scene.
+ * @return
+ *     The scene (never NULL).
+ * @throws OperationException
+ *     If the scene is not found.
+ */
+Scene*
+OperationShowScene::getSceneWithNameOrNumber(SceneFile& sceneFile,
+                                             const AString& sceneNameOrNumber)
+{
+    Scene* scene = sceneFile.getSceneWithName(sceneNameOrNumber);
+    if (scene == NULL) {
+        bool valid = false;
+        const int32_t sceneIndexStartAtOne = sceneNameOrNumber.toInt(&valid);
+        if (valid) {
+            const int32_t sceneIndex = sceneIndexStartAtOne - 1;
+            if ((sceneIndex >= 0)
+                && (sceneIndex < sceneFile.getNumberOfScenes())) {
+                scene = sceneFile.getSceneAtIndex(sceneIndex);
+            }
+            else {
+                throw OperationException("Scene index is invalid: "
+                                         + sceneNameOrNumber);
+            }
+        }
+        else {
+            throw OperationException("Scene name is invalid: "
+                                     + sceneNameOrNumber);
+        }
     }
+    
+    return scene;
 }
 
 /**
@@ -773,8 +947,117 @@ OperationShowScene::createBrainOpenGL()
     return brainOpenGL;
 }
 
+/**
+ * Constructor that copies the image data.
+ *
+ * @param imageFileName
+ *     Name of image file.
+ * @param imageIndex
+ *     Index of image inserted into name of file (if not negative).
+ * @param imageContent
+ *     content of image.
+ * @param imageWidth
+ *     width of image.
+ * @param imageHeight
+ *     height of image.
+ */
+OperationShowScene::ImageToWrite::ImageToWrite(const AString& imageFileName,
+                                               const int32_t imageIndex,
+                                               const std::vector<unsigned char>& imageContent,
+                                               const int32_t imageWidth,
+                                               const int32_t imageHeight)
+: m_imageFileName(imageFileName),
+m_imageIndex(imageIndex),
+m_imageContent(imageContent),
+m_imageWidth(imageWidth),
+m_imageHeight(imageHeight)
+{
+}
+
+/**
+ * Write images in parallel, one image per thread, and
+ * clear the images.
+ *
+ * @param imagesToWrite
+ *     The images.
+ * @throws OperationException
+ *     If writing any of the images fails.
+ */
+void
+OperationShowScene::writeImages(std::vector<ImageToWrite>& imagesToWrite)
+{
+    const int32_t numberOfImages = static_cast<int32_t>(imagesToWrite.size());
+    std::vector<AString> errorMessages(numberOfImages);
+    
+#pragma omp CARET_PARFOR schedule(dynamic, 1)
+    for (int32_t i = 0; i < numberOfImages; i++) {
+        const ImageToWrite& image = imagesToWrite[i];
+        try {
+            writeImage(image.m_imageFileName,
+                       image.m_imageIndex,
+                       &image.m_imageContent[0],
+                       image.m_imageWidth,
+                       image.m_imageHeight);
+        }
+        catch (const OperationException& e) {
+            errorMessages[i] = e.whatString();
+        }
+    }
+    
+    imagesToWrite.clear();
+    
+    AString errorMessage;
+    for (std::vector<AString>::iterator iter = errorMessages.begin();
+         iter != errorMessages.end();
+         iter++) {
+        if ( ! iter->isEmpty()) {
+            errorMessage.appendWithNewLine(*iter);
+        }
+    }
+    if ( ! errorMessage.isEmpty()) {
+        throw OperationException(errorMessage);
+    }
+}
+
 #endif // HAVE_OSMESA
 
+/**
+ * Insert a number, preceded by an underscore, before the
+ * extension of a file name.  If there is no extension,
+ * the number and a PNG extension are appended.
+ *
+ * @param fileName
+ *     Name of file.
+ * @param number
+ *     The number.
+ * @param numberWidth
+ *     Minimum number of digits, zeros are added on the left.
+ * @return
+ *     Name of file containing the number.
+ */
+AString
+OperationShowScene::insertNumberIntoFileName(const AString& fileName,
+                                             const int32_t number,
+                                             const int32_t numberWidth)
+{
+    AString outputName(fileName);
+    const AString numberText = QString("_%1").arg((int)number,
+                                                  numberWidth, // width
+                                                  10, // base
+                                                  QChar('0')); // fill character
+    const int dotOffset = outputName.lastIndexOf(".");
+    if (dotOffset >= 0) {
+        outputName.insert(dotOffset,
+                          numberText);
+    }
+    else {
+        outputName += (numberText
+                       + ".png");
+    }
+    
+    return outputName;
+}
+
 /**
  * Write the image data to a Image File.
  *
@@ -801,19 +1084,9 @@ OperationShowScene::writeImage(const AString& imageFileName,
      */
     QString outputName(imageFileName);
     if (imageIndex >= 0) {
-        const AString imageNumber = QString("_%1").arg((int)(imageIndex + 1),
-                                                       2, // width
-                                                       10, // base
-                                                       QChar('0')); // fill character
-        const int dotOffset = outputName.lastIndexOf(".");
-        if (dotOffset >= 0) {
-            outputName.insert(dotOffset,
-                              imageNumber);
-        }
-        else {
-            outputName += (imageNumber
-                           + ".png");
-        }
+        outputName = insertNumberIntoFileName(imageFileName,
+                                              imageIndex + 1,
+                                              2);
     }
     
     try {
@@ -22,11 +22,15 @@
 /*LICENSE_END*/
 
 
+#include <vector>
+
 #include "AbstractOperation.h"
 
 namespace caret {
 
     class BrainOpenGLFixedPipeline;
+    class Scene;
+    class SceneFile;
     
     class OperationShowScene : public AbstractOperation {
 
@@ -43,8 +47,39 @@ namespace caret {
         static bool isShowSceneCommandAvailable();
         
     private:
+        /**
+         * Image that has been drawn and is waiting to be written.
+         */
+        class ImageToWrite {
+        public:
+            ImageToWrite(const AString& imageFileName,
+                         const int32_t imageIndex,
+                         const std::vector<unsigned char>& imageContent,
+                         const int32_t imageWidth,
+                         const int32_t imageHeight);
+            
+            AString m_imageFileName;
+            
+            int32_t m_imageIndex;
+            
+            std::vector<unsigned char> m_imageContent;
+            
+            int32_t m_imageWidth;
+            
+            int32_t m_imageHeight;
+        };
+        
         static BrainOpenGLFixedPipeline* createBrainOpenGL();
         
+        static Scene* getSceneWithNameOrNumber(SceneFile& sceneFile,
+                                               const AString& sceneNameOrNumber);
+        
+        static void writeImages(std::vector<ImageToWrite>& imagesToWrite);
+        
+        static AString insertNumberIntoFileName(const AString& fileName,
+                                                const int32_t number,
+                                                const int32_t numberWidth);
+        
         static void writeImage(const AString& imageFileName,
                                   const int32_t imageIndex,
                                   const unsigned char* imageContent,
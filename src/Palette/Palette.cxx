@@ -26,6 +26,7 @@
 #include "Palette.h"
 #undef __PALETTE_DEFINE__
 
+#include "PaletteLookupTable.h"
 #include "PaletteScalarAndColor.h"
 
 using namespace caret;
@@ -85,6 +86,8 @@ Palette::copyHelper(const Palette& o)
 {
     this->name = o.name;
     this->paletteScalars.clear();
+    m_lookupTables[0].reset();
+    m_lookupTables[1].reset();
     uint64_t num = o.paletteScalars.size();
     for (uint64_t i = 0; i < num; i++) {
         this->paletteScalars.push_back(new PaletteScalarAndColor(*o.paletteScalars[i]));
@@ -483,6 +486,27 @@ Palette::getPaletteColor(
     }
 }
 
+/**
+ * Get a lookup table that gives the same colors as getPaletteColor() for
+ * normalized values, for coloring many values.  The table is created when
+ * first requested and is kept until the palette is modified.
+ *
+ * @param interpolateColorFlag - interpolate the color between scalars.
+ * @return Lookup table for this palette.
+ */
+const PaletteLookupTable*
+Palette::getLookupTable(const bool interpolateColorFlag) const
+{
+    CaretMutexLocker locker(&m_lookupTableMutex);
+    std::unique_ptr<PaletteLookupTable>& lookupTable = m_lookupTables[interpolateColorFlag ? 1 : 0];
+    if ( ! lookupTable) {
+        lookupTable.reset(new PaletteLookupTable(this,
+                                                 interpolateColorFlag));
+    }
+    
+    return lookupTable.get();
+}
+
 /**
  * Set this object has been modified.
  *
@@ -491,6 +515,13 @@ void
 Palette::setModified()
 {
     this->modifiedFlag = true;
+    
+    /*
+     * Scalars or colors may have changed
+     */
+    CaretMutexLocker locker(&m_lookupTableMutex);
+    m_lookupTables[0].reset();
+    m_lookupTables[1].reset();
 }
 
 /**
@@ -26,12 +26,14 @@
 #include <vector>
 
 #include "CaretAssert.h"
+#include "CaretMutex.h"
 #include "CaretObject.h"
 #include "TracksModificationInterface.h"
 
 
 namespace caret {
 
+    class PaletteLookupTable;
     class PaletteScalarAndColor;
 
     /**
@@ -97,6 +99,8 @@ namespace caret {
                              const bool interpolateColorFlag,
                              float rgbaOut[4]) const;
         
+        const PaletteLookupTable* getLookupTable(const bool interpolateColorFlag) const;
+        
         void setModified();
         
         void clearModified();
@@ -144,6 +148,12 @@ namespace caret {
         
         /** The inverted palette with negative inverted separate from positive */
         mutable std::unique_ptr<Palette> m_noneSeparateInvertedPalette;
+        
+        /** Lookup tables are lazily created, without and with interpolation, and removed when the palette is modified */
+        mutable std::unique_ptr<PaletteLookupTable> m_lookupTables[2];
+        
+        /** Lookup tables may be requested by more than one thread */
+        mutable CaretMutex m_lookupTableMutex;
     };
 
     
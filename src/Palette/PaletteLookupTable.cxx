@@ -0,0 +1,98 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "PaletteLookupTable.h"
+
+#include <cmath>
+
+#include "CaretAssert.h"
+#include "PaletteScalarAndColor.h"
+
+using namespace caret;
+
+/**
+ * \class caret::PaletteLookupTable
+ * \brief Palette colors precomputed at evenly spaced normalized values.
+ *
+ * Within a bin that does not contain a control point, the palette's color
+ * is either constant or linear in the normalized value, so the colors at
+ * the edges of the bin give the same result as the palette.
+ */
+
+/**
+ * Constructor.
+ *
+ * @param palette
+ *    Palette that is sampled, must remain valid while this table is used.
+ * @param interpolateColorFlag
+ *    Interpolate the color between scalars.
+ * @param numberOfBins
+ *    Number of evenly spaced bins in the normalized range [-1, 1].
+ */
+PaletteLookupTable::PaletteLookupTable(const Palette* palette,
+                                       const bool interpolateColorFlag,
+                                       const int32_t numberOfBins)
+{
+    CaretAssert(palette);
+    CaretAssert(numberOfBins > 0);
+    m_palette = palette;
+    m_interpolateColorFlag = interpolateColorFlag;
+    const int32_t numScalarColors = palette->getNumberOfScalarsAndColors();
+    
+    /*
+     * A palette with two colors always interpolates, see Palette::getPaletteColor().
+     * Outside of the control points, the color is constant, so interpolating
+     * between equal edge colors does not change it.
+     */
+    m_interpolateFlag = (interpolateColorFlag
+                         || (numScalarColors == 2));
+    
+    m_binScale = numberOfBins / 2.0f;
+    m_numberOfBinsFloat = numberOfBins;
+    const float binWidth = 2.0f / numberOfBins;
+    
+    m_edgeColors.resize((numberOfBins + 1) * 4);
+    for (int32_t i = 0; i <= numberOfBins; i++) {
+        float value = -1.0f + i * binWidth;
+        if (value > 1.0f) value = 1.0f;
+        palette->getPaletteColor(value,
+                                 interpolateColorFlag,
+                                 &m_edgeColors[i * 4]);
+    }
+    
+    m_exactBins.resize(numberOfBins, 0);
+    for (int32_t i = 0; i < numScalarColors; i++) {
+        const float scalar = palette->getScalarAndColor(i)->getScalar();
+        if ((scalar < -1.0f) || (scalar > 1.0f)) {
+            continue;
+        }
+        /*
+         * Mark the bin containing the control point, and its neighbors,
+         * so rounding of the bin position never crosses a color boundary
+         */
+        const int32_t bin = static_cast<int32_t>(std::floor((scalar + 1.0f) * m_binScale));
+        for (int32_t j = bin - 1; j <= bin + 1; j++) {
+            if ((j >= 0) && (j < numberOfBins)) {
+                m_exactBins[j] = 1;
+            }
+        }
+    }
+}
+
@@ -0,0 +1,99 @@
+#ifndef __PALETTE_LOOKUP_TABLE_H__
+#define __PALETTE_LOOKUP_TABLE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include <stdint.h>
+#include <vector>
+
+#include "Palette.h"
+
+namespace caret {
+
+    /**
+     * A palette sampled at evenly spaced normalized values, so that coloring
+     * a large number of values does not search the palette's control points
+     * for every value.  Bins that contain a control point are marked and
+     * colored by the palette itself, so color boundaries are not moved.
+     */
+    class PaletteLookupTable {
+        
+    public:
+        PaletteLookupTable(const Palette* palette,
+                           const bool interpolateColorFlag,
+                           const int32_t numberOfBins = 4096);
+        
+        /**
+         * Get the color for a normalized value, same as Palette::getPaletteColor().
+         *
+         * @param normalizedValue - normalized value, clamped to [-1, 1].
+         * @param rgbaOut - output color components ranging zero to one.
+         */
+        inline void getPaletteColor(const float normalizedValue,
+                                    float rgbaOut[4]) const {
+            const float position = (normalizedValue + 1.0f) * m_binScale;
+            if ((position >= 0.0f) && (position < m_numberOfBinsFloat)) {
+                const int32_t bin = static_cast<int32_t>(position);
+                if ( ! m_exactBins[bin]) {
+                    const float* below = &m_edgeColors[bin * 4];
+                    if (m_interpolateFlag) {
+                        const float* above = below + 4;
+                        const float offset = position - bin;
+                        rgbaOut[0] = below[0] + offset * (above[0] - below[0]);
+                        rgbaOut[1] = below[1] + offset * (above[1] - below[1]);
+                        rgbaOut[2] = below[2] + offset * (above[2] - below[2]);
+                    }
+                    else {
+                        rgbaOut[0] = below[0];
+                        rgbaOut[1] = below[1];
+                        rgbaOut[2] = below[2];
+                    }
+                    rgbaOut[3] = below[3];
+                    return;
+                }
+            }
+            m_palette->getPaletteColor(normalizedValue,
+                                       m_interpolateColorFlag,
+                                       rgbaOut);
+        }
+        
+    private:
+        const Palette* m_palette;
+        
+        bool m_interpolateColorFlag;
+        
+        /** interpolate between the colors at the edges of a bin (palette interpolates, or has only two colors) */
+        bool m_interpolateFlag;
+        
+        float m_binScale;
+        
+        float m_numberOfBinsFloat;
+        
+        /** colors at the bin edges, 4 per edge, numberOfBins + 1 edges */
+        std::vector<float> m_edgeColors;
+        
+        /** bins containing a control point of the palette, colored by the palette */
+        std::vector<char> m_exactBins;
+    };
+    
+} // namespace
+
+#endif //__PALETTE_LOOKUP_TABLE_H__
@@ -0,0 +1,126 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CiftiTransposeTest.h"
+
+#include "AlgorithmCiftiTranspose.h"
+#include "CiftiFile.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CiftiTransposeTest::CiftiTransposeTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //neither dimension is a multiple of the 8x8 tiles, or of the bands and groups the memory limit below gives
+    const int64_t NUM_ROWS = 203, NUM_COLS = 157;
+    
+    //about 64KB, small enough that the output needs 3 passes through the input, so on-disk input goes through a temporary file
+    const float MEM_LIMIT_GB = 64000.0f / (1024.0f * 1024.0f * 1024.0f);
+    
+    float inputValue(const int64_t& row, const int64_t& col)
+    {
+        return sin(0.37f * row) * 100.0f + col * 0.001f - row;
+    }
+    
+    //compares the bits, so it is the same as memcpy of each element
+    AString checkTranspose(const CiftiFile& input, const CiftiFile& output, const AString& description)
+    {
+        if (output.getNumberOfRows() != input.getNumberOfColumns() || output.getNumberOfColumns() != input.getNumberOfRows())
+        {
+            return description + " gave the wrong dimensions";
+        }
+        if (!(*(output.getCiftiXML().getMap(CiftiXML::ALONG_ROW)) == *(input.getCiftiXML().getMap(CiftiXML::ALONG_COLUMN))))
+        {
+            return description + " did not swap the mappings";
+        }
+        vector<float> outRow(NUM_ROWS);
+        for (int64_t outRowIndex = 0; outRowIndex < NUM_COLS; ++outRowIndex)
+        {
+            output.getRow(outRow.data(), outRowIndex);
+            for (int64_t i = 0; i < NUM_ROWS; ++i)
+            {
+                const float expected = inputValue(i, outRowIndex);
+                if (memcmp(&outRow[i], &expected, sizeof(float)) != 0)
+                {
+                    return description + " gave " + AString::number(outRow[i]) + " at row " + AString::number(outRowIndex) + ", column " + AString::number(i) +
+                           ", expected " + AString::number(expected);
+                }
+            }
+        }
+        return "";
+    }
+}
+
+void CiftiTransposeTest::execute()
+{
+    CiftiXML inXML;
+    inXML.setNumberOfDimensions(2);
+    inXML.setMap(CiftiXML::ALONG_ROW, CiftiScalarsMap(NUM_COLS));
+    inXML.setMap(CiftiXML::ALONG_COLUMN, CiftiSeriesMap(NUM_ROWS, 0.0f, 0.72f, CiftiSeriesMap::SECOND));
+    CiftiFile inMemory;
+    inMemory.setCiftiXML(inXML);
+    vector<float> row(NUM_COLS);
+    for (int64_t r = 0; r < NUM_ROWS; ++r)
+    {
+        for (int64_t c = 0; c < NUM_COLS; ++c)
+        {
+            row[c] = inputValue(r, c);
+        }
+        inMemory.setRow(row.data(), r);
+    }
+    AString error;
+    {
+        CiftiFile output;
+        AlgorithmCiftiTranspose(NULL, &inMemory, &output);
+        error = checkTranspose(inMemory, output, "unlimited memory");
+        if (error != "") { setFailed(error); return; }
+    }
+    {//in-memory input is always transposed directly, in several passes of small bands here
+        CiftiFile output;
+        AlgorithmCiftiTranspose(NULL, &inMemory, &output, MEM_LIMIT_GB);
+        error = checkTranspose(inMemory, output, "banded in-memory transpose");
+        if (error != "") { setFailed(error); return; }
+    }
+    const QString inFileName = QDir::tempPath() + "/CiftiTransposeTest.transposetest.nii";
+    inMemory.writeFile(inFileName);
+    {
+        CiftiFile onDisk(inFileName);
+        if (onDisk.isInMemory())
+        {
+            error = "input file was not read on-disk";
+        } else {
+            CiftiFile output;
+            AlgorithmCiftiTranspose(NULL, &onDisk, &output, MEM_LIMIT_GB);
+            error = checkTranspose(onDisk, output, "temporary file transpose");
+        }
+    }
+    QFile::remove(inFileName);
+    if (error != "") setFailed(error);
+}
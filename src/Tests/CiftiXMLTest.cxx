@@ -0,0 +1,214 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "CiftiXMLTest.h"
+
+#include "CiftiFile.h"
+#include "DataFileException.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <iostream>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //brain models along columns with vertex lists out of order, a partial and a full surface, and two voxel structures
+    CiftiXML makeTestXML(const int64_t& numScalars)
+    {
+        CiftiXML ret;
+        ret.setNumberOfDimensions(2);
+        CiftiScalarsMap scalarsMap(numScalars);
+        ret.setMap(CiftiXML::ALONG_ROW, scalarsMap);
+        CiftiBrainModelsMap modelsMap;
+        vector<int64_t> nodeList;
+        nodeList.push_back(7);
+        nodeList.push_back(0);
+        nodeList.push_back(3);
+        nodeList.push_back(19);
+        nodeList.push_back(12);
+        modelsMap.addSurfaceModel(20, StructureEnum::CORTEX_LEFT, nodeList);
+        modelsMap.addSurfaceModel(6, StructureEnum::CORTEX_RIGHT);
+        int64_t dims[3] = { 6, 5, 4 };
+        float sform[12] = { 2.0f, 0.0f, 0.0f, -6.0f,
+                            0.0f, 2.0f, 0.0f, -5.0f,
+                            0.0f, 0.0f, 2.0f, -4.0f };
+        modelsMap.setVolumeSpace(VolumeSpace(dims, sform));
+        vector<int64_t> ijkList;
+        for (int64_t k = 0; k < dims[2]; ++k)
+        {
+            for (int64_t i = 0; i < 2; ++i)
+            {
+                ijkList.push_back(i);
+                ijkList.push_back((i + k) % dims[1]);
+                ijkList.push_back(k);
+            }
+        }
+        modelsMap.addVolumeModel(StructureEnum::THALAMUS_LEFT, ijkList);
+        ijkList.clear();
+        ijkList.push_back(5);
+        ijkList.push_back(4);
+        ijkList.push_back(3);
+        ijkList.push_back(3);
+        ijkList.push_back(0);
+        ijkList.push_back(0);
+        modelsMap.addVolumeModel(StructureEnum::CEREBELLUM, ijkList);
+        ret.setMap(CiftiXML::ALONG_COLUMN, modelsMap);
+        return ret;
+    }
+    
+    //replace the text of the first element with the given tag, "" if the tag isn't found
+    QString replaceElementText(const QString& xmlText, const QString& tag, const QString& newText)
+    {
+        int start = xmlText.indexOf("<" + tag + ">");
+        if (start < 0) return "";
+        start += tag.size() + 2;
+        int end = xmlText.indexOf("</" + tag + ">", start);
+        if (end < 0) return "";
+        return xmlText.left(start) + newText + xmlText.mid(end);
+    }
+    
+    //check that the brain models map parsed from text matches the test XML, including its lookups
+    AString checkParsedXML(const CiftiXML& expected, const QString& xmlText, const AString& description)
+    {
+        CiftiXML parsed;
+        try
+        {
+            parsed.readXML(xmlText.toUtf8());
+        } catch (DataFileException& e) {
+            return description + " failed to parse: " + e.whatString();
+        }
+        if (!(parsed == expected)) return description + " parsed to different XML";
+        const CiftiBrainModelsMap& myMap = parsed.getBrainModelsMap(CiftiXML::ALONG_COLUMN);
+        if (myMap.getIndexForNode(19, StructureEnum::CORTEX_LEFT) != 3 || myMap.getIndexForNode(1, StructureEnum::CORTEX_LEFT) != -1)
+        {
+            return description + " gave wrong vertex lookup";
+        }
+        if (myMap.getIndexForNode(5, StructureEnum::CORTEX_RIGHT) != 10)
+        {
+            return description + " gave wrong vertex lookup for full surface";
+        }
+        StructureEnum::Enum structure;
+        if (myMap.getIndexForVoxel(3, 0, 0, &structure) != 20 || structure != StructureEnum::CEREBELLUM || myMap.getIndexForVoxel(5, 0, 0) != -1)
+        {
+            return description + " gave wrong voxel lookup";
+        }
+        return "";
+    }
+    
+    //parsing must throw for a bad index array, rather than producing some other list
+    AString checkParseFails(const QString& xmlText, const AString& description)
+    {
+        try
+        {
+            CiftiXML parsed;
+            parsed.readXML(xmlText.toUtf8());
+        } catch (DataFileException&) {
+            return "";
+        }
+        return description + " did not throw";
+    }
+}
+
+CiftiXMLTest::CiftiXMLTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void CiftiXMLTest::execute()
+{
+    testIndexArrayParsing();
+    if (failed()) return;
+    testXMLCache();
+}
+
+void CiftiXMLTest::testIndexArrayParsing()
+{
+    std::cout << "Testing Cifti index array parsing." << std::endl;
+    CiftiXML expected = makeTestXML(3);
+    AString error;
+    error = checkParsedXML(expected, expected.writeXMLToString(CiftiVersion(1, 0)), "cifti-1 round trip");
+    if (error != "") { setFailed(error); return; }
+    QString xmlText = expected.writeXMLToString(CiftiVersion(2, 0));
+    error = checkParsedXML(expected, xmlText, "cifti-2 round trip");
+    if (error != "") { setFailed(error); return; }
+    CiftiXML copied = expected;//copies share the index arrays
+    error = checkParsedXML(copied, xmlText, "copied XML");
+    if (error != "") { setFailed(error); return; }
+    //any mix of XML whitespace, a leading '+', and "-0" are valid integers, and a model's indices may be split across lines any way
+    QString spacedText = replaceElementText(xmlText, "VertexIndices", "\n\t +7\r\n0 3  \t19\t\t+0012 ");
+    spacedText = replaceElementText(spacedText, "VoxelIndicesIJK", "-0 +0 0\n\n1 1\n0 0 1 1 1 2 1 0 2 2 1 3 2 0 3 3 1 4 3");
+    error = checkParsedXML(expected, spacedText, "varied whitespace and signs");
+    if (error != "") { setFailed(error); return; }
+    const char* badArrays[] = { "7 0 3 19 12a", "7 0 -3 19 12", "7 0 3 19 99999999999999999999", "7 0 3 - 12", "7 0 3 19 +", "7 0 3 19 1.2" };
+    for (int i = 0; i < (int)(sizeof(badArrays) / sizeof(badArrays[0])); ++i)
+    {
+        error = checkParseFails(replaceElementText(xmlText, "VertexIndices", badArrays[i]), AString("vertex list \"") + badArrays[i] + "\"");
+        if (error != "") { setFailed(error); return; }
+    }
+    error = checkParseFails(replaceElementText(xmlText, "VertexIndices", "7 0 3 19"), "vertex list shorter than the index count");
+    if (error != "") { setFailed(error); return; }
+    error = checkParseFails(replaceElementText(xmlText, "VoxelIndicesIJK", "5 4 3 3 0"), "voxel list that isn't triples");
+    if (error != "") { setFailed(error); return; }
+}
+
+void CiftiXMLTest::testXMLCache()
+{
+    std::cout << "Testing Cifti XML cache." << std::endl;
+    CiftiXML xmlA = makeTestXML(3), xmlB = makeTestXML(2);
+    const int numFiles = 3;
+    const CiftiXML* fileXML[numFiles] = { &xmlA, &xmlA, &xmlB };//the second file reuses the first file's parse, the third must not
+    QString fileNames[numFiles];
+    for (int i = 0; i < numFiles; ++i)
+    {
+        fileNames[i] = QDir::tempPath() + "/CiftiXMLTest_xmlcache_" + QString::number(i) + ".dscalar.nii";
+        CiftiFile writer;
+        writer.setCiftiXML(*fileXML[i]);
+        vector<float> row(fileXML[i]->getDimensionLength(CiftiXML::ALONG_ROW));
+        for (int64_t r = 0; r < fileXML[i]->getDimensionLength(CiftiXML::ALONG_COLUMN); ++r)
+        {
+            for (int64_t c = 0; c < (int64_t)row.size(); ++c) row[c] = i * 1000 + r * 10 + c;
+            writer.setRow(row.data(), r);
+        }
+        writer.writeFile(fileNames[i]);
+    }
+    AString error;
+    for (int pass = 0; pass < 2 && error == ""; ++pass)//second pass finds all of them in the cache
+    {
+        for (int i = 0; i < numFiles && error == ""; ++i)
+        {
+            CiftiFile reader(fileNames[i]);
+            if (!(reader.getCiftiXML() == *fileXML[i]))
+            {
+                error = "file " + AString::number(i) + " read back with different XML on pass " + AString::number(pass);
+                break;
+            }
+            vector<float> row(reader.getNumberOfColumns());
+            reader.getRow(row.data(), 20);
+            if (row[1] != i * 1000 + 201) error = "file " + AString::number(i) + " read back with wrong data";
+        }
+    }
+    for (int i = 0; i < numFiles; ++i) QFile::remove(fileNames[i]);
+    CiftiFile::clearXMLCache();
+    if (error != "") setFailed(error);
+}
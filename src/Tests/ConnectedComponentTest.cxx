@@ -0,0 +1,119 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2018  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "ConnectedComponentTest.h"
+
+#include "ConnectedComponentHelper.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    //plain flood fill in scan order, gives the numbering the helper is supposed to match
+    int32_t floodFillLabels(const int64_t dims[3], const int& connectivity, const vector<char>& mask, vector<int32_t>& labelsOut)
+    {
+        int64_t numVoxels = dims[0] * dims[1] * dims[2];
+        labelsOut.assign(numVoxels, -1);
+        int32_t numComponents = 0;
+        for (int64_t start = 0; start < numVoxels; ++start)
+        {
+            if (mask[start] == 0 || labelsOut[start] != -1) continue;
+            vector<int64_t> members(1, start);
+            labelsOut[start] = numComponents;
+            for (size_t m = 0; m < members.size(); ++m)//NOTE: vector grows inside loop
+            {
+                int64_t ijk[3] = { members[m] % dims[0], (members[m] / dims[0]) % dims[1], members[m] / (dims[0] * dims[1]) };
+                for (int k = -1; k <= 1; ++k)
+                {
+                    for (int j = -1; j <= 1; ++j)
+                    {
+                        for (int i = -1; i <= 1; ++i)
+                        {
+                            int dist = abs(i) + abs(j) + abs(k);
+                            if (dist == 0 || (connectivity == 6 && dist > 1) || (connectivity == 18 && dist > 2)) continue;
+                            int64_t neigh[3] = { ijk[0] + i, ijk[1] + j, ijk[2] + k };
+                            if (neigh[0] < 0 || neigh[1] < 0 || neigh[2] < 0 || neigh[0] >= dims[0] || neigh[1] >= dims[1] || neigh[2] >= dims[2]) continue;
+                            int64_t neighIndex = neigh[0] + dims[0] * (neigh[1] + dims[1] * neigh[2]);
+                            if (mask[neighIndex] != 0 && labelsOut[neighIndex] == -1)
+                            {
+                                labelsOut[neighIndex] = numComponents;
+                                members.push_back(neighIndex);
+                            }
+                        }
+                    }
+                }
+            }
+            ++numComponents;
+        }
+        return numComponents;
+    }
+}
+
+ConnectedComponentTest::ConnectedComponentTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void ConnectedComponentTest::execute()
+{
+    const int64_t dims[3] = { 53, 47, 41 };//big enough that the labeling is split between threads
+    const int64_t numVoxels = dims[0] * dims[1] * dims[2];
+    const int connectivities[3] = { 6, 18, 26 };
+    vector<char> mask(numVoxels);
+    for (int64_t i = 0; i < numVoxels; ++i)
+    {
+        mask[i] = (rand() % 100 < 35) ? 1 : 0;//near the percolation threshold, so there are many components of many sizes
+    }
+    for (int c = 0; c < 3; ++c)
+    {
+        ConnectedComponentHelper myHelper(dims, connectivities[c]);
+        vector<int32_t> labels(numVoxels), expected;
+        int32_t numComponents = myHelper.labelComponents(mask.data(), labels.data());
+        int32_t expectedComponents = floodFillLabels(dims, connectivities[c], mask, expected);
+        AString connString = AString::number(connectivities[c]) + "-connectivity: ";
+        if (numComponents != expectedComponents)
+        {
+            setFailed(connString + "found " + AString::number(numComponents) + " components, expected " + AString::number(expectedComponents));
+            return;
+        }
+        for (int64_t i = 0; i < numVoxels; ++i)
+        {
+            if (labels[i] != expected[i])
+            {
+                setFailed(connString + "voxel " + AString::number(i) + " labeled " + AString::number(labels[i]) + ", expected " + AString::number(expected[i]));
+                return;
+            }
+        }
+        vector<double> counts;
+        myHelper.sumPerComponent(labels.data(), numComponents, NULL, counts);
+        vector<vector<int32_t> > members;
+        myHelper.getComponentMembers(labels.data(), numComponents, members);
+        for (int32_t i = 0; i < numComponents; ++i)
+        {
+            if ((int64_t)members[i].size() != (int64_t)counts[i] || expected[members[i][0]] != i)
+            {
+                setFailed(connString + "component " + AString::number(i) + " has inconsistent member list");
+                return;
+            }
+        }
+    }
+}
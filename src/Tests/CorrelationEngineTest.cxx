@@ -0,0 +1,247 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "CorrelationEngineTest.h"
+
+#include "CorrelationEngine.h"
+#include "dot_wrapper.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+CorrelationEngineTest::CorrelationEngineTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //neither is a multiple of the tile size, so both sides have partial tiles
+    const int64_t NUM_ROWS_A = 7, NUM_ROWS_B = 10, ROW_LENGTH = 37;
+    
+    //the row adjustment and correlation -cifti-cross-correlation did per pair before the engine, with the dot product spelled out
+    struct OldCorrelation
+    {
+        vector<float> m_weights;
+        vector<int64_t> m_weightIndexes;
+        double m_weightSum;
+        bool m_weightedMode, m_binaryWeights;
+        
+        OldCorrelation(const vector<float>* weights)
+        {
+            m_weightSum = 0.0;
+            m_weightedMode = false;
+            m_binaryWeights = true;
+            if (weights != NULL)
+            {
+                for (int64_t i = 0; i < ROW_LENGTH; ++i)
+                {
+                    if ((*weights)[i] != 0.0f)
+                    {
+                        m_weightSum += (*weights)[i];
+                        m_weights.push_back((*weights)[i]);
+                        m_weightIndexes.push_back(i);
+                        if ((*weights)[i] != 1.0f) m_binaryWeights = false;
+                    }
+                }
+                m_weightedMode = !m_binaryWeights || (int64_t)m_weightIndexes.size() != ROW_LENGTH;
+            }
+        }
+        
+        void adjustRow(float* row, float& rootResidSqrOut) const
+        {
+            double accum = 0.0;
+            float mean;
+            if (m_weightedMode)
+            {
+                int64_t mycount = (int64_t)m_weightIndexes.size();
+                if (m_binaryWeights)
+                {
+                    for (int64_t i = 0; i < mycount; ++i) accum += row[m_weightIndexes[i]];
+                    mean = accum / mycount;
+                    accum = 0.0;
+                    for (int64_t i = 0; i < mycount; ++i)
+                    {
+                        float tempf = row[m_weightIndexes[i]] - mean;
+                        accum += tempf * tempf;
+                    }
+                    for (int64_t i = 0; i < mycount; ++i) row[i] = row[m_weightIndexes[i]] - mean;
+                } else {
+                    for (int64_t i = 0; i < mycount; ++i) accum += m_weights[i] * row[m_weightIndexes[i]];
+                    mean = accum / m_weightSum;
+                    accum = 0.0;
+                    for (int64_t i = 0; i < mycount; ++i)
+                    {
+                        float tempf = row[m_weightIndexes[i]] - mean;
+                        accum += m_weights[i] * tempf * tempf;
+                    }
+                    for (int64_t i = 0; i < mycount; ++i) row[i] = sqrt(m_weights[i]) * (row[m_weightIndexes[i]] - mean);
+                }
+            } else {
+                for (int64_t i = 0; i < ROW_LENGTH; ++i) accum += row[i];
+                mean = accum / ROW_LENGTH;
+                accum = 0.0;
+                for (int64_t i = 0; i < ROW_LENGTH; ++i)
+                {
+                    float tempf = row[i] - mean;
+                    accum += tempf * tempf;
+                }
+                for (int64_t i = 0; i < ROW_LENGTH; ++i) row[i] -= mean;
+            }
+            rootResidSqrOut = sqrt(accum);
+        }
+        
+        int64_t getLength() const { return m_weightedMode ? (int64_t)m_weightIndexes.size() : ROW_LENGTH; }
+        
+        //useSIMD uses the dsdot the old code called, which sums in a different order, otherwise the same sums as the generic dsdot
+        float correlate(const float* row1, const float& rrs1, const float* row2, const float& rrs2, const bool& fisherZ, const bool& useSIMD) const
+        {
+            double accum = 0.0;
+            if (useSIMD)
+            {
+                accum = dsdot(row1, row2, (int)getLength());
+            } else {
+                for (int64_t i = 0; i < getLength(); ++i) accum += row1[i] * row2[i];
+            }
+            double r = accum / (rrs1 * rrs2);
+            if (fisherZ)
+            {
+                if (r > 0.999999) r = 0.999999;
+                if (r < -0.999999) r = -0.999999;
+                return 0.5 * log((1 + r) / (1 - r));
+            } else {
+                if (r > 1.0) r = 1.0;
+                if (r < -1.0) r = -1.0;
+                return r;
+            }
+        }
+    };
+    
+    vector<vector<float> > randomRows(const int64_t& numRows)
+    {
+        vector<vector<float> > ret(numRows, vector<float>(ROW_LENGTH));
+        for (int64_t r = 0; r < numRows; ++r)
+        {
+            for (int64_t i = 0; i < ROW_LENGTH; ++i)
+            {
+                ret[r][i] = ((float)rand()) / RAND_MAX * 10.0f - 3.0f + 0.5f * r;
+            }
+        }
+        return ret;
+    }
+    
+    bool sameBits(const float& a, const float& b)
+    {
+        return memcmp(&a, &b, sizeof(float)) == 0;
+    }
+    
+    AString testWeights(const vector<float>* weights, const AString& description)
+    {
+        const vector<vector<float> > rawA = randomRows(NUM_ROWS_A), rawB = randomRows(NUM_ROWS_B);
+        OldCorrelation oldCorr(weights);
+        CorrelationEngine engine(ROW_LENGTH, weights);
+        if (engine.getPreparedLength() != oldCorr.getLength()) return description + ": wrong prepared length";
+        vector<vector<float> > oldA = rawA, oldB = rawB, newA = rawA, newB = rawB;
+        vector<float> oldRrsA(NUM_ROWS_A), oldRrsB(NUM_ROWS_B), newRrsA(NUM_ROWS_A), newRrsB(NUM_ROWS_B);
+        vector<const float*> ptrsA(NUM_ROWS_A), ptrsB(NUM_ROWS_B);
+        for (int64_t r = 0; r < NUM_ROWS_A; ++r)
+        {
+            oldCorr.adjustRow(oldA[r].data(), oldRrsA[r]);
+            float mean;
+            engine.computeRowStatistics(newA[r].data(), mean, newRrsA[r]);
+            engine.prepareRow(newA[r].data(), mean);
+            ptrsA[r] = newA[r].data();
+        }
+        for (int64_t r = 0; r < NUM_ROWS_B; ++r)
+        {
+            oldCorr.adjustRow(oldB[r].data(), oldRrsB[r]);
+            float mean;
+            engine.computeRowStatistics(newB[r].data(), mean, newRrsB[r]);
+            engine.prepareRow(newB[r].data(), mean);
+            ptrsB[r] = newB[r].data();
+        }
+        vector<float> panelB(engine.getPanelSize(NUM_ROWS_B));
+        engine.packPanel(ptrsB.data(), NUM_ROWS_B, panelB.data());
+        for (int fisherZ = 0; fisherZ < 2; ++fisherZ)
+        {
+            const AString modeName = description + (fisherZ ? " with fisher z" : "");
+            vector<float> tileOut(NUM_ROWS_A * NUM_ROWS_B, -100.0f);
+            for (int64_t tileA = 0; tileA < NUM_ROWS_A; tileA += CorrelationEngine::TILE_SIZE)
+            {
+                const int64_t countA = min((int64_t)CorrelationEngine::TILE_SIZE, NUM_ROWS_A - tileA);
+                for (int64_t tileB = 0; tileB < NUM_ROWS_B; tileB += CorrelationEngine::TILE_SIZE)
+                {
+                    const int64_t countB = min((int64_t)CorrelationEngine::TILE_SIZE, NUM_ROWS_B - tileB);
+                    engine.correlateTile(ptrsA.data() + tileA, newRrsA.data() + tileA, countA,
+                                         panelB.data() + tileB * engine.getPreparedLength(), newRrsB.data() + tileB, countB,
+                                         tileOut.data() + tileA * NUM_ROWS_B + tileB, NUM_ROWS_B, fisherZ);
+                }
+            }
+            for (int64_t a = 0; a < NUM_ROWS_A; ++a)
+            {
+                for (int64_t b = 0; b < NUM_ROWS_B; ++b)
+                {
+                    const AString where = " at (" + AString::number(a) + ", " + AString::number(b) + ")";
+                    const float expected = oldCorr.correlate(oldA[a].data(), oldRrsA[a], oldB[b].data(), oldRrsB[b], fisherZ, false);
+                    const float pair = engine.correlatePair(ptrsA[a], newRrsA[a], ptrsB[b], newRrsB[b], fisherZ);
+                    const float tile = tileOut[a * NUM_ROWS_B + b];
+                    if (!sameBits(tile, expected))
+                    {
+                        return modeName + ": correlateTile gave " + AString::number(tile, 'g', 9) + where + ", expected " + AString::number(expected, 'g', 9);
+                    }
+                    if (!sameBits(pair, expected))
+                    {
+                        return modeName + ": correlatePair gave " + AString::number(pair, 'g', 9) + where + ", expected " + AString::number(expected, 'g', 9);
+                    }
+                    const float simdExpected = oldCorr.correlate(oldA[a].data(), oldRrsA[a], oldB[b].data(), oldRrsB[b], fisherZ, true);
+                    if (!(abs(tile - simdExpected) < 1e-5f * max(1.0f, abs(simdExpected))))
+                    {
+                        return modeName + ": correlateTile gave " + AString::number(tile, 'g', 9) + where + ", SIMD dot product gave " + AString::number(simdExpected, 'g', 9);
+                    }
+                }
+            }
+        }
+        return "";
+    }
+}
+
+void CorrelationEngineTest::execute()
+{
+    AString error = testWeights(NULL, "unweighted");
+    if (error != "") { setFailed(error); return; }
+    vector<float> weights(ROW_LENGTH, 1.0f);
+    error = testWeights(&weights, "all ones weights");
+    if (error != "") { setFailed(error); return; }
+    for (int64_t i = 0; i < ROW_LENGTH; i += 3)
+    {
+        weights[i] = 0.0f;
+    }
+    error = testWeights(&weights, "binary weights");
+    if (error != "") { setFailed(error); return; }
+    for (int64_t i = 0; i < ROW_LENGTH; ++i)
+    {
+        weights[i] = (i % 5 == 0) ? 0.0f : 0.25f + (i % 7) * 0.5f;
+    }
+    error = testWeights(&weights, "real weights");
+    if (error != "") { setFailed(error); return; }
+}
@@ -0,0 +1,266 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "EventManagerTest.h"
+
+#include "CaretAssert.h"
+#include "Event.h"
+#include "EventListenerInterface.h"
+#include "EventManager.h"
+#include "EventSurfaceColoringInvalidate.h"
+#include "MetricFile.h"
+
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+EventManagerTest::EventManagerTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //neither type has listeners outside the GUI
+    const EventTypeEnum::Enum OUTER_TYPE = EventTypeEnum::EVENT_ANNOTATION_TOOLBAR_UPDATE;
+    const EventTypeEnum::Enum NESTED_TYPE = EventTypeEnum::EVENT_BROWSER_WINDOW_MENUS_UPDATE;
+    
+    class TestEvent : public Event
+    {
+    public:
+        TestEvent(const EventTypeEnum::Enum eventType) : Event(eventType) { }
+    };
+    
+    //a receipt is the listener's id and the event type, in the order events were received
+    struct Receipt
+    {
+        int m_listenerId;
+        EventTypeEnum::Enum m_eventType;
+        Receipt(const int& listenerId, const EventTypeEnum::Enum& eventType) : m_listenerId(listenerId), m_eventType(eventType) { }
+        bool operator==(const Receipt& rhs) const { return m_listenerId == rhs.m_listenerId && m_eventType == rhs.m_eventType; }
+    };
+    
+    //records what it receives, then optionally removes a listener, adds a listener, or sends another event
+    class TestListener : public EventListenerInterface
+    {
+        int m_id;
+        vector<Receipt>* m_log;
+    public:
+        EventListenerInterface* m_removeOnReceive;
+        EventListenerInterface* m_addOnReceive;
+        EventTypeEnum::Enum m_actOnType, m_sendOnReceive;
+        
+        TestListener(const int& id, vector<Receipt>* log) : m_id(id), m_log(log)
+        {
+            m_removeOnReceive = NULL;
+            m_addOnReceive = NULL;
+            m_actOnType = OUTER_TYPE;
+            m_sendOnReceive = EventTypeEnum::EVENT_INVALID;
+        }
+        
+        ~TestListener()
+        {
+            EventManager::get()->removeAllEventsFromListener(this);
+        }
+        
+        void receiveEvent(Event* event)
+        {
+            m_log->push_back(Receipt(m_id, event->getEventType()));
+            if (event->getEventType() != m_actOnType) return;
+            if (m_removeOnReceive != NULL)
+            {
+                EventManager::get()->removeAllEventsFromListener(m_removeOnReceive);
+            }
+            if (m_addOnReceive != NULL)
+            {
+                EventManager::get()->addEventListener(m_addOnReceive, OUTER_TYPE);
+            }
+            if (m_sendOnReceive != EventTypeEnum::EVENT_INVALID)
+            {
+                TestEvent nested(m_sendOnReceive);
+                EventManager::get()->sendEvent(nested.getPointer());
+            }
+        }
+    };
+    
+    AString checkLog(const vector<Receipt>& log, const vector<Receipt>& expected, const AString& description)
+    {
+        if (log == expected) return "";
+        AString logText, expectedText;
+        for (int i = 0; i < (int)log.size(); ++i)
+        {
+            logText += " " + AString::number(log[i].m_listenerId) + ":" + EventTypeEnum::toName(log[i].m_eventType);
+        }
+        for (int i = 0; i < (int)expected.size(); ++i)
+        {
+            expectedText += " " + AString::number(expected[i].m_listenerId) + ":" + EventTypeEnum::toName(expected[i].m_eventType);
+        }
+        return description + ": listeners received" + logText + ", expected" + expectedText;
+    }
+    
+    AString testRemoveDuringSend()
+    {
+        EventManager* eventManager = EventManager::get();
+        vector<Receipt> log, expected;
+        TestListener l0(0, &log), l1(1, &log), l2(2, &log), l3(3, &log), l4(4, &log), l5(5, &log);
+        l1.m_removeOnReceive = &l1;//removes itself
+        l2.m_removeOnReceive = &l3;//removes a listener that has not received the event yet
+        l4.m_removeOnReceive = &l0;//removes a listener that already received the event
+        l4.m_addOnReceive = &l5;//must not receive the event being sent
+        eventManager->addEventListener(&l0, OUTER_TYPE);
+        eventManager->addEventListener(&l1, OUTER_TYPE);
+        eventManager->addEventListener(&l2, OUTER_TYPE);
+        eventManager->addEventListener(&l3, OUTER_TYPE);
+        eventManager->addEventListener(&l4, OUTER_TYPE);
+        TestEvent first(OUTER_TYPE);
+        eventManager->sendEvent(first.getPointer());
+        expected.push_back(Receipt(0, OUTER_TYPE));
+        expected.push_back(Receipt(1, OUTER_TYPE));
+        expected.push_back(Receipt(2, OUTER_TYPE));
+        expected.push_back(Receipt(4, OUTER_TYPE));
+        AString error = checkLog(log, expected, "first event with removals");
+        if (error != "") return error;
+        log.clear();
+        expected.clear();
+        TestEvent second(OUTER_TYPE);
+        eventManager->sendEvent(second.getPointer());
+        expected.push_back(Receipt(2, OUTER_TYPE));
+        expected.push_back(Receipt(4, OUTER_TYPE));
+        expected.push_back(Receipt(5, OUTER_TYPE));
+        return checkLog(log, expected, "event after removals");
+    }
+    
+    AString testSendDuringSend()
+    {
+        EventManager* eventManager = EventManager::get();
+        vector<Receipt> log, expected;
+        TestListener l0(0, &log), l1(1, &log), l2(2, &log);
+        l0.m_sendOnReceive = NESTED_TYPE;
+        l2.m_actOnType = NESTED_TYPE;
+        l2.m_removeOnReceive = &l1;//removed inside the nested event, before it receives the outer event
+        eventManager->addEventListener(&l0, OUTER_TYPE);
+        eventManager->addEventListener(&l1, OUTER_TYPE);
+        eventManager->addEventListener(&l1, NESTED_TYPE);
+        eventManager->addEventListener(&l2, NESTED_TYPE);
+        const int64_t outerCount = eventManager->getEventTypeIssuedCounter(OUTER_TYPE);
+        const int64_t nestedCount = eventManager->getEventTypeIssuedCounter(NESTED_TYPE);
+        TestEvent first(OUTER_TYPE);
+        eventManager->sendEvent(first.getPointer());
+        expected.push_back(Receipt(0, OUTER_TYPE));
+        expected.push_back(Receipt(1, NESTED_TYPE));
+        expected.push_back(Receipt(2, NESTED_TYPE));
+        AString error = checkLog(log, expected, "event sent from a listener");
+        if (error != "") return error;
+        if (eventManager->getEventTypeIssuedCounter(OUTER_TYPE) != outerCount + 1 ||
+            eventManager->getEventTypeIssuedCounter(NESTED_TYPE) != nestedCount + 1)
+        {
+            return "event sent from a listener was not counted once for each type";
+        }
+        log.clear();
+        expected.clear();
+        TestEvent second(OUTER_TYPE);
+        eventManager->sendEvent(second.getPointer());
+        expected.push_back(Receipt(0, OUTER_TYPE));
+        expected.push_back(Receipt(2, NESTED_TYPE));
+        return checkLog(log, expected, "event after removal in a nested event");
+    }
+    
+    class InvalidationListener : public EventListenerInterface
+    {
+    public:
+        vector<const CaretMappableDataFile*> m_received;
+        
+        InvalidationListener()
+        {
+            EventManager::get()->addEventListener(this, EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE);
+        }
+        
+        ~InvalidationListener()
+        {
+            EventManager::get()->removeAllEventsFromListener(this);
+        }
+        
+        void receiveEvent(Event* event)
+        {
+            EventSurfaceColoringInvalidate* invalidateEvent = dynamic_cast<EventSurfaceColoringInvalidate*>(event);
+            CaretAssert(invalidateEvent);
+            m_received.push_back(invalidateEvent->getMapFile());
+        }
+    };
+    
+    void sendInvalidate(const CaretMappableDataFile* mapFile)
+    {
+        if (mapFile == NULL)
+        {
+            EventManager::get()->sendEvent(EventSurfaceColoringInvalidate().getPointer());
+        } else {
+            EventManager::get()->sendEvent(EventSurfaceColoringInvalidate(mapFile).getPointer());
+        }
+    }
+    
+    AString checkInvalidations(const InvalidationListener& listener, const vector<const CaretMappableDataFile*>& expected, const AString& description)
+    {
+        if (listener.m_received == expected) return "";
+        return description + ": listener received " + AString::number((int)listener.m_received.size()) +
+               " invalidations, expected " + AString::number((int)expected.size());
+    }
+    
+    AString testCoalescedInvalidation()
+    {
+        EventManager* eventManager = EventManager::get();
+        MetricFile fileA, fileB;
+        InvalidationListener listener;
+        vector<const CaretMappableDataFile*> expected;
+        eventManager->sendSimpleEvent(NESTED_TYPE);//so an invalidation from an earlier test can't coalesce with ours
+        const int64_t issuedStart = eventManager->getEventTypeIssuedCounter(EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE);
+        sendInvalidate(NULL);
+        sendInvalidate(NULL);
+        sendInvalidate(&fileA);//already covered by invalidating everything
+        expected.push_back(NULL);
+        AString error = checkInvalidations(listener, expected, "repeated invalidation of everything");
+        if (error != "") return error;
+        eventManager->sendSimpleEvent(NESTED_TYPE);//caches may have been rebuilt by this
+        sendInvalidate(&fileA);
+        sendInvalidate(&fileA);
+        expected.push_back(&fileA);
+        error = checkInvalidations(listener, expected, "repeated invalidation of one file after another event");
+        if (error != "") return error;
+        sendInvalidate(&fileB);
+        sendInvalidate(NULL);
+        expected.push_back(&fileB);
+        expected.push_back(NULL);
+        error = checkInvalidations(listener, expected, "invalidation of different files");
+        if (error != "") return error;
+        if (eventManager->getEventTypeIssuedCounter(EventTypeEnum::EVENT_SURFACE_COLORING_INVALIDATE) != issuedStart + 4)
+        {
+            return "coalesced invalidations were counted as issued";
+        }
+        return "";
+    }
+}
+
+void EventManagerTest::execute()
+{
+    AString error = testRemoveDuringSend();
+    if (error != "") { setFailed(error); return; }
+    error = testSendDuringSend();
+    if (error != "") { setFailed(error); return; }
+    error = testCoalescedInvalidation();
+    if (error != "") { setFailed(error); return; }
+}
@@ -0,0 +1,264 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "FloatMatrixTest.h"
+
+#include "FloatMatrix.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+FloatMatrixTest::FloatMatrixTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    FloatMatrix randomMatrix(const int64_t& rows, const int64_t& cols)
+    {
+        FloatMatrix ret(rows, cols);
+        for (int64_t i = 0; i < rows; ++i)
+        {
+            for (int64_t j = 0; j < cols; ++j)
+            {
+                ret[i][j] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+            }
+        }
+        return ret;
+    }
+    
+    //float products summed in double in order of the inner index, which the blocked multiply must match exactly
+    AString checkMultiply(const int64_t& rows, const int64_t& inner, const int64_t& cols)
+    {
+        FloatMatrix left = randomMatrix(rows, inner), right = randomMatrix(inner, cols);
+        FloatMatrix result = left * right;
+        int64_t resultRows, resultCols;
+        result.getDimensions(resultRows, resultCols);
+        AString description = AString::number(rows) + "x" + AString::number(inner) + " times " + AString::number(inner) + "x" + AString::number(cols);
+        if (resultRows != rows || resultCols != cols) return description + " gave a " + AString::number(resultRows) + "x" + AString::number(resultCols) + " result";
+        for (int64_t i = 0; i < rows; ++i)
+        {
+            for (int64_t j = 0; j < cols; ++j)
+            {
+                double accum = 0.0;
+                for (int64_t k = 0; k < inner; ++k)
+                {
+                    accum += left[i][k] * right[k][j];
+                }
+                if (result[i][j] != (float)accum)
+                {
+                    return description + " element (" + AString::number(i) + ", " + AString::number(j) + ") is " + AString::number(result[i][j]) +
+                           ", naive multiply gave " + AString::number((float)accum);
+                }
+            }
+        }
+        return "";
+    }
+    
+    //reference least squares solution from the normal equations, by gaussian elimination with partial pivoting in double
+    vector<vector<double> > normalEquationsSolve(const FloatMatrix& design, const FloatMatrix& rhs)
+    {
+        int64_t numRows, numCols, numRHS, dummy;
+        design.getDimensions(numRows, numCols);
+        rhs.getDimensions(dummy, numRHS);
+        vector<vector<double> > system(numCols, vector<double>(numCols + numRHS, 0.0));
+        for (int64_t r = 0; r < numRows; ++r)
+        {
+            for (int64_t i = 0; i < numCols; ++i)
+            {
+                for (int64_t j = 0; j < numCols; ++j)
+                {
+                    system[i][j] += (double)design[r][i] * design[r][j];
+                }
+                for (int64_t c = 0; c < numRHS; ++c)
+                {
+                    system[i][numCols + c] += (double)design[r][i] * rhs[r][c];
+                }
+            }
+        }
+        for (int64_t i = 0; i < numCols; ++i)
+        {
+            int64_t pivot = i;
+            for (int64_t j = i + 1; j < numCols; ++j)
+            {
+                if (abs(system[j][i]) > abs(system[pivot][i])) pivot = j;
+            }
+            system[i].swap(system[pivot]);
+            for (int64_t j = 0; j < numCols; ++j)
+            {
+                if (j == i) continue;
+                double factor = system[j][i] / system[i][i];
+                for (int64_t k = i; k < numCols + numRHS; ++k)
+                {
+                    system[j][k] -= factor * system[i][k];
+                }
+            }
+        }
+        vector<vector<double> > ret(numCols, vector<double>(numRHS));
+        for (int64_t i = 0; i < numCols; ++i)
+        {
+            for (int64_t c = 0; c < numRHS; ++c)
+            {
+                ret[i][c] = system[i][numCols + c] / system[i][i];
+            }
+        }
+        return ret;
+    }
+    
+    AString checkLeastSquares(const FloatMatrix& design, const FloatMatrix& rhs, const vector<vector<double> >& expected, const double& tolerance, const AString& description)
+    {
+        FloatMatrix solution = design.solveLeastSquares(rhs);
+        int64_t rows, cols;
+        solution.getDimensions(rows, cols);
+        if (rows != (int64_t)expected.size() || cols != (int64_t)expected[0].size())
+        {
+            return description + " gave a " + AString::number(rows) + "x" + AString::number(cols) + " solution";
+        }
+        for (int64_t i = 0; i < rows; ++i)
+        {
+            for (int64_t j = 0; j < cols; ++j)
+            {
+                if (abs(solution[i][j] - expected[i][j]) > tolerance * max(1.0, abs(expected[i][j])))
+                {
+                    return description + " element (" + AString::number(i) + ", " + AString::number(j) + ") is " + AString::number(solution[i][j]) +
+                           ", expected " + AString::number(expected[i][j]);
+                }
+            }
+        }
+        return "";
+    }
+}
+
+void FloatMatrixTest::execute()
+{
+    srand(41);
+    testMultiply();
+    if (failed()) return;
+    testLeastSquares();
+}
+
+void FloatMatrixTest::testMultiply()
+{
+    //sizes around the row block of 8 and column block of 512, and big enough to use multiple threads
+    const int64_t sizes[][3] = { { 1, 1, 1 }, { 3, 4, 2 }, { 8, 5, 512 }, { 9, 7, 513 }, { 13, 700, 530 }, { 130, 40, 17 }, { 4, 0, 3 } };
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); ++i)
+    {
+        if (sizes[i][1] == 0)
+        {//empty inner dimension
+            FloatMatrix left(sizes[i][0], 0), right(0, sizes[i][2]);
+            int64_t rows, cols;
+            (left * right).getDimensions(rows, cols);
+            if (rows != 0 || cols != 0)
+            {
+                setFailed("multiply with empty inner dimension didn't give a 0x0 result");
+                return;
+            }
+            continue;
+        }
+        AString error = checkMultiply(sizes[i][0], sizes[i][1], sizes[i][2]);
+        if (error != "")
+        {
+            setFailed(error);
+            return;
+        }
+    }
+    int64_t rows, cols;
+    (randomMatrix(3, 4) * randomMatrix(3, 4)).getDimensions(rows, cols);
+    if (rows != 0 || cols != 0) setFailed("multiply with mismatched dimensions didn't give a 0x0 result");
+}
+
+void FloatMatrixTest::testLeastSquares()
+{
+    const int64_t NUM_ROWS = 300, NUM_COLS = 5, NUM_RHS = 4;
+    FloatMatrix design = randomMatrix(NUM_ROWS, NUM_COLS);
+    for (int64_t i = 0; i < NUM_ROWS; ++i)
+    {
+        design[i][0] = 1.0f;//intercept column, like a regression design
+        design[i][NUM_COLS - 1] = 50.0f * design[i][NUM_COLS - 1] + 100.0f;//a column with a different scale and offset
+    }
+    FloatMatrix exactBeta = randomMatrix(NUM_COLS, NUM_RHS);
+    FloatMatrix exactRHS(NUM_ROWS, NUM_RHS);
+    for (int64_t i = 0; i < NUM_ROWS; ++i)
+    {
+        for (int64_t c = 0; c < NUM_RHS; ++c)
+        {
+            double accum = 0.0;
+            for (int64_t k = 0; k < NUM_COLS; ++k)
+            {
+                accum += (double)design[i][k] * exactBeta[k][c];
+            }
+            exactRHS[i][c] = accum;
+        }
+    }
+    vector<vector<double> > expected(NUM_COLS, vector<double>(NUM_RHS));
+    for (int64_t i = 0; i < NUM_COLS; ++i)
+    {
+        for (int64_t c = 0; c < NUM_RHS; ++c)
+        {
+            expected[i][c] = exactBeta[i][c];
+        }
+    }
+    AString error = checkLeastSquares(design, exactRHS, expected, 1e-4, "consistent system");
+    if (error != "")
+    {
+        setFailed(error);
+        return;
+    }
+    FloatMatrix noisyRHS = randomMatrix(NUM_ROWS, NUM_RHS) + exactRHS;//no exact solution
+    error = checkLeastSquares(design, noisyRHS, normalEquationsSolve(design, noisyRHS), 1e-4, "inconsistent system");
+    if (error != "")
+    {
+        setFailed(error);
+        return;
+    }
+    FloatMatrix square = randomMatrix(NUM_COLS, NUM_COLS), squareRHS = randomMatrix(NUM_COLS, 1);
+    error = checkLeastSquares(square, squareRHS, normalEquationsSolve(square, squareRHS), 1e-3, "square system");
+    if (error != "")
+    {
+        setFailed(error);
+        return;
+    }
+    FloatMatrix deficient = design;
+    for (int64_t i = 0; i < NUM_ROWS; ++i)
+    {
+        deficient[i][2] = 2.0f * deficient[i][1];
+    }
+    int64_t rows, cols;
+    deficient.solveLeastSquares(noisyRHS).getDimensions(rows, cols);
+    if (rows != 0 || cols != 0)
+    {
+        setFailed("rank deficient system didn't give a 0x0 solution");
+        return;
+    }
+    design.solveLeastSquares(randomMatrix(NUM_ROWS - 1, NUM_RHS)).getDimensions(rows, cols);
+    if (rows != 0 || cols != 0)
+    {
+        setFailed("mismatched right hand side didn't give a 0x0 solution");
+        return;
+    }
+    randomMatrix(NUM_COLS - 1, NUM_COLS).solveLeastSquares(randomMatrix(NUM_COLS - 1, 1)).getDimensions(rows, cols);
+    if (rows != 0 || cols != 0)
+    {
+        setFailed("underdetermined system didn't give a 0x0 solution");
+    }
+}
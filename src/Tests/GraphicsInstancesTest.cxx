@@ -0,0 +1,190 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "GraphicsInstancesTest.h"
+
+#include "ElapsedTimer.h"
+#include "GraphicsPrimitiveV3fN3f.h"
+#include "GraphicsPrimitiveV3fN3fC4ub.h"
+#include "GraphicsShape.h"
+#include "MathFunctions.h"
+#include "Matrix4x4.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+GraphicsInstancesTest::GraphicsInstancesTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    float randFloat(const float& low, const float& high)
+    {
+        return low + (high - low) * ((float)rand()) / RAND_MAX;
+    }
+    
+    //octahedron triangles with vertex normals, repeated and offset to get shapes the size of the sphere used for foci
+    GraphicsPrimitiveV3fN3f* createTestShape(const int& numCopies)
+    {
+        const uint8_t rgbaUnused[4] = { 0, 0, 0, 255 };
+        GraphicsPrimitiveV3fN3f* ret = GraphicsPrimitive::newPrimitiveV3fN3f(GraphicsPrimitive::PrimitiveType::OPENGL_TRIANGLES, rgbaUnused);
+        for (int copy = 0; copy < numCopies; ++copy)
+        {
+            for (int face = 0; face < 8; ++face)
+            {
+                const float signs[3] = { (face & 1) ? -1.0f : 1.0f, (face & 2) ? -1.0f : 1.0f, (face & 4) ? -1.0f : 1.0f };
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    float xyz[3] = { copy * 0.01f, 0.0f, 0.0f }, normal[3] = { 0.0f, 0.0f, 0.0f };
+                    xyz[axis] += 0.5f * signs[axis];
+                    normal[axis] = signs[axis];
+                    ret->addVertex(xyz, normal);
+                }
+            }
+        }
+        return ret;
+    }
+    
+    //translation, rotation and nonuniform scaling, some mirrored, in the order the fiber cones use
+    void createTestInstances(const int& numInstances, vector<float>& matricesOut, vector<uint8_t>& rgbaOut)
+    {
+        matricesOut.resize(numInstances * 16);
+        rgbaOut.resize(numInstances * 4);
+        for (int i = 0; i < numInstances; ++i)
+        {
+            Matrix4x4 matrix;
+            matrix.translate(randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f));
+            matrix.rotate(randFloat(0.0f, 360.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(0.1f, 1.0f));
+            const float mirror = ((i % 5 == 4) ? -1.0f : 1.0f);
+            matrix.scale(mirror * randFloat(0.2f, 3.0f), randFloat(0.2f, 3.0f), randFloat(0.2f, 3.0f));
+            matrix.getMatrixForOpenGL(&matricesOut[i * 16]);
+            for (int j = 0; j < 4; ++j)
+            {
+                rgbaOut[i * 4 + j] = (uint8_t)(rand() % 256);
+            }
+        }
+    }
+    
+    //compare the instances against transforming each vertex separately, with normals by the inverse transpose
+    AString checkInstances(const GraphicsPrimitive* shape, const float matrices[], const uint8_t rgba[],
+                           const int& firstInstance, const int& numInstances, const GraphicsPrimitive* instances)
+    {
+        const int numShapeVertices = shape->getNumberOfVertices();
+        if (instances->getNumberOfVertices() != numInstances * numShapeVertices)
+        {
+            return "instances primitive has " + AString::number(instances->getNumberOfVertices()) + " vertices, expected "
+                   + AString::number(numInstances * numShapeVertices);
+        }
+        const vector<float>& shapeXYZ = shape->getFloatXYZ(), &shapeNormals = shape->getFloatNormalVectorXYZ();
+        const vector<float>& xyz = instances->getFloatXYZ(), &normals = instances->getFloatNormalVectorXYZ();
+        if (normals.size() != xyz.size()) return "instances primitive is missing normal vectors";
+        for (int i = 0; i < numInstances; ++i)
+        {
+            const int instance = firstInstance + i;
+            Matrix4x4 matrix;
+            matrix.setMatrixFromOpenGL(&matrices[instance * 16]);
+            Matrix4x4 normalMatrix = matrix;
+            if (!normalMatrix.invert()) return "test matrix is singular";
+            normalMatrix.transpose();
+            for (int k = 0; k < numShapeVertices; ++k)
+            {
+                const int v = i * numShapeVertices + k;
+                float expectXYZ[3] = { shapeXYZ[k * 3], shapeXYZ[k * 3 + 1], shapeXYZ[k * 3 + 2] };
+                matrix.multiplyPoint3(expectXYZ);
+                float expectNormal[3] = { shapeNormals[k * 3], shapeNormals[k * 3 + 1], shapeNormals[k * 3 + 2] };
+                normalMatrix.multiplyPoint3X3(expectNormal);
+                MathFunctions::normalizeVector(expectNormal);
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    if (abs(xyz[v * 3 + axis] - expectXYZ[axis]) > 0.0001f * (1.0f + abs(expectXYZ[axis])))
+                    {
+                        return "instance " + AString::number(instance) + " vertex " + AString::number(k) + " has coordinate "
+                               + AString::number(xyz[v * 3 + axis]) + ", expected " + AString::number(expectXYZ[axis]);
+                    }
+                    if (abs(normals[v * 3 + axis] - expectNormal[axis]) > 0.0001f)
+                    {
+                        return "instance " + AString::number(instance) + " vertex " + AString::number(k) + " has normal component "
+                               + AString::number(normals[v * 3 + axis]) + ", expected " + AString::number(expectNormal[axis]);
+                    }
+                }
+                uint8_t vertexRGBA[4];
+                instances->getVertexByteRGBA(v, vertexRGBA);
+                if (memcmp(vertexRGBA, &rgba[instance * 4], 4) != 0)
+                {
+                    return "instance " + AString::number(instance) + " vertex " + AString::number(k) + " has the wrong color";
+                }
+            }
+        }
+        return "";
+    }
+}
+
+void GraphicsInstancesTest::execute()
+{
+    srand(7);
+    unique_ptr<GraphicsPrimitiveV3fN3f> shape(createTestShape(1));
+    vector<float> matrices;
+    vector<uint8_t> rgba;
+    const int numInstances = 40;
+    createTestInstances(numInstances, matrices, rgba);
+    unique_ptr<GraphicsPrimitiveV3fN3fC4ub> instances(GraphicsShape::createInstancesPrimitive(shape.get(), matrices.data(), rgba.data(), 0, numInstances));
+    AString error = checkInstances(shape.get(), matrices.data(), rgba.data(), 0, numInstances, instances.get());
+    if (error != "")
+    {
+        setFailed("all instances: " + error);
+        return;
+    }
+    instances.reset(GraphicsShape::createInstancesPrimitive(shape.get(), matrices.data(), rgba.data(), 13, 9));//a batch in the middle
+    error = checkInstances(shape.get(), matrices.data(), rgba.data(), 13, 9, instances.get());
+    if (error != "")
+    {
+        setFailed("batch of instances: " + error);
+        return;
+    }
+    
+    //what a redraw of unchanged foci cost before keeping the instances primitives, versus the comparison that finds them now
+    const int numBenchInstances = 3000;
+    shape.reset(createTestShape(25));//600 vertices, like the sphere used for foci
+    createTestInstances(numBenchInstances, matrices, rgba);
+    vector<float> matricesCopy = matrices;
+    vector<uint8_t> rgbaCopy = rgba;
+    ElapsedTimer timer;
+    timer.start();
+    instances.reset(GraphicsShape::createInstancesPrimitive(shape.get(), matrices.data(), rgba.data(), 0, numBenchInstances));
+    double createMilliseconds = timer.getElapsedTimeMilliseconds();
+    timer.start();
+    bool same = (memcmp(matricesCopy.data(), matrices.data(), matrices.size() * sizeof(float)) == 0 &&
+                 memcmp(rgbaCopy.data(), rgba.data(), rgba.size()) == 0);
+    double compareMilliseconds = timer.getElapsedTimeMilliseconds();
+    if (!same || instances->getNumberOfVertices() != numBenchInstances * shape->getNumberOfVertices())
+    {
+        setFailed("benchmark instances are wrong");
+        return;
+    }
+    cout << numBenchInstances << " instances of " << shape->getNumberOfVertices() << " vertices: transforming took "
+         << createMilliseconds << " ms, finding them unchanged took " << compareMilliseconds << " ms" << endl;
+}
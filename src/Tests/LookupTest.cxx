@@ -21,17 +21,121 @@
 
 #include "CaretCompactLookup.h"
 #include "CaretCompact3DLookup.h"
+#include "CiftiBrainModelsMap.h"
+#include "DataFileException.h"
 
 #include <cstdlib>
+#include <limits>
+#include <map>
+#include <set>
 
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    struct VoxelRef
+    {
+        int64_t m_index;
+        StructureEnum::Enum m_structure;
+    };
+    
+    typedef map<vector<int64_t>, VoxelRef> VoxelRefMap;
+    
+    vector<int64_t> makeIJK(const int64_t& i, const int64_t& j, const int64_t& k)
+    {
+        vector<int64_t> ret(3);
+        ret[0] = i;
+        ret[1] = j;
+        ret[2] = k;
+        return ret;
+    }
+    
+    //add volume models to the map, and record what each voxel should look up to
+    void addVolumeModels(CiftiBrainModelsMap& myMap, const vector<vector<int64_t> >& voxelLists, const vector<StructureEnum::Enum>& structures, VoxelRefMap& refOut)
+    {
+        for (int m = 0; m < (int)voxelLists.size(); ++m)
+        {
+            int64_t start = myMap.getLength();
+            myMap.addVolumeModel(structures[m], voxelLists[m]);
+            for (int64_t v = 0; v < (int64_t)voxelLists[m].size() / 3; ++v)
+            {
+                VoxelRef myRef = { start + v, structures[m] };
+                refOut[makeIJK(voxelLists[m][v * 3], voxelLists[m][v * 3 + 1], voxelLists[m][v * 3 + 2])] = myRef;
+            }
+        }
+    }
+    
+    //check single and batch voxel lookups on a list of i, j, k triples against the reference, returns an empty string on success
+    AString checkVoxelQueries(const CiftiBrainModelsMap& myMap, const VoxelRefMap& ref, const vector<int64_t>& queries, const AString& description)
+    {
+        vector<StructureEnum::Enum> batchStructures;
+        vector<int64_t> batchIndices = myMap.getIndicesForVoxels(queries, &batchStructures);
+        vector<int64_t> batchIndicesNoStructure = myMap.getIndicesForVoxels(queries);
+        int64_t numQueries = (int64_t)queries.size() / 3;
+        if ((int64_t)batchIndices.size() != numQueries || (int64_t)batchStructures.size() != numQueries || batchIndicesNoStructure != batchIndices)
+        {
+            return description + ": batch voxel lookup returned inconsistent results";
+        }
+        for (int64_t q = 0; q < numQueries; ++q)
+        {
+            const int64_t* ijk = queries.data() + q * 3;
+            AString voxelText = " for voxel (" + AString::number(ijk[0]) + ", " + AString::number(ijk[1]) + ", " + AString::number(ijk[2]) + ")";
+            StructureEnum::Enum structure = StructureEnum::INVALID;
+            int64_t index = myMap.getIndexForVoxel(ijk, &structure);
+            VoxelRefMap::const_iterator iter = ref.find(makeIJK(ijk[0], ijk[1], ijk[2]));
+            if (iter == ref.end())
+            {
+                if (index != -1) return description + ": found index " + AString::number(index) + voxelText + " that is not in the map";
+                if (batchIndices[q] != -1) return description + ": batch lookup found index " + AString::number(batchIndices[q]) + voxelText + " that is not in the map";
+                continue;
+            }
+            if (index != iter->second.m_index || structure != iter->second.m_structure)
+            {
+                return description + ": lookup gave index " + AString::number(index) + ", expected " + AString::number(iter->second.m_index) + voxelText;
+            }
+            if (batchIndices[q] != iter->second.m_index || batchStructures[q] != iter->second.m_structure)
+            {
+                return description + ": batch lookup gave index " + AString::number(batchIndices[q]) + ", expected " + AString::number(iter->second.m_index) + voxelText;
+            }
+            CiftiBrainModelsMap::IndexInfo myInfo = myMap.getInfoForIndex(index);
+            if (myInfo.m_type != CiftiBrainModelsMap::VOXELS || myInfo.m_structure != structure ||
+                myInfo.m_ijk[0] != ijk[0] || myInfo.m_ijk[1] != ijk[1] || myInfo.m_ijk[2] != ijk[2])
+            {
+                return description + ": index " + AString::number(index) + " does not map back" + voxelText;
+            }
+        }
+        return "";
+    }
+    
+    //check that adding these volume models throws because a voxel is used twice
+    AString checkDuplicatesRejected(const VolumeSpace& mySpace, const vector<vector<int64_t> >& voxelLists, const vector<StructureEnum::Enum>& structures, const AString& description)
+    {
+        CiftiBrainModelsMap myMap;
+        myMap.setVolumeSpace(mySpace);
+        VoxelRefMap ignored;
+        try
+        {
+            addVolumeModels(myMap, voxelLists, structures, ignored);
+        } catch (DataFileException&) {
+            return "";
+        }
+        return description + ": duplicate voxel was not rejected";
+    }
+}
+
 LookupTest::LookupTest(const AString& identifier) : TestInterface(identifier)
 {
 }
 
 void LookupTest::execute()
+{
+    testCompactLookups();
+    if (failed()) return;
+    testBrainModelsLookups();
+}
+
+void LookupTest::testCompactLookups()
 {
     const int LOOKUP_SIZE = 500;
     const int LOOKUP_START = -200;
@@ -105,3 +209,229 @@ void LookupTest::execute()
       }      
    }
 }
+
+void LookupTest::testBrainModelsLookups()
+{
+    const float sform[12] = { 2.0f, 0.0f, 0.0f, -90.0f,
+                              0.0f, 2.0f, 0.0f, -126.0f,
+                              0.0f, 0.0f, 2.0f, -72.0f };
+    vector<StructureEnum::Enum> structures(2);
+    structures[0] = StructureEnum::THALAMUS_LEFT;
+    structures[1] = StructureEnum::THALAMUS_RIGHT;
+    /* Voxels that fill much of their bounding box use the bitmap with rank counts */
+    {
+        const int64_t dims[3] = { 20, 18, 16 };
+        VolumeSpace mySpace(dims, sform);
+        vector<vector<int64_t> > voxelLists(2);
+        for (int64_t k = 2; k < dims[2] - 1; ++k)
+        {
+            for (int64_t j = 1; j < dims[1]; ++j)
+            {
+                for (int64_t i = 3; i < dims[0] - 2; ++i)
+                {
+                    if (rand() % 2 == 0) continue;
+                    vector<int64_t>& myList = voxelLists[i < 10 ? 0 : 1];
+                    myList.push_back(i);
+                    myList.push_back(j);
+                    myList.push_back(k);
+                }
+            }
+        }
+        vector<int64_t> reversed;//reverse the order of the second list, as bitmap entries are in position order rather than index order
+        for (int64_t v = (int64_t)voxelLists[1].size() / 3 - 1; v >= 0; --v)
+        {
+            reversed.insert(reversed.end(), voxelLists[1].begin() + v * 3, voxelLists[1].begin() + v * 3 + 3);
+        }
+        voxelLists[1] = reversed;
+        CiftiBrainModelsMap myMap;
+        myMap.setVolumeSpace(mySpace);
+        myMap.addSurfaceModel(100, StructureEnum::CORTEX_LEFT);//surface before the volume, so voxel indices don't start at 0
+        VoxelRefMap ref;
+        addVolumeModels(myMap, voxelLists, structures, ref);
+        vector<int64_t> queries;//every voxel in and around the volume, including negative and out of range indices
+        for (int64_t k = -2; k < dims[2] + 2; ++k)
+        {
+            for (int64_t j = -2; j < dims[1] + 2; ++j)
+            {
+                for (int64_t i = -2; i < dims[0] + 2; ++i)
+                {
+                    queries.push_back(i);
+                    queries.push_back(j);
+                    queries.push_back(k);
+                }
+            }
+        }
+        const int64_t extremes[4] = { numeric_limits<int64_t>::min(), -1, dims[0] * dims[1] * dims[2], numeric_limits<int64_t>::max() };
+        for (int e = 0; e < 4; ++e)
+        {
+            queries.push_back(extremes[e]); queries.push_back(5); queries.push_back(5);
+            queries.push_back(5); queries.push_back(extremes[e]); queries.push_back(5);
+            queries.push_back(5); queries.push_back(5); queries.push_back(extremes[e]);
+        }
+        AString message = checkVoxelQueries(myMap, ref, queries, "dense voxel lookup");
+        if (message != "")
+        {
+            setFailed(message);
+            return;
+        }
+        /* Batch lookups of nodes and indices */
+        vector<int64_t> nodeQueries;
+        for (int64_t n = -3; n < 105; ++n)
+        {
+            nodeQueries.push_back(n);
+        }
+        vector<int64_t> nodeIndices = myMap.getIndicesForNodes(nodeQueries, StructureEnum::CORTEX_LEFT);
+        for (int64_t q = 0; q < (int64_t)nodeQueries.size(); ++q)
+        {
+            int64_t expected = (nodeQueries[q] >= 0 && nodeQueries[q] < 100) ? nodeQueries[q] : -1;
+            if (expected != -1 && myMap.getIndexForNode(nodeQueries[q], StructureEnum::CORTEX_LEFT) != expected)
+            {
+                setFailed("node lookup of node " + AString::number(nodeQueries[q]) + " gave the wrong index");
+                return;
+            }
+            if (nodeIndices[q] != expected)
+            {
+                setFailed("batch node lookup of node " + AString::number(nodeQueries[q]) + " gave " + AString::number(nodeIndices[q]) + ", expected " + AString::number(expected));
+                return;
+            }
+        }
+        vector<int64_t> missingStructure = myMap.getIndicesForNodes(nodeQueries, StructureEnum::CORTEX_RIGHT);
+        if (missingStructure != vector<int64_t>(nodeQueries.size(), -1))
+        {
+            setFailed("batch node lookup found nodes in a structure that is not in the map");
+            return;
+        }
+        vector<int64_t> indexQueries;
+        for (int64_t q = 0; q < 2000; ++q)
+        {//mostly runs of consecutive indices that cross model boundaries, with some random jumps and repeats
+            if (q % 50 == 0 || indexQueries.empty())
+            {
+                indexQueries.push_back(rand() % myMap.getLength());
+            } else {
+                indexQueries.push_back((indexQueries.back() + 1) % myMap.getLength());
+            }
+        }
+        vector<CiftiBrainModelsMap::IndexInfo> infos = myMap.getInfoForIndices(indexQueries);
+        for (int64_t q = 0; q < (int64_t)indexQueries.size(); ++q)
+        {
+            CiftiBrainModelsMap::IndexInfo expected = myMap.getInfoForIndex(indexQueries[q]);
+            bool match = (infos[q].m_type == expected.m_type && infos[q].m_structure == expected.m_structure);
+            if (match && expected.m_type == CiftiBrainModelsMap::SURFACE)
+            {
+                match = (infos[q].m_surfaceNode == expected.m_surfaceNode);
+            } else if (match) {
+                match = (infos[q].m_ijk[0] == expected.m_ijk[0] && infos[q].m_ijk[1] == expected.m_ijk[1] && infos[q].m_ijk[2] == expected.m_ijk[2]);
+            }
+            if (!match)
+            {
+                setFailed("batch index info for index " + AString::number(indexQueries[q]) + " does not match single index info");
+                return;
+            }
+        }
+        /* Copies share the lookup */
+        CiftiBrainModelsMap myCopy(myMap);
+        message = checkVoxelQueries(myCopy, ref, queries, "copy of dense voxel lookup");
+        if (message != "")
+        {
+            setFailed(message);
+            return;
+        }
+        /* Duplicate voxels, within a structure and across structures */
+        vector<vector<int64_t> > duplicateLists(voxelLists);
+        duplicateLists[0].push_back(duplicateLists[0][3]);
+        duplicateLists[0].push_back(duplicateLists[0][4]);
+        duplicateLists[0].push_back(duplicateLists[0][5]);
+        message = checkDuplicatesRejected(mySpace, duplicateLists, structures, "dense voxel lookup within a structure");
+        if (message != "")
+        {
+            setFailed(message);
+            return;
+        }
+        duplicateLists = voxelLists;
+        duplicateLists[1].push_back(voxelLists[0][0]);
+        duplicateLists[1].push_back(voxelLists[0][1]);
+        duplicateLists[1].push_back(voxelLists[0][2]);
+        message = checkDuplicatesRejected(mySpace, duplicateLists, structures, "dense voxel lookup across structures");
+        if (message != "")
+        {
+            setFailed(message);
+            return;
+        }
+    }
+    /* Voxels scattered through a large volume use the open addressing hash table */
+    {
+        const int64_t dims[3] = { 2000, 1500, 1000 };
+        VolumeSpace mySpace(dims, sform);
+        vector<vector<int64_t> > voxelLists(2);
+        set<vector<int64_t> > used;
+        while (used.size() < 3000)
+        {
+            vector<int64_t> ijk = makeIJK(rand() % dims[0], rand() % dims[1], rand() % dims[2]);
+            if (!used.insert(ijk).second) continue;
+            if (used.size() % 7 == 0)
+            {//some clusters of adjacent voxels, which hash to nearby values
+                for (int64_t di = 1; di < 4 && ijk[0] + di < dims[0]; ++di)
+                {
+                    vector<int64_t> neighbor = makeIJK(ijk[0] + di, ijk[1], ijk[2]);
+                    if (used.insert(neighbor).second)
+                    {
+                        voxelLists[1].insert(voxelLists[1].end(), neighbor.begin(), neighbor.end());
+                    }
+                }
+            }
+            vector<int64_t>& myList = voxelLists[ijk[0] < dims[0] / 2 ? 0 : 1];
+            myList.insert(myList.end(), ijk.begin(), ijk.end());
+        }
+        CiftiBrainModelsMap myMap;
+        myMap.setVolumeSpace(mySpace);
+        VoxelRefMap ref;
+        addVolumeModels(myMap, voxelLists, structures, ref);
+        vector<int64_t> queries;//every voxel in the map, and its neighbors, which are mostly not in the map
+        for (set<vector<int64_t> >::const_iterator iter = used.begin(); iter != used.end(); ++iter)
+        {
+            const vector<int64_t>& ijk = *iter;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                for (int64_t offset = -1; offset <= 1; ++offset)
+                {
+                    vector<int64_t> query(ijk);
+                    query[axis] += offset;
+                    queries.insert(queries.end(), query.begin(), query.end());
+                }
+            }
+        }
+        for (int q = 0; q < 10000; ++q)
+        {
+            queries.push_back(rand() % (dims[0] + 10) - 5);
+            queries.push_back(rand() % (dims[1] + 10) - 5);
+            queries.push_back(rand() % (dims[2] + 10) - 5);
+        }
+        const int64_t extremes[3] = { numeric_limits<int64_t>::min(), -1, numeric_limits<int64_t>::max() };
+        for (int e = 0; e < 3; ++e)
+        {
+            queries.push_back(extremes[e]); queries.push_back(extremes[e]); queries.push_back(extremes[e]);
+        }
+        AString message = checkVoxelQueries(myMap, ref, queries, "hashed voxel lookup");
+        if (message != "")
+        {
+            setFailed(message);
+            return;
+        }
+        vector<vector<int64_t> > duplicateLists(voxelLists);
+        duplicateLists[1].insert(duplicateLists[1].begin(), duplicateLists[1].end() - 3, duplicateLists[1].end());
+        message = checkDuplicatesRejected(mySpace, duplicateLists, structures, "hashed voxel lookup within a structure");
+        if (message != "")
+        {
+            setFailed(message);
+            return;
+        }
+        duplicateLists = voxelLists;
+        duplicateLists[1].insert(duplicateLists[1].end(), voxelLists[0].end() - 3, voxelLists[0].end());
+        message = checkDuplicatesRejected(mySpace, duplicateLists, structures, "hashed voxel lookup across structures");
+        if (message != "")
+        {
+            setFailed(message);
+            return;
+        }
+    }
+}
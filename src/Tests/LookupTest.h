@@ -29,6 +29,9 @@ namespace caret {
    public:
       LookupTest(const AString& identifier);
       virtual void execute();
+   private:
+      void testCompactLookups();
+      void testBrainModelsLookups();
    };
 
 }
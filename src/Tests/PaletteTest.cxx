@@ -0,0 +1,213 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "PaletteTest.h"
+
+#include "FastStatistics.h"
+#include "NodeAndVoxelColoring.h"
+#include "Palette.h"
+#include "PaletteColorMapping.h"
+#include "PaletteFile.h"
+#include "PaletteLookupTable.h"
+#include "PaletteScalarAndColor.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+PaletteTest::PaletteTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //evenly spaced values, and values at and just beside each control point, where the table must not move color boundaries
+    vector<float> makeNormalizedValues(const Palette* palette)
+    {
+        vector<float> ret;
+        const int numSteps = 20000;
+        for (int i = 0; i <= numSteps; ++i)
+        {
+            ret.push_back(-1.0f + 2.0f * i / numSteps);
+        }
+        for (int i = 0; i < palette->getNumberOfScalarsAndColors(); ++i)
+        {
+            float scalar = palette->getScalarAndColor(i)->getScalar();
+            ret.push_back(scalar);
+            ret.push_back(nextafter(scalar, -2.0f));
+            ret.push_back(nextafter(scalar, 2.0f));
+            ret.push_back(scalar - 1e-4f);
+            ret.push_back(scalar + 1e-4f);
+        }
+        ret.push_back(-1.5f);
+        ret.push_back(1.5f);
+        return ret;
+    }
+    
+    AString compareColors(const float expected[4], const float actual[4], const AString& description)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            if (abs(expected[c] - actual[c]) > 1e-5f)
+            {
+                return description + " has component " + AString::number(c) + " of " + AString::number(actual[c]) + ", expected " + AString::number(expected[c]);
+            }
+        }
+        return "";
+    }
+    
+    AString compareLookupTable(const Palette* palette, const bool& interpolate)
+    {
+        const PaletteLookupTable* lookupTable = palette->getLookupTable(interpolate);
+        if (palette->getLookupTable(interpolate) != lookupTable)
+        {
+            return "lookup table for palette " + palette->getName() + " was not kept";
+        }
+        vector<float> values = makeNormalizedValues(palette);
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            float expected[4], actual[4];
+            palette->getPaletteColor(values[i], interpolate, expected);
+            lookupTable->getPaletteColor(values[i], actual);
+            AString error = compareColors(expected, actual, "lookup table color of palette " + palette->getName() + " at " + AString::number(values[i]) +
+                                          (interpolate ? " with" : " without") + " interpolation");
+            if (error != "") return error;
+        }
+        return "";
+    }
+    
+    //the per-element coloring before the lookup table and threshold mask, for display of all values with normal thresholding
+    void referenceColor(const Palette* palette, const bool& interpolate, const float& scalar, const float& normalized, const float& threshold,
+                        const bool& skipThreshold, const bool& showOutside, const float& threshMin, const float& threshMax, float rgbaOut[4])
+    {
+        for (int c = 0; c < 4; ++c) rgbaOut[c] = 0.0f;
+        if (scalar != scalar) return;
+        float rgba[4];
+        palette->getPaletteColor(max(-1.0f, min(1.0f, normalized)), interpolate, rgba);
+        if (rgba[3] > 0.0f)
+        {
+            for (int c = 0; c < 4; ++c) rgbaOut[c] = rgba[c];
+        }
+        bool passed = skipThreshold;
+        if (!skipThreshold)
+        {
+            if (showOutside)
+            {
+                passed = (threshold > threshMax || threshold < threshMin);
+            } else {
+                passed = (threshold >= threshMin && threshold <= threshMax);
+            }
+        }
+        if (!passed) rgbaOut[3] = 0.0f;
+    }
+    
+    AString checkColoring(PaletteColorMapping& mapping, const vector<float>& scalars, const vector<float>& thresholds, const AString& description)
+    {
+        const int64_t numScalars = (int64_t)scalars.size();
+        FastStatistics statistics(scalars.data(), numScalars);
+        vector<float> normalized(numScalars), colors(numScalars * 4);
+        mapping.mapDataToPaletteNormalizedValues(&statistics, scalars.data(), normalized.data(), numScalars);
+        NodeAndVoxelColoring::colorScalarsWithPalette(&statistics, &mapping, scalars.data(), &mapping, thresholds.data(), numScalars, colors.data());
+        const Palette* palette = mapping.getPalette();
+        const PaletteThresholdTypeEnum::Enum thresholdType = mapping.getThresholdType();
+        const bool skipThreshold = (thresholdType == PaletteThresholdTypeEnum::THRESHOLD_TYPE_OFF);
+        const bool showOutside = (mapping.getThresholdTest() == PaletteThresholdTestEnum::THRESHOLD_TEST_SHOW_OUTSIDE);
+        for (int64_t i = 0; i < numScalars; ++i)
+        {
+            float expected[4];
+            referenceColor(palette, mapping.isInterpolatePaletteFlag(), scalars[i], normalized[i], thresholds[i], skipThreshold, showOutside,
+                           mapping.getThresholdMinimum(thresholdType), mapping.getThresholdMaximum(thresholdType), expected);
+            AString error = compareColors(expected, colors.data() + i * 4, description + " element " + AString::number(i));
+            if (error != "") return error;
+        }
+        return "";
+    }
+}
+
+void PaletteTest::execute()
+{
+    PaletteFile paletteFile;
+    for (int32_t i = 0; i < paletteFile.getNumberOfPalettes(); ++i)
+    {
+        for (int interp = 0; interp < 2; ++interp)
+        {
+            AString error = compareLookupTable(paletteFile.getPalette(i), interp != 0);
+            if (error != "")
+            {
+                setFailed(error);
+                return;
+            }
+        }
+    }
+    
+    //the table is replaced when the palette is modified
+    Palette modified(*paletteFile.getPaletteByName(Palette::ROY_BIG_BL_PALETTE_NAME));
+    modified.getLookupTable(true);
+    modified.removeScalarAndColor(modified.getNumberOfScalarsAndColors() / 2);
+    AString error = compareLookupTable(&modified, true);
+    if (error != "")
+    {
+        setFailed("after modification, " + error);
+        return;
+    }
+    
+    //scalars larger than the user scale, NaN and scalars at zero, and thresholds from other data and from the scalars themselves
+    srand(31);
+    const int64_t numScalars = 5000;
+    vector<float> scalars(numScalars), otherThresholds(numScalars);
+    for (int64_t i = 0; i < numScalars; ++i)
+    {
+        scalars[i] = ((float)rand() / RAND_MAX - 0.5f) * 10.0f;
+        otherThresholds[i] = ((float)rand() / RAND_MAX - 0.5f) * 4.0f;
+    }
+    scalars[10] = numeric_limits<float>::quiet_NaN();
+    scalars[11] = 0.0f;
+    otherThresholds[12] = numeric_limits<float>::quiet_NaN();
+    PaletteColorMapping mapping;
+    mapping.setSelectedPaletteName(Palette::ROY_BIG_BL_PALETTE_NAME);
+    mapping.setScaleMode(PaletteScaleModeEnum::MODE_USER_SCALE);
+    mapping.setUserScaleNegativeMaximum(-4.0f);
+    mapping.setUserScaleNegativeMinimum(-0.5f);
+    mapping.setUserScalePositiveMinimum(0.5f);
+    mapping.setUserScalePositiveMaximum(4.0f);
+    mapping.setDisplayZeroDataFlag(true);
+    mapping.setThresholdMinimum(PaletteThresholdTypeEnum::THRESHOLD_TYPE_NORMAL, -1.0f);
+    mapping.setThresholdMaximum(PaletteThresholdTypeEnum::THRESHOLD_TYPE_NORMAL, 1.5f);
+    for (int interp = 0; interp < 2 && error == ""; ++interp)
+    {
+        mapping.setInterpolatePaletteFlag(interp != 0);
+        AString interpString = (interp != 0 ? " with interpolation" : " without interpolation");
+        mapping.setThresholdType(PaletteThresholdTypeEnum::THRESHOLD_TYPE_OFF);
+        error = checkColoring(mapping, scalars, otherThresholds, "coloring without thresholding" + interpString);
+        if (error != "") break;
+        mapping.setThresholdType(PaletteThresholdTypeEnum::THRESHOLD_TYPE_NORMAL);
+        mapping.setThresholdTest(PaletteThresholdTestEnum::THRESHOLD_TEST_SHOW_OUTSIDE);
+        error = checkColoring(mapping, scalars, scalars, "coloring thresholded outside by the scalars" + interpString);
+        if (error != "") break;
+        error = checkColoring(mapping, scalars, otherThresholds, "coloring thresholded outside by other data" + interpString);
+        if (error != "") break;
+        mapping.setThresholdTest(PaletteThresholdTestEnum::THRESHOLD_TEST_SHOW_INSIDE);
+        error = checkColoring(mapping, scalars, otherThresholds, "coloring thresholded inside by other data" + interpString);
+    }
+    if (error != "") setFailed(error);
+}
@@ -26,7 +26,7 @@
 using namespace std;
 using namespace caret;
 
-TestAlgorithm::TestAlgorithm(ProgressObject* myproginfo, bool testOver) : AbstractAlgorithm(myproginfo)
+TestAlgorithm::TestAlgorithm(ProgressObject* myproginfo, bool testOver) : AbstractAlgorithm(myproginfo, "TestAlgorithm")
 {
    m_failed = false;
    const float oddEndWeight = 17.0f;
@@ -70,7 +70,7 @@ TestAlgorithm::TestAlgorithm(ProgressObject* myproginfo, bool testOver) : Abstra
    }
 }
 
-TestAlgorithm2::TestAlgorithm2(ProgressObject* myproginfo): AbstractAlgorithm(myproginfo)
+TestAlgorithm2::TestAlgorithm2(ProgressObject* myproginfo): AbstractAlgorithm(myproginfo, "TestAlgorithm2")
 {
    //do nothing, simulate ignoring the object
 }
@@ -0,0 +1,214 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "RibbonMappingTest.h"
+
+#include "AlgorithmVolumeToSurfaceMapping.h"
+#include "FloatMatrix.h"
+#include "MetricFile.h"
+#include "RibbonMappingHelper.h"
+#include "SurfaceFile.h"
+#include "VolumeFile.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+RibbonMappingTest::RibbonMappingTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    const int GRID_SIZE = 10;
+    
+    //a wavy grid, so the ribbon between two of them is several voxels thick and crosses voxels at many different fractions
+    void makeSheet(const float& height, SurfaceFile& sheetOut)
+    {
+        sheetOut.setNumberOfNodesAndTriangles(GRID_SIZE * GRID_SIZE, (GRID_SIZE - 1) * (GRID_SIZE - 1) * 2);
+        for (int j = 0; j < GRID_SIZE; ++j)
+        {
+            for (int i = 0; i < GRID_SIZE; ++i)
+            {
+                sheetOut.setCoordinate(i + j * GRID_SIZE, 2.5f * i + 0.3f * sin(1.3f * j), 2.5f * j + 0.3f * cos(0.7f * i), height + 0.8f * sin(0.5f * i) * cos(0.3f * j));
+            }
+        }
+        int triangle = 0;
+        for (int j = 0; j < GRID_SIZE - 1; ++j)
+        {
+            for (int i = 0; i < GRID_SIZE - 1; ++i)
+            {
+                int node = i + j * GRID_SIZE;
+                sheetOut.setTriangle(triangle++, node, node + 1, node + GRID_SIZE);
+                sheetOut.setTriangle(triangle++, node + 1, node + GRID_SIZE + 1, node + GRID_SIZE);
+            }
+        }
+    }
+    
+    //the per-frame mapping from per-vertex voxel weight lists, as it was done before the compact weights
+    vector<float> mapFrameReference(const vector<vector<VoxelWeight> >& weights, const VolumeFile& volume, const int64_t& frame)
+    {
+        int64_t numNodes = (int64_t)weights.size();
+        vector<float> ret(numNodes, 0.0f);
+        for (int64_t node = 0; node < numNodes; ++node)
+        {
+            float totalWeight = 0.0f;
+            int numVoxels = (int)weights[node].size();
+            for (int voxel = 0; voxel < numVoxels; ++voxel)
+            {
+                float thisWeight = weights[node][voxel].weight;
+                totalWeight += thisWeight;
+                ret[node] += thisWeight * volume.getValue(weights[node][voxel].ijk, frame);
+            }
+            if (totalWeight != 0.0f)
+            {
+                ret[node] /= totalWeight;
+            } else {
+                ret[node] = 0.0f;
+            }
+        }
+        return ret;
+    }
+    
+    AString compareFrame(const vector<float>& expected, const float* actual, const AString& description)
+    {
+        for (int64_t i = 0; i < (int64_t)expected.size(); ++i)
+        {
+            if (abs(actual[i] - expected[i]) > 1e-5f * max(1.0f, abs(expected[i])))
+            {
+                return description + " vertex " + AString::number(i) + " is " + AString::number(actual[i]) + ", per-frame mapping gave " + AString::number(expected[i]);
+            }
+        }
+        return "";
+    }
+    
+    AString checkMapFrames(const RibbonMappingWeights& compactWeights, const vector<vector<VoxelWeight> >& weights, const VolumeFile& volume, const AString& description)
+    {
+        int64_t numFrames = volume.getNumberOfMaps(), numNodes = (int64_t)weights.size();
+        vector<vector<float> > outFrames(numFrames, vector<float>(numNodes));
+        vector<const float*> framesIn(numFrames);
+        vector<float*> framesOut(numFrames);
+        for (int64_t f = 0; f < numFrames; ++f)
+        {
+            framesIn[f] = volume.getFrame(f);
+            framesOut[f] = outFrames[f].data();
+        }
+        compactWeights.mapFrames(framesIn, framesOut);
+        for (int64_t f = 0; f < numFrames; ++f)
+        {
+            AString error = compareFrame(mapFrameReference(weights, volume, f), outFrames[f].data(), description + " frame " + AString::number(f));
+            if (error != "") return error;
+        }
+        return "";
+    }
+}
+
+void RibbonMappingTest::execute()
+{
+    srand(26);
+    SurfaceFile innerSurf, outerSurf, midSurf;
+    makeSheet(1.3f, innerSurf);
+    makeSheet(4.6f, outerSurf);
+    makeSheet(2.9f, midSurf);
+    vector<int64_t> dims(4);
+    dims[0] = 16;
+    dims[1] = 16;
+    dims[2] = 5;
+    dims[3] = 70;//more than one pass of 64 frames in the algorithm, and several blocks in mapFrames
+    FloatMatrix sform = FloatMatrix::identity(4);
+    for (int i = 0; i < 3; ++i)
+    {
+        sform[i][i] = 2.0f;
+        sform[i][3] = -3.0f;
+    }
+    VolumeFile volume;
+    volume.reinitialize(dims, sform.getMatrix());
+    int64_t frameSize = dims[0] * dims[1] * dims[2];
+    vector<float> frame(frameSize);
+    for (int64_t f = 0; f < dims[3]; ++f)
+    {
+        for (int64_t i = 0; i < frameSize; ++i)
+        {
+            frame[i] = (float)rand() / RAND_MAX * 100.0f;
+        }
+        volume.setFrame(frame.data(), f);
+    }
+    vector<vector<VoxelWeight> > weights;
+    RibbonMappingHelper::computeWeightsRibbon(weights, volume.getVolumeSpace(), &innerSurf, &outerSurf);
+    int64_t numNodes = (int64_t)weights.size();
+    
+    MetricFile mapped, mappedSubvol;
+    AlgorithmVolumeToSurfaceMapping(NULL, &volume, &midSurf, &mapped, &innerSurf, &outerSurf);
+    AlgorithmVolumeToSurfaceMapping(NULL, &volume, &midSurf, &mappedSubvol, &innerSurf, &outerSurf, NULL, 3, false, 5);
+    for (int64_t f = 0; f < dims[3]; ++f)
+    {
+        vector<float> expected = mapFrameReference(weights, volume, f);
+        AString error = compareFrame(expected, mapped.getValuePointerForColumn(f), "ribbon mapping column " + AString::number(f + 1));
+        if (error == "" && f == 5)
+        {
+            error = compareFrame(expected, mappedSubvol.getValuePointerForColumn(0), "ribbon mapping of one subvolume");
+        }
+        if (error != "")
+        {
+            setFailed(error);
+            return;
+        }
+    }
+    
+    RibbonMappingWeights compactWeights, convertedWeights;
+    RibbonMappingHelper::computeWeightsRibbon(compactWeights, volume.getVolumeSpace(), &innerSurf, &outerSurf);
+    convertedWeights.setFromVoxelWeights(weights, volume.getVolumeSpace());
+    AString error = checkMapFrames(compactWeights, weights, volume, "compact weights");
+    if (error == "") error = checkMapFrames(convertedWeights, weights, volume, "converted weights");
+    if (error != "")
+    {
+        setFailed(error);
+        return;
+    }
+    for (int64_t node = 0; node < numNodes; ++node)
+    {//change the weights like -gaussian does, the mapping info must be recomputed
+        for (int64_t j = 0; j < (int64_t)weights[node].size(); ++j)
+        {
+            float factor = 0.5f + 0.5f * sin(0.37f * (node + j));
+            weights[node][j].weight *= factor;
+            compactWeights.m_weights[compactWeights.m_rowStart[node] + j] *= factor;
+        }
+    }
+    compactWeights.computeMappingInfo();
+    error = checkMapFrames(compactWeights, weights, volume, "modified weights");
+    if (error != "")
+    {
+        setFailed(error);
+        return;
+    }
+    AString fileName = QDir::tempPath() + "/RibbonMappingTest.weights";
+    RibbonMappingWeights readWeights;
+    compactWeights.writeFile(fileName);
+    readWeights.readFile(fileName);
+    QFile::remove(fileName);
+    error = checkMapFrames(readWeights, weights, volume, "weights read from file");
+    if (error != "") setFailed(error);
+}
@@ -18,8 +18,10 @@
  */
 /*LICENSE_END*/
 #include "StatisticsTest.h"
+#include <algorithm>
 #include <cstdlib>
 #include <cmath>
+#include <limits>
 
 #include "FastStatistics.h"
 #include "DescriptiveStatistics.h"
@@ -27,6 +29,113 @@
 using namespace caret;
 using namespace std;
 
+namespace
+{
+    //serial reference for the thresholded statistics, returns an empty string if FastStatistics matches it
+    AString checkThresholded(const vector<float>& data, const float& minThresh, const float& maxThresh)
+    {
+        FastStatistics myFastStats;
+        myFastStats.update(data.data(), (int64_t)data.size(), minThresh, maxThresh);
+        int64_t posCount = 0, zeroCount = 0, negCount = 0, infCount = 0, negInfCount = 0, nanCount = 0;
+        float mostNeg = 0.0f, leastNeg = 0.0f, leastPos = 0.0f, mostPos = 0.0f;
+        vector<float> inRange, positives;
+        double sum = 0.0;
+        for (int64_t i = 0; i < (int64_t)data.size(); ++i)
+        {
+            float value = data[i];
+            if (value != value)
+            {
+                ++nanCount;
+                continue;
+            }
+            if (value == numeric_limits<float>::infinity())
+            {
+                ++infCount;
+                continue;
+            }
+            if (value == -numeric_limits<float>::infinity())
+            {
+                ++negInfCount;
+                continue;
+            }
+            if (value < minThresh || value > maxThresh) continue;
+            if (value == 0.0f)
+            {
+                ++zeroCount;
+            } else if (value < 0.0f) {
+                if (negCount == 0 || value < mostNeg) mostNeg = value;
+                if (negCount == 0 || value > leastNeg) leastNeg = value;
+                ++negCount;
+            } else {
+                if (posCount == 0 || value > mostPos) mostPos = value;
+                if (posCount == 0 || value < leastPos) leastPos = value;
+                ++posCount;
+                positives.push_back(value);
+            }
+            inRange.push_back(value);
+            sum += value;
+        }
+        AString rangeText = " with threshold [" + AString::number(minThresh) + ", " + AString::number(maxThresh) + "]";
+        int64_t fastPos, fastZero, fastNeg, fastInf, fastNegInf, fastNan;
+        myFastStats.getCounts(fastPos, fastZero, fastNeg, fastInf, fastNegInf, fastNan);
+        if (fastPos != posCount || fastZero != zeroCount || fastNeg != negCount || fastInf != infCount || fastNegInf != negInfCount || fastNan != nanCount)
+        {
+            return "mismatch in counts" + rangeText + ", serial: " + AString::number(posCount) + " positive, " + AString::number(zeroCount) + " zero, " +
+                   AString::number(negCount) + " negative, " + AString::number(infCount) + " inf, " + AString::number(negInfCount) + " -inf, " + AString::number(nanCount) + " NaN";
+        }
+        if (inRange.empty()) return "";
+        float fastMostNeg, fastLeastNeg, fastLeastPos, fastMostPos;
+        myFastStats.getNonzeroRanges(fastMostNeg, fastLeastNeg, fastLeastPos, fastMostPos);
+        if (fastMostNeg != mostNeg || fastLeastNeg != leastNeg || fastLeastPos != leastPos || fastMostPos != mostPos)
+        {
+            return "mismatch in nonzero ranges" + rangeText + ", serial: " + AString::number(mostNeg) + ", " + AString::number(leastNeg) + ", " +
+                   AString::number(leastPos) + ", " + AString::number(mostPos) + ", fast: " + AString::number(fastMostNeg) + ", " + AString::number(fastLeastNeg) + ", " +
+                   AString::number(fastLeastPos) + ", " + AString::number(fastMostPos);
+        }
+        float refMin = *min_element(inRange.begin(), inRange.end()), refMax = *max_element(inRange.begin(), inRange.end());
+        if (myFastStats.getMin() != refMin || myFastStats.getMax() != refMax)
+        {
+            return "mismatch in min or max" + rangeText + ", serial: " + AString::number(refMin) + ", " + AString::number(refMax) +
+                   ", fast: " + AString::number(myFastStats.getMin()) + ", " + AString::number(myFastStats.getMax());
+        }
+        double mean = sum / inRange.size(), sum2 = 0.0;
+        for (size_t i = 0; i < inRange.size(); ++i)
+        {
+            double diff = inRange[i] - mean;
+            sum2 += diff * diff;
+        }
+        float popStdDev = sqrt(sum2 / inRange.size());
+        float tolerance = max(popStdDev, 1.0f) * 0.000001f;
+        if (abs(myFastStats.getMean() - mean) > tolerance)
+        {
+            return "mismatch in mean" + rangeText + ", serial: " + AString::number(mean) + ", fast: " + AString::number(myFastStats.getMean());
+        }
+        if (abs(myFastStats.getPopulationStdDev() - popStdDev) > tolerance)
+        {
+            return "mismatch in population stddev" + rangeText + ", serial: " + AString::number(popStdDev) + ", fast: " + AString::number(myFastStats.getPopulationStdDev());
+        }
+        if (inRange.size() > 1)
+        {
+            float sampleStdDev = sqrt(sum2 / (inRange.size() - 1));
+            if (abs(myFastStats.getSampleStdDev() - sampleStdDev) > tolerance)
+            {
+                return "mismatch in sample stddev" + rangeText + ", serial: " + AString::number(sampleStdDev) + ", fast: " + AString::number(myFastStats.getSampleStdDev());
+            }
+        }
+        if (positives.size() > 100)
+        {//percentiles come from a histogram, so only approximately match the sorted values
+            sort(positives.begin(), positives.end());
+            float refPercentile = positives[(size_t)(0.9 * (positives.size() - 1))];
+            float fastPercentile = myFastStats.getApproxPositivePercentile(90.0f);
+            if (abs(fastPercentile - refPercentile) > (mostPos - leastPos) * 0.01f)
+            {
+                return "mismatch in 90% positive percentile" + rangeText + ", serial: " + AString::number(refPercentile) + ", fast: " + AString::number(fastPercentile);
+            }
+        }
+        return "";
+    }
+}
+
 StatisticsTest::StatisticsTest(const AString& identifier) : TestInterface(identifier)
 {
 }
@@ -76,4 +185,39 @@ void StatisticsTest::execute()
     {
         setFailed(AString("mismatch in 90% negative percentile, full: ") + AString::number(myFullStats.getNegativePercentile(90.0f)) + ", fast: " + AString::number(myFastStats.getApproxNegativePercentile(90.0f)));
     }
+    //thresholded statistics, with non-numeric values and exact zeros mixed in, on data that fits in one chunk and data that is split across many
+    const int64_t sizes[2] = { 1000, NUM_ELEMENTS + 12345 };
+    const float thresholds[5][2] = { { -10.0f, 20.0f }, { 5.0f, 30.0f }, { -40.0f, -5.0f }, { 0.0f, 0.0f }, { 60.0f, 70.0f } };
+    for (int s = 0; s < 2; ++s)
+    {
+        vector<float> threshData(sizes[s]);
+        for (int64_t i = 0; i < sizes[s]; ++i)
+        {
+            switch (rand() % 100)
+            {
+                case 0:
+                    threshData[i] = numeric_limits<float>::quiet_NaN();
+                    break;
+                case 1:
+                    threshData[i] = numeric_limits<float>::infinity();
+                    break;
+                case 2:
+                    threshData[i] = -numeric_limits<float>::infinity();
+                    break;
+                case 3:
+                    threshData[i] = 0.0f;
+                    break;
+                default:
+                    threshData[i] = (rand() * 100.0f / RAND_MAX) - 50.0f;
+            }
+        }
+        for (int t = 0; t < 5; ++t)
+        {
+            AString message = checkThresholded(threshData, thresholds[t][0], thresholds[t][1]);
+            if (message != "")
+            {
+                setFailed(message + ", " + AString::number(sizes[s]) + " elements");
+            }
+        }
+    }
 }
@@ -0,0 +1,183 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "SurfaceDecimationTest.h"
+
+#include "SurfaceDecimationHelper.h"
+#include "SurfaceFile.h"
+#include "TestIcosphere.h"
+#include "Vector3D.h"
+
+#include <QThreadPool>
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+SurfaceDecimationTest::SurfaceDecimationTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //subdivided icosahedron with bumps, so the collapse costs differ across the surface
+    void makeBumpySphere(const int& subdivisions, SurfaceFile& sphereOut)
+    {
+        vector<Vector3D> coords;
+        vector<int32_t> triangles;
+        TestIcosphere::generate(subdivisions, coords, triangles);
+        for (int i = 0; i < (int)coords.size(); ++i)
+        {
+            float radius = 50.0f * (1.0f + 0.1f * sin(5.0f * coords[i][0]) * cos(4.0f * coords[i][1]) * sin(3.0f * coords[i][2] + 1.0f));
+            coords[i] *= radius;
+        }
+        TestIcosphere::toSurface(coords, triangles, sphereOut);
+    }
+    
+    //six times the volume enclosed by a closed, consistently wound set of triangles
+    double signedVolume(const SurfaceFile& surface, const int32_t* triangles, const int32_t& numTriangles)
+    {
+        double ret = 0.0;
+        for (int32_t i = 0; i < numTriangles; ++i)
+        {
+            Vector3D v0 = surface.getCoordinate(triangles[i * 3]), v1 = surface.getCoordinate(triangles[i * 3 + 1]), v2 = surface.getCoordinate(triangles[i * 3 + 2]);
+            ret += v0.dot(v1.cross(v2));
+        }
+        return ret;
+    }
+    
+    //triangles must use existing, distinct nodes, and form a closed surface of sphere topology with consistent winding
+    AString checkLevel(const SurfaceFile& surface, const int32_t* triangles, const int32_t& numTriangles, vector<char>& usedNodesOut)
+    {
+        const int32_t numNodes = surface.getNumberOfNodes();
+        usedNodesOut.assign(numNodes, 0);
+        map<pair<int32_t, int32_t>, int> directedEdges;
+        for (int32_t i = 0; i < numTriangles; ++i)
+        {
+            const int32_t* tri = triangles + i * 3;
+            for (int j = 0; j < 3; ++j)
+            {
+                if (tri[j] < 0 || tri[j] >= numNodes) return "triangle " + AString::number(i) + " uses invalid node " + AString::number(tri[j]);
+                usedNodesOut[tri[j]] = 1;
+            }
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) return "triangle " + AString::number(i) + " is degenerate";
+            for (int j = 0; j < 3; ++j)
+            {
+                if (++directedEdges[make_pair(tri[j], tri[(j + 1) % 3])] > 1) return "triangle " + AString::number(i) + " repeats an edge in the same direction";
+            }
+        }
+        for (map<pair<int32_t, int32_t>, int>::iterator iter = directedEdges.begin(); iter != directedEdges.end(); ++iter)
+        {
+            if (directedEdges.find(make_pair(iter->first.second, iter->first.first)) == directedEdges.end())
+            {
+                return "edge " + AString::number(iter->first.first) + ", " + AString::number(iter->first.second) + " is not shared by two triangles of opposite winding";
+            }
+        }
+        int64_t numUsed = 0;
+        for (int32_t i = 0; i < numNodes; ++i) numUsed += usedNodesOut[i];
+        int64_t euler = numUsed - (int64_t)directedEdges.size() / 2 + numTriangles;
+        if (euler != 2) return "euler characteristic is " + AString::number(euler) + ", should be 2";
+        return "";
+    }
+    
+    AString checkHelper(const SurfaceFile& surface, const SurfaceDecimationHelper& helper)
+    {
+        const int32_t numTriangles = surface.getNumberOfTriangles();
+        if (helper.getNumberOfLevels() < 2) return "only " + AString::number(helper.getNumberOfLevels()) + " levels for " + AString::number(numTriangles) + " triangles";
+        const double fullVolume = signedVolume(surface, surface.getTriangle(0), numTriangles);
+        vector<char> previousUsed(surface.getNumberOfNodes(), 1), used;
+        int32_t target = numTriangles;
+        for (int32_t level = 0; level < helper.getNumberOfLevels(); ++level)
+        {
+            AString levelString = "level " + AString::number(level) + " ";
+            target /= SurfaceDecimationHelper::LEVEL_REDUCTION;
+            const int32_t levelTriangles = helper.getLevelNumberOfTriangles(level);
+            if (levelTriangles > target || levelTriangles < SurfaceDecimationHelper::MIN_LEVEL_TRIANGLES / 2)
+            {
+                return levelString + "has " + AString::number(levelTriangles) + " triangles, target was " + AString::number(target);
+            }
+            AString error = checkLevel(surface, helper.getLevelTriangles(level), levelTriangles, used);
+            if (error != "") return levelString + error;
+            for (size_t i = 0; i < used.size(); ++i)
+            {//collapses only remove nodes, so each level uses a subset of the nodes of the one before
+                if (used[i] && !previousUsed[i]) return levelString + "uses node " + AString::number(i) + ", which was removed by a previous level";
+            }
+            previousUsed.swap(used);
+            double volume = signedVolume(surface, helper.getLevelTriangles(level), levelTriangles);
+            if (abs(volume - fullVolume) > 0.03 * fullVolume) return levelString + "volume differs from the full surface by " + AString::number(100.0 * (volume - fullVolume) / fullVolume) + "%";
+        }
+        return "";
+    }
+    
+    bool sameLevels(const SurfaceDecimationHelper& left, const SurfaceDecimationHelper& right)
+    {
+        if (left.getNumberOfLevels() != right.getNumberOfLevels()) return false;
+        for (int32_t level = 0; level < left.getNumberOfLevels(); ++level)
+        {
+            const int32_t numTriangles = left.getLevelNumberOfTriangles(level);
+            if (right.getLevelNumberOfTriangles(level) != numTriangles) return false;
+            if (!equal(left.getLevelTriangles(level), left.getLevelTriangles(level) + numTriangles * 3, right.getLevelTriangles(level))) return false;
+        }
+        return true;
+    }
+}
+
+void SurfaceDecimationTest::execute()
+{
+    SurfaceFile smallSphere;
+    makeBumpySphere(2, smallSphere);
+    if (SurfaceDecimationHelper(&smallSphere).getNumberOfLevels() != 0)
+    {
+        setFailed("levels were made for a surface with only " + AString::number(smallSphere.getNumberOfTriangles()) + " triangles");
+        return;
+    }
+    SurfaceFile sphere;
+    makeBumpySphere(6, sphere);
+    SurfaceDecimationHelper helper(&sphere);
+    AString error = checkHelper(sphere, helper);
+    if (error != "")
+    {
+        setFailed(error);
+        return;
+    }
+    
+    //the surface only gives the levels once they are built on the other thread, and then they are the same
+    sphere.getDecimationHelper();
+    QThreadPool::globalInstance()->waitForDone();
+    CaretPointer<const SurfaceDecimationHelper> builtHelper = sphere.getDecimationHelper();
+    if (builtHelper == NULL)
+    {
+        setFailed("surface did not give decimated levels after the build finished");
+        return;
+    }
+    if (!sameLevels(helper, *builtHelper))
+    {
+        setFailed("levels built on another thread differ from the levels built directly");
+        return;
+    }
+    
+    //a build must finish safely after its surface is deleted
+    SurfaceFile* deletedSphere = new SurfaceFile(sphere);
+    deletedSphere->getDecimationHelper();
+    delete deletedSphere;
+    QThreadPool::globalInstance()->waitForDone();
+}
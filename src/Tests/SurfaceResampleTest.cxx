@@ -0,0 +1,301 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "SurfaceResampleTest.h"
+
+#include "AlgorithmCiftiResample.h"
+#include "CiftiFile.h"
+#include "DataFileException.h"
+#include "FloatMatrix.h"
+#include "RibbonMappingHelper.h"
+#include "SurfaceFile.h"
+#include "SurfaceResamplingHelper.h"
+#include "TestIcosphere.h"
+#include "Vector3D.h"
+#include "VolumeSpace.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+SurfaceResampleTest::SurfaceResampleTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //subdivided icosahedron of radius 100, rotated so different spheres don't share vertices
+    void makeSphere(const int& subdivisions, const float& rotation, SurfaceFile& sphereOut)
+    {
+        vector<Vector3D> coords;
+        vector<int32_t> triangles;
+        TestIcosphere::generate(subdivisions, coords, triangles);
+        float cosA = cos(rotation), sinA = sin(rotation), cosB = cos(0.5f * rotation), sinB = sin(0.5f * rotation);
+        for (int i = 0; i < (int)coords.size(); ++i)
+        {
+            float x = cosA * coords[i][0] - sinA * coords[i][1], y = sinA * coords[i][0] + cosA * coords[i][1];
+            float z = sinB * y + cosB * coords[i][2];
+            y = cosB * y - sinB * coords[i][2];
+            coords[i] = Vector3D(100.0f * x, 100.0f * y, 100.0f * z);
+        }
+        TestIcosphere::toSurface(coords, triangles, sphereOut);
+    }
+    
+    vector<vector<float> > makeMaps(const int& numMaps, const int& numNodes)
+    {
+        vector<vector<float> > ret(numMaps, vector<float>(numNodes));
+        for (int m = 0; m < numMaps; ++m)
+        {
+            for (int i = 0; i < numNodes; ++i)
+            {
+                ret[m][i] = (float)rand() / RAND_MAX * 10.0f - 5.0f;
+            }
+        }
+        return ret;
+    }
+    
+    //results must be identical, not just close, since every path accumulates the same products in the same order
+    AString compareResampling(const SurfaceResamplingHelper& expected, const SurfaceResamplingHelper& actual, const vector<vector<float> >& maps, const AString& description)
+    {
+        if (actual.getNumberOfCurrentNodes() != expected.getNumberOfCurrentNodes() || actual.getNumberOfNewNodes() != expected.getNumberOfNewNodes())
+        {
+            return description + " has different dimensions";
+        }
+        int numMaps = (int)maps.size();
+        int64_t numNewNodes = expected.getNumberOfNewNodes();
+        vector<vector<float> > batchOut(numMaps, vector<float>(numNewNodes));
+        vector<const float*> inputs(numMaps);
+        vector<float*> outputs(numMaps);
+        for (int m = 0; m < numMaps; ++m)
+        {
+            inputs[m] = maps[m].data();
+            outputs[m] = batchOut[m].data();
+        }
+        actual.resampleNormal(inputs, outputs, -7.0f);
+        vector<float> singleOut(numNewNodes);
+        for (int m = 0; m < numMaps; ++m)
+        {
+            expected.resampleNormal(maps[m].data(), singleOut.data(), -7.0f);
+            for (int64_t i = 0; i < numNewNodes; ++i)
+            {
+                if (batchOut[m][i] != singleOut[i])
+                {
+                    return description + " map " + AString::number(m) + " vertex " + AString::number(i) + " is " + AString::number(batchOut[m][i]) +
+                           ", single map resampling gave " + AString::number(singleOut[i]);
+                }
+            }
+        }
+        return "";
+    }
+}
+
+void SurfaceResampleTest::execute()
+{
+    srand(30);
+    testHelper();
+    if (failed()) return;
+    testCiftiRows();
+}
+
+void SurfaceResampleTest::testHelper()
+{
+    SurfaceFile curSphere, newSphere;
+    makeSphere(3, 0.0f, curSphere);
+    makeSphere(2, 0.3f, newSphere);
+    int numCurNodes = curSphere.getNumberOfNodes();
+    vector<float> curAreas, newAreas;
+    curSphere.computeNodeAreas(curAreas);
+    newSphere.computeNodeAreas(newAreas);
+    vector<float> curRoi(numCurNodes, 1.0f);
+    for (int i = 0; i < numCurNodes; ++i)
+    {
+        if (curSphere.getCoordinate(i)[2] > 60.0f) curRoi[i] = 0.0f;//a hole, so some new vertices have no weights
+    }
+    vector<vector<float> > maps = makeMaps(21, numCurNodes);//more than one block of the multi-map kernel
+    QString weightsFileName = QDir::tempPath() + "/SurfaceResampleTest.weights";
+    QString ribbonFileName = QDir::tempPath() + "/SurfaceResampleTest.ribbon";
+    SurfaceResamplingMethodEnum::Enum methods[2] = { SurfaceResamplingMethodEnum::BARYCENTRIC, SurfaceResamplingMethodEnum::ADAP_BARY_AREA };
+    for (int i = 0; i < 2 && !failed(); ++i)
+    {
+        for (int useRoi = 0; useRoi < 2 && !failed(); ++useRoi)
+        {
+            AString description = SurfaceResamplingMethodEnum::toName(methods[i]) + (useRoi ? " with roi" : "");
+            SurfaceResamplingHelper myHelper(methods[i], &curSphere, &newSphere, curAreas.data(), newAreas.data(), (useRoi ? curRoi.data() : NULL));
+            AString error = compareResampling(myHelper, myHelper, maps, description);
+            if (error != "")
+            {
+                setFailed(error);
+                break;
+            }
+            SurfaceResamplingHelper readHelper;
+            try
+            {
+                myHelper.writeWeightsFile(weightsFileName);
+                readHelper.readWeightsFile(weightsFileName);
+            } catch (CaretException& e) {
+                setFailed(description + " weights file round trip failed: " + e.whatString());
+                break;
+            }
+            error = compareResampling(myHelper, readHelper, maps, description + " after weights file");
+            if (error != "") setFailed(error);
+        }
+    }
+    if (!failed())
+    {//the weights file formats share a layout, but must not be mistaken for each other
+        vector<vector<VoxelWeight> > voxelWeights(3);
+        int64_t ijk[3] = { 1, 2, 3 };
+        voxelWeights[0].push_back(VoxelWeight(0.5f, ijk));
+        voxelWeights[2].push_back(VoxelWeight(1.0f, ijk));
+        int64_t dims[3] = { 4, 5, 6 };
+        float sform[12] = { 2, 0, 0, -4, 0, 2, 0, -5, 0, 0, 2, -6 };
+        RibbonMappingWeights ribbonWeights, readRibbonWeights;
+        ribbonWeights.setFromVoxelWeights(voxelWeights, VolumeSpace(dims, sform));
+        ribbonWeights.writeFile(ribbonFileName);
+        readRibbonWeights.readFile(ribbonFileName);
+        if (readRibbonWeights.m_rowStart != ribbonWeights.m_rowStart || readRibbonWeights.m_voxelIndex != ribbonWeights.m_voxelIndex ||
+            readRibbonWeights.m_weights != ribbonWeights.m_weights || !readRibbonWeights.m_volSpace.matches(ribbonWeights.m_volSpace))
+        {
+            setFailed("ribbon weights file round trip changed the weights");
+        }
+        bool threw = false;
+        SurfaceResamplingHelper wrongHelper;
+        try
+        {
+            wrongHelper.readWeightsFile(ribbonFileName);
+        } catch (DataFileException&) {
+            threw = true;
+        }
+        if (!threw) setFailed("ribbon weights file was read as resampling weights");
+        threw = false;
+        try
+        {
+            readRibbonWeights.readFile(weightsFileName);
+        } catch (DataFileException&) {
+            threw = true;
+        }
+        if (!threw) setFailed("resampling weights file was read as ribbon weights");
+        threw = false;
+        QFile::resize(ribbonFileName, QFileInfo(ribbonFileName).size() - 4);
+        try
+        {
+            readRibbonWeights.readFile(ribbonFileName);
+        } catch (DataFileException&) {
+            threw = true;
+        }
+        if (!threw) setFailed("truncated ribbon weights file was read");
+        threw = false;
+        ribbonWeights.writeFile(ribbonFileName);
+        QFile corruptFile(ribbonFileName);
+        if (corruptFile.open(QIODevice::ReadWrite) && corruptFile.seek(8 + sizeof(int32_t)))
+        {
+            const char hugeRowCount[8] = { 0, 0, 0, 0, 0, 0, 0, 0x40 };//little endian, so this is 2^62 rows, must not be allocated
+            corruptFile.write(hugeRowCount, 8);
+            corruptFile.close();
+            try
+            {
+                readRibbonWeights.readFile(ribbonFileName);
+            } catch (DataFileException&) {
+                threw = true;
+            }
+            if (!threw) setFailed("ribbon weights file with a corrupt row count was read");
+        } else {
+            setFailed("failed to open ribbon weights file for modification");
+        }
+    }
+    QFile::remove(weightsFileName);
+    QFile::remove(ribbonFileName);
+}
+
+void SurfaceResampleTest::testCiftiRows()
+{
+    SurfaceFile curSphere, newSphere;
+    makeSphere(3, 0.0f, curSphere);
+    makeSphere(2, 0.3f, newSphere);
+    int numCurNodes = curSphere.getNumberOfNodes(), numNewNodes = newSphere.getNumberOfNodes();
+    const int64_t NUM_ROWS = 70;//more than one block of rows
+    vector<int64_t> nodeList;
+    vector<float> curRoi(numCurNodes, 0.0f);
+    for (int i = numCurNodes - 1; i >= 0; --i)
+    {
+        if (i % 7 != 3)
+        {
+            nodeList.push_back(i);
+            curRoi[i] = 1.0f;
+        }
+    }
+    CiftiXML inXML, templateXML;
+    inXML.setNumberOfDimensions(2);
+    inXML.setMap(CiftiXML::ALONG_COLUMN, CiftiScalarsMap(NUM_ROWS));
+    CiftiBrainModelsMap inModels, newModels;
+    inModels.addSurfaceModel(numCurNodes, StructureEnum::CORTEX_LEFT, nodeList);
+    inXML.setMap(CiftiXML::ALONG_ROW, inModels);
+    templateXML.setNumberOfDimensions(2);
+    templateXML.setMap(CiftiXML::ALONG_COLUMN, CiftiScalarsMap(1));
+    newModels.addSurfaceModel(numNewNodes, StructureEnum::CORTEX_LEFT);
+    templateXML.setMap(CiftiXML::ALONG_ROW, newModels);
+    CiftiFile inCifti, templateCifti;
+    inCifti.setCiftiXML(inXML);
+    templateCifti.setCiftiXML(templateXML);
+    vector<vector<float> > maps = makeMaps(NUM_ROWS, numCurNodes);
+    vector<float> inRow(nodeList.size());
+    for (int64_t row = 0; row < NUM_ROWS; ++row)
+    {
+        for (int j = 0; j < (int)nodeList.size(); ++j)
+        {
+            inRow[j] = maps[row][nodeList[j]];
+        }
+        inCifti.setRow(inRow.data(), row);
+    }
+    SurfaceResamplingHelper myHelper(SurfaceResamplingMethodEnum::BARYCENTRIC, &curSphere, &newSphere, NULL, NULL, curRoi.data());
+    vector<float> expected(numNewNodes), outRow(numNewNodes);
+    for (int largest = 0; largest < 2; ++largest)
+    {
+        CiftiFile outCifti;
+        AlgorithmCiftiResample(NULL, &inCifti, CiftiXML::ALONG_ROW, &templateCifti, CiftiXML::ALONG_ROW, SurfaceResamplingMethodEnum::BARYCENTRIC,
+                               VolumeFile::CUBIC, &outCifti, (largest != 0), 0.0f, 0.0f, FloatMatrix::identity(4),
+                               &curSphere, &newSphere, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        vector<CiftiBrainModelsMap::SurfaceMap> outMap = outCifti.getCiftiXML().getBrainModelsMap(CiftiXML::ALONG_ROW).getSurfaceMap(StructureEnum::CORTEX_LEFT);
+        for (int64_t row = 0; row < NUM_ROWS; ++row)
+        {
+            if (largest)
+            {
+                myHelper.resampleLargest(maps[row].data(), expected.data());
+            } else {
+                myHelper.resampleNormal(maps[row].data(), expected.data());
+            }
+            outCifti.getRow(outRow.data(), row);
+            for (int j = 0; j < (int)outMap.size(); ++j)
+            {
+                if (outRow[outMap[j].m_ciftiIndex] != expected[outMap[j].m_surfaceNode])
+                {
+                    setFailed(AString(largest ? "largest weight" : "weighted") + " cifti row resampling differs from resampling the row as a metric, row " +
+                              AString::number(row) + ", vertex " + AString::number(outMap[j].m_surfaceNode));
+                    return;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,436 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TFCETest.h"
+
+#include "AlgorithmMetricTFCE.h"
+#include "AlgorithmVolumeTFCE.h"
+#include "CaretHeap.h"
+#include "CaretPointer.h"
+#include "FloatMatrix.h"
+#include "MetricFile.h"
+#include "SurfaceFile.h"
+#include "TFCEHelper.h"
+#include "TopologyHelper.h"
+#include "VolumeFile.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+TFCETest::TFCETest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+namespace
+{
+    //the implementation before TFCEHelper, with clusters that keep member lists, as the reference the helper must match
+    struct Cluster
+    {
+        double accumVal, totalArea;
+        vector<int64_t> members;
+        float lastVal;
+        bool first;
+        Cluster()
+        {
+            first = true;
+            accumVal = 0.0;
+            totalArea = 0.0;
+        }
+        void addMember(const int64_t& elem, const float& val, const float& area, const float& param_e, const float& param_h)
+        {
+            update(val, param_e, param_h);
+            members.push_back(elem);
+            totalArea += area;
+        }
+        void update(const float& bottomVal, const float& param_e, const float& param_h)
+        {
+            if (first)
+            {
+                lastVal = bottomVal;
+                first = false;
+            } else {
+                if (bottomVal != lastVal)
+                {
+                    double integrated_h = param_h + 1.0f;
+                    double newSlice = pow(totalArea, (double)param_e) * (pow((double)lastVal, integrated_h) - pow((double)bottomVal, integrated_h)) / integrated_h;
+                    accumVal += newSlice;
+                    lastVal = bottomVal;
+                }
+            }
+        }
+    };
+    
+    int64_t allocCluster(vector<Cluster>& clusterList, set<int64_t>& deadClusters)
+    {
+        if (deadClusters.empty())
+        {
+            clusterList.push_back(Cluster());
+            return (int64_t)(clusterList.size() - 1);
+        } else {
+            set<int64_t>::iterator iter = deadClusters.begin();
+            int64_t ret = *iter;
+            deadClusters.erase(iter);
+            clusterList[ret] = Cluster();
+            return ret;
+        }
+    }
+    
+    void referenceTFCEPos(const vector<vector<int64_t> >& neighbors, const float* data, double* accumData, const float* roiData,
+                          const float& param_e, const float& param_h, const vector<float>& areaData)
+    {
+        int64_t numElems = (int64_t)neighbors.size();
+        vector<int64_t> membership(numElems, -1);
+        vector<Cluster> clusterList;
+        set<int64_t> deadClusters;
+        CaretSimpleMaxHeap<int64_t, float> elemHeap;
+        for (int64_t i = 0; i < numElems; ++i)
+        {
+            if ((roiData == NULL || roiData[i] > 0.0f) && data[i] > 0.0f)
+            {
+                elemHeap.push(i, data[i]);
+            }
+        }
+        while (!elemHeap.isEmpty())
+        {
+            float value;
+            int64_t elem = elemHeap.pop(&value);
+            set<int64_t> touchingClusters;
+            for (int i = 0; i < (int)neighbors[elem].size(); ++i)
+            {
+                if (membership[neighbors[elem][i]] != -1)
+                {
+                    touchingClusters.insert(membership[neighbors[elem][i]]);
+                }
+            }
+            switch (touchingClusters.size())
+            {
+                case 0:
+                {
+                    int64_t newCluster = allocCluster(clusterList, deadClusters);
+                    clusterList[newCluster].addMember(elem, value, areaData[elem], param_e, param_h);
+                    membership[elem] = newCluster;
+                    break;
+                }
+                case 1:
+                {
+                    int64_t whichCluster = *(touchingClusters.begin());
+                    clusterList[whichCluster].addMember(elem, value, areaData[elem], param_e, param_h);
+                    membership[elem] = whichCluster;
+                    accumData[elem] -= clusterList[whichCluster].accumVal;
+                    break;
+                }
+                default:
+                {
+                    int64_t mergedIndex = -1, biggestSize = 0;
+                    for (set<int64_t>::iterator iter = touchingClusters.begin(); iter != touchingClusters.end(); ++iter)
+                    {
+                        if ((int64_t)clusterList[*iter].members.size() > biggestSize)
+                        {
+                            mergedIndex = *iter;
+                            biggestSize = (int64_t)clusterList[*iter].members.size();
+                        }
+                    }
+                    Cluster& mergedCluster = clusterList[mergedIndex];
+                    mergedCluster.update(value, param_e, param_h);
+                    for (set<int64_t>::iterator iter = touchingClusters.begin(); iter != touchingClusters.end(); ++iter)
+                    {
+                        if (*iter != mergedIndex)
+                        {
+                            Cluster& thisCluster = clusterList[*iter];
+                            thisCluster.update(value, param_e, param_h);
+                            double correctionVal = thisCluster.accumVal - mergedCluster.accumVal;
+                            for (int64_t j = 0; j < (int64_t)thisCluster.members.size(); ++j)
+                            {
+                                accumData[thisCluster.members[j]] += correctionVal;
+                                membership[thisCluster.members[j]] = mergedIndex;
+                            }
+                            mergedCluster.members.insert(mergedCluster.members.end(), thisCluster.members.begin(), thisCluster.members.end());
+                            mergedCluster.totalArea += thisCluster.totalArea;
+                            deadClusters.insert(*iter);
+                            vector<int64_t>().swap(thisCluster.members);
+                        }
+                    }
+                    mergedCluster.addMember(elem, value, areaData[elem], param_e, param_h);
+                    accumData[elem] -= mergedCluster.accumVal;
+                    membership[elem] = mergedIndex;
+                    break;
+                }
+            }
+        }
+        for (int64_t i = 0; i < (int64_t)clusterList.size(); ++i)
+        {
+            if (deadClusters.find(i) != deadClusters.end()) continue;
+            Cluster& thisCluster = clusterList[i];
+            thisCluster.update(0.0f, param_e, param_h);
+            for (int64_t j = 0; j < (int64_t)thisCluster.members.size(); ++j)
+            {
+                accumData[thisCluster.members[j]] += thisCluster.accumVal;
+            }
+        }
+    }
+    
+    vector<float> referenceTFCE(const vector<vector<int64_t> >& neighbors, const float* data, const float* roiData,
+                                const float& param_e, const float& param_h, const vector<float>& areaData)
+    {
+        int64_t numElems = (int64_t)neighbors.size();
+        vector<double> accum(numElems, 0.0);
+        referenceTFCEPos(neighbors, data, accum.data(), roiData, param_e, param_h, areaData);
+        vector<float> negData(numElems);
+        for (int64_t i = 0; i < numElems; ++i)
+        {
+            negData[i] = -data[i];
+        }
+        referenceTFCEPos(neighbors, negData.data(), accum.data(), roiData, param_e, param_h, areaData);
+        vector<float> ret(numElems, 0.0f);
+        for (int64_t i = 0; i < numElems; ++i)
+        {
+            if (roiData == NULL || roiData[i] > 0.0f)
+            {
+                ret[i] = (data[i] < 0.0f) ? (float)-accum[i] : (float)accum[i];
+            }
+        }
+        return ret;
+    }
+    
+    //positive and negative blobs over small noise, with some values rounded so there are ties, and some exact zeros
+    float blobValue(const float& x, const float& y, const float& z, const int& map)
+    {
+        float ret = 3.0f * exp(-((x - 4.0f - map) * (x - 4.0f - map) + (y - 3.0f) * (y - 3.0f) + (z - 2.0f) * (z - 2.0f)) / 6.0f)
+                    - 2.5f * exp(-((x - 10.0f) * (x - 10.0f) + (y - 7.0f + map) * (y - 7.0f + map) + (z - 4.0f) * (z - 4.0f)) / 4.0f)
+                    + 1.5f * exp(-((x - 12.0f) * (x - 12.0f) + (y - 2.0f) * (y - 2.0f)) / 3.0f)
+                    + 0.2f * ((float)rand() / RAND_MAX - 0.5f);
+        switch (rand() % 10)
+        {
+            case 0:
+                return 0.0f;
+            case 1:
+                return floor(ret * 4.0f + 0.5f) / 4.0f;
+            default:
+                return ret;
+        }
+    }
+    
+    AString compareMaps(const vector<float>& expected, const float* actual, const AString& description)
+    {
+        for (int64_t i = 0; i < (int64_t)expected.size(); ++i)
+        {
+            if (abs(actual[i] - expected[i]) > 1e-5f * max(abs(expected[i]), 1.0f))
+            {
+                return description + " element " + AString::number(i) + " is " + AString::number(actual[i]) +
+                       ", previous implementation gave " + AString::number(expected[i]);
+            }
+        }
+        return "";
+    }
+}
+
+void TFCETest::execute()
+{
+    srand(29);
+    testMetric();
+    if (failed()) return;
+    testVolume();
+}
+
+void TFCETest::testMetric()
+{
+    const int GRID_X = 16, GRID_Y = 12, NUM_COLS = 5;
+    const int numNodes = GRID_X * GRID_Y;
+    SurfaceFile mySurf;//a bumpy, irregular grid, so vertex areas differ
+    mySurf.setNumberOfNodesAndTriangles(numNodes, (GRID_X - 1) * (GRID_Y - 1) * 2);
+    for (int j = 0; j < GRID_Y; ++j)
+    {
+        for (int i = 0; i < GRID_X; ++i)
+        {
+            mySurf.setCoordinate(i + j * GRID_X, i + 0.3f * ((float)rand() / RAND_MAX - 0.5f), j + 0.3f * ((float)rand() / RAND_MAX - 0.5f), 0.5f * sin(0.7f * i) * cos(0.4f * j));
+        }
+    }
+    int triangle = 0;
+    for (int j = 0; j < GRID_Y - 1; ++j)
+    {
+        for (int i = 0; i < GRID_X - 1; ++i)
+        {
+            int node = i + j * GRID_X;
+            mySurf.setTriangle(triangle++, node, node + 1, node + GRID_X);
+            mySurf.setTriangle(triangle++, node + 1, node + GRID_X + 1, node + GRID_X);
+        }
+    }
+    vector<float> areas;
+    mySurf.computeNodeAreas(areas);
+    CaretPointer<TopologyHelper> myTopoHelp = mySurf.getTopologyHelper();
+    vector<vector<int64_t> > neighbors(numNodes);
+    for (int i = 0; i < numNodes; ++i)
+    {
+        const vector<int32_t>& nodeNeighbors = myTopoHelp->getNodeNeighbors(i);
+        neighbors[i].assign(nodeNeighbors.begin(), nodeNeighbors.end());
+    }
+    MetricFile myMetric, myRoi;
+    myMetric.setNumberOfNodesAndColumns(numNodes, NUM_COLS);
+    myRoi.setNumberOfNodesAndColumns(numNodes, 1);
+    vector<float> roiData(numNodes);
+    for (int j = 0; j < GRID_Y; ++j)
+    {
+        for (int i = 0; i < GRID_X; ++i)
+        {
+            roiData[i + j * GRID_X] = (i == 7 || (i == 11 && j > 3)) ? 0.0f : 1.0f;//cuts that split clusters
+        }
+    }
+    myRoi.setValuesForColumn(0, roiData.data());
+    for (int col = 0; col < NUM_COLS; ++col)
+    {
+        vector<float> colData(numNodes);
+        for (int i = 0; i < numNodes; ++i)
+        {
+            const float* coord = mySurf.getCoordinate(i);
+            colData[i] = blobValue(coord[0], coord[1], 0.0f, col);
+        }
+        myMetric.setValuesForColumn(col, colData.data());
+    }
+    const float params[2][2] = { { 1.0f, 2.0f }, { 0.5f, 1.5f } };
+    for (int p = 0; p < 2; ++p)
+    {
+        for (int useRoi = 0; useRoi < 2; ++useRoi)
+        {
+            const MetricFile* roiMetric = (useRoi ? &myRoi : NULL);
+            AString description = "metric E=" + AString::number(params[p][0]) + " H=" + AString::number(params[p][1]) + (useRoi ? " with roi" : "");
+            MetricFile myMetricOut;
+            AlgorithmMetricTFCE(NULL, &mySurf, &myMetric, &myMetricOut, 0.0f, roiMetric, params[p][0], params[p][1]);
+            if (myMetricOut.getNumberOfColumns() != NUM_COLS)
+            {
+                setFailed(description + " output has the wrong number of columns");
+                return;
+            }
+            TFCEHelper myTFCE(myTopoHelp, areas.data(), (useRoi ? roiData.data() : NULL), params[p][0], params[p][1]);
+            for (int col = 0; col < NUM_COLS; ++col)
+            {
+                vector<float> expected = referenceTFCE(neighbors, myMetric.getValuePointerForColumn(col), (useRoi ? roiData.data() : NULL),
+                                                       params[p][0], params[p][1], areas);
+                AString error = compareMaps(expected, myMetricOut.getValuePointerForColumn(col), description + " column " + AString::number(col + 1));
+                if (error != "")
+                {
+                    setFailed(error);
+                    return;
+                }
+                vector<float> single(numNodes);
+                myTFCE.compute(myMetric.getValuePointerForColumn(col), single.data());
+                error = compareMaps(expected, single.data(), description + " single map column " + AString::number(col + 1));
+                if (error != "")
+                {
+                    setFailed(error);
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void TFCETest::testVolume()
+{
+    vector<int64_t> dims(4);
+    dims[0] = 9;
+    dims[1] = 8;
+    dims[2] = 7;
+    dims[3] = 4;
+    const int64_t frameSize = dims[0] * dims[1] * dims[2];
+    FloatMatrix sform = FloatMatrix::identity(4);
+    sform[0][0] = 2.0f;
+    sform[1][1] = 1.5f;
+    sform[2][2] = 1.0f;
+    const float voxelVolume = 3.0f;
+    vector<vector<int64_t> > neighbors(frameSize);
+    VolumeFile myVol, myRoi;
+    myVol.reinitialize(dims, sform.getMatrix());
+    vector<int64_t> roiDims = dims;
+    roiDims.resize(3);
+    myRoi.reinitialize(roiDims, sform.getMatrix());
+    vector<float> roiFrame(frameSize);
+    for (int64_t k = 0; k < dims[2]; ++k)
+    {
+        for (int64_t j = 0; j < dims[1]; ++j)
+        {
+            for (int64_t i = 0; i < dims[0]; ++i)
+            {
+                int64_t index = i + dims[0] * (j + dims[1] * k);
+                roiFrame[index] = (j == 4 || (i == 6 && k < 4)) ? 0.0f : 1.0f;
+                const int64_t offsets[6][3] = { { 0, 0, -1 }, { 0, -1, 0 }, { -1, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+                for (int n = 0; n < 6; ++n)
+                {
+                    int64_t ni = i + offsets[n][0], nj = j + offsets[n][1], nk = k + offsets[n][2];
+                    if (ni >= 0 && ni < dims[0] && nj >= 0 && nj < dims[1] && nk >= 0 && nk < dims[2])
+                    {
+                        neighbors[index].push_back(ni + dims[0] * (nj + dims[1] * nk));
+                    }
+                }
+            }
+        }
+    }
+    myRoi.setFrame(roiFrame.data());
+    for (int64_t b = 0; b < dims[3]; ++b)
+    {
+        vector<float> frame(frameSize);
+        for (int64_t k = 0; k < dims[2]; ++k)
+        {
+            for (int64_t j = 0; j < dims[1]; ++j)
+            {
+                for (int64_t i = 0; i < dims[0]; ++i)
+                {
+                    frame[i + dims[0] * (j + dims[1] * k)] = blobValue(1.3f * i, j, k, b);
+                }
+            }
+        }
+        myVol.setFrame(frame.data(), b);
+    }
+    vector<float> weights(frameSize, voxelVolume);
+    const float params[2][2] = { { 0.5f, 2.0f }, { 1.0f, 1.0f } };
+    for (int p = 0; p < 2; ++p)
+    {
+        for (int useRoi = 0; useRoi < 2; ++useRoi)
+        {
+            const VolumeFile* roiVol = (useRoi ? &myRoi : NULL);
+            AString description = "volume E=" + AString::number(params[p][0]) + " H=" + AString::number(params[p][1]) + (useRoi ? " with roi" : "");
+            VolumeFile myVolOut, mySubvolOut;
+            AlgorithmVolumeTFCE(NULL, &myVol, &myVolOut, 0.0f, roiVol, params[p][0], params[p][1]);
+            AlgorithmVolumeTFCE(NULL, &myVol, &mySubvolOut, 0.0f, roiVol, params[p][0], params[p][1], 2);
+            for (int64_t b = 0; b < dims[3]; ++b)
+            {
+                vector<float> expected = referenceTFCE(neighbors, myVol.getFrame(b), (useRoi ? roiFrame.data() : NULL), params[p][0], params[p][1], weights);
+                AString error = compareMaps(expected, myVolOut.getFrame(b), description + " frame " + AString::number(b + 1));
+                if (error != "")
+                {
+                    setFailed(error);
+                    return;
+                }
+                if (b == 2)
+                {
+                    error = compareMaps(expected, mySubvolOut.getFrame(), description + " single subvolume");
+                    if (error != "")
+                    {
+                        setFailed(error);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
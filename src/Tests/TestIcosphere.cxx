@@ -0,0 +1,96 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "TestIcosphere.h"
+
+#include "SurfaceFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+using namespace caret;
+using namespace std;
+
+void TestIcosphere::generate(const int& subdivisions, vector<Vector3D>& unitCoordsOut, vector<int32_t>& trianglesOut)
+{
+    const float t = (1.0f + sqrt(5.0f)) / 2.0f;
+    const float baseCoords[12][3] = { { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 }, { 0, -1, t }, { 0, 1, t },
+                                      { 0, -1, -t }, { 0, 1, -t }, { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 } };
+    const int32_t baseTriangles[20][3] = { { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 }, { 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+                                           { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 }, { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 } };
+    vector<Vector3D> coords;
+    vector<int32_t> triangles;
+    for (int i = 0; i < 12; ++i)
+    {
+        coords.push_back(Vector3D(baseCoords[i]).normal());
+    }
+    for (int i = 0; i < 20; ++i)
+    {
+        triangles.insert(triangles.end(), baseTriangles[i], baseTriangles[i] + 3);
+    }
+    for (int s = 0; s < subdivisions; ++s)
+    {
+        map<pair<int32_t, int32_t>, int32_t> midpoints;
+        vector<int32_t> newTriangles;
+        int32_t numTriangles = (int32_t)triangles.size() / 3;
+        for (int32_t tri = 0; tri < numTriangles; ++tri)
+        {
+            int32_t middle[3];
+            for (int e = 0; e < 3; ++e)
+            {
+                int32_t node1 = triangles[tri * 3 + e], node2 = triangles[tri * 3 + (e + 1) % 3];
+                pair<int32_t, int32_t> edge(min(node1, node2), max(node1, node2));
+                map<pair<int32_t, int32_t>, int32_t>::iterator iter = midpoints.find(edge);
+                if (iter == midpoints.end())
+                {
+                    middle[e] = (int32_t)coords.size();
+                    coords.push_back((coords[node1] + coords[node2]).normal());
+                    midpoints[edge] = middle[e];
+                } else {
+                    middle[e] = iter->second;
+                }
+            }
+            const int32_t* corner = triangles.data() + tri * 3;
+            const int32_t subTriangles[4][3] = { { corner[0], middle[0], middle[2] }, { corner[1], middle[1], middle[0] },
+                                                 { corner[2], middle[2], middle[1] }, { middle[0], middle[1], middle[2] } };
+            for (int i = 0; i < 4; ++i)
+            {
+                newTriangles.insert(newTriangles.end(), subTriangles[i], subTriangles[i] + 3);
+            }
+        }
+        triangles.swap(newTriangles);
+    }
+    unitCoordsOut.swap(coords);
+    trianglesOut.swap(triangles);
+}
+
+void TestIcosphere::toSurface(const vector<Vector3D>& coords, const vector<int32_t>& triangles, SurfaceFile& surfaceOut)
+{
+    int32_t numNodes = (int32_t)coords.size(), numTriangles = (int32_t)triangles.size() / 3;
+    surfaceOut.setNumberOfNodesAndTriangles(numNodes, numTriangles);
+    for (int32_t i = 0; i < numNodes; ++i)
+    {
+        surfaceOut.setCoordinate(i, coords[i][0], coords[i][1], coords[i][2]);
+    }
+    for (int32_t i = 0; i < numTriangles; ++i)
+    {
+        surfaceOut.setTriangle(i, triangles[i * 3], triangles[i * 3 + 1], triangles[i * 3 + 2]);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef __TEST_ICOSPHERE_H__
+#define __TEST_ICOSPHERE_H__
+
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+
+#include "Vector3D.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace caret
+{
+
+    class SurfaceFile;
+    
+    ///closed spheres with consistently oriented triangles, for tests that need a surface
+    class TestIcosphere
+    {
+    public:
+        ///unit vectors and triangles of an icosahedron with each triangle split into 4 the given number of times
+        static void generate(const int& subdivisions, std::vector<Vector3D>& unitCoordsOut, std::vector<int32_t>& trianglesOut);
+        
+        static void toSurface(const std::vector<Vector3D>& coords, const std::vector<int32_t>& triangles, SurfaceFile& surfaceOut);
+    };
+
+}
+#endif // __TEST_ICOSPHERE_H__
@@ -0,0 +1,207 @@
+/*LICENSE_START*/
+/*
+ *  Copyright (C) 2014  Washington University School of Medicine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+/*LICENSE_END*/
+#include "VolumeSplineTest.h"
+
+#include "AlgorithmVolumeAffineResample.h"
+#include "ElapsedTimer.h"
+#include "FloatMatrix.h"
+#include "VolumeFile.h"
+#include "VolumeSpline.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace caret;
+using namespace std;
+
+namespace
+{
+    float smoothValue(const int64_t& i, const int64_t& j, const int64_t& k)
+    {
+        return sin(0.3f * i) + cos(0.2f * j) + 0.1f * k;
+    }
+}
+
+VolumeSplineTest::VolumeSplineTest(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void VolumeSplineTest::execute()
+{
+    const int64_t dims[3] = { 23, 19, 17 };
+    vector<float> frame(dims[0] * dims[1] * dims[2]);
+    for (int64_t k = 0; k < dims[2]; ++k)
+    {
+        for (int64_t j = 0; j < dims[1]; ++j)
+        {
+            for (int64_t i = 0; i < dims[0]; ++i)
+            {
+                frame[i + dims[0] * (j + dims[1] * k)] = smoothValue(i, j, k) + ((float)rand()) / RAND_MAX;
+            }
+        }
+    }
+    VolumeSpline mySpline(frame.data(), dims);
+    //the deconvolution makes the spline interpolating, so it must reproduce the input at voxel centers
+    for (int64_t k = 0; k < dims[2]; ++k)
+    {
+        for (int64_t j = 0; j < dims[1]; ++j)
+        {
+            for (int64_t i = 0; i < dims[0]; ++i)
+            {
+                float expected = frame[i + dims[0] * (j + dims[1] * k)];
+                float result = mySpline.sample(i, j, k);
+                if (!(abs(result - expected) < 0.0001f + 0.0001f * abs(expected)))
+                {
+                    setFailed("spline at voxel (" + AString::number(i) + ", " + AString::number(j) + ", " + AString::number(k) + ") gave " +
+                              AString::number(result) + ", expected " + AString::number(expected));
+                    return;
+                }
+            }
+        }
+    }
+    //batched sampling must match scalar sampling, including edges and points outside the volume
+    const int64_t NUM_POINTS = 5000;
+    vector<float> points(NUM_POINTS * 3), batched(NUM_POINTS);
+    for (int64_t p = 0; p < NUM_POINTS; ++p)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            points[p * 3 + axis] = ((float)rand()) / RAND_MAX * (dims[axis] + 2) - 1.0f;
+        }
+    }
+    mySpline.sample(points.data(), batched.data(), NUM_POINTS);
+    for (int64_t p = 0; p < NUM_POINTS; ++p)
+    {
+        float scalar = mySpline.sample(points.data() + p * 3);
+        if (!(abs(batched[p] - scalar) < 0.00001f + 0.00001f * abs(scalar)))
+        {
+            setFailed("batched spline sample at (" + AString::number(points[p * 3]) + ", " + AString::number(points[p * 3 + 1]) + ", " + AString::number(points[p * 3 + 2]) +
+                      ") gave " + AString::number(batched[p]) + ", scalar sample gave " + AString::number(scalar));
+            return;
+        }
+    }
+    //the tiled affine resampler must give the same values as sampling the input voxel by voxel
+    vector<int64_t> volDims(4);
+    volDims[0] = 31;
+    volDims[1] = 27;
+    volDims[2] = 19;
+    volDims[3] = 2;
+    FloatMatrix sform = FloatMatrix::identity(4);
+    sform[0][0] = -0.7f; sform[0][3] = 10.0f;
+    sform[1][1] = 0.7f; sform[1][3] = -9.0f;
+    sform[2][2] = 0.7f; sform[2][3] = -6.0f;
+    VolumeFile inVol, outVol;
+    inVol.reinitialize(volDims, sform.getMatrix());
+    for (int64_t b = 0; b < volDims[3]; ++b)
+    {
+        vector<float> volFrame(volDims[0] * volDims[1] * volDims[2]);
+        for (int64_t k = 0; k < volDims[2]; ++k)
+        {
+            for (int64_t j = 0; j < volDims[1]; ++j)
+            {
+                for (int64_t i = 0; i < volDims[0]; ++i)
+                {
+                    volFrame[i + volDims[0] * (j + volDims[1] * k)] = smoothValue(i + b, j, k);
+                }
+            }
+        }
+        inVol.setFrame(volFrame.data(), b);
+    }
+    FloatMatrix affine = FloatMatrix::identity(4);//small rotation about z and a shift, so the resampling isn't trivially aligned
+    const float angle = 5.0f * 3.14159265f / 180.0f;
+    affine[0][0] = cos(angle); affine[0][1] = -sin(angle); affine[0][3] = 0.3f;
+    affine[1][0] = sin(angle); affine[1][1] = cos(angle); affine[1][3] = -0.2f;
+    AlgorithmVolumeAffineResample(NULL, &inVol, affine, volDims.data(), sform.getMatrix(), VolumeFile::CUBIC, &outVol);
+    FloatMatrix targetToSource = affine.inverse();
+    for (int64_t b = 0; b < volDims[3]; ++b)
+    {
+        for (int64_t k = 0; k < volDims[2]; ++k)
+        {
+            for (int64_t j = 0; j < volDims[1]; ++j)
+            {
+                for (int64_t i = 0; i < volDims[0]; ++i)
+                {
+                    float outCoord[3], inCoord[3];
+                    outVol.indexToSpace(i, j, k, outCoord);
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        inCoord[axis] = targetToSource[axis][0] * outCoord[0] + targetToSource[axis][1] * outCoord[1] +
+                                        targetToSource[axis][2] * outCoord[2] + targetToSource[axis][3];
+                    }
+                    float expected = inVol.interpolateValue(inCoord, VolumeFile::CUBIC, NULL, b);
+                    float result = outVol.getValue(i, j, k, b);
+                    if (!(abs(result - expected) < 0.0001f + 0.0001f * abs(expected)))
+                    {
+                        setFailed("affine resampling at voxel (" + AString::number(i) + ", " + AString::number(j) + ", " + AString::number(k) + "), frame " +
+                                  AString::number(b) + " gave " + AString::number(result) + ", expected " + AString::number(expected));
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+VolumeSplineBenchmark::VolumeSplineBenchmark(const AString& identifier) : TestInterface(identifier)
+{
+}
+
+void VolumeSplineBenchmark::execute()
+{
+    vector<int64_t> dims(4);
+    dims[0] = 260;//0.7mm MNI grid, as used for HCP structurals
+    dims[1] = 311;
+    dims[2] = 260;
+    dims[3] = 4;
+    FloatMatrix sform = FloatMatrix::identity(4);
+    sform[0][0] = -0.7f; sform[0][3] = 90.0f;
+    sform[1][1] = 0.7f; sform[1][3] = -126.0f;
+    sform[2][2] = 0.7f; sform[2][3] = -72.0f;
+    VolumeFile inVol, outVol;
+    inVol.reinitialize(dims, sform.getMatrix());
+    for (int64_t b = 0; b < dims[3]; ++b)
+    {
+        vector<float> frame(dims[0] * dims[1] * dims[2]);
+        for (int64_t k = 0; k < dims[2]; ++k)
+        {
+            for (int64_t j = 0; j < dims[1]; ++j)
+            {
+                for (int64_t i = 0; i < dims[0]; ++i)
+                {
+                    frame[i + dims[0] * (j + dims[1] * k)] = smoothValue(i + b, j, k);
+                }
+            }
+        }
+        inVol.setFrame(frame.data(), b);
+    }
+    FloatMatrix affine = FloatMatrix::identity(4);//small rotation about z, so the resampling isn't trivially aligned
+    const float angle = 5.0f * 3.14159265f / 180.0f;
+    affine[0][0] = cos(angle); affine[0][1] = -sin(angle);
+    affine[1][0] = sin(angle); affine[1][1] = cos(angle);
+    ElapsedTimer myTimer;
+    myTimer.start();
+    AlgorithmVolumeAffineResample(NULL, &inVol, affine, dims.data(), sform.getMatrix(), VolumeFile::CUBIC, &outVol);
+    double elapsed = myTimer.getElapsedTimeSeconds();
+    int64_t numVoxels = dims[0] * dims[1] * dims[2] * dims[3];
+    cout << "cubic resampling of " << dims[0] << "x" << dims[1] << "x" << dims[2] << "x" << dims[3] << " volume took " << elapsed << " seconds ("
+         << numVoxels / elapsed / 1000000.0 << " million voxels per second)" << endl;
+}
@@ -31,23 +31,37 @@
 #include "CaretHttpManager.h"
 #include "CaretCommandLine.h"
 #include "CaretException.h"
+#include "CiftiFile.h"
 
 //tests
 #include "CiftiFileTest.h"
+#include "CiftiTransposeTest.h"
+#include "CiftiXMLTest.h"
+#include "ConnectedComponentTest.h"
+#include "CorrelationEngineTest.h"
 #include "DotTest.h"
+#include "EventManagerTest.h"
+#include "FloatMatrixTest.h"
 #include "GeodesicHelperTest.h"
+#include "GraphicsInstancesTest.h"
 #include "HttpTest.h"
 #include "HeapTest.h"
 #include "LookupTest.h"
 #include "MathExpressionTest.h"
 #include "NiftiTest.h"
+#include "PaletteTest.h"
 #include "PointerTest.h"
 #include "ProgressTest.h"
 #include "QuatTest.h"
+#include "RibbonMappingTest.h"
 #include "StatisticsTest.h"
+#include "SurfaceDecimationTest.h"
+#include "SurfaceResampleTest.h"
+#include "TFCETest.h"
 #include "TimerTest.h"
 #include "TopologyHelperTest.h"
 #include "VolumeFileTest.h"
+#include "VolumeSplineTest.h"
 #include "XnatTest.h"
 
 using namespace std;
@@ -70,22 +84,37 @@ int main(int argc, char** argv)
         SessionManager::createSessionManager(ApplicationTypeEnum::APPLICATION_TYPE_COMMAND_LINE);
         vector<TestInterface*> mytests;
         mytests.push_back(new CiftiFileTest("ciftifile"));
+        mytests.push_back(new CiftiTransposeTest("ciftitranspose"));
+        mytests.push_back(new CiftiXMLTest("ciftixml"));
+        mytests.push_back(new ConnectedComponentTest("connectedcomponents"));
+        mytests.push_back(new CorrelationEngineTest("correlationengine"));
         mytests.push_back(new DotTest("dotsimd"));
+        mytests.push_back(new EventManagerTest("eventmanager"));
+        mytests.push_back(new FloatMatrixTest("floatmatrix"));
         mytests.push_back(new GeodesicHelperTest("geohelp"));
+        mytests.push_back(new GraphicsInstancesTest("graphicsinstances"));
         mytests.push_back(new HeapTest("heap"));
         mytests.push_back(new HttpTest("http"));
         mytests.push_back(new LookupTest("lookup"));
         mytests.push_back(new MathExpressionTest("mathexpression"));
         mytests.push_back(new NiftiFileTest("niftifile"));
         mytests.push_back(new NiftiHeaderTest("niftiheader"));
+        mytests.push_back(new PaletteTest("palette"));
         mytests.push_back(new PointerTest("pointer"));
         mytests.push_back(new ProgressTest("progress"));
         mytests.push_back(new QuatTest("quaternion"));
+        mytests.push_back(new RibbonMappingTest("ribbonmapping"));
         mytests.push_back(new StatisticsTest("statistics"));
+        mytests.push_back(new SurfaceDecimationTest("surfacedecimation"));
+        mytests.push_back(new SurfaceResampleTest("surfaceresample"));
+        mytests.push_back(new TFCETest("tfce"));
         mytests.push_back(new TimerTest("timer"));
         mytests.push_back(new TopologyHelperTest("topohelp"));
         mytests.push_back(new VolumeFileTest("volumefile"));
+        mytests.push_back(new VolumeSplineTest("volumespline"));
         mytests.push_back(new XnatTest("xnat"));
+        vector<TestInterface*> manualTests;//slow or memory-hungry, only run when named, not by "all"
+        manualTests.push_back(new VolumeSplineBenchmark("volumesplinebench"));
         if (argc < 2)
         {
             cout << "No test specified, please specify one of the following:" << endl;
@@ -93,7 +122,13 @@ int main(int argc, char** argv)
             {
                 cout << mytests[i]->getIdentifier() << endl;
             }
+            cout << "These are not included in 'all', and must be specified by name:" << endl;
+            for (int i = 0; i < (int)manualTests.size(); ++i)
+            {
+                cout << manualTests[i]->getIdentifier() << endl;
+            }
             freeTestList(mytests);
+            freeTestList(manualTests);
             return 1;//no test specified, fail
         }
         int failCount = 0;
@@ -118,8 +153,28 @@ int main(int argc, char** argv)
                     }
                 }
             }
+            for (int j = 0; j < (int)manualTests.size(); ++j)
+            {
+                if (manualTests[j]->getIdentifier() == AString(argv[i]))
+                {
+                    try
+                    {
+                        manualTests[j]->execute();
+                    } catch (CaretException& e) {
+                        ++failCount;
+                        cout << "Test " << manualTests[j]->getIdentifier() << " failed, exception: " << e.whatString() << endl;
+                        continue;
+                    }
+                    if (manualTests[j]->failed())
+                    {
+                        ++failCount;
+                        cout << "Test " << manualTests[j]->getIdentifier() << " failed: " << manualTests[j]->getFailMessage() << endl;
+                    }
+                }
+            }
         }
         freeTestList(mytests);
+        freeTestList(manualTests);
         if (failCount != 0)
         {
             cout << "Total of " << failCount << " tests failed!" << endl;
@@ -127,6 +182,7 @@ int main(int argc, char** argv)
         }
         SessionManager::deleteSessionManager();
         CaretHttpManager::deleteHttpManager();
+        CiftiFile::clearXMLCache();
         myApp.processEvents();
     }
     CaretObject::printListOfObjectsNotDeleted(true);